@@ -0,0 +1,514 @@
+/****************************************************************************
+ * apps/benchmarks/ahdlc/ahdlc_bench.c
+ *
+ * SPDX-License-Identifier: Apache-2.0
+ *
+ * Licensed to the Apache Software Foundation (ASF) under one or more
+ * contributor license agreements.  See the NOTICE file distributed with
+ * this work for additional information regarding copyright ownership.  The
+ * ASF licenses this file to you under the Apache License, Version 2.0 (the
+ * "License"); you may not use this file except in compliance with the
+ * License.  You may obtain a copy of the License at
+ *
+ *   http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS, WITHOUT
+ * WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.  See the
+ * License for the specific language governing permissions and limitations
+ * under the License.
+ *
+ ****************************************************************************/
+
+/****************************************************************************
+ * Included Files
+ ****************************************************************************/
+
+#include <nuttx/config.h>
+
+#include <errno.h>
+#include <fcntl.h>
+#include <poll.h>
+#include <pthread.h>
+#include <stdbool.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <termios.h>
+#include <time.h>
+#include <unistd.h>
+
+#include "ppp.h"
+
+/****************************************************************************
+ * Pre-processor Definitions
+ ****************************************************************************/
+
+#define AHBENCH_DEFAULT_FRAMES 5000
+#define AHBENCH_DEFAULT_SIZE   512
+
+/****************************************************************************
+ * Private Types
+ ****************************************************************************/
+
+struct ahbench_s
+{
+  int master;                  /* Transmit side of the pty */
+  int slave;                   /* Receive side of the pty */
+  int frames;                  /* Frames to send */
+  int size;                    /* Largest payload size */
+  bool bytewise;               /* Emulate the old byte at a time framing */
+  int errors;                  /* Frames that did not arrive intact */
+};
+
+/****************************************************************************
+ * Private Functions
+ ****************************************************************************/
+
+/****************************************************************************
+ * Name: ahbench_usage
+ ****************************************************************************/
+
+static void ahbench_usage(FAR const char *progname)
+{
+  fprintf(stderr, "usage: %s [-n frames] [-s size]\n", progname);
+  fprintf(stderr, "  -n <n>  Frames sent through the pty [%d]\n",
+          AHBENCH_DEFAULT_FRAMES);
+  fprintf(stderr, "  -s <n>  Largest payload in bytes, up to %d [%d]\n",
+          PPP_RX_BUFFER_SIZE - 4, AHBENCH_DEFAULT_SIZE);
+}
+
+/****************************************************************************
+ * Name: ahbench_payload
+ *
+ * Description:
+ *   Generate the i-th test payload.  Lengths vary from 1 to size and about
+ *   one byte in eight is a flag, an escape or a control character.
+ *
+ ****************************************************************************/
+
+static int ahbench_payload(FAR struct ahbench_s *bench, int i,
+                           FAR uint8_t *buf)
+{
+  uint32_t x = 2654435761u * (i + 1);
+  int len;
+  int j;
+
+  len = 1 + i % bench->size;
+  for (j = 0; j < len; j++)
+    {
+      x ^= x << 13;
+      x ^= x >> 17;
+      x ^= x << 5;
+      buf[j] = (x & 0x700) == 0 ? (uint8_t)(0x7d + (x & 1)) :
+               (x & 0x7000) == 0 ? (uint8_t)(x & 0x1f) : (uint8_t)x;
+    }
+
+  return len;
+}
+
+/****************************************************************************
+ * Name: ahbench_getchar
+ *
+ * Description:
+ *   The single byte read pppd used before ppp_arch_read().
+ *
+ ****************************************************************************/
+
+static int ahbench_getchar(FAR struct ppp_context_s *ctx, FAR uint8_t *c)
+{
+  return read(ctx->ctl.fd, c, 1) == 1;
+}
+
+/****************************************************************************
+ * Name: ahbench_putchar
+ *
+ * Description:
+ *   The single byte write pppd used before ppp_arch_write().
+ *
+ ****************************************************************************/
+
+static void ahbench_putchar(FAR struct ppp_context_s *ctx, uint8_t c)
+{
+  struct pollfd fds;
+
+  while (write(ctx->ctl.fd, &c, 1) < 0 && errno == EAGAIN)
+    {
+      fds.fd = ctx->ctl.fd;
+      fds.events = POLLOUT;
+      fds.revents = 0;
+
+      if (poll(&fds, 1, 1000) <= 0)
+        {
+          break;
+        }
+    }
+}
+
+/****************************************************************************
+ * Name: ahbench_crcadd
+ *
+ * Description:
+ *   The FCS-16 step ahdlc used before the lookup table.
+ *
+ ****************************************************************************/
+
+static uint16_t ahbench_crcadd(uint16_t crcvalue, uint8_t c)
+{
+  uint16_t b;
+
+  b = (crcvalue ^ c) & 0xff;
+  b = (b ^ (b << 4)) & 0xff;
+  b = (b << 8) ^ (b << 3) ^ (b >> 4);
+
+  return ((crcvalue >> 8) ^ b);
+}
+
+/****************************************************************************
+ * Name: ahbench_tx_char
+ ****************************************************************************/
+
+static void ahbench_tx_char(FAR struct ppp_context_s *ctx, uint8_t c)
+{
+  ctx->ahdlc_tx_crc = ahbench_crcadd(ctx->ahdlc_tx_crc, c);
+
+  if (c == 0x7d || c == 0x7e || c < 0x20)
+    {
+      ahbench_putchar(ctx, 0x7d);
+      c ^= 0x20;
+    }
+
+  ahbench_putchar(ctx, c);
+}
+
+/****************************************************************************
+ * Name: ahbench_tx_bytewise
+ *
+ * Description:
+ *   Send an IPv4 frame the way ahdlc_tx() used to: one write() for every
+ *   byte of the escaped frame.
+ *
+ ****************************************************************************/
+
+static void ahbench_tx_bytewise(FAR struct ppp_context_s *ctx,
+                                FAR const uint8_t *buf, int len)
+{
+  uint16_t crc;
+  int i;
+
+  ahbench_putchar(ctx, 0x7e);
+  ctx->ahdlc_tx_crc = 0xffff;
+
+  ahbench_tx_char(ctx, 0xff);
+  ahbench_tx_char(ctx, 0x03);
+  ahbench_tx_char(ctx, (uint8_t)(IPV4 >> 8));
+  ahbench_tx_char(ctx, (uint8_t)(IPV4 & 0xff));
+
+  for (i = 0; i < len; i++)
+    {
+      ahbench_tx_char(ctx, buf[i]);
+    }
+
+  crc = ctx->ahdlc_tx_crc ^ 0xffff;
+  ahbench_tx_char(ctx, (uint8_t)(crc & 0xff));
+  ahbench_tx_char(ctx, (uint8_t)(crc >> 8));
+
+  ahbench_putchar(ctx, 0x7e);
+}
+
+/****************************************************************************
+ * Name: ahbench_sender
+ *
+ * Description:
+ *   The transmit side, frames every payload onto the pty.
+ *
+ ****************************************************************************/
+
+static FAR void *ahbench_sender(FAR void *arg)
+{
+  FAR struct ahbench_s *bench = arg;
+  FAR struct ppp_context_s *ctx;
+  uint8_t buf[PPP_RX_BUFFER_SIZE];
+  int len;
+  int i;
+
+  ctx = calloc(1, sizeof(*ctx));
+  if (ctx == NULL)
+    {
+      return NULL;
+    }
+
+  ctx->ctl.fd = bench->master;
+  ahdlc_init(ctx);
+
+  for (i = 0; i < bench->frames; i++)
+    {
+      len = ahbench_payload(bench, i, buf);
+
+      /* Nothing ever comes back, keep ahdlc_tx() from reconnecting */
+
+      ctx->ahdlc_tx_offline = 0;
+
+      if (bench->bytewise)
+        {
+          ahbench_tx_bytewise(ctx, buf, len);
+        }
+      else
+        {
+          ahdlc_tx(ctx, IPV4, NULL, buf, 0, len);
+        }
+    }
+
+  free(ctx);
+  return NULL;
+}
+
+/****************************************************************************
+ * Name: ahbench_check
+ *
+ * Description:
+ *   Compare the IP packet the upcall left in ip_buf against the expected
+ *   payload and release it.
+ *
+ ****************************************************************************/
+
+static void ahbench_check(FAR struct ahbench_s *bench,
+                          FAR struct ppp_context_s *ctx, int i)
+{
+  uint8_t expect[PPP_RX_BUFFER_SIZE];
+  int len;
+
+  len = ahbench_payload(bench, i, expect);
+  if (ctx->ip_len != len || memcmp(ctx->ip_buf, expect, len) != 0)
+    {
+      bench->errors++;
+    }
+
+  ctx->ip_len = 0;
+}
+
+/****************************************************************************
+ * Name: ahbench_run
+ *
+ * Description:
+ *   Push the frames through the pty and deframe and check them on the
+ *   other side.  Returns the elapsed time in seconds, or a negative value
+ *   on failure.
+ *
+ ****************************************************************************/
+
+static double ahbench_run(FAR struct ahbench_s *bench)
+{
+  FAR struct ppp_context_s *ctx;
+  uint8_t buf[PPP_RX_CHUNK_SIZE];
+  struct timespec start;
+  struct timespec end;
+  struct pollfd fds;
+  pthread_t sender;
+  int got = 0;
+  int pos;
+  int len;
+  int n;
+  uint8_t c;
+
+  ctx = calloc(1, sizeof(*ctx));
+  if (ctx == NULL)
+    {
+      return -1;
+    }
+
+  /* A receiver that only wants IPv4 frames handed up */
+
+  ctx->ctl.fd = bench->slave;
+  ctx->ppp_flags |= PPP_RX_READY;
+  ahdlc_init(ctx);
+  ahdlc_rx_ready(ctx);
+
+  bench->errors = 0;
+  clock_gettime(CLOCK_MONOTONIC, &start);
+
+  pthread_create(&sender, NULL, ahbench_sender, bench);
+
+  while (got < bench->frames)
+    {
+      fds.fd = bench->slave;
+      fds.events = POLLIN;
+      fds.revents = 0;
+
+      if (poll(&fds, 1, 5000) <= 0)
+        {
+          fprintf(stderr, "stalled after %d frames\n", got);
+          break;
+        }
+
+      if (bench->bytewise)
+        {
+          /* One read() and one ahdlc_rx() per byte, as before */
+
+          while (got < bench->frames && ahbench_getchar(ctx, &c))
+            {
+              ahdlc_rx(ctx, c);
+              if (ctx->ip_len != 0)
+                {
+                  ahbench_check(bench, ctx, got++);
+                }
+            }
+
+          continue;
+        }
+
+      len = ppp_arch_read(ctx, buf, sizeof(buf));
+      for (pos = 0; pos < len && got < bench->frames; pos += n)
+        {
+          n = ahdlc_rx_bulk(ctx, &buf[pos], len - pos);
+          if (ctx->ip_len != 0)
+            {
+              ahbench_check(bench, ctx, got++);
+            }
+        }
+    }
+
+  clock_gettime(CLOCK_MONOTONIC, &end);
+
+  pthread_join(sender, NULL);
+  free(ctx);
+
+  if (got < bench->frames)
+    {
+      return -1;
+    }
+
+  return (end.tv_sec - start.tv_sec) +
+         (end.tv_nsec - start.tv_nsec) / 1e9;
+}
+
+/****************************************************************************
+ * Name: ahbench_openpty
+ ****************************************************************************/
+
+static int ahbench_openpty(FAR struct ahbench_s *bench)
+{
+  struct termios tio;
+  char name[32];
+
+  bench->master = posix_openpt(O_RDWR | O_NOCTTY);
+  if (bench->master < 0)
+    {
+      perror("posix_openpt");
+      return -1;
+    }
+
+  if (grantpt(bench->master) < 0 || unlockpt(bench->master) < 0 ||
+      ptsname_r(bench->master, name, sizeof(name)) != 0)
+    {
+      perror("pty setup");
+      close(bench->master);
+      return -1;
+    }
+
+  bench->slave = open(name, O_RDWR | O_NOCTTY);
+  if (bench->slave < 0)
+    {
+      perror(name);
+      close(bench->master);
+      return -1;
+    }
+
+  /* Raw and non-blocking on both ends, like the tty pppd opens */
+
+  if (tcgetattr(bench->slave, &tio) == 0)
+    {
+      cfmakeraw(&tio);
+      tcsetattr(bench->slave, TCSANOW, &tio);
+    }
+
+  fcntl(bench->master, F_SETFL, O_NONBLOCK);
+  fcntl(bench->slave, F_SETFL, O_NONBLOCK);
+  return 0;
+}
+
+/****************************************************************************
+ * Name: ahbench_report
+ ****************************************************************************/
+
+static void ahbench_report(FAR struct ahbench_s *bench,
+                           FAR const char *name, double secs)
+{
+  uint8_t buf[PPP_RX_BUFFER_SIZE];
+  double bytes = 0;
+  int i;
+
+  for (i = 0; i < bench->frames; i++)
+    {
+      bytes += ahbench_payload(bench, i, buf);
+    }
+
+  printf("%-10s %6d frames %9.3f ms %8.0f frames/s %8.1f KiB/s"
+         "  %d errors\n", name, bench->frames, secs * 1000,
+         secs > 0 ? bench->frames / secs : 0,
+         secs > 0 ? bytes / secs / 1024 : 0, bench->errors);
+}
+
+/****************************************************************************
+ * Public Functions
+ ****************************************************************************/
+
+int main(int argc, FAR char *argv[])
+{
+  struct ahbench_s bench;
+  double bytewise;
+  double buffered;
+  int errors;
+  int opt;
+
+  memset(&bench, 0, sizeof(bench));
+  bench.frames = AHBENCH_DEFAULT_FRAMES;
+  bench.size = AHBENCH_DEFAULT_SIZE;
+
+  while ((opt = getopt(argc, argv, "n:s:h")) != ERROR)
+    {
+      switch (opt)
+        {
+          case 'n':
+            bench.frames = atoi(optarg);
+            break;
+
+          case 's':
+            bench.size = atoi(optarg);
+            break;
+
+          default:
+            ahbench_usage(argv[0]);
+            return opt == 'h' ? EXIT_SUCCESS : EXIT_FAILURE;
+        }
+    }
+
+  if (bench.frames <= 0 || bench.size <= 0 ||
+      bench.size > PPP_RX_BUFFER_SIZE - 4)
+    {
+      ahbench_usage(argv[0]);
+      return EXIT_FAILURE;
+    }
+
+  if (ahbench_openpty(&bench) < 0)
+    {
+      return EXIT_FAILURE;
+    }
+
+  bench.bytewise = true;
+  bytewise = ahbench_run(&bench);
+  ahbench_report(&bench, "byte-wise", bytewise);
+
+  errors = bench.errors;
+  bench.bytewise = false;
+  buffered = ahbench_run(&bench);
+  ahbench_report(&bench, "buffered", buffered);
+
+  errors += bench.errors;
+
+  close(bench.slave);
+  close(bench.master);
+
+  return bytewise > 0 && buffered > 0 && errors == 0 ?
+         EXIT_SUCCESS : EXIT_FAILURE;
+}
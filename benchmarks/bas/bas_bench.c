@@ -0,0 +1,241 @@
+/****************************************************************************
+ * apps/benchmarks/bas/bas_bench.c
+ *
+ * SPDX-License-Identifier: Apache-2.0
+ *
+ * Licensed to the Apache Software Foundation (ASF) under one or more
+ * contributor license agreements.  See the NOTICE file distributed with
+ * this work for additional information regarding copyright ownership.  The
+ * ASF licenses this file to you under the Apache License, Version 2.0 (the
+ * "License"); you may not use this file except in compliance with the
+ * License.  You may obtain a copy of the License at
+ *
+ *   http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS, WITHOUT
+ * WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.  See the
+ * License for the specific language governing permissions and limitations
+ * under the License.
+ *
+ ****************************************************************************/
+
+/****************************************************************************
+ * Included Files
+ ****************************************************************************/
+
+#include <nuttx/config.h>
+
+#include <fcntl.h>
+#include <stdbool.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+#include <unistd.h>
+
+#include "bas.h"
+#include "bas_fs.h"
+
+/****************************************************************************
+ * Pre-processor Definitions
+ ****************************************************************************/
+
+#define BASBENCH_DEFAULT_PATH       "/tmp/bas_bench.bas"
+#define BASBENCH_DEFAULT_ITERATIONS 20000
+#define BASBENCH_PROGLEN            512
+
+/****************************************************************************
+ * Private Types
+ ****************************************************************************/
+
+struct basbench_s
+{
+  FAR const char *name;
+  FAR const char *program;  /* printf() format of the program lines */
+};
+
+/****************************************************************************
+ * Private Data
+ ****************************************************************************/
+
+static const struct basbench_s g_basbench[] =
+{
+  {
+    "int loop",
+    "10 S%%=0\n"
+    "20 FOR I%%=1 TO %d\n"
+    "30 S%%=S%%+(I%% AND 7)*3-I%% MOD 5\n"
+    "40 NEXT I%%\n"
+    "50 PRINT S%%\n"
+  },
+  {
+    "real arith",
+    "10 X=0\n"
+    "20 FOR I=1 TO %d\n"
+    "30 X=X+I*0.5/(I+1)-X/1000\n"
+    "40 NEXT I\n"
+    "50 PRINT X\n"
+  },
+  {
+    "arrays",
+    "10 DIM A(100)\n"
+    "20 FOR I=0 TO 100:A(I)=I:NEXT I\n"
+    "30 FOR I=1 TO %d\n"
+    "40 J=I MOD 100+1\n"
+    "50 S=S+A(J)-A(J-1)*2\n"
+    "60 A(J-1)=A(J)+1\n"
+    "70 NEXT I\n"
+    "80 PRINT S\n"
+  },
+  {
+    "strings",
+    "10 FOR I=1 TO %d\n"
+    "20 S$=CHR$(65+I MOD 26)+\"x\"\n"
+    "30 N=N+LEN(S$)+ASC(MID$(\"ABCDEFGH\",1+I MOD 8,1))\n"
+    "40 NEXT I\n"
+    "50 PRINT N\n"
+  },
+  {
+    "branches",
+    "10 WHILE I<%d\n"
+    "20 I=I+1\n"
+    "30 IF I MOD 3=0 OR I MOD 5=0 THEN C=C+I ELSE C=C-1\n"
+    "40 WEND\n"
+    "50 PRINT C\n"
+  }
+};
+
+/****************************************************************************
+ * Private Functions
+ ****************************************************************************/
+
+/****************************************************************************
+ * Name: basbench_usage
+ ****************************************************************************/
+
+static void basbench_usage(FAR const char *progname)
+{
+  fprintf(stderr, "usage: %s [-f file] [-n iterations]\n", progname);
+  fprintf(stderr, "  -f <file>  Scratch file for the programs [%s]\n",
+          BASBENCH_DEFAULT_PATH);
+  fprintf(stderr, "  -n <n>     Loop iterations per program [%d]\n",
+          BASBENCH_DEFAULT_ITERATIONS);
+}
+
+/****************************************************************************
+ * Name: basbench_run
+ *
+ * Description:
+ *   Save a program to path, run it and return the elapsed time in seconds.
+ *
+ ****************************************************************************/
+
+static double basbench_run(FAR const char *path, FAR const char *program,
+                           bool bytecode)
+{
+  struct timespec start;
+  struct timespec end;
+  FAR FILE *stream;
+
+  stream = fopen(path, "w");
+  if (stream == NULL)
+    {
+      perror(path);
+      return 0;
+    }
+
+  fputs(program, stream);
+  fclose(stream);
+
+  g_bas_bytecode = bytecode;
+
+  clock_gettime(CLOCK_MONOTONIC, &start);
+  bas_runFile(path);
+  FS_flush(STDCHANNEL);
+  clock_gettime(CLOCK_MONOTONIC, &end);
+
+  return (end.tv_sec - start.tv_sec) +
+         (end.tv_nsec - start.tv_nsec) / 1e9;
+}
+
+/****************************************************************************
+ * Public Functions
+ ****************************************************************************/
+
+int main(int argc, FAR char *argv[])
+{
+  FAR const char *path = BASBENCH_DEFAULT_PATH;
+  char program[BASBENCH_PROGLEN];
+  int iterations = BASBENCH_DEFAULT_ITERATIONS;
+  double total_tree = 0;
+  double total_code = 0;
+  double tree;
+  double code;
+  bool saved;
+  size_t i;
+  int lpfd;
+  int opt;
+
+  while ((opt = getopt(argc, argv, "f:n:h")) != ERROR)
+    {
+      switch (opt)
+        {
+          case 'f':
+            path = optarg;
+            break;
+
+          case 'n':
+            iterations = atoi(optarg);
+            break;
+
+          default:
+            basbench_usage(argv[0]);
+            return opt == 'h' ? EXIT_SUCCESS : EXIT_FAILURE;
+        }
+    }
+
+  if (iterations <= 0)
+    {
+      basbench_usage(argv[0]);
+      return EXIT_FAILURE;
+    }
+
+  lpfd = open("/dev/null", O_WRONLY);
+  if (lpfd < 0)
+    {
+      perror("open /dev/null");
+      return EXIT_FAILURE;
+    }
+
+  saved = g_bas_bytecode;
+  bas_init(0, 1, 0, lpfd);
+
+  for (i = 0; i < sizeof(g_basbench) / sizeof(g_basbench[0]); i++)
+    {
+      snprintf(program, sizeof(program), g_basbench[i].program,
+               iterations);
+      tree = basbench_run(path, program, false);
+      code = basbench_run(path, program, true);
+
+      total_tree += tree;
+      total_code += code;
+
+      printf("%-12s tree %9.3f ms  bytecode %9.3f ms  speedup %5.2fx\n",
+             g_basbench[i].name, tree * 1000, code * 1000,
+             code > 0 ? tree / code : 0);
+      fflush(stdout);
+    }
+
+  printf("%-12s tree %9.3f ms  bytecode %9.3f ms  speedup %5.2fx\n",
+         "total", total_tree * 1000, total_code * 1000,
+         total_code > 0 ? total_tree / total_code : 0);
+  fflush(stdout);
+
+  /* bas_exit() closes the standard output channel as well */
+
+  bas_exit();
+  unlink(path);
+  g_bas_bytecode = saved;
+  return EXIT_SUCCESS;
+}
@@ -0,0 +1,748 @@
+/****************************************************************************
+ * apps/benchmarks/cmux/cmux_bench.c
+ *
+ * SPDX-License-Identifier: Apache-2.0
+ *
+ * Licensed to the Apache Software Foundation (ASF) under one or more
+ * contributor license agreements.  See the NOTICE file distributed with
+ * this work for additional information regarding copyright ownership.  The
+ * ASF licenses this file to you under the Apache License, Version 2.0 (the
+ * "License"); you may not use this file except in compliance with the
+ * License.  You may obtain a copy of the License at
+ *
+ *   http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS, WITHOUT
+ * WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.  See the
+ * License for the specific language governing permissions and limitations
+ * under the License.
+ *
+ ****************************************************************************/
+
+/****************************************************************************
+ * Included Files
+ ****************************************************************************/
+
+#include <nuttx/config.h>
+
+#include <errno.h>
+#include <fcntl.h>
+#include <inttypes.h>
+#include <poll.h>
+#include <pthread.h>
+#include <stdbool.h>
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <termios.h>
+#include <time.h>
+#include <unistd.h>
+
+#include "netutils/cmux.h"
+
+/****************************************************************************
+ * Pre-processor Definitions
+ ****************************************************************************/
+
+#define CXBENCH_DEFAULT_CHANNELS 3
+#define CXBENCH_DEFAULT_SIZE     256
+#define CXBENCH_DEFAULT_PINGS    200
+#define CXBENCH_MAX_CHANNELS     8
+#define CXBENCH_PING_SIZE        16
+#define CXBENCH_CHUNK            512
+#define CXBENCH_MODEM_BUFFER     4096
+#define CXBENCH_MODEM_QUEUE      65536
+#define CXBENCH_TIMEOUT          5000
+
+#define CXBENCH_FLAG             0xf9
+#define CXBENCH_SABM             0x2f
+#define CXBENCH_UA               0x63
+#define CXBENCH_UIH              0xef
+#define CXBENCH_PF               0x10
+
+/****************************************************************************
+ * Private Types
+ ****************************************************************************/
+
+struct cxbench_s
+{
+  int modem;                   /* Modem side of the UART pty */
+  int channels;                /* Data channels, DLCI 1 to channels */
+  int size;                    /* KiB echoed per channel */
+  int pings;                   /* Latency round trips per channel */
+  unsigned long frames;        /* UIH frames the modem received */
+  unsigned long reads;         /* Modem reads that returned frames */
+};
+
+struct cxbench_channel_s
+{
+  FAR struct cxbench_s *bench;
+  int dlci;                    /* Channel number */
+  char path[CMUX_CHANNEL_NAME_SZ];
+  double secs;                 /* Time taken by the echo transfer */
+  uint32_t rtt_min;            /* Round trip times in microseconds */
+  uint32_t rtt_max;
+  uint64_t rtt_total;
+  int errors;                  /* Bytes that came back wrong or not at all */
+};
+
+/****************************************************************************
+ * Private Functions
+ ****************************************************************************/
+
+/****************************************************************************
+ * Name: cxbench_usage
+ ****************************************************************************/
+
+static void cxbench_usage(FAR const char *progname)
+{
+  fprintf(stderr, "usage: %s [-c channels] [-s kbytes] [-p pings]\n",
+          progname);
+  fprintf(stderr, "  -c <n>  Data channels, up to %d [%d]\n",
+          CXBENCH_MAX_CHANNELS, CXBENCH_DEFAULT_CHANNELS);
+  fprintf(stderr, "  -s <n>  KiB echoed through each channel [%d]\n",
+          CXBENCH_DEFAULT_SIZE);
+  fprintf(stderr, "  -p <n>  Latency round trips per channel [%d]\n",
+          CXBENCH_DEFAULT_PINGS);
+}
+
+/****************************************************************************
+ * Name: cxbench_now
+ ****************************************************************************/
+
+static uint64_t cxbench_now(void)
+{
+  struct timespec ts;
+
+  clock_gettime(CLOCK_MONOTONIC, &ts);
+  return (uint64_t)ts.tv_sec * 1000000 + ts.tv_nsec / 1000;
+}
+
+/****************************************************************************
+ * Name: cxbench_pattern
+ *
+ * Description:
+ *   The byte at offset of the test stream of a channel.  It contains flag
+ *   octets, which basic option frames carry without escaping.
+ *
+ ****************************************************************************/
+
+static uint8_t cxbench_pattern(int dlci, uint32_t offset)
+{
+  return (uint8_t)((offset * 7) ^ (offset >> 8) ^ (dlci * 0x5b));
+}
+
+/****************************************************************************
+ * Name: cxbench_fcs
+ *
+ * Description:
+ *   GSM 07.10 frame checking sequence, computed bit by bit so that it is
+ *   independent of the table in the multiplexer.
+ *
+ ****************************************************************************/
+
+static uint8_t cxbench_fcs(FAR const uint8_t *data, int len)
+{
+  uint8_t fcs = 0xff;
+  int i;
+
+  while (len-- > 0)
+    {
+      fcs ^= *data++;
+      for (i = 0; i < 8; i++)
+        {
+          fcs = (fcs & 1) ? (fcs >> 1) ^ 0xe0 : fcs >> 1;
+        }
+    }
+
+  return 0xff - fcs;
+}
+
+/****************************************************************************
+ * Name: cxbench_frame
+ *
+ * Description:
+ *   Encode a frame from the modem into buf, returns its length.
+ *
+ ****************************************************************************/
+
+static int cxbench_frame(FAR uint8_t *buf, int dlci, uint8_t control,
+                         FAR const uint8_t *data, int len)
+{
+  int hdr;
+
+  buf[0] = CXBENCH_FLAG;
+  buf[1] = 0x01 | (dlci << 2);
+  buf[2] = control;
+  if (len <= 127)
+    {
+      buf[3] = 0x01 | (len << 1);
+      hdr = 4;
+    }
+  else
+    {
+      buf[3] = (len << 1) & 0xfe;
+      buf[4] = 0x01 | ((len >> 7) << 1);
+      hdr = 5;
+    }
+
+  if (len > 0)
+    {
+      memcpy(&buf[hdr], data, len);
+    }
+
+  buf[hdr + len] = cxbench_fcs(&buf[1], hdr - 1);
+  buf[hdr + len + 1] = CXBENCH_FLAG;
+  return hdr + len + 2;
+}
+
+/****************************************************************************
+ * Name: cxbench_modem_frames
+ *
+ * Description:
+ *   Answer every complete frame at the start of buf: UA for SABM and the
+ *   same data back for UIH.  The answers go to out, returns the number of
+ *   bytes of buf used.
+ *
+ ****************************************************************************/
+
+static int cxbench_modem_frames(FAR struct cxbench_s *bench,
+                                FAR const uint8_t *buf, int len,
+                                FAR uint8_t *out, FAR int *outlen)
+{
+  int pos = 0;
+  int hdr;
+  int dlen;
+  int dlci;
+
+  for (; ; )
+    {
+      /* Find the open flag, the last one of a run */
+
+      while (pos < len && buf[pos] != CXBENCH_FLAG)
+        {
+          pos++;
+        }
+
+      while (pos + 1 < len && buf[pos + 1] == CXBENCH_FLAG)
+        {
+          pos++;
+        }
+
+      if (len - pos < 6)
+        {
+          return pos;
+        }
+
+      hdr = (buf[pos + 3] & 1) ? 4 : 5;
+      dlen = buf[pos + 3] >> 1;
+      if (hdr == 5)
+        {
+          dlen |= (buf[pos + 4] >> 1) << 7;
+        }
+
+      if (len - pos < hdr + dlen + 2)
+        {
+          return pos;
+        }
+
+      if (cxbench_fcs(&buf[pos + 1], hdr - 1) != buf[pos + hdr + dlen] ||
+          buf[pos + hdr + dlen + 1] != CXBENCH_FLAG)
+        {
+          pos++;
+          continue;
+        }
+
+      dlci = buf[pos + 1] >> 2;
+      switch (buf[pos + 2] & ~CXBENCH_PF)
+        {
+          case CXBENCH_SABM:
+            *outlen += cxbench_frame(&out[*outlen], dlci,
+                                     CXBENCH_UA | CXBENCH_PF, NULL, 0);
+            break;
+
+          case CXBENCH_UIH:
+            bench->frames++;
+            if (dlci > 0)
+              {
+                *outlen += cxbench_frame(&out[*outlen], dlci, CXBENCH_UIH,
+                                         &buf[pos + hdr], dlen);
+              }
+            break;
+
+          default:
+            break;
+        }
+
+      pos += hdr + dlen + 2;
+    }
+}
+
+/****************************************************************************
+ * Name: cxbench_modem
+ *
+ * Description:
+ *   The emulated modem: answer AT+CMUX with OK, then echo every channel.
+ *
+ ****************************************************************************/
+
+static FAR void *cxbench_modem(FAR void *arg)
+{
+  FAR struct cxbench_s *bench = arg;
+  FAR uint8_t *buf;
+  FAR uint8_t *out;
+  struct pollfd fds;
+  bool muxing = false;
+  int outhead = 0;
+  int outlen = 0;
+  int len = 0;
+  int ret;
+  int n;
+
+  buf = malloc(CXBENCH_MODEM_BUFFER);
+  out = malloc(CXBENCH_MODEM_QUEUE);
+  if (buf == NULL || out == NULL)
+    {
+      goto out;
+    }
+
+  /* Like a real modem, keep reading while the answers drain, or both
+   * sides of the line could end up waiting for each other.
+   */
+
+  for (; ; )
+    {
+      fds.fd = bench->modem;
+      fds.events = 0;
+      fds.revents = 0;
+
+      if (outlen + CXBENCH_MODEM_BUFFER <= CXBENCH_MODEM_QUEUE)
+        {
+          fds.events |= POLLIN;
+        }
+
+      if (outlen > 0)
+        {
+          fds.events |= POLLOUT;
+        }
+
+      if (poll(&fds, 1, -1) < 0)
+        {
+          break;
+        }
+
+      if ((fds.revents & POLLOUT) != 0)
+        {
+          ret = write(bench->modem, &out[outhead], outlen);
+          if (ret > 0)
+            {
+              outhead += ret;
+              outlen -= ret;
+            }
+        }
+
+      if ((fds.revents & POLLIN) == 0)
+        {
+          continue;
+        }
+
+      ret = read(bench->modem, &buf[len], CXBENCH_MODEM_BUFFER - len);
+      if (ret <= 0)
+        {
+          continue;
+        }
+
+      len += ret;
+      if (!muxing)
+        {
+          buf[len < CXBENCH_MODEM_BUFFER ? len : len - 1] = '\0';
+          if (strstr((FAR char *)buf, "AT+CMUX") != NULL &&
+              strchr((FAR char *)buf, '\r') != NULL)
+            {
+              write(bench->modem, "\r\nOK\r\n", 6);
+              muxing = true;
+              len = 0;
+            }
+
+          continue;
+        }
+
+      /* Queue the answers behind what is still waiting to be sent */
+
+      memmove(out, &out[outhead], outlen);
+      outhead = 0;
+
+      ret = outlen;
+      n = cxbench_modem_frames(bench, buf, len, out, &outlen);
+      if (outlen > ret)
+        {
+          bench->reads++;
+        }
+
+      memmove(buf, &buf[n], len - n);
+      len -= n;
+      if (len == CXBENCH_MODEM_BUFFER)
+        {
+          len = 0;
+        }
+    }
+
+out:
+  free(out);
+  free(buf);
+  return NULL;
+}
+
+/****************************************************************************
+ * Name: cxbench_recv
+ *
+ * Description:
+ *   Read exactly len bytes from a channel, returns false on timeout.
+ *
+ ****************************************************************************/
+
+static bool cxbench_recv(int fd, FAR uint8_t *buf, int len)
+{
+  struct pollfd fds;
+  int ret;
+
+  while (len > 0)
+    {
+      fds.fd = fd;
+      fds.events = POLLIN;
+      fds.revents = 0;
+      if (poll(&fds, 1, CXBENCH_TIMEOUT) <= 0)
+        {
+          return false;
+        }
+
+      ret = read(fd, buf, len);
+      if (ret > 0)
+        {
+          buf += ret;
+          len -= ret;
+        }
+    }
+
+  return true;
+}
+
+/****************************************************************************
+ * Name: cxbench_ping
+ *
+ * Description:
+ *   Time round trips of short messages on an otherwise idle channel.
+ *
+ ****************************************************************************/
+
+static void cxbench_ping(FAR struct cxbench_channel_s *ch, int fd)
+{
+  uint8_t msg[CXBENCH_PING_SIZE];
+  uint8_t echo[CXBENCH_PING_SIZE];
+  uint64_t start;
+  uint32_t rtt;
+  int i;
+  int j;
+
+  ch->rtt_min = UINT32_MAX;
+  for (i = 0; i < ch->bench->pings; i++)
+    {
+      for (j = 0; j < CXBENCH_PING_SIZE; j++)
+        {
+          msg[j] = cxbench_pattern(ch->dlci, i + j);
+        }
+
+      start = cxbench_now();
+      if (write(fd, msg, sizeof(msg)) != sizeof(msg) ||
+          !cxbench_recv(fd, echo, sizeof(echo)))
+        {
+          ch->errors++;
+          return;
+        }
+
+      rtt = cxbench_now() - start;
+      ch->rtt_total += rtt;
+      ch->rtt_min = rtt < ch->rtt_min ? rtt : ch->rtt_min;
+      ch->rtt_max = rtt > ch->rtt_max ? rtt : ch->rtt_max;
+
+      if (memcmp(msg, echo, sizeof(msg)) != 0)
+        {
+          ch->errors++;
+        }
+    }
+}
+
+/****************************************************************************
+ * Name: cxbench_stream
+ *
+ * Description:
+ *   Write the test stream to a channel while reading and checking what
+ *   comes back.
+ *
+ ****************************************************************************/
+
+static void cxbench_stream(FAR struct cxbench_channel_s *ch, int fd)
+{
+  uint8_t buf[CXBENCH_CHUNK];
+  struct pollfd fds;
+  uint32_t total = ch->bench->size * 1024;
+  uint32_t sent = 0;
+  uint32_t got = 0;
+  uint64_t start;
+  int len;
+  int ret;
+  int i;
+
+  start = cxbench_now();
+  while (got < total)
+    {
+      fds.fd = fd;
+      fds.events = sent < total ? POLLIN | POLLOUT : POLLIN;
+      fds.revents = 0;
+      if (poll(&fds, 1, CXBENCH_TIMEOUT) <= 0)
+        {
+          ch->errors += total - got;
+          break;
+        }
+
+      if ((fds.revents & POLLOUT) != 0 && sent < total)
+        {
+          len = total - sent < CXBENCH_CHUNK ? total - sent : CXBENCH_CHUNK;
+          for (i = 0; i < len; i++)
+            {
+              buf[i] = cxbench_pattern(ch->dlci, sent + i);
+            }
+
+          ret = write(fd, buf, len);
+          if (ret > 0)
+            {
+              sent += ret;
+            }
+        }
+
+      if ((fds.revents & POLLIN) != 0)
+        {
+          ret = read(fd, buf, sizeof(buf));
+          for (i = 0; i < ret; i++)
+            {
+              if (buf[i] != cxbench_pattern(ch->dlci, got + i))
+                {
+                  ch->errors++;
+                }
+            }
+
+          if (ret > 0)
+            {
+              got += ret;
+            }
+        }
+    }
+
+  ch->secs = (cxbench_now() - start) / 1e6;
+}
+
+/****************************************************************************
+ * Name: cxbench_channel
+ *
+ * Description:
+ *   One channel user: latency first, then throughput, while the other
+ *   channels do the same.
+ *
+ ****************************************************************************/
+
+static FAR void *cxbench_channel(FAR void *arg)
+{
+  FAR struct cxbench_channel_s *ch = arg;
+  struct termios tio;
+  int fd;
+
+  fd = open(ch->path, O_RDWR | O_NOCTTY | O_NONBLOCK);
+  if (fd < 0)
+    {
+      perror(ch->path);
+      ch->errors++;
+      return NULL;
+    }
+
+  if (tcgetattr(fd, &tio) == 0)
+    {
+      cfmakeraw(&tio);
+      tcsetattr(fd, TCSANOW, &tio);
+    }
+
+  cxbench_ping(ch, fd);
+  if (ch->errors == 0)
+    {
+      cxbench_stream(ch, fd);
+    }
+
+  close(fd);
+  return NULL;
+}
+
+/****************************************************************************
+ * Name: cxbench_openpty
+ *
+ * Description:
+ *   Create the UART pty, the multiplexer gets the slave side.
+ *
+ ****************************************************************************/
+
+static int cxbench_openpty(FAR struct cxbench_s *bench, FAR char *name,
+                           size_t size)
+{
+  struct termios tio;
+  int fd;
+
+  bench->modem = posix_openpt(O_RDWR | O_NOCTTY);
+  if (bench->modem < 0)
+    {
+      perror("posix_openpt");
+      return -1;
+    }
+
+  if (grantpt(bench->modem) < 0 || unlockpt(bench->modem) < 0 ||
+      ptsname_r(bench->modem, name, size) != 0)
+    {
+      perror("pty setup");
+      close(bench->modem);
+      return -1;
+    }
+
+  /* Make the line raw before the multiplexer opens it */
+
+  fd = open(name, O_RDWR | O_NOCTTY);
+  if (fd < 0)
+    {
+      perror(name);
+      close(bench->modem);
+      return -1;
+    }
+
+  if (tcgetattr(fd, &tio) == 0)
+    {
+      cfmakeraw(&tio);
+      tcsetattr(fd, TCSANOW, &tio);
+    }
+
+  close(fd);
+  fcntl(bench->modem, F_SETFL, O_NONBLOCK);
+  return 0;
+}
+
+/****************************************************************************
+ * Public Functions
+ ****************************************************************************/
+
+int main(int argc, FAR char *argv[])
+{
+  struct cxbench_channel_s ch[CXBENCH_MAX_CHANNELS];
+  char paths[CXBENCH_MAX_CHANNELS + 1][CMUX_CHANNEL_NAME_SZ];
+  FAR char *pathp[CXBENCH_MAX_CHANNELS + 1];
+  pthread_t threads[CXBENCH_MAX_CHANNELS];
+  struct cmux_settings_s settings;
+  struct cxbench_s bench;
+  char uart[CMUX_CHANNEL_NAME_SZ];
+  pthread_t modem;
+  double bytes = 0;
+  double secs = 0;
+  int errors = 0;
+  int opt;
+  int i;
+
+  memset(&bench, 0, sizeof(bench));
+  bench.channels = CXBENCH_DEFAULT_CHANNELS;
+  bench.size = CXBENCH_DEFAULT_SIZE;
+  bench.pings = CXBENCH_DEFAULT_PINGS;
+
+  while ((opt = getopt(argc, argv, "c:s:p:h")) != ERROR)
+    {
+      switch (opt)
+        {
+          case 'c':
+            bench.channels = atoi(optarg);
+            break;
+
+          case 's':
+            bench.size = atoi(optarg);
+            break;
+
+          case 'p':
+            bench.pings = atoi(optarg);
+            break;
+
+          default:
+            cxbench_usage(argv[0]);
+            return opt == 'h' ? EXIT_SUCCESS : EXIT_FAILURE;
+        }
+    }
+
+  if (bench.channels <= 0 || bench.channels > CXBENCH_MAX_CHANNELS ||
+      bench.size < 0 || bench.pings < 0)
+    {
+      cxbench_usage(argv[0]);
+      return EXIT_FAILURE;
+    }
+
+  if (cxbench_openpty(&bench, uart, sizeof(uart)) < 0)
+    {
+      return EXIT_FAILURE;
+    }
+
+  pthread_create(&modem, NULL, cxbench_modem, &bench);
+
+  /* Channel 0 is the control channel, the data channels follow it */
+
+  for (i = 0; i <= bench.channels; i++)
+    {
+      pathp[i] = paths[i];
+    }
+
+  memset(&settings, 0, sizeof(settings));
+  settings.tty_name = uart;
+  settings.script = "\"\" AT+CMUX=0 OK \\c";
+  settings.total_channels = bench.channels + 1;
+  settings.channel_paths = pathp;
+
+  printf("Opening %d channels on %s\n", settings.total_channels, uart);
+  if (cmux_create(&settings) != 0)
+    {
+      fprintf(stderr, "cmux_create failed\n");
+      return EXIT_FAILURE;
+    }
+
+  memset(ch, 0, sizeof(ch));
+  for (i = 0; i < bench.channels; i++)
+    {
+      ch[i].bench = &bench;
+      ch[i].dlci = i + 1;
+      strlcpy(ch[i].path, paths[i + 1], sizeof(ch[i].path));
+      pthread_create(&threads[i], NULL, cxbench_channel, &ch[i]);
+    }
+
+  for (i = 0; i < bench.channels; i++)
+    {
+      pthread_join(threads[i], NULL);
+    }
+
+  for (i = 0; i < bench.channels; i++)
+    {
+      printf("dlci %d  rtt min %5" PRIu32 " avg %5" PRIu64 " max %6"
+             PRIu32 " us  %6d KiB %9.1f KiB/s  %d errors\n",
+             ch[i].dlci, ch[i].rtt_min == UINT32_MAX ? 0 : ch[i].rtt_min,
+             bench.pings > 0 ? ch[i].rtt_total / bench.pings : 0,
+             ch[i].rtt_max, bench.size,
+             ch[i].secs > 0 ? bench.size / ch[i].secs : 0, ch[i].errors);
+
+      bytes += bench.size;
+      secs = ch[i].secs > secs ? ch[i].secs : secs;
+      errors += ch[i].errors;
+    }
+
+  printf("total %9.1f KiB/s, %lu frames in %lu modem reads\n",
+         secs > 0 ? bytes / secs : 0, bench.frames, bench.reads);
+
+  return errors == 0 ? EXIT_SUCCESS : EXIT_FAILURE;
+}
@@ -0,0 +1,588 @@
+/****************************************************************************
+ * apps/benchmarks/codecbench/codecbench_main.c
+ *
+ * SPDX-License-Identifier: Apache-2.0
+ *
+ * Licensed to the Apache Software Foundation (ASF) under one or more
+ * contributor license agreements.  See the NOTICE file distributed with
+ * this work for additional information regarding copyright ownership.  The
+ * ASF licenses this file to you under the Apache License, Version 2.0 (the
+ * "License"); you may not use this file except in compliance with the
+ * License.  You may obtain a copy of the License at
+ *
+ *   http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS, WITHOUT
+ * WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.  See the
+ * License for the specific language governing permissions and limitations
+ * under the License.
+ *
+ ****************************************************************************/
+
+/****************************************************************************
+ * Included Files
+ ****************************************************************************/
+
+#include <nuttx/config.h>
+
+#include <sys/param.h>
+#include <sys/types.h>
+#include <inttypes.h>
+#include <stdbool.h>
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+#include <time.h>
+
+#include "netutils/base64.h"
+#include "netutils/md5.h"
+#include "netutils/urldecode.h"
+
+/****************************************************************************
+ * Pre-processor Definitions
+ ****************************************************************************/
+
+#define CODECBENCH_DEFAULT_SIZE   16384
+#define CODECBENCH_DEFAULT_ROUNDS 100
+#define CODECBENCH_RANDOM_RUNS    200
+
+#define CODECBENCH_CHECK(cond) \
+  codecbench_check((cond), #cond, __LINE__)
+
+/****************************************************************************
+ * Private Types
+ ****************************************************************************/
+
+struct codecbench_vector_s
+{
+  FAR const char *plain;
+  FAR const char *coded;
+};
+
+/****************************************************************************
+ * Private Data
+ ****************************************************************************/
+
+/* RFC 4648, section 10 */
+
+static const struct codecbench_vector_s g_base64_vectors[] =
+{
+  { "",       ""         },
+  { "f",      "Zg=="     },
+  { "fo",     "Zm8="     },
+  { "foo",    "Zm9v"     },
+  { "foob",   "Zm9vYg==" },
+  { "fooba",  "Zm9vYmE=" },
+  { "foobar", "Zm9vYmFy" },
+};
+
+/* RFC 1321, appendix A.5 */
+
+static const struct codecbench_vector_s g_md5_vectors[] =
+{
+  { "", "d41d8cd98f00b204e9800998ecf8427e" },
+  { "a", "0cc175b9c0f1b6a831c399e269772661" },
+  { "abc", "900150983cd24fb0d6963f7d28e17f72" },
+  { "message digest", "f96b697d7cb7938d525a2f31aaf161d0" },
+  { "abcdefghijklmnopqrstuvwxyz", "c3fcd3d76192e4007dfb496cca67e13b" },
+  {
+    "ABCDEFGHIJKLMNOPQRSTUVWXYZabcdefghijklmnopqrstuvwxyz0123456789",
+    "d174ab98d277d9f5a5611c2c9f419d9f"
+  },
+  {
+    "1234567890123456789012345678901234567890"
+    "1234567890123456789012345678901234567890",
+    "57edf4a22be3c955ac49da2e2107b67a"
+  },
+};
+
+static const struct codecbench_vector_s g_url_vectors[] =
+{
+  { "a b", "a+b" },
+  { "100%", "100%25" },
+  { "key=v&x=~_-.", "key%3Dv%26x%3D~_-." },
+  { "\xc3\xa9t\xc3\xa9", "%C3%A9t%C3%A9" },
+};
+
+static int g_failures;
+
+/****************************************************************************
+ * Private Functions
+ ****************************************************************************/
+
+/****************************************************************************
+ * Name: codecbench_check
+ ****************************************************************************/
+
+static void codecbench_check(bool cond, FAR const char *expr, int line)
+{
+  if (!cond)
+    {
+      printf("FAIL line %d: %s\n", line, expr);
+      g_failures++;
+    }
+}
+
+/****************************************************************************
+ * Name: codecbench_now
+ ****************************************************************************/
+
+static uint64_t codecbench_now(void)
+{
+  struct timespec ts;
+
+  clock_gettime(CLOCK_MONOTONIC, &ts);
+  return (uint64_t)ts.tv_sec * 1000000 + ts.tv_nsec / 1000;
+}
+
+/****************************************************************************
+ * Name: codecbench_random
+ ****************************************************************************/
+
+static uint32_t codecbench_random(FAR uint32_t *state)
+{
+  uint32_t x = *state;
+
+  x ^= x << 13;
+  x ^= x >> 17;
+  x ^= x << 5;
+  *state = x;
+  return x;
+}
+
+/****************************************************************************
+ * Name: ref_base64_decode
+ *
+ * Description:
+ *   The former strchr() based decoder, as reference for the results and
+ *   the speed of base64_decode().
+ *
+ ****************************************************************************/
+
+static size_t ref_base64_decode(FAR const unsigned char *src, size_t len,
+                                FAR unsigned char *dst)
+{
+  static const char table[] =
+    "ABCDEFGHIJKLMNOPQRSTUVWXYZabcdefghijklmnopqrstuvwxyz0123456789+/";
+  FAR unsigned char *pos = dst;
+  unsigned char block[4];
+  FAR char *tmp;
+  size_t count = 0;
+  size_t i;
+
+  for (i = 0; i < len; i++)
+    {
+      tmp = strchr(table, src[i]);
+      block[count] = tmp ? tmp - table : 0;
+      count++;
+
+      if (count == 4)
+        {
+          *pos++ = (block[0] << 2) | (block[1] >> 4);
+          if (src[i - 1] == '=')
+            {
+              break;
+            }
+
+          *pos++ = (block[1] << 4) | (block[2] >> 2);
+          if (src[i] == '=')
+            {
+              break;
+            }
+
+          *pos++ = (block[2] << 6) | block[3];
+          count = 0;
+        }
+    }
+
+  return pos - dst;
+}
+
+/****************************************************************************
+ * Name: codecbench_base64
+ ****************************************************************************/
+
+static void codecbench_base64(void)
+{
+  struct base64_ctx_s ctx;
+  unsigned char plain[256];
+  unsigned char coded[512];
+  unsigned char out[512];
+  unsigned char ref[512];
+  uint32_t rnd = 0x12345678;
+  size_t plainlen;
+  size_t outlen;
+  size_t reflen;
+  ssize_t n;
+  size_t len;
+  size_t pos;
+  size_t i;
+  int run;
+
+  for (i = 0; i < nitems(g_base64_vectors); i++)
+    {
+      FAR const struct codecbench_vector_s *v = &g_base64_vectors[i];
+
+      len = strlen(v->plain);
+      base64_encode(v->plain, len, coded, &outlen);
+      CODECBENCH_CHECK(outlen == strlen(v->coded) &&
+                       strcmp((FAR char *)coded, v->coded) == 0);
+
+      base64_decode(v->coded, strlen(v->coded), out, &outlen);
+      CODECBENCH_CHECK(outlen == len && memcmp(out, v->plain, len) == 0);
+    }
+
+  /* Web safe alphabet: '.' pads, 62 and 63 both encode as '_' */
+
+  base64w_encode("\xfb\xff", 2, coded, &outlen);
+  CODECBENCH_CHECK(outlen == 4 && memcmp(coded, "__8.", 4) == 0);
+  base64w_decode("Zm8.", 4, out, &outlen);
+  CODECBENCH_CHECK(outlen == 2 && memcmp(out, "fo", 2) == 0);
+
+  /* Random data against the former decoder, one shot and in chunks of
+   * random size with line breaks.
+   */
+
+  for (run = 0; run < CODECBENCH_RANDOM_RUNS; run++)
+    {
+      len = codecbench_random(&rnd) % sizeof(plain);
+      for (i = 0; i < len; i++)
+        {
+          plain[i] = codecbench_random(&rnd);
+        }
+
+      base64_encode(plain, len, coded, &outlen);
+      base64_decode(coded, outlen, out, &outlen);
+      reflen = ref_base64_decode(coded, strlen((FAR char *)coded), ref);
+      CODECBENCH_CHECK(outlen == len && memcmp(out, plain, len) == 0);
+      CODECBENCH_CHECK(reflen == outlen && memcmp(ref, out, len) == 0);
+      plainlen = len;
+
+      base64_encode_init(&ctx, false);
+      outlen = 0;
+      for (pos = 0; pos < len; pos += i)
+        {
+          i = codecbench_random(&rnd) % 8;
+          i = i > len - pos ? len - pos : i;
+          outlen += base64_encode_update(&ctx, plain + pos, i,
+                                         out + outlen);
+        }
+
+      outlen += base64_encode_final(&ctx, out + outlen);
+      CODECBENCH_CHECK(outlen == strlen((FAR char *)coded) &&
+                       memcmp(out, coded, outlen) == 0);
+
+      /* Insert a line break every 16 characters */
+
+      for (i = 0, pos = 0; i < outlen; i++)
+        {
+          ref[pos++] = coded[i];
+          if (i % 16 == 15)
+            {
+              ref[pos++] = '\n';
+            }
+        }
+
+      base64_decode_init(&ctx, false);
+      outlen = 0;
+      for (i = 0; i < pos; i += len)
+        {
+          len = codecbench_random(&rnd) % 8;
+          len = len > pos - i ? pos - i : len;
+          n = base64_decode_update(&ctx, ref + i, len, out + outlen);
+          CODECBENCH_CHECK(n >= 0);
+          outlen += n > 0 ? n : 0;
+        }
+
+      n = base64_decode_final(&ctx, out + outlen);
+      CODECBENCH_CHECK(n >= 0);
+      outlen += n > 0 ? n : 0;
+      CODECBENCH_CHECK(outlen == plainlen &&
+                       memcmp(out, plain, outlen) == 0);
+    }
+
+  /* Chunked decode: unpadded end, invalid input */
+
+  base64_decode_init(&ctx, false);
+  n = base64_decode_update(&ctx, "Zm9vYmE", 7, out);
+  CODECBENCH_CHECK(n == 3);
+  CODECBENCH_CHECK(base64_decode_final(&ctx, out + 3) == 2 &&
+                   memcmp(out, "fooba", 5) == 0);
+
+  base64_decode_init(&ctx, false);
+  CODECBENCH_CHECK(base64_decode_update(&ctx, "Zm9v!", 5, out) < 0);
+
+  base64_decode_init(&ctx, false);
+  CODECBENCH_CHECK(base64_decode_update(&ctx, "Zg==Zg", 6, out) < 0);
+
+  base64_decode_init(&ctx, false);
+  base64_decode_update(&ctx, "Zm9vY", 5, out);
+  CODECBENCH_CHECK(base64_decode_final(&ctx, out) < 0);
+}
+
+/****************************************************************************
+ * Name: codecbench_md5
+ ****************************************************************************/
+
+static void codecbench_md5(void)
+{
+  FAR char *hash;
+  uint8_t digest[16];
+  uint8_t digest2[16];
+  uint32_t buf[64];
+  MD5_CTX ctx;
+  size_t i;
+
+  for (i = 0; i < nitems(g_md5_vectors); i++)
+    {
+      hash = md5_hash((FAR const uint8_t *)g_md5_vectors[i].plain,
+                      strlen(g_md5_vectors[i].plain));
+      CODECBENCH_CHECK(hash != NULL &&
+                       strcmp(hash, g_md5_vectors[i].coded) == 0);
+      free(hash);
+    }
+
+  /* Aligned and unaligned input give the same digest */
+
+  for (i = 0; i < sizeof(buf); i++)
+    {
+      ((FAR uint8_t *)buf)[i] = i * 7;
+    }
+
+  md5_sum((FAR uint8_t *)buf, 200, digest);
+  memmove((FAR uint8_t *)buf + 1, buf, 200);
+  md5_sum((FAR uint8_t *)buf + 1, 200, digest2);
+  CODECBENCH_CHECK(memcmp(digest, digest2, 16) == 0);
+
+  md5_init(&ctx);
+  md5_update(&ctx, (FAR uint8_t *)buf + 1, 3);
+  md5_update(&ctx, (FAR uint8_t *)buf + 4, 197);
+  md5_final(digest2, &ctx);
+  CODECBENCH_CHECK(memcmp(digest, digest2, 16) == 0);
+}
+
+/****************************************************************************
+ * Name: codecbench_url
+ ****************************************************************************/
+
+static void codecbench_url(void)
+{
+  char out[64];
+  size_t i;
+  int len;
+
+  for (i = 0; i < nitems(g_url_vectors); i++)
+    {
+      FAR const struct codecbench_vector_s *v = &g_url_vectors[i];
+
+      urlencode(v->plain, strlen(v->plain), out, &len);
+      CODECBENCH_CHECK(strcmp(out, v->coded) == 0);
+      CODECBENCH_CHECK(urlencode_len(v->plain, strlen(v->plain)) == len);
+
+      urldecode(v->coded, strlen(v->coded), out, &len);
+      CODECBENCH_CHECK(strcmp(out, v->plain) == 0);
+      CODECBENCH_CHECK(urldecode_len(v->coded, strlen(v->coded)) == len);
+    }
+
+  /* Incomplete and invalid escapes are copied */
+
+  urldecode("%4g%4%", 6, out, &len);
+  CODECBENCH_CHECK(strcmp(out, "%4g%4%") == 0 && len == 6);
+  urldecode("x%41", 4, out, &len);
+  CODECBENCH_CHECK(strcmp(out, "xA") == 0 && len == 2);
+}
+
+/****************************************************************************
+ * Name: codecbench_report
+ ****************************************************************************/
+
+static void codecbench_report(FAR const char *name, size_t bytes,
+                              uint64_t us)
+{
+  printf("%-20s %8" PRIu64 " KB/s\n", name,
+         us > 0 ? (uint64_t)bytes * 1000000 / 1024 / us : 0);
+}
+
+/****************************************************************************
+ * Name: codecbench_speed
+ ****************************************************************************/
+
+static int codecbench_speed(size_t size, int rounds)
+{
+  FAR unsigned char *plain;
+  FAR unsigned char *coded;
+  FAR unsigned char *out;
+  uint8_t digest[16];
+  uint32_t rnd = 0x9e3779b9;
+  uint64_t start;
+  size_t codedlen;
+  size_t outlen;
+  size_t i;
+  int r;
+
+  plain = malloc(size + 1);
+  coded = malloc(base64_encode_length(size) + 1);
+  out   = malloc(size + 3);
+  if (plain == NULL || coded == NULL || out == NULL)
+    {
+      free(plain);
+      free(coded);
+      free(out);
+      return -1;
+    }
+
+  for (i = 0; i < size + 1; i++)
+    {
+      plain[i] = codecbench_random(&rnd);
+    }
+
+  start = codecbench_now();
+  for (r = 0; r < rounds; r++)
+    {
+      base64_encode(plain, size, coded, &codedlen);
+    }
+
+  codecbench_report("base64_encode", size * rounds,
+                    codecbench_now() - start);
+
+  start = codecbench_now();
+  for (r = 0; r < rounds; r++)
+    {
+      base64_decode(coded, codedlen, out, &outlen);
+    }
+
+  codecbench_report("base64_decode", codedlen * rounds,
+                    codecbench_now() - start);
+
+  start = codecbench_now();
+  for (r = 0; r < rounds; r++)
+    {
+      ref_base64_decode(coded, codedlen, out);
+    }
+
+  codecbench_report("  strchr() decode", codedlen * rounds,
+                    codecbench_now() - start);
+
+  start = codecbench_now();
+  for (r = 0; r < rounds; r++)
+    {
+      md5_sum(plain, size, digest);
+    }
+
+  codecbench_report("md5 aligned", size * rounds,
+                    codecbench_now() - start);
+
+  start = codecbench_now();
+  for (r = 0; r < rounds; r++)
+    {
+      md5_sum(plain + 1, size, digest);
+    }
+
+  codecbench_report("md5 unaligned", size * rounds,
+                    codecbench_now() - start);
+
+  /* URL decode of mostly plain text with some escapes */
+
+  for (i = 0; i < size; i++)
+    {
+      plain[i] = 'a' + plain[i] % 26;
+      if (i % 16 == 15)
+        {
+          plain[i] = ' ';
+        }
+    }
+
+  urlencode((FAR char *)plain, size, (FAR char *)coded, &r);
+  codedlen = r;
+
+  start = codecbench_now();
+  for (r = 0; r < rounds; r++)
+    {
+      int len;
+
+      urldecode((FAR char *)coded, codedlen, (FAR char *)out, &len);
+    }
+
+  codecbench_report("urldecode", codedlen * rounds,
+                    codecbench_now() - start);
+
+  free(plain);
+  free(coded);
+  free(out);
+  return 0;
+}
+
+/****************************************************************************
+ * Name: codecbench_usage
+ ****************************************************************************/
+
+static void codecbench_usage(FAR const char *progname)
+{
+  fprintf(stderr, "Usage: %s [-t] [-s <size>] [-n <rounds>]\n", progname);
+  fprintf(stderr, "  -t  Run the test vectors only\n");
+  fprintf(stderr, "  -s  Buffer size in bytes (default %d)\n",
+          CODECBENCH_DEFAULT_SIZE);
+  fprintf(stderr, "  -n  Rounds per measurement (default %d)\n",
+          CODECBENCH_DEFAULT_ROUNDS);
+}
+
+/****************************************************************************
+ * Public Functions
+ ****************************************************************************/
+
+int main(int argc, FAR char *argv[])
+{
+  size_t size = CODECBENCH_DEFAULT_SIZE;
+  int rounds = CODECBENCH_DEFAULT_ROUNDS;
+  bool testonly = false;
+  int opt;
+
+  while ((opt = getopt(argc, argv, "ts:n:h")) != ERROR)
+    {
+      switch (opt)
+        {
+          case 't':
+            testonly = true;
+            break;
+
+          case 's':
+            size = strtoul(optarg, NULL, 0);
+            break;
+
+          case 'n':
+            rounds = atoi(optarg);
+            break;
+
+          default:
+            codecbench_usage(argv[0]);
+            return EXIT_FAILURE;
+        }
+    }
+
+  if (size == 0 || rounds <= 0)
+    {
+      codecbench_usage(argv[0]);
+      return EXIT_FAILURE;
+    }
+
+  codecbench_base64();
+  codecbench_md5();
+  codecbench_url();
+
+  printf("Test vectors: %s (%d failures)\n",
+         g_failures == 0 ? "PASS" : "FAIL", g_failures);
+  if (g_failures > 0)
+    {
+      return EXIT_FAILURE;
+    }
+
+  if (!testonly && codecbench_speed(size, rounds) < 0)
+    {
+      return EXIT_FAILURE;
+    }
+
+  return EXIT_SUCCESS;
+}
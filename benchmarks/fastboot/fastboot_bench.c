@@ -0,0 +1,726 @@
+/****************************************************************************
+ * apps/benchmarks/fastboot/fastboot_bench.c
+ *
+ * SPDX-License-Identifier: Apache-2.0
+ *
+ * Licensed to the Apache Software Foundation (ASF) under one or more
+ * contributor license agreements.  See the NOTICE file distributed with
+ * this work for additional information regarding copyright ownership.  The
+ * ASF licenses this file to you under the Apache License, Version 2.0 (the
+ * "License"); you may not use this file except in compliance with the
+ * License.  You may obtain a copy of the License at
+ *
+ *   http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS, WITHOUT
+ * WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.  See the
+ * License for the specific language governing permissions and limitations
+ * under the License.
+ *
+ ****************************************************************************/
+
+/****************************************************************************
+ * Included Files
+ ****************************************************************************/
+
+#include <nuttx/config.h>
+
+#include <arpa/inet.h>
+#include <endian.h>
+#include <errno.h>
+#include <fcntl.h>
+#include <inttypes.h>
+#include <limits.h>
+#include <stdbool.h>
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+#include <unistd.h>
+
+#include <netinet/in.h>
+#include <netinet/tcp.h>
+#include <sys/param.h>
+#include <sys/socket.h>
+
+/****************************************************************************
+ * Pre-processor Definitions
+ ****************************************************************************/
+
+#define FBBENCH_DEFAULT_SIZE    1024      /* KiB */
+#define FBBENCH_DEFAULT_CHUNK   4         /* Blocks per chunk */
+#define FBBENCH_DEFAULT_ADDR    "127.0.0.1"
+#define FBBENCH_PORT            5554
+#define FBBENCH_BLKSZ           4096
+#define FBBENCH_BUFSIZE         16384
+#define FBBENCH_MSG_LEN         64
+
+#define FBBENCH_SPARSE_MAGIC    0xed26ff3a
+#define FBBENCH_CHUNK_RAW       0xcac1
+#define FBBENCH_CHUNK_FILL      0xcac2
+#define FBBENCH_CHUNK_DONT_CARE 0xcac3
+
+#define FBBENCH_SPARSE_HEADER   28
+#define FBBENCH_CHUNK_HEADER    12
+
+/* Every fourth chunk is a fill chunk, alternately of zeroes and of ones */
+
+#define FBBENCH_IS_FILL(k)      ((k) % 4 == 3)
+#define FBBENCH_FILL(k)         ((k) / 4 % 2 ? 0xffffffff : 0)
+
+/****************************************************************************
+ * Private Types
+ ****************************************************************************/
+
+struct fbbench_s
+{
+  int sock;                    /* Connection to fastbootd */
+  FAR const char *part;        /* Partition that is programmed */
+  uint32_t nblocks;            /* Blocks in the image */
+  uint32_t chunkblks;          /* Blocks per chunk */
+  uint32_t nchunks;
+  uint32_t seed;               /* Makes each run write different data */
+  size_t maxdownload;          /* max-download-size of fastbootd */
+  size_t buflen;               /* Bytes waiting in buf */
+  uint8_t buf[FBBENCH_BUFSIZE];
+};
+
+/****************************************************************************
+ * Private Functions
+ ****************************************************************************/
+
+/****************************************************************************
+ * Name: fbbench_usage
+ ****************************************************************************/
+
+static void fbbench_usage(FAR const char *progname)
+{
+  fprintf(stderr, "usage: %s [-s kbytes] [-b blocks] [-a addr] "
+                  "<partition>\n", progname);
+  fprintf(stderr, "  -s <n>     KiB in the image [%d]\n",
+          FBBENCH_DEFAULT_SIZE);
+  fprintf(stderr, "  -b <n>     4 KiB blocks per sparse chunk [%d]\n",
+          FBBENCH_DEFAULT_CHUNK);
+  fprintf(stderr, "  -a <addr>  Address of fastbootd [%s]\n",
+          FBBENCH_DEFAULT_ADDR);
+}
+
+/****************************************************************************
+ * Name: fbbench_now
+ ****************************************************************************/
+
+static double fbbench_now(void)
+{
+  struct timespec ts;
+
+  clock_gettime(CLOCK_MONOTONIC, &ts);
+  return ts.tv_sec + ts.tv_nsec / 1e9;
+}
+
+/****************************************************************************
+ * Name: fbbench_word
+ *
+ * Description:
+ *   The 32-bit word at a byte offset of the raw chunks.
+ *
+ ****************************************************************************/
+
+static uint32_t fbbench_word(FAR struct fbbench_s *bench, size_t offset)
+{
+  return (bench->seed * 0x9e3779b9) ^ (uint32_t)(offset / 4);
+}
+
+/****************************************************************************
+ * Name: fbbench_chunk
+ *
+ * Description:
+ *   Return the first block and the number of blocks of chunk k.
+ *
+ ****************************************************************************/
+
+static uint32_t fbbench_chunk(FAR struct fbbench_s *bench, uint32_t k,
+                              FAR uint32_t *first)
+{
+  *first = k * bench->chunkblks;
+  return MIN(bench->chunkblks, bench->nblocks - *first);
+}
+
+/****************************************************************************
+ * Name: fbbench_flush
+ *
+ * Description:
+ *   Send what fbbench_reserve() and fbbench_send() queued, the data goes
+ *   out in writes of up to FBBENCH_BUFSIZE.
+ *
+ ****************************************************************************/
+
+static int fbbench_flush(FAR struct fbbench_s *bench)
+{
+  size_t off = 0;
+
+  while (off < bench->buflen)
+    {
+      ssize_t n = send(bench->sock, bench->buf + off, bench->buflen - off,
+                       0);
+      if (n < 0)
+        {
+          if (errno == EINTR)
+            {
+              continue;
+            }
+
+          perror("send");
+          return -errno;
+        }
+
+      off += n;
+    }
+
+  bench->buflen = 0;
+  return 0;
+}
+
+static FAR uint8_t *fbbench_reserve(FAR struct fbbench_s *bench,
+                                    size_t len)
+{
+  if (bench->buflen + len > sizeof(bench->buf) && fbbench_flush(bench) < 0)
+    {
+      return NULL;
+    }
+
+  bench->buflen += len;
+  return bench->buf + bench->buflen - len;
+}
+
+static int fbbench_send(FAR struct fbbench_s *bench, FAR const void *data,
+                        size_t len)
+{
+  FAR uint8_t *ptr = fbbench_reserve(bench, len);
+
+  if (ptr == NULL)
+    {
+      return -EIO;
+    }
+
+  memcpy(ptr, data, len);
+  return 0;
+}
+
+/****************************************************************************
+ * Name: fbbench_recv
+ ****************************************************************************/
+
+static int fbbench_recv(FAR struct fbbench_s *bench, FAR void *buf,
+                        size_t len)
+{
+  FAR uint8_t *ptr = buf;
+
+  while (len > 0)
+    {
+      ssize_t n = recv(bench->sock, ptr, len, 0);
+      if (n <= 0)
+        {
+          if (n < 0 && errno == EINTR)
+            {
+              continue;
+            }
+
+          fprintf(stderr, "fastbootd closed the connection\n");
+          return -EIO;
+        }
+
+      ptr += n;
+      len -= n;
+    }
+
+  return 0;
+}
+
+/****************************************************************************
+ * Name: fbbench_response
+ *
+ * Description:
+ *   Wait for the final response to a command.  Returns 0 on OKAY, the
+ *   size on DATA and a negated errno otherwise.  The text after OKAY is
+ *   copied to reply if it is not NULL.
+ *
+ ****************************************************************************/
+
+static ssize_t fbbench_response(FAR struct fbbench_s *bench,
+                                FAR const char *cmd, FAR char *reply)
+{
+  char msg[FBBENCH_MSG_LEN + 1];
+  uint64_t size;
+
+  while (1)
+    {
+      if (fbbench_recv(bench, &size, sizeof(size)) < 0)
+        {
+          return -EIO;
+        }
+
+      size = be64toh(size);
+      if (size < 4 || size > FBBENCH_MSG_LEN ||
+          fbbench_recv(bench, msg, size) < 0)
+        {
+          return -EIO;
+        }
+
+      msg[size] = '\0';
+      if (memcmp(msg, "OKAY", 4) == 0)
+        {
+          if (reply != NULL)
+            {
+              strcpy(reply, msg + 4);
+            }
+
+          return 0;
+        }
+      else if (memcmp(msg, "DATA", 4) == 0)
+        {
+          return strtoul(msg + 4, NULL, 16);
+        }
+      else if (memcmp(msg, "FAIL", 4) == 0)
+        {
+          fprintf(stderr, "%s: %s\n", cmd, msg + 4);
+          return -EPERM;
+        }
+    }
+}
+
+/****************************************************************************
+ * Name: fbbench_command
+ ****************************************************************************/
+
+static ssize_t fbbench_command(FAR struct fbbench_s *bench,
+                               FAR const char *cmd, FAR char *reply)
+{
+  uint64_t size = htobe64(strlen(cmd));
+
+  if (fbbench_send(bench, &size, sizeof(size)) < 0 ||
+      fbbench_send(bench, cmd, strlen(cmd)) < 0 ||
+      fbbench_flush(bench) < 0)
+    {
+      return -EIO;
+    }
+
+  return fbbench_response(bench, cmd, reply);
+}
+
+/****************************************************************************
+ * Name: fbbench_chunkhdr
+ *
+ * Description:
+ *   Account for a chunk and send its header.
+ *
+ ****************************************************************************/
+
+static int fbbench_chunkhdr(FAR struct fbbench_s *bench, uint16_t type,
+                            uint32_t num, bool send, FAR size_t *size)
+{
+  uint32_t hdr[FBBENCH_CHUNK_HEADER / 4];
+
+  hdr[0] = type;
+  hdr[1] = num;
+  hdr[2] = FBBENCH_CHUNK_HEADER +
+           (type == FBBENCH_CHUNK_RAW ? num * FBBENCH_BLKSZ :
+            type == FBBENCH_CHUNK_FILL ? 4 : 0);
+  *size += hdr[2];
+
+  return send ? fbbench_send(bench, hdr, FBBENCH_CHUNK_HEADER) : 0;
+}
+
+/****************************************************************************
+ * Name: fbbench_piece
+ *
+ * Description:
+ *   Send chunks [c0, c1) as a sparse image of the whole partition, the
+ *   blocks of the other chunks are don't care, like the host tool does
+ *   when an image is bigger than max-download-size.  With send false only
+ *   the size of the piece is returned.
+ *
+ ****************************************************************************/
+
+static ssize_t fbbench_piece(FAR struct fbbench_s *bench, uint32_t c0,
+                             uint32_t c1, bool send)
+{
+  uint32_t hdr[FBBENCH_SPARSE_HEADER / 4];
+  uint32_t begin = c0 * bench->chunkblks;
+  uint32_t end = MIN(c1 * bench->chunkblks, bench->nblocks);
+  size_t size = FBBENCH_SPARSE_HEADER;
+  uint32_t first;
+  uint32_t num;
+  uint32_t k;
+  size_t i;
+  size_t j;
+
+  if (send)
+    {
+      hdr[0] = FBBENCH_SPARSE_MAGIC;
+      hdr[1] = 1;                                 /* Version 1.0 */
+      hdr[2] = FBBENCH_SPARSE_HEADER |            /* file_hdr_sz */
+               (FBBENCH_CHUNK_HEADER << 16);      /* chunk_hdr_sz */
+      hdr[3] = FBBENCH_BLKSZ;
+      hdr[4] = bench->nblocks;
+      hdr[5] = (c1 - c0) + (begin > 0) + (end < bench->nblocks);
+      hdr[6] = 0;
+      if (fbbench_send(bench, hdr, FBBENCH_SPARSE_HEADER) < 0)
+        {
+          return -EIO;
+        }
+    }
+
+  if (begin > 0 &&
+      fbbench_chunkhdr(bench, FBBENCH_CHUNK_DONT_CARE, begin, send,
+                       &size) < 0)
+    {
+      return -EIO;
+    }
+
+  for (k = c0; k < c1; k++)
+    {
+      num = fbbench_chunk(bench, k, &first);
+      if (FBBENCH_IS_FILL(k))
+        {
+          uint32_t fill = FBBENCH_FILL(k);
+
+          if (fbbench_chunkhdr(bench, FBBENCH_CHUNK_FILL, num, send,
+                               &size) < 0 ||
+              (send && fbbench_send(bench, &fill, 4) < 0))
+            {
+              return -EIO;
+            }
+
+          continue;
+        }
+
+      if (fbbench_chunkhdr(bench, FBBENCH_CHUNK_RAW, num, send, &size) < 0)
+        {
+          return -EIO;
+        }
+
+      for (i = 0; send && i < num; i++)
+        {
+          FAR uint32_t *ptr = (FAR uint32_t *)
+            fbbench_reserve(bench, FBBENCH_BLKSZ);
+          size_t offset = ((size_t)first + i) * FBBENCH_BLKSZ;
+
+          if (ptr == NULL)
+            {
+              return -EIO;
+            }
+
+          for (j = 0; j < FBBENCH_BLKSZ / 4; j++)
+            {
+              ptr[j] = fbbench_word(bench, offset + j * 4);
+            }
+        }
+    }
+
+  if (end < bench->nblocks &&
+      fbbench_chunkhdr(bench, FBBENCH_CHUNK_DONT_CARE,
+                       bench->nblocks - end, send, &size) < 0)
+    {
+      return -EIO;
+    }
+
+  return size;
+}
+
+/****************************************************************************
+ * Name: fbbench_flash
+ *
+ * Description:
+ *   Download and flash chunks [c0, c1).
+ *
+ ****************************************************************************/
+
+static int fbbench_flash(FAR struct fbbench_s *bench, uint32_t c0,
+                         uint32_t c1)
+{
+  char cmd[FBBENCH_MSG_LEN];
+  ssize_t size = fbbench_piece(bench, c0, c1, false);
+  uint64_t len = htobe64(size);
+
+  snprintf(cmd, sizeof(cmd), "download:%08zx", size);
+  if (fbbench_command(bench, cmd, NULL) != size)
+    {
+      return -EIO;
+    }
+
+  /* The whole download is one message of the TCP protocol */
+
+  if (fbbench_send(bench, &len, sizeof(len)) < 0 ||
+      fbbench_piece(bench, c0, c1, true) != size ||
+      fbbench_flush(bench) < 0 || fbbench_response(bench, cmd, NULL) < 0)
+    {
+      return -EIO;
+    }
+
+  snprintf(cmd, sizeof(cmd), "flash:%s", bench->part);
+  return fbbench_command(bench, cmd, NULL) < 0 ? -EIO : 0;
+}
+
+/****************************************************************************
+ * Name: fbbench_verify
+ *
+ * Description:
+ *   Read the partition back, possible when fastbootd runs on this target.
+ *
+ ****************************************************************************/
+
+static int fbbench_verify(FAR struct fbbench_s *bench)
+{
+  FAR uint32_t *buf = (FAR uint32_t *)bench->buf;
+  char path[PATH_MAX];
+  uint32_t first;
+  uint32_t num;
+  uint32_t k;
+  uint32_t b;
+  uint32_t i;
+  int ret = 0;
+  int fd;
+
+  snprintf(path, sizeof(path), "/dev/%s", bench->part);
+  fd = open(path, O_RDONLY);
+  if (fd < 0)
+    {
+      return -ENOENT;
+    }
+
+  for (k = 0; k < bench->nchunks && ret == 0; k++)
+    {
+      num = fbbench_chunk(bench, k, &first);
+      for (b = first; b < first + num && ret == 0; b++)
+        {
+          size_t offset = (size_t)b * FBBENCH_BLKSZ;
+
+          if (pread(fd, buf, FBBENCH_BLKSZ, offset) != FBBENCH_BLKSZ)
+            {
+              ret = -EIO;
+              break;
+            }
+
+          for (i = 0; i < FBBENCH_BLKSZ / 4; i++)
+            {
+              uint32_t expect = FBBENCH_IS_FILL(k) ? FBBENCH_FILL(k) :
+                                fbbench_word(bench, offset + i * 4);
+              if (buf[i] != expect)
+                {
+                  fprintf(stderr, "mismatch at %zu: %08" PRIx32
+                          " != %08" PRIx32 "\n", offset + i * 4, buf[i],
+                          expect);
+                  ret = -EIO;
+                  break;
+                }
+            }
+        }
+    }
+
+  close(fd);
+  return ret;
+}
+
+/****************************************************************************
+ * Name: fbbench_run
+ *
+ * Description:
+ *   Program the image and return the seconds it took, negative on error.
+ *   Buffered, the image is cut in pieces of max-download-size that are
+ *   each downloaded and then flashed.  Streamed, it is one download that
+ *   fastbootd programs while receiving it.
+ *
+ ****************************************************************************/
+
+static double fbbench_run(FAR struct fbbench_s *bench, bool stream)
+{
+  char cmd[FBBENCH_MSG_LEN];
+  double start;
+  double elapsed;
+  uint32_t c0;
+  uint32_t c1;
+  int ret;
+
+  bench->seed++;
+
+  if (stream)
+    {
+      snprintf(cmd, sizeof(cmd), "oem stream %s", bench->part);
+      if (fbbench_command(bench, cmd, NULL) < 0)
+        {
+          return -1;
+        }
+    }
+
+  start = fbbench_now();
+
+  for (c0 = 0, ret = 0; c0 < bench->nchunks && ret == 0; c0 = c1)
+    {
+      c1 = c0 + 1;
+      while (!stream && c1 < bench->nchunks &&
+             fbbench_piece(bench, c0, c1 + 1, false) <= bench->maxdownload)
+        {
+          c1++;
+        }
+
+      if (stream)
+        {
+          c1 = bench->nchunks;
+        }
+      else if (fbbench_piece(bench, c0, c1, false) > bench->maxdownload)
+        {
+          fprintf(stderr, "chunk does not fit in %zu bytes, lower -b\n",
+                  bench->maxdownload);
+          return -1;
+        }
+
+      ret = fbbench_flash(bench, c0, c1);
+    }
+
+  elapsed = fbbench_now() - start;
+
+  if (stream && fbbench_command(bench, "oem stream", NULL) < 0)
+    {
+      return -1;
+    }
+
+  return ret < 0 ? -1 : elapsed;
+}
+
+/****************************************************************************
+ * Name: fbbench_report
+ ****************************************************************************/
+
+static void fbbench_report(FAR struct fbbench_s *bench,
+                           FAR const char *mode, double elapsed)
+{
+  size_t size = (size_t)bench->nblocks * FBBENCH_BLKSZ;
+  FAR const char *check = "";
+  int ret;
+
+  if (elapsed >= 0)
+    {
+      ret = fbbench_verify(bench);
+      check = ret == -ENOENT ? "  (not verified)" :
+              ret < 0 ? "  VERIFY FAILED" : "";
+    }
+
+  printf("%-9s %10zu bytes %9.3f ms %8.0f KiB/s%s\n", mode, size,
+         elapsed * 1000, elapsed > 0 ? size / elapsed / 1024 : 0,
+         elapsed >= 0 ? check : "  FAILED");
+}
+
+/****************************************************************************
+ * Public Functions
+ ****************************************************************************/
+
+/****************************************************************************
+ * main
+ ****************************************************************************/
+
+int main(int argc, FAR char *argv[])
+{
+  FAR const char *addr = FBBENCH_DEFAULT_ADDR;
+  FAR struct fbbench_s *bench;
+  struct sockaddr_in sin;
+  char handshake[4];
+  char reply[FBBENCH_MSG_LEN];
+  int one = 1;
+  int opt;
+
+  bench = calloc(1, sizeof(*bench));
+  if (bench == NULL)
+    {
+      return EXIT_FAILURE;
+    }
+
+  bench->sock = -1;
+  bench->nblocks = FBBENCH_DEFAULT_SIZE / (FBBENCH_BLKSZ / 1024);
+  bench->chunkblks = FBBENCH_DEFAULT_CHUNK;
+
+  while ((opt = getopt(argc, argv, "s:b:a:h")) != ERROR)
+    {
+      switch (opt)
+        {
+          case 's':
+            bench->nblocks = atoi(optarg) / (FBBENCH_BLKSZ / 1024);
+            break;
+
+          case 'b':
+            bench->chunkblks = atoi(optarg);
+            break;
+
+          case 'a':
+            addr = optarg;
+            break;
+
+          default:
+            fbbench_usage(argv[0]);
+            free(bench);
+            return opt == 'h' ? EXIT_SUCCESS : EXIT_FAILURE;
+        }
+    }
+
+  if (optind != argc - 1 || bench->nblocks == 0 || bench->chunkblks == 0)
+    {
+      fbbench_usage(argv[0]);
+      free(bench);
+      return EXIT_FAILURE;
+    }
+
+  bench->part = argv[optind];
+  bench->nchunks = (bench->nblocks + bench->chunkblks - 1) /
+                   bench->chunkblks;
+
+  memset(&sin, 0, sizeof(sin));
+  sin.sin_family = AF_INET;
+  sin.sin_port = htons(FBBENCH_PORT);
+  inet_pton(AF_INET, addr, &sin.sin_addr);
+
+  bench->sock = socket(AF_INET, SOCK_STREAM, 0);
+  if (bench->sock < 0 ||
+      connect(bench->sock, (FAR struct sockaddr *)&sin, sizeof(sin)) < 0)
+    {
+      perror("connect");
+      goto errout;
+    }
+
+  setsockopt(bench->sock, IPPROTO_TCP, TCP_NODELAY, &one, sizeof(one));
+
+  if (fbbench_send(bench, "FB01", 4) < 0 || fbbench_flush(bench) < 0 ||
+      fbbench_recv(bench, handshake, 4) < 0 ||
+      memcmp(handshake, "FB01", 4) != 0)
+    {
+      fprintf(stderr, "handshake failed\n");
+      goto errout;
+    }
+
+  if (fbbench_command(bench, "getvar:max-download-size", reply) < 0)
+    {
+      goto errout;
+    }
+
+  bench->maxdownload = strtoul(reply, NULL, 0);
+
+  printf("%s, %" PRIu32 " chunks of %" PRIu32 " KiB, "
+         "max-download-size %zu\n", bench->part, bench->nchunks,
+         bench->chunkblks * (FBBENCH_BLKSZ / 1024), bench->maxdownload);
+
+  fbbench_report(bench, "buffered", fbbench_run(bench, false));
+  fbbench_report(bench, "streamed", fbbench_run(bench, true));
+
+  close(bench->sock);
+  free(bench);
+  return EXIT_SUCCESS;
+
+errout:
+  if (bench->sock >= 0)
+    {
+      close(bench->sock);
+    }
+
+  free(bench);
+  return EXIT_FAILURE;
+}
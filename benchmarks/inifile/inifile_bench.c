@@ -0,0 +1,234 @@
+/****************************************************************************
+ * apps/benchmarks/inifile/inifile_bench.c
+ *
+ * SPDX-License-Identifier: Apache-2.0
+ *
+ * Licensed to the Apache Software Foundation (ASF) under one or more
+ * contributor license agreements.  See the NOTICE file distributed with
+ * this work for additional information regarding copyright ownership.  The
+ * ASF licenses this file to you under the Apache License, Version 2.0 (the
+ * "License"); you may not use this file except in compliance with the
+ * License.  You may obtain a copy of the License at
+ *
+ *   http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS, WITHOUT
+ * WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.  See the
+ * License for the specific language governing permissions and limitations
+ * under the License.
+ *
+ ****************************************************************************/
+
+/****************************************************************************
+ * Included Files
+ ****************************************************************************/
+
+#include <nuttx/config.h>
+
+#include <inttypes.h>
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+#include <unistd.h>
+
+#include "fsutils/inifile.h"
+
+/****************************************************************************
+ * Pre-processor Definitions
+ ****************************************************************************/
+
+#define INIBENCH_DEFAULT_PATH     "/tmp/inibench.ini"
+#define INIBENCH_DEFAULT_SECTIONS 20
+#define INIBENCH_DEFAULT_VARS     10
+#define INIBENCH_DEFAULT_LOOKUPS  200
+
+/****************************************************************************
+ * Private Functions
+ ****************************************************************************/
+
+/****************************************************************************
+ * Name: inibench_usage
+ ****************************************************************************/
+
+static void inibench_usage(FAR const char *progname)
+{
+  fprintf(stderr, "usage: %s [-f file] [-s sections] [-v variables] "
+          "[-n lookups]\n", progname);
+  fprintf(stderr, "  -f <file>  INI file to generate [%s]\n",
+          INIBENCH_DEFAULT_PATH);
+  fprintf(stderr, "  -s <n>     Number of sections [%d]\n",
+          INIBENCH_DEFAULT_SECTIONS);
+  fprintf(stderr, "  -v <n>     Variables per section [%d]\n",
+          INIBENCH_DEFAULT_VARS);
+  fprintf(stderr, "  -n <n>     Number of lookups [%d]\n",
+          INIBENCH_DEFAULT_LOOKUPS);
+}
+
+/****************************************************************************
+ * Name: inibench_elapsed
+ ****************************************************************************/
+
+static double inibench_elapsed(FAR const struct timespec *start,
+                               FAR const struct timespec *end)
+{
+  return (end->tv_sec - start->tv_sec) +
+         (end->tv_nsec - start->tv_nsec) / 1e9;
+}
+
+/****************************************************************************
+ * Name: inibench_generate
+ *
+ * Description:
+ *   Write an INI file of nsections sections with nvars variables each.
+ *   Variable "var<j>" of section "section<i>" holds the value i * nvars + j.
+ *
+ ****************************************************************************/
+
+static int inibench_generate(FAR const char *path, int nsections,
+                             int nvars)
+{
+  FAR FILE *stream;
+  int i;
+  int j;
+
+  stream = fopen(path, "w");
+  if (stream == NULL)
+    {
+      return -1;
+    }
+
+  fprintf(stream, "; Generated by inifile_bench\n");
+  for (i = 0; i < nsections; i++)
+    {
+      fprintf(stream, "[section%d]\n", i);
+      for (j = 0; j < nvars; j++)
+        {
+          fprintf(stream, "var%d=%d\n", j, i * nvars + j);
+        }
+    }
+
+  fclose(stream);
+  return 0;
+}
+
+/****************************************************************************
+ * Public Functions
+ ****************************************************************************/
+
+int main(int argc, FAR char *argv[])
+{
+  FAR const char *path = INIBENCH_DEFAULT_PATH;
+  struct timespec start;
+  struct timespec end;
+  INIHANDLE handle;
+  char section[32];
+  char variable[32];
+  unsigned int seed = 1;
+  int nsections = INIBENCH_DEFAULT_SECTIONS;
+  int nvars = INIBENCH_DEFAULT_VARS;
+  int nlookups = INIBENCH_DEFAULT_LOOKUPS;
+  int errors = 0;
+  double inittime;
+  double looktime;
+  long value;
+  int option;
+  int i;
+  int s;
+  int v;
+
+  while ((option = getopt(argc, argv, "f:s:v:n:")) != ERROR)
+    {
+      switch (option)
+        {
+          case 'f':
+            path = optarg;
+            break;
+
+          case 's':
+            nsections = atoi(optarg);
+            break;
+
+          case 'v':
+            nvars = atoi(optarg);
+            break;
+
+          case 'n':
+            nlookups = atoi(optarg);
+            break;
+
+          default:
+            inibench_usage(argv[0]);
+            return EXIT_FAILURE;
+        }
+    }
+
+  if (nsections <= 0 || nvars <= 0 || nlookups <= 0)
+    {
+      inibench_usage(argv[0]);
+      return EXIT_FAILURE;
+    }
+
+  if (inibench_generate(path, nsections, nvars) < 0)
+    {
+      fprintf(stderr, "Failed to create %s\n", path);
+      return EXIT_FAILURE;
+    }
+
+  printf("INI file: %s, %d sections x %d variables\n",
+         path, nsections, nvars);
+
+  clock_gettime(CLOCK_MONOTONIC, &start);
+  handle = inifile_initialize(path);
+  clock_gettime(CLOCK_MONOTONIC, &end);
+
+  if (handle == NULL)
+    {
+      fprintf(stderr, "Failed to open %s\n", path);
+      unlink(path);
+      return EXIT_FAILURE;
+    }
+
+  inittime = inibench_elapsed(&start, &end);
+
+  /* Look up random variables and check every returned value */
+
+  clock_gettime(CLOCK_MONOTONIC, &start);
+  for (i = 0; i < nlookups; i++)
+    {
+      s = rand_r(&seed) % nsections;
+      v = rand_r(&seed) % nvars;
+
+      snprintf(section, sizeof(section), "section%d", s);
+      snprintf(variable, sizeof(variable), "var%d", v);
+
+      value = inifile_read_integer(handle, section, variable, -1);
+      if (value != (long)s * nvars + v)
+        {
+          errors++;
+        }
+    }
+
+  clock_gettime(CLOCK_MONOTONIC, &end);
+  looktime = inibench_elapsed(&start, &end);
+
+  inifile_uninitialize(handle);
+  unlink(path);
+
+  printf("Initialize:      %10.3f ms\n", inittime * 1000);
+  printf("Lookups:         %10d\n", nlookups);
+  printf("Total time:      %10.3f ms\n", looktime * 1000);
+  printf("Per lookup:      %10.3f us\n", looktime * 1e6 / nlookups);
+  printf("Lookups/second:  %10.0f\n",
+         looktime > 0 ? nlookups / looktime : 0);
+
+  if (errors > 0)
+    {
+      printf("ERROR: %d lookups returned a wrong value\n", errors);
+      return EXIT_FAILURE;
+    }
+
+  return EXIT_SUCCESS;
+}
@@ -27,12 +27,18 @@
 #include <nuttx/config.h>
 
 #include <sys/stat.h>
+#include <errno.h>
+#include <inttypes.h>
+#include <pthread.h>
+#include <stdbool.h>
+#include <stdint.h>
 #include <unistd.h>
 #include <stdio.h>
 #include <stdlib.h>
 #include <string.h>
 #include <time.h>
 
+#include <nuttx/kmalloc.h>
 #include <nuttx/mtd/mtd.h>
 #include <nuttx/fs/smart.h>
 #include <nuttx/fs/ioctl.h>
@@ -41,49 +47,724 @@
  * Pre-processor Definitions
  ****************************************************************************/
 
+#ifndef CONFIG_BENCHMARK_MTD_MAXTHREADS
+#  define CONFIG_BENCHMARK_MTD_MAXTHREADS 4
+#endif
+
+/* Latency histogram: bucket n holds operations that took
+ * [2^n, 2^(n+1)) microseconds, bucket 0 also holds anything below 1 us.
+ */
+
+#define MTD_HIST_NBUCKETS  24
+
+#ifndef MIN
+#  define MIN(a, b)        ((a) < (b) ? (a) : (b))
+#endif
+
+#define MTD_DEFAULT_BSIZES "512,4096,65536"
+#define MTD_DEFAULT_MIXES  "0,100,70"
+
+#define MTD_MAX_BSIZES     8
+#define MTD_MAX_MIXES      8
+
+#define MTD_PATTERN_SEQ    (1 << 0)
+#define MTD_PATTERN_RAND   (1 << 1)
+
 /****************************************************************************
- * Private data
+ * Private Types
  ****************************************************************************/
 
+/* The device under test.  Either a block driver (normally an FTL on top
+ * of an MTD partition) or a RAM MTD stand-in that is accessed through the
+ * raw MTD interface.
+ */
+
+struct mtd_bench_dev_s
+{
+  FAR struct inode *inode;     /* Block driver or NULL */
+  FAR struct mtd_dev_s *mtd;   /* RAM MTD stand-in or NULL */
+  FAR uint8_t *ram;            /* Backing store of the RAM MTD */
+  size_t sectorsize;           /* Size of one read/write unit */
+  size_t nsectors;             /* Number of read/write units */
+  size_t erasesize;            /* Size of one erase block */
+  size_t neraseblocks;         /* Number of erase blocks */
+  FAR uint32_t *wear;          /* Erase count per erase block */
+  FAR uint8_t *written;        /* Bitmap of sectors holding valid data */
+  pthread_mutex_t lock;        /* Protects wear and written */
+};
+
+/* One cell of the test matrix */
+
+struct mtd_bench_cell_s
+{
+  size_t bsize;                /* Bytes per operation */
+  bool random;                 /* Random instead of sequential offsets */
+  int readpct;                 /* Percentage of read operations */
+  size_t nops;                 /* Operations per thread */
+  int nthreads;                /* Concurrent workers (queue depth) */
+  bool verify;                 /* Verify read data against pattern */
+};
+
+/* Per-thread state and results */
+
+struct mtd_bench_worker_s
+{
+  FAR struct mtd_bench_dev_s *dev;
+  FAR const struct mtd_bench_cell_s *cell;
+  pthread_t thread;
+  unsigned int seed;
+  size_t first;                /* First block (in bsize units) of stripe */
+  size_t nblocks;              /* Blocks (in bsize units) in stripe */
+  FAR uint8_t *buffer;
+  uint32_t rhist[MTD_HIST_NBUCKETS];
+  uint32_t whist[MTD_HIST_NBUCKETS];
+  uint64_t rbytes;
+  uint64_t wbytes;
+  uint32_t rmax;               /* Longest read in microseconds */
+  uint32_t wmax;               /* Longest write in microseconds */
+  size_t errors;
+  size_t mismatches;
+};
+
 /****************************************************************************
- * Public Functions
+ * Private Functions
  ****************************************************************************/
 
-int main(int argc, FAR char *argv[])
+/****************************************************************************
+ * Name: mtd_bench_usage
+ ****************************************************************************/
+
+static void mtd_bench_usage(FAR const char *progname)
 {
-  struct inode            *inode;
-  struct timespec         start;
-  struct timespec         end;
-  struct mtd_geometry_s   geo;
-  struct partition_info_s info;
-  int                     ret;
-  int                     x;
-  double                  elapsed_time;
-  double                  transfer_rate;
-  size_t                  total_bytes_written = 0;
-  size_t                  total_bytes_read = 0;
-  char                    *buffer;
+  fprintf(stderr, "usage: %s [options] <flash_block_device>\n", progname);
+#ifdef CONFIG_RAMMTD
+  fprintf(stderr, "       %s [options] -R <erase blocks>\n", progname);
+#endif
+  fprintf(stderr, "\nOptions:\n");
+  fprintf(stderr, "  -b <list>  Block sizes in bytes [%s]\n",
+          MTD_DEFAULT_BSIZES);
+  fprintf(stderr, "  -m <list>  Read percentages [%s]\n",
+          MTD_DEFAULT_MIXES);
+  fprintf(stderr, "  -p <seq|rand|both>  Access pattern [both]\n");
+  fprintf(stderr, "  -t <n>     Worker threads (queue depth) [1..%d]\n",
+          CONFIG_BENCHMARK_MTD_MAXTHREADS);
+  fprintf(stderr, "  -n <n>     Operations per cell [one device pass]\n");
+  fprintf(stderr, "  -s <seed>  Random seed [1]\n");
+  fprintf(stderr, "  -v         Verify data read back\n");
+  fprintf(stderr, "  -H         Print latency histograms\n");
+#ifdef CONFIG_RAMMTD
+  fprintf(stderr, "  -R <n>     Use a RAM MTD of <n> erase blocks\n");
+#endif
+}
 
-  /* Argument given? */
+/****************************************************************************
+ * Name: mtd_bench_parselist
+ ****************************************************************************/
+
+static int mtd_bench_parselist(FAR const char *str, FAR size_t *values,
+                               int maxvalues)
+{
+  FAR char *endptr;
+  int n = 0;
+
+  while (*str != '\0')
+    {
+      if (n >= maxvalues)
+        {
+          return -E2BIG;
+        }
+
+      values[n++] = strtoul(str, &endptr, 0);
+      if (endptr == str || (*endptr != ',' && *endptr != '\0'))
+        {
+          return -EINVAL;
+        }
+
+      str = *endptr == ',' ? endptr + 1 : endptr;
+    }
+
+  return n;
+}
+
+/****************************************************************************
+ * Name: mtd_bench_elapsed_us
+ ****************************************************************************/
+
+static uint32_t mtd_bench_elapsed_us(FAR const struct timespec *start,
+                                     FAR const struct timespec *end)
+{
+  return (uint32_t)((end->tv_sec - start->tv_sec) * 1000000 +
+                    (end->tv_nsec - start->tv_nsec) / 1000);
+}
+
+/****************************************************************************
+ * Name: mtd_bench_histadd
+ ****************************************************************************/
+
+static void mtd_bench_histadd(FAR uint32_t *hist, uint32_t us)
+{
+  int bucket = 0;
+
+  while (us > 1 && bucket < MTD_HIST_NBUCKETS - 1)
+    {
+      us >>= 1;
+      bucket++;
+    }
+
+  hist[bucket]++;
+}
+
+/****************************************************************************
+ * Name: mtd_bench_percentile
+ *
+ * Description:
+ *   Return the upper bound (in microseconds) of the histogram bucket that
+ *   contains the given percentile.
+ *
+ ****************************************************************************/
+
+static uint32_t mtd_bench_percentile(FAR const uint32_t *hist, int pct)
+{
+  uint64_t total = 0;
+  uint64_t target;
+  uint64_t sum = 0;
+  int i;
+
+  for (i = 0; i < MTD_HIST_NBUCKETS; i++)
+    {
+      total += hist[i];
+    }
+
+  if (total == 0)
+    {
+      return 0;
+    }
+
+  target = (total * pct + 99) / 100;
+  for (i = 0; i < MTD_HIST_NBUCKETS; i++)
+    {
+      sum += hist[i];
+      if (sum >= target)
+        {
+          break;
+        }
+    }
+
+  return (uint32_t)2 << i;
+}
+
+/****************************************************************************
+ * Name: mtd_bench_fill
+ *
+ * Description:
+ *   Fill a buffer with a pattern derived from the sector number so that
+ *   any sector can be verified independently of the access order.
+ *
+ ****************************************************************************/
+
+static void mtd_bench_fill(FAR uint8_t *buffer, size_t sector,
+                           size_t nsectors, size_t sectorsize)
+{
+  size_t i;
+  size_t j;
+
+  for (i = 0; i < nsectors; i++, sector++)
+    {
+      for (j = 0; j < sectorsize; j++)
+        {
+          *buffer++ = (uint8_t)(sector + j);
+        }
+    }
+}
+
+/****************************************************************************
+ * Name: mtd_bench_check
+ ****************************************************************************/
+
+static size_t mtd_bench_check(FAR struct mtd_bench_dev_s *dev,
+                              FAR const uint8_t *buffer, size_t sector,
+                              size_t nsectors)
+{
+  size_t mismatches = 0;
+  size_t i;
+  size_t j;
+
+  pthread_mutex_lock(&dev->lock);
+  for (i = 0; i < nsectors; i++, sector++)
+    {
+      if ((dev->written[sector >> 3] & (1 << (sector & 7))) == 0)
+        {
+          buffer += dev->sectorsize;
+          continue;
+        }
+
+      for (j = 0; j < dev->sectorsize; j++)
+        {
+          if (buffer[j] != (uint8_t)(sector + j))
+            {
+              mismatches++;
+              break;
+            }
+        }
+
+      buffer += dev->sectorsize;
+    }
+
+  pthread_mutex_unlock(&dev->lock);
+  return mismatches;
+}
+
+/****************************************************************************
+ * Name: mtd_bench_account
+ *
+ * Description:
+ *   Update the erase-block wear counters and the valid-data bitmap after a
+ *   write of nsectors starting at sector.  For the block driver the FTL
+ *   performs one read-modify-erase-write cycle per touched erase block;
+ *   for the RAM MTD the benchmark issued exactly those erases itself.
+ *
+ ****************************************************************************/
+
+static void mtd_bench_account(FAR struct mtd_bench_dev_s *dev,
+                              size_t sector, size_t nsectors)
+{
+  size_t first = sector * dev->sectorsize / dev->erasesize;
+  size_t last = ((sector + nsectors) * dev->sectorsize - 1) /
+                dev->erasesize;
+  size_t i;
+
+  pthread_mutex_lock(&dev->lock);
+
+  for (i = first; i <= last && i < dev->neraseblocks; i++)
+    {
+      dev->wear[i]++;
+
+      /* Erasing on the raw MTD destroys the neighbours of the written
+       * range within the same erase block.
+       */
+
+      if (dev->mtd != NULL)
+        {
+          size_t per = dev->erasesize / dev->sectorsize;
+          size_t s;
+
+          for (s = i * per; s < (i + 1) * per; s++)
+            {
+              dev->written[s >> 3] &= ~(1 << (s & 7));
+            }
+        }
+    }
+
+  for (i = sector; i < sector + nsectors; i++)
+    {
+      dev->written[i >> 3] |= 1 << (i & 7);
+    }
+
+  pthread_mutex_unlock(&dev->lock);
+}
+
+/****************************************************************************
+ * Name: mtd_bench_read
+ ****************************************************************************/
+
+static int mtd_bench_read(FAR struct mtd_bench_dev_s *dev,
+                          FAR uint8_t *buffer, size_t sector,
+                          size_t nsectors)
+{
+  ssize_t ret;
+
+  if (dev->mtd != NULL)
+    {
+      ret = MTD_BREAD(dev->mtd, sector, nsectors, buffer);
+    }
+  else
+    {
+      ret = dev->inode->u.i_bops->read(dev->inode, buffer, sector,
+                                       nsectors);
+    }
+
+  return ret == (ssize_t)nsectors ? OK : (ret < 0 ? (int)ret : -EIO);
+}
+
+/****************************************************************************
+ * Name: mtd_bench_write
+ ****************************************************************************/
+
+static int mtd_bench_write(FAR struct mtd_bench_dev_s *dev,
+                           FAR const uint8_t *buffer, size_t sector,
+                           size_t nsectors)
+{
+  ssize_t ret;
+
+  if (dev->mtd != NULL)
+    {
+      size_t per = dev->erasesize / dev->sectorsize;
+      size_t first = sector / per;
+      size_t last = (sector + nsectors - 1) / per;
+
+      /* Raw FLASH must be erased before it can be programmed again */
+
+      ret = MTD_ERASE(dev->mtd, first, last - first + 1);
+      if (ret < 0)
+        {
+          return (int)ret;
+        }
+
+      ret = MTD_BWRITE(dev->mtd, sector, nsectors, buffer);
+    }
+  else
+    {
+      ret = dev->inode->u.i_bops->write(dev->inode, buffer, sector,
+                                        nsectors);
+    }
+
+  if (ret != (ssize_t)nsectors)
+    {
+      return ret < 0 ? (int)ret : -EIO;
+    }
+
+  mtd_bench_account(dev, sector, nsectors);
+  return OK;
+}
+
+/****************************************************************************
+ * Name: mtd_bench_worker
+ ****************************************************************************/
+
+static FAR void *mtd_bench_worker(FAR void *arg)
+{
+  FAR struct mtd_bench_worker_s *worker = arg;
+  FAR struct mtd_bench_dev_s *dev = worker->dev;
+  FAR const struct mtd_bench_cell_s *cell = worker->cell;
+  size_t nsect = cell->bsize / dev->sectorsize;
+  struct timespec start;
+  struct timespec end;
+  size_t block;
+  size_t sector;
+  uint32_t us;
+  size_t i;
+  bool isread;
+  int ret;
+
+  for (i = 0; i < cell->nops; i++)
+    {
+      if (cell->random)
+        {
+          block = worker->first + rand_r(&worker->seed) % worker->nblocks;
+        }
+      else
+        {
+          block = worker->first + i % worker->nblocks;
+        }
+
+      sector = block * nsect;
+      isread = (int)(rand_r(&worker->seed) % 100) < cell->readpct;
+
+      if (!isread)
+        {
+          mtd_bench_fill(worker->buffer, sector, nsect, dev->sectorsize);
+        }
+
+      clock_gettime(CLOCK_MONOTONIC, &start);
+
+      if (isread)
+        {
+          ret = mtd_bench_read(dev, worker->buffer, sector, nsect);
+        }
+      else
+        {
+          ret = mtd_bench_write(dev, worker->buffer, sector, nsect);
+        }
+
+      clock_gettime(CLOCK_MONOTONIC, &end);
+      us = mtd_bench_elapsed_us(&start, &end);
+
+      if (ret < 0)
+        {
+          worker->errors++;
+          continue;
+        }
+
+      if (isread)
+        {
+          mtd_bench_histadd(worker->rhist, us);
+          worker->rbytes += cell->bsize;
+          if (us > worker->rmax)
+            {
+              worker->rmax = us;
+            }
+
+          if (cell->verify)
+            {
+              worker->mismatches += mtd_bench_check(dev, worker->buffer,
+                                                    sector, nsect);
+            }
+        }
+      else
+        {
+          mtd_bench_histadd(worker->whist, us);
+          worker->wbytes += cell->bsize;
+          if (us > worker->wmax)
+            {
+              worker->wmax = us;
+            }
+        }
+    }
+
+  return NULL;
+}
+
+/****************************************************************************
+ * Name: mtd_bench_printhist
+ ****************************************************************************/
+
+static void mtd_bench_printhist(FAR const char *label,
+                                FAR const uint32_t *hist)
+{
+  int i;
+
+  printf("    %s latency histogram (us):\n", label);
+  for (i = 0; i < MTD_HIST_NBUCKETS; i++)
+    {
+      if (hist[i] != 0)
+        {
+          printf("      %8" PRIu32 " .. %8" PRIu32 ": %" PRIu32 "\n",
+                 i == 0 ? 0 : (uint32_t)1 << i, (uint32_t)2 << i, hist[i]);
+        }
+    }
+}
+
+/****************************************************************************
+ * Name: mtd_bench_runcell
+ ****************************************************************************/
+
+static int mtd_bench_runcell(FAR struct mtd_bench_dev_s *dev,
+                             FAR const struct mtd_bench_cell_s *cell,
+                             unsigned int seed, bool showhist)
+{
+  struct mtd_bench_worker_s workers[CONFIG_BENCHMARK_MTD_MAXTHREADS];
+  uint32_t rhist[MTD_HIST_NBUCKETS];
+  uint32_t whist[MTD_HIST_NBUCKETS];
+  struct timespec start;
+  struct timespec end;
+  uint64_t rbytes = 0;
+  uint64_t wbytes = 0;
+  uint32_t rmax = 0;
+  uint32_t wmax = 0;
+  size_t errors = 0;
+  size_t mismatches = 0;
+  size_t nsect;
+  size_t unit;
+  size_t stripe;
+  double elapsed;
+  int started;
+  int ret = OK;
+  int i;
+  int j;
+
+  /* Stripes are whole erase blocks, so that a write to the raw MTD never
+   * erases data that belongs to another thread.  The unit is the least
+   * common multiple of the block and erase block sizes, in sectors.
+   */
+
+  nsect = cell->bsize / dev->sectorsize;
+  unit = dev->erasesize / dev->sectorsize;
+  while (unit % nsect != 0)
+    {
+      unit += dev->erasesize / dev->sectorsize;
+    }
+
+  stripe = dev->nsectors / unit / cell->nthreads * unit;
+  if (stripe == 0)
+    {
+      return -EINVAL;
+    }
+
+  memset(workers, 0, sizeof(workers));
+  memset(rhist, 0, sizeof(rhist));
+  memset(whist, 0, sizeof(whist));
+
+  for (i = 0; i < cell->nthreads; i++)
+    {
+      workers[i].dev     = dev;
+      workers[i].cell    = cell;
+      workers[i].seed    = seed + i;
+      workers[i].first   = i * stripe / nsect;
+      workers[i].nblocks = stripe / nsect;
+      workers[i].buffer  = malloc(cell->bsize);
+      if (workers[i].buffer == NULL)
+        {
+          ret = -ENOMEM;
+          goto errout_with_buffers;
+        }
+    }
+
+  clock_gettime(CLOCK_MONOTONIC, &start);
+
+  for (started = 0; started < cell->nthreads; started++)
+    {
+      ret = pthread_create(&workers[started].thread, NULL,
+                           mtd_bench_worker, &workers[started]);
+      if (ret != 0)
+        {
+          ret = -ret;
+          break;
+        }
+    }
+
+  for (i = 0; i < started; i++)
+    {
+      pthread_join(workers[i].thread, NULL);
+    }
+
+  clock_gettime(CLOCK_MONOTONIC, &end);
+
+  if (ret < 0)
+    {
+      goto errout_with_buffers;
+    }
+
+  for (i = 0; i < cell->nthreads; i++)
+    {
+      for (j = 0; j < MTD_HIST_NBUCKETS; j++)
+        {
+          rhist[j] += workers[i].rhist[j];
+          whist[j] += workers[i].whist[j];
+        }
+
+      rbytes     += workers[i].rbytes;
+      wbytes     += workers[i].wbytes;
+      errors     += workers[i].errors;
+      mismatches += workers[i].mismatches;
+      rmax        = workers[i].rmax > rmax ? workers[i].rmax : rmax;
+      wmax        = workers[i].wmax > wmax ? workers[i].wmax : wmax;
+    }
+
+  elapsed = (end.tv_sec - start.tv_sec) + (end.tv_nsec - start.tv_nsec) / 1e9;
+
+  printf("%7zu %4s %4d%% %2d %9.2f %9.2f %7" PRIu32 " %7" PRIu32
+         " %7" PRIu32 " %7" PRIu32 " %7" PRIu32 " %7" PRIu32 "\n",
+         cell->bsize, cell->random ? "rand" : "seq", cell->readpct,
+         cell->nthreads, rbytes / elapsed / 1024, wbytes / elapsed / 1024,
+         MIN(mtd_bench_percentile(rhist, 50), rmax),
+         MIN(mtd_bench_percentile(rhist, 99), rmax), rmax,
+         MIN(mtd_bench_percentile(whist, 50), wmax),
+         MIN(mtd_bench_percentile(whist, 99), wmax), wmax);
+
+  if (errors != 0 || mismatches != 0)
+    {
+      printf("    %zu I/O errors, %zu sectors failed verification\n",
+             errors, mismatches);
+    }
+
+  if (showhist)
+    {
+      mtd_bench_printhist("read", rhist);
+      mtd_bench_printhist("write", whist);
+    }
+
+errout_with_buffers:
+  for (i = 0; i < cell->nthreads; i++)
+    {
+      free(workers[i].buffer);
+    }
+
+  return ret;
+}
+
+/****************************************************************************
+ * Name: mtd_bench_printwear
+ ****************************************************************************/
+
+static void mtd_bench_printwear(FAR struct mtd_bench_dev_s *dev)
+{
+  uint64_t total = 0;
+  uint32_t min = UINT32_MAX;
+  uint32_t max = 0;
+  size_t i;
+
+  for (i = 0; i < dev->neraseblocks; i++)
+    {
+      total += dev->wear[i];
+      min = dev->wear[i] < min ? dev->wear[i] : min;
+      max = dev->wear[i] > max ? dev->wear[i] : max;
+    }
 
-  if (argc < 2)
+  printf("\nErase block wear (%s):\n",
+         dev->mtd != NULL ? "erases issued" : "FTL erase cycles");
+  printf("   Total erases:     %10" PRIu64 "\n", total);
+  printf("   Min per block:    %10" PRIu32 "\n", min);
+  printf("   Max per block:    %10" PRIu32 "\n", max);
+  printf("   Avg per block:    %10.2f\n",
+         (double)total / dev->neraseblocks);
+}
+
+#ifdef CONFIG_RAMMTD
+/****************************************************************************
+ * Name: mtd_bench_openram
+ ****************************************************************************/
+
+static int mtd_bench_openram(FAR struct mtd_bench_dev_s *dev,
+                             size_t neraseblocks)
+{
+  struct mtd_geometry_s geo;
+  size_t size = neraseblocks * CONFIG_RAMMTD_ERASESIZE;
+  int ret;
+
+  dev->ram = malloc(size);
+  if (dev->ram == NULL)
+    {
+      return -ENOMEM;
+    }
+
+  dev->mtd = rammtd_initialize(dev->ram, size);
+  if (dev->mtd == NULL)
     {
-      fprintf(stderr, "usage: mtd flash_block_device\n");
-      return -1;
+      free(dev->ram);
+      return -ENODEV;
     }
 
+  ret = MTD_IOCTL(dev->mtd, MTDIOC_GEOMETRY,
+                  (unsigned long)((uintptr_t)&geo));
+  if (ret < 0)
+    {
+      kmm_free(dev->mtd);
+      free(dev->ram);
+      return ret;
+    }
+
+  dev->sectorsize   = geo.blocksize;
+  dev->erasesize    = geo.erasesize;
+  dev->neraseblocks = geo.neraseblocks;
+  dev->nsectors     = geo.neraseblocks * (geo.erasesize / geo.blocksize);
+  return OK;
+}
+#endif
+
+/****************************************************************************
+ * Name: mtd_bench_openblk
+ ****************************************************************************/
+
+static int mtd_bench_openblk(FAR struct mtd_bench_dev_s *dev,
+                             FAR const char *path)
+{
+  struct mtd_geometry_s   geo;
+  struct partition_info_s info;
+  int                     ret = OK;
+
   /* Find the inode of the block driver identified by 'source' */
 
-  ret = open_blockdriver(argv[1], 0, &inode);
+  ret = open_blockdriver(path, 0, &dev->inode);
   if (ret < 0)
     {
-      fprintf(stderr, "Failed to open %s\n", argv[1]);
+      fprintf(stderr, "Failed to open %s\n", path);
       return ret;
     }
 
   /* Get the low-level format from the device. */
 
-  ret = inode->u.i_bops->ioctl(inode, BIOC_PARTINFO, (unsigned long) &info);
+  ret = dev->inode->u.i_bops->ioctl(dev->inode, BIOC_PARTINFO,
+                                    (unsigned long) &info);
   if (ret != OK)
     {
       fprintf(stderr, "Device is not a block device\n");
@@ -92,116 +773,258 @@ int main(int argc, FAR char *argv[])
 
   /* Get the MTD geometry */
 
-  ret = inode->u.i_bops->ioctl(inode, MTDIOC_GEOMETRY, (unsigned long) &geo);
+  ret = dev->inode->u.i_bops->ioctl(dev->inode, MTDIOC_GEOMETRY,
+                                    (unsigned long) &geo);
   if (ret != OK)
     {
       fprintf(stderr, "Device is not a MTD device");
       goto errout_with_driver;
     }
 
-  /* Report the device structure */
-
-  printf("FLASH device parameters:\n");
-  printf("   Sector size:      %10d\n", info.sectorsize);
-  printf("   Sector count:     %10d\n", info.numsectors);
-  printf("   Erase block size: %10" PRIu32 "\n", geo.erasesize);
-  printf("   Total size:       %10d\n", info.sectorsize * info.numsectors);
-
   if (info.sectorsize != geo.erasesize)
     {
       fprintf(stderr, "Sector size does not match the erase block size.\n"
              "Please adjust the sector size to enable erasing and writing "
              "without using an intermediary read buffer.\n");
+      ret = -EINVAL;
       goto errout_with_driver;
     }
 
-  /* Allocate buffers to use */
+  dev->sectorsize   = info.sectorsize;
+  dev->nsectors     = info.numsectors;
+  dev->erasesize    = geo.erasesize;
+  dev->neraseblocks = info.sectorsize * info.numsectors / geo.erasesize;
+  return OK;
+
+errout_with_driver:
+  close_blockdriver(dev->inode);
+  dev->inode = NULL;
+  return ret < 0 ? ret : -ENODEV;
+}
+
+/****************************************************************************
+ * Public Functions
+ ****************************************************************************/
+
+int main(int argc, FAR char *argv[])
+{
+  struct mtd_bench_dev_s  dev;
+  struct mtd_bench_cell_s cell;
+  size_t                  bsizes[MTD_MAX_BSIZES];
+  size_t                  mixes[MTD_MAX_MIXES];
+  FAR const char          *bsizestr = MTD_DEFAULT_BSIZES;
+  FAR const char          *mixstr = MTD_DEFAULT_MIXES;
+  unsigned int            seed = 1;
+  size_t                  nops = 0;
+  size_t                  ramblocks = 0;
+  int                     patterns = MTD_PATTERN_SEQ | MTD_PATTERN_RAND;
+  int                     nthreads = 1;
+  int                     nbsizes;
+  int                     nmixes;
+  bool                    verify = false;
+  bool                    showhist = false;
+  int                     ret = OK;
+  int                     option;
+  int                     b;
+  int                     p;
+  int                     m;
 
-  buffer = (char *)malloc(info.sectorsize);
-  if (buffer == NULL)
+  while ((option = getopt(argc, argv, "b:m:p:t:n:s:vHR:")) != ERROR)
     {
-      fprintf(stderr, "Error allocating buffer\n");
-      goto errout_with_driver;
+      switch (option)
+        {
+          case 'b':
+            bsizestr = optarg;
+            break;
+
+          case 'm':
+            mixstr = optarg;
+            break;
+
+          case 'p':
+            if (strcmp(optarg, "seq") == 0)
+              {
+                patterns = MTD_PATTERN_SEQ;
+              }
+            else if (strcmp(optarg, "rand") == 0)
+              {
+                patterns = MTD_PATTERN_RAND;
+              }
+            else if (strcmp(optarg, "both") != 0)
+              {
+                mtd_bench_usage(argv[0]);
+                return EXIT_FAILURE;
+              }
+            break;
+
+          case 't':
+            nthreads = atoi(optarg);
+            break;
+
+          case 'n':
+            nops = strtoul(optarg, NULL, 0);
+            break;
+
+          case 's':
+            seed = strtoul(optarg, NULL, 0);
+            break;
+
+          case 'v':
+            verify = true;
+            break;
+
+          case 'H':
+            showhist = true;
+            break;
+
+#ifdef CONFIG_RAMMTD
+          case 'R':
+            ramblocks = strtoul(optarg, NULL, 0);
+            break;
+#endif
+
+          default:
+            mtd_bench_usage(argv[0]);
+            return EXIT_FAILURE;
+        }
     }
 
-  /* Fill the buffer with known data */
+  if (nthreads < 1 || nthreads > CONFIG_BENCHMARK_MTD_MAXTHREADS)
+    {
+      fprintf(stderr, "Thread count must be 1..%d\n",
+              CONFIG_BENCHMARK_MTD_MAXTHREADS);
+      return EXIT_FAILURE;
+    }
 
-  for (int i = 0; i < info.sectorsize; i++)
+  nbsizes = mtd_bench_parselist(bsizestr, bsizes, MTD_MAX_BSIZES);
+  nmixes  = mtd_bench_parselist(mixstr, mixes, MTD_MAX_MIXES);
+  if (nbsizes <= 0 || nmixes <= 0)
     {
-      buffer[i] = (char)(i & 0xff);
+      fprintf(stderr, "Invalid block size or read mix list\n");
+      return EXIT_FAILURE;
     }
 
-  /* Now write some data to the sector */
+  memset(&dev, 0, sizeof(dev));
 
-  printf("\nStarting write operation...\n");
+  /* Argument given? */
 
-  clock_gettime(CLOCK_MONOTONIC, &start);
-  for (x = 0; x < info.numsectors; x++)
+  if (ramblocks > 0)
+    {
+#ifdef CONFIG_RAMMTD
+      ret = mtd_bench_openram(&dev, ramblocks);
+#endif
+    }
+  else if (optind < argc)
+    {
+      ret = mtd_bench_openblk(&dev, argv[optind]);
+    }
+  else
     {
-      inode->u.i_bops->write(inode, (const unsigned char *)buffer, x, 1);
+      mtd_bench_usage(argv[0]);
+      return EXIT_FAILURE;
+    }
 
-      total_bytes_written += info.sectorsize;
+  if (ret < 0)
+    {
+      fprintf(stderr, "Failed to set up the device: %d\n", ret);
+      return EXIT_FAILURE;
     }
 
-  clock_gettime(CLOCK_MONOTONIC, &end);
+  /* Report the device structure */
 
-  elapsed_time = (end.tv_sec - start.tv_sec) + \
-                 (end.tv_nsec - start.tv_nsec) / 1e9;
-  transfer_rate = (total_bytes_written / elapsed_time) / 1024;
+  printf("FLASH device parameters:\n");
+  printf("   Sector size:      %10zu\n", dev.sectorsize);
+  printf("   Sector count:     %10zu\n", dev.nsectors);
+  printf("   Erase block size: %10zu\n", dev.erasesize);
+  printf("   Total size:       %10zu\n", dev.sectorsize * dev.nsectors);
 
-  printf("\nWrite operation completed in %.2f seconds\n", elapsed_time);
-  printf("Total bytes written: %zu\n", total_bytes_written);
-  printf("Transfer rate [write]: %.2f KiB/s\n", transfer_rate);
+  dev.wear = calloc(dev.neraseblocks, sizeof(uint32_t));
+  dev.written = calloc((dev.nsectors + 7) / 8, 1);
+  if (dev.wear == NULL || dev.written == NULL)
+    {
+      fprintf(stderr, "Error allocating buffer\n");
+      ret = -ENOMEM;
+      goto errout_with_device;
+    }
 
-  /* Now read the data back to validate everything was written and can
-   * be read.
-   */
+  pthread_mutex_init(&dev.lock, NULL);
 
-  printf("\nStarting read operation...\n");
+  printf("\n%7s %4s %5s %2s %9s %9s %7s %7s %7s %7s %7s %7s\n",
+         "bsize", "mode", "read", "qd", "rd KiB/s", "wr KiB/s",
+         "rd p50", "rd p99", "rd max", "wr p50", "wr p99", "wr max");
 
-  clock_gettime(CLOCK_MONOTONIC, &start);
+  memset(&cell, 0, sizeof(cell));
+  cell.nthreads = nthreads;
+  cell.verify   = verify;
 
-  for (x = 0; x < info.numsectors; x++)
+  for (b = 0; b < nbsizes; b++)
     {
-      inode->u.i_bops->read(inode, (unsigned char *)buffer, x, 1);
+      cell.bsize = bsizes[b];
+      if (cell.bsize < dev.sectorsize || cell.bsize % dev.sectorsize != 0 ||
+          cell.bsize > dev.sectorsize * dev.nsectors)
+        {
+          printf("%7zu skipped: not a multiple of the sector size\n",
+                 cell.bsize);
+          continue;
+        }
 
-      total_bytes_read += info.sectorsize;
-    }
+      for (p = 0; p < 2; p++)
+        {
+          if ((patterns & (1 << p)) == 0)
+            {
+              continue;
+            }
 
-  clock_gettime(CLOCK_MONOTONIC, &end);
+          cell.random = p == 1;
 
-  elapsed_time = (end.tv_sec - start.tv_sec) + \
-                 (end.tv_nsec - start.tv_nsec) / 1e9;
-  transfer_rate = (total_bytes_written / elapsed_time) / 1024;
+          for (m = 0; m < nmixes; m++)
+            {
+              cell.readpct = mixes[m] > 100 ? 100 : (int)mixes[m];
 
-  printf("\nRead operation completed in %.2f seconds\n", elapsed_time);
-  printf("Total bytes read: %zu\n", total_bytes_read);
-  printf("Transfer rate [read]: %.2f KiB/s\n", transfer_rate);
+              /* By default each cell covers the device once */
 
-  /* Compare the read data with the written data */
+              cell.nops = nops > 0 ? nops :
+                          dev.nsectors / (cell.bsize / dev.sectorsize);
+              cell.nops = (cell.nops + nthreads - 1) / nthreads;
 
-  for (int i = 0; i < info.sectorsize; i++)
-    {
-      if (buffer[i] != (char)(i & 0xff))
-        {
-          printf("\nData mismatch at byte %d: expected %02X, got %02X\n",
-                 i, (unsigned char)(i & 0xff), (unsigned char)buffer[i]);
-          goto errout_with_buffers;
+              ret = mtd_bench_runcell(&dev, &cell, seed, showhist);
+              if (ret < 0)
+                {
+                  fprintf(stderr, "Benchmark cell failed: %d\n", ret);
+                  goto errout_with_lock;
+                }
+            }
         }
     }
 
-  printf("\nData verification successful: read data matches written data\n");
+  mtd_bench_printwear(&dev);
 
-errout_with_buffers:
+errout_with_lock:
+  pthread_mutex_destroy(&dev.lock);
 
-  /* Free the allocated buffers */
+errout_with_device:
 
-  free(buffer);
+  /* Free the allocated buffers */
 
-errout_with_driver:
+  free(dev.written);
+  free(dev.wear);
 
   /* Now close the block device and exit */
 
-  close_blockdriver(inode);
-  return 0;
+  if (dev.inode != NULL)
+    {
+      close_blockdriver(dev.inode);
+    }
+
+  if (dev.mtd != NULL)
+    {
+      /* The RAM MTD has no uninitialize interface, its state is a single
+       * kernel allocation.
+       */
+
+      kmm_free(dev.mtd);
+      free(dev.ram);
+    }
+
+  return ret < 0 ? EXIT_FAILURE : EXIT_SUCCESS;
 }
@@ -0,0 +1,480 @@
+/****************************************************************************
+ * apps/benchmarks/netserver/netserver_main.c
+ *
+ * SPDX-License-Identifier: Apache-2.0
+ *
+ * Licensed to the Apache Software Foundation (ASF) under one or more
+ * contributor license agreements.  See the NOTICE file distributed with
+ * this work for additional information regarding copyright ownership.  The
+ * ASF licenses this file to you under the Apache License, Version 2.0 (the
+ * "License"); you may not use this file except in compliance with the
+ * License.  You may obtain a copy of the License at
+ *
+ *   http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS, WITHOUT
+ * WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.  See the
+ * License for the specific language governing permissions and limitations
+ * under the License.
+ *
+ ****************************************************************************/
+
+/****************************************************************************
+ * Included Files
+ ****************************************************************************/
+
+#include <nuttx/config.h>
+
+#include <sys/socket.h>
+
+#include <inttypes.h>
+#include <stdbool.h>
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+#include <pthread.h>
+#include <poll.h>
+#include <time.h>
+#include <errno.h>
+
+#include <arpa/inet.h>
+#include <netinet/in.h>
+
+#include "netutils/netlib.h"
+
+/****************************************************************************
+ * Pre-processor Definitions
+ ****************************************************************************/
+
+#define NETSERVER_DEFAULT_PORT      5471
+#define NETSERVER_DEFAULT_CLIENTS   8
+#define NETSERVER_DEFAULT_REQUESTS  100
+#define NETSERVER_DEFAULT_SIZE      64
+#define NETSERVER_MAXSIZE           1024
+
+#define NETSERVER_THREAD            -1  /* netlib_server(), for comparison */
+
+/****************************************************************************
+ * Private Types
+ ****************************************************************************/
+
+/* Request being received by the event loop */
+
+struct netserver_conn_s
+{
+  size_t len;
+  char buf[NETSERVER_MAXSIZE];
+};
+
+struct netserver_client_s
+{
+  pthread_t tid;
+  uint32_t ok;
+  uint32_t refused;
+  uint64_t total_us;
+  uint64_t max_us;
+};
+
+/****************************************************************************
+ * Private Data
+ ****************************************************************************/
+
+static struct netlib_server_s g_server;
+static uint16_t g_port = NETSERVER_DEFAULT_PORT;
+static int g_requests = NETSERVER_DEFAULT_REQUESTS;
+static size_t g_size = NETSERVER_DEFAULT_SIZE;
+
+/****************************************************************************
+ * Private Functions
+ ****************************************************************************/
+
+/****************************************************************************
+ * Name: netserver_now
+ ****************************************************************************/
+
+static uint64_t netserver_now(void)
+{
+  struct timespec ts;
+
+  clock_gettime(CLOCK_MONOTONIC, &ts);
+  return (uint64_t)ts.tv_sec * 1000000 + ts.tv_nsec / 1000;
+}
+
+/****************************************************************************
+ * Name: netserver_transfer
+ *
+ * Description:
+ *   Send or receive exactly len bytes.  Returns false on error or EOF.
+ *
+ ****************************************************************************/
+
+static bool netserver_transfer(int sd, FAR char *buf, size_t len,
+                               bool send)
+{
+  ssize_t ret;
+
+  while (len > 0)
+    {
+      ret = send ? write(sd, buf, len) : read(sd, buf, len);
+      if (ret <= 0)
+        {
+          if (ret < 0 && errno == EINTR)
+            {
+              continue;
+            }
+
+          return false;
+        }
+
+      buf += ret;
+      len -= ret;
+    }
+
+  return true;
+}
+
+/****************************************************************************
+ * Name: netserver_handler
+ *
+ * Description:
+ *   Thread and pool handler: echo one request and close the connection.
+ *
+ ****************************************************************************/
+
+static FAR void *netserver_handler(pthread_addr_t arg)
+{
+  char buf[NETSERVER_MAXSIZE];
+  int sd = (int)(uintptr_t)arg;
+
+  if (netserver_transfer(sd, buf, g_size, false))
+    {
+      netserver_transfer(sd, buf, g_size, true);
+    }
+
+  close(sd);
+  return NULL;
+}
+
+/****************************************************************************
+ * Name: netserver_connect, netserver_event, netserver_disconnect
+ *
+ * Description:
+ *   Event loop callbacks doing the same as netserver_handler().
+ *
+ ****************************************************************************/
+
+static int netserver_connect(FAR void *arg, int sd, FAR void **conn)
+{
+  *conn = calloc(1, sizeof(struct netserver_conn_s));
+  return *conn != NULL ? POLLIN : -ENOMEM;
+}
+
+static int netserver_event(FAR void *arg, int sd, FAR void *conn,
+                           short revents)
+{
+  FAR struct netserver_conn_s *req = conn;
+  ssize_t ret;
+
+  ret = read(sd, req->buf + req->len, g_size - req->len);
+  if (ret <= 0)
+    {
+      return -1;
+    }
+
+  req->len += ret;
+  if (req->len < g_size)
+    {
+      return POLLIN;
+    }
+
+  /* The answer is small enough for the send buffer */
+
+  netserver_transfer(sd, req->buf, g_size, true);
+  return -1;
+}
+
+static void netserver_disconnect(FAR void *arg, int sd, FAR void *conn)
+{
+  free(conn);
+}
+
+static const struct netlib_server_ops_s g_netserver_ops =
+{
+  netserver_connect,
+  netserver_event,
+  netserver_disconnect
+};
+
+/****************************************************************************
+ * Name: netserver_server
+ ****************************************************************************/
+
+static FAR void *netserver_server(FAR void *arg)
+{
+  int mode = (int)(intptr_t)arg;
+  int listensd;
+  int ret;
+
+  if (mode == NETSERVER_THREAD)
+    {
+      netlib_server(htons(g_port), netserver_handler,
+                    CONFIG_DEFAULT_TASK_STACKSIZE);
+      return NULL;
+    }
+
+  listensd = netlib_listenon(htons(g_port));
+  if (listensd < 0)
+    {
+      return NULL;
+    }
+
+  ret = netlib_server_run(&g_server, listensd);
+  fprintf(stderr, "ERROR: netlib_server_run failed: %d\n", ret);
+  close(listensd);
+  return NULL;
+}
+
+/****************************************************************************
+ * Name: netserver_client
+ ****************************************************************************/
+
+static FAR void *netserver_client(FAR void *arg)
+{
+  FAR struct netserver_client_s *client = arg;
+  struct sockaddr_in addr;
+  char buf[NETSERVER_MAXSIZE];
+  uint64_t start;
+  uint64_t us;
+  int sd;
+  int i;
+
+  memset(&addr, 0, sizeof(addr));
+  addr.sin_family      = AF_INET;
+  addr.sin_port        = htons(g_port);
+  addr.sin_addr.s_addr = htonl(INADDR_LOOPBACK);
+  memset(buf, 'x', sizeof(buf));
+
+  for (i = 0; i < g_requests; i++)
+    {
+      start = netserver_now();
+      sd = socket(AF_INET, SOCK_STREAM, 0);
+      if (sd < 0)
+        {
+          client->refused++;
+          continue;
+        }
+
+      if (connect(sd, (FAR struct sockaddr *)&addr, sizeof(addr)) < 0 ||
+          !netserver_transfer(sd, buf, g_size, true) ||
+          !netserver_transfer(sd, buf, g_size, false))
+        {
+          client->refused++;
+          close(sd);
+          continue;
+        }
+
+      close(sd);
+
+      us = netserver_now() - start;
+      client->ok++;
+      client->total_us += us;
+      if (us > client->max_us)
+        {
+          client->max_us = us;
+        }
+    }
+
+  return NULL;
+}
+
+/****************************************************************************
+ * Name: netserver_usage
+ ****************************************************************************/
+
+static void netserver_usage(FAR const char *progname)
+{
+  fprintf(stderr, "Usage: %s [-m thread|pool|event] [-c <clients>] "
+                  "[-n <requests>]\n"
+                  "          [-s <size>] [-w <workers>] [-b <backlog>] "
+                  "[-l <maxconn>] [-p <port>]\n", progname);
+  fprintf(stderr, "  -m  Server mode (default pool)\n");
+  fprintf(stderr, "  -c  Concurrent clients (default %d)\n",
+          NETSERVER_DEFAULT_CLIENTS);
+  fprintf(stderr, "  -n  Connections per client (default %d)\n",
+          NETSERVER_DEFAULT_REQUESTS);
+  fprintf(stderr, "  -s  Request size, echoed back (default %d, max %d)\n",
+          NETSERVER_DEFAULT_SIZE, NETSERVER_MAXSIZE);
+  fprintf(stderr, "  -w  Pool worker threads (default %d)\n",
+          CONFIG_NETUTILS_NETLIB_SERVER_WORKERS);
+  fprintf(stderr, "  -b  Pool queued connections (default %d)\n",
+          CONFIG_NETUTILS_NETLIB_SERVER_BACKLOG);
+  fprintf(stderr, "  -l  Event loop connections (default %d)\n",
+          CONFIG_NETUTILS_NETLIB_SERVER_MAXCONN);
+  fprintf(stderr, "  -p  TCP port on the loopback (default %d)\n",
+          NETSERVER_DEFAULT_PORT);
+}
+
+/****************************************************************************
+ * Public Functions
+ ****************************************************************************/
+
+int main(int argc, FAR char *argv[])
+{
+  FAR struct netserver_client_s *clients;
+  struct netlib_server_stats_s stats;
+  pthread_t server;
+  uint64_t total_us = 0;
+  uint64_t max_us = 0;
+  uint64_t elapsed;
+  uint32_t refused = 0;
+  uint32_t ok = 0;
+  int nclients = NETSERVER_DEFAULT_CLIENTS;
+  int mode = NETLIB_SERVER_POOL;
+  int opt;
+  int i;
+
+  netlib_server_init(&g_server, NETLIB_SERVER_POOL);
+
+  while ((opt = getopt(argc, argv, "m:c:n:s:w:b:l:p:h")) != ERROR)
+    {
+      switch (opt)
+        {
+          case 'm':
+            if (strcmp(optarg, "thread") == 0)
+              {
+                mode = NETSERVER_THREAD;
+              }
+            else if (strcmp(optarg, "event") == 0)
+              {
+                mode = NETLIB_SERVER_EVENT;
+              }
+            else if (strcmp(optarg, "pool") == 0)
+              {
+                mode = NETLIB_SERVER_POOL;
+              }
+            else
+              {
+                netserver_usage(argv[0]);
+                return EXIT_FAILURE;
+              }
+            break;
+
+          case 'c':
+            nclients = atoi(optarg);
+            break;
+
+          case 'n':
+            g_requests = atoi(optarg);
+            break;
+
+          case 's':
+            g_size = atoi(optarg);
+            break;
+
+          case 'w':
+            g_server.nworkers = atoi(optarg);
+            break;
+
+          case 'b':
+            g_server.backlog = atoi(optarg);
+            break;
+
+          case 'l':
+            g_server.maxconn = atoi(optarg);
+            break;
+
+          case 'p':
+            g_port = atoi(optarg);
+            break;
+
+          default:
+            netserver_usage(argv[0]);
+            return EXIT_FAILURE;
+        }
+    }
+
+  if (nclients <= 0 || g_requests <= 0 || g_size == 0 ||
+      g_size > NETSERVER_MAXSIZE)
+    {
+      netserver_usage(argv[0]);
+      return EXIT_FAILURE;
+    }
+
+  clients = calloc(nclients, sizeof(struct netserver_client_s));
+  if (clients == NULL)
+    {
+      return EXIT_FAILURE;
+    }
+
+  g_server.mode    = mode;
+  g_server.handler = netserver_handler;
+  g_server.ops     = &g_netserver_ops;
+
+  /* The server runs until the program exits */
+
+  if (pthread_create(&server, NULL, netserver_server,
+                     (FAR void *)(intptr_t)mode) != 0)
+    {
+      free(clients);
+      return EXIT_FAILURE;
+    }
+
+  pthread_detach(server);
+  usleep(100000);
+
+  elapsed = netserver_now();
+  for (i = 0; i < nclients; i++)
+    {
+      pthread_create(&clients[i].tid, NULL, netserver_client, &clients[i]);
+    }
+
+  for (i = 0; i < nclients; i++)
+    {
+      pthread_join(clients[i].tid, NULL);
+      ok       += clients[i].ok;
+      refused  += clients[i].refused;
+      total_us += clients[i].total_us;
+      if (clients[i].max_us > max_us)
+        {
+          max_us = clients[i].max_us;
+        }
+    }
+
+  elapsed = netserver_now() - elapsed;
+
+  printf("%-6s %8s %8s %10s %10s %10s\n", "MODE", "OK", "REFUSED",
+         "CONN/S", "AVG(us)", "MAX(us)");
+  printf("%-6s %8" PRIu32 " %8" PRIu32 " %10" PRIu64 " %10" PRIu64
+         " %10" PRIu64 "\n",
+         mode == NETSERVER_THREAD ? "thread" :
+         mode == NETLIB_SERVER_EVENT ? "event" : "pool",
+         ok, refused, elapsed > 0 ? ok * UINT64_C(1000000) / elapsed : 0,
+         ok > 0 ? total_us / ok : 0, max_us);
+
+  if (mode != NETSERVER_THREAD)
+    {
+      usleep(100000);
+      netlib_server_getstats(&g_server, &stats);
+      printf("Server: accepted %" PRIu32 " rejected %" PRIu32
+             " served %" PRIu32 " peak %u\n",
+             stats.accepted, stats.rejected, stats.served, stats.peak);
+      printf("        wait avg %" PRIu64 " max %" PRIu32
+             " us, serve avg %" PRIu64 " max %" PRIu32 " us",
+             stats.accepted > 0 ? stats.wait_total_us / stats.accepted : 0,
+             stats.wait_max_us,
+             stats.served > 0 ? stats.serve_total_us / stats.served : 0,
+             stats.serve_max_us);
+      if (mode == NETLIB_SERVER_EVENT)
+        {
+          printf(", callback max %" PRIu32 " us", stats.callback_max_us);
+        }
+
+      printf("\n");
+    }
+
+  free(clients);
+  return ok > 0 ? EXIT_SUCCESS : EXIT_FAILURE;
+}
@@ -0,0 +1,1182 @@
+/****************************************************************************
+ * apps/benchmarks/nxboot/nxboot_bench.c
+ *
+ * SPDX-License-Identifier: Apache-2.0
+ *
+ * Licensed to the Apache Software Foundation (ASF) under one or more
+ * contributor license agreements.  See the NOTICE file distributed with
+ * this work for additional information regarding copyright ownership.  The
+ * ASF licenses this file to you under the Apache License, Version 2.0 (the
+ * "License"); you may not use this file except in compliance with the
+ * License.  You may obtain a copy of the License at
+ *
+ *   http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS, WITHOUT
+ * WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.  See the
+ * License for the specific language governing permissions and limitations
+ * under the License.
+ *
+ ****************************************************************************/
+
+
+/****************************************************************************
+ * Included Files
+ ****************************************************************************/
+
+#include <nuttx/config.h>
+
+#include <errno.h>
+#include <fcntl.h>
+#include <inttypes.h>
+#include <stdbool.h>
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+#include <unistd.h>
+
+#include <sys/ioctl.h>
+#include <sys/param.h>
+
+#include <nuttx/crc32.h>
+#include <nuttx/fs/fs.h>
+#include <nuttx/fs/ioctl.h>
+#include <nuttx/mtd/mtd.h>
+#include <nxboot.h>
+
+#include "crc.h"
+#include "verify.h"
+
+/****************************************************************************
+ * Pre-processor Definitions
+ ****************************************************************************/
+
+#define NBBENCH_DEFAULT_SIZE  512       /* Image size in KiB */
+#define NBBENCH_DEFAULT_BOOTS 10        /* Timed ordinary boots */
+#define NBBENCH_DEFAULT_DIR   "/tmp"    /* Backing files location */
+#define NBBENCH_SECTSIZE      512       /* Fake MTD write block size */
+#define NBBENCH_ERASESIZE     4096      /* Fake MTD erase block size */
+#define NBBENCH_CRC_BYTES     (16 * 1024 * 1024)
+#define NBBENCH_NSLOTS        3
+#define NBBENCH_GROWTH        256       /* Bytes inserted by "insert" */
+#define NBBENCH_DELTA_BLOCK   NBBENCH_ERASESIZE
+#define NBBENCH_DELTA_HDR_PTR 128       /* As in tools/nximage.py */
+#define NBBENCH_MIN_MATCH     8         /* As in tools/nximage.py */
+#define NBBENCH_BASE_BITS     16        /* Base image match index */
+#define NBBENCH_BASE_STEP     4         /* Base positions indexed */
+#define NBBENCH_LOCAL_BITS    10        /* Matches within a block */
+
+/****************************************************************************
+ * Private Types
+ ****************************************************************************/
+
+/* Counts what reaches the file backed MTD of one slot */
+
+struct nbbench_mtd_s
+{
+  struct mtd_dev_s mtd;                  /* Must be first */
+  FAR struct mtd_dev_s *under;           /* The FILEMTD device */
+  FAR struct nbbench_s *bench;
+};
+
+/* Typical differences between two firmware builds */
+
+enum nbbench_change_e
+{
+  NBBENCH_PATCH = 0,                     /* A few constants changed */
+  NBBENCH_INSERT,                        /* Code inserted, rest shifted */
+  NBBENCH_APPEND,                        /* Tail of the image replaced */
+  NBBENCH_REBUILD,                       /* Small changes everywhere */
+  NBBENCH_NCHANGES
+};
+
+struct nbbench_s
+{
+  FAR const char *dir;                   /* Where the backing files go */
+  int size;                              /* Image size without header */
+  int boots;                             /* Ordinary boots to time */
+  int slotsize;                          /* Size of each slot in bytes */
+  FAR uint8_t *image;                    /* Header and image */
+  FAR uint8_t *base;                     /* Image the changes apply to */
+  FAR uint8_t *package;                  /* Delta update package */
+  FAR int32_t *index;                    /* Base image match index */
+  FAR struct mtd_dev_s *mtd[NBBENCH_NSLOTS];
+  struct nbbench_mtd_s counted[NBBENCH_NSLOTS];
+  char backing[NBBENCH_NSLOTS][64];      /* Backing file of each slot */
+  uint32_t programmed;                   /* Bytes written to the MTDs */
+  uint32_t erased;                       /* Erase blocks erased */
+  int errors;                            /* Failed boots and mismatches */
+};
+
+/****************************************************************************
+ * Private Data
+ ****************************************************************************/
+
+static FAR const char *g_slot_path[NBBENCH_NSLOTS] =
+{
+  CONFIG_NXBOOT_PRIMARY_SLOT_PATH,
+  CONFIG_NXBOOT_SECONDARY_SLOT_PATH,
+  CONFIG_NXBOOT_TERTIARY_SLOT_PATH
+};
+
+static FAR const char *g_change_name[NBBENCH_NCHANGES] =
+{
+  "patch",
+  "insert",
+  "append",
+  "rebuild"
+};
+
+/****************************************************************************
+ * Private Functions
+ ****************************************************************************/
+
+/****************************************************************************
+ * Name: nbbench_usage
+ ****************************************************************************/
+
+static void nbbench_usage(FAR const char *progname)
+{
+  fprintf(stderr, "usage: %s [-s KiB] [-n boots] [-d dir]\n", progname);
+  fprintf(stderr, "  -s <n>  Image size in KiB [%d]\n",
+          NBBENCH_DEFAULT_SIZE);
+  fprintf(stderr, "  -n <n>  Ordinary boots to time [%d]\n",
+          NBBENCH_DEFAULT_BOOTS);
+  fprintf(stderr, "  -d <d>  Directory for the slot backing files [%s]\n",
+          NBBENCH_DEFAULT_DIR);
+}
+
+/****************************************************************************
+ * Name: nbbench_elapsed
+ ****************************************************************************/
+
+static double nbbench_elapsed(FAR const struct timespec *start)
+{
+  struct timespec end;
+
+  clock_gettime(CLOCK_MONOTONIC, &end);
+  return (end.tv_sec - start->tv_sec) * 1e3 +
+         (end.tv_nsec - start->tv_nsec) / 1e6;
+}
+
+/****************************************************************************
+ * Name: nbbench_seal
+ *
+ * Description:
+ *   Calculates the crc of a complete image and stores it in its header.
+ *
+ ****************************************************************************/
+
+static uint32_t nbbench_seal(FAR uint8_t *image)
+{
+  FAR struct nxboot_img_header *header;
+  size_t skip;
+
+  header = (FAR struct nxboot_img_header *)image;
+  skip = offsetof(struct nxboot_img_header, crc) + sizeof(header->crc);
+  header->crc = ~crc32part(image + skip,
+                           header->header_size + header->size - skip,
+                           0xffffffff);
+  return header->crc;
+}
+
+/****************************************************************************
+ * Name: nbbench_image
+ *
+ * Description:
+ *   Generates an image the same way tools/nximage.py does, the content
+ *   depends on the patch version.
+ *
+ ****************************************************************************/
+
+static uint32_t nbbench_image(FAR struct nbbench_s *bench, int patch)
+{
+  FAR struct nxboot_img_header *header;
+  uint32_t seed = 0x9e3779b9 * (patch + 1);
+  int i;
+
+  memset(bench->image, 0, CONFIG_NXBOOT_HEADER_SIZE);
+  for (i = CONFIG_NXBOOT_HEADER_SIZE;
+       i < CONFIG_NXBOOT_HEADER_SIZE + bench->size; i++)
+    {
+      seed = seed * 1103515245 + 12345;
+      bench->image[i] = seed >> 16;
+    }
+
+  header = (FAR struct nxboot_img_header *)bench->image;
+  header->magic = NXBOOT_HEADER_MAGIC;
+  header->header_size = CONFIG_NXBOOT_HEADER_SIZE;
+  header->size = bench->size;
+  header->identifier = CONFIG_NXBOOT_PLATFORM_IDENTIFIER;
+  header->img_version.major = 1;
+  header->img_version.patch = patch;
+
+  return nbbench_seal(bench->image);
+}
+
+/****************************************************************************
+ * Name: nbbench_change
+ *
+ * Description:
+ *   Derives the next version of the base image with a typical kind of
+ *   change. Returns the crc of the new image.
+ *
+ ****************************************************************************/
+
+static uint32_t nbbench_change(FAR struct nbbench_s *bench, int change)
+{
+  FAR struct nxboot_img_header *header;
+  FAR uint8_t *body = bench->image + CONFIG_NXBOOT_HEADER_SIZE;
+  uint32_t seed = 0x2545f491 * (change + 1);
+  size_t size = bench->size;
+  size_t from = 0;
+  size_t step = 1;
+  size_t to = 0;
+  size_t i;
+
+  memcpy(bench->image, bench->base, CONFIG_NXBOOT_HEADER_SIZE + size);
+
+  switch (change)
+    {
+      case NBBENCH_PATCH:
+
+        /* A handful of words in a few places */
+
+        for (i = 0; i < 16; i++)
+          {
+            memset(body + i * (size / 16) + 100, 0x5a, 4);
+          }
+        break;
+
+      case NBBENCH_INSERT:
+
+        /* New code early in the image moves everything after it */
+
+        from = size * 3 / 10;
+        memmove(body + from + NBBENCH_GROWTH, body + from, size - from);
+        size += NBBENCH_GROWTH;
+        to = from + NBBENCH_GROWTH;
+        break;
+
+      case NBBENCH_APPEND:
+
+        /* The tail of the image is new */
+
+        from = size - size / 16;
+        to = size;
+        break;
+
+      case NBBENCH_REBUILD:
+
+        /* Relocated addresses all over the image */
+
+        from = 64;
+        step = 256;
+        to = size;
+        break;
+    }
+
+  for (i = from; i < to; i += step)
+    {
+      seed = seed * 1103515245 + 12345;
+      body[i] ^= (seed >> 16) | 1;
+    }
+
+  header = (FAR struct nxboot_img_header *)bench->image;
+  header->size = size;
+  header->img_version.patch = change + 2;
+
+  return nbbench_seal(bench->image);
+}
+
+/****************************************************************************
+ * Name: nbbench_write
+ ****************************************************************************/
+
+static int nbbench_write(FAR struct nbbench_s *bench, int fd)
+{
+  ssize_t nbytes;
+
+  nbytes = write(fd, bench->image, CONFIG_NXBOOT_HEADER_SIZE + bench->size);
+  close(fd);
+  return nbytes == CONFIG_NXBOOT_HEADER_SIZE + bench->size ? 0 : -1;
+}
+
+/****************************************************************************
+ * Name: nbbench_crc
+ *
+ * Description:
+ *   Compares the byte wise C library CRC32 with the one used by NXboot.
+ *
+ ****************************************************************************/
+
+static void nbbench_crc(FAR struct nbbench_s *bench)
+{
+  struct timespec start;
+  size_t len = CONFIG_NXBOOT_HEADER_SIZE + bench->size;
+  uint32_t expect = 0xffffffff;
+  uint32_t crc = 0xffffffff;
+  double libc;
+  double fast;
+  size_t done;
+
+  clock_gettime(CLOCK_MONOTONIC, &start);
+  for (done = 0; done < NBBENCH_CRC_BYTES; done += len)
+    {
+      expect = crc32part(bench->image, len, expect);
+    }
+
+  libc = nbbench_elapsed(&start);
+
+  clock_gettime(CLOCK_MONOTONIC, &start);
+  for (done = 0; done < NBBENCH_CRC_BYTES; done += len)
+    {
+      crc = crc_update(bench->image, len, crc);
+    }
+
+  fast = nbbench_elapsed(&start);
+
+  if (crc != expect)
+    {
+      fprintf(stderr, "CRC mismatch: %08" PRIx32 " != %08" PRIx32 "\n",
+              crc, expect);
+      bench->errors++;
+    }
+
+  printf("crc32part  %9.3f ms %8.1f MiB/s\n", libc,
+         done / libc / 1024.0 / 1024.0 * 1e3);
+  printf("nxboot crc %9.3f ms %8.1f MiB/s\n", fast,
+         done / fast / 1024.0 / 1024.0 * 1e3);
+}
+
+/****************************************************************************
+ * Name: nbbench_boot
+ *
+ * Description:
+ *   Runs nxboot_perform_update() count times and prints the timing.
+ *
+ ****************************************************************************/
+
+static void nbbench_boot(FAR struct nbbench_s *bench,
+                         FAR const char *name, int count)
+{
+  struct timespec start;
+  double total = 0;
+  double min = 0;
+  double max = 0;
+  double ms;
+  int i;
+
+  for (i = 0; i < count; i++)
+    {
+      clock_gettime(CLOCK_MONOTONIC, &start);
+      if (nxboot_perform_update(false) < 0)
+        {
+          bench->errors++;
+        }
+
+      ms = nbbench_elapsed(&start);
+      total += ms;
+      min = i == 0 || ms < min ? ms : min;
+      max = i == 0 || ms > max ? ms : max;
+    }
+
+  printf("%-10s %9.3f ms avg %9.3f min %9.3f max (%d runs)\n",
+         name, total / count, min, max, count);
+}
+
+/****************************************************************************
+ * Name: nbbench_forget
+ *
+ * Description:
+ *   Drops the verified image records so that the next boot has to check
+ *   all the images in full.
+ *
+ ****************************************************************************/
+
+static void nbbench_forget(void)
+{
+#ifdef CONFIG_NXBOOT_VERIFY_CACHE
+  int i;
+
+  for (i = 0; i < NBBENCH_NSLOTS; i++)
+    {
+      verify_cache_invalidate(i);
+    }
+#endif
+}
+
+/****************************************************************************
+ * Name: nbbench_check
+ *
+ * Description:
+ *   Checks that the image with the given crc is the confirmed primary
+ *   image and that there is a valid recovery.
+ *
+ ****************************************************************************/
+
+static void nbbench_check(FAR struct nbbench_s *bench, uint32_t crc)
+{
+  struct nxboot_img_header header;
+  struct nxboot_state state;
+  int fd;
+
+  if (nxboot_get_state(&state) < 0 || !state.primary_confirmed ||
+      !state.recovery_valid || state.next_boot != NXBOOT_UPDATE_TYPE_NONE)
+    {
+      fprintf(stderr, "Unexpected state after the update\n");
+      bench->errors++;
+    }
+
+  fd = open(CONFIG_NXBOOT_PRIMARY_SLOT_PATH, O_RDONLY);
+  if (fd < 0 || read(fd, &header, sizeof(header)) != sizeof(header) ||
+      header.crc != crc)
+    {
+      fprintf(stderr, "The update is not in the primary slot\n");
+      bench->errors++;
+    }
+
+  if (fd >= 0)
+    {
+      close(fd);
+    }
+}
+
+#ifdef CONFIG_NXBOOT_DELTA
+/****************************************************************************
+ * Name: nbbench_common
+ ****************************************************************************/
+
+static size_t nbbench_common(FAR const uint8_t *a, FAR const uint8_t *b,
+                             size_t limit)
+{
+  size_t n = 0;
+
+  while (n < limit && a[n] == b[n])
+    {
+      n++;
+    }
+
+  return n;
+}
+
+/****************************************************************************
+ * Name: nbbench_hash
+ ****************************************************************************/
+
+static uint32_t nbbench_hash(FAR const uint8_t *key, int bits)
+{
+  uint64_t value;
+
+  memcpy(&value, key, sizeof(value));
+  return (uint32_t)((value * 0x9e3779b97f4a7c15ull) >> (64 - bits));
+}
+
+/****************************************************************************
+ * Name: nbbench_varint
+ ****************************************************************************/
+
+static FAR uint8_t *nbbench_varint(FAR uint8_t *op, uint32_t value)
+{
+  while (value >= 0x80)
+    {
+      *op++ = (value & 0x7f) | 0x80;
+      value >>= 7;
+    }
+
+  *op++ = value;
+  return op;
+}
+
+/****************************************************************************
+ * Name: nbbench_literal
+ ****************************************************************************/
+
+static FAR uint8_t *nbbench_literal(FAR uint8_t *op,
+                                    FAR const uint8_t *data, size_t len)
+{
+  if (len > 0)
+    {
+      *op++ = NXBOOT_DELTA_OP_LITERAL;
+      op = nbbench_varint(op, len);
+      memcpy(op, data, len);
+      op += len;
+    }
+
+  return op;
+}
+
+/****************************************************************************
+ * Name: nbbench_encode_block
+ *
+ * Description:
+ *   Encodes image[start, end) into one package block the same greedy way
+ *   as tools/nximage.py does. Returns the size of the block record.
+ *
+ ****************************************************************************/
+
+static size_t nbbench_encode_block(FAR struct nbbench_s *bench,
+                                   size_t start, size_t end,
+                                   FAR uint8_t *out)
+{
+  FAR const struct nxboot_img_header *base_header;
+  FAR const uint8_t *image = bench->image;
+  FAR int32_t *local = bench->index + (1 << NBBENCH_BASE_BITS);
+  FAR uint8_t *op = out + sizeof(uint32_t);
+  size_t literal = start;
+  size_t pos = start;
+  size_t base_end;
+  size_t length;
+  size_t limit;
+  size_t best;
+  uint32_t hash = 0;
+  uint32_t len;
+  uint32_t arg = 0;
+  uint8_t code = 0;
+  off_t shift = 0;
+  off_t cand;
+  bool shifted = false;
+  int i;
+
+  base_header = (FAR const struct nxboot_img_header *)bench->base;
+  base_end = CONFIG_NXBOOT_HEADER_SIZE + base_header->size;
+  memset(local, 0xff, sizeof(int32_t) << NBBENCH_LOCAL_BITS);
+
+  while (pos < end)
+    {
+      limit = end - pos;
+      best = nbbench_common(image + pos, image + pos + 1, limit - 1) + 1;
+      code = NXBOOT_DELTA_OP_FILL;
+      arg = image[pos];
+
+      /* Where the last base match continues, then the base index */
+
+      for (i = 0; i < 2; i++)
+        {
+          if (i == 0)
+            {
+              cand = shifted ? (off_t)pos + shift : -1;
+            }
+          else
+            {
+              cand = limit >= NBBENCH_MIN_MATCH ? bench->index[
+                nbbench_hash(image + pos, NBBENCH_BASE_BITS)] : -1;
+            }
+
+          if (cand < CONFIG_NXBOOT_HEADER_SIZE || cand >= base_end)
+            {
+              continue;
+            }
+
+          length = nbbench_common(image + pos, bench->base + cand,
+                                  MIN(limit, base_end - cand));
+          if (length > best)
+            {
+              best = length;
+              code = NXBOOT_DELTA_OP_BASE;
+              arg = cand;
+            }
+        }
+
+      if (limit >= NBBENCH_MIN_MATCH)
+        {
+          hash = nbbench_hash(image + pos, NBBENCH_LOCAL_BITS);
+          cand = local[hash];
+          if (cand >= 0)
+            {
+              length = nbbench_common(image + pos, image + cand, limit);
+              if (length > best)
+                {
+                  best = length;
+                  code = NXBOOT_DELTA_OP_SELF;
+                  arg = pos - cand;
+                }
+            }
+
+          local[hash] = pos;
+        }
+
+      if (best < NBBENCH_MIN_MATCH)
+        {
+          pos++;
+          continue;
+        }
+
+      op = nbbench_literal(op, image + literal, pos - literal);
+      *op++ = code;
+      op = nbbench_varint(op, best);
+      if (code == NXBOOT_DELTA_OP_FILL)
+        {
+          *op++ = arg;
+        }
+      else
+        {
+          op = nbbench_varint(op, arg);
+        }
+
+      if (code == NXBOOT_DELTA_OP_BASE)
+        {
+          shift = (off_t)arg - (off_t)pos;
+          shifted = true;
+        }
+
+      pos += best;
+      literal = pos;
+    }
+
+  op = nbbench_literal(op, image + literal, end - literal);
+
+  if (op - out - sizeof(uint32_t) > end - start + 6)
+    {
+      /* Not worth it, store the block as it is. */
+
+      op = nbbench_literal(out + sizeof(uint32_t), image + start,
+                           end - start);
+    }
+
+  len = op - out - sizeof(uint32_t);
+  out[0] = len;
+  out[1] = len >> 8;
+  out[2] = len >> 16;
+  out[3] = len >> 24;
+  return op - out;
+}
+
+/****************************************************************************
+ * Name: nbbench_delta
+ *
+ * Description:
+ *   Turns the image into a delta update package against the base image.
+ *   Returns the size of the package.
+ *
+ ****************************************************************************/
+
+static size_t nbbench_delta(FAR struct nbbench_s *bench)
+{
+  FAR struct nxboot_img_header *header;
+  FAR const struct nxboot_img_header *base_header;
+  struct nxboot_delta_header delta;
+  size_t len = CONFIG_NXBOOT_HEADER_SIZE;
+  size_t block;
+  size_t skip;
+  size_t end;
+  off_t pos;
+
+  header = (FAR struct nxboot_img_header *)bench->image;
+  base_header = (FAR const struct nxboot_img_header *)bench->base;
+  end = CONFIG_NXBOOT_HEADER_SIZE + header->size;
+
+  /* Indexing every few positions only keeps the index small. A match
+   * is then found a few bytes late at worst.
+   */
+
+  memset(bench->index, 0xff, sizeof(int32_t) << NBBENCH_BASE_BITS);
+  for (pos = CONFIG_NXBOOT_HEADER_SIZE + base_header->size -
+             NBBENCH_MIN_MATCH; pos >= CONFIG_NXBOOT_HEADER_SIZE;
+       pos -= NBBENCH_BASE_STEP)
+    {
+      bench->index[nbbench_hash(bench->base + pos, NBBENCH_BASE_BITS)] =
+        pos;
+    }
+
+  for (block = 0; block < end; block += NBBENCH_DELTA_BLOCK)
+    {
+      len += nbbench_encode_block(bench,
+                                  MAX(block, CONFIG_NXBOOT_HEADER_SIZE),
+                                  MIN(block + NBBENCH_DELTA_BLOCK, end),
+                                  bench->package + len);
+    }
+
+  /* The package checksum is calculated with its own field zeroed, the
+   * image checksum covers the whole extended header.
+   */
+
+  header->extd_hdr_ptr = NBBENCH_DELTA_HDR_PTR;
+  delta.magic = NXBOOT_DELTA_MAGIC;
+  delta.crc = 0;
+  delta.base_crc = base_header->crc;
+  delta.size = len - CONFIG_NXBOOT_HEADER_SIZE;
+  delta.block_size = NBBENCH_DELTA_BLOCK;
+  memcpy(bench->image + NBBENCH_DELTA_HDR_PTR, &delta, sizeof(delta));
+
+  skip = offsetof(struct nxboot_img_header, crc) + sizeof(header->crc);
+  delta.crc = crc32part(bench->image + skip,
+                        CONFIG_NXBOOT_HEADER_SIZE - skip, 0xffffffff);
+  delta.crc = ~crc32part(bench->package + CONFIG_NXBOOT_HEADER_SIZE,
+                         delta.size, delta.crc);
+  memcpy(bench->image + NBBENCH_DELTA_HDR_PTR, &delta, sizeof(delta));
+
+  nbbench_seal(bench->image);
+  memcpy(bench->package, bench->image, CONFIG_NXBOOT_HEADER_SIZE);
+  return len;
+}
+#endif
+
+/****************************************************************************
+ * Name: nbbench_seed
+ *
+ * Description:
+ *   Puts the base image into the primary slot and its recovery copy into
+ *   the tertiary slot, as after a confirmed update. The secondary slot is
+ *   left erased.
+ *
+ ****************************************************************************/
+
+static int nbbench_seed(FAR struct nbbench_s *bench)
+{
+  FAR struct nxboot_img_header *header;
+  ssize_t len;
+  int ret = 0;
+  int fd;
+  int i;
+
+  header = (FAR struct nxboot_img_header *)bench->base;
+  len = CONFIG_NXBOOT_HEADER_SIZE + header->size;
+
+  for (i = 0; i < NBBENCH_NSLOTS && ret == 0; i++)
+    {
+      fd = open(g_slot_path[i], O_WRONLY);
+      if (fd < 0)
+        {
+          return -errno;
+        }
+
+      ret = ioctl(fd, MTDIOC_BULKERASE, 0);
+      if (ret == 0 && i != NXBOOT_SECONDARY_SLOT_NUM)
+        {
+          header->magic = i == NXBOOT_PRIMARY_SLOT_NUM ?
+            NXBOOT_HEADER_MAGIC :
+            NXBOOT_HEADER_MAGIC_INT | NXBOOT_SECONDARY_SLOT_NUM;
+          ret = write(fd, bench->base, len) == len ? 0 : -EIO;
+        }
+
+      close(fd);
+    }
+
+  header->magic = NXBOOT_HEADER_MAGIC;
+  nbbench_forget();
+  return ret;
+}
+
+/****************************************************************************
+ * Name: nbbench_update
+ *
+ * Description:
+ *   Uploads, installs and confirms one kind of change, either as a full
+ *   image or as a delta package, and prints what it cost.
+ *
+ ****************************************************************************/
+
+static void nbbench_update(FAR struct nbbench_s *bench, int change,
+                           bool delta)
+{
+  FAR const uint8_t *upload = bench->image;
+  struct timespec start;
+  uint32_t crc;
+  ssize_t len;
+  double ms;
+  int fd;
+
+  crc = nbbench_change(bench, change);
+  len = CONFIG_NXBOOT_HEADER_SIZE +
+        ((FAR struct nxboot_img_header *)bench->image)->size;
+
+#ifdef CONFIG_NXBOOT_DELTA
+  if (delta)
+    {
+      len = nbbench_delta(bench);
+      crc = ((FAR struct nxboot_img_header *)bench->image)->crc;
+      upload = bench->package;
+    }
+#endif
+
+  /* Start from a booted base image with its records in place. */
+
+  if (nbbench_seed(bench) < 0 || nxboot_perform_update(false) < 0)
+    {
+      fprintf(stderr, "Could not prepare the slots\n");
+      bench->errors++;
+      return;
+    }
+
+  bench->programmed = 0;
+  bench->erased = 0;
+
+  fd = nxboot_open_update_partition();
+  if (fd < 0 || write(fd, upload, len) != len)
+    {
+      fprintf(stderr, "Could not write the update\n");
+      bench->errors++;
+    }
+
+  if (fd >= 0)
+    {
+      close(fd);
+    }
+
+  clock_gettime(CLOCK_MONOTONIC, &start);
+  if (nxboot_perform_update(false) < 0)
+    {
+      bench->errors++;
+    }
+
+  ms = nbbench_elapsed(&start);
+
+  if (nxboot_confirm() < 0)
+    {
+      bench->errors++;
+    }
+
+  printf("%-8s %-5s %9.1f %9.1f %7" PRIu32 " %9.3f\n",
+         g_change_name[change], delta ? "delta" : "full", len / 1024.0,
+         bench->programmed / 1024.0, bench->erased, ms);
+
+  nbbench_check(bench, crc);
+}
+
+/****************************************************************************
+ * Name: nbbench_updates
+ *
+ * Description:
+ *   Compares full image and delta updates for the kinds of changes.
+ *
+ ****************************************************************************/
+
+static void nbbench_updates(FAR struct nbbench_s *bench)
+{
+  int change;
+
+  memcpy(bench->base, bench->image,
+         CONFIG_NXBOOT_HEADER_SIZE + bench->size);
+
+  printf("%-8s %-5s %9s %9s %7s %9s\n", "change", "mode", "sent KiB",
+         "flash KiB", "erases", "update ms");
+
+  for (change = 0; change < NBBENCH_NCHANGES; change++)
+    {
+      nbbench_update(bench, change, false);
+#ifdef CONFIG_NXBOOT_DELTA
+      nbbench_update(bench, change, true);
+#endif
+    }
+}
+
+/****************************************************************************
+ * Name: nbbench_mtd_*
+ *
+ * Description:
+ *   Pass everything to the FILEMTD device and count erases and writes.
+ *
+ ****************************************************************************/
+
+static int nbbench_mtd_erase(FAR struct mtd_dev_s *dev, off_t startblock,
+                             size_t nblocks)
+{
+  FAR struct nbbench_mtd_s *priv = (FAR struct nbbench_mtd_s *)dev;
+
+  priv->bench->erased += nblocks;
+  return MTD_ERASE(priv->under, startblock, nblocks);
+}
+
+static ssize_t nbbench_mtd_bread(FAR struct mtd_dev_s *dev,
+                                 off_t startblock, size_t nblocks,
+                                 FAR uint8_t *buffer)
+{
+  FAR struct nbbench_mtd_s *priv = (FAR struct nbbench_mtd_s *)dev;
+
+  return MTD_BREAD(priv->under, startblock, nblocks, buffer);
+}
+
+static ssize_t nbbench_mtd_bwrite(FAR struct mtd_dev_s *dev,
+                                  off_t startblock, size_t nblocks,
+                                  FAR const uint8_t *buffer)
+{
+  FAR struct nbbench_mtd_s *priv = (FAR struct nbbench_mtd_s *)dev;
+
+  priv->bench->programmed += nblocks * NBBENCH_SECTSIZE;
+  return MTD_BWRITE(priv->under, startblock, nblocks, buffer);
+}
+
+static ssize_t nbbench_mtd_read(FAR struct mtd_dev_s *dev, off_t offset,
+                                size_t nbytes, FAR uint8_t *buffer)
+{
+  FAR struct nbbench_mtd_s *priv = (FAR struct nbbench_mtd_s *)dev;
+
+  return MTD_READ(priv->under, offset, nbytes, buffer);
+}
+
+static int nbbench_mtd_ioctl(FAR struct mtd_dev_s *dev, int cmd,
+                             unsigned long arg)
+{
+  FAR struct nbbench_mtd_s *priv = (FAR struct nbbench_mtd_s *)dev;
+
+  if (cmd == MTDIOC_BULKERASE)
+    {
+      struct mtd_geometry_s geo;
+
+      if (MTD_IOCTL(priv->under, MTDIOC_GEOMETRY,
+                    (unsigned long)((uintptr_t)&geo)) == 0)
+        {
+          priv->bench->erased += geo.neraseblocks;
+        }
+    }
+
+  return MTD_IOCTL(priv->under, cmd, arg);
+}
+
+/****************************************************************************
+ * Name: nbbench_slots_create
+ ****************************************************************************/
+
+static int nbbench_slots_create(FAR struct nbbench_s *bench)
+{
+  FAR uint8_t *erased;
+  int ret = 0;
+  int off;
+  int fd;
+  int i;
+
+  erased = malloc(NBBENCH_ERASESIZE);
+  if (erased == NULL)
+    {
+      return -ENOMEM;
+    }
+
+  memset(erased, 0xff, NBBENCH_ERASESIZE);
+
+  for (i = 0; i < NBBENCH_NSLOTS && ret == 0; i++)
+    {
+      if (access(g_slot_path[i], F_OK) == 0)
+        {
+          fprintf(stderr, "%s already exists\n", g_slot_path[i]);
+          ret = -EEXIST;
+          break;
+        }
+
+      snprintf(bench->backing[i], sizeof(bench->backing[i]),
+               "%s/nxboot_bench%d.img", bench->dir, i);
+
+      fd = open(bench->backing[i], O_WRONLY | O_CREAT | O_TRUNC, 0644);
+      if (fd < 0)
+        {
+          ret = -errno;
+          perror(bench->backing[i]);
+          break;
+        }
+
+      for (off = 0; off < bench->slotsize && ret == 0;
+           off += NBBENCH_ERASESIZE)
+        {
+          if (write(fd, erased, NBBENCH_ERASESIZE) != NBBENCH_ERASESIZE)
+            {
+              ret = -errno;
+              perror(bench->backing[i]);
+            }
+        }
+
+      close(fd);
+      if (ret < 0)
+        {
+          break;
+        }
+
+      bench->mtd[i] = filemtd_initialize(bench->backing[i], 0,
+                                         NBBENCH_SECTSIZE,
+                                         NBBENCH_ERASESIZE);
+      if (bench->mtd[i] == NULL)
+        {
+          fprintf(stderr, "filemtd_initialize %s failed\n",
+                  bench->backing[i]);
+          ret = -ENODEV;
+          break;
+        }
+
+      bench->counted[i].under = bench->mtd[i];
+      bench->counted[i].bench = bench;
+      bench->counted[i].mtd.erase = nbbench_mtd_erase;
+      bench->counted[i].mtd.bread = nbbench_mtd_bread;
+      bench->counted[i].mtd.bwrite = nbbench_mtd_bwrite;
+      bench->counted[i].mtd.read = nbbench_mtd_read;
+      bench->counted[i].mtd.ioctl = nbbench_mtd_ioctl;
+      bench->counted[i].mtd.name = "nxbootbench";
+
+      ret = register_mtddriver(g_slot_path[i], &bench->counted[i].mtd,
+                               0666, NULL);
+      if (ret < 0)
+        {
+          fprintf(stderr, "register_mtddriver %s failed: %d\n",
+                  g_slot_path[i], ret);
+          filemtd_teardown(bench->mtd[i]);
+          bench->mtd[i] = NULL;
+        }
+    }
+
+  free(erased);
+  return ret;
+}
+
+/****************************************************************************
+ * Name: nbbench_slots_destroy
+ ****************************************************************************/
+
+static void nbbench_slots_destroy(FAR struct nbbench_s *bench)
+{
+  int i;
+
+  for (i = 0; i < NBBENCH_NSLOTS; i++)
+    {
+      if (bench->mtd[i] != NULL)
+        {
+          unregister_mtddriver(g_slot_path[i]);
+          filemtd_teardown(bench->mtd[i]);
+        }
+
+      if (bench->backing[i][0] != '\0')
+        {
+          unlink(bench->backing[i]);
+        }
+    }
+}
+
+/****************************************************************************
+ * Name: nbbench_run
+ ****************************************************************************/
+
+static void nbbench_run(FAR struct nbbench_s *bench)
+{
+  struct timespec start;
+  uint32_t crc;
+  int fd;
+
+  /* A confirmed image in the primary slot and nothing else. */
+
+  nbbench_image(bench, 0);
+  fd = open(CONFIG_NXBOOT_PRIMARY_SLOT_PATH, O_WRONLY);
+  if (fd < 0 || nbbench_write(bench, fd) < 0)
+    {
+      fprintf(stderr, "Could not write the primary image\n");
+      bench->errors++;
+      return;
+    }
+
+  nbbench_forget();
+  nbbench_boot(bench, "first", 1);
+  nbbench_boot(bench, "boot", bench->boots);
+
+  /* Upload an update, install it and confirm it like an application
+   * would do after the reboot.
+   */
+
+  crc = nbbench_image(bench, 1);
+  clock_gettime(CLOCK_MONOTONIC, &start);
+  fd = nxboot_open_update_partition();
+  if (fd < 0 || nbbench_write(bench, fd) < 0)
+    {
+      fprintf(stderr, "Could not write the update image\n");
+      bench->errors++;
+      return;
+    }
+
+  printf("%-10s %9.3f ms\n", "upload", nbbench_elapsed(&start));
+
+  nbbench_boot(bench, "update", 1);
+
+  clock_gettime(CLOCK_MONOTONIC, &start);
+  if (nxboot_confirm() < 0)
+    {
+      bench->errors++;
+    }
+
+  printf("%-10s %9.3f ms\n", "confirm", nbbench_elapsed(&start));
+
+  nbbench_boot(bench, "boot", bench->boots);
+  nbbench_check(bench, crc);
+}
+
+/****************************************************************************
+ * Public Functions
+ ****************************************************************************/
+
+int main(int argc, FAR char *argv[])
+{
+  struct nbbench_s bench;
+  size_t len;
+  int opt;
+
+  memset(&bench, 0, sizeof(bench));
+  bench.size = NBBENCH_DEFAULT_SIZE;
+  bench.boots = NBBENCH_DEFAULT_BOOTS;
+  bench.dir = NBBENCH_DEFAULT_DIR;
+
+  while ((opt = getopt(argc, argv, "s:n:d:h")) != ERROR)
+    {
+      switch (opt)
+        {
+          case 's':
+            bench.size = atoi(optarg);
+            break;
+
+          case 'n':
+            bench.boots = atoi(optarg);
+            break;
+
+          case 'd':
+            bench.dir = optarg;
+            break;
+
+          default:
+            nbbench_usage(argv[0]);
+            return opt == 'h' ? EXIT_SUCCESS : EXIT_FAILURE;
+        }
+    }
+
+  if (bench.size <= 0 || bench.boots <= 0)
+    {
+      nbbench_usage(argv[0]);
+      return EXIT_FAILURE;
+    }
+
+  /* Room for the header, a delta package larger than the image and the
+   * erase block with its progress record in every slot.
+   */
+
+  bench.size *= 1024;
+  len = CONFIG_NXBOOT_HEADER_SIZE + bench.size + NBBENCH_GROWTH;
+  bench.slotsize = (len + bench.size / 8 + 2 * NBBENCH_ERASESIZE - 1) /
+                   NBBENCH_ERASESIZE * NBBENCH_ERASESIZE;
+
+  bench.image = malloc(len);
+  bench.base = malloc(len);
+  bench.package = malloc(len + bench.size / 8);
+  bench.index = malloc(sizeof(int32_t) * ((1 << NBBENCH_BASE_BITS) +
+                                          (1 << NBBENCH_LOCAL_BITS)));
+  if (bench.image == NULL || bench.base == NULL || bench.package == NULL ||
+      bench.index == NULL)
+    {
+      bench.errors++;
+    }
+  else if (nbbench_slots_create(&bench) == 0)
+    {
+      nbbench_image(&bench, 0);
+      nbbench_crc(&bench);
+      nbbench_run(&bench);
+      nbbench_image(&bench, 0);
+      nbbench_updates(&bench);
+    }
+  else
+    {
+      bench.errors++;
+    }
+
+  nbbench_slots_destroy(&bench);
+  free(bench.index);
+  free(bench.package);
+  free(bench.base);
+  free(bench.image);
+
+  printf("%d errors\n", bench.errors);
+  return bench.errors == 0 ? EXIT_SUCCESS : EXIT_FAILURE;
+}
@@ -0,0 +1,335 @@
+/****************************************************************************
+ * apps/benchmarks/nxinit/nxinit_bench.c
+ *
+ * SPDX-License-Identifier: Apache-2.0
+ *
+ * Licensed to the Apache Software Foundation (ASF) under one or more
+ * contributor license agreements.  See the NOTICE file distributed with
+ * this work for additional information regarding copyright ownership.  The
+ * ASF licenses this file to you under the Apache License, Version 2.0 (the
+ * "License"); you may not use this file except in compliance with the
+ * License.  You may obtain a copy of the License at
+ *
+ *   http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS, WITHOUT
+ * WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.  See the
+ * License for the specific language governing permissions and limitations
+ * under the License.
+ *
+ ****************************************************************************/
+
+/****************************************************************************
+ * Included Files
+ ****************************************************************************/
+
+#include <nuttx/config.h>
+
+#include <errno.h>
+#include <fcntl.h>
+#include <spawn.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+#include <unistd.h>
+
+#include <sys/param.h>
+#include <sys/wait.h>
+
+/****************************************************************************
+ * Pre-processor Definitions
+ ****************************************************************************/
+
+#define NIBENCH_DEFAULT_STEPS   4       /* Independent "on init" steps */
+#define NIBENCH_DEFAULT_MS      200     /* Duration of every step */
+#define NIBENCH_DEFAULT_DIR     "/tmp"  /* RC and readiness files */
+#define NIBENCH_NSERVICES       3       /* Length of the service chain */
+#define NIBENCH_PATH_MAX        64
+
+/****************************************************************************
+ * Private Types
+ ****************************************************************************/
+
+struct nibench_s
+{
+  int steps;                            /* Independent "on init" steps */
+  int ms;                               /* Duration of every step */
+  int workers;                          /* Workers of the concurrent run */
+  FAR const char *dir;                  /* RC and readiness files */
+  char rc[NIBENCH_PATH_MAX];            /* The generated RC file */
+  int errors;
+};
+
+/****************************************************************************
+ * Private Functions
+ ****************************************************************************/
+
+static void nibench_usage(FAR const char *progname)
+{
+  printf("Usage: %s [-n <steps>] [-t <ms>] [-j <workers>] [-d <dir>]\n",
+         progname);
+  printf("       %s step <ms> [<file> [<hold ms>]]\n", progname);
+  printf("  -n  Independent boot steps, default %d\n",
+         NIBENCH_DEFAULT_STEPS);
+  printf("  -t  Duration of a step in ms, default %d\n", NIBENCH_DEFAULT_MS);
+  printf("  -j  Workers of the concurrent run, default %d\n",
+         CONFIG_SYSTEM_NXINIT_ACTION_WORKERS);
+  printf("  -d  Directory for the RC and readiness files, default %s\n",
+         NIBENCH_DEFAULT_DIR);
+  printf("The \"step\" form is what the generated RC file runs: it\n"
+         "sleeps, creates the file and stays alive for hold ms.\n");
+}
+
+/* A boot step: take some time, then signal readiness with a file */
+
+static int nibench_step(int argc, FAR char *argv[])
+{
+  int fd;
+
+  usleep(atoi(argv[2]) * 1000);
+  if (argc > 3)
+    {
+      fd = open(argv[3], O_WRONLY | O_CREAT | O_TRUNC, 0644);
+      if (fd < 0)
+        {
+          return EXIT_FAILURE;
+        }
+
+      close(fd);
+    }
+
+  if (argc > 4)
+    {
+      usleep(atoi(argv[4]) * 1000);
+    }
+
+  return EXIT_SUCCESS;
+}
+
+static void nibench_path(FAR struct nibench_s *bench, FAR char *path,
+                         FAR const char *name)
+{
+  snprintf(path, NIBENCH_PATH_MAX, "%s/nxinit_bench_%s", bench->dir, name);
+}
+
+/* Generate the RC file:
+ *
+ *   - "on boot": a step that sets a property, an independent step and a
+ *     step that waits for the property.
+ *   - "on init": the service chain s1 -> s2 -> s3, and bench->steps
+ *     independent steps.
+ *   - s1 is ready once it exits, s2 starts after s1 and s3 after s2, s3
+ *     signals readiness with a file and keeps running.
+ *
+ * With one worker everything but the service chain runs in sequence.
+ */
+
+static int nibench_rc(FAR struct nibench_s *bench)
+{
+  char path[NIBENCH_PATH_MAX];
+  FAR FILE *rc;
+  int i;
+
+  nibench_path(bench, bench->rc, "init.rc");
+  rc = fopen(bench->rc, "w");
+  if (rc == NULL)
+    {
+      fprintf(stderr, "Could not create %s: %d\n", bench->rc, errno);
+      return -errno;
+    }
+
+  fprintf(rc, "on boot\n");
+  fprintf(rc, "    exec -- nxinit_bench step %d\n", bench->ms);
+  fprintf(rc, "    setprop bench.step done\n");
+  fprintf(rc, "on boot\n");
+  fprintf(rc, "    exec -- nxinit_bench step %d\n", bench->ms);
+  fprintf(rc, "on boot\n");
+  fprintf(rc, "    wait_for_prop bench.step done\n");
+  fprintf(rc, "    exec -- nxinit_bench step %d\n", bench->ms);
+
+  fprintf(rc, "on init\n");
+  fprintf(rc, "    class_start bench\n");
+  for (i = 0; i < bench->steps; i++)
+    {
+      fprintf(rc, "on init\n");
+      fprintf(rc, "    exec -- nxinit_bench step %d\n", bench->ms);
+    }
+
+  fprintf(rc, "service s1 nxinit_bench step %d\n", bench->ms);
+  fprintf(rc, "    class bench\n");
+  fprintf(rc, "    oneshot\n");
+  fprintf(rc, "    ready exited\n");
+  fprintf(rc, "service s2 nxinit_bench step %d\n", bench->ms);
+  fprintf(rc, "    class bench\n");
+  fprintf(rc, "    oneshot\n");
+  fprintf(rc, "    after s1\n");
+  fprintf(rc, "    ready exited\n");
+
+  nibench_path(bench, path, "s3");
+  fprintf(rc, "service s3 nxinit_bench step %d %s %d\n",
+          bench->ms, path, 5 * bench->ms);
+  fprintf(rc, "    class bench\n");
+  fprintf(rc, "    oneshot\n");
+  fprintf(rc, "    after s2\n");
+  fprintf(rc, "    ready file %s\n", path);
+
+  fclose(rc);
+  return 0;
+}
+
+/* Show the timeline NxInit wrote once the boot was complete */
+
+#ifdef CONFIG_SYSTEM_NXINIT_TIMELINE
+static void nibench_timeline(void)
+{
+  FAR FILE *file;
+  int c;
+
+  file = fopen(CONFIG_SYSTEM_NXINIT_TIMELINE_PATH, "r");
+  if (file != NULL)
+    {
+      while ((c = fgetc(file)) != EOF)
+        {
+          putchar(c);
+        }
+
+      fclose(file);
+    }
+}
+#else
+#  define nibench_timeline()
+#endif
+
+/* Boot with the RC file until everything is started and ready */
+
+static void nibench_boot(FAR struct nibench_s *bench, int workers)
+{
+  char path[NIBENCH_PATH_MAX];
+  char jobs[12];
+  struct timespec start;
+  struct timespec end;
+  FAR char *argv[7];
+  int status;
+  pid_t pid;
+  int ret;
+
+  nibench_path(bench, path, "s3");
+  unlink(path);
+
+  snprintf(jobs, sizeof(jobs), "%d", workers);
+  argv[0] = CONFIG_SYSTEM_NXINIT_PROGNAME;
+  argv[1] = "-f";
+  argv[2] = bench->rc;
+  argv[3] = "-j";
+  argv[4] = jobs;
+  argv[5] = "-x";
+  argv[6] = NULL;
+
+  clock_gettime(CLOCK_MONOTONIC, &start);
+  ret = posix_spawnp(&pid, argv[0], NULL, NULL, argv, NULL);
+  if (ret != 0)
+    {
+      fprintf(stderr, "Could not start %s: %d\n", argv[0], ret);
+      bench->errors++;
+      return;
+    }
+
+  if (waitpid(pid, &status, 0) != pid ||
+      !WIFEXITED(status) || WEXITSTATUS(status) != 0)
+    {
+      fprintf(stderr, "%s -j %d failed\n", argv[0], workers);
+      bench->errors++;
+      return;
+    }
+
+  clock_gettime(CLOCK_MONOTONIC, &end);
+
+  /* s3 runs on after the boot completed, but it must be ready */
+
+  if (access(path, F_OK) != 0)
+    {
+      fprintf(stderr, "Service s3 not ready\n");
+      bench->errors++;
+    }
+
+  printf("%-8d %10ld ms\n", workers,
+         (long)((end.tv_sec - start.tv_sec) * 1000 +
+                (end.tv_nsec - start.tv_nsec) / 1000000));
+
+  nibench_timeline();
+}
+
+/****************************************************************************
+ * Public Functions
+ ****************************************************************************/
+
+int main(int argc, FAR char *argv[])
+{
+  struct nibench_s bench;
+  int opt;
+
+  if (argc > 2 && !strcmp(argv[1], "step"))
+    {
+      return nibench_step(argc, argv);
+    }
+
+  memset(&bench, 0, sizeof(bench));
+  bench.steps = NIBENCH_DEFAULT_STEPS;
+  bench.ms = NIBENCH_DEFAULT_MS;
+  bench.workers = CONFIG_SYSTEM_NXINIT_ACTION_WORKERS;
+  bench.dir = NIBENCH_DEFAULT_DIR;
+
+  while ((opt = getopt(argc, argv, "n:t:j:d:h")) != ERROR)
+    {
+      switch (opt)
+        {
+          case 'n':
+            bench.steps = atoi(optarg);
+            break;
+
+          case 't':
+            bench.ms = atoi(optarg);
+            break;
+
+          case 'j':
+            bench.workers = atoi(optarg);
+            break;
+
+          case 'd':
+            bench.dir = optarg;
+            break;
+
+          default:
+            nibench_usage(argv[0]);
+            return opt == 'h' ? EXIT_SUCCESS : EXIT_FAILURE;
+        }
+    }
+
+  if (bench.steps < 0 || bench.ms <= 0 || bench.workers < 1 ||
+      bench.workers > CONFIG_SYSTEM_NXINIT_ACTION_WORKERS)
+    {
+      nibench_usage(argv[0]);
+      return EXIT_FAILURE;
+    }
+
+  if (nibench_rc(&bench) < 0)
+    {
+      return EXIT_FAILURE;
+    }
+
+  printf("%d steps of %d ms, service chain of %d\n",
+         bench.steps + 3, bench.ms, NIBENCH_NSERVICES);
+  printf("%-8s %13s\n", "workers", "boot");
+
+  nibench_boot(&bench, 1);
+  if (bench.workers > 1)
+    {
+      nibench_boot(&bench, bench.workers);
+    }
+
+  unlink(bench.rc);
+  printf("%d errors\n", bench.errors);
+  return bench.errors == 0 ? EXIT_SUCCESS : EXIT_FAILURE;
+}
@@ -0,0 +1,658 @@
+/****************************************************************************
+ * apps/benchmarks/nxpkg/nxpkg_bench.c
+ *
+ * SPDX-License-Identifier: Apache-2.0
+ *
+ * Licensed to the Apache Software Foundation (ASF) under one or more
+ * contributor license agreements.  See the NOTICE file distributed with
+ * this work for additional information regarding copyright ownership.  The
+ * ASF licenses this file to you under the Apache License, Version 2.0 (the
+ * "License"); you may not use this file except in compliance with the
+ * License.  You may obtain a copy of the License at
+ *
+ *   http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS, WITHOUT
+ * WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.  See the
+ * License for the specific language governing permissions and limitations
+ * under the License.
+ *
+ ****************************************************************************/
+
+/****************************************************************************
+ * Included Files
+ ****************************************************************************/
+
+#include <nuttx/config.h>
+
+#include <dirent.h>
+#include <errno.h>
+#include <fcntl.h>
+#include <spawn.h>
+#include <stdbool.h>
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+#include <unistd.h>
+
+#include <sys/stat.h>
+#include <sys/wait.h>
+
+#include <crypto/sha2.h>
+
+#include "pkg.h"
+
+/****************************************************************************
+ * Pre-processor Definitions
+ ****************************************************************************/
+
+#define NPBENCH_DEFAULT_KB      1024    /* Size of the generated payload */
+#define NPBENCH_DEFAULT_DIR     "/tmp"  /* Scratch files of the copy test */
+#define NPBENCH_OLD_BUFSIZE     512     /* Buffers of the two pass store */
+#define NPBENCH_NAME            "nxpkg-bench"
+
+/****************************************************************************
+ * Private Types
+ ****************************************************************************/
+
+struct npbench_s
+{
+  size_t size;                          /* Size of the generated payload */
+  FAR const char *dir;                  /* Scratch files of the copy test */
+  FAR uint8_t *buffer;                  /* PKG_IO_BUFSIZE bytes */
+  size_t nread;                         /* Bytes read by the copy test */
+  size_t nwritten;                      /* Bytes written by the copy test */
+  int errors;
+};
+
+/* A file to put back the way it was found */
+
+struct npbench_saved_s
+{
+  FAR const char *path;
+  FAR char *data;                       /* NULL: the file did not exist */
+  size_t length;
+};
+
+/****************************************************************************
+ * Private Functions
+ ****************************************************************************/
+
+static void npbench_usage(FAR const char *progname)
+{
+  printf("Usage: %s [-s <KiB>] [-d <dir>]\n", progname);
+  printf("  -s  Size of the generated payload in KiB, default %d\n",
+         NPBENCH_DEFAULT_KB);
+  printf("  -d  Directory for the copy test files, default %s\n",
+         NPBENCH_DEFAULT_DIR);
+}
+
+static long npbench_ms(FAR const struct timespec *start)
+{
+  struct timespec end;
+
+  clock_gettime(CLOCK_MONOTONIC, &end);
+  return (long)((end.tv_sec - start->tv_sec) * 1000 +
+                (end.tv_nsec - start->tv_nsec) / 1000000);
+}
+
+static void npbench_hex(FAR const uint8_t *raw, FAR char *hex)
+{
+  static const char digits[] = "0123456789abcdef";
+  int i;
+
+  for (i = 0; i < SHA256_DIGEST_LENGTH; i++)
+    {
+      hex[i * 2] = digits[raw[i] >> 4];
+      hex[i * 2 + 1] = digits[raw[i] & 0x0f];
+    }
+
+  hex[PKG_HASH_HEX_LEN] = '\0';
+}
+
+/* Generate a payload, seed selects its content, and return its digest */
+
+static int npbench_payload(FAR struct npbench_s *bench,
+                           FAR const char *path, uint32_t seed,
+                           FAR char digest[PKG_HASH_HEX_LEN + 1])
+{
+  uint8_t raw[SHA256_DIGEST_LENGTH];
+  SHA2_CTX ctx;
+  size_t done;
+  size_t chunk;
+  size_t i;
+  int fd;
+
+  fd = open(path, O_WRONLY | O_CREAT | O_TRUNC, 0644);
+  if (fd < 0)
+    {
+      fprintf(stderr, "Could not create %s: %d\n", path, errno);
+      return -errno;
+    }
+
+  sha256init(&ctx);
+  for (done = 0; done < bench->size; done += chunk)
+    {
+      chunk = bench->size - done;
+      if (chunk > PKG_IO_BUFSIZE)
+        {
+          chunk = PKG_IO_BUFSIZE;
+        }
+
+      for (i = 0; i < chunk; i++)
+        {
+          seed = seed * 1103515245 + 12345;
+          bench->buffer[i] = seed >> 16;
+        }
+
+      sha256update(&ctx, bench->buffer, chunk);
+      if (write(fd, bench->buffer, chunk) != (ssize_t)chunk)
+        {
+          fprintf(stderr, "Could not write %s: %d\n", path, errno);
+          close(fd);
+          return -EIO;
+        }
+    }
+
+  close(fd);
+  sha256final(raw, &ctx);
+  if (digest != NULL)
+    {
+      npbench_hex(raw, digest);
+    }
+
+  return 0;
+}
+
+/* Copy src to dest, optionally hashing, with a buffer of the given size */
+
+static int npbench_copy(FAR struct npbench_s *bench, FAR const char *src,
+                        FAR const char *dest, size_t bufsize,
+                        FAR SHA2_CTX *ctx)
+{
+  ssize_t nread;
+  int infd;
+  int outfd = -1;
+  int ret = 0;
+
+  infd = open(src, O_RDONLY);
+  if (infd < 0)
+    {
+      return -errno;
+    }
+
+  if (dest != NULL)
+    {
+      outfd = open(dest, O_WRONLY | O_CREAT | O_TRUNC, 0644);
+      if (outfd < 0)
+        {
+          close(infd);
+          return -errno;
+        }
+    }
+
+  while ((nread = read(infd, bench->buffer, bufsize)) > 0)
+    {
+      bench->nread += nread;
+      if (ctx != NULL)
+        {
+          sha256update(ctx, bench->buffer, nread);
+        }
+
+      if (outfd >= 0)
+        {
+          if (write(outfd, bench->buffer, nread) != nread)
+            {
+              ret = -EIO;
+              break;
+            }
+
+          bench->nwritten += nread;
+        }
+    }
+
+  if (nread < 0)
+    {
+      ret = -errno;
+    }
+
+  if (outfd >= 0)
+    {
+      close(outfd);
+    }
+
+  close(infd);
+  return ret;
+}
+
+/* Store a payload the way nxpkg did before the object store: copy it to a
+ * download file, hash that and copy it again to its place in the store.
+ */
+
+static int npbench_two_pass(FAR struct npbench_s *bench,
+                            FAR const char *src, FAR const char *tmp,
+                            FAR const char *dest)
+{
+  uint8_t raw[SHA256_DIGEST_LENGTH];
+  SHA2_CTX ctx;
+  int ret;
+
+  ret = npbench_copy(bench, src, tmp, NPBENCH_OLD_BUFSIZE, NULL);
+  if (ret >= 0)
+    {
+      sha256init(&ctx);
+      ret = npbench_copy(bench, tmp, NULL, NPBENCH_OLD_BUFSIZE, &ctx);
+      sha256final(raw, &ctx);
+    }
+
+  if (ret >= 0)
+    {
+      ret = npbench_copy(bench, tmp, dest, NPBENCH_OLD_BUFSIZE, NULL);
+    }
+
+  unlink(tmp);
+  return ret;
+}
+
+/* Store it the way pkg_hash_copy_sha256() does */
+
+static int npbench_one_pass(FAR struct npbench_s *bench,
+                            FAR const char *src, FAR const char *dest)
+{
+  uint8_t raw[SHA256_DIGEST_LENGTH];
+  SHA2_CTX ctx;
+  int ret;
+
+  sha256init(&ctx);
+  ret = npbench_copy(bench, src, dest, PKG_IO_BUFSIZE, &ctx);
+  sha256final(raw, &ctx);
+  return ret;
+}
+
+static void npbench_store(FAR struct npbench_s *bench)
+{
+  char src[PATH_MAX];
+  char tmp[PATH_MAX];
+  char dest[PATH_MAX];
+  struct timespec start;
+  int ret;
+
+  snprintf(src, sizeof(src), "%s/nxpkg_bench_src", bench->dir);
+  snprintf(tmp, sizeof(tmp), "%s/nxpkg_bench_tmp", bench->dir);
+  snprintf(dest, sizeof(dest), "%s/nxpkg_bench_dest", bench->dir);
+
+  if (npbench_payload(bench, src, 1, NULL) < 0)
+    {
+      bench->errors++;
+      return;
+    }
+
+  printf("%-24s %8s %10s %10s\n", "store path", "time", "read",
+         "written");
+
+  bench->nread = 0;
+  bench->nwritten = 0;
+  clock_gettime(CLOCK_MONOTONIC, &start);
+  ret = npbench_two_pass(bench, src, tmp, dest);
+  if (ret < 0)
+    {
+      fprintf(stderr, "Two pass store failed: %d\n", ret);
+      bench->errors++;
+    }
+  else
+    {
+      printf("%-24s %5ld ms %10zu %10zu\n", "two pass, 512 B",
+             npbench_ms(&start), bench->nread, bench->nwritten);
+    }
+
+  unlink(dest);
+
+  bench->nread = 0;
+  bench->nwritten = 0;
+  clock_gettime(CLOCK_MONOTONIC, &start);
+  ret = npbench_one_pass(bench, src, dest);
+  if (ret < 0)
+    {
+      fprintf(stderr, "One pass store failed: %d\n", ret);
+      bench->errors++;
+    }
+  else
+    {
+      snprintf(tmp, sizeof(tmp), "one pass, %d B", PKG_IO_BUFSIZE);
+      printf("%-24s %5ld ms %10zu %10zu\n", tmp, npbench_ms(&start),
+             bench->nread, bench->nwritten);
+    }
+
+  unlink(dest);
+  unlink(src);
+}
+
+/* Bytes in the package store and in the object store */
+
+static size_t npbench_du(FAR const char *path)
+{
+  FAR struct dirent *entry;
+  char child[PATH_MAX];
+  struct stat st;
+  FAR DIR *dir;
+  size_t total = 0;
+
+  if (stat(path, &st) < 0)
+    {
+      return 0;
+    }
+
+  if (!S_ISDIR(st.st_mode))
+    {
+      return st.st_size;
+    }
+
+  dir = opendir(path);
+  if (dir == NULL)
+    {
+      return 0;
+    }
+
+  while ((entry = readdir(dir)) != NULL)
+    {
+      if (!strcmp(entry->d_name, ".") || !strcmp(entry->d_name, ".."))
+        {
+          continue;
+        }
+
+      snprintf(child, sizeof(child), "%s/%s", path, entry->d_name);
+      total += npbench_du(child);
+    }
+
+  closedir(dir);
+  return total;
+}
+
+static size_t npbench_stored(void)
+{
+  return npbench_du(PKG_STORE_DIR) + npbench_du(PKG_OBJECT_DIR);
+}
+
+static void npbench_remove(FAR const char *path)
+{
+  FAR struct dirent *entry;
+  char child[PATH_MAX];
+  FAR DIR *dir;
+
+  dir = opendir(path);
+  if (dir == NULL)
+    {
+      unlink(path);
+      return;
+    }
+
+  while ((entry = readdir(dir)) != NULL)
+    {
+      if (strcmp(entry->d_name, ".") && strcmp(entry->d_name, ".."))
+        {
+          snprintf(child, sizeof(child), "%s/%s", path, entry->d_name);
+          npbench_remove(child);
+        }
+    }
+
+  closedir(dir);
+  rmdir(path);
+}
+
+static void npbench_save(FAR struct npbench_saved_s *saved,
+                         FAR const char *path)
+{
+  struct stat st;
+  int fd;
+
+  saved->path = path;
+  saved->data = NULL;
+  saved->length = 0;
+
+  fd = open(path, O_RDONLY);
+  if (fd < 0)
+    {
+      return;
+    }
+
+  if (fstat(fd, &st) == 0)
+    {
+      saved->data = malloc(st.st_size + 1);
+      if (saved->data != NULL)
+        {
+          saved->length = read(fd, saved->data, st.st_size);
+        }
+    }
+
+  close(fd);
+}
+
+static void npbench_restore(FAR struct npbench_saved_s *saved)
+{
+  int fd;
+
+  if (saved->data == NULL)
+    {
+      unlink(saved->path);
+      return;
+    }
+
+  fd = open(saved->path, O_WRONLY | O_CREAT | O_TRUNC, 0644);
+  if (fd >= 0)
+    {
+      write(fd, saved->data, saved->length);
+      close(fd);
+    }
+
+  free(saved->data);
+}
+
+/* Publish version of the package with the given payload as the only
+ * package of the repository index.
+ */
+
+static int npbench_publish(FAR struct npbench_s *bench,
+                           FAR const char *version, uint32_t seed)
+{
+  char digest[PKG_HASH_HEX_LEN + 1];
+  char path[PATH_MAX];
+  FAR FILE *index;
+  int ret;
+
+  snprintf(path, sizeof(path), "%s/%s-%s.bin", PKG_REPO_DIR, NPBENCH_NAME,
+           version);
+  ret = npbench_payload(bench, path, seed, digest);
+  if (ret < 0)
+    {
+      return ret;
+    }
+
+  index = fopen(PKG_REPO_INDEX, "w");
+  if (index == NULL)
+    {
+      fprintf(stderr, "Could not create %s: %d\n", PKG_REPO_INDEX, errno);
+      return -errno;
+    }
+
+  fprintf(index, "{\"packages\":[{\"name\":\"%s\",\"version\":\"%s\","
+          "\"arch\":\"%s\",\"compat\":\"%s\",\"artifact\":\"%s-%s.bin\","
+          "\"sha256\":\"%s\",\"type\":\"elf\"}]}\n",
+          NPBENCH_NAME, version, CONFIG_ARCH, CONFIG_ARCH_BOARD,
+          NPBENCH_NAME, version, digest);
+  fclose(index);
+  return 0;
+}
+
+/* Run nxpkg with its output discarded */
+
+static int npbench_nxpkg(FAR const char *cmd)
+{
+  posix_spawn_file_actions_t actions;
+  FAR char *argv[4];
+  int status;
+  pid_t pid;
+  int ret;
+
+  argv[0] = CONFIG_SYSTEM_NXPKG_PROGNAME;
+  argv[1] = (FAR char *)cmd;
+  argv[2] = NPBENCH_NAME;
+  argv[3] = NULL;
+
+  posix_spawn_file_actions_init(&actions);
+  posix_spawn_file_actions_addopen(&actions, STDOUT_FILENO, "/dev/null",
+                                   O_WRONLY, 0);
+  ret = posix_spawnp(&pid, argv[0], &actions, NULL, argv, NULL);
+  posix_spawn_file_actions_destroy(&actions);
+  if (ret != 0)
+    {
+      return -ret;
+    }
+
+  if (waitpid(pid, &status, 0) != pid)
+    {
+      return -errno;
+    }
+
+  return WIFEXITED(status) && WEXITSTATUS(status) == 0 ? 0 : -EIO;
+}
+
+static void npbench_step(FAR struct npbench_s *bench, FAR const char *what,
+                         FAR const char *cmd, FAR const char *version,
+                         uint32_t seed)
+{
+  struct timespec start;
+  size_t before;
+  int ret;
+
+  if (version != NULL && npbench_publish(bench, version, seed) < 0)
+    {
+      bench->errors++;
+      return;
+    }
+
+  before = npbench_stored();
+  clock_gettime(CLOCK_MONOTONIC, &start);
+  ret = npbench_nxpkg(cmd);
+  if (ret < 0)
+    {
+      fprintf(stderr, "%s %s failed: %d\n", CONFIG_SYSTEM_NXPKG_PROGNAME,
+              cmd, ret);
+      bench->errors++;
+      return;
+    }
+
+  printf("%-24s %5ld ms %10zd\n", what, npbench_ms(&start),
+         (ssize_t)(npbench_stored() - before));
+}
+
+/* Install, upgrade and roll back the benchmark package */
+
+static void npbench_lifecycle(FAR struct npbench_s *bench)
+{
+  struct npbench_saved_s index;
+  struct npbench_saved_s installed;
+  char path[PATH_MAX];
+  char digest[2][PKG_HASH_HEX_LEN + 1];
+  bool existed[2];
+  int i;
+
+  /* The objects of the two payloads, unless they were there already */
+
+  for (i = 0; i < 2; i++)
+    {
+      snprintf(path, sizeof(path), "%s/nxpkg_bench_src", bench->dir);
+      npbench_payload(bench, path, 2 + i, digest[i]);
+      snprintf(path, sizeof(path), "%s/%s", PKG_OBJECT_DIR, digest[i]);
+      existed[i] = access(path, F_OK) == 0;
+    }
+
+  snprintf(path, sizeof(path), "%s/nxpkg_bench_src", bench->dir);
+  unlink(path);
+
+  npbench_save(&index, PKG_REPO_INDEX);
+  npbench_save(&installed, PKG_REPO_INSTALLED);
+  mkdir(PKG_REPO_DIR, 0755);
+
+  printf("%-24s %8s %10s\n", "package step", "time", "stored");
+  npbench_step(bench, "install", "install", "1.0", 2);
+  npbench_step(bench, "upgrade, new payload", "install", "1.1", 3);
+  npbench_step(bench, "upgrade, same payload", "install", "1.2", 3);
+  npbench_step(bench, "rollback", "rollback", NULL, 0);
+
+  npbench_restore(&index);
+  npbench_restore(&installed);
+
+  snprintf(path, sizeof(path), "%s/%s", PKG_STORE_DIR, NPBENCH_NAME);
+  npbench_remove(path);
+  for (i = 0; i < 3; i++)
+    {
+      snprintf(path, sizeof(path), "%s/%s-1.%d.bin", PKG_REPO_DIR,
+               NPBENCH_NAME, i);
+      unlink(path);
+    }
+
+  for (i = 0; i < 2; i++)
+    {
+      if (!existed[i])
+        {
+          snprintf(path, sizeof(path), "%s/%s", PKG_OBJECT_DIR, digest[i]);
+          unlink(path);
+        }
+    }
+}
+
+/****************************************************************************
+ * Public Functions
+ ****************************************************************************/
+
+int main(int argc, FAR char *argv[])
+{
+  struct npbench_s bench;
+  int opt;
+
+  memset(&bench, 0, sizeof(bench));
+  bench.size = NPBENCH_DEFAULT_KB * 1024;
+  bench.dir = NPBENCH_DEFAULT_DIR;
+
+  while ((opt = getopt(argc, argv, "s:d:h")) != ERROR)
+    {
+      switch (opt)
+        {
+          case 's':
+            bench.size = (size_t)atoi(optarg) * 1024;
+            break;
+
+          case 'd':
+            bench.dir = optarg;
+            break;
+
+          default:
+            npbench_usage(argv[0]);
+            return opt == 'h' ? EXIT_SUCCESS : EXIT_FAILURE;
+        }
+    }
+
+  if (bench.size == 0)
+    {
+      npbench_usage(argv[0]);
+      return EXIT_FAILURE;
+    }
+
+  bench.buffer = malloc(PKG_IO_BUFSIZE);
+  if (bench.buffer == NULL)
+    {
+      fprintf(stderr, "Out of memory\n");
+      return EXIT_FAILURE;
+    }
+
+  printf("payload of %zu bytes\n", bench.size);
+  npbench_store(&bench);
+  npbench_lifecycle(&bench);
+
+  free(bench.buffer);
+  printf("%d errors\n", bench.errors);
+  return bench.errors == 0 ? EXIT_SUCCESS : EXIT_FAILURE;
+}
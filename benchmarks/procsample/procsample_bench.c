@@ -0,0 +1,417 @@
+/****************************************************************************
+ * apps/benchmarks/procsample/procsample_bench.c
+ *
+ * SPDX-License-Identifier: Apache-2.0
+ *
+ * Licensed to the Apache Software Foundation (ASF) under one or more
+ * contributor license agreements.  See the NOTICE file distributed with
+ * this work for additional information regarding copyright ownership.  The
+ * ASF licenses this file to you under the Apache License, Version 2.0 (the
+ * "License"); you may not use this file except in compliance with the
+ * License.  You may obtain a copy of the License at
+ *
+ *   http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS, WITHOUT
+ * WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.  See the
+ * License for the specific language governing permissions and limitations
+ * under the License.
+ *
+ ****************************************************************************/
+
+/****************************************************************************
+ * Included Files
+ ****************************************************************************/
+
+#include <nuttx/config.h>
+
+#include <ctype.h>
+#include <dirent.h>
+#include <errno.h>
+#include <inttypes.h>
+#include <limits.h>
+#include <pthread.h>
+#include <semaphore.h>
+#include <stdbool.h>
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <sys/param.h>
+#include <time.h>
+#include <unistd.h>
+
+#include "system/procsample.h"
+
+/****************************************************************************
+ * Pre-processor Definitions
+ ****************************************************************************/
+
+#define PSBENCH_DEFAULT_MOUNTPOINT "/proc"
+#define PSBENCH_DEFAULT_TASKS      64
+#define PSBENCH_DEFAULT_ROUNDS     20
+#define PSBENCH_STACKSIZE          MAX(PTHREAD_STACK_MIN, 1024)
+
+#define PSBENCH_FILES              (PROCSAMPLE_FILE(PROCSAMPLE_STATUS) | \
+                                    PROCSAMPLE_FILE(PROCSAMPLE_STACK))
+
+/****************************************************************************
+ * Private Types
+ ****************************************************************************/
+
+struct psbench_s
+{
+  FAR const char *mountpoint;
+  FAR pthread_t *threads;
+  int nthreads;
+  sem_t sem;
+  volatile bool stop;
+  unsigned long checksum;      /* Keeps the parsed values alive */
+};
+
+/****************************************************************************
+ * Private Functions
+ ****************************************************************************/
+
+/****************************************************************************
+ * Name: psbench_now
+ ****************************************************************************/
+
+static uint64_t psbench_now(void)
+{
+  struct timespec ts;
+
+  clock_gettime(CLOCK_MONOTONIC, &ts);
+  return (uint64_t)ts.tv_sec * 1000000 + ts.tv_nsec / 1000;
+}
+
+/****************************************************************************
+ * Name: psbench_idle
+ ****************************************************************************/
+
+static FAR void *psbench_idle(FAR void *arg)
+{
+  FAR struct psbench_s *bench = arg;
+
+  while (!bench->stop)
+    {
+      sem_wait(&bench->sem);
+    }
+
+  return NULL;
+}
+
+/****************************************************************************
+ * Name: psbench_spawn
+ *
+ * Description:
+ *   Grow the number of idle threads to count.
+ *
+ ****************************************************************************/
+
+static int psbench_spawn(FAR struct psbench_s *bench, int count)
+{
+  pthread_attr_t attr;
+  int ret = OK;
+
+  pthread_attr_init(&attr);
+  pthread_attr_setstacksize(&attr, PSBENCH_STACKSIZE);
+
+  while (bench->nthreads < count)
+    {
+      ret = pthread_create(&bench->threads[bench->nthreads], &attr,
+                           psbench_idle, bench);
+      if (ret != 0)
+        {
+          fprintf(stderr, "ERROR: pthread_create failed: %d\n", ret);
+          ret = -ret;
+          break;
+        }
+
+      bench->nthreads++;
+    }
+
+  pthread_attr_destroy(&attr);
+  return ret;
+}
+
+/****************************************************************************
+ * Name: psbench_reap
+ ****************************************************************************/
+
+static void psbench_reap(FAR struct psbench_s *bench)
+{
+  int i;
+
+  bench->stop = true;
+  for (i = 0; i < bench->nthreads; i++)
+    {
+      sem_post(&bench->sem);
+    }
+
+  for (i = 0; i < bench->nthreads; i++)
+    {
+      pthread_join(bench->threads[i], NULL);
+    }
+
+  bench->nthreads = 0;
+}
+
+/****************************************************************************
+ * Name: psbench_readvalue
+ *
+ * Description:
+ *   What the monitors used to do for each file: build the path, fopen()
+ *   it and scan it with fgets() for one key.
+ *
+ ****************************************************************************/
+
+static unsigned long psbench_readvalue(FAR struct psbench_s *bench,
+                                       FAR const char *pid,
+                                       FAR const char *file,
+                                       FAR const char *key)
+{
+  char path[PATH_MAX];
+  char line[80];
+  unsigned long value = 0;
+  size_t len = strlen(key);
+  FILE *stream;
+
+  snprintf(path, sizeof(path), "%s/%s/%s", bench->mountpoint, pid, file);
+  stream = fopen(path, "r");
+  if (stream == NULL)
+    {
+      return 0;
+    }
+
+  while (fgets(line, sizeof(line), stream) != NULL)
+    {
+      if (strncmp(line, key, len) == 0)
+        {
+          value = strtoul(&line[len], NULL, 10);
+          break;
+        }
+    }
+
+  fclose(stream);
+  return value;
+}
+
+/****************************************************************************
+ * Name: psbench_legacy
+ *
+ * Description:
+ *   One sample the way stackmonitor did it before: walk the directory and
+ *   open, read and parse status and stack of every task.
+ *
+ ****************************************************************************/
+
+static int psbench_legacy(FAR struct psbench_s *bench)
+{
+  FAR struct dirent *entryp;
+  FAR DIR *dirp;
+  int ntasks = 0;
+
+  dirp = opendir(bench->mountpoint);
+  if (dirp == NULL)
+    {
+      return -errno;
+    }
+
+  while ((entryp = readdir(dirp)) != NULL)
+    {
+      if (!DIRENT_ISDIRECTORY(entryp->d_type) || !isdigit(entryp->d_name[0]))
+        {
+          continue;
+        }
+
+      bench->checksum += psbench_readvalue(bench, entryp->d_name,
+                                           "status", "Name:");
+      bench->checksum += psbench_readvalue(bench, entryp->d_name,
+                                           "stack", "StackSize:");
+      bench->checksum += psbench_readvalue(bench, entryp->d_name,
+                                           "stack", "StackUsed:");
+      ntasks++;
+    }
+
+  closedir(dirp);
+  return ntasks;
+}
+
+/****************************************************************************
+ * Name: psbench_task
+ ****************************************************************************/
+
+static int psbench_task(FAR struct procsample_s *ps,
+                        FAR struct procsample_task_s *task, FAR void *arg)
+{
+  FAR struct psbench_s *bench = arg;
+
+  bench->checksum += task->stacksize + task->stackused + task->name[0];
+  return OK;
+}
+
+/****************************************************************************
+ * Name: psbench_run
+ ****************************************************************************/
+
+static int psbench_run(FAR struct psbench_s *bench, int rounds)
+{
+  struct procsample_s ps;
+  uint64_t legacy;
+  uint64_t first;
+  uint64_t cached;
+  uint64_t start;
+  int ntasks = 0;
+  int ret;
+  int i;
+
+  /* The old way, every sample opens every file */
+
+  start = psbench_now();
+  for (i = 0; i < rounds; i++)
+    {
+      ntasks = psbench_legacy(bench);
+      if (ntasks < 0)
+        {
+          return ntasks;
+        }
+    }
+
+  legacy = (psbench_now() - start) / rounds;
+
+  /* The first sample opens the files, the following ones re-read them */
+
+  procsample_init(&ps, bench->mountpoint, PSBENCH_FILES);
+
+  start = psbench_now();
+  ret = procsample_update(&ps, psbench_task, bench);
+  first = psbench_now() - start;
+
+  start = psbench_now();
+  for (i = 0; i < rounds && ret >= 0; i++)
+    {
+      ret = procsample_update(&ps, psbench_task, bench);
+    }
+
+  cached = (psbench_now() - start) / rounds;
+
+  if (ret >= 0)
+    {
+      printf("%6d %10" PRIu64 " %10" PRIu64 " %10" PRIu64
+             " %8" PRIu64 " %6" PRIu32 " %3" PRIu64 ".%" PRIu64 "x\n",
+             ntasks, legacy, first, cached,
+             ntasks > 0 ? cached / ntasks : 0, ps.nopens,
+             cached > 0 ? legacy / cached : 0,
+             cached > 0 ? legacy * 10 / cached % 10 : 0);
+    }
+
+  procsample_deinit(&ps);
+  return ret;
+}
+
+/****************************************************************************
+ * Name: psbench_usage
+ ****************************************************************************/
+
+static void psbench_usage(FAR const char *progname)
+{
+  fprintf(stderr, "Usage: %s [-n <tasks>] [-r <rounds>] [-m <mountpoint>]\n",
+          progname);
+  fprintf(stderr, "  -n  Largest number of idle threads to add "
+                  "(default %d)\n", PSBENCH_DEFAULT_TASKS);
+  fprintf(stderr, "  -r  Samples per measurement (default %d)\n",
+          PSBENCH_DEFAULT_ROUNDS);
+  fprintf(stderr, "  -m  procfs mount point (default %s)\n",
+          PSBENCH_DEFAULT_MOUNTPOINT);
+}
+
+/****************************************************************************
+ * Public Functions
+ ****************************************************************************/
+
+int main(int argc, FAR char *argv[])
+{
+  struct psbench_s bench;
+  int maxtasks = PSBENCH_DEFAULT_TASKS;
+  int rounds = PSBENCH_DEFAULT_ROUNDS;
+  int count;
+  int ret = OK;
+  int opt;
+
+  memset(&bench, 0, sizeof(bench));
+  bench.mountpoint = PSBENCH_DEFAULT_MOUNTPOINT;
+
+  while ((opt = getopt(argc, argv, "n:r:m:h")) != ERROR)
+    {
+      switch (opt)
+        {
+          case 'n':
+            maxtasks = atoi(optarg);
+            break;
+
+          case 'r':
+            rounds = atoi(optarg);
+            break;
+
+          case 'm':
+            bench.mountpoint = optarg;
+            break;
+
+          default:
+            psbench_usage(argv[0]);
+            return EXIT_FAILURE;
+        }
+    }
+
+  if (maxtasks < 0 || rounds <= 0)
+    {
+      psbench_usage(argv[0]);
+      return EXIT_FAILURE;
+    }
+
+  bench.threads = calloc(MAX(maxtasks, 1), sizeof(pthread_t));
+  if (bench.threads == NULL)
+    {
+      return EXIT_FAILURE;
+    }
+
+  sem_init(&bench.sem, 0, 0);
+
+  printf("Sample cost in microseconds, status and stack of every task\n");
+  printf("%6s %10s %10s %10s %8s %6s %6s\n",
+         "TASKS", "LEGACY", "FIRST", "CACHED", "PERTASK", "OPENS",
+         "GAIN");
+
+  /* Double the number of idle threads for every measurement */
+
+  for (count = 0; ; count = count ? count * 2 : 8)
+    {
+      count = MIN(count, maxtasks);
+      ret = psbench_spawn(&bench, count);
+      if (ret < 0)
+        {
+          break;
+        }
+
+      ret = psbench_run(&bench, rounds);
+      if (ret < 0)
+        {
+          fprintf(stderr, "ERROR: sampling %s failed: %d\n",
+                  bench.mountpoint, ret);
+          break;
+        }
+
+      if (count >= maxtasks)
+        {
+          break;
+        }
+    }
+
+  psbench_reap(&bench);
+  sem_destroy(&bench.sem);
+  free(bench.threads);
+
+  return ret < 0 ? EXIT_FAILURE : EXIT_SUCCESS;
+}
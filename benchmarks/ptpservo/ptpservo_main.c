@@ -0,0 +1,512 @@
+/****************************************************************************
+ * apps/benchmarks/ptpservo/ptpservo_main.c
+ *
+ * SPDX-License-Identifier: Apache-2.0
+ *
+ * Licensed to the Apache Software Foundation (ASF) under one or more
+ * contributor license agreements.  See the NOTICE file distributed with
+ * this work for additional information regarding copyright ownership.  The
+ * ASF licenses this file to you under the Apache License, Version 2.0 (the
+ * "License"); you may not use this file except in compliance with the
+ * License.  You may obtain a copy of the License at
+ *
+ *   http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS, WITHOUT
+ * WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.  See the
+ * License for the specific language governing permissions and limitations
+ * under the License.
+ *
+ ****************************************************************************/
+
+/****************************************************************************
+ * Included Files
+ ****************************************************************************/
+
+#include <nuttx/config.h>
+
+#include <inttypes.h>
+#include <stdbool.h>
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+
+#include "ptpd_servo.h"
+
+/****************************************************************************
+ * Pre-processor Definitions
+ ****************************************************************************/
+
+#define PTPSIM_EPOCH_NS         (1700000000ll * 1000000000ll)
+#define PTPSIM_INTERVAL_NS      1000000000ll
+#define PTPSIM_DELAYREQ_EVERY   4
+#define PTPSIM_DELAYREQ_LATENCY 1000000   /* ns after the sync */
+
+#define PTPSIM_DEFAULT_SECONDS  1200
+#define PTPSIM_DEFAULT_RUNS     8
+#define PTPSIM_DEFAULT_DRIFT    50000     /* ppb */
+#define PTPSIM_DEFAULT_OFFSET   200000    /* ns */
+#define PTPSIM_DEFAULT_DELAY    50000     /* ns */
+#define PTPSIM_DEFAULT_JITTER   100000    /* ns */
+#define PTPSIM_MAXPPB           500000
+
+/* Timestamp noise: software timestamps are taken late by up to the
+ * interrupt and scheduling latency, hardware ones scatter a few ns.
+ */
+
+#define PTPSIM_NOISE_SW_NS      5000
+#define PTPSIM_NOISE_HW_NS      20
+
+#define PTPSIM_ABS(x)           ((x) < 0 ? -(x) : (x))
+
+/****************************************************************************
+ * Private Types
+ ****************************************************************************/
+
+struct ptpsim_s
+{
+  /* Parameters */
+
+  bool hardware_ts;
+  bool verbose;
+  int seconds;
+  int64_t drift_ppb;            /* Remote rate minus local rate */
+  int64_t offset_ns;            /* Initial local minus remote time */
+  int64_t delay_ns;             /* Path delay without queuing */
+  int64_t jitter_ns;            /* Largest regular queuing delay */
+  int64_t bound_ns;             /* Converged when within this */
+  int length;                   /* Filter length, -1 for default */
+  int outlier;                  /* Outlier factor, -1 for default */
+  uint64_t seed;
+
+  /* Results */
+
+  int converged;                /* Seconds until within bound, or -1 */
+  int64_t rms_ns;               /* Over the second half of the run */
+  int64_t max_ns;
+  int64_t freq_err_ppb;         /* Remaining frequency error at the end */
+  uint32_t noutliers;
+};
+
+/****************************************************************************
+ * Private Functions
+ ****************************************************************************/
+
+/****************************************************************************
+ * Name: ptpsim_random
+ ****************************************************************************/
+
+static uint64_t ptpsim_random(FAR uint64_t *state)
+{
+  uint64_t x = *state;
+
+  x ^= x << 13;
+  x ^= x >> 7;
+  x ^= x << 17;
+  *state = x;
+  return x;
+}
+
+/****************************************************************************
+ * Name: ptpsim_isqrt
+ ****************************************************************************/
+
+static uint64_t ptpsim_isqrt(uint64_t value)
+{
+  uint64_t root = 0;
+  uint64_t bit = (uint64_t)1 << 62;
+
+  while (bit > value)
+    {
+      bit >>= 2;
+    }
+
+  while (bit != 0)
+    {
+      if (value >= root + bit)
+        {
+          value -= root + bit;
+          root = (root >> 1) + bit;
+        }
+      else
+        {
+          root >>= 1;
+        }
+
+      bit >>= 2;
+    }
+
+  return root;
+}
+
+/****************************************************************************
+ * Name: ptpsim_uniform
+ ****************************************************************************/
+
+static int64_t ptpsim_uniform(FAR uint64_t *state, int64_t max)
+{
+  return max > 0 ? (int64_t)(ptpsim_random(state) % (uint64_t)max) : 0;
+}
+
+/****************************************************************************
+ * Name: ptpsim_transit
+ *
+ * Description:
+ *   One trip over the simulated path: half of the packets are queued
+ *   behind other traffic for up to jitter_ns, a few get stuck for up to
+ *   ten times as long.
+ *
+ ****************************************************************************/
+
+static int64_t ptpsim_transit(FAR struct ptpsim_s *sim, FAR uint64_t *rnd)
+{
+  uint64_t dice = ptpsim_random(rnd) % 100;
+
+  if (dice < 2)
+    {
+      return sim->delay_ns + sim->jitter_ns +
+             ptpsim_uniform(rnd, 9 * sim->jitter_ns);
+    }
+
+  if (dice < 50)
+    {
+      return sim->delay_ns + ptpsim_uniform(rnd, sim->jitter_ns);
+    }
+
+  return sim->delay_ns;
+}
+
+/****************************************************************************
+ * Name: ptpsim_noise
+ ****************************************************************************/
+
+static int64_t ptpsim_noise(FAR struct ptpsim_s *sim, FAR uint64_t *rnd)
+{
+  if (sim->hardware_ts)
+    {
+      return ptpsim_uniform(rnd, 2 * PTPSIM_NOISE_HW_NS + 1) -
+             PTPSIM_NOISE_HW_NS;
+    }
+
+  return ptpsim_uniform(rnd, PTPSIM_NOISE_SW_NS);
+}
+
+/****************************************************************************
+ * Name: ptpsim_run
+ *
+ * Description:
+ *   Run the servo the way ptpd does: one sync per second, a delay request
+ *   every few syncs once the clock is close, frequency corrections applied
+ *   until the next sync.  err is the true local minus remote time.
+ *
+ ****************************************************************************/
+
+static void ptpsim_run(FAR struct ptpsim_s *sim)
+{
+  struct ptpd_servo_s servo;
+  uint64_t rnd = sim->seed;
+  uint64_t sumsq = 0;
+  int64_t err = sim->offset_ns;
+  int64_t freq = 0;
+  int64_t remote;
+  int64_t local;
+  int64_t offset;
+  int64_t ppb;
+  int nsumsq = 0;
+  int ret;
+  int k;
+
+  ptpd_servo_init(&servo, sim->hardware_ts, PTPSIM_MAXPPB,
+                  CONFIG_NETUTILS_PTPD_SETTIME_THRESHOLD_MS * 1000000ll);
+
+  if (sim->length > 0)
+    {
+      servo.length = sim->length;
+    }
+
+  if (sim->outlier >= 0)
+    {
+      servo.outlier = sim->outlier;
+    }
+
+  sim->converged = -1;
+  sim->max_ns = 0;
+
+  for (k = 0; k < sim->seconds; k++)
+    {
+      /* Sync: remote send time and local receive time */
+
+      remote = PTPSIM_EPOCH_NS + k * PTPSIM_INTERVAL_NS;
+      local  = remote + ptpsim_transit(sim, &rnd) + err +
+               ptpsim_noise(sim, &rnd);
+
+      if (PTPSIM_ABS(err) > sim->bound_ns)
+        {
+          sim->converged = -1;
+        }
+      else if (sim->converged < 0)
+        {
+          sim->converged = k;
+        }
+
+      if (k >= sim->seconds / 2)
+        {
+          sumsq += PTPSIM_ABS(err) > UINT32_MAX ?
+                   UINT64_MAX / sim->seconds : (uint64_t)(err * err);
+          nsumsq++;
+          if (PTPSIM_ABS(err) > sim->max_ns)
+            {
+              sim->max_ns = PTPSIM_ABS(err);
+            }
+        }
+
+      ret = ptpd_servo_sync(&servo, local - remote, local, &offset, &ppb);
+      if (ret == PTPD_SERVO_JUMP)
+        {
+          err += offset;
+        }
+
+      freq = ppb;
+
+      /* ptpd sends the delay request right after processing the sync */
+
+      if (ret == PTPD_SERVO_LOCKED && k % PTPSIM_DELAYREQ_EVERY == 0 &&
+          PTPSIM_ABS(offset) < CONFIG_NETUTILS_PTPD_MAX_PATH_DELAY_NS)
+        {
+          int64_t sent = remote + sim->delay_ns + PTPSIM_DELAYREQ_LATENCY;
+          int64_t t3 = sent + err + ptpsim_noise(sim, &rnd);
+          int64_t t4 = sent + ptpsim_transit(sim, &rnd);
+          int64_t delay;
+
+          ptpd_servo_delay(&servo, t4 - t3, t3, &delay);
+        }
+
+      if (sim->verbose && servo.offset_acc.count == 0 &&
+          ret == PTPD_SERVO_LOCKED)
+        {
+          printf("%5d %10" PRId64 " %10" PRId64 " %10" PRId64
+                 " %10" PRId64 " %10" PRId64 "\n",
+                 k, err, servo.offset_stats.rms, servo.offset_stats.max,
+                 servo.delay_stats.mean, servo.freq_stats.mean);
+        }
+
+      /* Let the clocks run until the next sync */
+
+      err += (freq - sim->drift_ppb) * PTPSIM_INTERVAL_NS / 1000000000ll;
+    }
+
+  sim->rms_ns = nsumsq > 0 ? (int64_t)ptpsim_isqrt(sumsq / nsumsq) : 0;
+  sim->freq_err_ppb = freq - sim->drift_ppb;
+  sim->noutliers = servo.noutliers;
+}
+
+/****************************************************************************
+ * Name: ptpsim_report
+ ****************************************************************************/
+
+static void ptpsim_report(FAR const char *name, FAR struct ptpsim_s *sim)
+{
+  printf("%#18" PRIx64 " %-10s %10d %10" PRId64 " %10" PRId64 " %10" PRId64
+         " %8" PRIu32 "\n", sim->seed, name, sim->converged, sim->rms_ns,
+         sim->max_ns, sim->freq_err_ppb, sim->noutliers);
+}
+
+/****************************************************************************
+ * Name: ptpsim_header
+ ****************************************************************************/
+
+static void ptpsim_header(void)
+{
+  printf("Clock error over the second half of the run, in ns\n");
+  printf("%18s %-10s %10s %10s %10s %10s %8s\n", "SEED", "FILTER",
+         "CONVERGED", "RMS", "MAX", "FREQERR", "OUTLIERS");
+}
+
+/****************************************************************************
+ * Name: ptpsim_usage
+ ****************************************************************************/
+
+static void ptpsim_usage(FAR const char *progname)
+{
+  fprintf(stderr, "Usage: %s [-H] [-v] [-n <seconds>] [-d <ppb>] "
+                  "[-o <ns>] [-p <ns>] [-j <ns>]\n"
+                  "          [-b <ns>] [-l <length>] [-f <factor>] "
+                  "[-s <seed>] [-r <runs>]\n", progname);
+  fprintf(stderr, "  -H  Hardware timestamps (default software)\n");
+  fprintf(stderr, "  -v  Print the servo statistics of every interval\n");
+  fprintf(stderr, "  -n  Simulated seconds, one sync each (default %d)\n",
+          PTPSIM_DEFAULT_SECONDS);
+  fprintf(stderr, "  -d  Local clock drift in ppb (default %d)\n",
+          PTPSIM_DEFAULT_DRIFT);
+  fprintf(stderr, "  -o  Initial clock offset in ns (default %d)\n",
+          PTPSIM_DEFAULT_OFFSET);
+  fprintf(stderr, "  -p  Path delay in ns (default %d)\n",
+          PTPSIM_DEFAULT_DELAY);
+  fprintf(stderr, "  -j  Queuing jitter in ns (default %d)\n",
+          PTPSIM_DEFAULT_JITTER);
+  fprintf(stderr, "  -b  Convergence bound in ns "
+                  "(default 1000 hardware, 20000 software)\n");
+  fprintf(stderr, "  -l  Filter length (default %d)\n",
+          CONFIG_NETUTILS_PTPD_FILTER_LENGTH);
+  fprintf(stderr, "  -f  Outlier factor (default %d)\n",
+          CONFIG_NETUTILS_PTPD_OUTLIER_FACTOR);
+  fprintf(stderr, "  -s  Random seed of the first run\n");
+  fprintf(stderr, "  -r  Runs with consecutive seeds (default %d)\n",
+          PTPSIM_DEFAULT_RUNS);
+}
+
+/****************************************************************************
+ * Public Functions
+ ****************************************************************************/
+
+int main(int argc, FAR char *argv[])
+{
+  struct ptpsim_s sim;
+  struct ptpsim_s run;
+  struct ptpsim_s raw;
+  int runs = PTPSIM_DEFAULT_RUNS;
+  int nfailed = 0;
+  int opt;
+  int i;
+
+  memset(&sim, 0, sizeof(sim));
+  sim.seconds   = PTPSIM_DEFAULT_SECONDS;
+  sim.drift_ppb = PTPSIM_DEFAULT_DRIFT;
+  sim.offset_ns = PTPSIM_DEFAULT_OFFSET;
+  sim.delay_ns  = PTPSIM_DEFAULT_DELAY;
+  sim.jitter_ns = PTPSIM_DEFAULT_JITTER;
+  sim.length    = -1;
+  sim.outlier   = -1;
+  sim.seed      = 0x2545f4914f6cdd1dull;
+
+  while ((opt = getopt(argc, argv, "Hvn:d:o:p:j:b:l:f:s:r:h")) != ERROR)
+    {
+      switch (opt)
+        {
+          case 'H':
+            sim.hardware_ts = true;
+            break;
+
+          case 'v':
+            sim.verbose = true;
+            break;
+
+          case 'n':
+            sim.seconds = atoi(optarg);
+            break;
+
+          case 'd':
+            sim.drift_ppb = strtoll(optarg, NULL, 0);
+            break;
+
+          case 'o':
+            sim.offset_ns = strtoll(optarg, NULL, 0);
+            break;
+
+          case 'p':
+            sim.delay_ns = strtoll(optarg, NULL, 0);
+            break;
+
+          case 'j':
+            sim.jitter_ns = strtoll(optarg, NULL, 0);
+            break;
+
+          case 'b':
+            sim.bound_ns = strtoll(optarg, NULL, 0);
+            break;
+
+          case 'l':
+            sim.length = atoi(optarg);
+            break;
+
+          case 'f':
+            sim.outlier = atoi(optarg);
+            break;
+
+          case 's':
+            sim.seed = strtoull(optarg, NULL, 0);
+            break;
+
+          case 'r':
+            runs = atoi(optarg);
+            break;
+
+          default:
+            ptpsim_usage(argv[0]);
+            return EXIT_FAILURE;
+        }
+    }
+
+  if (sim.seconds < 2 || sim.delay_ns < 0 || sim.jitter_ns < 0 ||
+      sim.length == 0 || sim.length > CONFIG_NETUTILS_PTPD_FILTER_LENGTH ||
+      runs < 1 ||
+      PTPSIM_ABS(sim.drift_ppb) >= PTPSIM_MAXPPB)
+    {
+      ptpsim_usage(argv[0]);
+      return EXIT_FAILURE;
+    }
+
+  if (sim.bound_ns == 0)
+    {
+      sim.bound_ns = sim.hardware_ts ? 1000 : 20000;
+    }
+
+  printf("%s timestamps, drift %" PRId64 " ppb, delay %" PRId64
+         " ns, jitter %" PRId64 " ns\n",
+         sim.hardware_ts ? "Hardware" : "Software", sim.drift_ppb,
+         sim.delay_ns, sim.jitter_ns);
+
+  if (!sim.verbose)
+    {
+      ptpsim_header();
+    }
+
+  /* A single path rarely shows every corner of the filters, run a few */
+
+  for (i = 0; i < runs; i++)
+    {
+      run = sim;
+      run.seed = sim.seed + i != 0 ? sim.seed + i : 1;
+
+      if (run.verbose)
+        {
+          printf("%5s %10s %10s %10s %10s %10s\n", "TIME", "ERROR",
+                 "OFFSETRMS", "OFFSETMAX", "DELAY", "FREQ");
+        }
+
+      ptpsim_run(&run);
+
+      /* The same run without filtering, for comparison */
+
+      raw = run;
+      raw.verbose = false;
+      raw.length = 1;
+      raw.outlier = 0;
+      ptpsim_run(&raw);
+
+      if (run.verbose)
+        {
+          ptpsim_header();
+        }
+
+      ptpsim_report("filtered", &run);
+      ptpsim_report("raw", &raw);
+
+      if (run.converged < 0)
+        {
+          nfailed++;
+        }
+    }
+
+  if (nfailed > 0)
+    {
+      printf("ERROR: %d of %d runs no convergence to %" PRId64 " ns\n",
+             nfailed, runs, sim.bound_ns);
+      return EXIT_FAILURE;
+    }
+
+  return EXIT_SUCCESS;
+}
@@ -0,0 +1,435 @@
+/****************************************************************************
+ * apps/benchmarks/slcan/slcan_bench.c
+ *
+ * SPDX-License-Identifier: Apache-2.0
+ *
+ * Licensed to the Apache Software Foundation (ASF) under one or more
+ * contributor license agreements.  See the NOTICE file distributed with
+ * this work for additional information regarding copyright ownership.  The
+ * ASF licenses this file to you under the Apache License, Version 2.0 (the
+ * "License"); you may not use this file except in compliance with the
+ * License.  You may obtain a copy of the License at
+ *
+ *   http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS, WITHOUT
+ * WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.  See the
+ * License for the specific language governing permissions and limitations
+ * under the License.
+ *
+ ****************************************************************************/
+
+/****************************************************************************
+ * Included Files
+ ****************************************************************************/
+
+#include <nuttx/config.h>
+
+#include <errno.h>
+#include <fcntl.h>
+#include <pthread.h>
+#include <stdbool.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <sys/select.h>
+#include <termios.h>
+#include <time.h>
+#include <unistd.h>
+
+#include "slcan.h"
+
+/****************************************************************************
+ * Pre-processor Definitions
+ ****************************************************************************/
+
+#define SLBENCH_DEFAULT_FRAMES 20000
+#define SLBENCH_DEFAULT_BURST  16
+
+/****************************************************************************
+ * Private Types
+ ****************************************************************************/
+
+struct slbench_s
+{
+  int master;                  /* Host side of the pty */
+  int slave;                   /* Adapter side of the pty */
+  int frames;                  /* Frames to send */
+  int burst;                   /* Frames per host write */
+  bool bytewise;               /* Emulate the old byte at a time I/O */
+  int errors;                  /* Frames that did not come back intact */
+};
+
+/****************************************************************************
+ * Private Functions
+ ****************************************************************************/
+
+/****************************************************************************
+ * Name: slbench_usage
+ ****************************************************************************/
+
+static void slbench_usage(FAR const char *progname)
+{
+  fprintf(stderr, "usage: %s [-n frames] [-b burst]\n", progname);
+  fprintf(stderr, "  -n <n>  Frames sent through the pty [%d]\n",
+          SLBENCH_DEFAULT_FRAMES);
+  fprintf(stderr, "  -b <n>  Frames per host write [%d]\n",
+          SLBENCH_DEFAULT_BURST);
+}
+
+/****************************************************************************
+ * Name: slbench_frame
+ *
+ * Description:
+ *   Generate the i-th test frame, a mix of standard, extended and remote
+ *   frames of every length.
+ *
+ ****************************************************************************/
+
+static void slbench_frame(int i, FAR struct can_frame *frame)
+{
+  int j;
+
+  memset(frame, 0, sizeof(*frame));
+  frame->can_dlc = i % (CAN_MAX_DLEN + 1);
+  if (i % 3 == 0)
+    {
+      frame->can_id = (i * 2654435761u) & CAN_EFF_MASK;
+      frame->can_id |= CAN_EFF_FLAG;
+    }
+  else
+    {
+      frame->can_id = i & CAN_SFF_MASK;
+    }
+
+  if (i % 17 == 0)
+    {
+      frame->can_id |= CAN_RTR_FLAG;
+      return;
+    }
+
+  for (j = 0; j < frame->can_dlc; j++)
+    {
+      frame->data[j] = i + j * 7;
+    }
+}
+
+/****************************************************************************
+ * Name: slbench_adapter
+ *
+ * Description:
+ *   The adapter side: decode every t/T/r/R command and send the frame back
+ *   as if it had been received from the bus, with the acknowledge of the
+ *   command.  This is what slcan does with a looped back CAN interface.
+ *
+ ****************************************************************************/
+
+static FAR void *slbench_adapter(FAR void *arg)
+{
+  FAR struct slbench_s *bench = arg;
+  FAR struct slcan_rxbuf_s *rx;
+  FAR struct slcan_txbuf_s *tx;
+  struct can_frame frame;
+  char buf[SLCAN_MAXFRAME + 1];
+  FAR char *line;
+  int done = 0;
+  int len;
+  uint8_t ch;
+
+  rx = calloc(1, sizeof(*rx));
+  tx = calloc(1, sizeof(*tx));
+  if (rx == NULL || tx == NULL)
+    {
+      goto out;
+    }
+
+  tx->fd = bench->slave;
+
+  while (done < bench->frames)
+    {
+      if (bench->bytewise)
+        {
+          /* One read() per byte and one write() per reply, as before */
+
+          len = 0;
+          while (read(bench->slave, &ch, 1) == 1 && ch != '\r')
+            {
+              if (len < SLCAN_MAXLINE)
+                {
+                  buf[len++] = ch;
+                }
+            }
+
+          write(bench->slave, "\r", 1);
+          if (slcan_decode(buf, len, &frame) == 0)
+            {
+              len = slcan_encode(buf, &frame, -1);
+              write(bench->slave, buf, len);
+            }
+
+          done++;
+          continue;
+        }
+
+      if (slcan_rxfill(rx, bench->slave) <= 0)
+        {
+          break;
+        }
+
+      while ((line = slcan_rxline(rx, &len)) != NULL)
+        {
+          slcan_txput(tx, "\r", 1);
+          if (len > 0 && slcan_decode(line, len, &frame) == 0)
+            {
+              slcan_txcommit(tx, slcan_encode(slcan_txreserve(tx,
+                                              SLCAN_MAXFRAME),
+                                              &frame, -1));
+            }
+
+          done++;
+        }
+
+      slcan_txflush(tx);
+    }
+
+out:
+  free(tx);
+  free(rx);
+  return NULL;
+}
+
+/****************************************************************************
+ * Name: slbench_host
+ *
+ * Description:
+ *   The host side transmitter, writes the frames in bursts.
+ *
+ ****************************************************************************/
+
+static FAR void *slbench_host(FAR void *arg)
+{
+  FAR struct slbench_s *bench = arg;
+  struct can_frame frame;
+  FAR char *buf;
+  size_t len;
+  int i;
+
+  buf = malloc(bench->burst * SLCAN_MAXFRAME);
+  if (buf == NULL)
+    {
+      return NULL;
+    }
+
+  for (i = 0; i < bench->frames; )
+    {
+      len = 0;
+      do
+        {
+          slbench_frame(i++, &frame);
+          len += slcan_encode(&buf[len], &frame, -1);
+        }
+      while (i < bench->frames && i % bench->burst != 0);
+
+      if (write(bench->master, buf, len) != (ssize_t)len)
+        {
+          break;
+        }
+    }
+
+  free(buf);
+  return NULL;
+}
+
+/****************************************************************************
+ * Name: slbench_run
+ *
+ * Description:
+ *   Push the frames through the pty and check what comes back.  Returns the
+ *   elapsed time in seconds, or a negative value on failure.
+ *
+ ****************************************************************************/
+
+static double slbench_run(FAR struct slbench_s *bench)
+{
+  FAR struct slcan_rxbuf_s *rx;
+  struct can_frame expect;
+  struct can_frame frame;
+  struct timespec start;
+  struct timespec end;
+  struct timeval timeout;
+  pthread_t adapter;
+  pthread_t host;
+  FAR char *line;
+  fd_set rdfs;
+  int acks = 0;
+  int got = 0;
+  int len;
+
+  rx = calloc(1, sizeof(*rx));
+  if (rx == NULL)
+    {
+      return -1;
+    }
+
+  bench->errors = 0;
+  clock_gettime(CLOCK_MONOTONIC, &start);
+
+  pthread_create(&adapter, NULL, slbench_adapter, bench);
+  pthread_create(&host, NULL, slbench_host, bench);
+
+  while (got < bench->frames || acks < bench->frames)
+    {
+      FD_ZERO(&rdfs);
+      FD_SET(bench->master, &rdfs);
+      timeout.tv_sec = 5;
+      timeout.tv_usec = 0;
+
+      if (select(bench->master + 1, &rdfs, NULL, NULL, &timeout) <= 0 ||
+          slcan_rxfill(rx, bench->master) <= 0)
+        {
+          fprintf(stderr, "stalled after %d frames\n", got);
+          break;
+        }
+
+      while ((line = slcan_rxline(rx, &len)) != NULL)
+        {
+          if (len == 0)
+            {
+              acks++;
+              continue;
+            }
+
+          slbench_frame(got++, &expect);
+          if (slcan_decode(line, len, &frame) < 0 ||
+              memcmp(&frame, &expect, sizeof(frame)) != 0)
+            {
+              bench->errors++;
+            }
+        }
+    }
+
+  clock_gettime(CLOCK_MONOTONIC, &end);
+
+  pthread_join(host, NULL);
+  pthread_join(adapter, NULL);
+  free(rx);
+
+  if (got < bench->frames)
+    {
+      return -1;
+    }
+
+  return (end.tv_sec - start.tv_sec) +
+         (end.tv_nsec - start.tv_nsec) / 1e9;
+}
+
+/****************************************************************************
+ * Name: slbench_openpty
+ ****************************************************************************/
+
+static int slbench_openpty(FAR struct slbench_s *bench)
+{
+  struct termios tio;
+  char name[32];
+
+  bench->master = posix_openpt(O_RDWR | O_NOCTTY);
+  if (bench->master < 0)
+    {
+      perror("posix_openpt");
+      return -1;
+    }
+
+  if (grantpt(bench->master) < 0 || unlockpt(bench->master) < 0 ||
+      ptsname_r(bench->master, name, sizeof(name)) != 0)
+    {
+      perror("pty setup");
+      close(bench->master);
+      return -1;
+    }
+
+  bench->slave = open(name, O_RDWR | O_NOCTTY);
+  if (bench->slave < 0)
+    {
+      perror(name);
+      close(bench->master);
+      return -1;
+    }
+
+  /* No line discipline, SLCAN lines end with a bare CR */
+
+  if (tcgetattr(bench->slave, &tio) == 0)
+    {
+      cfmakeraw(&tio);
+      tcsetattr(bench->slave, TCSANOW, &tio);
+    }
+
+  return 0;
+}
+
+/****************************************************************************
+ * Public Functions
+ ****************************************************************************/
+
+int main(int argc, FAR char *argv[])
+{
+  struct slbench_s bench;
+  double bytewise;
+  double buffered;
+  int errors;
+  int opt;
+
+  memset(&bench, 0, sizeof(bench));
+  bench.frames = SLBENCH_DEFAULT_FRAMES;
+  bench.burst = SLBENCH_DEFAULT_BURST;
+
+  while ((opt = getopt(argc, argv, "n:b:h")) != ERROR)
+    {
+      switch (opt)
+        {
+          case 'n':
+            bench.frames = atoi(optarg);
+            break;
+
+          case 'b':
+            bench.burst = atoi(optarg);
+            break;
+
+          default:
+            slbench_usage(argv[0]);
+            return opt == 'h' ? EXIT_SUCCESS : EXIT_FAILURE;
+        }
+    }
+
+  if (bench.frames <= 0 || bench.burst <= 0)
+    {
+      slbench_usage(argv[0]);
+      return EXIT_FAILURE;
+    }
+
+  if (slbench_openpty(&bench) < 0)
+    {
+      return EXIT_FAILURE;
+    }
+
+  bench.bytewise = true;
+  bytewise = slbench_run(&bench);
+  printf("byte-wise  %6d frames %9.3f ms %8.0f frames/s  %d errors\n",
+         bench.frames, bytewise * 1000,
+         bytewise > 0 ? bench.frames / bytewise : 0, bench.errors);
+
+  errors = bench.errors;
+  bench.bytewise = false;
+  buffered = slbench_run(&bench);
+  printf("buffered   %6d frames %9.3f ms %8.0f frames/s  %d errors\n",
+         bench.frames, buffered * 1000,
+         buffered > 0 ? bench.frames / buffered : 0, bench.errors);
+
+  errors += bench.errors;
+
+  close(bench.slave);
+  close(bench.master);
+
+  return bytewise > 0 && buffered > 0 && errors == 0 ?
+         EXIT_SUCCESS : EXIT_FAILURE;
+}
@@ -0,0 +1,600 @@
+/****************************************************************************
+ * apps/benchmarks/ymodem/ymodem_bench.c
+ *
+ * SPDX-License-Identifier: Apache-2.0
+ *
+ * Licensed to the Apache Software Foundation (ASF) under one or more
+ * contributor license agreements.  See the NOTICE file distributed with
+ * this work for additional information regarding copyright ownership.  The
+ * ASF licenses this file to you under the Apache License, Version 2.0 (the
+ * "License"); you may not use this file except in compliance with the
+ * License.  You may obtain a copy of the License at
+ *
+ *   http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS, WITHOUT
+ * WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.  See the
+ * License for the specific language governing permissions and limitations
+ * under the License.
+ *
+ ****************************************************************************/
+
+/****************************************************************************
+ * Included Files
+ ****************************************************************************/
+
+#include <nuttx/config.h>
+
+#include <errno.h>
+#include <inttypes.h>
+#include <fcntl.h>
+#include <limits.h>
+#include <poll.h>
+#include <pthread.h>
+#include <spawn.h>
+#include <stdbool.h>
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <sys/stat.h>
+#include <sys/wait.h>
+#include <termios.h>
+#include <time.h>
+#include <unistd.h>
+
+/****************************************************************************
+ * Pre-processor Definitions
+ ****************************************************************************/
+
+#define YMBENCH_DEFAULT_SIZE  256     /* KiB */
+#define YMBENCH_DEFAULT_DIR   "/tmp"
+#define YMBENCH_FILENAME      "ymbench.bin"
+#define YMBENCH_CHUNK         1024
+#define YMBENCH_QUEUE         16
+
+/****************************************************************************
+ * Private Types
+ ****************************************************************************/
+
+struct ymbench_pty_s
+{
+  int master;                  /* Relay side of the pty */
+  int slave;                   /* Kept open while sb or rb come and go */
+  char name[32];               /* Device given to sb or rb */
+};
+
+struct ymbench_chunk_s
+{
+  uint64_t due;                /* When it reaches the other side */
+  size_t len;
+  size_t off;                  /* Part already written */
+  uint8_t data[YMBENCH_CHUNK];
+};
+
+struct ymbench_dir_s
+{
+  int from;
+  int to;
+  unsigned int head;           /* Next chunk to read */
+  unsigned int tail;           /* Next chunk to write */
+  struct ymbench_chunk_s queue[YMBENCH_QUEUE];
+};
+
+struct ymbench_s
+{
+  struct ymbench_pty_s sb;     /* Line of the sender */
+  struct ymbench_pty_s rb;     /* Line of the receiver */
+  FAR const char *bindir;      /* Where sb and rb are, NULL to search */
+  size_t size;                 /* Bytes to send */
+  char src[PATH_MAX];          /* The generated file */
+  char dstdir[PATH_MAX - 16];  /* Where rb puts the copy */
+  char dst[PATH_MAX];          /* The copy */
+  uint32_t latency;            /* One way line latency in microseconds */
+  struct ymbench_dir_s dir[2]; /* Data on the line in both directions */
+  volatile bool stop;          /* Ends the relay */
+};
+
+/****************************************************************************
+ * Private Functions
+ ****************************************************************************/
+
+/****************************************************************************
+ * Name: ymbench_usage
+ ****************************************************************************/
+
+static void ymbench_usage(FAR const char *progname)
+{
+  fprintf(stderr, "usage: %s [-s kbytes] [-l usec] [-f dir] [-x bindir]\n",
+          progname);
+  fprintf(stderr, "  -s <n>    KiB sent through the pty [%d]\n",
+          YMBENCH_DEFAULT_SIZE);
+  fprintf(stderr, "  -l <n>    One way line latency in microseconds [0]"
+                  "\n");
+  fprintf(stderr, "  -f <dir>  Directory for the test files [%s]\n",
+          YMBENCH_DEFAULT_DIR);
+  fprintf(stderr, "  -x <dir>  Run sb and rb from dir instead of the "
+                  "builtin ones\n");
+}
+
+/****************************************************************************
+ * Name: ymbench_openpty
+ ****************************************************************************/
+
+static int ymbench_openpty(FAR struct ymbench_pty_s *pty)
+{
+  struct termios tio;
+
+  pty->master = posix_openpt(O_RDWR | O_NOCTTY);
+  if (pty->master < 0)
+    {
+      perror("posix_openpt");
+      return -1;
+    }
+
+  if (grantpt(pty->master) < 0 || unlockpt(pty->master) < 0 ||
+      ptsname_r(pty->master, pty->name, sizeof(pty->name)) != 0)
+    {
+      perror("pty setup");
+      close(pty->master);
+      return -1;
+    }
+
+  pty->slave = open(pty->name, O_RDWR | O_NOCTTY);
+  if (pty->slave < 0)
+    {
+      perror(pty->name);
+      close(pty->master);
+      return -1;
+    }
+
+  if (tcgetattr(pty->slave, &tio) == 0)
+    {
+      cfmakeraw(&tio);
+      tcsetattr(pty->slave, TCSANOW, &tio);
+    }
+
+  fcntl(pty->master, F_SETFL, O_NONBLOCK);
+  return 0;
+}
+
+/****************************************************************************
+ * Name: ymbench_pattern
+ *
+ * Description:
+ *   Fill buf with the bytes of the test file starting at offset, a pseudo
+ *   random sequence that includes every control character.
+ *
+ ****************************************************************************/
+
+static void ymbench_pattern(FAR uint8_t *buf, size_t offset, size_t len)
+{
+  size_t i;
+
+  for (i = 0; i < len; i++)
+    {
+      buf[i] = ((offset + i) * 2654435761u) >> 13;
+    }
+}
+
+/****************************************************************************
+ * Name: ymbench_mkfile
+ ****************************************************************************/
+
+static int ymbench_mkfile(FAR struct ymbench_s *bench)
+{
+  uint8_t buf[YMBENCH_CHUNK];
+  size_t offset;
+  size_t len;
+  int fd;
+
+  fd = open(bench->src, O_WRONLY | O_CREAT | O_TRUNC, 0644);
+  if (fd < 0)
+    {
+      perror(bench->src);
+      return -1;
+    }
+
+  for (offset = 0; offset < bench->size; offset += len)
+    {
+      len = bench->size - offset;
+      if (len > sizeof(buf))
+        {
+          len = sizeof(buf);
+        }
+
+      ymbench_pattern(buf, offset, len);
+      if (write(fd, buf, len) != (ssize_t)len)
+        {
+          perror(bench->src);
+          close(fd);
+          return -1;
+        }
+    }
+
+  close(fd);
+  return 0;
+}
+
+/****************************************************************************
+ * Name: ymbench_verify
+ *
+ * Description:
+ *   Check the copy written by rb against the pattern.
+ *
+ ****************************************************************************/
+
+static bool ymbench_verify(FAR struct ymbench_s *bench)
+{
+  uint8_t expect[YMBENCH_CHUNK];
+  uint8_t buf[YMBENCH_CHUNK];
+  size_t offset = 0;
+  ssize_t nread;
+  int fd;
+
+  fd = open(bench->dst, O_RDONLY);
+  if (fd < 0)
+    {
+      perror(bench->dst);
+      return false;
+    }
+
+  while ((nread = read(fd, buf, sizeof(buf))) > 0)
+    {
+      ymbench_pattern(expect, offset, nread);
+      if (offset + nread > bench->size ||
+          memcmp(buf, expect, nread) != 0)
+        {
+          break;
+        }
+
+      offset += nread;
+    }
+
+  close(fd);
+  return nread == 0 && offset == bench->size;
+}
+
+/****************************************************************************
+ * Name: ymbench_now
+ ****************************************************************************/
+
+static uint64_t ymbench_now(void)
+{
+  struct timespec ts;
+
+  clock_gettime(CLOCK_MONOTONIC, &ts);
+  return ts.tv_sec * 1000000ull + ts.tv_nsec / 1000;
+}
+
+/****************************************************************************
+ * Name: ymbench_deliver
+ *
+ * Description:
+ *   Write the chunks of one direction that have been on the line long
+ *   enough.  Returns the time in microseconds until the next one is due, or
+ *   -1 if there is none or the receiving side is behind.
+ *
+ ****************************************************************************/
+
+static int ymbench_deliver(FAR struct ymbench_dir_s *dir, uint64_t now)
+{
+  FAR struct ymbench_chunk_s *chunk;
+  ssize_t nwritten;
+
+  while (dir->tail != dir->head)
+    {
+      chunk = &dir->queue[dir->tail % YMBENCH_QUEUE];
+      if (chunk->due > now)
+        {
+          return chunk->due - now;
+        }
+
+      nwritten = write(dir->to, chunk->data + chunk->off,
+                       chunk->len - chunk->off);
+      if (nwritten < 0)
+        {
+          return -1;
+        }
+
+      chunk->off += nwritten;
+      if (chunk->off < chunk->len)
+        {
+          return -1;
+        }
+
+      dir->tail++;
+    }
+
+  return -1;
+}
+
+/****************************************************************************
+ * Name: ymbench_line
+ *
+ * Description:
+ *   The serial line, relays between the two ptys until told to stop.
+ *   Every chunk read is held back for the line latency before it is
+ *   written to the other side.
+ *
+ ****************************************************************************/
+
+static FAR void *ymbench_line(FAR void *arg)
+{
+  FAR struct ymbench_s *bench = arg;
+  FAR struct ymbench_chunk_s *chunk;
+  FAR struct ymbench_dir_s *dir;
+  struct pollfd fds[4];
+  uint64_t now;
+  int timeout;
+  ssize_t nread;
+  int nfds;
+  int due;
+  int i;
+
+  bench->dir[0].from = bench->sb.master;
+  bench->dir[0].to   = bench->rb.master;
+  bench->dir[1].from = bench->rb.master;
+  bench->dir[1].to   = bench->sb.master;
+
+  while (!bench->stop)
+    {
+      now = ymbench_now();
+      timeout = 100;
+      nfds = 0;
+
+      for (i = 0; i < 2; i++)
+        {
+          dir = &bench->dir[i];
+          due = ymbench_deliver(dir, now);
+          if (due >= 0 && due / 1000 < timeout)
+            {
+              timeout = due / 1000;
+            }
+          else if (due < 0 && dir->tail != dir->head)
+            {
+              fds[nfds].fd = dir->to;
+              fds[nfds++].events = POLLOUT;
+            }
+
+          if (dir->head - dir->tail < YMBENCH_QUEUE)
+            {
+              fds[nfds].fd = dir->from;
+              fds[nfds++].events = POLLIN;
+            }
+        }
+
+      for (i = 0; i < nfds; i++)
+        {
+          fds[i].revents = 0;
+        }
+
+      if (poll(fds, nfds, timeout) <= 0)
+        {
+          continue;
+        }
+
+      now = ymbench_now();
+      for (i = 0; i < 2; i++)
+        {
+          dir = &bench->dir[i];
+          if (dir->head - dir->tail == YMBENCH_QUEUE)
+            {
+              continue;
+            }
+
+          chunk = &dir->queue[dir->head % YMBENCH_QUEUE];
+          nread = read(dir->from, chunk->data, sizeof(chunk->data));
+          if (nread > 0)
+            {
+              chunk->len = nread;
+              chunk->off = 0;
+              chunk->due = now + bench->latency;
+              dir->head++;
+            }
+        }
+    }
+
+  return NULL;
+}
+
+/****************************************************************************
+ * Name: ymbench_spawn
+ ****************************************************************************/
+
+static pid_t ymbench_spawn(FAR struct ymbench_s *bench,
+                           FAR char *argv[])
+{
+  char path[PATH_MAX];
+  pid_t pid;
+  int ret;
+
+  if (bench->bindir != NULL)
+    {
+      snprintf(path, sizeof(path), "%s/%s", bench->bindir, argv[0]);
+      argv[0] = path;
+    }
+
+  ret = posix_spawnp(&pid, argv[0], NULL, NULL, argv, NULL);
+  if (ret != 0)
+    {
+      fprintf(stderr, "%s: %s\n", argv[0], strerror(ret));
+      return -1;
+    }
+
+  return pid;
+}
+
+/****************************************************************************
+ * Name: ymbench_wait
+ ****************************************************************************/
+
+static bool ymbench_wait(pid_t pid)
+{
+  int status;
+
+  if (pid < 0 || waitpid(pid, &status, 0) != pid)
+    {
+      return false;
+    }
+
+  return WIFEXITED(status) && WEXITSTATUS(status) == 0;
+}
+
+/****************************************************************************
+ * Name: ymbench_run
+ *
+ * Description:
+ *   Send the file from sb to rb, with YMODEM-G streaming or not.  Returns
+ *   the elapsed time in seconds, or a negative value on failure.
+ *
+ ****************************************************************************/
+
+static double ymbench_run(FAR struct ymbench_s *bench, bool streaming)
+{
+  FAR char *rbargv[7];
+  FAR char *sbargv[5];
+  struct timespec start;
+  struct timespec end;
+  pthread_t line;
+  pid_t sbpid;
+  pid_t rbpid;
+  bool ok;
+
+  unlink(bench->dst);
+
+  rbargv[0] = "rb";
+  rbargv[1] = "-d";
+  rbargv[2] = bench->rb.name;
+  rbargv[3] = "-f";
+  rbargv[4] = bench->dstdir;
+  rbargv[5] = streaming ? "-g" : NULL;
+  rbargv[6] = NULL;
+
+  sbargv[0] = "sb";
+  sbargv[1] = "-d";
+  sbargv[2] = bench->sb.name;
+  sbargv[3] = bench->src;
+  sbargv[4] = NULL;
+
+  bench->dir[0].head = bench->dir[0].tail = 0;
+  bench->dir[1].head = bench->dir[1].tail = 0;
+  bench->stop = false;
+  if (pthread_create(&line, NULL, ymbench_line, bench) != 0)
+    {
+      return -1;
+    }
+
+  clock_gettime(CLOCK_MONOTONIC, &start);
+
+  rbpid = ymbench_spawn(bench, rbargv);
+  sbpid = ymbench_spawn(bench, sbargv);
+  ok = ymbench_wait(sbpid);
+  ok = ymbench_wait(rbpid) && ok;
+
+  clock_gettime(CLOCK_MONOTONIC, &end);
+
+  bench->stop = true;
+  pthread_join(line, NULL);
+
+  if (!ok || !ymbench_verify(bench))
+    {
+      return -1;
+    }
+
+  return (end.tv_sec - start.tv_sec) +
+         (end.tv_nsec - start.tv_nsec) / 1e9;
+}
+
+/****************************************************************************
+ * Public Functions
+ ****************************************************************************/
+
+int main(int argc, FAR char *argv[])
+{
+  FAR const char *dir = YMBENCH_DEFAULT_DIR;
+  FAR struct ymbench_s *bench;
+  double acked;
+  double streamed;
+  int opt;
+
+  bench = calloc(1, sizeof(*bench));
+  if (bench == NULL)
+    {
+      return EXIT_FAILURE;
+    }
+
+  bench->size = YMBENCH_DEFAULT_SIZE * 1024;
+
+  while ((opt = getopt(argc, argv, "s:l:f:x:h")) != ERROR)
+    {
+      switch (opt)
+        {
+          case 's':
+            bench->size = atoi(optarg) * 1024;
+            break;
+
+          case 'l':
+            bench->latency = atoi(optarg);
+            break;
+
+          case 'f':
+            dir = optarg;
+            break;
+
+          case 'x':
+            bench->bindir = optarg;
+            break;
+
+          default:
+            ymbench_usage(argv[0]);
+            free(bench);
+            return opt == 'h' ? EXIT_SUCCESS : EXIT_FAILURE;
+        }
+    }
+
+  if (bench->size == 0)
+    {
+      ymbench_usage(argv[0]);
+      free(bench);
+      return EXIT_FAILURE;
+    }
+
+  snprintf(bench->src, sizeof(bench->src), "%s/" YMBENCH_FILENAME, dir);
+  snprintf(bench->dstdir, sizeof(bench->dstdir), "%s/ymbench", dir);
+  snprintf(bench->dst, sizeof(bench->dst), "%s/" YMBENCH_FILENAME,
+           bench->dstdir);
+  mkdir(bench->dstdir, 0755);
+
+  if (ymbench_mkfile(bench) < 0 || ymbench_openpty(&bench->sb) < 0 ||
+      ymbench_openpty(&bench->rb) < 0)
+    {
+      free(bench);
+      return EXIT_FAILURE;
+    }
+
+  acked = ymbench_run(bench, false);
+  printf("line latency %" PRIu32 " us\n", bench->latency);
+  printf("ACK per packet  %8zu bytes %9.3f ms %8.0f KiB/s%s\n",
+         bench->size, acked * 1000,
+         acked > 0 ? bench->size / acked / 1024 : 0,
+         acked > 0 ? "" : "  FAILED");
+
+  streamed = ymbench_run(bench, true);
+  printf("YMODEM-G        %8zu bytes %9.3f ms %8.0f KiB/s%s\n",
+         bench->size, streamed * 1000,
+         streamed > 0 ? bench->size / streamed / 1024 : 0,
+         streamed > 0 ? "" : "  FAILED");
+
+  close(bench->sb.slave);
+  close(bench->sb.master);
+  close(bench->rb.slave);
+  close(bench->rb.master);
+  unlink(bench->dst);
+  rmdir(bench->dstdir);
+  unlink(bench->src);
+  free(bench);
+
+  return acked > 0 && streamed > 0 ? EXIT_SUCCESS : EXIT_FAILURE;
+}
@@ -68,6 +68,27 @@
 
 #define NXBOOT_HEADER_PRERELEASE_MAXLEN 94
 
+#define NXBOOT_DELTA_MAGIC      0x4c44584e /* NXDL. Extended header of a
+                                            * delta update package, see
+                                            * struct nxboot_delta_header.
+                                            */
+
+/* Operations of a delta package block. Every operation starts with its
+ * code and a LEB128 encoded length n, followed by:
+ *
+ *   NXBOOT_DELTA_OP_LITERAL: n bytes of data
+ *   NXBOOT_DELTA_OP_BASE:    LEB128 offset of n bytes in the base image
+ *                            slot (header included) to be copied
+ *   NXBOOT_DELTA_OP_SELF:    LEB128 distance back in the output of this
+ *                            block to copy n bytes from (may overlap)
+ *   NXBOOT_DELTA_OP_FILL:    one byte repeated n times
+ */
+
+#define NXBOOT_DELTA_OP_LITERAL 0x01
+#define NXBOOT_DELTA_OP_BASE    0x02
+#define NXBOOT_DELTA_OP_SELF    0x03
+#define NXBOOT_DELTA_OP_FILL    0x04
+
 /****************************************************************************
  * Public Types
  ****************************************************************************/
@@ -120,6 +141,27 @@ struct nxboot_img_header
   struct nxboot_img_version img_version; /* Image version */
 };
 
+/* A delta update package carries the header of the resulting image, with
+ * extd_hdr_ptr pointing to this structure inside the header area, and
+ * a payload instead of the image. The payload follows the header and
+ * holds one block per block_size bytes of the resulting image (header
+ * included): a little endian uint32_t length and the operations that
+ * produce the image bytes of that block past the header. Every block is
+ * self-contained, so the installation can be resumed at any block.
+ */
+
+struct nxboot_delta_header
+{
+  uint32_t magic;           /* NXBOOT_DELTA_MAGIC */
+  uint32_t crc;             /* CRC32 of the package from the end of the
+                             * image header crc field up to the end of the
+                             * payload, calculated with this field zeroed.
+                             */
+  uint32_t base_crc;        /* crc of the image the delta applies to */
+  uint32_t size;            /* Size of the payload */
+  uint32_t block_size;      /* Image bytes produced by one payload block */
+};
+
 static_assert(CONFIG_NXBOOT_HEADER_SIZE > sizeof(struct nxboot_img_header),
               "CONFIG_NXBOOT_HEADER_SIZE has to be larger than"
               "sizeof(struct nxboot_img_header)");
@@ -162,6 +204,7 @@ enum progress_msg_e
   recovery_created,
   recovery_invalid,
   update_failed,
+  update_from_delta,
 };
 
 /****************************************************************************
@@ -32,10 +32,12 @@
 #include <syslog.h>
 #include <sys/param.h>
 
-#include <nuttx/crc32.h>
 #include <nxboot.h>
 
+#include "crc.h"
+#include "delta.h"
 #include "flash.h"
+#include "verify.h"
 
 /****************************************************************************
  * Pre-processor Definitions
@@ -71,76 +73,113 @@ static inline bool validate_image_header(struct nxboot_img_header *header)
          header->identifier == CONFIG_NXBOOT_PLATFORM_IDENTIFIER;
 }
 
-static uint32_t calculate_crc(int fd, struct nxboot_img_header *header)
+static int calculate_crc(int fd, off_t end, off_t zero, uint32_t *crc)
 {
-  char *buf;
-  int remain;
+  uint8_t *buf;
+  int bufsize;
+  int skip;
   int readsiz;
+  int i;
   off_t off;
-  uint32_t crc;
+  uint32_t value;
   struct flash_partition_info info;
 #ifdef CONFIG_NXBOOT_PRINTF_PROGRESS_PERCENT
-  int total_size;
-#endif  
+  int percent;
+  int last_percent = -1;
+#else
+  unsigned int chunks = 0;
+#endif
 
   if (flash_partition_info(fd, &info) < 0)
     {
-      return false;
+      return ERROR;
     }
 
-  buf = malloc(info.blocksize);
+  /* Read in large chunks that start on a block boundary. The chunk size
+   * is a multiple of the block size, so every read stays aligned.
+   */
+
+  bufsize = (CONFIG_NXBOOT_CRC_BUFSIZE + info.blocksize - 1) /
+            info.blocksize * info.blocksize;
+
+  buf = malloc(bufsize);
   if (!buf)
     {
-      return false;
+      return ERROR;
     }
 
-  crc = 0xffffffff;
-  off = offsetof(struct nxboot_img_header, crc) + sizeof crc;
-  remain = header->size + header->header_size - off;
-#ifdef CONFIG_NXBOOT_PRINTF_PROGRESS_PERCENT
-  total_size = remain;
-#endif
-  while (remain > 0)
+  /* The checksum starts right after the crc field of the header. */
+
+  skip = offsetof(struct nxboot_img_header, crc) + sizeof(uint32_t);
+  if (end <= skip || end > info.size)
     {
-      readsiz = remain > info.blocksize ? info.blocksize : remain;
+      free(buf);
+      return ERROR;
+    }
+
+  value = 0xffffffff;
+  off = 0;
+  while (off < end)
+    {
+      readsiz = end - off > bufsize ? bufsize : end - off;
       if (flash_partition_read(fd, buf, readsiz, off) != 0)
         {
           free(buf);
-          return 0xffffffff;
+          return ERROR;
         }
 
-      off += readsiz;
-      remain -= readsiz;
-      crc = crc32part((uint8_t *)buf, readsiz, crc);
-      if ((remain % 25) == 0)
+      /* A field that holds a checksum is calculated as zeros. */
+
+      for (i = 0; zero != 0 && i < (int)sizeof(uint32_t); i++)
         {
+          if (zero + i >= off && zero + i < off + readsiz)
+            {
+              buf[zero + i - off] = 0;
+            }
+        }
+
+      value = crc_update(buf + skip, readsiz - skip, value);
+      skip = 0;
+      off += readsiz;
+
 #ifdef CONFIG_NXBOOT_PRINTF_PROGRESS_PERCENT
-          nxboot_progress(nxboot_progress_percent,
-                          ((total_size - remain) * 100) / total_size);
+      percent = (off * 100) / end;
+      if (percent != last_percent)
+        {
+          nxboot_progress(nxboot_progress_percent, percent);
+          last_percent = percent;
+        }
 #else
+      if ((++chunks % 16) == 0)
+        {
           nxboot_progress(nxboot_progress_dot);
-#endif
         }
+#endif
     }
 
   free(buf);
-  return ~crc;
+  *crc = ~value;
+  return OK;
 }
 
-static int copy_partition(int from, int where, struct nxboot_state *state,
-                          bool update)
+static int copy_partition(int from, int where, int where_slot,
+                          struct nxboot_state *state, bool update,
+                          bool headless)
 {
   struct nxboot_img_header header;
   struct flash_partition_info info_from;
   struct flash_partition_info info_where;
   uint32_t magic;
   int readsiz;
-  int remain;
-  int blocksize;
+  int chunk;
+  int written;
+  int ret;
   off_t off;
+  off_t end;
   char *buf;
-#ifdef CONFIG_NXBOOT_PRINTF_PROGRESS_PERCENT  
-  int total_size;
+#ifdef CONFIG_NXBOOT_PRINTF_PROGRESS_PERCENT
+  int percent;
+  int last_percent = -1;
 #endif
 
   get_image_header(from, &header);
@@ -155,23 +194,37 @@ static int copy_partition(int from, int where, struct nxboot_state *state,
       return ERROR;
     }
 
-  remain = header.size + header.header_size;
-  if (remain > info_where.size)
+  end = header.size + header.header_size;
+  if (end > info_where.size)
     {
       return ERROR;
     }
 
-#ifdef CONFIG_NXBOOT_PRINTF_PROGRESS_PERCENT
-  total_size = remain;
-#endif
-  blocksize = info_where.blocksize;
+  /* The target slot no longer holds the verified image from now on. */
 
-  buf = malloc(blocksize);
-  if (!buf)
+  if (verify_cache_invalidate(where_slot) < 0)
     {
       return ERROR;
     }
 
+  /* Copy whole erase blocks, so that each of them is erased and written
+   * (or skipped if unchanged) at once. The second half of the buffer
+   * holds the current content of the target for the comparison. Fall
+   * back to write blocks if there is not enough memory.
+   */
+
+  chunk = info_where.erasesize;
+  buf = malloc(2 * chunk);
+  if (!buf)
+    {
+      chunk = info_where.blocksize;
+      buf = malloc(2 * chunk);
+      if (!buf)
+        {
+          return ERROR;
+        }
+    }
+
   /* Flip header's magic. We go from standard to internal in case of
    * image update and from internal to standard in case of recovery
    * creation or revert operation.
@@ -189,58 +242,67 @@ static int copy_partition(int from, int where, struct nxboot_state *state,
       magic |= state->update;
     }
 
-  if (flash_partition_read(from, buf, blocksize, 0) < 0)
-    {
-      free(buf);
-      return ERROR;
-    }
+  /* A headless copy leaves the first erase block of the target alone. */
 
-  memcpy(buf + offsetof(struct nxboot_img_header, magic), &magic,
-          sizeof magic);
-  if (flash_partition_write(where, buf, blocksize, 0) < 0)
-    {
-      free(buf);
-      return ERROR;
-    }
+  off = headless ? info_where.erasesize : 0;
+  written = 0;
 
-  off = blocksize;
-  remain -= blocksize;
-
-  while (remain > 0)
+  while (off < end)
     {
-      readsiz = remain > blocksize ? blocksize : remain;
+      readsiz = end - off > chunk ? chunk : end - off;
       if (flash_partition_read(from, buf, readsiz, off) < 0)
         {
           free(buf);
           return ERROR;
         }
 
-      if (flash_partition_write(where, buf, readsiz, off) < 0)
+      if (off == 0)
+        {
+          memcpy(buf + offsetof(struct nxboot_img_header, magic), &magic,
+                 sizeof magic);
+        }
+
+      ret = flash_partition_write_changed(where, buf, buf + chunk, readsiz,
+                                          off);
+      if (ret < 0)
         {
           free(buf);
           return ERROR;
         }
 
+      written += ret > 0 ? readsiz : 0;
       off += readsiz;
-      remain -= readsiz;
-      if ((remain % 25) == 0)
-        {
+
 #ifdef CONFIG_NXBOOT_PRINTF_PROGRESS_PERCENT
-          nxboot_progress(nxboot_progress_percent,
-                          100 - ((100 * remain) / total_size));
+      percent = (off * 100) / end;
+      if (percent != last_percent)
+        {
+          nxboot_progress(nxboot_progress_percent, percent);
+          last_percent = percent;
+        }
 #else
+      if (((off / chunk) % 16) == 0)
+        {
           nxboot_progress(nxboot_progress_dot);
-#endif
         }
+#endif
     }
 
+  syslog(LOG_INFO, "Image copied, %d of %d bytes written.\n",
+         written, (int)end);
+
   free(buf);
   return OK;
 }
 
-static bool validate_image(int fd)
+static bool validate_image(int fd, int slot)
 {
   struct nxboot_img_header header;
+#ifdef CONFIG_NXBOOT_DELTA
+  struct nxboot_delta_header delta;
+#endif
+  uint32_t generation;
+  uint32_t crc;
 
   get_image_header(fd, &header);
   if (!validate_image_header(&header))
@@ -248,8 +310,34 @@ static bool validate_image(int fd)
       return false;
     }
 
+#ifdef CONFIG_NXBOOT_DELTA
+  if (delta_get_header(fd, &header, &delta))
+    {
+      /* Packages are small and short lived, they are always checked. */
+
+      syslog(LOG_INFO, "Validating delta package.\n");
+      return calculate_crc(fd, header.header_size + delta.size,
+                           header.extd_hdr_ptr +
+                           offsetof(struct nxboot_delta_header, crc),
+                           &crc) == 0 && crc == delta.crc;
+    }
+#endif
+
+  if (verify_cache_lookup(slot, &header, &generation))
+    {
+      syslog(LOG_INFO, "Image already verified.\n");
+      return true;
+    }
+
   syslog(LOG_INFO, "Validating image.\n");
-  return calculate_crc(fd, &header) == header.crc;
+  if (calculate_crc(fd, header.header_size + header.size, 0, &crc) < 0 ||
+      crc != header.crc)
+    {
+      return false;
+    }
+
+  verify_cache_store(slot, &header, generation);
+  return true;
 }
 
 static bool compare_versions(struct nxboot_img_version *v1,
@@ -300,11 +388,12 @@ static enum nxboot_update_type
                   struct nxboot_img_header *recovery_header)
 {
   nxboot_progress(nxboot_progress_start, validate_primary);
-  bool primary_valid = validate_image(primary);
+  bool primary_valid = validate_image(primary, NXBOOT_PRIMARY_SLOT_NUM);
   nxboot_progress(nxboot_progress_end);
 
   nxboot_progress(nxboot_progress_start, validate_update);
-  if (update_header->magic == NXBOOT_HEADER_MAGIC && validate_image(update))
+  if (update_header->magic == NXBOOT_HEADER_MAGIC &&
+      validate_image(update, state->update))
     {
       if (primary_header->crc != update_header->crc ||
           !compare_versions(&primary_header->img_version,
@@ -314,7 +403,10 @@ static enum nxboot_update_type
           return NXBOOT_UPDATE_TYPE_UPDATE;
         }
 
-        flash_partition_erase_first_sector(update);
+      if (verify_cache_invalidate(state->update) >= 0)
+        {
+          flash_partition_erase_first_sector(update);
+        }
     }
 
   nxboot_progress(nxboot_progress_end);
@@ -329,6 +421,94 @@ static enum nxboot_update_type
   return NXBOOT_UPDATE_TYPE_NONE;
 }
 
+#ifdef CONFIG_NXBOOT_DELTA
+static int install_delta(struct nxboot_state *state, int primary,
+                         int update, int recovery)
+{
+  struct nxboot_img_header header;
+  struct nxboot_img_header recovery_header;
+  struct nxboot_delta_header delta;
+  uint32_t magic;
+  int ret;
+
+  get_image_header(update, &header);
+  if (!delta_get_header(update, &header, &delta))
+    {
+      return -ENOTSUP;
+    }
+
+  /* The delta is applied against the recovery, which is a copy of the
+   * primary image made just before. Unlike the primary, it is not touched
+   * during the installation, so an interrupted installation can always
+   * continue.
+   */
+
+  get_image_header(recovery, &recovery_header);
+  if (recovery_header.crc != delta.base_crc ||
+      !validate_image(recovery, state->recovery))
+    {
+      syslog(LOG_ERR, "Delta package does not match the recovery.\n");
+      nxboot_progress(nxboot_error, update_failed);
+      if (verify_cache_invalidate(state->update) >= 0)
+        {
+          flash_partition_erase_first_sector(update);
+        }
+
+      return ERROR;
+    }
+
+  syslog(LOG_INFO, "Updating from delta package.\n");
+  nxboot_progress(nxboot_progress_start, update_from_delta);
+
+  magic = NXBOOT_HEADER_MAGIC_INT | state->update;
+  ret = verify_cache_invalidate(NXBOOT_PRIMARY_SLOT_NUM);
+  if (ret >= 0)
+    {
+      ret = delta_apply(update, recovery, primary, &header, &delta, magic);
+    }
+
+  nxboot_progress(nxboot_progress_end);
+
+  if (ret < 0 || !validate_image(primary, NXBOOT_PRIMARY_SLOT_NUM))
+    {
+      /* The package is broken, do not try again and bring the previous
+       * image back.
+       */
+
+      syslog(LOG_ERR, "Delta update failed, reverting.\n");
+      nxboot_progress(nxboot_error, update_failed);
+      if (verify_cache_invalidate(state->update) >= 0)
+        {
+          flash_partition_erase_first_sector(update);
+        }
+
+      nxboot_progress(nxboot_progress_start, recovery_revert);
+      copy_partition(recovery, primary, NXBOOT_PRIMARY_SLOT_NUM, state,
+                     false, false);
+      flash_partition_flush(primary);
+      nxboot_progress(nxboot_progress_end);
+      return ERROR;
+    }
+
+  /* Turn the update slot into what a full update would leave there: the
+   * new image without its first erase block, which nxboot_confirm()
+   * writes once the image is confirmed.
+   */
+
+  if (verify_cache_invalidate(state->update) < 0 ||
+      flash_partition_erase_first_sector(update) < 0)
+    {
+      return ERROR;
+    }
+
+  nxboot_progress(nxboot_progress_start, recovery_create);
+  ret = copy_partition(primary, update, state->update, state, false, true);
+  flash_partition_flush(update);
+  nxboot_progress(nxboot_progress_end);
+  return ret;
+}
+#endif
+
 static int perform_update(struct nxboot_state *state, bool check_only)
 {
   int successful;
@@ -373,14 +553,15 @@ static int perform_update(struct nxboot_state *state, bool check_only)
 
   nxboot_progress(nxboot_progress_start, validate_primary);
   if (state->next_boot == NXBOOT_UPDATE_TYPE_REVERT &&
-      (!check_only || !validate_image(primary)))
+      (!check_only || !validate_image(primary, NXBOOT_PRIMARY_SLOT_NUM)))
     {
       nxboot_progress(nxboot_progress_end);
       if (state->recovery_valid)
         {
           syslog(LOG_INFO, "Reverting image to recovery.\n");
           nxboot_progress(nxboot_progress_start, recovery_revert);
-          copy_partition(recovery, primary, state, false);
+          copy_partition(recovery, primary, NXBOOT_PRIMARY_SLOT_NUM,
+                         state, false, false);
           nxboot_progress(nxboot_progress_end);
         }
     }
@@ -388,7 +569,7 @@ static int perform_update(struct nxboot_state *state, bool check_only)
     {
       nxboot_progress(nxboot_progress_end);
       nxboot_progress(nxboot_progress_start, validate_primary);
-      primary_valid = validate_image(primary);
+      primary_valid = validate_image(primary, NXBOOT_PRIMARY_SLOT_NUM);
       nxboot_progress(nxboot_progress_end);
       if (primary_valid && check_only)
         {
@@ -416,11 +597,12 @@ static int perform_update(struct nxboot_state *state, bool check_only)
 
           syslog(LOG_INFO, "Creating recovery image.\n");
           nxboot_progress(nxboot_progress_start, recovery_create);
-          copy_partition(primary, recovery, state, false);
+          copy_partition(primary, recovery, state->recovery, state, false,
+                         false);
           flash_partition_flush(recovery);
           nxboot_progress(nxboot_progress_end);
           nxboot_progress(nxboot_progress_start, validate_recovery);
-          successful = validate_image(recovery);
+          successful = validate_image(recovery, state->recovery);
           nxboot_progress(nxboot_progress_end);
           if (!successful)
             {
@@ -435,15 +617,23 @@ static int perform_update(struct nxboot_state *state, bool check_only)
         }
 
       nxboot_progress(nxboot_progress_start, validate_update);
-      successful = validate_image(update);
+      successful = validate_image(update, state->update);
       nxboot_progress(nxboot_progress_end);
       if (successful)
         {
           /* Perform update only if update slot contains valid image. */
 
+#ifdef CONFIG_NXBOOT_DELTA
+          if (install_delta(state, primary, update, recovery) != -ENOTSUP)
+            {
+              goto perform_update_done;
+            }
+#endif
+
           syslog(LOG_INFO, "Updating from update image.\n");
           nxboot_progress(nxboot_progress_start, update_from_update);
-          if (copy_partition(update, primary, state, true) >= 0)
+          if (copy_partition(update, primary, NXBOOT_PRIMARY_SLOT_NUM,
+                             state, true, false) >= 0)
             {
               flash_partition_flush(primary);
 
@@ -453,7 +643,10 @@ static int perform_update(struct nxboot_state *state, bool check_only)
                * confirmation.
                */
 
-              flash_partition_erase_first_sector(update);
+              if (verify_cache_invalidate(state->update) >= 0)
+                {
+                  flash_partition_erase_first_sector(update);
+                }
             }
 
           nxboot_progress(nxboot_progress_end);
@@ -633,7 +826,7 @@ int nxboot_get_state(struct nxboot_state *state)
     }
 
   nxboot_progress(nxboot_progress_start, validate_recovery);
-  state->recovery_valid = validate_image(recovery);
+  state->recovery_valid = validate_image(recovery, state->recovery);
   nxboot_progress(nxboot_progress_end);
   state->recovery_present = primary_header.crc == recovery_header->crc;
 
@@ -696,6 +889,13 @@ int nxboot_open_update_partition(void)
   path = state.update == NXBOOT_SECONDARY_SLOT_NUM ?
     CONFIG_NXBOOT_SECONDARY_SLOT_PATH : CONFIG_NXBOOT_TERTIARY_SLOT_PATH;
 
+  /* The caller is going to write a new image to the slot. */
+
+  if (verify_cache_invalidate(state.update) < 0)
+    {
+      return ERROR;
+    }
+
   return flash_partition_open(path);
 }
 
@@ -825,6 +1025,12 @@ int nxboot_confirm(void)
       goto confirm_done;
     }
 
+  if (verify_cache_invalidate(state.update) < 0)
+    {
+      ret = ERROR;
+      goto confirm_done;
+    }
+
   /* Write by write pages to avoid large array buffering. */
 
   buf = malloc(info_update.blocksize);
@@ -921,7 +1127,7 @@ int nxboot_perform_update(bool check_only)
       return ERROR;
     }
 
-  if (!validate_image(primary))
+  if (!validate_image(primary, NXBOOT_PRIMARY_SLOT_NUM))
     {
       ret = ERROR;
     }
@@ -0,0 +1,148 @@
+/****************************************************************************
+ * apps/boot/nxboot/loader/crc.c
+ *
+ * SPDX-License-Identifier: Apache-2.0
+ *
+ * Licensed to the Apache Software Foundation (ASF) under one or more
+ * contributor license agreements.  See the NOTICE file distributed with
+ * this work for additional information regarding copyright ownership.  The
+ * ASF licenses this file to you under the Apache License, Version 2.0 (the
+ * "License"); you may not use this file except in compliance with the
+ * License.  You may obtain a copy of the License at
+ *
+ *   http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS, WITHOUT
+ * WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.  See the
+ * License for the specific language governing permissions and limitations
+ * under the License.
+ *
+ ****************************************************************************/
+
+/****************************************************************************
+ * Included Files
+ ****************************************************************************/
+
+#include <nuttx/config.h>
+
+#include <stdbool.h>
+#include <stdint.h>
+#include <stddef.h>
+
+#include "crc.h"
+
+/****************************************************************************
+ * Pre-processor Definitions
+ ****************************************************************************/
+
+#define CRC_POLYNOMIAL 0xedb88320
+
+/* Little endian load that is independent on the alignment of the source
+ * and on the byte order of the CPU.
+ */
+
+#define CRC_LOAD32(p) ((uint32_t)(p)[0] | ((uint32_t)(p)[1] << 8) | \
+                       ((uint32_t)(p)[2] << 16) | ((uint32_t)(p)[3] << 24))
+
+/****************************************************************************
+ * Private Data
+ ****************************************************************************/
+
+/* g_crc_table[0] is the ordinary byte wise table, g_crc_table[n] advances
+ * the CRC of a byte followed by n zero bytes.
+ */
+
+static uint32_t g_crc_table[8][256];
+static bool g_crc_table_ready;
+
+/****************************************************************************
+ * Private Functions
+ ****************************************************************************/
+
+static void crc_table_init(void)
+{
+  uint32_t crc;
+  int i;
+  int j;
+
+  for (i = 0; i < 256; i++)
+    {
+      crc = i;
+      for (j = 0; j < 8; j++)
+        {
+          crc = (crc & 1) ? (crc >> 1) ^ CRC_POLYNOMIAL : crc >> 1;
+        }
+
+      g_crc_table[0][i] = crc;
+    }
+
+  for (i = 0; i < 256; i++)
+    {
+      crc = g_crc_table[0][i];
+      for (j = 1; j < 8; j++)
+        {
+          crc = g_crc_table[0][crc & 0xff] ^ (crc >> 8);
+          g_crc_table[j][i] = crc;
+        }
+    }
+
+  g_crc_table_ready = true;
+}
+
+/****************************************************************************
+ * Public Functions
+ ****************************************************************************/
+
+/****************************************************************************
+ * Name: crc_update
+ *
+ * Description:
+ *   Continues the CRC32 (IEEE 802.3, reflected) calculation over len bytes
+ *   at src, eight bytes per step.
+ *
+ * Input parameters:
+ *   src: The data to be added to the checksum.
+ *   len: Number of bytes.
+ *   crc: The running CRC32 value.
+ *
+ * Returned Value:
+ *   The updated CRC32 value.
+ *
+ ****************************************************************************/
+
+uint32_t crc_update(const uint8_t *src, size_t len, uint32_t crc)
+{
+  uint32_t lo;
+  uint32_t hi;
+
+  if (!g_crc_table_ready)
+    {
+      crc_table_init();
+    }
+
+  while (len >= 8)
+    {
+      lo = crc ^ CRC_LOAD32(src);
+      hi = CRC_LOAD32(src + 4);
+
+      crc = g_crc_table[7][lo & 0xff] ^
+            g_crc_table[6][(lo >> 8) & 0xff] ^
+            g_crc_table[5][(lo >> 16) & 0xff] ^
+            g_crc_table[4][lo >> 24] ^
+            g_crc_table[3][hi & 0xff] ^
+            g_crc_table[2][(hi >> 8) & 0xff] ^
+            g_crc_table[1][(hi >> 16) & 0xff] ^
+            g_crc_table[0][hi >> 24];
+
+      src += 8;
+      len -= 8;
+    }
+
+  while (len-- > 0)
+    {
+      crc = g_crc_table[0][(crc ^ *src++) & 0xff] ^ (crc >> 8);
+    }
+
+  return crc;
+}
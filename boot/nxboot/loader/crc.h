@@ -0,0 +1,67 @@
+/****************************************************************************
+ * apps/boot/nxboot/loader/crc.h
+ *
+ * SPDX-License-Identifier: Apache-2.0
+ *
+ * Licensed to the Apache Software Foundation (ASF) under one or more
+ * contributor license agreements.  See the NOTICE file distributed with
+ * this work for additional information regarding copyright ownership.  The
+ * ASF licenses this file to you under the Apache License, Version 2.0 (the
+ * "License"); you may not use this file except in compliance with the
+ * License.  You may obtain a copy of the License at
+ *
+ *   http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS, WITHOUT
+ * WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.  See the
+ * License for the specific language governing permissions and limitations
+ * under the License.
+ *
+ ****************************************************************************/
+
+#ifndef __BOOT_NXBOOT_LOADER_CRC_H
+#define __BOOT_NXBOOT_LOADER_CRC_H
+
+/****************************************************************************
+ * Included Files
+ ****************************************************************************/
+
+#include <nuttx/config.h>
+
+#include <stdint.h>
+#include <stddef.h>
+
+#ifndef CONFIG_NXBOOT_CRC_SLICE8
+#  include <nuttx/crc32.h>
+#endif
+
+/****************************************************************************
+ * Public Functions Prototypes
+ ****************************************************************************/
+
+/****************************************************************************
+ * Name: crc_update
+ *
+ * Description:
+ *   Continues the CRC32 (IEEE 802.3, reflected) calculation over len bytes
+ *   at src. The semantics are the same as crc32part(): the initial value
+ *   and the final inversion are up to the caller.
+ *
+ * Input parameters:
+ *   src: The data to be added to the checksum.
+ *   len: Number of bytes.
+ *   crc: The running CRC32 value.
+ *
+ * Returned Value:
+ *   The updated CRC32 value.
+ *
+ ****************************************************************************/
+
+#ifdef CONFIG_NXBOOT_CRC_SLICE8
+uint32_t crc_update(const uint8_t *src, size_t len, uint32_t crc);
+#else
+#  define crc_update(src, len, crc) crc32part(src, len, crc)
+#endif
+
+#endif /* __BOOT_NXBOOT_LOADER_CRC_H */
@@ -0,0 +1,455 @@
+/****************************************************************************
+ * apps/boot/nxboot/loader/delta.c
+ *
+ * SPDX-License-Identifier: Apache-2.0
+ *
+ * Licensed to the Apache Software Foundation (ASF) under one or more
+ * contributor license agreements.  See the NOTICE file distributed with
+ * this work for additional information regarding copyright ownership.  The
+ * ASF licenses this file to you under the Apache License, Version 2.0 (the
+ * "License"); you may not use this file except in compliance with the
+ * License.  You may obtain a copy of the License at
+ *
+ *   http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS, WITHOUT
+ * WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.  See the
+ * License for the specific language governing permissions and limitations
+ * under the License.
+ *
+ ****************************************************************************/
+
+/****************************************************************************
+ * Included Files
+ ****************************************************************************/
+
+#include <nuttx/config.h>
+
+#include <inttypes.h>
+#include <stdbool.h>
+#include <stddef.h>
+#include <stdint.h>
+#include <stdlib.h>
+#include <string.h>
+#include <syslog.h>
+#include <sys/param.h>
+
+#include <nxboot.h>
+
+#include "crc.h"
+#include "delta.h"
+#include "flash.h"
+
+/****************************************************************************
+ * Pre-processor Definitions
+ ****************************************************************************/
+
+#define DELTA_PROGRESS_MAGIC 0x5044584e /* NXDP */
+
+/* Largest encoded block accepted. An incompressible block is stored as a
+ * single literal, which costs six bytes more than the block itself.
+ */
+
+#define DELTA_OPS_SIZE(bsize) ((bsize) + ((bsize) >> 3) + 16)
+
+/****************************************************************************
+ * Private Types
+ ****************************************************************************/
+
+struct delta_progress_s
+{
+  uint32_t magic;    /* DELTA_PROGRESS_MAGIC */
+  uint32_t crc;      /* crc of the package being installed */
+  uint32_t block;    /* Next block to be installed */
+  uint32_t offset;   /* Package offset of that block */
+  uint32_t check;    /* CRC32 of the fields above */
+};
+
+/****************************************************************************
+ * Private Functions
+ ****************************************************************************/
+
+static uint32_t delta_progress_check(const struct delta_progress_s *rec)
+{
+  return ~crc_update((const uint8_t *)rec,
+                     offsetof(struct delta_progress_s, check), 0xffffffff);
+}
+
+static bool delta_progress_read(int fd, off_t off,
+                                const struct nxboot_delta_header *delta,
+                                struct delta_progress_s *rec)
+{
+  if (flash_partition_read(fd, rec, sizeof(*rec), off) < 0)
+    {
+      return false;
+    }
+
+  return rec->magic == DELTA_PROGRESS_MAGIC && rec->crc == delta->crc &&
+         rec->check == delta_progress_check(rec);
+}
+
+static int delta_progress_write(int fd, off_t off,
+                                const struct nxboot_delta_header *delta,
+                                uint32_t block, uint32_t offset)
+{
+  struct delta_progress_s rec;
+
+  memset(&rec, 0, sizeof(rec));
+  if (delta != NULL)
+    {
+      rec.magic = DELTA_PROGRESS_MAGIC;
+      rec.crc = delta->crc;
+      rec.block = block;
+      rec.offset = offset;
+      rec.check = delta_progress_check(&rec);
+    }
+
+  if (flash_partition_write(fd, &rec, sizeof(rec), off) < 0)
+    {
+      return ERROR;
+    }
+
+  return flash_partition_flush(fd);
+}
+
+static int delta_varint(const uint8_t **op, const uint8_t *end,
+                        uint32_t *value)
+{
+  uint32_t result = 0;
+  int shift;
+
+  for (shift = 0; *op < end && shift < 32; shift += 7)
+    {
+      result |= (uint32_t)(**op & 0x7f) << shift;
+      if ((*(*op)++ & 0x80) == 0)
+        {
+          *value = result;
+          return OK;
+        }
+    }
+
+  return ERROR;
+}
+
+/****************************************************************************
+ * Name: delta_decode
+ *
+ * Description:
+ *   Runs the operations of one block. They have to fill out from pos up
+ *   to len exactly.
+ *
+ ****************************************************************************/
+
+static int delta_decode(int base, off_t base_start, off_t base_end,
+                        const uint8_t *op, const uint8_t *end,
+                        uint8_t *out, size_t pos, size_t len)
+{
+  uint32_t count;
+  uint32_t arg;
+  uint8_t code;
+  size_t i;
+
+  while (op < end)
+    {
+      code = *op++;
+      if (delta_varint(&op, end, &count) < 0 || count > len - pos)
+        {
+          return ERROR;
+        }
+
+      switch (code)
+        {
+          case NXBOOT_DELTA_OP_LITERAL:
+            if (count > end - op)
+              {
+                return ERROR;
+              }
+
+            memcpy(out + pos, op, count);
+            op += count;
+            break;
+
+          case NXBOOT_DELTA_OP_BASE:
+            if (delta_varint(&op, end, &arg) < 0 || arg < base_start ||
+                arg > base_end || count > base_end - arg ||
+                flash_partition_read(base, out + pos, count, arg) < 0)
+              {
+                return ERROR;
+              }
+            break;
+
+          case NXBOOT_DELTA_OP_SELF:
+            if (delta_varint(&op, end, &arg) < 0 || arg == 0 || arg > pos)
+              {
+                return ERROR;
+              }
+
+            for (i = 0; i < count; i++)
+              {
+                out[pos + i] = out[pos + i - arg];
+              }
+            break;
+
+          case NXBOOT_DELTA_OP_FILL:
+            if (op >= end)
+              {
+                return ERROR;
+              }
+
+            memset(out + pos, *op++, count);
+            break;
+
+          default:
+            return ERROR;
+        }
+
+      pos += count;
+    }
+
+  return pos == len ? OK : ERROR;
+}
+
+/****************************************************************************
+ * Public Functions
+ ****************************************************************************/
+
+/****************************************************************************
+ * Name: delta_get_header
+ *
+ * Description:
+ *   Checks whether the slot holds a delta update package and reads its
+ *   extended header.
+ *
+ * Input parameters:
+ *   fd: Valid file descriptor of the slot.
+ *   header: The image header read from the slot.
+ *   delta: Receives the delta package header.
+ *
+ * Returned Value:
+ *   True if the slot holds a delta update package.
+ *
+ ****************************************************************************/
+
+bool delta_get_header(int fd, const struct nxboot_img_header *header,
+                      struct nxboot_delta_header *delta)
+{
+  if (header->magic != NXBOOT_HEADER_MAGIC ||
+      header->extd_hdr_ptr < sizeof(*header) ||
+      header->extd_hdr_ptr + sizeof(*delta) > header->header_size)
+    {
+      return false;
+    }
+
+  if (flash_partition_read(fd, delta, sizeof(*delta),
+                           header->extd_hdr_ptr) < 0)
+    {
+      return false;
+    }
+
+  return delta->magic == NXBOOT_DELTA_MAGIC;
+}
+
+/****************************************************************************
+ * Name: delta_apply
+ *
+ * Description:
+ *   Builds the image described by a delta update package in the target
+ *   slot, block by block.
+ *
+ * Input parameters:
+ *   package: Valid file descriptor of the slot with the package.
+ *   base: Valid file descriptor of the slot with the base image.
+ *   target: Valid file descriptor of the slot to be written.
+ *   header: The image header read from the package.
+ *   delta: The delta package header.
+ *   magic: The magic written to the header of the resulting image.
+ *
+ * Returned Value:
+ *   0 on success, -1 on failure.
+ *
+ ****************************************************************************/
+
+int delta_apply(int package, int base, int target,
+                const struct nxboot_img_header *header,
+                const struct nxboot_delta_header *delta, uint32_t magic)
+{
+  struct flash_partition_info info;
+  struct flash_partition_info package_info;
+  struct nxboot_img_header base_header;
+  struct delta_progress_s progress;
+  uint8_t length[4];
+  uint8_t *scratch;
+  uint8_t *out;
+  uint8_t *ops;
+  uint32_t bsize = delta->block_size;
+  uint32_t nblocks;
+  uint32_t block;
+  uint32_t oplen;
+  size_t outlen;
+  size_t hdrlen;
+  off_t record;
+  off_t outoff;
+  off_t end;
+  off_t pend;
+  off_t poff;
+  int written = 0;
+  int ret = ERROR;
+#ifdef CONFIG_NXBOOT_PRINTF_PROGRESS_PERCENT
+  int percent;
+  int last_percent = -1;
+#endif
+
+  if (flash_partition_info(target, &info) < 0 ||
+      flash_partition_info(package, &package_info) < 0 ||
+      flash_partition_read(base, &base_header, sizeof(base_header), 0) < 0)
+    {
+      return ERROR;
+    }
+
+  end = header->header_size + header->size;
+  pend = header->header_size + delta->size;
+  if (bsize == 0 || bsize % info.blocksize != 0 || end > info.size ||
+      pend > package_info.size)
+    {
+      syslog(LOG_ERR, "Delta package does not fit the slots.\n");
+      return ERROR;
+    }
+
+  out = malloc(2 * bsize + DELTA_OPS_SIZE(bsize));
+  if (out == NULL)
+    {
+      return ERROR;
+    }
+
+  scratch = out + bsize;
+  ops = scratch + bsize;
+
+  /* Resume an interrupted installation of the same package. The blocks
+   * before the recorded one are already in the target.
+   */
+
+  nblocks = (end + bsize - 1) / bsize;
+  block = 0;
+  poff = header->header_size;
+
+  record = package_info.size - package_info.erasesize;
+  if (CONFIG_NXBOOT_DELTA_PROGRESS_BLOCKS <= 0 || pend > record)
+    {
+      record = 0;
+    }
+  else if (delta_progress_read(package, record, delta, &progress) &&
+           progress.block < nblocks && progress.offset >= poff &&
+           progress.offset <= pend)
+    {
+      syslog(LOG_INFO, "Resuming delta update at block %" PRIu32 ".\n",
+             progress.block);
+      block = progress.block;
+      poff = progress.offset;
+    }
+
+  for (; block < nblocks; block++)
+    {
+      outoff = (off_t)block * bsize;
+      outlen = MIN(bsize, end - outoff);
+
+      if (poff + (off_t)sizeof(length) > pend ||
+          flash_partition_read(package, length, sizeof(length), poff) < 0)
+        {
+          goto errout;
+        }
+
+      oplen = length[0] | (length[1] << 8) | (length[2] << 16) |
+              ((uint32_t)length[3] << 24);
+      poff += sizeof(length);
+      if (oplen > DELTA_OPS_SIZE(bsize) || oplen > pend - poff ||
+          flash_partition_read(package, ops, oplen, poff) < 0)
+        {
+          goto errout;
+        }
+
+      /* The header comes from the package, the rest from the operations */
+
+      hdrlen = 0;
+      if (outoff < header->header_size)
+        {
+          hdrlen = MIN(outlen, header->header_size - outoff);
+          if (flash_partition_read(package, out, hdrlen, outoff) < 0)
+            {
+              goto errout;
+            }
+
+          if (outoff == 0)
+            {
+              memcpy(out + offsetof(struct nxboot_img_header, magic),
+                     &magic, sizeof magic);
+            }
+        }
+
+      if (delta_decode(base, base_header.header_size,
+                       base_header.header_size + base_header.size,
+                       ops, ops + oplen, out, hdrlen, outlen) < 0)
+        {
+          syslog(LOG_ERR, "Malformed delta block %" PRIu32 ".\n", block);
+          goto errout;
+        }
+
+      ret = flash_partition_write_changed(target, out, scratch, outlen,
+                                          outoff);
+      if (ret < 0)
+        {
+          goto errout;
+        }
+
+      written += ret > 0 ? outlen : 0;
+      ret = ERROR;
+      poff += oplen;
+
+#if CONFIG_NXBOOT_DELTA_PROGRESS_BLOCKS > 0
+      if (record != 0 && block + 1 < nblocks &&
+          (block + 1) % CONFIG_NXBOOT_DELTA_PROGRESS_BLOCKS == 0)
+        {
+          /* The target has to hold the blocks before the record does. */
+
+          if (flash_partition_flush(target) < 0 ||
+              delta_progress_write(package, record, delta, block + 1,
+                                   poff) < 0)
+            {
+              goto errout;
+            }
+        }
+#endif
+
+#ifdef CONFIG_NXBOOT_PRINTF_PROGRESS_PERCENT
+      percent = ((block + 1) * 100) / nblocks;
+      if (percent != last_percent)
+        {
+          nxboot_progress(nxboot_progress_percent, percent);
+          last_percent = percent;
+        }
+#else
+      if (((block + 1) % 16) == 0)
+        {
+          nxboot_progress(nxboot_progress_dot);
+        }
+#endif
+    }
+
+  if (poff != pend || flash_partition_flush(target) < 0)
+    {
+      goto errout;
+    }
+
+  if (record != 0)
+    {
+      delta_progress_write(package, record, NULL, 0, 0);
+    }
+
+  syslog(LOG_INFO, "Delta update applied, %d of %d bytes written.\n",
+         written, (int)end);
+  ret = OK;
+
+errout:
+  free(out);
+  return ret;
+}
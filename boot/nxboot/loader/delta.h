@@ -0,0 +1,89 @@
+/****************************************************************************
+ * apps/boot/nxboot/loader/delta.h
+ *
+ * SPDX-License-Identifier: Apache-2.0
+ *
+ * Licensed to the Apache Software Foundation (ASF) under one or more
+ * contributor license agreements.  See the NOTICE file distributed with
+ * this work for additional information regarding copyright ownership.  The
+ * ASF licenses this file to you under the Apache License, Version 2.0 (the
+ * "License"); you may not use this file except in compliance with the
+ * License.  You may obtain a copy of the License at
+ *
+ *   http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS, WITHOUT
+ * WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.  See the
+ * License for the specific language governing permissions and limitations
+ * under the License.
+ *
+ ****************************************************************************/
+
+#ifndef __BOOT_NXBOOT_LOADER_DELTA_H
+#define __BOOT_NXBOOT_LOADER_DELTA_H
+
+/****************************************************************************
+ * Included Files
+ ****************************************************************************/
+
+#include <nuttx/config.h>
+
+#include <stdbool.h>
+#include <stdint.h>
+
+#include <nxboot.h>
+
+/****************************************************************************
+ * Public Functions Prototypes
+ ****************************************************************************/
+
+/****************************************************************************
+ * Name: delta_get_header
+ *
+ * Description:
+ *   Checks whether the slot holds a delta update package and reads its
+ *   extended header.
+ *
+ * Input parameters:
+ *   fd: Valid file descriptor of the slot.
+ *   header: The image header read from the slot.
+ *   delta: Receives the delta package header.
+ *
+ * Returned Value:
+ *   True if the slot holds a delta update package.
+ *
+ ****************************************************************************/
+
+bool delta_get_header(int fd, const struct nxboot_img_header *header,
+                      struct nxboot_delta_header *delta);
+
+/****************************************************************************
+ * Name: delta_apply
+ *
+ * Description:
+ *   Builds the image described by a delta update package in the target
+ *   slot, block by block. Only the blocks that differ from the current
+ *   content of the target are written. Progress records are kept in the
+ *   last erase block of the package slot, an interrupted installation
+ *   continues from the last record.
+ *
+ * Input parameters:
+ *   package: Valid file descriptor of the slot with the package.
+ *   base: Valid file descriptor of the slot with the base image. This
+ *         must not be the target.
+ *   target: Valid file descriptor of the slot to be written.
+ *   header: The image header read from the package.
+ *   delta: The delta package header.
+ *   magic: The magic written to the header of the resulting image.
+ *
+ * Returned Value:
+ *   0 on success, -1 on failure.
+ *
+ ****************************************************************************/
+
+int delta_apply(int package, int base, int target,
+                const struct nxboot_img_header *header,
+                const struct nxboot_delta_header *delta, uint32_t magic);
+
+#endif /* __BOOT_NXBOOT_LOADER_DELTA_H */
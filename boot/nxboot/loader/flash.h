@@ -135,6 +135,32 @@ int flash_partition_write(int fd, const void *buf, size_t count, off_t off);
 
 int flash_partition_read(int fd, void *buf, size_t count, off_t off);
 
+/****************************************************************************
+ * Name: flash_partition_write_changed
+ *
+ * Description:
+ *   Writes count data pointed to by buf at offset off to a partition
+ *   referenced by file descriptor fd, unless the partition already holds
+ *   the very same data. The current content is read to scratch, which must
+ *   be count bytes large. Without CONFIG_NXBOOT_COPY_COMPARE the data are
+ *   always written.
+ *
+ * Input parameters:
+ *   fd: Valid file descriptor.
+ *   buf: The pointer to data to be written.
+ *   scratch: The pointer to a buffer for the current content.
+ *   count: Number of bytes to be written.
+ *   off: Write offset in bytes.
+ *
+ * Returned Value:
+ *   1 if the data were written, 0 if they were already present, -1 on
+ *   failure.
+ *
+ ****************************************************************************/
+
+int flash_partition_write_changed(int fd, const void *buf, void *scratch,
+                                  size_t count, off_t off);
+
 /****************************************************************************
  * Name: flash_partition_erase
  *
@@ -0,0 +1,333 @@
+/****************************************************************************
+ * apps/boot/nxboot/loader/verify.c
+ *
+ * SPDX-License-Identifier: Apache-2.0
+ *
+ * Licensed to the Apache Software Foundation (ASF) under one or more
+ * contributor license agreements.  See the NOTICE file distributed with
+ * this work for additional information regarding copyright ownership.  The
+ * ASF licenses this file to you under the Apache License, Version 2.0 (the
+ * "License"); you may not use this file except in compliance with the
+ * License.  You may obtain a copy of the License at
+ *
+ *   http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS, WITHOUT
+ * WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.  See the
+ * License for the specific language governing permissions and limitations
+ * under the License.
+ *
+ ****************************************************************************/
+
+/****************************************************************************
+ * Included Files
+ ****************************************************************************/
+
+#include <nuttx/config.h>
+
+#include <errno.h>
+#include <fcntl.h>
+#include <stdbool.h>
+#include <stddef.h>
+#include <stdint.h>
+#include <string.h>
+#include <syslog.h>
+#include <unistd.h>
+
+#include <nxboot.h>
+
+#include "verify.h"
+
+/****************************************************************************
+ * Pre-processor Definitions
+ ****************************************************************************/
+
+#define VERIFY_RECORD_VALID   0x5652584e /* NXRV */
+#define VERIFY_RECORD_DROPPED 0x4452584e /* NXRD */
+
+#define VERIFY_KEY0 ((uint64_t)CONFIG_NXBOOT_VERIFY_CACHE_KEY)
+#define VERIFY_KEY1 ((uint64_t)CONFIG_NXBOOT_PLATFORM_IDENTIFIER)
+
+#define VERIFY_TAG_SIZE offsetof(struct verify_record_s, tag)
+
+#define ROTL64(x, b) (((x) << (b)) | ((x) >> (64 - (b))))
+
+#define SIPROUND(v0, v1, v2, v3) \
+  do \
+    { \
+      (v0) += (v1); (v1) = ROTL64(v1, 13); (v1) ^= (v0); \
+      (v0) = ROTL64(v0, 32); \
+      (v2) += (v3); (v3) = ROTL64(v3, 16); (v3) ^= (v2); \
+      (v0) += (v3); (v3) = ROTL64(v3, 21); (v3) ^= (v0); \
+      (v2) += (v1); (v1) = ROTL64(v1, 17); (v1) ^= (v2); \
+      (v2) = ROTL64(v2, 32); \
+    } \
+  while (0)
+
+/****************************************************************************
+ * Private Types
+ ****************************************************************************/
+
+/* One record per slot, stored at offset slot * sizeof(record). The tag
+ * covers all the preceding fields.
+ */
+
+struct verify_record_s
+{
+  uint32_t magic;                   /* VERIFY_RECORD_VALID or _DROPPED */
+  uint32_t slot;                    /* Slot the record belongs to */
+  uint32_t generation;              /* Bumped whenever the slot is written */
+  uint32_t crc;                     /* CRC32 calculated over the image */
+  struct nxboot_img_header header;  /* Header of the verified image */
+  uint64_t tag;                     /* SipHash-2-4 of the fields above */
+};
+
+/****************************************************************************
+ * Private Functions
+ ****************************************************************************/
+
+/****************************************************************************
+ * Name: verify_siphash
+ *
+ * Description:
+ *   SipHash-2-4 keyed with NXBOOT_VERIFY_CACHE_KEY and the platform
+ *   identifier.
+ *
+ ****************************************************************************/
+
+static uint64_t verify_siphash(const uint8_t *data, size_t len)
+{
+  uint64_t v0 = VERIFY_KEY0 ^ 0x736f6d6570736575ull;
+  uint64_t v1 = VERIFY_KEY1 ^ 0x646f72616e646f6dull;
+  uint64_t v2 = VERIFY_KEY0 ^ 0x6c7967656e657261ull;
+  uint64_t v3 = VERIFY_KEY1 ^ 0x7465646279746573ull;
+  uint64_t m;
+  size_t left;
+  int i;
+
+  for (left = len; left >= 8; left -= 8, data += 8)
+    {
+      for (m = 0, i = 7; i >= 0; i--)
+        {
+          m = (m << 8) | data[i];
+        }
+
+      v3 ^= m;
+      SIPROUND(v0, v1, v2, v3);
+      SIPROUND(v0, v1, v2, v3);
+      v0 ^= m;
+    }
+
+  m = (uint64_t)len << 56;
+  for (i = left - 1; i >= 0; i--)
+    {
+      m |= (uint64_t)data[i] << (8 * i);
+    }
+
+  v3 ^= m;
+  SIPROUND(v0, v1, v2, v3);
+  SIPROUND(v0, v1, v2, v3);
+  v0 ^= m;
+
+  v2 ^= 0xff;
+  SIPROUND(v0, v1, v2, v3);
+  SIPROUND(v0, v1, v2, v3);
+  SIPROUND(v0, v1, v2, v3);
+  SIPROUND(v0, v1, v2, v3);
+
+  return v0 ^ v1 ^ v2 ^ v3;
+}
+
+/****************************************************************************
+ * Name: verify_record_read
+ *
+ * Description:
+ *   Reads the record of the slot. Returns true only if the record is
+ *   authentic, whether it is valid or dropped.
+ *
+ ****************************************************************************/
+
+static bool verify_record_read(int fd, int slot,
+                               struct verify_record_s *record)
+{
+  ssize_t nbytes;
+
+  nbytes = pread(fd, record, sizeof(*record), slot * sizeof(*record));
+  if (nbytes != sizeof(*record))
+    {
+      return false;
+    }
+
+  return (record->magic == VERIFY_RECORD_VALID ||
+          record->magic == VERIFY_RECORD_DROPPED) &&
+         record->slot == (uint32_t)slot &&
+         record->tag == verify_siphash((const uint8_t *)record,
+                                       VERIFY_TAG_SIZE);
+}
+
+/****************************************************************************
+ * Name: verify_record_write
+ ****************************************************************************/
+
+static int verify_record_write(int fd, int slot,
+                               struct verify_record_s *record)
+{
+  ssize_t nbytes;
+
+  record->slot = slot;
+  record->tag = verify_siphash((const uint8_t *)record, VERIFY_TAG_SIZE);
+
+  nbytes = pwrite(fd, record, sizeof(*record), slot * sizeof(*record));
+  if (nbytes != sizeof(*record) || fsync(fd) < 0)
+    {
+      syslog(LOG_ERR, "Could not write verify record of slot %d: %s\n",
+             slot, strerror(errno));
+      return ERROR;
+    }
+
+  return OK;
+}
+
+/****************************************************************************
+ * Public Functions
+ ****************************************************************************/
+
+/****************************************************************************
+ * Name: verify_cache_lookup
+ *
+ * Description:
+ *   Checks whether the image with the given header was already verified
+ *   in the slot and nothing was written to the slot since then.
+ *
+ * Input parameters:
+ *   slot: The slot number.
+ *   header: The header currently stored in the slot.
+ *   generation: Receives the current write generation of the slot.
+ *
+ * Returned Value:
+ *   True if the image does not need to be verified again.
+ *
+ ****************************************************************************/
+
+bool verify_cache_lookup(int slot, const struct nxboot_img_header *header,
+                         uint32_t *generation)
+{
+  struct verify_record_s record;
+  bool found;
+  int fd;
+
+  *generation = 0;
+
+  fd = open(CONFIG_NXBOOT_VERIFY_CACHE_PATH, O_RDONLY);
+  if (fd < 0)
+    {
+      return false;
+    }
+
+  found = verify_record_read(fd, slot, &record);
+  close(fd);
+
+  if (!found)
+    {
+      return false;
+    }
+
+  *generation = record.generation;
+  return record.magic == VERIFY_RECORD_VALID &&
+         record.crc == header->crc &&
+         memcmp(&record.header, header, sizeof(*header)) == 0;
+}
+
+/****************************************************************************
+ * Name: verify_cache_store
+ *
+ * Description:
+ *   Records that the image with the given header passed the full check.
+ *   Nothing is stored if the slot generation changed in the meantime.
+ *
+ * Input parameters:
+ *   slot: The slot number.
+ *   header: The header of the verified image.
+ *   generation: The generation returned by verify_cache_lookup().
+ *
+ * Returned Value:
+ *   0 on success, -1 on failure.
+ *
+ ****************************************************************************/
+
+int verify_cache_store(int slot, const struct nxboot_img_header *header,
+                       uint32_t generation)
+{
+  struct verify_record_s record;
+  uint32_t current;
+  int ret;
+  int fd;
+
+  fd = open(CONFIG_NXBOOT_VERIFY_CACHE_PATH, O_RDWR | O_CREAT, 0644);
+  if (fd < 0)
+    {
+      syslog(LOG_ERR, "Could not open %s: %s\n",
+             CONFIG_NXBOOT_VERIFY_CACHE_PATH, strerror(errno));
+      return ERROR;
+    }
+
+  current = verify_record_read(fd, slot, &record) ? record.generation : 0;
+  if (current != generation)
+    {
+      /* The slot was written while the image was being verified. */
+
+      close(fd);
+      return OK;
+    }
+
+  memset(&record, 0, sizeof(record));
+  record.magic = VERIFY_RECORD_VALID;
+  record.generation = generation;
+  record.crc = header->crc;
+  memcpy(&record.header, header, sizeof(*header));
+
+  ret = verify_record_write(fd, slot, &record);
+  close(fd);
+  return ret;
+}
+
+/****************************************************************************
+ * Name: verify_cache_invalidate
+ *
+ * Description:
+ *   Drops the record of the slot and advances its write generation.
+ *
+ * Input parameters:
+ *   slot: The slot number.
+ *
+ * Returned Value:
+ *   0 on success, -1 on failure.
+ *
+ ****************************************************************************/
+
+int verify_cache_invalidate(int slot)
+{
+  struct verify_record_s record;
+  uint32_t current;
+  int ret;
+  int fd;
+
+  fd = open(CONFIG_NXBOOT_VERIFY_CACHE_PATH, O_RDWR | O_CREAT, 0644);
+  if (fd < 0)
+    {
+      syslog(LOG_ERR, "Could not open %s: %s\n",
+             CONFIG_NXBOOT_VERIFY_CACHE_PATH, strerror(errno));
+      return ERROR;
+    }
+
+  current = verify_record_read(fd, slot, &record) ? record.generation : 0;
+
+  memset(&record, 0, sizeof(record));
+  record.magic = VERIFY_RECORD_DROPPED;
+  record.generation = current + 1;
+
+  ret = verify_record_write(fd, slot, &record);
+  close(fd);
+  return ret;
+}
@@ -0,0 +1,126 @@
+/****************************************************************************
+ * apps/boot/nxboot/loader/verify.h
+ *
+ * SPDX-License-Identifier: Apache-2.0
+ *
+ * Licensed to the Apache Software Foundation (ASF) under one or more
+ * contributor license agreements.  See the NOTICE file distributed with
+ * this work for additional information regarding copyright ownership.  The
+ * ASF licenses this file to you under the Apache License, Version 2.0 (the
+ * "License"); you may not use this file except in compliance with the
+ * License.  You may obtain a copy of the License at
+ *
+ *   http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS, WITHOUT
+ * WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.  See the
+ * License for the specific language governing permissions and limitations
+ * under the License.
+ *
+ ****************************************************************************/
+
+#ifndef __BOOT_NXBOOT_LOADER_VERIFY_H
+#define __BOOT_NXBOOT_LOADER_VERIFY_H
+
+/****************************************************************************
+ * Included Files
+ ****************************************************************************/
+
+#include <nuttx/config.h>
+
+#include <stdbool.h>
+#include <stdint.h>
+
+#include <nxboot.h>
+
+/****************************************************************************
+ * Public Functions Prototypes
+ ****************************************************************************/
+
+#ifdef CONFIG_NXBOOT_VERIFY_CACHE
+
+/****************************************************************************
+ * Name: verify_cache_lookup
+ *
+ * Description:
+ *   Checks whether the image with the given header was already verified
+ *   in the slot and nothing was written to the slot since then.
+ *
+ * Input parameters:
+ *   slot: The slot number.
+ *   header: The header currently stored in the slot.
+ *   generation: Receives the current write generation of the slot. It has
+ *               to be passed to verify_cache_store() once the image is
+ *               verified.
+ *
+ * Returned Value:
+ *   True if the image does not need to be verified again.
+ *
+ ****************************************************************************/
+
+bool verify_cache_lookup(int slot, const struct nxboot_img_header *header,
+                         uint32_t *generation);
+
+/****************************************************************************
+ * Name: verify_cache_store
+ *
+ * Description:
+ *   Records that the image with the given header passed the full check.
+ *   Nothing is stored if the slot generation changed in the meantime.
+ *
+ * Input parameters:
+ *   slot: The slot number.
+ *   header: The header of the verified image.
+ *   generation: The generation returned by verify_cache_lookup().
+ *
+ * Returned Value:
+ *   0 on success, -1 on failure.
+ *
+ ****************************************************************************/
+
+int verify_cache_store(int slot, const struct nxboot_img_header *header,
+                       uint32_t generation);
+
+/****************************************************************************
+ * Name: verify_cache_invalidate
+ *
+ * Description:
+ *   Drops the record of the slot and advances its write generation. This
+ *   has to be called before the slot is written or erased.
+ *
+ * Input parameters:
+ *   slot: The slot number.
+ *
+ * Returned Value:
+ *   0 on success, -1 on failure.
+ *
+ ****************************************************************************/
+
+int verify_cache_invalidate(int slot);
+
+#else
+
+static inline bool
+verify_cache_lookup(int slot, const struct nxboot_img_header *header,
+                    uint32_t *generation)
+{
+  *generation = 0;
+  return false;
+}
+
+static inline int
+verify_cache_store(int slot, const struct nxboot_img_header *header,
+                   uint32_t generation)
+{
+  return 0;
+}
+
+static inline int verify_cache_invalidate(int slot)
+{
+  return 0;
+}
+
+#endif /* CONFIG_NXBOOT_VERIFY_CACHE */
+
+#endif /* __BOOT_NXBOOT_LOADER_VERIFY_H */
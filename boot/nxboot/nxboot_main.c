@@ -79,6 +79,7 @@ static const char *progress_msgs[] =
   [recovery_created]         = "Recovery image created",
   [recovery_invalid]         = "Recovery image invalid, update stopped",
   [update_failed]            = "Update failed",
+  [update_from_delta]        = "Updating from delta package",
 };
 #endif /* CONFIG_NXBOOT_PRINTF_PROGRESS */
 
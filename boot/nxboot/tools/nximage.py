@@ -30,6 +30,139 @@ import zlib
 
 import semantic_version
 
+NXBOOT_DELTA_MAGIC = 0x4C44584E
+NXBOOT_DELTA_HDR_PTR = 128
+NXBOOT_DELTA_OP_LITERAL = 0x01
+NXBOOT_DELTA_OP_BASE = 0x02
+NXBOOT_DELTA_OP_SELF = 0x03
+NXBOOT_DELTA_OP_FILL = 0x04
+NXBOOT_DELTA_MIN_MATCH = 8
+
+
+def varint(value: int) -> bytes:
+    """Encode value as LEB128."""
+    out = bytearray()
+    while True:
+        byte = value & 0x7F
+        value >>= 7
+        if value:
+            out.append(byte | 0x80)
+        else:
+            out.append(byte)
+            return bytes(out)
+
+
+def common_length(a: bytes, ai: int, b: bytes, bi: int, limit: int) -> int:
+    """Return the length of the common prefix of a[ai:] and b[bi:]."""
+    n = 0
+    while n + 64 <= limit and a[ai + n : ai + n + 64] == b[bi + n : bi + n + 64]:
+        n += 64
+    while n < limit and a[ai + n] == b[bi + n]:
+        n += 1
+    return n
+
+
+class NxDelta:
+    """Encoder of the blocks of a delta update package.
+
+    Every block produces block_size bytes of the new image (the header
+    excluded) from literals, runs, back references within the block and
+    copies from the base image, see NXBOOT_DELTA_OP_* in nxboot.h.
+    """
+
+    def __init__(self, base: bytes, block_size: int) -> None:
+        self.base = base
+        self.block_size = block_size
+        self.base_header_size = struct.unpack_from("<H", base, 6)[0]
+        self.base_crc = struct.unpack_from("<I", base, 8)[0]
+        self.index = {}
+        last = len(base) - NXBOOT_DELTA_MIN_MATCH
+        for pos in range(last, self.base_header_size - 1, -1):
+            self.index[base[pos : pos + NXBOOT_DELTA_MIN_MATCH]] = pos
+
+    def encode_block(self, image: bytes, start: int, end: int) -> bytes:
+        ops = bytearray()
+        local = {}
+        literal = start
+        shift = None
+        pos = start
+
+        def flush_literal(upto: int) -> None:
+            if upto > literal:
+                ops.append(NXBOOT_DELTA_OP_LITERAL)
+                ops.extend(varint(upto - literal))
+                ops.extend(image[literal:upto])
+
+        while pos < end:
+            limit = end - pos
+            key = image[pos : pos + NXBOOT_DELTA_MIN_MATCH]
+            best = (0, 0, 0)
+
+            run = common_length(image, pos, image, pos + 1, limit - 1) + 1
+            if run >= NXBOOT_DELTA_MIN_MATCH:
+                best = (run, NXBOOT_DELTA_OP_FILL, image[pos])
+
+            for cand in (None if shift is None else pos + shift, self.index.get(key)):
+                if (
+                    cand is None
+                    or cand < self.base_header_size
+                    or cand >= len(self.base)
+                ):
+                    continue
+                length = common_length(
+                    image, pos, self.base, cand, min(limit, len(self.base) - cand)
+                )
+                if length > best[0]:
+                    best = (length, NXBOOT_DELTA_OP_BASE, cand)
+
+            cand = local.get(key)
+            if cand is not None:
+                length = common_length(image, pos, image, cand, limit)
+                if length > best[0]:
+                    best = (length, NXBOOT_DELTA_OP_SELF, pos - cand)
+
+            length, code, arg = best
+            if length < NXBOOT_DELTA_MIN_MATCH:
+                if len(key) == NXBOOT_DELTA_MIN_MATCH:
+                    local[key] = pos
+                pos += 1
+                continue
+
+            flush_literal(pos)
+            ops.append(code)
+            ops.extend(varint(length))
+            if code == NXBOOT_DELTA_OP_FILL:
+                ops.append(arg)
+            else:
+                ops.extend(varint(arg))
+            if code == NXBOOT_DELTA_OP_BASE:
+                shift = arg - pos
+            local[key] = pos
+            pos += length
+            literal = pos
+
+        flush_literal(end)
+
+        if len(ops) > end - start + 6:
+            # Not worth it, store the block as it is.
+
+            ops = bytearray([NXBOOT_DELTA_OP_LITERAL])
+            ops.extend(varint(end - start))
+            ops.extend(image[start:end])
+
+        return struct.pack("<I", len(ops)) + bytes(ops)
+
+    def encode(self, image: bytes, header_size: int) -> bytes:
+        payload = bytearray()
+        for block_start in range(0, len(image), self.block_size):
+            block_end = min(block_start + self.block_size, len(image))
+            start = max(block_start, header_size)
+            if start >= block_end:
+                payload.extend(struct.pack("<I", 0))
+            else:
+                payload.extend(self.encode_block(image, start, block_end))
+        return bytes(payload)
+
 
 class NxImage:
     def __init__(
@@ -48,6 +181,7 @@ class NxImage:
         self.identifier = identifier
         self.crc = 0
         self.extd_hdr_ptr = 0
+        self.delta_size = 0
 
     def __repr__(self) -> str:
         repr = (
@@ -59,29 +193,67 @@ class NxImage:
             f"  header_size: {self.header_size:x}\n"
             f"  identifier:  {self.identifier:x}\n"
             f"  crc:         {self.crc:x}\n"
+            f"  delta size:  {self.delta_size}\n"
             f">"
         )
         return repr
 
+    def header(self) -> bytearray:
+        dest = io.BytesIO()
+        dest.write(b"\x4e\x58\x4f\x53")
+        dest.write(struct.pack("<H", 0))
+        dest.write(struct.pack("<H", self.header_size))
+        dest.write(struct.pack("<I", 0xFFFFFFFF))
+        dest.write(struct.pack("<I", self.size))
+        dest.write(struct.pack("<Q", self.identifier))
+        dest.write(struct.pack("<I", self.extd_hdr_ptr))
+        dest.write(struct.pack("<H", self.version.major))
+        dest.write(struct.pack("<H", self.version.minor))
+        dest.write(struct.pack("<H", self.version.patch))
+        if not self.version.prerelease:
+            dest.write(struct.pack("@94s", b"\x00"))
+        else:
+            dest.write(struct.pack("@94s", bytes(self.version.prerelease[0], "utf-8")))
+        dest.write(bytearray(b"\xff") * (self.header_size - 128))
+        return bytearray(dest.getvalue())
+
+    def add_delta(self, base_path: str, block_size: int) -> None:
+        """Store a delta update package against the image base_path."""
+        with open(base_path, "rb") as f:
+            delta = NxDelta(f.read(), block_size)
+        with open(self.path, "rb") as f:
+            body = f.read()
+
+        self.extd_hdr_ptr = NXBOOT_DELTA_HDR_PTR
+        header = self.header()
+        payload = delta.encode(bytes(header) + body, self.header_size)
+        self.delta_size = len(payload)
+
+        # The package checksum is calculated with its own field zeroed,
+        # the image checksum covers the whole extended header.
+
+        ext = NXBOOT_DELTA_HDR_PTR
+        struct.pack_into(
+            "<IIIII",
+            header,
+            ext,
+            NXBOOT_DELTA_MAGIC,
+            0,
+            delta.base_crc,
+            len(payload),
+            block_size,
+        )
+        struct.pack_into("<I", header, ext + 4, zlib.crc32(header[12:] + payload))
+        self.crc = zlib.crc32(header[12:] + body)
+        struct.pack_into("<I", header, 8, self.crc)
+
+        with open(self.result, "wb") as dest:
+            dest.write(header)
+            dest.write(payload)
+
     def add_header(self) -> None:
         with open(self.path, "r+b") as src, open(self.result, "w+b") as dest:
-            dest.write(b"\x4e\x58\x4f\x53")
-            dest.write(struct.pack("<H", 0))
-            dest.write(struct.pack("<H", self.header_size))
-            dest.write(struct.pack("<I", 0xFFFFFFFF))
-            dest.write(struct.pack("<I", self.size))
-            dest.write(struct.pack("<Q", self.identifier))
-            dest.write(struct.pack("<I", self.extd_hdr_ptr))
-            dest.write(struct.pack("<H", self.version.major))
-            dest.write(struct.pack("<H", self.version.minor))
-            dest.write(struct.pack("<H", self.version.patch))
-            if not self.version.prerelease:
-                dest.write(struct.pack("@94s", b"\x00"))
-            else:
-                dest.write(
-                    struct.pack("@94s", bytes(self.version.prerelease[0], "utf-8"))
-                )
-            dest.write(bytearray(b"\xff") * (self.header_size - 128))
+            dest.write(self.header())
             while data := src.read(io.DEFAULT_BUFFER_SIZE):
                 dest.write(data)
 
@@ -113,6 +285,17 @@ def parse_args() -> argparse.Namespace:
         default=0x0,
         help="Platform identifier. An image is rejected if its identifier doesn't match the one set in bootloader.",
     )
+    parser.add_argument(
+        "--delta",
+        metavar="BASE",
+        help="Create a delta update package against BASE, the image currently in the primary slot.",
+    )
+    parser.add_argument(
+        "--delta_block_size",
+        type=lambda x: int(x, 0),
+        default=4096,
+        help="Image bytes per delta block. Use the erase size of the primary slot.",
+    )
     parser.add_argument(
         "-v",
         action="store_true",
@@ -140,7 +323,10 @@ def main() -> None:
         args.header_size,
         args.identifier,
     )
-    image.add_header()
+    if args.delta:
+        image.add_delta(args.delta, args.delta_block_size)
+    else:
+        image.add_header()
     if args.v:
         print(image)
 
@@ -69,6 +69,10 @@
 #include "terminal.h"
 #include "lib.h"
 
+#ifdef CONFIG_CANUTILS_CANDUMP_BINLOG
+#include "cblog.h"
+#endif
+
 /****************************************************************************
  * Pre-processor Definitions
  ****************************************************************************/
@@ -94,6 +98,15 @@
 #define SILENT_ANI 1  /* silent mode with animation */
 #define SILENT_ON  2  /* silent mode (completely silent) */
 
+/* number of frames fetched from a socket per wakeup */
+#ifdef CONFIG_CANUTILS_CANDUMP_BATCH
+#define MAXBATCH CONFIG_CANUTILS_CANDUMP_BATCH
+#else
+#define MAXBATCH 1
+#endif
+
+#define CTRLMSG_LEN CMSG_SPACE(sizeof(struct timeval) + 3*sizeof(struct timespec) + sizeof(__u32))
+
 #define BOLD    ATTBOLD
 #define RED     ATTBOLD FGRED
 #define GREEN   ATTBOLD FGGREEN
@@ -114,6 +127,7 @@ static __u32 last_dropcnt[MAXSOCK];
 static char devname[MAXIFNAMES][IFNAMSIZ+1];
 static int  dindex[MAXIFNAMES];
 static int  max_devname_len; /* to prevent frazzled device name output */
+static unsigned char devname_new[MAXIFNAMES]; /* not yet in the binary log */
 const int canfd_on = 1;
 
 #define MAXANI 4
@@ -122,6 +136,22 @@ const char extra_m_info[4][4] = {"- -", "B -", "- E", "B E"};
 
 static volatile int running = 1;
 
+#ifdef CONFIG_CANUTILS_CANDUMP_RECVMMSG
+typedef struct mmsghdr rxmsg_t;
+#else
+typedef struct {
+	struct msghdr msg_hdr;
+	unsigned int msg_len;
+} rxmsg_t;
+#endif
+
+/* receive batch, the static parts are set up once in main() */
+static struct canfd_frame rxframes[MAXBATCH];
+static struct sockaddr_can rxaddrs[MAXBATCH];
+static char rxctrlmsgs[MAXBATCH][CTRLMSG_LEN];
+static struct iovec rxiovs[MAXBATCH];
+static rxmsg_t rxmsgs[MAXBATCH];
+
 static void print_usage(char *prg)
 {
 	fprintf(stderr, "%s - dump CAN bus traffic.\n", prg);
@@ -137,6 +167,12 @@ static void print_usage(char *prg)
 	fprintf(stderr, "         -s <level>  (silent mode - %d: off (default) %d: animation %d: silent)\n", SILENT_OFF, SILENT_ANI, SILENT_ON);
 	fprintf(stderr, "         -l          (log CAN-frames into file. Sets '-s %d' by default)\n", SILENT_ON);
 	fprintf(stderr, "         -L          (use log file format on stdout)\n");
+#ifdef CONFIG_CANUTILS_CANDUMP_BINLOG
+	fprintf(stderr, "         -b          (log CAN-frames into binary file. Sets '-s %d' by default)\n", SILENT_ON);
+#ifdef CONFIG_LIBC_LZF
+	fprintf(stderr, "         -z          (LZF compress the binary log file)\n");
+#endif
+#endif
 	fprintf(stderr, "         -n <count>  (terminate after reception of <count> CAN frames)\n");
 	fprintf(stderr, "         -r <size>   (set socket receive buffer to <size>)\n");
 	fprintf(stderr, "         -D          (Don't exit if a \"detected\" can device goes down.\n");
@@ -213,6 +249,7 @@ int idx2dindex(int ifidx, int socket) {
 		max_devname_len = strlen(ifr.ifr_name);
 
 	strlcpy(devname[i], ifr.ifr_name, sizeof(devname[i]));
+	devname_new[i] = 1;
 
 #ifdef DEBUG
 	printf("new index %d (%s)\n", i, devname[i]);
@@ -221,6 +258,35 @@ int idx2dindex(int ifidx, int socket) {
 	return i;
 }
 
+/* fetch up to MAXBATCH frames, waiting for the first one only */
+static int recv_batch(int socket)
+{
+	int j;
+
+	/* these settings may be modified by recvmsg() */
+	for (j=0; j < MAXBATCH; j++) {
+		rxiovs[j].iov_len = sizeof(rxframes[j]);
+		rxmsgs[j].msg_hdr.msg_namelen = sizeof(rxaddrs[j]);
+		rxmsgs[j].msg_hdr.msg_controllen = sizeof(rxctrlmsgs[j]);
+		rxmsgs[j].msg_hdr.msg_flags = 0;
+	}
+
+#ifdef CONFIG_CANUTILS_CANDUMP_RECVMMSG
+	return recvmmsg(socket, rxmsgs, MAXBATCH, MSG_WAITFORONE, NULL);
+#else
+	for (j=0; j < MAXBATCH; j++) {
+		int nbytes = recvmsg(socket, &rxmsgs[j].msg_hdr, j ? MSG_DONTWAIT : 0);
+
+		if (nbytes < 0)
+			return j ? j : -1;
+
+		rxmsgs[j].msg_len = nbytes;
+	}
+
+	return j;
+#endif
+}
+
 int main(int argc, char **argv)
 {
 	fd_set rdfs;
@@ -236,6 +302,7 @@ int main(int argc, char **argv)
 	unsigned char view = 0;
 	unsigned char log = 0;
 	unsigned char logfrmt = 0;
+	unsigned char binlog = 0;
 	int count = 0;
 	int rcvbuf_size = 0;
 	int opt;
@@ -243,18 +310,20 @@ int main(int argc, char **argv)
 	int join_filter;
 	char *ptr, *nptr;
 	struct sockaddr_can addr;
-	char ctrlmsg[CMSG_SPACE(sizeof(struct timeval) + 3*sizeof(struct timespec) + sizeof(__u32))];
-	struct iovec iov;
-	struct msghdr msg;
+	struct msghdr *msg;
 	struct cmsghdr *cmsg;
 	struct can_filter *rfilter;
 	can_err_mask_t err_mask;
-	struct canfd_frame frame;
+	struct canfd_frame *frame;
 	int nbytes, i, maxdlen;
 	struct ifreq ifr;
 	struct timeval tv, last_tv;
 	struct timeval timeout, timeout_config = { 0, 0 }, *timeout_current = NULL;
 	FILE *logfile = NULL;
+#ifdef CONFIG_CANUTILS_CANDUMP_BINLOG
+	unsigned char compress = 0;
+	struct cblog_s *blog = NULL;
+#endif
 
 #if 0 /* NuttX doesn't support these signals */
 	signal(SIGTERM, sigterm);
@@ -265,7 +334,7 @@ int main(int argc, char **argv)
 	last_tv.tv_sec  = 0;
 	last_tv.tv_usec = 0;
 
-	while ((opt = getopt(argc, argv, "t:HciaSs:lDdxLn:r:heT:?")) != -1) {
+	while ((opt = getopt(argc, argv, "t:HciaSs:lbzDdxLn:r:heT:?")) != -1) {
 		switch (opt) {
 		case 't':
 			timestamp = optarg[0];
@@ -313,6 +382,18 @@ int main(int argc, char **argv)
 			log = 1;
 			break;
 
+#ifdef CONFIG_CANUTILS_CANDUMP_BINLOG
+		case 'b':
+			binlog = 1;
+			break;
+
+#ifdef CONFIG_LIBC_LZF
+		case 'z':
+			compress = 1;
+			break;
+#endif
+#endif
+
 		case 'D':
 			down_causes_exit = 0;
 			break;
@@ -373,8 +454,15 @@ int main(int argc, char **argv)
 		exit(0);
 	}
 
+#ifdef CONFIG_CANUTILS_CANDUMP_BINLOG
+	if (compress && !binlog) {
+		fprintf(stderr, "Compression needs the binary log file (-b)!\n");
+		exit(0);
+	}
+#endif
+
 	if (silent == SILENT_INI) {
-		if (log) {
+		if (log || binlog) {
 			fprintf(stderr, "Disabled standard output while logging.\n");
 			silent = SILENT_ON; /* disable output on stdout */
 		} else
@@ -537,7 +625,7 @@ int main(int argc, char **argv)
 			}
 		}
 
-		if (timestamp || log || logfrmt) {
+		if (timestamp || log || logfrmt || binlog) {
 
 			if (hwtimestamp) {
 				const int timestamping_flags = (SOF_TIMESTAMPING_SOFTWARE | \
@@ -577,7 +665,7 @@ int main(int argc, char **argv)
 		}
 	}
 
-	if (log) {
+	if (log || binlog) {
 		time_t currtime;
 		struct tm now;
 		char fname[83]; /* suggested by -Wformat-overflow= */
@@ -600,21 +688,40 @@ int main(int argc, char **argv)
 		if (silent != SILENT_ON)
 			fprintf(stderr, "Warning: Console output active while logging!\n");
 
-		fprintf(stderr, "Enabling Logfile '%s'\n", fname);
+		if (log) {
+			fprintf(stderr, "Enabling Logfile '%s'\n", fname);
 
-		logfile = fopen(fname, "w");
-		if (!logfile) {
-			perror("logfile");
-			return 1;
+			logfile = fopen(fname, "w");
+			if (!logfile) {
+				perror("logfile");
+				return 1;
+			}
+		}
+
+#ifdef CONFIG_CANUTILS_CANDUMP_BINLOG
+		if (binlog) {
+			strcpy(strrchr(fname, '.'), ".cbl");
+			fprintf(stderr, "Enabling binary Logfile '%s'\n", fname);
+
+			blog = cblog_open(fname, CONFIG_CANUTILS_CANDUMP_BINLOG_RINGBITS,
+					  CONFIG_CANUTILS_CANDUMP_BINLOG_BLOCKSIZE,
+					  compress, max_devname_len);
+			if (!blog) {
+				perror("binary logfile");
+				return 1;
+			}
 		}
+#endif
 	}
 
 	/* these settings are static and can be held out of the hot path */
-	iov.iov_base = &frame;
-	msg.msg_name = &addr;
-	msg.msg_iov = &iov;
-	msg.msg_iovlen = 1;
-	msg.msg_control = &ctrlmsg;
+	for (i=0; i < MAXBATCH; i++) {
+		rxiovs[i].iov_base = &rxframes[i];
+		rxmsgs[i].msg_hdr.msg_name = &rxaddrs[i];
+		rxmsgs[i].msg_hdr.msg_iov = &rxiovs[i];
+		rxmsgs[i].msg_hdr.msg_iovlen = 1;
+		rxmsgs[i].msg_hdr.msg_control = &rxctrlmsgs[i];
+	}
 
 	while (running) {
 
@@ -635,19 +742,13 @@ int main(int argc, char **argv)
 
 			if (FD_ISSET(s[i], &rdfs)) {
 
-				int idx;
-
-				/* these settings may be modified by recvmsg() */
-				iov.iov_len = sizeof(frame);
-				msg.msg_namelen = sizeof(addr);
-				msg.msg_controllen = sizeof(ctrlmsg);
-				msg.msg_flags = 0;
+				int idx, j, n;
 
-				nbytes = recvmsg(s[i], &msg, 0);
-				idx = idx2dindex(addr.can_ifindex, s[i]);
+				n = recv_batch(s[i]);
 
-				if (nbytes < 0) {
+				if (n < 0) {
 					if ((errno == ENETDOWN) && !down_causes_exit) {
+						idx = idx2dindex(rxaddrs[0].can_ifindex, s[i]);
 						fprintf(stderr, "%s: interface down\n", devname[idx]);
 						continue;
 					}
@@ -655,154 +756,184 @@ int main(int argc, char **argv)
 					return 1;
 				}
 
-				if ((size_t)nbytes == CAN_MTU)
-					maxdlen = CAN_MAX_DLEN;
-				else if ((size_t)nbytes == CANFD_MTU)
-					maxdlen = CANFD_MAX_DLEN;
-				else {
-					fprintf(stderr, "read: incomplete CAN frame\n");
-					return 1;
-				}
+				for (j=0; j < n && running; j++) {
 
-				if (count && (--count == 0))
-					running = 0;
-
-				for (cmsg = CMSG_FIRSTHDR(&msg);
-				     cmsg && (cmsg->cmsg_level == SOL_SOCKET);
-				     cmsg = CMSG_NXTHDR(&msg,cmsg)) {
-					if (cmsg->cmsg_type == SO_TIMESTAMP) {
-						memcpy(&tv, CMSG_DATA(cmsg), sizeof(tv));
-					} else if (cmsg->cmsg_type == SO_TIMESTAMPING) {
-
-						struct timespec *stamp = (struct timespec *)CMSG_DATA(cmsg);
-
-						/*
-						 * stamp[0] is the software timestamp
-						 * stamp[1] is deprecated
-						 * stamp[2] is the raw hardware timestamp
-						 * See chapter 2.1.2 Receive timestamps in
-						 * linux/Documentation/networking/timestamping.txt
-						 */
-						tv.tv_sec = stamp[2].tv_sec;
-						tv.tv_usec = stamp[2].tv_nsec/1000;
-					} else if (cmsg->cmsg_type == SO_RXQ_OVFL)
-						memcpy(&dropcnt[i], CMSG_DATA(cmsg), sizeof(__u32));
-				}
+					frame = &rxframes[j];
+					msg = &rxmsgs[j].msg_hdr;
+					nbytes = rxmsgs[j].msg_len;
+					idx = idx2dindex(rxaddrs[j].can_ifindex, s[i]);
 
-				/* check for (unlikely) dropped frames on this specific socket */
-				if (dropcnt[i] != last_dropcnt[i]) {
+#ifdef CONFIG_CANUTILS_CANDUMP_BINLOG
+					if (blog && devname_new[idx])
+						cblog_ifname(blog, idx, devname[idx], max_devname_len);
+#endif
+					devname_new[idx] = 0;
+
+					if ((size_t)nbytes == CAN_MTU)
+						maxdlen = CAN_MAX_DLEN;
+					else if ((size_t)nbytes == CANFD_MTU)
+						maxdlen = CANFD_MAX_DLEN;
+					else {
+						fprintf(stderr, "read: incomplete CAN frame\n");
+						return 1;
+					}
 
-					__u32 frames = dropcnt[i] - last_dropcnt[i];
+					if (count && (--count == 0))
+						running = 0;
+
+					for (cmsg = CMSG_FIRSTHDR(msg);
+					     cmsg && (cmsg->cmsg_level == SOL_SOCKET);
+					     cmsg = CMSG_NXTHDR(msg,cmsg)) {
+						if (cmsg->cmsg_type == SO_TIMESTAMP) {
+							memcpy(&tv, CMSG_DATA(cmsg), sizeof(tv));
+						} else if (cmsg->cmsg_type == SO_TIMESTAMPING) {
+
+							struct timespec *stamp = (struct timespec *)CMSG_DATA(cmsg);
+
+							/*
+							 * stamp[0] is the software timestamp
+							 * stamp[1] is deprecated
+							 * stamp[2] is the raw hardware timestamp
+							 * See chapter 2.1.2 Receive timestamps in
+							 * linux/Documentation/networking/timestamping.txt
+							 */
+							tv.tv_sec = stamp[2].tv_sec;
+							tv.tv_usec = stamp[2].tv_nsec/1000;
+						} else if (cmsg->cmsg_type == SO_RXQ_OVFL)
+							memcpy(&dropcnt[i], CMSG_DATA(cmsg), sizeof(__u32));
+					}
 
-					if (silent != SILENT_ON)
-						printf("DROPCOUNT: dropped %" PRId32 " CAN frame%s on '%s' socket (total drops %" PRId32 ")\n",
-						       (uint32_t)frames, (frames > 1)?"s":"", devname[idx], (uint32_t)dropcnt[i]);
+					/* check for (unlikely) dropped frames on this specific socket */
+					if (dropcnt[i] != last_dropcnt[i]) {
 
-					if (log)
-						fprintf(logfile, "DROPCOUNT: dropped %" PRId32 " CAN frame%s on '%s' socket (total drops %" PRId32 ")\n",
-							(uint32_t)frames, (frames > 1)?"s":"", devname[idx], (uint32_t)dropcnt[i]);
+						__u32 frames = dropcnt[i] - last_dropcnt[i];
 
-					last_dropcnt[i] = dropcnt[i];
-				}
+						if (silent != SILENT_ON)
+							printf("DROPCOUNT: dropped %" PRId32 " CAN frame%s on '%s' socket (total drops %" PRId32 ")\n",
+							       (uint32_t)frames, (frames > 1)?"s":"", devname[idx], (uint32_t)dropcnt[i]);
 
-				/* once we detected a EFF frame indent SFF frames accordingly */
-				if (frame.can_id & CAN_EFF_FLAG)
-					view |= CANLIB_VIEW_INDENT_SFF;
+						if (log)
+							fprintf(logfile, "DROPCOUNT: dropped %" PRId32 " CAN frame%s on '%s' socket (total drops %" PRId32 ")\n",
+								(uint32_t)frames, (frames > 1)?"s":"", devname[idx], (uint32_t)dropcnt[i]);
 
-				if (log) {
-					char buf[CL_CFSZ]; /* max length */
+#ifdef CONFIG_CANUTILS_CANDUMP_BINLOG
+						if (blog)
+							cblog_drop(blog, &tv, idx, frames, dropcnt[i]);
+#endif
 
-					/* log CAN frame with absolute timestamp & device */
-					sprint_canframe(buf, &frame, 0, maxdlen);
-					fprintf(logfile, "(%010ju.%06ld) %*s %s\n",
-						(uintmax_t)tv.tv_sec, tv.tv_usec,
-						max_devname_len, devname[idx], buf);
-				}
+						last_dropcnt[i] = dropcnt[i];
+					}
 
-				if ((logfrmt) && (silent == SILENT_OFF)){
-					char buf[CL_CFSZ]; /* max length */
+					/* once we detected a EFF frame indent SFF frames accordingly */
+					if (frame->can_id & CAN_EFF_FLAG)
+						view |= CANLIB_VIEW_INDENT_SFF;
 
-					/* print CAN frame in log file style to stdout */
-					sprint_canframe(buf, &frame, 0, maxdlen);
-					printf("(%010ju.%06ld) %*s %s\n",
-					       (uintmax_t)tv.tv_sec, tv.tv_usec,
-					       max_devname_len, devname[idx], buf);
-					goto out_fflush; /* no other output to stdout */
-				}
+					if (log) {
+						char buf[CL_CFSZ]; /* max length */
 
-				if (silent != SILENT_OFF){
-					if (silent == SILENT_ANI) {
-						printf("%c\b", anichar[silentani%=MAXANI]);
-						silentani++;
+						/* log CAN frame with absolute timestamp & device */
+						sprint_canframe(buf, frame, 0, maxdlen);
+						fprintf(logfile, "(%010ju.%06ld) %*s %s\n",
+							(uintmax_t)tv.tv_sec, tv.tv_usec,
+							max_devname_len, devname[idx], buf);
 					}
-					goto out_fflush; /* no other output to stdout */
-				}
 
-				printf(" %s", (color>2)?col_on[idx%MAXCOL]:"");
+#ifdef CONFIG_CANUTILS_CANDUMP_BINLOG
+					/* queue the frame, it is written out by the log thread */
+					if (blog)
+						cblog_frame(blog, &tv, idx, frame, maxdlen == CANFD_MAX_DLEN);
+#endif
 
-				switch (timestamp) {
+					if ((logfrmt) && (silent == SILENT_OFF)){
+						char buf[CL_CFSZ]; /* max length */
 
-				case 'a': /* absolute with timestamp */
-					printf("(%010ju.%06ld) ",
-						   (uintmax_t)tv.tv_sec, tv.tv_usec);
-					break;
+						/* print CAN frame in log file style to stdout */
+						sprint_canframe(buf, frame, 0, maxdlen);
+						printf("(%010ju.%06ld) %*s %s\n",
+						       (uintmax_t)tv.tv_sec, tv.tv_usec,
+						       max_devname_len, devname[idx], buf);
+						continue; /* no other output to stdout */
+					}
 
-				case 'A': /* absolute with date */
-				{
-					struct tm tm;
-					char timestring[25];
+					if (silent != SILENT_OFF){
+						if (silent == SILENT_ANI) {
+							printf("%c\b", anichar[silentani%=MAXANI]);
+							silentani++;
+						}
+						continue; /* no other output to stdout */
+					}
 
-					tm = *localtime(&tv.tv_sec);
-					strftime(timestring, 24, "%Y-%m-%d %H:%M:%S", &tm);
-					printf("(%s.%06ld) ", timestring, tv.tv_usec);
-				}
-				break;
-
-				case 'd': /* delta */
-				case 'z': /* starting with zero */
-				{
-					struct timeval diff;
-
-					if (last_tv.tv_sec == 0)   /* first init */
-						last_tv = tv;
-					diff.tv_sec  = tv.tv_sec  - last_tv.tv_sec;
-					diff.tv_usec = tv.tv_usec - last_tv.tv_usec;
-					if (diff.tv_usec < 0)
-						diff.tv_sec--, diff.tv_usec += 1000000;
-					if (diff.tv_sec < 0)
-						diff.tv_sec = diff.tv_usec = 0;
-					printf("(%03ju.%06ld) ",
-						   (uintmax_t)diff.tv_sec, diff.tv_usec);
-
-					if (timestamp == 'd')
-						last_tv = tv; /* update for delta calculation */
-				}
-				break;
+					printf(" %s", (color>2)?col_on[idx%MAXCOL]:"");
+
+					switch (timestamp) {
 
-				default: /* no timestamp output */
+					case 'a': /* absolute with timestamp */
+						printf("(%010ju.%06ld) ",
+							   (uintmax_t)tv.tv_sec, tv.tv_usec);
+						break;
+
+					case 'A': /* absolute with date */
+					{
+						struct tm tm;
+						char timestring[25];
+
+						tm = *localtime(&tv.tv_sec);
+						strftime(timestring, 24, "%Y-%m-%d %H:%M:%S", &tm);
+						printf("(%s.%06ld) ", timestring, tv.tv_usec);
+					}
 					break;
-				}
 
-				printf(" %s", (color && (color<3))?col_on[idx%MAXCOL]:"");
-				printf("%*s", max_devname_len, devname[idx]);
+					case 'd': /* delta */
+					case 'z': /* starting with zero */
+					{
+						struct timeval diff;
+
+						if (last_tv.tv_sec == 0)   /* first init */
+							last_tv = tv;
+						diff.tv_sec  = tv.tv_sec  - last_tv.tv_sec;
+						diff.tv_usec = tv.tv_usec - last_tv.tv_usec;
+						if (diff.tv_usec < 0)
+							diff.tv_sec--, diff.tv_usec += 1000000;
+						if (diff.tv_sec < 0)
+							diff.tv_sec = diff.tv_usec = 0;
+						printf("(%03ju.%06ld) ",
+							   (uintmax_t)diff.tv_sec, diff.tv_usec);
+
+						if (timestamp == 'd')
+							last_tv = tv; /* update for delta calculation */
+					}
+					break;
 
-				if (extra_msg_info) {
+					default: /* no timestamp output */
+						break;
+					}
 
-					if (msg.msg_flags & MSG_DONTROUTE)
-						printf ("  TX %s", extra_m_info[frame.flags & 3]);
-					else
-						printf ("  RX %s", extra_m_info[frame.flags & 3]);
-				}
+					printf(" %s", (color && (color<3))?col_on[idx%MAXCOL]:"");
+					printf("%*s", max_devname_len, devname[idx]);
+
+					if (extra_msg_info) {
+
+						if (msg->msg_flags & MSG_DONTROUTE)
+							printf ("  TX %s", extra_m_info[frame->flags & 3]);
+						else
+							printf ("  RX %s", extra_m_info[frame->flags & 3]);
+					}
 
-				printf("%s  ", (color==1)?col_off:"");
+					printf("%s  ", (color==1)?col_off:"");
 
-				fprint_long_canframe(stdout, &frame, NULL, view, maxdlen);
+					fprint_long_canframe(stdout, frame, NULL, view, maxdlen);
 
-				printf("%s", (color>1)?col_off:"");
-				printf("\n");
+					printf("%s", (color>1)?col_off:"");
+					printf("\n");
+				}
+
+#ifdef CONFIG_CANUTILS_CANDUMP_BINLOG
+				/* hand the whole batch to the log thread at once */
+				if (blog)
+					cblog_commit(blog);
+#endif
 			}
 
-		out_fflush:
 			fflush(stdout);
 		}
 	}
@@ -813,5 +944,20 @@ int main(int argc, char **argv)
 	if (log)
 		fclose(logfile);
 
+#ifdef CONFIG_CANUTILS_CANDUMP_BINLOG
+	if (blog) {
+		int ret = cblog_close(blog);
+
+		if (ret < 0) {
+			errno = -ret;
+			perror("binary logfile");
+			return 1;
+		}
+
+		if (ret > 0)
+			fprintf(stderr, "%d CAN frames lost, binary log buffer full\n", ret);
+	}
+#endif
+
 	return 0;
 }
@@ -0,0 +1,396 @@
+/****************************************************************************
+ * apps/canutils/candump/candump2log.c
+ *
+ * SPDX-License-Identifier: Apache-2.0
+ *
+ * Licensed to the Apache Software Foundation (ASF) under one or more
+ * contributor license agreements.  See the NOTICE file distributed with
+ * this work for additional information regarding copyright ownership.  The
+ * ASF licenses this file to you under the Apache License, Version 2.0 (the
+ * "License"); you may not use this file except in compliance with the
+ * License.  You may obtain a copy of the License at
+ *
+ *   http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS, WITHOUT
+ * WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.  See the
+ * License for the specific language governing permissions and limitations
+ * under the License.
+ *
+ ****************************************************************************/
+
+/****************************************************************************
+ * Included Files
+ ****************************************************************************/
+
+#include <nuttx/config.h>
+
+#include <inttypes.h>
+#include <stdbool.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+
+#include <net/if.h>
+#include <nuttx/can.h>
+
+#ifdef CONFIG_LIBC_LZF
+#  include <lzf.h>
+#endif
+
+#include "lib.h"
+#include "cblog.h"
+
+/****************************************************************************
+ * Pre-processor Definitions
+ ****************************************************************************/
+
+#define C2L_MAXIFNAMES      256
+
+#define C2L_SWAP16(v)       ((uint16_t)(((v) >> 8) | ((v) << 8)))
+#define C2L_SWAP32(v)       ((((v) >> 24) & 0xff) | (((v) >> 8) & 0xff00) | \
+                             (((v) << 8) & 0xff0000) | ((v) << 24))
+
+/****************************************************************************
+ * Private Types
+ ****************************************************************************/
+
+struct c2l_stream_s
+{
+  FAR FILE *in;                 /* The binary log */
+  bool lzf;                     /* Records are in LZF blocks */
+  FAR uint8_t *block;           /* Current decompressed block */
+  FAR uint8_t *cblock;          /* Current compressed block */
+  size_t blocksize;             /* Maximum block size from the header */
+  size_t len;                   /* Bytes in block */
+  size_t pos;                   /* Read position in block */
+};
+
+/****************************************************************************
+ * Private Data
+ ****************************************************************************/
+
+static char g_names[C2L_MAXIFNAMES][IFNAMSIZ + 1];
+
+/****************************************************************************
+ * Private Functions
+ ****************************************************************************/
+
+/****************************************************************************
+ * Name: c2l_usage
+ ****************************************************************************/
+
+static void c2l_usage(FAR const char *progname)
+{
+  fprintf(stderr, "Usage: %s [-o <logfile>] <binary logfile>\n", progname);
+  fprintf(stderr, "Convert a candump binary log (candump -b) to the candump "
+                  "log file format.\n");
+  fprintf(stderr, "  -o <logfile>  Write to logfile instead of stdout\n");
+}
+
+/****************************************************************************
+ * Name: c2l_nextblock
+ *
+ * Description:
+ *   Read and decompress the next LZF block.  Returns 0 at the end of the
+ *   file, 1 when a block was read and -1 on a corrupted file.
+ *
+ ****************************************************************************/
+
+static int c2l_nextblock(FAR struct c2l_stream_s *stream)
+{
+#ifdef CONFIG_LIBC_LZF
+  uint8_t header[LZF_MAX_HDR_SIZE];
+  size_t cs;
+  size_t us;
+
+  if (fread(header, 1, LZF_TYPE0_HDR_SIZE, stream->in) !=
+      LZF_TYPE0_HDR_SIZE)
+    {
+      return 0;
+    }
+
+  if (header[0] != 'Z' || header[1] != 'V')
+    {
+      return -1;
+    }
+
+  if (header[2] == 0)
+    {
+      us = (header[3] << 8) | header[4];
+      if (us > stream->blocksize ||
+          fread(stream->block, 1, us, stream->in) != us)
+        {
+          return -1;
+        }
+    }
+  else if (header[2] == 1)
+    {
+      if (fread(&header[LZF_TYPE0_HDR_SIZE], 1,
+                LZF_TYPE1_HDR_SIZE - LZF_TYPE0_HDR_SIZE, stream->in) !=
+          LZF_TYPE1_HDR_SIZE - LZF_TYPE0_HDR_SIZE)
+        {
+          return -1;
+        }
+
+      cs = (header[3] << 8) | header[4];
+      us = (header[5] << 8) | header[6];
+      if (cs > stream->blocksize || us > stream->blocksize ||
+          fread(stream->cblock, 1, cs, stream->in) != cs ||
+          lzf_decompress(stream->cblock, cs, stream->block, us) != us)
+        {
+          return -1;
+        }
+    }
+  else
+    {
+      return -1;
+    }
+
+  stream->len = us;
+  stream->pos = 0;
+  return 1;
+#else
+  return -1;
+#endif
+}
+
+/****************************************************************************
+ * Name: c2l_read
+ *
+ * Description:
+ *   Read len bytes of the record stream.  Returns 0 at the end of the file,
+ *   1 on success and -1 on a truncated or corrupted file.
+ *
+ ****************************************************************************/
+
+static int c2l_read(FAR struct c2l_stream_s *stream, FAR void *buf,
+                    size_t len)
+{
+  FAR uint8_t *ptr = buf;
+  size_t done = 0;
+  size_t chunk;
+  int ret;
+
+  if (!stream->lzf)
+    {
+      done = fread(buf, 1, len, stream->in);
+      return done == len ? 1 : done == 0 ? 0 : -1;
+    }
+
+  while (done < len)
+    {
+      if (stream->pos == stream->len)
+        {
+          ret = c2l_nextblock(stream);
+          if (ret <= 0)
+            {
+              return ret < 0 || done > 0 ? -1 : 0;
+            }
+
+          continue;
+        }
+
+      chunk = stream->len - stream->pos;
+      if (chunk > len - done)
+        {
+          chunk = len - done;
+        }
+
+      memcpy(ptr + done, &stream->block[stream->pos], chunk);
+      stream->pos += chunk;
+      done += chunk;
+    }
+
+  return 1;
+}
+
+/****************************************************************************
+ * Public Functions
+ ****************************************************************************/
+
+int main(int argc, FAR char *argv[])
+{
+  struct c2l_stream_s stream;
+  struct cblog_header_s header;
+  struct cblog_record_s rec;
+  struct canfd_frame frame;
+  char buf[CL_CFSZ];
+  FAR const char *outpath = NULL;
+  FAR FILE *out = stdout;
+  uint32_t total;
+  bool swap;
+  int namewidth;
+  int maxdlen;
+  int datalen;
+  int ret = EXIT_FAILURE;
+  int opt;
+
+  while ((opt = getopt(argc, argv, "o:h")) != -1)
+    {
+      switch (opt)
+        {
+          case 'o':
+            outpath = optarg;
+            break;
+
+          default:
+            c2l_usage(argv[0]);
+            return opt == 'h' ? EXIT_SUCCESS : EXIT_FAILURE;
+        }
+    }
+
+  if (optind != argc - 1)
+    {
+      c2l_usage(argv[0]);
+      return EXIT_FAILURE;
+    }
+
+  memset(&stream, 0, sizeof(stream));
+  stream.in = fopen(argv[optind], "rb");
+  if (stream.in == NULL)
+    {
+      perror(argv[optind]);
+      return EXIT_FAILURE;
+    }
+
+  if (fread(&header, 1, sizeof(header), stream.in) != sizeof(header) ||
+      memcmp(header.magic, CBLOG_MAGIC, sizeof(header.magic)) != 0 ||
+      (header.order != CBLOG_ORDER &&
+       header.order != C2L_SWAP16(CBLOG_ORDER)))
+    {
+      fprintf(stderr, "%s: not a candump binary log\n", argv[optind]);
+      goto errout;
+    }
+
+  if (header.version != CBLOG_VERSION)
+    {
+      fprintf(stderr, "%s: unsupported version %d\n", argv[optind],
+              header.version);
+      goto errout;
+    }
+
+  /* Logs written by a target of the other byte order are fine too */
+
+  swap = header.order != CBLOG_ORDER;
+  if (swap)
+    {
+      header.blocksize = C2L_SWAP16(header.blocksize);
+    }
+
+  namewidth = header.namewidth;
+  stream.lzf = (header.flags & CBLOG_HDR_LZF) != 0;
+  if (stream.lzf)
+    {
+#ifdef CONFIG_LIBC_LZF
+      stream.blocksize = header.blocksize;
+      stream.block = malloc(stream.blocksize);
+      stream.cblock = malloc(stream.blocksize);
+      if (stream.block == NULL || stream.cblock == NULL)
+        {
+          perror("malloc");
+          goto errout;
+        }
+#else
+      fprintf(stderr, "%s: compressed logs need CONFIG_LIBC_LZF\n",
+              argv[optind]);
+      goto errout;
+#endif
+    }
+
+  if (outpath != NULL)
+    {
+      out = fopen(outpath, "w");
+      if (out == NULL)
+        {
+          perror(outpath);
+          goto errout;
+        }
+    }
+
+  while ((ret = c2l_read(&stream, &rec, sizeof(rec))) > 0)
+    {
+      if (swap)
+        {
+          rec.sec    = C2L_SWAP32(rec.sec);
+          rec.usec   = C2L_SWAP32(rec.usec);
+          rec.can_id = C2L_SWAP32(rec.can_id);
+        }
+
+      datalen = CBLOG_DATALEN(&rec);
+      maxdlen = rec.type == CBLOG_TYPE_CANFD ? CANFD_MAX_DLEN : CAN_MAX_DLEN;
+      if (rec.type > CBLOG_TYPE_DROP ||
+          (rec.type == CBLOG_TYPE_IFNAME && rec.len > IFNAMSIZ) ||
+          (rec.type == CBLOG_TYPE_DROP && rec.len != sizeof(total)) ||
+          (rec.type <= CBLOG_TYPE_CANFD && rec.len > maxdlen))
+        {
+          ret = -1;
+          break;
+        }
+
+      memset(&frame, 0, sizeof(frame));
+      if (datalen > 0 && c2l_read(&stream, frame.data, datalen) <= 0)
+        {
+          ret = -1;
+          break;
+        }
+
+      switch (rec.type)
+        {
+          case CBLOG_TYPE_CAN:
+          case CBLOG_TYPE_CANFD:
+            frame.can_id = rec.can_id;
+            frame.len    = rec.len;
+            frame.flags  = rec.flags;
+
+            sprint_canframe(buf, &frame, 0, maxdlen);
+            fprintf(out, "(%010ju.%06ld) %*s %s\n",
+                    (uintmax_t)rec.sec, (long)rec.usec,
+                    namewidth, g_names[rec.ifidx], buf);
+            break;
+
+          case CBLOG_TYPE_IFNAME:
+            memcpy(g_names[rec.ifidx], frame.data, rec.len);
+            g_names[rec.ifidx][rec.len] = '\0';
+            namewidth = rec.can_id;
+            break;
+
+          case CBLOG_TYPE_DROP:
+            memcpy(&total, frame.data, sizeof(total));
+            if (swap)
+              {
+                total = C2L_SWAP32(total);
+              }
+
+            fprintf(out, "DROPCOUNT: dropped %" PRId32 " CAN frame%s on "
+                    "'%s' socket (total drops %" PRId32 ")\n",
+                    rec.can_id, rec.can_id > 1 ? "s" : "",
+                    g_names[rec.ifidx], total);
+            break;
+        }
+    }
+
+  if (ret < 0)
+    {
+      fprintf(stderr, "%s: truncated or corrupted log\n", argv[optind]);
+      ret = EXIT_FAILURE;
+    }
+  else
+    {
+      ret = EXIT_SUCCESS;
+    }
+
+  if (out != stdout && fclose(out) != 0)
+    {
+      perror(outpath);
+      ret = EXIT_FAILURE;
+    }
+
+errout:
+  free(stream.cblock);
+  free(stream.block);
+  fclose(stream.in);
+  return ret;
+}
@@ -0,0 +1,560 @@
+/****************************************************************************
+ * apps/canutils/candump/cblog.c
+ *
+ * SPDX-License-Identifier: Apache-2.0
+ *
+ * Licensed to the Apache Software Foundation (ASF) under one or more
+ * contributor license agreements.  See the NOTICE file distributed with
+ * this work for additional information regarding copyright ownership.  The
+ * ASF licenses this file to you under the Apache License, Version 2.0 (the
+ * "License"); you may not use this file except in compliance with the
+ * License.  You may obtain a copy of the License at
+ *
+ *   http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS, WITHOUT
+ * WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.  See the
+ * License for the specific language governing permissions and limitations
+ * under the License.
+ *
+ ****************************************************************************/
+
+/****************************************************************************
+ * Included Files
+ ****************************************************************************/
+
+#include <nuttx/config.h>
+
+#include <errno.h>
+#include <fcntl.h>
+#include <pthread.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+#include <unistd.h>
+
+#include <net/if.h>
+
+#ifdef CONFIG_LIBC_LZF
+#  include <lzf.h>
+#endif
+
+#include "cblog.h"
+
+/****************************************************************************
+ * Pre-processor Definitions
+ ****************************************************************************/
+
+/* Longest time a record waits in the ring before it is written */
+
+#define CBLOG_FLUSH_MS      1000
+
+/****************************************************************************
+ * Private Types
+ ****************************************************************************/
+
+struct cblog_s
+{
+  int fd;                       /* The log file */
+  int error;                    /* First write error, a negated errno */
+  bool stop;                    /* Set by cblog_close() */
+  pthread_t thread;             /* The writer thread */
+  pthread_mutex_t lock;         /* Protects head, tail, stop and error */
+  pthread_cond_t cond;          /* Signals new data and freed space */
+
+  /* The ring.  Positions only ever grow and are masked on access.  The
+   * receiving task owns wpos and tailcache and takes the lock once per
+   * batch to publish head.  The writer owns tail.
+   */
+
+  FAR uint8_t *ring;
+  size_t mask;                  /* Ring size - 1 */
+  size_t blocksize;             /* Bytes written at once */
+  size_t head;                  /* End of the data handed to the writer */
+  size_t tail;                  /* End of the data written out */
+  size_t wpos;                  /* End of the queued data */
+  size_t tailcache;             /* Copy of tail seen by the producer */
+  uint32_t lost;                /* Records dropped, ring full */
+
+#ifdef CONFIG_LIBC_LZF
+  FAR uint8_t *inbuf;           /* Block to compress */
+  FAR uint8_t *outbuf;          /* Compressed block */
+  FAR lzf_state_t *htab;        /* Compressor state */
+#endif
+};
+
+/****************************************************************************
+ * Private Functions
+ ****************************************************************************/
+
+/****************************************************************************
+ * Name: cblog_writeall
+ ****************************************************************************/
+
+static int cblog_writeall(int fd, FAR const void *buf, size_t len)
+{
+  FAR const uint8_t *ptr = buf;
+  ssize_t ret;
+
+  while (len > 0)
+    {
+      ret = write(fd, ptr, len);
+      if (ret < 0)
+        {
+          if (errno == EINTR)
+            {
+              continue;
+            }
+
+          return -errno;
+        }
+
+      ptr += ret;
+      len -= ret;
+    }
+
+  return 0;
+}
+
+/****************************************************************************
+ * Name: cblog_writeblock
+ *
+ * Description:
+ *   Write len bytes of the ring starting at position pos, compressed when
+ *   the log was opened with compression.
+ *
+ ****************************************************************************/
+
+static int cblog_writeblock(FAR struct cblog_s *log, size_t pos,
+                            size_t len)
+{
+  size_t off = pos & log->mask;
+  size_t first = log->mask + 1 - off;
+  int ret;
+
+  if (first > len)
+    {
+      first = len;
+    }
+
+#ifdef CONFIG_LIBC_LZF
+  if (log->htab != NULL)
+    {
+      FAR struct lzf_header_s *header;
+      FAR uint8_t *in = &log->inbuf[LZF_MAX_HDR_SIZE];
+      size_t clen;
+
+      /* lzf_compress() needs the block in one piece, with room for a
+       * header in front of it in case it is stored uncompressed.
+       */
+
+      memcpy(in, &log->ring[off], first);
+      memcpy(in + first, log->ring, len - first);
+
+      clen = lzf_compress(in, len, &log->outbuf[LZF_MAX_HDR_SIZE],
+                          len > 4 ? len - 4 : len, *log->htab, &header);
+      return cblog_writeall(log->fd, header, clen);
+    }
+#endif
+
+  ret = cblog_writeall(log->fd, &log->ring[off], first);
+  if (ret >= 0 && len > first)
+    {
+      ret = cblog_writeall(log->fd, log->ring, len - first);
+    }
+
+  return ret;
+}
+
+/****************************************************************************
+ * Name: cblog_writer
+ *
+ * Description:
+ *   The writer thread.  Waits for a full block, or for CBLOG_FLUSH_MS on a
+ *   quiet bus, and writes it out without holding the lock.
+ *
+ ****************************************************************************/
+
+static FAR void *cblog_writer(FAR void *arg)
+{
+  FAR struct cblog_s *log = arg;
+  struct timespec abstime;
+  size_t len;
+  size_t pos;
+  int ret;
+
+  pthread_mutex_lock(&log->lock);
+  for (; ; )
+    {
+      if (log->head - log->tail < log->blocksize && !log->stop)
+        {
+          clock_gettime(CLOCK_REALTIME, &abstime);
+          abstime.tv_sec  += CBLOG_FLUSH_MS / 1000;
+          abstime.tv_nsec += (CBLOG_FLUSH_MS % 1000) * 1000000;
+          if (abstime.tv_nsec >= 1000000000)
+            {
+              abstime.tv_sec++;
+              abstime.tv_nsec -= 1000000000;
+            }
+
+          pthread_cond_timedwait(&log->cond, &log->lock, &abstime);
+        }
+
+      len = log->head - log->tail;
+      if (len == 0)
+        {
+          if (log->stop)
+            {
+              break;
+            }
+
+          continue;
+        }
+
+      if (len > log->blocksize)
+        {
+          len = log->blocksize;
+        }
+
+      pos = log->tail;
+      pthread_mutex_unlock(&log->lock);
+
+      ret = cblog_writeblock(log, pos, len);
+
+      pthread_mutex_lock(&log->lock);
+      if (ret < 0)
+        {
+          /* Keep consuming so that the receiver is never blocked, but
+           * remember the error for cblog_close().
+           */
+
+          if (log->error == 0)
+            {
+              log->error = ret;
+            }
+        }
+
+      log->tail += len;
+      pthread_cond_broadcast(&log->cond);
+    }
+
+  pthread_mutex_unlock(&log->lock);
+  return NULL;
+}
+
+/****************************************************************************
+ * Name: cblog_put
+ *
+ * Description:
+ *   Queue a record and its payload.  When the ring is full the record is
+ *   dropped, unless wait is set: then the writer is kicked and waited for.
+ *
+ ****************************************************************************/
+
+static int cblog_put(FAR struct cblog_s *log,
+                     FAR const struct cblog_record_s *rec,
+                     FAR const void *data, size_t datalen, bool wait)
+{
+  static const uint8_t pad[4];
+  size_t size = sizeof(*rec) + CBLOG_DATALEN(rec);
+  size_t off;
+  size_t first;
+
+  if (log->mask + 1 - (log->wpos - log->tailcache) < size)
+    {
+      pthread_mutex_lock(&log->lock);
+      if (wait)
+        {
+          log->head = log->wpos;
+          pthread_cond_broadcast(&log->cond);
+          while (log->mask + 1 - (log->wpos - log->tail) < size)
+            {
+              pthread_cond_wait(&log->cond, &log->lock);
+            }
+        }
+
+      log->tailcache = log->tail;
+      pthread_mutex_unlock(&log->lock);
+
+      if (log->mask + 1 - (log->wpos - log->tailcache) < size)
+        {
+          log->lost++;
+          return -ENOSPC;
+        }
+    }
+
+  /* Copy the record, its payload and the padding, wrapping at the end of
+   * the ring.
+   */
+
+  while (size > 0)
+    {
+      FAR const uint8_t *src;
+      size_t len;
+
+      if (rec != NULL)
+        {
+          src = (FAR const uint8_t *)rec;
+          len = sizeof(*rec);
+          rec = NULL;
+        }
+      else if (datalen > 0)
+        {
+          src = data;
+          len = datalen;
+          datalen = 0;
+        }
+      else
+        {
+          src = pad;
+          len = size;
+        }
+
+      off = log->wpos & log->mask;
+      first = log->mask + 1 - off;
+      if (first > len)
+        {
+          first = len;
+        }
+
+      memcpy(&log->ring[off], src, first);
+      memcpy(log->ring, src + first, len - first);
+      log->wpos += len;
+      size -= len;
+    }
+
+  return 0;
+}
+
+/****************************************************************************
+ * Public Functions
+ ****************************************************************************/
+
+/****************************************************************************
+ * Name: cblog_open
+ ****************************************************************************/
+
+FAR struct cblog_s *cblog_open(FAR const char *path, int ringbits,
+                               int blocksize, bool compress,
+                               int namewidth)
+{
+  struct cblog_header_s header;
+  FAR struct cblog_s *log;
+  int ret;
+
+  log = calloc(1, sizeof(*log));
+  if (log == NULL)
+    {
+      return NULL;
+    }
+
+  /* Leave room for the producer to work while a block is written */
+
+  log->mask = ((size_t)1 << ringbits) - 1;
+  log->blocksize = blocksize;
+  if (log->blocksize > (log->mask + 1) / 2)
+    {
+      log->blocksize = (log->mask + 1) / 2;
+    }
+
+  log->ring = malloc(log->mask + 1);
+  if (log->ring == NULL)
+    {
+      goto errout;
+    }
+
+  if (compress)
+    {
+#ifdef CONFIG_LIBC_LZF
+      log->inbuf = malloc(log->blocksize + LZF_MAX_HDR_SIZE + 16);
+      log->outbuf = malloc(log->blocksize + LZF_MAX_HDR_SIZE + 16);
+      log->htab = malloc(sizeof(lzf_state_t));
+      if (log->inbuf == NULL || log->outbuf == NULL || log->htab == NULL)
+        {
+          goto errout;
+        }
+#else
+      errno = ENOSYS;
+      goto errout;
+#endif
+    }
+
+  log->fd = open(path, O_WRONLY | O_CREAT | O_TRUNC, 0644);
+  if (log->fd < 0)
+    {
+      goto errout;
+    }
+
+  memcpy(header.magic, CBLOG_MAGIC, sizeof(header.magic));
+  header.order     = CBLOG_ORDER;
+  header.version   = CBLOG_VERSION;
+  header.flags     = compress ? CBLOG_HDR_LZF : 0;
+  header.blocksize = log->blocksize;
+  header.namewidth = namewidth;
+  header.reserved  = 0;
+
+  ret = cblog_writeall(log->fd, &header, sizeof(header));
+  if (ret < 0)
+    {
+      errno = -ret;
+      goto errout_with_fd;
+    }
+
+  pthread_mutex_init(&log->lock, NULL);
+  pthread_cond_init(&log->cond, NULL);
+
+  ret = pthread_create(&log->thread, NULL, cblog_writer, log);
+  if (ret != 0)
+    {
+      pthread_cond_destroy(&log->cond);
+      pthread_mutex_destroy(&log->lock);
+      errno = ret;
+      goto errout_with_fd;
+    }
+
+  pthread_setname_np(log->thread, "candump_log");
+  return log;
+
+errout_with_fd:
+  close(log->fd);
+  unlink(path);
+
+errout:
+#ifdef CONFIG_LIBC_LZF
+  free(log->htab);
+  free(log->outbuf);
+  free(log->inbuf);
+#endif
+  free(log->ring);
+  free(log);
+  return NULL;
+}
+
+/****************************************************************************
+ * Name: cblog_frame
+ ****************************************************************************/
+
+int cblog_frame(FAR struct cblog_s *log, FAR const struct timeval *tv,
+                int ifidx, FAR const struct canfd_frame *frame, bool fd)
+{
+  struct cblog_record_s rec;
+
+  rec.sec    = tv->tv_sec;
+  rec.usec   = tv->tv_usec;
+  rec.can_id = frame->can_id;
+  rec.type   = fd ? CBLOG_TYPE_CANFD : CBLOG_TYPE_CAN;
+  rec.ifidx  = ifidx;
+  rec.flags  = fd ? frame->flags : 0;
+  rec.len    = frame->len;
+
+  if (rec.len > (fd ? CANFD_MAX_DLEN : CAN_MAX_DLEN))
+    {
+      rec.len = fd ? CANFD_MAX_DLEN : CAN_MAX_DLEN;
+    }
+
+  return cblog_put(log, &rec, frame->data,
+                   rec.type == CBLOG_TYPE_CAN &&
+                   (rec.can_id & CAN_RTR_FLAG) ? 0 : rec.len, false);
+}
+
+/****************************************************************************
+ * Name: cblog_ifname
+ ****************************************************************************/
+
+int cblog_ifname(FAR struct cblog_s *log, int ifidx, FAR const char *name,
+                 int namewidth)
+{
+  struct cblog_record_s rec;
+
+  memset(&rec, 0, sizeof(rec));
+  rec.can_id = namewidth;
+  rec.type   = CBLOG_TYPE_IFNAME;
+  rec.ifidx  = ifidx;
+  rec.len    = strnlen(name, IFNAMSIZ);
+
+  return cblog_put(log, &rec, name, rec.len, true);
+}
+
+/****************************************************************************
+ * Name: cblog_drop
+ ****************************************************************************/
+
+int cblog_drop(FAR struct cblog_s *log, FAR const struct timeval *tv,
+               int ifidx, uint32_t frames, uint32_t total)
+{
+  struct cblog_record_s rec;
+
+  rec.sec    = tv->tv_sec;
+  rec.usec   = tv->tv_usec;
+  rec.can_id = frames;
+  rec.type   = CBLOG_TYPE_DROP;
+  rec.ifidx  = ifidx;
+  rec.flags  = 0;
+  rec.len    = sizeof(total);
+
+  return cblog_put(log, &rec, &total, sizeof(total), false);
+}
+
+/****************************************************************************
+ * Name: cblog_commit
+ ****************************************************************************/
+
+void cblog_commit(FAR struct cblog_s *log)
+{
+  pthread_mutex_lock(&log->lock);
+
+  /* Only wake the writer for full blocks, partial ones are flushed when it
+   * times out.
+   */
+
+  if ((log->wpos - log->tail) / log->blocksize >
+      (log->head - log->tail) / log->blocksize)
+    {
+      pthread_cond_broadcast(&log->cond);
+    }
+
+  log->head = log->wpos;
+  log->tailcache = log->tail;
+  pthread_mutex_unlock(&log->lock);
+}
+
+/****************************************************************************
+ * Name: cblog_close
+ ****************************************************************************/
+
+int cblog_close(FAR struct cblog_s *log)
+{
+  int ret;
+
+  pthread_mutex_lock(&log->lock);
+  log->head = log->wpos;
+  log->stop = true;
+  pthread_cond_broadcast(&log->cond);
+  pthread_mutex_unlock(&log->lock);
+
+  pthread_join(log->thread, NULL);
+  pthread_cond_destroy(&log->cond);
+  pthread_mutex_destroy(&log->lock);
+
+  ret = log->error;
+  if (close(log->fd) < 0 && ret == 0)
+    {
+      ret = -errno;
+    }
+
+  if (ret == 0)
+    {
+      ret = log->lost;
+    }
+
+#ifdef CONFIG_LIBC_LZF
+  free(log->htab);
+  free(log->outbuf);
+  free(log->inbuf);
+#endif
+  free(log->ring);
+  free(log);
+  return ret;
+}
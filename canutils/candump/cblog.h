@@ -0,0 +1,155 @@
+/****************************************************************************
+ * apps/canutils/candump/cblog.h
+ *
+ * SPDX-License-Identifier: Apache-2.0
+ *
+ * Licensed to the Apache Software Foundation (ASF) under one or more
+ * contributor license agreements.  See the NOTICE file distributed with
+ * this work for additional information regarding copyright ownership.  The
+ * ASF licenses this file to you under the Apache License, Version 2.0 (the
+ * "License"); you may not use this file except in compliance with the
+ * License.  You may obtain a copy of the License at
+ *
+ *   http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS, WITHOUT
+ * WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.  See the
+ * License for the specific language governing permissions and limitations
+ * under the License.
+ *
+ ****************************************************************************/
+
+#ifndef __APPS_CANUTILS_CANDUMP_CBLOG_H
+#define __APPS_CANUTILS_CANDUMP_CBLOG_H
+
+/****************************************************************************
+ * Included Files
+ ****************************************************************************/
+
+#include <nuttx/config.h>
+
+#include <stdbool.h>
+#include <stdint.h>
+#include <sys/time.h>
+
+#include <nuttx/can.h>
+
+/****************************************************************************
+ * Pre-processor Definitions
+ ****************************************************************************/
+
+/* Anatomy: a candump binary log starts with a struct cblog_header_s.
+ * The rest of the file is a stream of records, each one a struct
+ * cblog_record_s followed by CBLOG_DATALEN() bytes of payload.  When
+ * CBLOG_HDR_LZF is set the stream is split in blocks of at most
+ * cblog_header_s::blocksize bytes, each stored as an LZF block in the
+ * format of the lzf tool ("ZV\0" or "ZV\1" header).  Records may straddle
+ * blocks.  All fields use the byte order of the target that wrote the log,
+ * which can be told by cblog_header_s::order.
+ */
+
+#define CBLOG_MAGIC         "CBLG"
+#define CBLOG_VERSION       1
+#define CBLOG_ORDER         0x0102
+
+/* cblog_header_s::flags */
+
+#define CBLOG_HDR_LZF       (1 << 0)  /* Record stream is LZF compressed */
+
+/* cblog_record_s::type */
+
+#define CBLOG_TYPE_CAN      0  /* Classic CAN frame */
+#define CBLOG_TYPE_CANFD    1  /* CAN FD frame */
+#define CBLOG_TYPE_IFNAME   2  /* Name of interface ifidx, see below */
+#define CBLOG_TYPE_DROP     3  /* Frames dropped by the socket */
+
+/* Payload length of a record, padded so records stay 32-bit aligned.
+ *
+ * CAN, CANFD: len is the frame length and the payload the frame data.
+ *             Remote frames carry no data.
+ * IFNAME:     can_id is the width of the interface name column from now
+ *             on, len the length of the name that is the payload.
+ * DROP:       can_id is the number of frames dropped, the payload is the
+ *             32-bit total of drops on the socket.
+ */
+
+#define CBLOG_DATALEN(r) \
+  ((((r)->type == CBLOG_TYPE_CAN && ((r)->can_id & CAN_RTR_FLAG)) ? \
+    0 : (r)->len + 3) & ~3)
+
+/****************************************************************************
+ * Public Types
+ ****************************************************************************/
+
+struct cblog_header_s
+{
+  uint8_t  magic[4];            /* CBLOG_MAGIC */
+  uint16_t order;               /* CBLOG_ORDER */
+  uint8_t  version;             /* CBLOG_VERSION */
+  uint8_t  flags;               /* CBLOG_HDR_* */
+  uint16_t blocksize;           /* Maximum uncompressed block size */
+  uint8_t  namewidth;           /* Initial interface name column width */
+  uint8_t  reserved;
+};
+
+struct cblog_record_s
+{
+  uint32_t sec;                 /* Receive timestamp */
+  uint32_t usec;
+  uint32_t can_id;              /* CAN id including the EFF/RTR/ERR flags */
+  uint8_t  type;                /* CBLOG_TYPE_* */
+  uint8_t  ifidx;               /* Index in the interface name table */
+  uint8_t  flags;               /* CAN FD flags */
+  uint8_t  len;                 /* Data length */
+};
+
+struct cblog_s;
+
+/****************************************************************************
+ * Public Function Prototypes
+ ****************************************************************************/
+
+/* Create the log file and start its writer thread.
+ *
+ * Records are queued in a ring buffer of 2^ringbits bytes by the caller
+ * and written out by the thread in blocks of blocksize bytes, or less when
+ * the bus is quiet, so that the receiving task never waits on storage.
+ */
+
+FAR struct cblog_s *cblog_open(FAR const char *path, int ringbits,
+                               int blocksize, bool compress,
+                               int namewidth);
+
+/* Queue a received frame.  Returns -ENOSPC when the ring is full, the
+ * frame is then lost and counted by cblog_close().
+ */
+
+int cblog_frame(FAR struct cblog_s *log, FAR const struct timeval *tv,
+                int ifidx, FAR const struct canfd_frame *frame, bool fd);
+
+/* Queue the name of interface ifidx.  This waits for room in the ring,
+ * the converter needs every name to resolve the frames that follow.
+ */
+
+int cblog_ifname(FAR struct cblog_s *log, int ifidx, FAR const char *name,
+                 int namewidth);
+
+/* Queue a socket drop count report */
+
+int cblog_drop(FAR struct cblog_s *log, FAR const struct timeval *tv,
+               int ifidx, uint32_t frames, uint32_t total);
+
+/* Hand the records queued so far to the writer thread.  Call it once per
+ * receive batch.
+ */
+
+void cblog_commit(FAR struct cblog_s *log);
+
+/* Flush all queued records, stop the writer and close the file.  Returns
+ * the number of records lost to a full ring, or a negated errno.
+ */
+
+int cblog_close(FAR struct cblog_s *log);
+
+#endif /* __APPS_CANUTILS_CANDUMP_CBLOG_H */
@@ -26,6 +26,7 @@
 
 #include <nuttx/config.h>
 
+#include <inttypes.h>
 #include <stdint.h>
 #include <stdio.h>
 #include <unistd.h>
@@ -58,6 +59,14 @@
 #define DEFAULT_PRIORITY 100
 #define DEFAULT_STACK_SIZE 2048
 
+#ifndef CONFIG_CANUTILS_SLCAN_BURST
+#  define CONFIG_CANUTILS_SLCAN_BURST 16
+#endif
+
+/* The timestamp of received frames wraps every minute */
+
+#define SLCAN_TIMESTAMP_WRAP 60000
+
 #ifdef CONFIG_SLCAN_TRACE
 #  define DEBUG 1
 #else
@@ -72,6 +81,36 @@
     } \
   while (0)
 
+
+/****************************************************************************
+ * Private Types
+ ****************************************************************************/
+
+struct slcan_s
+{
+  FAR const char *candev;       /* CAN interface name */
+  int s;                        /* CAN socket */
+  int mode;                     /* 0: closed, 1: open */
+  bool autopoll;                /* Forward frames without P/A commands */
+  bool timestamp;               /* Append timestamps to received frames */
+  uint8_t flags;                /* SLCAN_* status, cleared when read */
+  int reccount;
+
+  /* CAN receive */
+
+  struct sockaddr_can addr;
+  struct canfd_frame frame;
+  struct msghdr msg;
+  struct iovec iov;
+  char ctrlmsg[CMSG_SPACE(sizeof(struct timeval) +
+                          3 * sizeof(struct timespec) + sizeof(int))];
+
+  /* Serial line */
+
+  struct slcan_rxbuf_s rx;
+  struct slcan_txbuf_s tx;
+};
+
 /****************************************************************************
  * private data
  ****************************************************************************/
@@ -82,84 +121,52 @@ static char opening[] = "starting slcan\n";
 static char opening[] = "";
 #endif
 
-static void ok_return(int fd)
-{
-  write(fd, "\r", 1);
-}
-
-static void fail_return(int fd)
+static void ok_return(FAR struct slcan_s *slcan)
 {
-  write(fd, "\a", 1); /* BELL return for error */
+  slcan_txput(&slcan->tx, "\r", 1);
 }
 
-static int readlinebuffer(int fd, char *buf, int maxlen)
+static void fail_return(FAR struct slcan_s *slcan)
 {
-  size_t n;
-  int meslen = 0;
-  int noeol  = 1;
-  uint8_t ch;
-
-  while ((meslen < maxlen) && noeol)
-    {
-      n = read(fd, &ch, 1);
-      if (n > 0)
-        {
-          /* valid input */
-
-          if (ch == '\r')
-            {
-              noeol = 0;
-              *buf  = '\0';
-            }
-          else
-            {
-              *buf++ = ch;
-              meslen++;
-            }
-        }
-      else
-        {
-          return (meslen);
-        }
-    }
-  return (meslen);
+  slcan_txput(&slcan->tx, "\a", 1); /* BELL return for error */
 }
 
-static int caninit(char *candev, int *s, struct sockaddr_can *addr,
-                   char *ctrlmsg, struct canfd_frame *frame,
-                   struct msghdr *msg, struct iovec *iov)
+static int caninit(FAR struct slcan_s *slcan)
 {
   struct ifreq ifr;
 
   debug_print("slcanBus\n");
-  if ((*s = socket(PF_CAN, SOCK_RAW, CAN_RAW)) < 0)
+  if ((slcan->s = socket(PF_CAN, SOCK_RAW, CAN_RAW)) < 0)
     {
       syslog(LOG_ERR, "Error opening CAN socket\n");
       return -1;
     }
-  strlcpy(ifr.ifr_name, candev, IFNAMSIZ);
+
+  strlcpy(ifr.ifr_name, slcan->candev, IFNAMSIZ);
   ifr.ifr_ifindex = if_nametoindex(ifr.ifr_name);
   if (!ifr.ifr_ifindex)
     {
-      syslog(LOG_ERR, "error finding index %s\n", candev);
+      syslog(LOG_ERR, "error finding index %s\n", slcan->candev);
       return -1;
     }
-  memset(addr, 0, sizeof(struct sockaddr));
-  addr->can_family  = AF_CAN;
-  addr->can_ifindex = ifr.ifr_ifindex;
-  setsockopt(*s, SOL_CAN_RAW, CAN_RAW_FILTER, NULL, 0);
 
-  if (bind(*s, (struct sockaddr *)addr, sizeof(struct sockaddr)) < 0)
+  memset(&slcan->addr, 0, sizeof(slcan->addr));
+  slcan->addr.can_family  = AF_CAN;
+  slcan->addr.can_ifindex = ifr.ifr_ifindex;
+  setsockopt(slcan->s, SOL_CAN_RAW, CAN_RAW_FILTER, NULL, 0);
+
+  if (bind(slcan->s, (struct sockaddr *)&slcan->addr,
+           sizeof(struct sockaddr)) < 0)
     {
       syslog(LOG_ERR, "bind error\n");
       return -1;
     }
 
-  iov->iov_base    = frame;
-  msg->msg_name    = addr;
-  msg->msg_iov     = iov;
-  msg->msg_iovlen  = 1;
-  msg->msg_control = ctrlmsg;
+  slcan->iov.iov_base    = &slcan->frame;
+  slcan->msg.msg_name    = &slcan->addr;
+  slcan->msg.msg_iov     = &slcan->iov;
+  slcan->msg.msg_iovlen  = 1;
+  slcan->msg.msg_control = slcan->ctrlmsg;
 
   /* CAN interface ready to be used */
 
@@ -169,39 +176,324 @@ static int caninit(char *candev, int *s, struct sockaddr_can *addr,
 }
 
 /****************************************************************************
- * Public Functions
+ * Name: slcan_recvframe
+ *
+ * Description:
+ *   Fetch one pending frame from the CAN socket, without waiting, and queue
+ *   it for the serial line.  Returns 1 when a frame was queued, 0 when
+ *   none is pending.
+ *
  ****************************************************************************/
 
+static int slcan_recvframe(FAR struct slcan_s *slcan)
+{
+  struct timespec ts;
+  int timestamp = -1;
+  int nbytes;
+
+  do
+    {
+      slcan->iov.iov_len        = sizeof(slcan->frame);
+      slcan->msg.msg_namelen    = sizeof(slcan->addr);
+      slcan->msg.msg_controllen = sizeof(slcan->ctrlmsg);
+      slcan->msg.msg_flags      = 0;
+      nbytes = recvmsg(slcan->s, &slcan->msg, MSG_DONTWAIT);
+      if (nbytes < 0)
+        {
+          return 0;
+        }
+    }
+  while (nbytes != CAN_MTU);  /* CAN FD frames can not be forwarded */
+
+  slcan->reccount++;
+  debug_print("R%d, Id:0x%" PRIx32 "\n",
+              slcan->reccount, slcan->frame.can_id);
+
+  if (slcan->timestamp)
+    {
+      clock_gettime(CLOCK_MONOTONIC, &ts);
+      timestamp = (ts.tv_sec % (SLCAN_TIMESTAMP_WRAP / 1000)) * 1000 +
+                  ts.tv_nsec / 1000000;
+    }
+
+  slcan_txcommit(&slcan->tx,
+                 slcan_encode(slcan_txreserve(&slcan->tx, SLCAN_MAXFRAME),
+                              (FAR struct can_frame *)&slcan->frame,
+                              timestamp));
+  return 1;
+}
+
 /****************************************************************************
- * Name: slcan_main
+ * Name: slcan_setspeed
  ****************************************************************************/
 
-int main(int argc, char *argv[])
+static void slcan_setspeed(FAR struct slcan_s *slcan, char code)
 {
-  /* UART */
+  static const int speeds[] =
+  {
+    10000, 20000, 50000, 100000, 125000, 250000, 500000, 800000, 1000000
+  };
 
-  char buf[31];
-  int mode = 0;
-  size_t n;
+  struct ifreq ifr;
   int canspeed = 1000000; /* default to 1MBps */
-  int fd;                 /* UART slcan channel */
 
-  /* CAN */
+  if (code >= '0' && code <= '8')
+    {
+      canspeed = speeds[code - '0'];
+    }
+
+  /* set the device name */
 
-  int s;
-  int nbytes;
+  strlcpy(ifr.ifr_name, slcan->candev, IFNAMSIZ);
+  ifr.ifr_ifru.ifru_can_data.arbi_bitrate = canspeed;
+  ifr.ifr_ifru.ifru_can_data.arbi_samplep = 80;
+
+  if (ioctl(slcan->s, SIOCSCANBITRATE, &ifr) < 0)
+    {
+      syslog(LOG_ERR, "set speed %d failed\n", canspeed);
+      fail_return(slcan);
+    }
+  else
+    {
+      debug_print("set speed %d\n", canspeed);
+      ok_return(slcan);
+    }
+}
+
+/****************************************************************************
+ * Name: slcan_setup
+ *
+ * Description:
+ *   Open (O) or close (C) the CAN interface.
+ *
+ ****************************************************************************/
+
+static void slcan_setup(FAR struct slcan_s *slcan, bool up)
+{
+  struct ifreq ifr;
+
+  strlcpy(ifr.ifr_name, slcan->candev, IFNAMSIZ);
+
+  ifr.ifr_flags = up ? IFF_UP : 0;
+  if (ioctl(slcan->s, SIOCSIFFLAGS, &ifr) < 0)
+    {
+      syslog(LOG_ERR, "%s interface failed\n", up ? "Open" : "Close");
+      fail_return(slcan);
+    }
+  else
+    {
+      slcan->mode = up;
+      debug_print("%s interface\n", up ? "Open" : "Close");
+      ok_return(slcan);
+    }
+}
+
+/****************************************************************************
+ * Name: slcan_transmit
+ ****************************************************************************/
+
+static void slcan_transmit(FAR struct slcan_s *slcan, FAR const char *line,
+                           int len)
+{
+  struct can_frame frame;
   int i;
-  int ret;
-  int reccount = 0;
-  struct sockaddr_can addr;
-  struct canfd_frame frame;
-  struct msghdr msg;
-  struct iovec iov;
+
+  if (slcan_decode(line, len, &frame) < 0)
+    {
+      fail_return(slcan);
+      return;
+    }
+
+  debug_print("Transmitt: 0x%" PRIX32 " ", frame.can_id & CAN_EFF_MASK);
+  for (i = 0; i < frame.can_dlc; i++)
+    {
+      debug_print("0x%02X ", frame.data[i]);
+    }
+
+  debug_print("\n");
+
+  if (write(slcan->s, &frame, CAN_MTU) != CAN_MTU)
+    {
+      syslog(LOG_ERR, "transmitt error\n");
+      slcan->flags |= SLCAN_SND_FIFO_FULL;
+      fail_return(slcan);
+      return;
+    }
+
+  ok_return(slcan);
+}
+
+/****************************************************************************
+ * Name: slcan_status
+ *
+ * Description:
+ *   Reply to F with the status flags collected since the last F, then
+ *   clear them.
+ *
+ ****************************************************************************/
+
+static void slcan_status(FAR struct slcan_s *slcan)
+{
+  char reply[5];
+
+  snprintf(reply, sizeof(reply), "F%02X\r", slcan->flags);
+  slcan_txput(&slcan->tx, reply, 4);
+  slcan->flags = 0;
+}
+
+/****************************************************************************
+ * Name: slcan_command
+ *
+ * Description:
+ *   Execute one command line.  Besides the Lawicel basics this handles the
+ *   polled mode used by most adapters to move frames in bursts:  X0
+ *   disables the automatic forwarding of received frames, P then fetches
+ *   one and A all pending frames at once, terminated with "A\r".
+ *
+ ****************************************************************************/
+
+static void slcan_command(FAR struct slcan_s *slcan, FAR const char *buf,
+                          int len)
+{
+  if (len < 0)
+    {
+      /* Overlong line */
+
+      slcan->flags |= SLCAN_DATA_OVERRUN;
+      fail_return(slcan);
+      return;
+    }
+
+  if (len == 0)
+    {
+      return;
+    }
+
+  switch (slcan->mode)
+    {
+    case 0: /* CAN channel not open */
+      if (buf[0] == 'F')
+        {
+          /* return and clear status flags */
+
+          slcan_status(slcan);
+        }
+      else if (buf[0] == 'O')
+        {
+          /* open CAN interface */
+
+          slcan_setup(slcan, true);
+        }
+      else if (buf[0] == 'S')
+        {
+          /* set CAN interface speed */
+
+          slcan_setspeed(slcan, buf[1]);
+        }
+      else if (buf[0] == 'X' || buf[0] == 'Z')
+        {
+          /* auto poll and timestamp on/off */
+
+          if (buf[1] != '0' && buf[1] != '1')
+            {
+              fail_return(slcan);
+              return;
+            }
+
+          if (buf[0] == 'X')
+            {
+              slcan->autopoll = buf[1] == '1';
+            }
+          else
+            {
+              slcan->timestamp = buf[1] == '1';
+            }
+
+          ok_return(slcan);
+        }
+      else
+        {
+          /* whatever */
+
+          ok_return(slcan);
+        }
+      break;
+
+    case 1: /* CAN task running open interface */
+      if (buf[0] == 'C')
+        {
+          /* close interface */
+
+          slcan_setup(slcan, false);
+        }
+      else if (buf[0] == 'T' || buf[0] == 't' ||
+               buf[0] == 'R' || buf[0] == 'r')
+        {
+          /* Transmit a 29 or 11 bit CAN data or remote frame */
+
+          slcan_transmit(slcan, buf, len);
+        }
+      else if (buf[0] == 'P' || buf[0] == 'A')
+        {
+          /* Poll one or all received frames */
+
+          if (slcan->autopoll)
+            {
+              fail_return(slcan);
+            }
+          else if (buf[0] == 'P')
+            {
+              if (!slcan_recvframe(slcan))
+                {
+                  ok_return(slcan);
+                }
+            }
+          else
+            {
+              while (slcan_recvframe(slcan))
+                {
+                }
+
+              slcan_txput(&slcan->tx, "A\r", 2);
+            }
+        }
+      else if (buf[0] == 'F')
+        {
+          /* return and clear status flags */
+
+          slcan_status(slcan);
+        }
+      else
+        {
+          /* whatever */
+
+          ok_return(slcan);
+        }
+      break;
+
+    default: /* should not happen */
+      slcan->mode = 100;
+      break;
+    }
+}
+
+/****************************************************************************
+ * Public Functions
+ ****************************************************************************/
+
+/****************************************************************************
+ * Name: slcan_main
+ ****************************************************************************/
+
+int main(int argc, char *argv[])
+{
+  FAR struct slcan_s *slcan;
+  FAR char *line;
   fd_set rdfs;
-  char ctrlmsg[CMSG_SPACE(sizeof(struct timeval) +
-                          3 * sizeof(struct timespec) + sizeof(int))];
-  char sbuf[40];
-  char *sbp;
+  int maxfd;
+  int len;
+  int fd;   /* UART slcan channel */
+  int i;
 
   if (argc != 3)
     {
@@ -213,325 +505,96 @@ int main(int argc, char *argv[])
   char *chrdev = argv[2];
   char *candev = argv[1];
 
+  /* The buffers are too large for the stack */
+
+  slcan = calloc(1, sizeof(*slcan));
+  if (slcan == NULL)
+    {
+      syslog(LOG_ERR, "Failed to allocate slcan state\n");
+      return -1;
+    }
+
+  slcan->candev   = candev;
+  slcan->autopoll = true;
+
   debug_print("Starting slcan on NuttX\n");
   fd = open(chrdev, O_RDWR);
   if (fd < 0)
     {
       syslog(LOG_ERR, "Failed to open serial channel %s\n", chrdev);
+      free(slcan);
       return -1;
     }
-  else
+
+  /* Create CAN socket */
+
+  if (caninit(slcan) < 0)
     {
-      /* Create CAN socket */
+      syslog(LOG_ERR, "Failed to open CAN socket %s\n", candev);
+      close(fd);
+      free(slcan);
+      return -1;
+    }
 
-      if (caninit(candev, &s, &addr, &ctrlmsg[0], &frame, &msg, &iov) < 0)
-        {
-          syslog(LOG_ERR, "Failed to open CAN socket %s\n", candev);
-          close(fd);
-          return -1;
-        }
+  /* serial interface active */
 
-      /* serial interface active */
+  debug_print("Serial interface open %s\n", chrdev);
+  slcan->tx.fd = fd;
+  slcan_txput(&slcan->tx, opening, sizeof(opening) - 1);
+  slcan_txflush(&slcan->tx);
 
-      debug_print("Serial interface open %s\n", chrdev);
-      write(fd, opening, (sizeof(opening) - 1));
+  maxfd = slcan->s > fd ? slcan->s : fd;
+
+  while (slcan->mode < 100)
+    {
+      /* Setup poll */
 
-      while (mode < 100)
+      FD_ZERO(&rdfs);
+      FD_SET(fd, &rdfs);       /* UART */
+      if (slcan->autopoll)
         {
-          /* Setup ooll */
+          FD_SET(slcan->s, &rdfs); /* CAN Socket */
+        }
 
-          FD_ZERO(&rdfs);
-          FD_SET(s, &rdfs);  /* CAN Socket */
-          FD_SET(fd, &rdfs); /* UART */
+      if (select(maxfd + 1, &rdfs, NULL, NULL, NULL) <= 0)
+        {
+          continue;
+        }
 
-          if ((ret = select(s + 1, &rdfs, NULL, NULL, NULL)) <= 0)
-            {
-              continue;
-            }
+      if (FD_ISSET(slcan->s, &rdfs))
+        {
+          /* CAN received new messages in socketCAN input, forward a burst
+           * of them at once.
+           */
 
-          if (FD_ISSET(s, &rdfs))
+          for (i = 0; i < CONFIG_CANUTILS_SLCAN_BURST; i++)
             {
-              /* CAN received new message in socketCAN input */
-
-              iov.iov_len        = sizeof(frame);
-              msg.msg_namelen    = sizeof(addr);
-              msg.msg_controllen = sizeof(ctrlmsg);
-              msg.msg_flags      = 0;
-              nbytes             = recvmsg(s, &msg, 0);
-
-              if (nbytes == CAN_MTU)
+              if (!slcan_recvframe(slcan))
                 {
-                  reccount++;
-                  debug_print("R%d, Id:0x%" PRIx32 "\n",
-                              reccount, frame.can_id);
-                  if (frame.can_id & CAN_EFF_FLAG)
-                    {
-                      /* 29 bit address */
-
-                      frame.can_id = frame.can_id & ~CAN_EFF_FLAG;
-                      snprintf(sbuf, sizeof(sbuf), "T%08" PRIx32 "%d",
-                               frame.can_id, frame.len);
-                      sbp = &sbuf[10];
-                    }
-                  else
-                    {
-                      /* 11 bit address */
-
-                      snprintf(sbuf, sizeof(sbuf), "t%03" PRIx32 "%d",
-                               frame.can_id, frame.len);
-                      sbp = &sbuf[5];
-                    }
-
-                  for (i = 0; i < frame.len; i++)
-                    {
-                      snprintf(sbp, sizeof(sbuf) - (sbp - sbuf),
-                               "%02X", frame.data[i]);
-                      sbp += 2;
-                    }
-
-                  *sbp++ = '\r';
-                  *sbp   = '\0';
-                  write(fd, sbuf, strlen(sbuf));
+                  break;
                 }
             }
+        }
 
-          if (FD_ISSET(fd, &rdfs))
-            {
-              /* UART receive */
-
-              n = readlinebuffer(fd, buf, 30);
+      if (FD_ISSET(fd, &rdfs))
+        {
+          /* UART receive, all the commands that arrived at once */
 
-              switch (mode)
-                {
-                case 0: /* CAN channel not open */
-                  if (n > 0)
-                    {
-                      if (buf[0] == 'F')
-                        {
-                          /* return clear flags */
-
-                          write(fd, "F00\r", 4);
-                        }
-                      else if (buf[0] == 'O')
-                        {
-                          /* open CAN interface */
-
-                          struct ifreq ifr;
-
-                          strlcpy(ifr.ifr_name, argv[1], IFNAMSIZ);
-
-                          ifr.ifr_flags = IFF_UP;
-                          if (ioctl(s, SIOCSIFFLAGS, &ifr) < 0)
-                            {
-                              syslog(LOG_ERR, "Open interface failed\n");
-                              fail_return(fd);
-                            }
-                          else
-                            {
-                              mode = 1;
-                              debug_print("Open interface\n");
-                              ok_return(fd);
-                            }
-                        }
-                      else if (buf[0] == 'S')
-                        {
-                          /* set CAN interface speed */
-
-                          switch (buf[1])
-                            {
-                            case '0':
-                              canspeed = 10000;
-                              break;
-                            case '1':
-                              canspeed = 20000;
-                              break;
-                            case '2':
-                              canspeed = 50000;
-                              break;
-                            case '3':
-                              canspeed = 100000;
-                              break;
-                            case '4':
-                              canspeed = 125000;
-                              break;
-                            case '5':
-                              canspeed = 250000;
-                              break;
-                            case '6':
-                              canspeed = 500000;
-                              break;
-                            case '7':
-                              canspeed = 800000;
-                              break;
-                            case '8': /* set speed to 1Mbps */
-                              canspeed = 1000000;
-                              break;
-                            default:
-                              break;
-                            }
-
-                          struct ifreq ifr;
-
-                          /* set the device name */
-
-                          strlcpy(ifr.ifr_name, argv[1], IFNAMSIZ);
-                          ifr.ifr_ifru.ifru_can_data.arbi_bitrate = canspeed;
-                          ifr.ifr_ifru.ifru_can_data.arbi_samplep = 80;
-
-                          if (ioctl(s, SIOCSCANBITRATE, &ifr) < 0)
-                            {
-                              syslog(LOG_ERR, "set speed %d failed\n",
-                                     canspeed);
-                              fail_return(fd);
-                            }
-                          else
-                            {
-                              debug_print("set speed %d\n", canspeed);
-                              ok_return(fd);
-                            }
-                        }
-                      else
-                        {
-                          /* whatever */
-
-                          ok_return(fd);
-                        }
-                    }
-                  break;
-                case 1: /* CAN task running open interface */
-                  if (n > 0)
-                    {
-                      if (buf[0] == 'C')
-                        {
-                          /* close interface */
-
-                          struct ifreq ifr;
-
-                          strlcpy(ifr.ifr_name, argv[1], IFNAMSIZ);
-
-                          ifr.ifr_flags = 0;
-                          if (ioctl(s, SIOCSIFFLAGS, &ifr) < 0)
-                            {
-                              syslog(LOG_ERR, "Close interface failed\n");
-                              fail_return(fd);
-                            }
-                          else
-                            {
-                              mode = 0;
-                              debug_print("Close interface\n");
-                              ok_return(fd);
-                            }
-                        }
-                      else if (buf[0] == 'T')
-                        {
-                          /* Transmit an extended 29 bit CAN frame */
-
-                          char tbuf[9];
-                          int idval;
-                          int val;
-
-                          /* get 29bit CAN ID */
-
-                          strncpy(tbuf, &buf[1], 8);
-                          tbuf[8] = '\0';
-                          sscanf(tbuf, "%x", &idval);
-
-                          frame.len = buf[9] - '0'; /* get byte count */
-
-                          /* get canmessage */
-
-                          for (i = 0; i < frame.len; i++)
-                            {
-                              tbuf[0] = buf[10 + (2 * i)];
-                              tbuf[1] = buf[11 + (2 * i)];
-                              tbuf[2] = '\0';
-                              sscanf(tbuf, "%x", &val);
-                              frame.data[i] = val & 0xff;
-                            }
-
-                          debug_print("Transmitt: 0x%X ", idval);
-                          for (i = 0; i < frame.len; i++)
-                            {
-                              debug_print("0x%02X ", frame.data[i]);
-                            }
-
-                          debug_print("\n");
-
-                          frame.can_id = idval | CAN_EFF_FLAG; /* 29 bit */
-
-                          if (write(s, &frame, CAN_MTU) != CAN_MTU)
-                            {
-                              syslog(LOG_ERR, "transmitt error\n");
-
-                              /* TODO update error flags */
-                            }
-
-                          ok_return(fd);
-                        }
-                      else if (buf[0] == 't')
-                        {
-                          /* Transmit an 11 bit CAN frame */
-
-                          char tbuf[9];
-                          int idval;
-                          int val;
-
-                          /* get 11bit CAN ID */
-
-                          strncpy(tbuf, &buf[1], 3);
-                          tbuf[3] = '\0';
-                          sscanf(tbuf, "%x", &idval);
-
-                          frame.len = buf[4] - '0'; /* get byte count */
-
-                          /* get canmessage */
-
-                          for (i = 0; i < frame.len; i++)
-                            {
-                              tbuf[0] = buf[5 + (2 * i)];
-                              tbuf[1] = buf[6 + (2 * i)];
-                              tbuf[2] = '\0';
-                              sscanf(tbuf, "%x", &val);
-                              frame.data[i] = val & 0xff;
-                            }
-
-                          debug_print("Transmitt: 0x%X ", idval);
-                          for (i = 0; i < frame.len; i++)
-                            {
-                              debug_print("0x%02X ", frame.data[i]);
-                            }
-
-                          debug_print("\n");
-
-                          frame.can_id = idval; /* 11 bit address command */
-
-                          if (write(s, &frame, CAN_MTU) != CAN_MTU)
-                            {
-                              syslog(LOG_ERR, "transmitt error\n");
-
-                              /* TODO update error flags */
-                            }
-
-                          ok_return(fd);
-                        }
-                      else
-                        {
-                          /* whatever */
-
-                          ok_return(fd);
-                        }
-                    }
-                  break;
-                default: /* should not happen */
-                  mode = 100;
-                  break;
-                }
+          slcan_rxfill(&slcan->rx, fd);
+          while ((line = slcan_rxline(&slcan->rx, &len)) != NULL)
+            {
+              slcan_command(slcan, line, len);
             }
         }
 
-      close(fd);
-      close(s);
+      /* One write for all the replies and frames of this cycle */
+
+      slcan_txflush(&slcan->tx);
     }
 
+  close(fd);
+  close(slcan->s);
+  free(slcan);
+
   return 0;
 }
@@ -23,10 +23,41 @@
 #ifndef SLCAN_H
 #define SLCAN_H
 
+/****************************************************************************
+ * Included Files
+ ****************************************************************************/
+
+#include <nuttx/config.h>
+
+#include <stdbool.h>
+#include <stddef.h>
+#include <stdint.h>
+#include <sys/types.h>
+
+#include <nuttx/can.h>
+
 /****************************************************************************
  * Pre-processor Definitions
  ****************************************************************************/
 
+#ifndef CONFIG_CANUTILS_SLCAN_RXBUFSIZE
+#  define CONFIG_CANUTILS_SLCAN_RXBUFSIZE 256
+#endif
+
+#ifndef CONFIG_CANUTILS_SLCAN_TXBUFSIZE
+#  define CONFIG_CANUTILS_SLCAN_TXBUFSIZE 512
+#endif
+
+/* Longest command line: T + 8 digit id + length + 8 data bytes + 4 digit
+ * timestamp, without the CR.
+ */
+
+#define SLCAN_MAXLINE          30
+
+/* Longest encoded frame, including the CR */
+
+#define SLCAN_MAXFRAME         (SLCAN_MAXLINE + 1)
+
 /* S6   - CAN speed 500 kBit/s
  * S8   - CAN speed 1   Mbit/s
  * O    - open channel
@@ -44,4 +75,90 @@
 #define SLCAN_ARBITRATION_LOST (1 << 6)
 #define SLCAN_BUS_ERROR        (1 << 7)
 
+/****************************************************************************
+ * Public Types
+ ****************************************************************************/
+
+/* Serial receive side.  Bytes are read in bulk into the ring and command
+ * lines are cut out of it as their CR arrives, so no byte is looked at
+ * twice.
+ */
+
+struct slcan_rxbuf_s
+{
+  uint8_t ring[CONFIG_CANUTILS_SLCAN_RXBUFSIZE];
+  size_t head;                   /* Write position, free running */
+  size_t tail;                   /* Read position, free running */
+  char line[SLCAN_MAXLINE + 1];  /* Line being assembled */
+  size_t linelen;
+  bool overrun;                  /* Current line was too long */
+};
+
+/* Serial transmit side.  Replies and received frames are collected and
+ * written with a single write() per poll cycle.
+ */
+
+struct slcan_txbuf_s
+{
+  int fd;
+  size_t len;
+  char buf[CONFIG_CANUTILS_SLCAN_TXBUFSIZE];
+};
+
+/****************************************************************************
+ * Public Function Prototypes
+ ****************************************************************************/
+
+/* Read whatever the serial line has into the ring with one read() call.
+ * Returns the number of bytes read, 0 if the ring is full or a negated
+ * errno.
+ */
+
+ssize_t slcan_rxfill(FAR struct slcan_rxbuf_s *rx, int fd);
+
+/* Return the next complete command line, NUL terminated and without its
+ * CR, or NULL when more input is needed.  *len is set to the line length,
+ * or to -1 for a line that exceeded SLCAN_MAXLINE and was dropped.
+ */
+
+FAR char *slcan_rxline(FAR struct slcan_rxbuf_s *rx, FAR int *len);
+
+/* Decode a t, T, r or R command into a classic CAN frame.  Returns 0 or
+ * -EINVAL on a malformed command.
+ */
+
+int slcan_decode(FAR const char *line, int len,
+                 FAR struct can_frame *frame);
+
+/* Encode a received frame as t, T, r or R line including the CR, with an
+ * optional millisecond timestamp (-1 for none).  buf must hold
+ * SLCAN_MAXFRAME bytes.  Returns the number of bytes used.
+ */
+
+int slcan_encode(FAR char *buf, FAR const struct can_frame *frame,
+                 int timestamp);
+
+/* Queue bytes for the serial line, flushing first if they do not fit */
+
+void slcan_txput(FAR struct slcan_txbuf_s *tx, FAR const void *data,
+                 size_t len);
+
+/* Reserve room for len bytes (at most SLCAN_MAXFRAME) at the end of the
+ * transmit buffer, flushing first if needed.  The caller fills them in and
+ * calls slcan_txcommit().
+ */
+
+FAR char *slcan_txreserve(FAR struct slcan_txbuf_s *tx, size_t len);
+
+static inline void slcan_txcommit(FAR struct slcan_txbuf_s *tx, size_t len)
+{
+  tx->len += len;
+}
+
+/* Write out everything queued.  Returns 0 or a negated errno, the data is
+ * dropped on errors.
+ */
+
+int slcan_txflush(FAR struct slcan_txbuf_s *tx);
+
 #endif /* SLCAN_H */
@@ -0,0 +1,373 @@
+/****************************************************************************
+ * apps/canutils/slcan/slcan_io.c
+ *
+ * SPDX-License-Identifier: Apache-2.0
+ *
+ * Licensed to the Apache Software Foundation (ASF) under one or more
+ * contributor license agreements.  See the NOTICE file distributed with
+ * this work for additional information regarding copyright ownership.  The
+ * ASF licenses this file to you under the Apache License, Version 2.0 (the
+ * "License"); you may not use this file except in compliance with the
+ * License.  You may obtain a copy of the License at
+ *
+ *   http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS, WITHOUT
+ * WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.  See the
+ * License for the specific language governing permissions and limitations
+ * under the License.
+ *
+ ****************************************************************************/
+
+/****************************************************************************
+ * Included Files
+ ****************************************************************************/
+
+#include <nuttx/config.h>
+
+#include <errno.h>
+#include <string.h>
+#include <unistd.h>
+
+#include "slcan.h"
+
+/****************************************************************************
+ * Pre-processor Definitions
+ ****************************************************************************/
+
+#define RXBUFSIZE CONFIG_CANUTILS_SLCAN_RXBUFSIZE
+
+/****************************************************************************
+ * Private Data
+ ****************************************************************************/
+
+static const char g_hexdigits[] = "0123456789ABCDEF";
+
+/****************************************************************************
+ * Private Functions
+ ****************************************************************************/
+
+/****************************************************************************
+ * Name: slcan_hex
+ *
+ * Description:
+ *   Convert len hex digits to a value.  Returns -1 on a non hex digit.
+ *
+ ****************************************************************************/
+
+static int32_t slcan_hex(FAR const char *str, int len)
+{
+  uint32_t val = 0;
+  int digit;
+
+  while (len-- > 0)
+    {
+      digit = *str++;
+      if (digit >= '0' && digit <= '9')
+        {
+          digit -= '0';
+        }
+      else if ((digit | 0x20) >= 'a' && (digit | 0x20) <= 'f')
+        {
+          digit = (digit | 0x20) - 'a' + 10;
+        }
+      else
+        {
+          return -1;
+        }
+
+      val = (val << 4) | digit;
+    }
+
+  return val;
+}
+
+/****************************************************************************
+ * Name: slcan_puthex
+ ****************************************************************************/
+
+static FAR char *slcan_puthex(FAR char *buf, uint32_t val, int len)
+{
+  while (len-- > 0)
+    {
+      buf[len] = g_hexdigits[val & 0xf];
+      val >>= 4;
+    }
+
+  return buf;
+}
+
+/****************************************************************************
+ * Public Functions
+ ****************************************************************************/
+
+/****************************************************************************
+ * Name: slcan_rxfill
+ ****************************************************************************/
+
+ssize_t slcan_rxfill(FAR struct slcan_rxbuf_s *rx, int fd)
+{
+  size_t off = rx->head % RXBUFSIZE;
+  size_t room = RXBUFSIZE - (rx->head - rx->tail);
+  ssize_t nbytes;
+
+  /* Read into the contiguous free space only, the next call picks up the
+   * part that wrapped.
+   */
+
+  if (room > RXBUFSIZE - off)
+    {
+      room = RXBUFSIZE - off;
+    }
+
+  if (room == 0)
+    {
+      return 0;
+    }
+
+  nbytes = read(fd, &rx->ring[off], room);
+  if (nbytes < 0)
+    {
+      return -errno;
+    }
+
+  rx->head += nbytes;
+  return nbytes;
+}
+
+/****************************************************************************
+ * Name: slcan_rxline
+ ****************************************************************************/
+
+FAR char *slcan_rxline(FAR struct slcan_rxbuf_s *rx, FAR int *len)
+{
+  FAR uint8_t *start;
+  FAR uint8_t *eol;
+  size_t chunk;
+  size_t copy;
+  size_t off;
+
+  while (rx->tail != rx->head)
+    {
+      off = rx->tail % RXBUFSIZE;
+      chunk = rx->head - rx->tail;
+      if (chunk > RXBUFSIZE - off)
+        {
+          chunk = RXBUFSIZE - off;
+        }
+
+      start = &rx->ring[off];
+      eol = memchr(start, '\r', chunk);
+      copy = eol != NULL ? (size_t)(eol - start) : chunk;
+
+      /* Append to the line, or just skip the bytes of an overlong one */
+
+      if (rx->linelen + copy > SLCAN_MAXLINE)
+        {
+          rx->overrun = true;
+        }
+      else if (!rx->overrun)
+        {
+          memcpy(&rx->line[rx->linelen], start, copy);
+          rx->linelen += copy;
+        }
+
+      if (eol == NULL)
+        {
+          rx->tail += chunk;
+          continue;
+        }
+
+      rx->tail += copy + 1;
+      rx->line[rx->linelen] = '\0';
+      *len = rx->overrun ? -1 : (int)rx->linelen;
+      rx->linelen = 0;
+      rx->overrun = false;
+      return rx->line;
+    }
+
+  return NULL;
+}
+
+/****************************************************************************
+ * Name: slcan_decode
+ ****************************************************************************/
+
+int slcan_decode(FAR const char *line, int len, FAR struct can_frame *frame)
+{
+  int32_t val;
+  int idlen;
+  int i;
+
+  switch (line[0])
+    {
+      case 't':
+      case 'r':
+        idlen = 3;
+        break;
+
+      case 'T':
+      case 'R':
+        idlen = 8;
+        break;
+
+      default:
+        return -EINVAL;
+    }
+
+  if (len < idlen + 2)
+    {
+      return -EINVAL;
+    }
+
+  val = slcan_hex(&line[1], idlen);
+  if (val < 0 || (idlen == 3 && (uint32_t)val > CAN_SFF_MASK) ||
+      (uint32_t)val > CAN_EFF_MASK)
+    {
+      return -EINVAL;
+    }
+
+  memset(frame, 0, sizeof(*frame));
+  frame->can_id = val;
+  if (idlen == 8)
+    {
+      frame->can_id |= CAN_EFF_FLAG;
+    }
+
+  frame->can_dlc = line[idlen + 1] - '0';
+  if (frame->can_dlc > CAN_MAX_DLEN)
+    {
+      return -EINVAL;
+    }
+
+  if (line[0] == 'r' || line[0] == 'R')
+    {
+      frame->can_id |= CAN_RTR_FLAG;
+      return len == idlen + 2 ? 0 : -EINVAL;
+    }
+
+  if (len < idlen + 2 + 2 * frame->can_dlc)
+    {
+      return -EINVAL;
+    }
+
+  for (i = 0; i < frame->can_dlc; i++)
+    {
+      val = slcan_hex(&line[idlen + 2 + 2 * i], 2);
+      if (val < 0)
+        {
+          return -EINVAL;
+        }
+
+      frame->data[i] = val;
+    }
+
+  return 0;
+}
+
+/****************************************************************************
+ * Name: slcan_encode
+ ****************************************************************************/
+
+int slcan_encode(FAR char *buf, FAR const struct can_frame *frame,
+                 int timestamp)
+{
+  FAR char *ptr = buf;
+  bool rtr = (frame->can_id & CAN_RTR_FLAG) != 0;
+  int dlc = frame->can_dlc > CAN_MAX_DLEN ? CAN_MAX_DLEN : frame->can_dlc;
+  int i;
+
+  if (frame->can_id & CAN_EFF_FLAG)
+    {
+      *ptr++ = rtr ? 'R' : 'T';
+      slcan_puthex(ptr, frame->can_id & CAN_EFF_MASK, 8);
+      ptr += 8;
+    }
+  else
+    {
+      *ptr++ = rtr ? 'r' : 't';
+      slcan_puthex(ptr, frame->can_id & CAN_SFF_MASK, 3);
+      ptr += 3;
+    }
+
+  *ptr++ = '0' + dlc;
+
+  if (!rtr)
+    {
+      for (i = 0; i < dlc; i++)
+        {
+          slcan_puthex(ptr, frame->data[i], 2);
+          ptr += 2;
+        }
+    }
+
+  if (timestamp >= 0)
+    {
+      slcan_puthex(ptr, timestamp, 4);
+      ptr += 4;
+    }
+
+  *ptr++ = '\r';
+  return ptr - buf;
+}
+
+/****************************************************************************
+ * Name: slcan_txreserve
+ ****************************************************************************/
+
+FAR char *slcan_txreserve(FAR struct slcan_txbuf_s *tx, size_t len)
+{
+  if (tx->len + len > sizeof(tx->buf))
+    {
+      slcan_txflush(tx);
+    }
+
+  return &tx->buf[tx->len];
+}
+
+/****************************************************************************
+ * Name: slcan_txput
+ ****************************************************************************/
+
+void slcan_txput(FAR struct slcan_txbuf_s *tx, FAR const void *data,
+                 size_t len)
+{
+  memcpy(slcan_txreserve(tx, len), data, len);
+  slcan_txcommit(tx, len);
+}
+
+/****************************************************************************
+ * Name: slcan_txflush
+ ****************************************************************************/
+
+int slcan_txflush(FAR struct slcan_txbuf_s *tx)
+{
+  size_t off = 0;
+  ssize_t nbytes;
+  int ret = 0;
+
+  while (off < tx->len)
+    {
+      nbytes = write(tx->fd, &tx->buf[off], tx->len - off);
+      if (nbytes < 0)
+        {
+          if (errno == EINTR)
+            {
+              continue;
+            }
+
+          /* Drop what could not be sent, the host resynchronizes on the
+           * next CR anyway.
+           */
+
+          ret = -errno;
+          break;
+        }
+
+      off += nbytes;
+    }
+
+  tx->len = 0;
+  return ret;
+}
@@ -0,0 +1,553 @@
+/****************************************************************************
+ * apps/examples/dhcpd/loadtest.c
+ *
+ * SPDX-License-Identifier: Apache-2.0
+ *
+ * Licensed to the Apache Software Foundation (ASF) under one or more
+ * contributor license agreements.  See the NOTICE file distributed with
+ * this work for additional information regarding copyright ownership.  The
+ * ASF licenses this file to you under the Apache License, Version 2.0 (the
+ * "License"); you may not use this file except in compliance with the
+ * License.  You may obtain a copy of the License at
+ *
+ *   http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS, WITHOUT
+ * WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.  See the
+ * License for the specific language governing permissions and limitations
+ * under the License.
+ *
+ ****************************************************************************/
+
+/* Host load test of the DHCP server.  The socket calls of dhcpd_run() are
+ * redirected (ld --wrap) to a simulated network interface with thousands
+ * of clients behind it, a quarter of them behind a relay agent.  Every
+ * client does a DISCOVER/REQUEST exchange and the replies are checked.
+ *
+ * Run it once to fill the lease journal, then again with -r: the second
+ * run restarts the server from the journal and the clients, asking in the
+ * opposite order, must be offered the addresses they had.
+ */
+
+/****************************************************************************
+ * Included Files
+ ****************************************************************************/
+
+#include <sys/socket.h>
+#include <sys/ioctl.h>
+
+#include <errno.h>
+#include <inttypes.h>
+#include <stdarg.h>
+#include <stdbool.h>
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+#include <unistd.h>
+
+#include <net/if.h>
+#include <netinet/in.h>
+#include <arpa/inet.h>
+
+/****************************************************************************
+ * Pre-processor Definitions
+ ****************************************************************************/
+
+#define LT_SOCKFD           1000
+#define LT_SERVERIP         0x0a000001  /* 10.0.0.1, default pool subnet */
+#define LT_RELAYIP          0x0a010001  /* 10.1.0.1, relay agent */
+#define LT_POOLSTART        0x0a010002
+#define LT_POOLEND          0x0a010fff
+#define LT_POOLMASK         0xffff0000
+#define LT_MAPFILE          CONFIG_NETUTILS_DHCPD_LEASEFILE ".map"
+#define LT_DEFAULT_CLIENTS  3000
+#define LT_MAX_CLIENTS      5000        /* What the pools can hold */
+
+#define DHCP_SERVER_PORT    67
+#define DHCP_CLIENT_PORT    68
+
+#define DHCPDISCOVER        1
+#define DHCPOFFER           2
+#define DHCPREQUEST         3
+#define DHCPACK             5
+#define DHCPRELEASE         7
+
+/****************************************************************************
+ * Private Types
+ ****************************************************************************/
+
+struct lt_msg_s
+{
+  uint8_t  op;
+  uint8_t  htype;
+  uint8_t  hlen;
+  uint8_t  hops;
+  uint8_t  xid[4];
+  uint16_t secs;
+  uint16_t flags;
+  uint8_t  ciaddr[4];
+  uint8_t  yiaddr[4];
+  uint8_t  siaddr[4];
+  uint8_t  giaddr[4];
+  uint8_t  chaddr[16];
+  uint8_t  sname[64];
+  uint8_t  file[128];
+  uint8_t  options[312];
+};
+
+struct lt_client_s
+{
+  uint8_t  mac[6];
+  bool     relayed;
+  bool     released;
+  uint32_t ipaddr;                /* Address acknowledged, host order */
+};
+
+/****************************************************************************
+ * Private Data
+ ****************************************************************************/
+
+static struct lt_client_s *g_clients;
+static uint32_t *g_map;           /* Addresses of the previous run */
+static int g_nclients = LT_DEFAULT_CLIENTS;
+static bool g_recover;
+
+static int g_step;                /* Message being sent */
+static int g_expect;              /* Reply expected, 0 for none */
+static uint32_t g_offered;
+static int g_errors;
+
+static uint64_t g_start;
+static uint64_t g_ready;
+
+/****************************************************************************
+ * Public Function Prototypes
+ ****************************************************************************/
+
+extern int dhcpd_run(const char *interface);
+extern int dhcpd_add_pool(in_addr_t startip, in_addr_t endip,
+                          in_addr_t routerip, in_addr_t netmask,
+                          in_addr_t dnsip);
+
+/****************************************************************************
+ * Private Functions
+ ****************************************************************************/
+
+static uint64_t lt_now(void)
+{
+  struct timespec ts;
+
+  clock_gettime(CLOCK_MONOTONIC, &ts);
+  return (uint64_t)ts.tv_sec * 1000000 + ts.tv_nsec / 1000;
+}
+
+/* The client of a step: the run walks the clients up, the recovery run
+ * walks them down so that a server without its leases would hand out the
+ * addresses in the wrong order.  Each client takes two steps and released
+ * clients a third one at the end.
+ */
+
+static int lt_client(int step)
+{
+  int ndx = step / 2;
+
+  return g_recover ? g_nclients - 1 - ndx : ndx;
+}
+
+static uint8_t lt_msgtype(const struct lt_msg_s *msg, size_t len)
+{
+  const uint8_t *opt = msg->options + 4;
+  const uint8_t *end = (const uint8_t *)msg + len;
+
+  while (opt + 2 <= end && opt[0] != 255)
+    {
+      if (opt[0] == 0)
+        {
+          opt++;
+          continue;
+        }
+
+      if (opt[0] == 53)
+        {
+          return opt[2];
+        }
+
+      opt += opt[1] + 2;
+    }
+
+  return 0;
+}
+
+static size_t lt_build(struct lt_msg_s *msg, int ndx, uint8_t type,
+                       uint32_t reqip, bool serverid)
+{
+  struct lt_client_s *client = &g_clients[ndx];
+  uint8_t *opt;
+  uint32_t addr;
+
+  memset(msg, 0, sizeof(*msg));
+  msg->op    = 1;
+  msg->htype = 1;
+  msg->hlen  = 6;
+  memcpy(msg->xid, &ndx, 4);
+  memcpy(msg->chaddr, client->mac, 6);
+
+  if (client->relayed)
+    {
+      addr = htonl(LT_RELAYIP);
+      memcpy(msg->giaddr, &addr, 4);
+      msg->hops = 1;
+    }
+
+  if (type == DHCPRELEASE)
+    {
+      addr = htonl(client->ipaddr);
+      memcpy(msg->ciaddr, &addr, 4);
+    }
+
+  opt = msg->options;
+  *opt++ = 99;
+  *opt++ = 130;
+  *opt++ = 83;
+  *opt++ = 99;
+
+  *opt++ = 53;
+  *opt++ = 1;
+  *opt++ = type;
+
+  if (reqip != 0)
+    {
+      addr = htonl(reqip);
+      *opt++ = 50;
+      *opt++ = 4;
+      memcpy(opt, &addr, 4);
+      opt += 4;
+    }
+
+  if (serverid)
+    {
+      addr = htonl(LT_SERVERIP);
+      *opt++ = 54;
+      *opt++ = 4;
+      memcpy(opt, &addr, 4);
+      opt += 4;
+    }
+
+  *opt++ = 255;
+  return opt - (uint8_t *)msg;
+}
+
+static void lt_error(int ndx, const char *fmt, ...)
+{
+  va_list ap;
+
+  if (g_errors++ < 10)
+    {
+      fprintf(stderr, "ERROR: client %d: ", ndx);
+      va_start(ap, fmt);
+      vfprintf(stderr, fmt, ap);
+      va_end(ap);
+      fputc('\n', stderr);
+    }
+}
+
+static void lt_finish(void)
+{
+  uint64_t elapsed = lt_now() - g_ready;
+  uint32_t *seen;
+  FILE *stream;
+  int nreleased = 0;
+  int i;
+  int j;
+
+  /* No two clients may hold the same address */
+
+  seen = calloc(g_nclients, sizeof(uint32_t));
+  for (i = 0; seen != NULL && i < g_nclients; i++)
+    {
+      if (g_clients[i].released)
+        {
+          nreleased++;
+          continue;
+        }
+
+      for (j = 0; j < i; j++)
+        {
+          if (seen[j] == g_clients[i].ipaddr)
+            {
+              lt_error(i, "address %08" PRIx32 " also leased to %d",
+                       g_clients[i].ipaddr, j);
+            }
+        }
+
+      seen[i] = g_clients[i].ipaddr;
+    }
+
+  free(seen);
+
+  if (!g_recover)
+    {
+      stream = fopen(LT_MAPFILE, "w");
+      if (stream != NULL)
+        {
+          for (i = 0; i < g_nclients; i++)
+            {
+              uint32_t addr = g_clients[i].released ? 0 :
+                              g_clients[i].ipaddr;
+              fwrite(&addr, sizeof(addr), 1, stream);
+            }
+
+          fclose(stream);
+        }
+    }
+
+  printf("%s: %d clients, %d released\n",
+         g_recover ? "recovery" : "run", g_nclients, nreleased);
+  printf("  start-up %" PRIu64 " us, %" PRIu64 " us for all exchanges, "
+         "%" PRIu64 " exchanges/s\n", g_ready - g_start, elapsed,
+         elapsed > 0 ? (uint64_t)g_nclients * 1000000 / elapsed : 0);
+  printf("  %s\n", g_errors ? "FAILED" : "PASSED");
+
+  free(g_clients);
+  free(g_map);
+  exit(g_errors ? EXIT_FAILURE : EXIT_SUCCESS);
+}
+
+/****************************************************************************
+ * Public Functions
+ ****************************************************************************/
+
+/* The simulated interface */
+
+int __wrap_socket(int domain, int type, int protocol)
+{
+  g_ready = lt_now();
+  return LT_SOCKFD;
+}
+
+int __wrap_setsockopt(int fd, int level, int option, const void *value,
+                      socklen_t len)
+{
+  return 0;
+}
+
+int __wrap_bind(int fd, const struct sockaddr *addr, socklen_t len)
+{
+  return 0;
+}
+
+int __wrap_ioctl(int fd, unsigned long request, ...)
+{
+  struct sockaddr_in *addr;
+  struct ifreq *req;
+  va_list ap;
+
+  va_start(ap, request);
+  req = (struct ifreq *)va_arg(ap, unsigned long);
+  va_end(ap);
+
+  addr = (struct sockaddr_in *)&req->ifr_addr;
+  addr->sin_family      = AF_INET;
+  addr->sin_addr.s_addr = htonl(LT_SERVERIP);
+  return 0;
+}
+
+int __wrap_usleep(useconds_t usec)
+{
+  return 0;
+}
+
+ssize_t __wrap_recv(int fd, void *buf, size_t len, int flags)
+{
+  struct lt_msg_s *msg = buf;
+  int nexchanges = 2 * g_nclients;
+  int ndx;
+
+  if (g_expect != 0)
+    {
+      lt_error(lt_client(g_step - 1), "no reply %d", g_expect);
+      g_expect = 0;
+    }
+
+  /* After the exchanges, release every eighth client of the first run */
+
+  while (g_step >= nexchanges)
+    {
+      ndx = g_step++ - nexchanges;
+      if (g_recover || ndx >= g_nclients)
+        {
+          lt_finish();
+        }
+
+      if ((ndx & 7) == 7)
+        {
+          g_clients[ndx].released = true;
+          return lt_build(msg, ndx, DHCPRELEASE, 0, false);
+        }
+    }
+
+  ndx = lt_client(g_step);
+  if ((g_step++ & 1) == 0)
+    {
+      g_expect = DHCPOFFER;
+      return lt_build(msg, ndx, DHCPDISCOVER, 0, false);
+    }
+
+  g_expect = DHCPACK;
+  return lt_build(msg, ndx, DHCPREQUEST, g_offered, true);
+}
+
+ssize_t __wrap_sendto(int fd, const void *buf, size_t len, int flags,
+                      const struct sockaddr *to, socklen_t tolen)
+{
+  const struct lt_msg_s *msg = buf;
+  const struct sockaddr_in *addr = (const struct sockaddr_in *)to;
+  struct lt_client_s *client;
+  uint32_t yiaddr;
+  uint8_t type;
+  int ndx;
+
+  ndx    = lt_client(g_step - 1);
+  client = &g_clients[ndx];
+  type   = lt_msgtype(msg, len);
+
+  memcpy(&yiaddr, msg->yiaddr, 4);
+  yiaddr = ntohl(yiaddr);
+
+  if (type != g_expect)
+    {
+      lt_error(ndx, "reply %d, expected %d", type, g_expect);
+    }
+  else if (memcmp(msg->chaddr, client->mac, 6) != 0)
+    {
+      lt_error(ndx, "reply to another client");
+    }
+  else if (ntohs(addr->sin_port) !=
+           (client->relayed ? DHCP_SERVER_PORT : DHCP_CLIENT_PORT))
+    {
+      lt_error(ndx, "reply to port %d", ntohs(addr->sin_port));
+    }
+  else if (client->relayed &&
+           (yiaddr < LT_POOLSTART || yiaddr > LT_POOLEND))
+    {
+      lt_error(ndx, "relayed client offered %08" PRIx32, yiaddr);
+    }
+  else if (!client->relayed && (yiaddr & LT_POOLMASK) !=
+                               (LT_SERVERIP & LT_POOLMASK))
+    {
+      lt_error(ndx, "local client offered %08" PRIx32, yiaddr);
+    }
+  else if (type == DHCPOFFER)
+    {
+      if (g_map != NULL && g_map[ndx] != 0 && g_map[ndx] != yiaddr)
+        {
+          lt_error(ndx, "offered %08" PRIx32 " after restart, had %08"
+                   PRIx32, yiaddr, g_map[ndx]);
+        }
+
+      g_offered = yiaddr;
+    }
+  else if (yiaddr != g_offered)
+    {
+      lt_error(ndx, "acknowledged %08" PRIx32 ", offered %08" PRIx32,
+               yiaddr, g_offered);
+    }
+  else
+    {
+      client->ipaddr = yiaddr;
+    }
+
+  g_expect = 0;
+  return len;
+}
+
+int main(int argc, char **argv)
+{
+  FILE *stream;
+  int ret;
+  int opt;
+  int i;
+
+  while ((opt = getopt(argc, argv, "n:r")) != -1)
+    {
+      switch (opt)
+        {
+          case 'n':
+            g_nclients = atoi(optarg);
+            break;
+
+          case 'r':
+            g_recover = true;
+            break;
+
+          default:
+            fprintf(stderr, "Usage: %s [-n <clients>] [-r]\n", argv[0]);
+            fprintf(stderr, "  -r  Restart from the lease journal of the "
+                            "previous run\n");
+            return EXIT_FAILURE;
+        }
+    }
+
+  if (g_nclients <= 0 || g_nclients > LT_MAX_CLIENTS)
+    {
+      fprintf(stderr, "ERROR: 1 to %d clients\n", LT_MAX_CLIENTS);
+      return EXIT_FAILURE;
+    }
+
+  g_clients = calloc(g_nclients, sizeof(struct lt_client_s));
+  g_map     = calloc(g_nclients, sizeof(uint32_t));
+  if (g_clients == NULL || g_map == NULL)
+    {
+      return EXIT_FAILURE;
+    }
+
+  for (i = 0; i < g_nclients; i++)
+    {
+      g_clients[i].mac[0]  = 0x02;
+      g_clients[i].mac[2]  = i >> 24;
+      g_clients[i].mac[3]  = i >> 16;
+      g_clients[i].mac[4]  = i >> 8;
+      g_clients[i].mac[5]  = i;
+      g_clients[i].relayed = (i & 3) == 3;
+    }
+
+  if (g_recover)
+    {
+      stream = fopen(LT_MAPFILE, "r");
+      if (stream == NULL ||
+          fread(g_map, sizeof(uint32_t), g_nclients, stream) !=
+          (size_t)g_nclients)
+        {
+          fprintf(stderr, "ERROR: No previous run of %d clients\n",
+                  g_nclients);
+          return EXIT_FAILURE;
+        }
+
+      fclose(stream);
+    }
+  else
+    {
+      free(g_map);
+      g_map = NULL;
+      unlink(CONFIG_NETUTILS_DHCPD_LEASEFILE);
+    }
+
+  ret = dhcpd_add_pool(LT_POOLSTART, LT_POOLEND, LT_RELAYIP, LT_POOLMASK,
+                       0);
+  if (ret < 0)
+    {
+      fprintf(stderr, "ERROR: dhcpd_add_pool failed: %d\n", ret);
+      return EXIT_FAILURE;
+    }
+
+  g_start = lt_now();
+  ret = dhcpd_run("lt0");
+
+  /* dhcpd_run() only returns if it could not start */
+
+  fprintf(stderr, "ERROR: dhcpd_run failed: %d\n", ret);
+  return EXIT_FAILURE;
+}
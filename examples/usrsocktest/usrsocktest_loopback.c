@@ -0,0 +1,702 @@
+/****************************************************************************
+ * apps/examples/usrsocktest/usrsocktest_loopback.c
+ *
+ * SPDX-License-Identifier: Apache-2.0
+ *
+ * Licensed to the Apache Software Foundation (ASF) under one or more
+ * contributor license agreements.  See the NOTICE file distributed with
+ * this work for additional information regarding copyright ownership.  The
+ * ASF licenses this file to you under the Apache License, Version 2.0 (the
+ * "License"); you may not use this file except in compliance with the
+ * License.  You may obtain a copy of the License at
+ *
+ *   http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS, WITHOUT
+ * WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.  See the
+ * License for the specific language governing permissions and limitations
+ * under the License.
+ *
+ ****************************************************************************/
+
+/****************************************************************************
+ * Included Files
+ ****************************************************************************/
+
+#include <nuttx/config.h>
+
+#include <sys/param.h>
+#include <sys/socket.h>
+#include <errno.h>
+#include <inttypes.h>
+#include <poll.h>
+#include <pthread.h>
+#include <stdio.h>
+#include <string.h>
+#include <time.h>
+#include <unistd.h>
+#include <netinet/in.h>
+#include <arpa/inet.h>
+
+#include "netutils/usrsockd.h"
+
+#include "defines.h"
+
+/****************************************************************************
+ * Pre-processor Definitions
+ ****************************************************************************/
+
+#define LOOPBACK_SOCKBASE  100
+#define LOOPBACK_NSOCKS    4
+#define LOOPBACK_RINGSIZE  2048
+#define LOOPBACK_STREAMLEN (16 * 1024)
+#define LOOPBACK_RECVMAX   700
+#define LOOPBACK_ROUNDS    500
+#define LOOPBACK_MSGLEN    64
+
+/****************************************************************************
+ * Private Types
+ ****************************************************************************/
+
+/* A socket of the stand-in daemon: whatever is sent on it is buffered in
+ * its receive ring and read back by recv().
+ */
+
+struct loopback_sock_s
+{
+  bool opened;
+  bool connected;
+  struct sockaddr_in peer;
+  struct usrsockd_ring_s ring;
+};
+
+struct loopback_s
+{
+  struct usrsockd_s ud;
+  pthread_t tid;
+  int pipefd[2];
+  struct loopback_sock_s socks[LOOPBACK_NSOCKS];
+};
+
+/****************************************************************************
+ * Private Function Prototypes
+ ****************************************************************************/
+
+static int loopback_socket(FAR struct usrsockd_s *ud, FAR void *hdr,
+                           FAR uint8_t *data, size_t datalen);
+static int loopback_close(FAR struct usrsockd_s *ud, FAR void *hdr,
+                          FAR uint8_t *data, size_t datalen);
+static int loopback_connect(FAR struct usrsockd_s *ud, FAR void *hdr,
+                            FAR uint8_t *data, size_t datalen);
+static int loopback_sendto(FAR struct usrsockd_s *ud, FAR void *hdr,
+                           FAR uint8_t *data, size_t datalen);
+static int loopback_recvfrom(FAR struct usrsockd_s *ud, FAR void *hdr,
+                             FAR uint8_t *data, size_t datalen);
+
+/****************************************************************************
+ * Private Data
+ ****************************************************************************/
+
+static const usrsockd_handler_t g_loopback_handlers[USRSOCK_REQUEST__MAX] =
+{
+  [USRSOCK_REQUEST_SOCKET]   = loopback_socket,
+  [USRSOCK_REQUEST_CLOSE]    = loopback_close,
+  [USRSOCK_REQUEST_CONNECT]  = loopback_connect,
+  [USRSOCK_REQUEST_SENDTO]   = loopback_sendto,
+  [USRSOCK_REQUEST_RECVFROM] = loopback_recvfrom,
+};
+
+static struct loopback_s g_loopback;
+static bool started;
+static int sd;
+
+/****************************************************************************
+ * Private Functions
+ ****************************************************************************/
+
+/****************************************************************************
+ * Name: loopback_sock
+ ****************************************************************************/
+
+static FAR struct loopback_sock_s *loopback_sock(int16_t usockid)
+{
+  int idx = usockid - LOOPBACK_SOCKBASE;
+
+  if (idx < 0 || idx >= LOOPBACK_NSOCKS || !g_loopback.socks[idx].opened)
+    {
+      return NULL;
+    }
+
+  return &g_loopback.socks[idx];
+}
+
+/****************************************************************************
+ * Name: loopback_socket
+ ****************************************************************************/
+
+static int loopback_socket(FAR struct usrsockd_s *ud, FAR void *hdr,
+                           FAR uint8_t *data, size_t datalen)
+{
+  FAR struct usrsock_request_socket_s *req = hdr;
+  FAR struct loopback_sock_s *lsock;
+  int ret = -ENFILE;
+  int i;
+
+  if (req->domain != AF_INET || req->type != SOCK_STREAM)
+    {
+      return usrsockd_ack(ud, req->head.xid, -EAFNOSUPPORT, 0);
+    }
+
+  for (i = 0; i < LOOPBACK_NSOCKS; i++)
+    {
+      lsock = &g_loopback.socks[i];
+      if (!lsock->opened)
+        {
+          memset(lsock, 0, sizeof(*lsock));
+          ret = usrsockd_ring_init(&lsock->ring, LOOPBACK_RINGSIZE);
+          if (ret == 0)
+            {
+              lsock->opened = true;
+              ret = LOOPBACK_SOCKBASE + i;
+            }
+
+          break;
+        }
+    }
+
+  return usrsockd_ack(ud, req->head.xid, ret, 0);
+}
+
+/****************************************************************************
+ * Name: loopback_close
+ ****************************************************************************/
+
+static int loopback_close(FAR struct usrsockd_s *ud, FAR void *hdr,
+                          FAR uint8_t *data, size_t datalen)
+{
+  FAR struct usrsock_request_close_s *req = hdr;
+  FAR struct loopback_sock_s *lsock = loopback_sock(req->usockid);
+
+  if (lsock == NULL)
+    {
+      return usrsockd_ack(ud, req->head.xid, -EBADFD, 0);
+    }
+
+  usrsockd_ring_free(&lsock->ring);
+  lsock->opened = false;
+  return usrsockd_ack(ud, req->head.xid, 0, 0);
+}
+
+/****************************************************************************
+ * Name: loopback_connect
+ ****************************************************************************/
+
+static int loopback_connect(FAR struct usrsockd_s *ud, FAR void *hdr,
+                            FAR uint8_t *data, size_t datalen)
+{
+  FAR struct usrsock_request_connect_s *req = hdr;
+  FAR struct loopback_sock_s *lsock = loopback_sock(req->usockid);
+  int ret;
+
+  if (lsock == NULL)
+    {
+      return usrsockd_ack(ud, req->head.xid, -EBADFD, 0);
+    }
+
+  if (lsock->connected)
+    {
+      return usrsockd_ack(ud, req->head.xid, -EISCONN, 0);
+    }
+
+  if (datalen < sizeof(lsock->peer))
+    {
+      return usrsockd_ack(ud, req->head.xid, -EINVAL, 0);
+    }
+
+  memcpy(&lsock->peer, data, sizeof(lsock->peer));
+  lsock->connected = true;
+
+  ret = usrsockd_ack(ud, req->head.xid, 0, 0);
+  if (ret < 0)
+    {
+      return ret;
+    }
+
+  return usrsockd_event(ud, req->usockid, USRSOCK_EVENT_SENDTO_READY);
+}
+
+/****************************************************************************
+ * Name: loopback_sendto
+ ****************************************************************************/
+
+static int loopback_sendto(FAR struct usrsockd_s *ud, FAR void *hdr,
+                           FAR uint8_t *data, size_t datalen)
+{
+  FAR struct usrsock_request_sendto_s *req = hdr;
+  FAR struct loopback_sock_s *lsock = loopback_sock(req->usockid);
+  uint16_t events = USRSOCK_EVENT_RECVFROM_AVAIL;
+  size_t nput;
+  int ret;
+
+  if (lsock == NULL)
+    {
+      return usrsockd_ack(ud, req->head.xid, -EBADFD, 0);
+    }
+
+  if (!lsock->connected)
+    {
+      return usrsockd_ack(ud, req->head.xid, -ENOTCONN, 0);
+    }
+
+  if (req->addrlen > 0)
+    {
+      return usrsockd_ack(ud, req->head.xid, -EISCONN, 0);
+    }
+
+  /* The data is taken straight from the request buffer */
+
+  nput = usrsockd_ring_put(&lsock->ring, data, req->buflen);
+  if (nput == 0 && req->buflen > 0)
+    {
+      return usrsockd_ack(ud, req->head.xid, -EAGAIN, 0);
+    }
+
+  ret = usrsockd_ack(ud, req->head.xid, nput, 0);
+  if (ret < 0)
+    {
+      return ret;
+    }
+
+  if (usrsockd_ring_used(&lsock->ring) < lsock->ring.size)
+    {
+      events |= USRSOCK_EVENT_SENDTO_READY;
+    }
+
+  return usrsockd_event(ud, req->usockid, events);
+}
+
+/****************************************************************************
+ * Name: loopback_recvfrom
+ ****************************************************************************/
+
+static int loopback_recvfrom(FAR struct usrsockd_s *ud, FAR void *hdr,
+                             FAR uint8_t *data, size_t datalen)
+{
+  FAR struct usrsock_request_recvfrom_s *req = hdr;
+  FAR struct loopback_sock_s *lsock = loopback_sock(req->usockid);
+  struct iovec iov[2];
+  uint16_t events = USRSOCK_EVENT_SENDTO_READY;
+  size_t len;
+  int iovcnt;
+  int ret;
+
+  if (lsock == NULL)
+    {
+      return usrsockd_dataack(ud, req->head.xid, -EBADFD, 0, NULL, 0, 0,
+                              NULL, 0);
+    }
+
+  if (!lsock->connected)
+    {
+      return usrsockd_dataack(ud, req->head.xid, -ENOTCONN, 0, NULL, 0, 0,
+                              NULL, 0);
+    }
+
+  len = usrsockd_ring_used(&lsock->ring);
+  if (len == 0)
+    {
+      return usrsockd_dataack(ud, req->head.xid, -EAGAIN, 0, NULL, 0, 0,
+                              NULL, 0);
+    }
+
+  /* Answer from the ring in place, the consumed part is not overwritten
+   * before the response has been flushed.
+   */
+
+  len    = MIN(len, req->max_buflen);
+  iovcnt = usrsockd_ring_peek(&lsock->ring, len, iov);
+  ret    = usrsockd_dataack(ud, req->head.xid, len, 0, &lsock->peer,
+                            MIN(sizeof(lsock->peer), req->max_addrlen),
+                            sizeof(lsock->peer), iov, iovcnt);
+  if (ret < 0)
+    {
+      return ret;
+    }
+
+  if ((req->flags & MSG_PEEK) == 0)
+    {
+      usrsockd_ring_consume(&lsock->ring, len);
+    }
+
+  if (usrsockd_ring_used(&lsock->ring) > 0)
+    {
+      events |= USRSOCK_EVENT_RECVFROM_AVAIL;
+    }
+
+  return usrsockd_event(ud, req->usockid, events);
+}
+
+/****************************************************************************
+ * Name: loopback_daemon
+ ****************************************************************************/
+
+static FAR void *loopback_daemon(FAR void *arg)
+{
+  FAR struct loopback_s *lb = arg;
+  struct pollfd pfd[2];
+  int ret;
+
+  for (; ; )
+    {
+      memset(pfd, 0, sizeof(pfd));
+      pfd[0].fd     = lb->ud.fd;
+      pfd[0].events = POLLIN;
+      pfd[1].fd     = lb->pipefd[0];
+      pfd[1].events = POLLIN;
+
+      ret = poll(pfd, 2, -1);
+      if (ret < 0)
+        {
+          ret = -errno;
+          break;
+        }
+
+      if (pfd[1].revents & POLLIN)
+        {
+          ret = 0;
+          break;
+        }
+
+      if (pfd[0].revents & POLLIN)
+        {
+          ret = usrsockd_process(&lb->ud);
+          if (ret < 0)
+            {
+              break;
+            }
+        }
+    }
+
+  return (FAR void *)(intptr_t)ret;
+}
+
+/****************************************************************************
+ * Name: loopback_start
+ ****************************************************************************/
+
+static int loopback_start(void)
+{
+  int ret;
+
+  memset(&g_loopback, 0, sizeof(g_loopback));
+
+  ret = usrsockd_open(&g_loopback.ud, g_loopback_handlers, &g_loopback);
+  if (ret < 0)
+    {
+      return ret;
+    }
+
+  if (pipe(g_loopback.pipefd) < 0)
+    {
+      ret = -errno;
+      goto errout_close;
+    }
+
+  ret = pthread_create(&g_loopback.tid, NULL, loopback_daemon,
+                       &g_loopback);
+  if (ret != 0)
+    {
+      ret = -ret;
+      goto errout_pipe;
+    }
+
+  return OK;
+
+errout_pipe:
+  close(g_loopback.pipefd[0]);
+  close(g_loopback.pipefd[1]);
+
+errout_close:
+  usrsockd_close(&g_loopback.ud);
+  return ret;
+}
+
+/****************************************************************************
+ * Name: loopback_stop
+ ****************************************************************************/
+
+static int loopback_stop(void)
+{
+  FAR pthread_addr_t retval;
+  char stop = 'S';
+  int i;
+
+  write(g_loopback.pipefd[1], &stop, 1);
+  pthread_join(g_loopback.tid, &retval);
+
+  for (i = 0; i < LOOPBACK_NSOCKS; i++)
+    {
+      if (g_loopback.socks[i].opened)
+        {
+          usrsockd_ring_free(&g_loopback.socks[i].ring);
+          g_loopback.socks[i].opened = false;
+        }
+    }
+
+  close(g_loopback.pipefd[0]);
+  close(g_loopback.pipefd[1]);
+  usrsockd_close(&g_loopback.ud);
+  return (intptr_t)retval;
+}
+
+/****************************************************************************
+ * Name: loopback_pattern
+ ****************************************************************************/
+
+static uint8_t loopback_pattern(size_t off)
+{
+  return (uint8_t)(off * 7 + (off >> 8));
+}
+
+/****************************************************************************
+ * Name: loopback_connect_sd
+ ****************************************************************************/
+
+static void loopback_connect_sd(void)
+{
+  struct sockaddr_in addr;
+  int ret;
+
+  TEST_ASSERT_EQUAL(OK, loopback_start());
+  started = true;
+
+  sd = socket(AF_INET, SOCK_STREAM, 0);
+  TEST_ASSERT_TRUE(sd >= 0);
+
+  memset(&addr, 0, sizeof(addr));
+  inet_pton(AF_INET, "127.0.0.1", &addr.sin_addr.s_addr);
+  addr.sin_family = AF_INET;
+  addr.sin_port = htons(255);
+  ret = connect(sd, (FAR const struct sockaddr *)&addr, sizeof(addr));
+  TEST_ASSERT_EQUAL(0, ret);
+}
+
+/****************************************************************************
+ * Name: loopback test group setup
+ *
+ * Description:
+ *   Setup function executed before each testcase in this test group
+ *
+ * Input Parameters:
+ *   None
+ *
+ * Returned Value:
+ *   None
+ *
+ * Assumptions/Limitations:
+ *   None
+ *
+ ****************************************************************************/
+
+TEST_SETUP(loopback)
+{
+  sd = -1;
+  started = false;
+}
+
+/****************************************************************************
+ * Name: loopback test group teardown
+ *
+ * Description:
+ *   Setup function executed after each testcase in this test group
+ *
+ * Input Parameters:
+ *   None
+ *
+ * Returned Value:
+ *   None
+ *
+ * Assumptions/Limitations:
+ *   None
+ *
+ ****************************************************************************/
+
+TEST_TEAR_DOWN(loopback)
+{
+  int ret;
+
+  if (sd >= 0)
+    {
+      ret = close(sd);
+      TEST_ASSERT_TRUE(ret >= 0);
+    }
+
+  if (started)
+    {
+      ret = loopback_stop();
+      TEST_ASSERT_EQUAL(OK, ret);
+    }
+}
+
+/****************************************************************************
+ * Name: echo
+ *
+ * Description:
+ *   Stream data of varying chunk sizes through the daemon and check that
+ *   it comes back intact, including the parts that wrap around the end of
+ *   the receive ring.
+ *
+ * Input Parameters:
+ *   None
+ *
+ * Returned Value:
+ *   None
+ *
+ * Assumptions/Limitations:
+ *   None
+ *
+ ****************************************************************************/
+
+TEST(loopback, echo)
+{
+  static const size_t chunks[] =
+  {
+    1, 333, 1000, 77
+  };
+
+  uint8_t buf[1000];
+  size_t sent = 0;
+  size_t recvd = 0;
+  size_t chunk;
+  ssize_t ret;
+  size_t i;
+  int n = 0;
+
+  loopback_connect_sd();
+  if (usrsocktest_test_failed)
+    {
+      return;
+    }
+
+  while (recvd < LOOPBACK_STREAMLEN)
+    {
+      /* Keep the ring from filling up, a blocked send() could not be
+       * released from this thread.
+       */
+
+      chunk = chunks[n++ % nitems(chunks)];
+      chunk = MIN(chunk, LOOPBACK_STREAMLEN - sent);
+      if (chunk > 0 && sent - recvd + chunk <= LOOPBACK_RINGSIZE)
+        {
+          for (i = 0; i < chunk; i++)
+            {
+              buf[i] = loopback_pattern(sent + i);
+            }
+
+          ret = send(sd, buf, chunk, 0);
+          TEST_ASSERT_TRUE(ret > 0);
+          sent += ret;
+          continue;
+        }
+
+      ret = recv(sd, buf, LOOPBACK_RECVMAX, 0);
+      TEST_ASSERT_TRUE(ret > 0);
+
+      for (i = 0; i < ret; i++)
+        {
+          TEST_ASSERT_EQUAL(loopback_pattern(recvd + i), buf[i]);
+        }
+
+      recvd += ret;
+    }
+
+  TEST_ASSERT_EQUAL(LOOPBACK_STREAMLEN, sent);
+}
+
+/****************************************************************************
+ * Name: perf
+ *
+ * Description:
+ *   Ping-pong small messages through the daemon and report the request
+ *   rate, the round trip latency and how many requests each wakeup of the
+ *   daemon handled.
+ *
+ * Input Parameters:
+ *   None
+ *
+ * Returned Value:
+ *   None
+ *
+ * Assumptions/Limitations:
+ *   None
+ *
+ ****************************************************************************/
+
+TEST(loopback, perf)
+{
+  uint8_t txbuf[LOOPBACK_MSGLEN];
+  uint8_t rxbuf[LOOPBACK_MSGLEN];
+  struct timespec start;
+  struct timespec end;
+  uint32_t nrequests;
+  uint32_t nwakeups;
+  uint32_t nwrites;
+  uint32_t usec;
+  ssize_t ret;
+  int i;
+
+  loopback_connect_sd();
+  if (usrsocktest_test_failed)
+    {
+      return;
+    }
+
+  nrequests = g_loopback.ud.nrequests;
+  nwakeups  = g_loopback.ud.nwakeups;
+  nwrites   = g_loopback.ud.nwrites;
+
+  clock_gettime(CLOCK_MONOTONIC, &start);
+
+  for (i = 0; i < LOOPBACK_ROUNDS; i++)
+    {
+      memset(txbuf, i, sizeof(txbuf));
+
+      ret = send(sd, txbuf, sizeof(txbuf), 0);
+      TEST_ASSERT_EQUAL(sizeof(txbuf), ret);
+
+      ret = recv(sd, rxbuf, sizeof(rxbuf), 0);
+      TEST_ASSERT_EQUAL(sizeof(rxbuf), ret);
+      TEST_ASSERT_EQUAL_UINT8_ARRAY(txbuf, rxbuf, sizeof(rxbuf));
+    }
+
+  clock_gettime(CLOCK_MONOTONIC, &end);
+
+  nrequests = g_loopback.ud.nrequests - nrequests;
+  nwakeups  = g_loopback.ud.nwakeups - nwakeups;
+  nwrites   = g_loopback.ud.nwrites - nwrites;
+  usec      = (end.tv_sec - start.tv_sec) * 1000000 +
+              (end.tv_nsec - start.tv_nsec) / 1000;
+
+  TEST_ASSERT_TRUE(nrequests >= 2 * LOOPBACK_ROUNDS);
+
+  printf("\t\t%" PRIu32 " requests in %" PRIu32 " us: "
+         "%" PRIu32 " req/s, %" PRIu32 " us per round trip\n",
+         nrequests, usec,
+         (uint32_t)((uint64_t)nrequests * 1000000 / MAX(usec, 1)),
+         usec / LOOPBACK_ROUNDS);
+  printf("\t\t%" PRIu32 " wakeups, %" PRIu32 " writes, "
+         "%" PRIu32 ".%02" PRIu32 " requests per wakeup\n",
+         nwakeups, nwrites, nrequests / MAX(nwakeups, 1),
+         nrequests * 100 / MAX(nwakeups, 1) % 100);
+}
+
+/****************************************************************************
+ * Public Functions
+ ****************************************************************************/
+
+TEST_GROUP(loopback)
+{
+  RUN_TEST_CASE(loopback, echo);
+  RUN_TEST_CASE(loopback, perf);
+}
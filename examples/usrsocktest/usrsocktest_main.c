@@ -164,6 +164,7 @@ static void run_all_tests(void)
   RUN_TEST_GROUP(basic_getsockname);
   RUN_TEST_GROUP(wake_with_signal);
   RUN_TEST_GROUP(multithread);
+  RUN_TEST_GROUP(loopback);
 }
 
 /****************************************************************************
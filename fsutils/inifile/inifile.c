@@ -26,8 +26,12 @@
 
 #include <nuttx/config.h>
 
+#include <sys/stat.h>
+#include <ctype.h>
+#include <inttypes.h>
 #include <stdio.h>
 #include <stdlib.h>
+#include <string.h>
 #include <strings.h>
 #include <nuttx/debug.h>
 
@@ -47,6 +51,16 @@
 #  define CONFIG_FSUTILS_INIFILE_DEBUGLEVEL 0
 #endif
 
+/* The upper limit on memory used by the lookup index.  Larger files are
+ * parsed from the stream on every lookup.
+ */
+
+#ifndef CONFIG_FSUTILS_INIFILE_INDEX_MAXSIZE
+#  define CONFIG_FSUTILS_INIFILE_INDEX_MAXSIZE 8192
+#endif
+
+#define INIFILE_NO_SECTION UINT16_MAX
+
 #if CONFIG_FSUTILS_INIFILE_DEBUGLEVEL < 1
 #  define inidbg _none
 #elif defined(CONFIG_CPP_HAVE_VARARGS)
@@ -77,6 +91,35 @@ struct inifile_var_s
   FAR char *value;
 };
 
+#ifdef CONFIG_FSUTILS_INIFILE_INDEX
+/* One indexed variable.  Only the file offset of the variable line is
+ * kept in memory; the line is re-read on lookup.
+ */
+
+struct inifile_entry_s
+{
+  uint32_t hash;      /* Hash of the section index and variable name */
+  uint32_t next;      /* Next entry in the bucket (index + 1, 0 = none) */
+  off_t    offset;    /* File offset of the variable line */
+  uint16_t section;   /* Index of the owning section */
+};
+
+/* The lookup index built by a single pass over the INI file */
+
+struct inifile_index_s
+{
+  FAR char **sections;                /* Section names in file order */
+  FAR struct inifile_entry_s *entries;
+  FAR uint32_t *buckets;              /* Entry index + 1, 0 = empty */
+  uint32_t nbuckets;                  /* Power of two */
+  uint32_t nentries;
+  uint16_t nsections;
+  size_t   memsize;                   /* Bytes held by the index */
+  time_t   mtime;                     /* File state the index reflects */
+  off_t    size;
+};
+#endif
+
 /* A structure describes the state of one instance of the INI file parser */
 
 struct inifile_state_s
@@ -84,6 +127,10 @@ struct inifile_state_s
   FILE *instream;
   int   nextch;
   char  line[CONFIG_FSUTILS_INIFILE_MAXLINE + 1];
+#ifdef CONFIG_FSUTILS_INIFILE_INDEX
+  FAR struct inifile_index_s *index;  /* NULL: parse the stream */
+  bool  noindex;                      /* Index did not fit in memory */
+#endif
 };
 
 /****************************************************************************
@@ -107,6 +154,15 @@ static FAR char *
 static FAR char *
             inifile_find_variable(FAR struct inifile_state_s *priv,
               FAR const char *section, FAR const char *variable);
+#ifdef CONFIG_FSUTILS_INIFILE_INDEX
+static void inifile_free_index(FAR struct inifile_index_s *index);
+static FAR struct inifile_index_s *
+            inifile_build_index(FAR struct inifile_state_s *priv);
+static bool inifile_check_index(FAR struct inifile_state_s *priv);
+static FAR char *
+            inifile_index_find(FAR struct inifile_state_s *priv,
+              FAR const char *section, FAR const char *variable);
+#endif
 
 /****************************************************************************
  * Private Functions
@@ -425,6 +481,371 @@ static FAR char *
     }
 }
 
+#ifdef CONFIG_FSUTILS_INIFILE_INDEX
+/****************************************************************************
+ * Name:  inifile_hash
+ *
+ * Description:
+ *   Case-insensitive FNV-1a hash of a variable name within a section.  The
+ *   name ends at the NUL terminator.
+ *
+ ****************************************************************************/
+
+static uint32_t inifile_hash(uint16_t section, FAR const char *name)
+{
+  uint32_t hash = 2166136261u ^ section;
+
+  while (*name != '\0')
+    {
+      hash ^= (uint8_t)tolower(*name++);
+      hash *= 16777619u;
+    }
+
+  return hash;
+}
+
+/****************************************************************************
+ * Name:  inifile_index_reserve
+ *
+ * Description:
+ *   Grow an index array by doubling.  Fails if the index would exceed its
+ *   memory budget.
+ *
+ ****************************************************************************/
+
+static bool inifile_index_reserve(FAR struct inifile_index_s *index,
+                                  FAR void **array, uint32_t count,
+                                  size_t elemsize)
+{
+  FAR void *newarray;
+  uint32_t newcount;
+
+  /* Arrays are grown whenever count reaches a power of two */
+
+  if (count != 0 && (count & (count - 1)) != 0)
+    {
+      return true;
+    }
+
+  newcount = count != 0 ? count * 2 : 8;
+  if (CONFIG_FSUTILS_INIFILE_INDEX_MAXSIZE > 0 &&
+      index->memsize + (newcount - count) * elemsize >
+      CONFIG_FSUTILS_INIFILE_INDEX_MAXSIZE)
+    {
+      return false;
+    }
+
+  newarray = realloc(*array, newcount * elemsize);
+  if (newarray == NULL)
+    {
+      return false;
+    }
+
+  index->memsize += (newcount - count) * elemsize;
+  *array = newarray;
+  return true;
+}
+
+/****************************************************************************
+ * Name:  inifile_index_lookup
+ *
+ * Description:
+ *   Return the index of the first entry with the given section and name,
+ *   or -1.  Names are verified by re-reading the variable line, which
+ *   leaves the parsed line in priv->line.
+ *
+ ****************************************************************************/
+
+static int inifile_index_lookup(FAR struct inifile_state_s *priv,
+                                FAR struct inifile_index_s *index,
+                                uint16_t section, FAR const char *variable,
+                                FAR struct inifile_var_s *varinfo)
+{
+  uint32_t hash = inifile_hash(section, variable);
+  uint32_t i = index->buckets[hash & (index->nbuckets - 1)];
+
+  while (i != 0)
+    {
+      FAR struct inifile_entry_s *entry = &index->entries[i - 1];
+
+      if (entry->hash == hash && entry->section == section &&
+          fseek(priv->instream, entry->offset, SEEK_SET) == 0)
+        {
+          priv->nextch = getc(priv->instream);
+          if (inifile_read_variable(priv, varinfo) &&
+              strcasecmp(varinfo->variable, variable) == 0)
+            {
+              return i - 1;
+            }
+        }
+
+      i = entry->next;
+    }
+
+  return -1;
+}
+
+/****************************************************************************
+ * Name:  inifile_free_index
+ ****************************************************************************/
+
+static void inifile_free_index(FAR struct inifile_index_s *index)
+{
+  uint16_t i;
+
+  if (index != NULL)
+    {
+      for (i = 0; i < index->nsections; i++)
+        {
+          free(index->sections[i]);
+        }
+
+      free(index->sections);
+      free(index->entries);
+      free(index->buckets);
+      free(index);
+    }
+}
+
+/****************************************************************************
+ * Name:  inifile_build_index
+ *
+ * Description:
+ *   Parse the whole INI file once and record where each variable lives.
+ *   Lookups through the index must return exactly what the streaming
+ *   parser returns, so the same rules apply:  the first section of a
+ *   given name wins, the first assignment of a variable wins, and a blank
+ *   line or a short '[' line ends the section.  Returns NULL if the file
+ *   could not be indexed within the memory budget.
+ *
+ ****************************************************************************/
+
+static FAR struct inifile_index_s *
+  inifile_build_index(FAR struct inifile_state_s *priv)
+{
+  FAR struct inifile_index_s *index;
+  struct inifile_var_s varinfo;
+  struct stat buf;
+  uint16_t section = INIFILE_NO_SECTION;
+  off_t offset;
+  uint32_t i;
+  int nbytes;
+
+  if (fstat(fileno(priv->instream), &buf) < 0)
+    {
+      return NULL;
+    }
+
+  index = calloc(1, sizeof(struct inifile_index_s));
+  if (index == NULL)
+    {
+      return NULL;
+    }
+
+  index->mtime   = buf.st_mtime;
+  index->size    = buf.st_size;
+  index->memsize = sizeof(struct inifile_index_s);
+
+  rewind(priv->instream);
+  priv->nextch = getc(priv->instream);
+
+  while (priv->nextch != EOF)
+    {
+      /* The look-ahead character has already been consumed */
+
+      offset = ftell(priv->instream) - 1;
+      nbytes = inifile_read_line(priv);
+
+      if (nbytes > 0 && priv->line[0] == ';')
+        {
+          continue;
+        }
+
+      if (nbytes >= 3 && priv->line[0] == '[')
+        {
+          FAR char *sectend = strchr(&priv->line[1], ']');
+
+          if (sectend)
+            {
+              *sectend = '\0';
+            }
+
+          if (index->nsections == INIFILE_NO_SECTION ||
+              !inifile_index_reserve(index, (FAR void **)&index->sections,
+                                     index->nsections, sizeof(FAR char *)))
+            {
+              goto errout;
+            }
+
+          index->sections[index->nsections] = strdup(&priv->line[1]);
+          if (index->sections[index->nsections] == NULL)
+            {
+              goto errout;
+            }
+
+          index->memsize += strlen(&priv->line[1]) + 1;
+          section = index->nsections++;
+          continue;
+        }
+
+      if (nbytes == 0 || priv->line[0] == '[')
+        {
+          section = INIFILE_NO_SECTION;
+          continue;
+        }
+
+      if (section == INIFILE_NO_SECTION)
+        {
+          continue;
+        }
+
+      /* Split the line the same way inifile_read_variable() does */
+
+      varinfo.variable = priv->line;
+      varinfo.value    = strchr(&priv->line[1], '=');
+      if (varinfo.value == NULL)
+        {
+          continue;
+        }
+
+      *varinfo.value = '\0';
+
+      if (!inifile_index_reserve(index, (FAR void **)&index->entries,
+                                 index->nentries,
+                                 sizeof(struct inifile_entry_s)))
+        {
+          goto errout;
+        }
+
+      index->entries[index->nentries].hash =
+        inifile_hash(section, varinfo.variable);
+      index->entries[index->nentries].section = section;
+      index->entries[index->nentries].offset  = offset;
+      index->entries[index->nentries].next    = 0;
+      index->nentries++;
+    }
+
+  /* Hash the entries.  Chains are kept in file order so that the first
+   * assignment of a variable is found first.
+   */
+
+  for (index->nbuckets = 1; index->nbuckets < index->nentries; )
+    {
+      index->nbuckets <<= 1;
+    }
+
+  if (CONFIG_FSUTILS_INIFILE_INDEX_MAXSIZE > 0 &&
+      index->memsize + index->nbuckets * sizeof(uint32_t) >
+      CONFIG_FSUTILS_INIFILE_INDEX_MAXSIZE)
+    {
+      goto errout;
+    }
+
+  index->buckets = calloc(index->nbuckets, sizeof(uint32_t));
+  if (index->buckets == NULL)
+    {
+      goto errout;
+    }
+
+  index->memsize += index->nbuckets * sizeof(uint32_t);
+
+  for (i = index->nentries; i > 0; i--)
+    {
+      FAR struct inifile_entry_s *entry = &index->entries[i - 1];
+      FAR uint32_t *bucket =
+        &index->buckets[entry->hash & (index->nbuckets - 1)];
+
+      entry->next = *bucket;
+      *bucket = i;
+    }
+
+  iniinfo("Indexed %u sections, %" PRIu32 " variables in %zu bytes\n",
+          index->nsections, index->nentries, index->memsize);
+  return index;
+
+errout:
+  inidbg("ERROR: INI file index exceeds the memory budget\n");
+  inifile_free_index(index);
+  return NULL;
+}
+
+/****************************************************************************
+ * Name:  inifile_check_index
+ *
+ * Description:
+ *   Make sure that the index reflects the current file content, rebuilding
+ *   it if the file was modified.  Returns false if lookups must use the
+ *   stream instead.
+ *
+ ****************************************************************************/
+
+static bool inifile_check_index(FAR struct inifile_state_s *priv)
+{
+  struct stat buf;
+
+  if (priv->noindex)
+    {
+      return false;
+    }
+
+  if (priv->index != NULL)
+    {
+      if (fstat(fileno(priv->instream), &buf) == 0 &&
+          buf.st_mtime == priv->index->mtime &&
+          buf.st_size == priv->index->size)
+        {
+          return true;
+        }
+
+      iniinfo("INI file changed, rebuilding the index\n");
+      inifile_free_index(priv->index);
+    }
+
+  priv->index = inifile_build_index(priv);
+  priv->noindex = priv->index == NULL;
+  return !priv->noindex;
+}
+
+/****************************************************************************
+ * Name:  inifile_index_find
+ *
+ * Description:
+ *   The indexed equivalent of inifile_find_variable()
+ *
+ ****************************************************************************/
+
+static FAR char *inifile_index_find(FAR struct inifile_state_s *priv,
+                                    FAR const char *section,
+                                    FAR const char *variable)
+{
+  FAR struct inifile_index_s *index = priv->index;
+  struct inifile_var_s varinfo;
+  uint16_t i;
+
+  for (i = 0; i < index->nsections; i++)
+    {
+      if (strcasecmp(index->sections[i], section) == 0)
+        {
+          break;
+        }
+    }
+
+  if (i >= index->nsections)
+    {
+      inidbg("ERROR: Section \"%s\" not found\n", section);
+      return NULL;
+    }
+
+  if (inifile_index_lookup(priv, index, i, variable, &varinfo) < 0)
+    {
+      return NULL;
+    }
+
+  iniinfo("variable_value=\"%s\"\n", varinfo.value);
+  return *varinfo.value ? varinfo.value : NULL;
+}
+#endif
+
 /****************************************************************************
  * Name:  inifile_find_variable
  *
@@ -442,6 +863,15 @@ static FAR char *inifile_find_variable(FAR struct inifile_state_s *priv,
 
   iniinfo("section=\"%s\" variable=\"%s\"\n", section, variable);
 
+#ifdef CONFIG_FSUTILS_INIFILE_INDEX
+  /* Use the index unless it could not be built within its memory budget */
+
+  if (priv->instream && inifile_check_index(priv))
+    {
+      return inifile_index_find(priv, section, variable);
+    }
+#endif
+
   /* Seek to the first variable in the specified section of the INI file */
 
   if (priv->instream && inifile_seek_to_section(priv, section))
@@ -500,6 +930,16 @@ INIHANDLE inifile_initialize(FAR const char *inifile_name)
   if (priv->instream)
     {
       priv->nextch = getc(priv->instream);
+
+#ifdef CONFIG_FSUTILS_INIFILE_INDEX
+      /* Build the lookup index in a single pass.  If it does not fit,
+       * lookups fall back to parsing the stream.
+       */
+
+      priv->index = inifile_build_index(priv);
+      priv->noindex = priv->index == NULL;
+#endif
+
       return (INIHANDLE)priv;
     }
   else
@@ -531,6 +971,10 @@ void inifile_uninitialize(INIHANDLE handle)
           fclose(priv->instream);
         }
 
+#ifdef CONFIG_FSUTILS_INIFILE_INDEX
+      inifile_free_index(priv->index);
+#endif
+
       /* Release the state structure */
 
       free(priv);
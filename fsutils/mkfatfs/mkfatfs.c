@@ -30,7 +30,9 @@
 #include <stdint.h>
 #include <stdlib.h>
 #include <fcntl.h>
+#include <stdio.h>
 #include <string.h>
+#include <time.h>
 #include <nuttx/debug.h>
 #include <errno.h>
 #include <unistd.h>
@@ -246,6 +248,9 @@ static inline int mkfatfs_getgeometry(FAR struct fat_format_s *fmt,
 int mkfatfs(FAR const char *pathname, FAR struct fat_format_s *fmt)
 {
   struct fat_var_s var;
+  struct timespec start;
+  struct timespec end;
+  uint32_t elapsed;
   int ret;
 
   /* Initialize */
@@ -362,9 +367,62 @@ int mkfatfs(FAR const char *pathname, FAR struct fat_format_s *fmt)
       goto errout_with_driver;
     }
 
+  /* Allocate a zeroed buffer so that the FATs and the root directory can
+   * be cleared with multi-sector writes.  Fall back to one sector at a
+   * time if memory is short.
+   */
+
+  var.fv_zerosects = CONFIG_MKFATFS_ZERO_BUFSIZE >> var.fv_sectshift;
+  while (var.fv_zerosects > 1)
+    {
+      var.fv_zero = (FAR uint8_t *)
+        fat_buffer_alloc(var.fv_zerosects << var.fv_sectshift);
+      if (var.fv_zero != NULL)
+        {
+          break;
+        }
+
+      var.fv_zerosects >>= 1;
+    }
+
+  if (var.fv_zero == NULL)
+    {
+      var.fv_zerosects = 1;
+      var.fv_zero = (FAR uint8_t *)fat_buffer_alloc(var.fv_sectorsize);
+      if (!var.fv_zero)
+        {
+          ferr("ERROR: Failed to allocate working buffers\n");
+          ret = -ENOMEM;
+          goto errout_with_driver;
+        }
+    }
+
+  memset(var.fv_zero, 0, var.fv_zerosects << var.fv_sectshift);
+
   /* Write the filesystem to media */
 
+  clock_gettime(CLOCK_MONOTONIC, &start);
   ret = mkfatfs_writefatfs(fmt, &var);
+  clock_gettime(CLOCK_MONOTONIC, &end);
+
+  if (ret >= 0 && (fmt->ff_flags & MKFATFS_FLAG_VERBOSE) != 0)
+    {
+      elapsed = (end.tv_sec - start.tv_sec) * 1000 +
+                (end.tv_nsec - start.tv_nsec) / 1000000;
+
+      printf("mkfatfs: FAT%d, %" PRIu32 " sectors written, %" PRIu32
+             " sectors erased in %" PRIu32 " ms",
+             fmt->ff_fattype, var.fv_nwritten, var.fv_ndiscarded, elapsed);
+      if (elapsed > 0)
+        {
+          printf(", %" PRIu32 " KiB/s",
+                 (uint32_t)(((uint64_t)(var.fv_nwritten +
+                                        var.fv_ndiscarded) <<
+                             var.fv_sectshift) / elapsed * 1000 / 1024));
+        }
+
+      printf("\n");
+    }
 
 errout_with_driver:
 
@@ -381,6 +439,11 @@ errout:
       free(var.fv_sect);
     }
 
+  if (var.fv_zero)
+    {
+      free(var.fv_zero);
+    }
+
   /* Return any reported errors */
 
   if (ret < 0)
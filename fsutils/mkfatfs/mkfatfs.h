@@ -28,6 +28,7 @@
  ****************************************************************************/
 
 #include <nuttx/config.h>
+#include <stdbool.h>
 #include <stdint.h>
 
 /****************************************************************************
@@ -47,6 +48,14 @@
 
 #define FAT_DEFAULT_FSINFO_SECTOR      1
 
+/* Default size of the zero buffer used to clear the FATs and the root
+ * directory with multi-sector writes.
+ */
+
+#ifndef CONFIG_MKFATFS_ZERO_BUFSIZE
+#  define CONFIG_MKFATFS_ZERO_BUFSIZE  8192
+#endif
+
 /* FAT32 foot cluster number */
 
 #define FAT32_DEFAULT_ROOT_CLUSTER     2
@@ -74,6 +83,13 @@ struct fat_var_s
   uint32_t       fv_nfatsects;      /* Number of sectors in each FAT */
   uint32_t       fv_nclusters;      /* Number of clusters */
   uint8_t       *fv_sect;           /* Allocated working sector buffer */
+  uint8_t       *fv_zero;           /* Zeroed buffer for multi-sector writes */
+  uint32_t       fv_zerosects;      /* Number of sectors in fv_zero */
+  bool           fv_discarded;      /* Metadata area was erased to zero */
+  uint32_t       fv_nmetasects;     /* Sectors up to the end of the root dir */
+  uint32_t       fv_nwritten;       /* Sectors written so far */
+  uint32_t       fv_ndiscarded;     /* Sectors erased instead of written */
+  uint8_t        fv_progress;       /* Last reported progress in percent */
   uint8_t        fv_bootcodepatch;  /* FAT16/FAT32 Bootcode offset patch */
   const uint8_t *fv_bootcodeblob;   /* Points to boot code to put into MBR */
 };
@@ -32,9 +32,14 @@
 #include <string.h>
 #include <errno.h>
 #include <nuttx/debug.h>
+#include <stdio.h>
 #include <unistd.h>
 
+#include <sys/ioctl.h>
+
 #include <nuttx/fs/fat.h>
+#include <nuttx/fs/ioctl.h>
+#include <nuttx/mtd/mtd.h>
 
 #include "fsutils/mkfatfs.h"
 #include "fat32.h"
@@ -45,38 +50,83 @@
  ****************************************************************************/
 
 /****************************************************************************
- * Name: mkfatfs_devwrite
+ * Name: mkfatfs_progress
  *
  * Description:
- *   Write the content of the dedicate sector buffer beginning to the
- *   specified sector
+ *   Account for sectors that were written or erased and report progress
+ *   through the metadata area in steps of 10% when verbose output was
+ *   requested.
+ *
+ ****************************************************************************/
+
+static void mkfatfs_progress(FAR const struct fat_format_s *fmt,
+                             FAR struct fat_var_s *var, uint32_t nwritten,
+                             uint32_t ndiscarded)
+{
+  uint32_t percent;
+
+  var->fv_nwritten   += nwritten;
+  var->fv_ndiscarded += ndiscarded;
+
+  if ((fmt->ff_flags & MKFATFS_FLAG_VERBOSE) == 0 ||
+      var->fv_nmetasects == 0)
+    {
+      return;
+    }
+
+  percent = (uint64_t)(var->fv_nwritten + var->fv_ndiscarded) * 100 /
+            var->fv_nmetasects;
+  if (percent > 100)
+    {
+      percent = 100;
+    }
+
+  if (percent >= var->fv_progress + 10U)
+    {
+      var->fv_progress = percent - percent % 10;
+      printf("mkfatfs: %3u%%\n", var->fv_progress);
+    }
+}
+
+/****************************************************************************
+ * Name: mkfatfs_devwritebuf
+ *
+ * Description:
+ *   Write nsectors sectors from buffer beginning at the specified sector
+ *   with a single seek and write.
  *
  * Input:
- *    fmt  - User specified format parameters
- *    var  - Other format parameters that are not user specifiable
+ *    fmt      - User specified format parameters
+ *    var      - Other format parameters that are not user specifiable
+ *    sector   - The first sector to write
+ *    buffer   - The data to write
+ *    nsectors - The number of sectors in buffer
  *
  * Return:
- *    None; caller is responsible for providing valid parameters.
+ *    Zero on success; negated errno on failure
  *
  ****************************************************************************/
 
-static int mkfatfs_devwrite(FAR const struct fat_format_s *fmt,
-                            FAR const struct fat_var_s *var, off_t sector)
+static int mkfatfs_devwritebuf(FAR const struct fat_format_s *fmt,
+                               FAR struct fat_var_s *var, off_t sector,
+                               FAR const uint8_t *buffer, uint32_t nsectors)
 {
   ssize_t nwritten;
+  size_t nbytes;
   off_t seekpos;
   off_t fpos;
   int ret;
 
   /* Convert the sector number to a byte offset */
 
-  if (sector < 0 || sector >= (off_t)fmt->ff_nsectors)
+  if (sector < 0 || sector + nsectors > (off_t)fmt->ff_nsectors)
     {
       ferr("sector out of range: %ju\n", (intmax_t)sector);
       return -ESPIPE;
     }
 
   fpos = sector << var->fv_sectshift;
+  nbytes = (size_t)nsectors << var->fv_sectshift;
 
   /* Seek to that offset */
 
@@ -94,23 +144,168 @@ static int mkfatfs_devwrite(FAR const struct fat_format_s *fmt,
       return -EINVAL;
     }
 
-  /* Write the sector to that offset.  Partial writes are not expected. */
+  /* Write the sectors to that offset.  Partial writes are not expected. */
 
-  nwritten = write(var->fv_fd, var->fv_sect, var->fv_sectorsize);
+  nwritten = write(var->fv_fd, buffer, nbytes);
   if (nwritten < 0)
     {
       ret = -errno;
-      ferr("ERROR:  write failed: size=%" PRIu32 " pos=%jd error=%d\n",
-           var->fv_sectorsize, (intmax_t)fpos, ret);
+      ferr("ERROR:  write failed: size=%zu pos=%jd error=%d\n",
+           nbytes, (intmax_t)fpos, ret);
       return ret;
     }
-  else if (nwritten != (ssize_t)var->fv_sectorsize)
+  else if (nwritten != (ssize_t)nbytes)
     {
-      ferr("ERROR:  Partial write: size=%" PRIu32 " written=%zd\n",
-           var->fv_sectorsize, nwritten);
+      ferr("ERROR:  Partial write: size=%zu written=%zd\n",
+           nbytes, nwritten);
       return -ENODATA;
     }
 
+  mkfatfs_progress(fmt, var, nsectors, 0);
+  return OK;
+}
+
+/****************************************************************************
+ * Name: mkfatfs_devwrite
+ *
+ * Description:
+ *   Write the content of the dedicate sector buffer beginning to the
+ *   specified sector
+ *
+ * Input:
+ *    fmt  - User specified format parameters
+ *    var  - Other format parameters that are not user specifiable
+ *
+ * Return:
+ *    None; caller is responsible for providing valid parameters.
+ *
+ ****************************************************************************/
+
+static int mkfatfs_devwrite(FAR const struct fat_format_s *fmt,
+                            FAR struct fat_var_s *var, off_t sector)
+{
+  return mkfatfs_devwritebuf(fmt, var, sector, var->fv_sect, 1);
+}
+
+/****************************************************************************
+ * Name: mkfatfs_devzero
+ *
+ * Description:
+ *   Clear a range of sectors.  Nothing needs to be written if the metadata
+ *   area was already erased to zero, otherwise the range is written from
+ *   the zero buffer, up to fv_zerosects sectors per write.
+ *
+ * Input:
+ *    fmt      - User specified format parameters
+ *    var      - Other format parameters that are not user specifiable
+ *    sector   - The first sector to clear
+ *    nsectors - The number of sectors to clear
+ *
+ * Return:
+ *    Zero on success; negated errno on failure
+ *
+ ****************************************************************************/
+
+static int mkfatfs_devzero(FAR const struct fat_format_s *fmt,
+                           FAR struct fat_var_s *var, off_t sector,
+                           uint32_t nsectors)
+{
+  uint32_t nwrite;
+  int ret;
+
+  if (var->fv_discarded)
+    {
+      return OK;
+    }
+
+  while (nsectors > 0)
+    {
+      nwrite = nsectors < var->fv_zerosects ? nsectors : var->fv_zerosects;
+      ret = mkfatfs_devwritebuf(fmt, var, sector, var->fv_zero, nwrite);
+      if (ret < 0)
+        {
+          return ret;
+        }
+
+      sector   += nwrite;
+      nsectors -= nwrite;
+    }
+
+  return OK;
+}
+
+/****************************************************************************
+ * Name: mkfatfs_discard
+ *
+ * Description:
+ *   Try to clear the whole metadata area by erasing it instead of writing
+ *   zeros.  This is only possible if the device erases to zero and its
+ *   erase blocks are made up of whole sectors.  Partial erase blocks at
+ *   the end of the area are written with zeros.  On failure the caller
+ *   writes zeros over the whole area instead.
+ *
+ * Input:
+ *    fmt  - User specified format parameters
+ *    var  - Other format parameters that are not user specifiable
+ *
+ * Return:
+ *    Zero on success; negated errno on failure
+ *
+ ****************************************************************************/
+
+static int mkfatfs_discard(FAR const struct fat_format_s *fmt,
+                           FAR struct fat_var_s *var)
+{
+  struct mtd_geometry_s geo;
+  struct mtd_erase_s erase;
+  uint32_t sectsperblock;
+  uint8_t erasestate;
+  int ret;
+
+  ret = ioctl(var->fv_fd, MTDIOC_ERASESTATE,
+              (unsigned long)((uintptr_t)&erasestate));
+  if (ret < 0 || erasestate != 0)
+    {
+      return -ENOTSUP;
+    }
+
+  ret = ioctl(var->fv_fd, MTDIOC_GEOMETRY,
+              (unsigned long)((uintptr_t)&geo));
+  if (ret < 0 || geo.erasesize < var->fv_sectorsize ||
+      geo.erasesize % var->fv_sectorsize != 0)
+    {
+      return -ENOTSUP;
+    }
+
+  sectsperblock = geo.erasesize / var->fv_sectorsize;
+
+  /* The volume begins at sector zero, so the first erase block is
+   * aligned.
+   */
+
+  erase.startblock = 0;
+  erase.nblocks    = var->fv_nmetasects / sectsperblock;
+  if (erase.nblocks > 0)
+    {
+      ret = ioctl(var->fv_fd, MTDIOC_ERASESECTORS,
+                  (unsigned long)((uintptr_t)&erase));
+      if (ret < 0)
+        {
+          return -errno;
+        }
+    }
+
+  /* Clear the rest of the last, partial erase block */
+
+  mkfatfs_progress(fmt, var, 0, erase.nblocks * sectsperblock);
+  ret = mkfatfs_devzero(fmt, var, erase.nblocks * sectsperblock,
+                        var->fv_nmetasects - erase.nblocks * sectsperblock);
+  if (ret < 0)
+    {
+      return ret;
+    }
+
+  var->fv_discarded = true;
   return OK;
 }
 
@@ -412,7 +607,6 @@ static inline void mkfatfs_initrootdir(FAR struct fat_format_s *fmt,
 static inline int mkfatfs_writembr(FAR struct fat_format_s *fmt,
                                    FAR struct fat_var_s *var)
 {
-  int sectno;
   int ret;
 
   /* Create an image of the configured master boot record */
@@ -425,10 +619,9 @@ static inline int mkfatfs_writembr(FAR struct fat_format_s *fmt,
 
   /* Write all of the reserved sectors */
 
-  memset(var->fv_sect, 0, var->fv_sectorsize);
-  for (sectno = 1; sectno < fmt->ff_rsvdseccount && ret >= 0; sectno++)
+  if (ret >= 0 && fmt->ff_rsvdseccount > 1)
     {
-      ret = mkfatfs_devwrite(fmt, var, sectno);
+      ret = mkfatfs_devzero(fmt, var, 1, fmt->ff_rsvdseccount - 1);
     }
 
   /* Write FAT32-specific sectors */
@@ -487,75 +680,72 @@ static inline int mkfatfs_writefat(FAR struct fat_format_s *fmt,
 {
   off_t offset = fmt->ff_rsvdseccount;
   uint8_t fatno;
-  uint32_t sectno;
   int ret;
 
   /* Loop for each FAT copy */
 
   for (fatno = 0; fatno < fmt->ff_nfats; fatno++)
     {
-      /* Loop for each sector in the FAT */
+      /* Mark cluster allocations in sector one of each FAT */
 
-      for (sectno = 0; sectno < var->fv_nfatsects; sectno++)
+      memset(var->fv_sect, 0, var->fv_sectorsize);
+      switch (fmt->ff_fattype)
         {
-          memset(var->fv_sect, 0, var->fv_sectorsize);
-
-          /* Mark cluster allocations in sector one of each FAT */
+          case 12:
+            /* Mark the first two full FAT entries -- 24 bits,
+             * 3 bytes total
+             */
 
-          if (sectno == 0)
-            {
-              memset(var->fv_sect, 0, var->fv_sectorsize);
-              switch (fmt->ff_fattype)
-                {
-                  case 12:
-                    /* Mark the first two full FAT entries -- 24 bits,
-                     * 3 bytes total
-                     */
+            memset(var->fv_sect, 0xff, 3);
+            break;
 
-                    memset(var->fv_sect, 0xff, 3);
-                    break;
+          case 16:
+            /* Mark the first two full FAT entries -- 32 bits,
+             * 4 bytes total
+             */
 
-                  case 16:
-                    /* Mark the first two full FAT entries -- 32 bits,
-                     * 4 bytes total
-                     */
+            memset(var->fv_sect, 0xff, 4);
+            break;
 
-                    memset(var->fv_sect, 0xff, 4);
-                    break;
+          case 32:
+          default: /* Shouldn't happen */
 
-                  case 32:
-                  default: /* Shouldn't happen */
+            /* Mark the first two full FAT entries -- 64 bits,
+             * 8 bytes total
+             */
 
-                    /* Mark the first two full FAT entries -- 64 bits,
-                     * 8 bytes total
-                     */
+            memset(var->fv_sect, 0xff, 8);
 
-                    memset(var->fv_sect, 0xff, 8);
+            /* Cluster 2 is used as the root directory.
+             * Mark as EOF
+             */
 
-                    /* Cluster 2 is used as the root directory.
-                     * Mark as EOF
-                     */
+            var->fv_sect[8] =  0xf8;
+            memset(&var->fv_sect[9], 0xff, 3);
+            break;
+        }
 
-                    var->fv_sect[8] =  0xf8;
-                    memset(&var->fv_sect[9], 0xff, 3);
-                    break;
-                }
+      /* Save the media type in the first byte of the FAT */
 
-              /* Save the media type in the first byte of the FAT */
+      var->fv_sect[0] = FAT_DEFAULT_MEDIA_TYPE;
 
-              var->fv_sect[0] = FAT_DEFAULT_MEDIA_TYPE;
-            }
+      /* Write the first FAT sector */
 
-          /* Write the FAT sector */
+      ret = mkfatfs_devwrite(fmt, var, offset);
+      if (ret < 0)
+        {
+          return ret;
+        }
 
-          ret = mkfatfs_devwrite(fmt, var, offset);
-          if (ret < 0)
-            {
-              return ret;
-            }
+      /* The remaining sectors of the FAT are all zero */
 
-          offset++;
+      ret = mkfatfs_devzero(fmt, var, offset + 1, var->fv_nfatsects - 1);
+      if (ret < 0)
+        {
+          return ret;
         }
+
+      offset += var->fv_nfatsects;
     }
 
   return OK;
@@ -581,30 +771,25 @@ static inline int mkfatfs_writerootdir(FAR struct fat_format_s *fmt,
 {
   off_t offset = fmt->ff_rsvdseccount + fmt->ff_nfats * var->fv_nfatsects;
   int ret;
-  int i;
 
   /* Write the root directory after the last FAT. This is the root directory
-   * area for FAT12/16, and the first cluster on FAT32.
+   * area for FAT12/16, and the first cluster on FAT32.  Only the first
+   * sector holds data, the rest of the directory is zero.
    */
 
-  for (i = 0; i < var->fv_nrootdirsects; i++)
+  if (var->fv_nrootdirsects == 0)
     {
-      /* Format the next sector of the root directory */
-
-      mkfatfs_initrootdir(fmt, var, i);
-
-      /* Write the next sector of the root directory */
-
-      ret = mkfatfs_devwrite(fmt, var, offset);
-      if (ret < 0)
-        {
-          return ret;
-        }
+      return 0;
+    }
 
-      offset++;
+  mkfatfs_initrootdir(fmt, var, 0);
+  ret = mkfatfs_devwrite(fmt, var, offset);
+  if (ret < 0)
+    {
+      return ret;
     }
 
-  return 0;
+  return mkfatfs_devzero(fmt, var, offset + 1, var->fv_nrootdirsects - 1);
 }
 
 /****************************************************************************
@@ -630,11 +815,32 @@ static inline int mkfatfs_writerootdir(FAR struct fat_format_s *fmt,
 int mkfatfs_writefatfs(FAR struct fat_format_s *fmt,
                        FAR struct fat_var_s *var)
 {
-  int ret;
+  int ret = OK;
+
+  var->fv_nmetasects = fmt->ff_rsvdseccount +
+                       fmt->ff_nfats * var->fv_nfatsects +
+                       var->fv_nrootdirsects;
+
+  /* Clear the whole metadata area by erasing it if requested.  If the
+   * device cannot do that, zeros are written sector range by sector range.
+   */
+
+  if ((fmt->ff_flags & MKFATFS_FLAG_DISCARD) != 0)
+    {
+      ret = mkfatfs_discard(fmt, var);
+      if (ret < 0)
+        {
+          finfo("Discard not possible (%d), writing zeros\n", ret);
+          ret = OK;
+        }
+    }
 
   /* Write the master boot record (also the backup and fsinfo sectors) */
 
-  ret = mkfatfs_writembr(fmt, var);
+  if (ret >= 0)
+    {
+      ret = mkfatfs_writembr(fmt, var);
+    }
 
   /* Write FATs */
 
@@ -668,31 +668,18 @@ static void PDC_gotoyx_term(FAR SCREEN *s, int row, int col)
 #endif
 
 /****************************************************************************
- * Name: PDC_set_char_attrib_term
+ * Name: PDC_set_attrib_term
  *
  * Description:
- *   Sets the specified character attributes.
+ *   Sets the terminal text attributes if they differ from the current ones.
  *
  ****************************************************************************/
 
 #ifdef CONFIG_SYSTEM_TERMCURSES
-static void PDC_set_char_attrib_term(FAR struct pdc_termscreen_s *termscreen,
-              chtype ch)
+static void PDC_set_attrib_term(FAR struct pdc_termstate_s *termstate,
+                                long attrib)
 {
-  FAR struct pdc_termstate_s *termstate = &termscreen->termstate;
-  struct termcurses_colors_s   colors;
-  short fg;
-  short bg;
-  long  attrib;
-  long  term_attrib;
-
-  /* Handle the attributes */
-
-#ifdef CONFIG_PDCURSES_CHTYPE_LONG
-  attrib = ch & (A_BOLD | A_BLINK | A_UNDERLINE | A_INVIS);
-#else
-  attrib = ch & (A_BOLD | A_BLINK);
-#endif
+  long term_attrib;
 
   if (attrib != termstate->attrib)
     {
@@ -709,6 +696,11 @@ static void PDC_set_char_attrib_term(FAR struct pdc_termscreen_s *termscreen,
           term_attrib |= TCURS_ATTRIB_BLINK;
         }
 
+      if (attrib & A_ALTCHARSET)
+        {
+          term_attrib |= TCURS_ATTRIB_ALTCHARSET;
+        }
+
 #ifdef CONFIG_PDCURSES_CHTYPE_LONG
       if (attrib & A_UNDERLINE)
         {
@@ -719,12 +711,39 @@ static void PDC_set_char_attrib_term(FAR struct pdc_termscreen_s *termscreen,
         {
           term_attrib |= TCURS_ATTRIB_INVIS;
         }
-
-      termcurses_setattribute(termstate->tcurs, term_attrib);
 #endif
 
+      termcurses_setattribute(termstate->tcurs, term_attrib);
       termstate->attrib = attrib;
     }
+}
+#endif   /* CONFIG_SYSTEM_TERMCURSES */
+
+/****************************************************************************
+ * Name: PDC_set_char_attrib_term
+ *
+ * Description:
+ *   Sets the specified character attributes.
+ *
+ ****************************************************************************/
+
+#ifdef CONFIG_SYSTEM_TERMCURSES
+static void PDC_set_char_attrib_term(FAR struct pdc_termscreen_s *termscreen,
+              chtype ch)
+{
+  FAR struct pdc_termstate_s *termstate = &termscreen->termstate;
+  struct termcurses_colors_s   colors;
+  short fg;
+  short bg;
+
+  /* Handle the attributes */
+
+#ifdef CONFIG_PDCURSES_CHTYPE_LONG
+  PDC_set_attrib_term(termstate, ch & (A_BOLD | A_BLINK | A_UNDERLINE |
+                                       A_INVIS | A_ALTCHARSET));
+#else
+  PDC_set_attrib_term(termstate, ch & (A_BOLD | A_BLINK | A_ALTCHARSET));
+#endif
 
   /* Get the character colors */
 
@@ -854,15 +873,12 @@ static void PDC_transform_line_term(FAR SCREEN *s, int lineno, int x,
           buffer[i] = ch;
         }
 
-      /* Update source pointer and write data */
+      /* Update source pointer and write data.  The line drawing character
+       * set is selected with the other attributes and the output is only
+       * sent to the terminal by PDC_doupdate().
+       */
 
-      if (*srcp & A_ALTCHARSET)
-        {
-          write(termstate->out_fd, "\x1b(0", 3);
-          write(termstate->out_fd, buffer, i);
-          write(termstate->out_fd, "\x1b(B", 3);
-        }
-      else
+      if (termcurses_write(termstate->tcurs, buffer, i) == -ENOSYS)
         {
           write(termstate->out_fd, buffer, i);
         }
@@ -932,6 +948,41 @@ void PDC_gotoyx(int row, int col)
     }
 }
 
+/****************************************************************************
+ * Name: PDC_doupdate
+ *
+ * Description:
+ *   Called at the end of doupdate(), once all changed lines have been
+ *   passed to PDC_transform_line() and the cursor placed.  Sends the
+ *   output collected for the terminal.
+ *
+ ****************************************************************************/
+
+void PDC_doupdate(void)
+{
+#ifdef CONFIG_SYSTEM_TERMCURSES
+#ifdef CONFIG_PDCURSES_MULTITHREAD
+  FAR struct pdc_context_s *ctx = PDC_ctx();
+#endif
+
+  PDC_LOG(("PDC_doupdate() - called\n"));
+
+  if (!graphic_screen)
+    {
+      FAR struct pdc_termscreen_s *termscreen =
+        (FAR struct pdc_termscreen_s *)SP;
+      FAR struct pdc_termstate_s *termstate = &termscreen->termstate;
+
+      /* Do not leave the terminal in the line drawing character set, other
+       * output to the console would be garbled.
+       */
+
+      PDC_set_attrib_term(termstate, termstate->attrib & ~A_ALTCHARSET);
+      termcurses_flush(termstate->tcurs);
+    }
+#endif
+}
+
 /****************************************************************************
  * Name: PDC_transform_line
  *
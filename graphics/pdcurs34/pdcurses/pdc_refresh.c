@@ -275,6 +275,7 @@ int doupdate(void)
   SP->cursrow = curscr->_cury;
   SP->curscol = curscr->_curx;
 
+  PDC_doupdate();
   return OK;
 }
 
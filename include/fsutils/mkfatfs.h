@@ -44,6 +44,12 @@
 #define MKFATFS_DEFAULT_HIDSEC       0     /* No hidden sectors */
 #define MKFATFS_DEFAULT_VOLUMEID     0     /* No volume ID */
 #define MKFATFS_DEFAULT_NSECTORS     0     /* 0: Use all sectors on device */
+#define MKFATFS_DEFAULT_FLAGS        0     /* No optional behavior */
+
+/* Values for the ff_flags field of struct fat_format_s */
+
+#define MKFATFS_FLAG_DISCARD         (1 << 0) /* Erase instead of writing zeros */
+#define MKFATFS_FLAG_VERBOSE         (1 << 1) /* Report progress and throughput */
 
 #define FAT_FORMAT_INITIALIZER \
 { \
@@ -56,7 +62,8 @@
   MKFATFS_DEFAULT_RSVDSECCOUNT, \
   MKFATFS_DEFAULT_HIDSEC, \
   MKFATFS_DEFAULT_VOLUMEID, \
-  MKFATFS_DEFAULT_NSECTORS \
+  MKFATFS_DEFAULT_NSECTORS, \
+  MKFATFS_DEFAULT_FLAGS \
 }
 
 /****************************************************************************
@@ -79,6 +86,7 @@ struct fat_format_s
   uint32_t ff_hidsec;          /* Count of hidden sectors preceding fat */
   uint32_t ff_volumeid;        /* FAT volume id */
   uint32_t ff_nsectors;        /* Number of sectors from device to use: 0: Use all */
+  uint8_t  ff_flags;           /* MKFATFS_FLAG_* options */
 };
 
 /****************************************************************************
@@ -53,6 +53,27 @@
 
 #include <nuttx/config.h>
 
+#include <sys/types.h>
+#include <stdbool.h>
+#include <stdint.h>
+
+/****************************************************************************
+ * Public Types
+ ****************************************************************************/
+
+#ifdef CONFIG_CODECS_BASE64
+/* State of a chunked encode or decode */
+
+struct base64_ctx_s
+{
+  uint32_t value;               /* Decode: bits of the pending group */
+  uint8_t buf[3];               /* Encode: pending bytes */
+  uint8_t count;                /* Pending bytes or characters */
+  uint8_t npad;                 /* Decode: padding seen */
+  bool websafe;                 /* base64w alphabet */
+};
+#endif
+
 #ifdef __cplusplus
 extern "C"
 {
@@ -73,6 +94,18 @@ FAR void *base64w_encode(FAR const void *src, size_t len, FAR void *dst,
                          FAR size_t *out_len);
 FAR void *base64w_decode(FAR const void *src, size_t len, FAR void *dst,
                          FAR size_t *out_len);
+
+/* Chunked coding, e.g. of data received or sent in pieces */
+
+void base64_encode_init(FAR struct base64_ctx_s *ctx, bool websafe);
+size_t base64_encode_update(FAR struct base64_ctx_s *ctx,
+                            FAR const void *src, size_t len, FAR void *dst);
+size_t base64_encode_final(FAR struct base64_ctx_s *ctx, FAR void *dst);
+void base64_decode_init(FAR struct base64_ctx_s *ctx, bool websafe);
+ssize_t base64_decode_update(FAR struct base64_ctx_s *ctx,
+                             FAR const void *src, size_t len,
+                             FAR void *dst);
+ssize_t base64_decode_final(FAR struct base64_ctx_s *ctx, FAR void *dst);
 #endif /* CONFIG_CODECS_BASE64 */
 
 #ifdef __cplusplus
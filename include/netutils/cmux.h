@@ -32,6 +32,12 @@
 #include <nuttx/debug.h>
 #include <errno.h>
 
+/****************************************************************************
+ * Pre-processor Definitions
+ ****************************************************************************/
+
+#define CMUX_CHANNEL_NAME_SZ (64)
+
 /****************************************************************************
  * Public Types
  ****************************************************************************/
@@ -41,6 +47,12 @@ struct cmux_settings_s
     FAR const char *tty_name;
     FAR const char *script;
     int total_channels;
+
+    /* Optional, total_channels buffers of CMUX_CHANNEL_NAME_SZ bytes that
+     * receive the path of the pseudo terminal of each channel.
+     */
+
+    FAR char **channel_paths;
 };
 
 /****************************************************************************
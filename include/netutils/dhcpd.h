@@ -68,6 +68,8 @@ int dhcpd_set_startip(in_addr_t startip);
 int dhcpd_set_routerip(in_addr_t routerip);
 int dhcpd_set_netmask(in_addr_t netmask);
 int dhcpd_set_dnsip(in_addr_t dnsip);
+int dhcpd_add_pool(in_addr_t startip, in_addr_t endip, in_addr_t routerip,
+                   in_addr_t netmask, in_addr_t dnsip);
 
 #undef EXTERN
 #ifdef __cplusplus
@@ -80,6 +80,13 @@
 #  define IPv6_ROUTE_PATH CONFIG_NETLIB_PROCFS_MOUNTPT "/net/route/ipv6"
 #endif
 
+#ifdef CONFIG_NETUTILS_NETLIB_SERVER
+/* netlib_server_run() modes */
+
+#  define NETLIB_SERVER_POOL   0  /* Pre-spawned worker threads */
+#  define NETLIB_SERVER_EVENT  1  /* One thread, poll() event loop */
+#endif
+
 /****************************************************************************
  * Public Types
  ****************************************************************************/
@@ -208,6 +215,95 @@ typedef CODE void (*netlib_dhcp_ntp_callback_t)
   (FAR const char *ntp_server_list, FAR void *arg);
 #endif
 
+#ifdef CONFIG_NETUTILS_NETLIB_SERVER
+/* Counters and latencies of a server instance.  Times are in microseconds.
+ * Wait is the time from accept() to the start of the service, serve the
+ * time from there until the connection is closed.
+ */
+
+struct netlib_server_stats_s
+{
+  uint32_t accepted;            /* Connections accepted */
+  uint32_t rejected;            /* Connections refused by the limits */
+  uint32_t served;              /* Connections closed after service */
+  uint16_t active;              /* Connections being served */
+  uint16_t queued;              /* Connections waiting for a worker */
+  uint16_t peak;                /* Highest active + queued so far */
+  uint32_t wait_max_us;
+  uint64_t wait_total_us;
+  uint32_t serve_max_us;
+  uint64_t serve_total_us;
+  uint32_t callback_max_us;     /* Event mode: longest single callback */
+};
+
+/* Per-connection callbacks of the event loop.  They run on the server
+ * thread and must not block.
+ */
+
+struct netlib_server_ops_s
+{
+  /* A connection was accepted.  Returns the poll() events to wait for or
+   * a negated errno to refuse the connection.  *conn may be set to the
+   * connection's private data.
+   */
+
+  CODE int (*connect)(FAR void *arg, int sd, FAR void **conn);
+
+  /* Events occurred on the connection.  Returns the next events to wait
+   * for or a negative value to close the connection.
+   */
+
+  CODE int (*event)(FAR void *arg, int sd, FAR void *conn, short revents);
+
+  /* The connection is closed, the server closes sd on return */
+
+  CODE void (*disconnect)(FAR void *arg, int sd, FAR void *conn);
+};
+
+/* One accepted connection, private to netlib_server_run() */
+
+struct netlib_server_conn_s
+{
+  int sd;
+  FAR void *conn;
+  uint64_t start_us;            /* Accept time, then start of service */
+};
+
+/* Server instance.  netlib_server_init() sets up the defaults, the
+ * configuration may then be changed before netlib_server_run().
+ */
+
+struct netlib_server_s
+{
+  /* Configuration */
+
+  int mode;                     /* NETLIB_SERVER_POOL or _EVENT */
+  int nworkers;                 /* Pool: worker threads */
+  int backlog;                  /* Pool: connections queued for a worker */
+  int maxconn;                  /* Event: open connections */
+  int stacksize;                /* Pool: worker stack size */
+  int linger;                   /* SO_LINGER seconds, negative for none */
+
+  /* Pool: serves and closes the socket passed as its argument */
+
+  pthread_startroutine_t handler;
+
+  /* Event: connection callbacks and their argument */
+
+  FAR const struct netlib_server_ops_s *ops;
+  FAR void *arg;
+
+  /* Private */
+
+  pthread_mutex_t lock;
+  pthread_cond_t cond;
+  FAR struct netlib_server_conn_s *queue;
+  int head;
+  bool stopping;
+  struct netlib_server_stats_s stats;
+};
+#endif
+
 /****************************************************************************
  * Public Data
  ****************************************************************************/
@@ -528,6 +624,13 @@ int netlib_listenon(uint16_t portno);
 void netlib_server(uint16_t portno, pthread_startroutine_t handler,
                    int stacksize);
 
+#ifdef CONFIG_NETUTILS_NETLIB_SERVER
+void netlib_server_init(FAR struct netlib_server_s *server, int mode);
+int netlib_server_run(FAR struct netlib_server_s *server, int listensd);
+void netlib_server_getstats(FAR struct netlib_server_s *server,
+                            FAR struct netlib_server_stats_s *stats);
+#endif
+
 int netlib_getifstatus(FAR const char *ifname, FAR uint8_t *flags);
 int netlib_ifup(FAR const char *ifname);
 int netlib_ifdown(FAR const char *ifname);
@@ -48,6 +48,17 @@ struct ptpd_config_s
   sa_family_t af;
 };
 
+/* Summary of one clock servo quantity over the last statistics interval
+ * (CONFIG_NETUTILS_PTPD_STATS_INTERVAL samples).
+ */
+
+struct ptpd_statistics_s
+{
+  int64_t mean;      /* Average value */
+  int64_t rms;       /* Root mean square */
+  int64_t max;       /* Largest absolute value */
+};
+
 /* PTPD status information structure */
 
 struct ptpd_status_s
@@ -83,17 +94,29 @@ struct ptpd_status_s
   int64_t last_delta_ns;     /* Latest measured clock error */
   int64_t last_adjtime_ns;   /* Previously applied adjtime() offset */
 
-  /* Averaged clock drift estimate (parts per billion).
-   * Positive means remote clock runs faster than local clock before
-   * adjustment.
+  /* Clock drift estimate (parts per billion), the integral term of the
+   * clock servo.  Positive means remote clock runs faster than local clock
+   * before adjustment.
    */
 
   long drift_ppb;
 
-  /* Averaged path delay */
+  /* Filtered path delay */
 
   long path_delay_ns;
 
+  /* Clock servo statistics.  offset is the filtered clock error fed to
+   * the servo, delay the filtered path delay and freq the frequency
+   * correction applied to the clock, in ppb.
+   */
+
+  bool servo_locked;                     /* Servo is tracking the source */
+  uint32_t nsamples;                     /* Sync samples since selection */
+  uint32_t noutliers;                    /* Samples rejected by filters */
+  struct ptpd_statistics_s offset_stats;
+  struct ptpd_statistics_s delay_stats;
+  struct ptpd_statistics_s freq_stats;
+
   /* Timestamps of latest received packets (CLOCK_MONOTONIC) */
 
   struct timespec last_received_multicast; /* Any multicast packet */
@@ -0,0 +1,238 @@
+/****************************************************************************
+ * apps/include/netutils/usrsockd.h
+ *
+ * SPDX-License-Identifier: Apache-2.0
+ *
+ * Licensed to the Apache Software Foundation (ASF) under one or more
+ * contributor license agreements.  See the NOTICE file distributed with
+ * this work for additional information regarding copyright ownership.  The
+ * ASF licenses this file to you under the Apache License, Version 2.0 (the
+ * "License"); you may not use this file except in compliance with the
+ * License.  You may obtain a copy of the License at
+ *
+ *   http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS, WITHOUT
+ * WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.  See the
+ * License for the specific language governing permissions and limitations
+ * under the License.
+ *
+ ****************************************************************************/
+
+#ifndef __APPS_INCLUDE_NETUTILS_USRSOCKD_H
+#define __APPS_INCLUDE_NETUTILS_USRSOCKD_H
+
+/****************************************************************************
+ * Included Files
+ ****************************************************************************/
+
+#include <nuttx/config.h>
+
+#include <stddef.h>
+#include <stdint.h>
+#include <sys/types.h>
+#include <sys/uio.h>
+
+#include <nuttx/net/usrsock.h>
+
+/****************************************************************************
+ * Pre-processor Definitions
+ ****************************************************************************/
+
+/* Responses are gathered into one writev() of at most this many segments */
+
+#ifndef CONFIG_NETUTILS_USRSOCKD_IOVMAX
+#  define CONFIG_NETUTILS_USRSOCKD_IOVMAX 16
+#endif
+
+/* Room for the queued message headers and the values copied with them */
+
+#ifndef CONFIG_NETUTILS_USRSOCKD_HDRSIZE
+#  define CONFIG_NETUTILS_USRSOCKD_HDRSIZE 256
+#endif
+
+/****************************************************************************
+ * Public Types
+ ****************************************************************************/
+
+struct usrsockd_s;
+
+/* A request handler gets the complete request: the fixed part in req and
+ * whatever follows it (address, send data, option value or ioctl argument)
+ * in data, straight from the request buffer.  Both stay valid until the
+ * handler returns.  A negative return value stops usrsockd_process().
+ */
+
+typedef CODE int (*usrsockd_handler_t)(FAR struct usrsockd_s *ud,
+                                       FAR void *req,
+                                       FAR uint8_t *data, size_t datalen);
+
+struct usrsockd_s
+{
+  int fd;                                   /* /dev/usrsock */
+  FAR void *priv;                           /* Daemon private data */
+  FAR const usrsockd_handler_t *handlers;   /* Indexed by request id */
+
+  /* Request buffer, grown to the largest request seen */
+
+  FAR uint8_t *reqbuf;
+  size_t reqsize;
+
+  /* Queued responses and events */
+
+  struct iovec iov[CONFIG_NETUTILS_USRSOCKD_IOVMAX];
+  int iovcnt;
+  size_t hdrlen;
+  uint8_t hdrbuf[CONFIG_NETUTILS_USRSOCKD_HDRSIZE];
+
+  /* Statistics */
+
+  uint32_t nrequests;                       /* Requests handled */
+  uint32_t nwakeups;                        /* usrsockd_process() calls */
+  uint32_t nwrites;                         /* writev() calls */
+};
+
+/* Receive ring for a socket.  head and tail run freely and are reduced
+ * modulo size on access, so used space is simply head - tail.
+ */
+
+struct usrsockd_ring_s
+{
+  FAR uint8_t *buf;
+  size_t size;
+  size_t head;                              /* Producer index */
+  size_t tail;                              /* Consumer index */
+};
+
+/****************************************************************************
+ * Public Function Prototypes
+ ****************************************************************************/
+
+#undef EXTERN
+#if defined(__cplusplus)
+#define EXTERN extern "C"
+extern "C"
+{
+#else
+#define EXTERN extern
+#endif
+
+/****************************************************************************
+ * Name: usrsockd_open
+ *
+ * Description:
+ *   Open /dev/usrsock and prepare ud.  handlers must have
+ *   USRSOCK_REQUEST__MAX entries, requests without a handler are answered
+ *   with -ENOSYS.
+ *
+ * Returned Value:
+ *   Zero on success, a negated errno value on failure.
+ *
+ ****************************************************************************/
+
+int usrsockd_open(FAR struct usrsockd_s *ud,
+                  FAR const usrsockd_handler_t *handlers, FAR void *priv);
+
+/****************************************************************************
+ * Name: usrsockd_close
+ ****************************************************************************/
+
+void usrsockd_close(FAR struct usrsockd_s *ud);
+
+/****************************************************************************
+ * Name: usrsockd_process
+ *
+ * Description:
+ *   Handle all requests that are pending on /dev/usrsock, call this when
+ *   poll() reports POLLIN.  Each request is fetched with a single read()
+ *   and its responses are sent with a single writev() before the next one
+ *   is read.
+ *
+ * Returned Value:
+ *   The number of requests handled, or a negated errno value.
+ *
+ ****************************************************************************/
+
+int usrsockd_process(FAR struct usrsockd_s *ud);
+
+/****************************************************************************
+ * Name: usrsockd_ack
+ *
+ * Description:
+ *   Queue a USRSOCK_MESSAGE_RESPONSE_ACK.
+ *
+ ****************************************************************************/
+
+int usrsockd_ack(FAR struct usrsockd_s *ud, uint32_t xid, int32_t result,
+                 uint16_t events);
+
+/****************************************************************************
+ * Name: usrsockd_dataack
+ *
+ * Description:
+ *   Queue a USRSOCK_MESSAGE_RESPONSE_DATA_ACK.  The value is copied, the
+ *   data is referenced and must stay valid until usrsockd_flush() returns.
+ *   result is the data length on success.
+ *
+ ****************************************************************************/
+
+int usrsockd_dataack(FAR struct usrsockd_s *ud, uint32_t xid,
+                     int32_t result, uint16_t events,
+                     FAR const void *value, uint16_t valuelen,
+                     uint16_t valuelen_nontrunc,
+                     FAR const struct iovec *data, int datacnt);
+
+/****************************************************************************
+ * Name: usrsockd_event
+ *
+ * Description:
+ *   Queue a USRSOCK_MESSAGE_SOCKET_EVENT.
+ *
+ ****************************************************************************/
+
+int usrsockd_event(FAR struct usrsockd_s *ud, int16_t usockid,
+                   uint16_t events);
+
+/****************************************************************************
+ * Name: usrsockd_flush
+ *
+ * Description:
+ *   Send everything queued.  usrsockd_process() flushes after each request,
+ *   events queued outside of a handler need an explicit flush.
+ *
+ ****************************************************************************/
+
+int usrsockd_flush(FAR struct usrsockd_s *ud);
+
+/****************************************************************************
+ * Name: usrsockd_ring_*
+ *
+ * Description:
+ *   Per-socket receive ring.  A producer either asks for the contiguous
+ *   free space and commits what it filled in (usrsockd_ring_space/commit),
+ *   or copies with usrsockd_ring_put().  The consumer describes buffered
+ *   data with at most two iovecs (usrsockd_ring_peek) that can be passed
+ *   to usrsockd_dataack() directly, and then drops it with
+ *   usrsockd_ring_consume().
+ *
+ ****************************************************************************/
+
+int usrsockd_ring_init(FAR struct usrsockd_ring_s *ring, size_t size);
+void usrsockd_ring_free(FAR struct usrsockd_ring_s *ring);
+size_t usrsockd_ring_used(FAR const struct usrsockd_ring_s *ring);
+FAR uint8_t *usrsockd_ring_space(FAR struct usrsockd_ring_s *ring,
+                                 FAR size_t *len);
+void usrsockd_ring_commit(FAR struct usrsockd_ring_s *ring, size_t len);
+size_t usrsockd_ring_put(FAR struct usrsockd_ring_s *ring,
+                         FAR const void *data, size_t len);
+int usrsockd_ring_peek(FAR const struct usrsockd_ring_s *ring, size_t len,
+                       FAR struct iovec *iov);
+void usrsockd_ring_consume(FAR struct usrsockd_ring_s *ring, size_t len);
+
+#undef EXTERN
+#ifdef __cplusplus
+}
+#endif
+
+#endif /* __APPS_INCLUDE_NETUTILS_USRSOCKD_H */
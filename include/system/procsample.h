@@ -0,0 +1,238 @@
+/****************************************************************************
+ * apps/include/system/procsample.h
+ *
+ * SPDX-License-Identifier: Apache-2.0
+ *
+ * Licensed to the Apache Software Foundation (ASF) under one or more
+ * contributor license agreements.  See the NOTICE file distributed with
+ * this work for additional information regarding copyright ownership.  The
+ * ASF licenses this file to you under the Apache License, Version 2.0 (the
+ * "License"); you may not use this file except in compliance with the
+ * License.  You may obtain a copy of the License at
+ *
+ *   http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS, WITHOUT
+ * WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.  See the
+ * License for the specific language governing permissions and limitations
+ * under the License.
+ *
+ ****************************************************************************/
+
+#ifndef __APPS_INCLUDE_SYSTEM_PROCSAMPLE_H
+#define __APPS_INCLUDE_SYSTEM_PROCSAMPLE_H
+
+/****************************************************************************
+ * Included Files
+ ****************************************************************************/
+
+#include <nuttx/config.h>
+
+#include <stdbool.h>
+#include <stddef.h>
+#include <stdint.h>
+#include <sys/types.h>
+
+/****************************************************************************
+ * Pre-processor Definitions
+ ****************************************************************************/
+
+/* Per-task procfs files, as indices and as bits of the file mask */
+
+#define PROCSAMPLE_STATUS       0  /* <pid>/status */
+#define PROCSAMPLE_GROUP        1  /* <pid>/group/status */
+#define PROCSAMPLE_STACK        2  /* <pid>/stack */
+#define PROCSAMPLE_HEAP         3  /* <pid>/heap */
+#define PROCSAMPLE_LOADAVG      4  /* <pid>/loadavg */
+#define PROCSAMPLE_CRITMON      5  /* <pid>/critmon */
+#define PROCSAMPLE_CMDLINE      6  /* <pid>/cmdline */
+#define PROCSAMPLE_NFILES       7
+
+#define PROCSAMPLE_FILE(n)      (1 << (n))
+
+#if CONFIG_TASK_NAME_SIZE > 0
+#  define PROCSAMPLE_NAME_SIZE  CONFIG_TASK_NAME_SIZE
+#else
+#  define PROCSAMPLE_NAME_SIZE  0
+#endif
+
+/****************************************************************************
+ * Public Types
+ ****************************************************************************/
+
+/* One cached procfs file of a task.  The file stays open between samples
+ * and is re-read from offset zero.  text is NUL terminated and is left
+ * untouched by the parser, copy it before modifying it.
+ */
+
+struct procsample_file_s
+{
+  int fd;                          /* -1 if the file does not exist */
+  uint16_t size;                   /* Size of text[] */
+  uint16_t len;                    /* Length of the last read */
+  uint32_t hash;                   /* Hash of text, to detect changes */
+  FAR char *text;                  /* Content of the last read */
+};
+
+/* Sampled state of one task.  The parsed values are only updated for the
+ * files that were requested, and only when the content of the file
+ * changed since the previous sample.
+ */
+
+struct procsample_task_s
+{
+  pid_t pid;
+  uint32_t seen;                   /* Generation the task was last seen */
+  uint32_t nsamples;               /* Samples taken of this task */
+  uint32_t changed;                /* Files that changed in this sample */
+
+  char name[PROCSAMPLE_NAME_SIZE + 1];
+  pid_t ppid;                      /* Parent, from group/status */
+  unsigned long stacksize;
+  unsigned long stackused;
+  unsigned long heapsize;          /* AllocSize from heap */
+  uint32_t load;                   /* CPU load in 0.1 % units */
+
+  /* From critmon, all in nanoseconds.  The kernel resets the maxima when
+   * the file is read.
+   */
+
+  uint64_t premp_max;
+  uint64_t crit_max;
+  uint64_t run_max;
+  uint64_t runtime;
+  uint64_t runtime_delta;          /* runtime since the previous sample */
+
+  struct procsample_file_s file[PROCSAMPLE_NFILES];
+};
+
+struct procsample_s;
+
+/* Called for each task after it was sampled, in ascending pid order.
+ * A non-zero return value stops the walk and is returned by
+ * procsample_update().
+ */
+
+typedef CODE int (*procsample_cb_t)(FAR struct procsample_s *ps,
+                                    FAR struct procsample_task_s *task,
+                                    FAR void *arg);
+
+struct procsample_s
+{
+  FAR const char *mountpoint;      /* procfs mount point */
+  uint32_t files;                  /* Files to sample, PROCSAMPLE_FILE() */
+  uint32_t generation;             /* Sample counter */
+  bool fixed;                      /* Only tasks added by procsample_add() */
+  bool reopen;                     /* procfs cannot seek, reopen per read */
+
+  FAR struct procsample_task_s **tasks; /* Sorted by pid */
+  size_t ntasks;
+  size_t capacity;
+
+  /* Statistics of the last sample */
+
+  uint32_t elapsed;                /* Microseconds taken by the sample */
+  uint32_t nreads;                 /* Files read */
+  uint32_t nopens;                 /* Files opened */
+};
+
+/****************************************************************************
+ * Public Function Prototypes
+ ****************************************************************************/
+
+#undef EXTERN
+#if defined(__cplusplus)
+#define EXTERN extern "C"
+extern "C"
+{
+#else
+#define EXTERN extern
+#endif
+
+/****************************************************************************
+ * Name: procsample_init
+ *
+ * Description:
+ *   Prepare a sampler for the files in the files mask.  No procfs file is
+ *   touched until the first procsample_update().
+ *
+ ****************************************************************************/
+
+void procsample_init(FAR struct procsample_s *ps,
+                     FAR const char *mountpoint, uint32_t files);
+
+/****************************************************************************
+ * Name: procsample_deinit
+ *
+ * Description:
+ *   Close all cached files and release the task records.
+ *
+ ****************************************************************************/
+
+void procsample_deinit(FAR struct procsample_s *ps);
+
+/****************************************************************************
+ * Name: procsample_add
+ *
+ * Description:
+ *   Restrict the sampler to explicitly added tasks.  After the first call
+ *   the procfs directory is no longer scanned, tasks that exit are dropped.
+ *
+ * Returned Value:
+ *   Zero on success, a negated errno value on failure.
+ *
+ ****************************************************************************/
+
+int procsample_add(FAR struct procsample_s *ps, pid_t pid);
+
+/****************************************************************************
+ * Name: procsample_update
+ *
+ * Description:
+ *   Take one sample: pick up new tasks, drop the ones that exited, re-read
+ *   the cached files of the others and parse what changed.  cb, if not
+ *   NULL, is then called for every task.
+ *
+ * Returned Value:
+ *   Zero on success, the non-zero value returned by cb, or a negated errno
+ *   value if the procfs directory could not be read.
+ *
+ ****************************************************************************/
+
+int procsample_update(FAR struct procsample_s *ps, procsample_cb_t cb,
+                      FAR void *arg);
+
+/****************************************************************************
+ * Name: procsample_value
+ *
+ * Description:
+ *   Find the line starting with key ("StackSize:") in text and return the
+ *   start of its value, or NULL.  The value ends at the next newline.
+ *
+ ****************************************************************************/
+
+FAR const char *procsample_value(FAR const char *text,
+                                 FAR const char *key);
+
+/****************************************************************************
+ * Name: procsample_copyline
+ *
+ * Description:
+ *   Copy the value returned by procsample_value() up to the end of its
+ *   line, without trailing blanks, and NUL terminate it.
+ *
+ * Returned Value:
+ *   The length of the copied string.
+ *
+ ****************************************************************************/
+
+size_t procsample_copyline(FAR char *dest, size_t size,
+                           FAR const char *value);
+
+#undef EXTERN
+#ifdef __cplusplus
+}
+#endif
+
+#endif /* __APPS_INCLUDE_SYSTEM_PROCSAMPLE_H */
@@ -27,6 +27,7 @@
  * Included Files
  ****************************************************************************/
 
+#include <sys/types.h>
 #include <stdint.h>
 #include <nuttx/fs/ioctl.h>
 #include <nuttx/fs/fs.h>
@@ -57,6 +58,7 @@
 #define TCURS_ATTRIB_INVIS      0x0008
 #define TCURS_ATTRIB_CURS_HIDE  0x0010
 #define TCURS_ATTRIB_CURS_SHOW  0x0020
+#define TCURS_ATTRIB_ALTCHARSET 0x0040
 
 /****************************************************************************
  * Public Type Definitions
@@ -116,6 +118,15 @@ struct termcurses_ops_s
   /* Terminate  */
 
   CODE int (*terminate)(FAR struct termcurses_s *dev);
+
+  /* Output text at the cursor position */
+
+  CODE int (*write)(FAR struct termcurses_s *dev, FAR const char *buf,
+                    size_t len);
+
+  /* Send buffered output to the terminal */
+
+  CODE int (*flush)(FAR struct termcurses_s *dev);
 };
 
 struct termcurses_dev_s
@@ -220,6 +231,28 @@ int termcurses_setcolors(FAR struct termcurses_s *term,
 int termcurses_getwinsize(FAR struct termcurses_s *term,
                           FAR struct winsize *winsz);
 
+/****************************************************************************
+ * Name: termcurses_write
+ *
+ * Description:
+ *   Output text at the cursor position.  The output may be buffered until
+ *   termcurses_flush() is called.
+ *
+ ****************************************************************************/
+
+int termcurses_write(FAR struct termcurses_s *term, FAR const char *buf,
+                     size_t len);
+
+/****************************************************************************
+ * Name: termcurses_flush
+ *
+ * Description:
+ *   Send all buffered output to the terminal.
+ *
+ ****************************************************************************/
+
+int termcurses_flush(FAR struct termcurses_s *term);
+
 /****************************************************************************
  * Name: termcurses_getkeycode
  *
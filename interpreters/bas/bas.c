@@ -49,6 +49,9 @@
 
 #include "bas_auto.h"
 #include "bas.h"
+#ifdef CONFIG_INTERPRETERS_BAS_BYTECODE
+#  include "bas_code.h"
+#endif
 #include "bas_error.h"
 #include "bas_fs.h"
 #include "bas_global.h"
@@ -123,6 +126,7 @@ int g_bas_argc;
 char *g_bas_argv0;
 char **g_bas_argv;
 bool g_bas_end;
+bool g_bas_bytecode = true;
 
 /****************************************************************************
  * Private Function Prototypes
@@ -1483,6 +1487,22 @@ static struct Value *eval1(struct Value *value)
 
 static struct Value *eval(struct Value *value, const char *desc)
 {
+#ifdef CONFIG_INTERPRETERS_BAS_BYTECODE
+  /* Run the expression as bytecode if it can be compiled */
+
+  if (g_pass == INTERPRET && g_bas_bytecode)
+    {
+      struct Token *end;
+
+      if ((end = Code_eval(g_pc.token, &g_stack, value)) !=
+          (struct Token *)0)
+        {
+          g_pc.token = end;
+          return value;
+        }
+    }
+
+#endif
   /* Avoid function calls for atomic expression */
 
   switch (g_pc.token->type)
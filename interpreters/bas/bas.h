@@ -48,6 +48,7 @@ extern int g_bas_argc;
 extern char *g_bas_argv0;
 extern char **g_bas_argv;
 extern bool g_bas_end;
+extern bool g_bas_bytecode; /* Run expressions as bytecode if enabled */
 
 /****************************************************************************
  * Public Function Prototypes
@@ -0,0 +1,1154 @@
+/****************************************************************************
+ * apps/interpreters/bas/bas_code.c
+ *
+ * SPDX-License-Identifier: Apache-2.0
+ *
+ * Licensed to the Apache Software Foundation (ASF) under one or more
+ * contributor license agreements.  See the NOTICE file distributed with
+ * this work for additional information regarding copyright ownership.  The
+ * ASF licenses this file to you under the Apache License, Version 2.0 (the
+ * "License"); you may not use this file except in compliance with the
+ * License.  You may obtain a copy of the License at
+ *
+ *   http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS, WITHOUT
+ * WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.  See the
+ * License for the specific language governing permissions and limitations
+ * under the License.
+ *
+ ****************************************************************************/
+
+/* Expression bytecode.
+ *
+ * The tree walking evaluator in bas.c re-parses every expression each time
+ * it runs: it walks the operator priority levels, looks up identifiers and
+ * boxes every intermediate result in a struct Value.  Here the same parse
+ * is done once and turned into a small stack machine program whose
+ * operations are specialised for integer and real operands, so that at run
+ * time only unboxed C arithmetic is left.
+ *
+ * The compiler follows the recursive descent of eval() level by level, so
+ * the bytecode always consumes exactly the tokens the evaluator would.  It
+ * runs the first time an expression is executed, which lets it take the
+ * operand types from the live variables.  Every load checks that the type
+ * is still the one the code was compiled for; if not, the code is marked
+ * stale and compiled again on the next run.
+ *
+ * The compiled expressions have no side effects, so whenever the bytecode
+ * hits a case it does not handle bit for bit like the evaluator (an error,
+ * a type change), it simply gives up and the caller evaluates the same
+ * tokens again the slow way, which also produces the right error message.
+ */
+
+/****************************************************************************
+ * Included Files
+ ****************************************************************************/
+
+#include <nuttx/config.h>
+
+#include <assert.h>
+#include <math.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include "bas_auto.h"
+#include "bas_code.h"
+#include "bas_token.h"
+#include "bas_value.h"
+#include "bas_var.h"
+
+/****************************************************************************
+ * Pre-processor Definitions
+ ****************************************************************************/
+
+#define CODE_MAXWORDS   128  /* Longest code compiled */
+#define CODE_MAXSTACK   16   /* Deepest operand stack */
+
+/* Use a computed goto per operation where the compiler supports it, so
+ * that every operation jumps straight to the next one instead of going
+ * back through a single switch.
+ */
+
+#ifdef __GNUC__
+#  define CODE_THREADED
+#endif
+
+/****************************************************************************
+ * Private Types
+ ****************************************************************************/
+
+enum CodeOp
+{
+  OP_ENDI,     /* Return integer result */
+  OP_ENDR,     /* Return real result */
+  OP_PUSHI,    /* Push integer literal */
+  OP_PUSHR,    /* Push real literal */
+  OP_LOADGI,   /* Push global integer variable */
+  OP_LOADGR,   /* Push global real variable */
+  OP_LOADLI,   /* Push local integer variable */
+  OP_LOADLR,   /* Push local real variable */
+  OP_LOADAI,   /* Pop subscripts, push integer array element */
+  OP_LOADAR,   /* Pop subscripts, push real array element */
+  OP_TOINT,    /* Round top of stack to integer */
+  OP_TOINT1,   /* Round second of stack to integer */
+  OP_TOREAL,   /* Convert top of stack to real */
+  OP_TOREAL1,  /* Convert second of stack to real */
+  OP_NEGI,
+  OP_NEGR,
+  OP_NOTI,
+  OP_ADDI,
+  OP_ADDR,
+  OP_SUBI,
+  OP_SUBR,
+  OP_MULI,
+  OP_MULR,
+  OP_DIVR,
+  OP_IDIVI,
+  OP_IDIVR,
+  OP_MODI,
+  OP_MODR,
+  OP_POWR,
+  OP_ANDI,
+  OP_ORI,
+  OP_XORI,
+  OP_EQVI,
+  OP_IMPI,
+  OP_LTI,
+  OP_LTR,
+  OP_LEI,
+  OP_LER,
+  OP_EQI,
+  OP_EQR,
+  OP_GEI,
+  OP_GER,
+  OP_GTI,
+  OP_GTR,
+  OP_NEI,
+  OP_NER,
+  OP_COUNT
+};
+
+/* An operation is one word, followed by its operands */
+
+union CodeWord
+{
+  enum CodeOp op;
+  long int integer;
+  double real;
+  struct Identifier *ident;
+  unsigned int dim;
+};
+
+union CodeSlot
+{
+  long int integer;
+  double real;
+};
+
+struct Code
+{
+  unsigned int length;    /* Words of code, 0 if not compilable */
+  unsigned int end;       /* Offset of the token after the expression */
+  int stale;              /* Operand types changed, compile again */
+  union CodeWord code[];
+};
+
+struct Compiler
+{
+  struct Token *token;    /* Next token */
+  struct Auto *stack;     /* For the types of local variables */
+  unsigned int length;    /* Words emitted */
+  unsigned int depth;     /* Operand stack depth */
+  enum ValueType type[CODE_MAXSTACK];
+  union CodeWord code[CODE_MAXWORDS];
+};
+
+/****************************************************************************
+ * Private Function Prototypes
+ ****************************************************************************/
+
+static int compileLevel(struct Compiler *c, int level);
+
+/****************************************************************************
+ * Private Functions
+ ****************************************************************************/
+
+/* The compile functions return 1 if they compiled an expression, 0 if
+ * there was no expression (like the evaluator returning a null pointer)
+ * and -1 if the expression can not be compiled.
+ */
+
+static union CodeWord *emit(struct Compiler *c, enum CodeOp op,
+                            unsigned int operands)
+{
+  union CodeWord *word;
+
+  if (c->length + 1 + operands > CODE_MAXWORDS)
+    {
+      return (union CodeWord *)0;
+    }
+
+  word = &c->code[c->length];
+  word->op = op;
+  c->length += 1 + operands;
+  return word + 1;
+}
+
+static int push(struct Compiler *c, enum ValueType type)
+{
+  if (c->depth == CODE_MAXSTACK)
+    {
+      return -1;
+    }
+
+  c->type[c->depth++] = type;
+  return 1;
+}
+
+/* Convert the top (pos 0) or second (pos 1) operand */
+
+static int toInteger(struct Compiler *c, int pos)
+{
+  enum ValueType *type = &c->type[c->depth - 1 - pos];
+
+  if (*type == V_REAL)
+    {
+      if (emit(c, pos ? OP_TOINT1 : OP_TOINT, 0) == (union CodeWord *)0)
+        {
+          return -1;
+        }
+
+      *type = V_INTEGER;
+    }
+
+  return 1;
+}
+
+static int toReal(struct Compiler *c, int pos)
+{
+  enum ValueType *type = &c->type[c->depth - 1 - pos];
+
+  if (*type == V_INTEGER)
+    {
+      if (emit(c, pos ? OP_TOREAL1 : OP_TOREAL, 0) == (union CodeWord *)0)
+        {
+          return -1;
+        }
+
+      *type = V_REAL;
+    }
+
+  return 1;
+}
+
+static int compileUnary(struct Compiler *c, enum TokenType op)
+{
+  enum ValueType *type = &c->type[c->depth - 1];
+
+  switch (op)
+    {
+    case T_PLUS:
+      return 1;
+
+    case T_MINUS:
+      return emit(c, *type == V_INTEGER ? OP_NEGI : OP_NEGR, 0) ? 1 : -1;
+
+    case T_NOT:
+      if (toInteger(c, 0) < 0)
+        {
+          return -1;
+        }
+
+      return emit(c, OP_NOTI, 0) ? 1 : -1;
+
+    default:
+      return -1;
+    }
+}
+
+static int compileBinary(struct Compiler *c, enum TokenType op)
+{
+  enum ValueType result;
+  int integer;
+  enum CodeOp opi;
+  enum CodeOp opr;
+
+  integer = (c->type[c->depth - 2] == V_INTEGER &&
+             c->type[c->depth - 1] == V_INTEGER);
+
+  /* Same result types as Value_add() and friends: integer if both
+   * operands are integer and real otherwise, except that "/" is always
+   * real, the logical operators always integer and the relational
+   * operators return an integer truth value.
+   */
+
+  result = integer ? V_INTEGER : V_REAL;
+  switch (op)
+    {
+    case T_PLUS:
+      opi = OP_ADDI;
+      opr = OP_ADDR;
+      break;
+
+    case T_MINUS:
+      opi = OP_SUBI;
+      opr = OP_SUBR;
+      break;
+
+    case T_MULT:
+      opi = OP_MULI;
+      opr = OP_MULR;
+      break;
+
+    case T_IDIV:
+      opi = OP_IDIVI;
+      opr = OP_IDIVR;
+      break;
+
+    case T_MOD:
+      opi = OP_MODI;
+      opr = OP_MODR;
+      break;
+
+    case T_DIV:
+      integer = 0;
+      result = V_REAL;
+      opi = opr = OP_DIVR;
+      break;
+
+    case T_POW:
+
+      /* The type of integer^integer depends on the sign of the exponent */
+
+      if (integer)
+        {
+          return -1;
+        }
+
+      opi = opr = OP_POWR;
+      break;
+
+    case T_AND:
+    case T_OR:
+    case T_XOR:
+    case T_EQV:
+    case T_IMP:
+      if (toInteger(c, 1) < 0 || toInteger(c, 0) < 0)
+        {
+          return -1;
+        }
+
+      integer = 1;
+      result = V_INTEGER;
+      opi = op == T_AND ? OP_ANDI : op == T_OR ? OP_ORI :
+            op == T_XOR ? OP_XORI : op == T_EQV ? OP_EQVI : OP_IMPI;
+      opr = opi;
+      break;
+
+    case T_LT:
+      opi = OP_LTI;
+      opr = OP_LTR;
+      result = V_INTEGER;
+      break;
+
+    case T_LE:
+      opi = OP_LEI;
+      opr = OP_LER;
+      result = V_INTEGER;
+      break;
+
+    case T_EQ:
+      opi = OP_EQI;
+      opr = OP_EQR;
+      result = V_INTEGER;
+      break;
+
+    case T_GE:
+      opi = OP_GEI;
+      opr = OP_GER;
+      result = V_INTEGER;
+      break;
+
+    case T_GT:
+      opi = OP_GTI;
+      opr = OP_GTR;
+      result = V_INTEGER;
+      break;
+
+    case T_NE:
+      opi = OP_NEI;
+      opr = OP_NER;
+      result = V_INTEGER;
+      break;
+
+    default:
+      return -1;
+    }
+
+  if (!integer && (toReal(c, 1) < 0 || toReal(c, 0) < 0))
+    {
+      return -1;
+    }
+
+  if (emit(c, integer ? opi : opr, 0) == (union CodeWord *)0)
+    {
+      return -1;
+    }
+
+  --c->depth;
+  c->type[c->depth - 1] = result;
+  return 1;
+}
+
+/* Mirror of eval(), including its shortcut for atomic expressions */
+
+static int compileEval(struct Compiler *c)
+{
+  switch (c->token->type)
+    {
+    case T_STRING:
+    case T_REAL:
+    case T_INTEGER:
+    case T_HEXINTEGER:
+    case T_OCTINTEGER:
+    case T_IDENTIFIER:
+      if (!TOKEN_ISBINARYOPERATOR((c->token + 1)->type) &&
+          (c->token + 1)->type != T_OP)
+        {
+          return compileLevel(c, 7);
+        }
+
+    default:
+      break;
+    }
+
+  return compileLevel(c, 0);
+}
+
+/* Mirror of lvalue() for numeric scalars and array elements */
+
+static int compileVariable(struct Compiler *c)
+{
+  struct Identifier *ident = c->token->u.identifier;
+  struct Symbol *sym = ident->sym;
+  union CodeWord *word;
+  struct Value *value;
+  enum ValueType type;
+  unsigned int dim;
+
+  if (sym == (struct Symbol *)0)
+    {
+      return -1;
+    }
+
+  if ((c->token + 1)->type == T_OP)
+    {
+      if (sym->type != GLOBALARRAY)
+        {
+          return -1;
+        }
+
+      type = sym->u.var.type;
+      if (type != V_INTEGER && type != V_REAL)
+        {
+          return -1;
+        }
+
+      c->token += 2;
+      dim = 0;
+      while (1)
+        {
+          if (compileEval(c) <= 0 || toInteger(c, 0) < 0)
+            {
+              return -1;
+            }
+
+          ++dim;
+          if (c->token->type == T_COMMA)
+            {
+              ++c->token;
+            }
+          else
+            {
+              break;
+            }
+        }
+
+      if (c->token->type != T_CP)
+        {
+          return -1;
+        }
+
+      ++c->token;
+      word = emit(c, type == V_INTEGER ? OP_LOADAI : OP_LOADAR, 2);
+      if (word == (union CodeWord *)0)
+        {
+          return -1;
+        }
+
+      word[0].ident = ident;
+      word[1].dim = dim;
+      c->depth -= dim;
+      return push(c, type);
+    }
+
+  switch (sym->type)
+    {
+    case GLOBALVAR:
+      value = VAR_SCALAR_VALUE(&sym->u.var);
+      break;
+
+    case LOCALVAR:
+      value = VAR_SCALAR_VALUE(Auto_local(c->stack, sym->u.local.offset));
+      break;
+
+    default:
+      return -1;
+    }
+
+  type = value->type;
+  if (type != V_INTEGER && type != V_REAL)
+    {
+      return -1;
+    }
+
+  if (sym->type == GLOBALVAR)
+    {
+      word = emit(c, type == V_INTEGER ? OP_LOADGI : OP_LOADGR, 1);
+    }
+  else
+    {
+      word = emit(c, type == V_INTEGER ? OP_LOADLI : OP_LOADLR, 1);
+    }
+
+  if (word == (union CodeWord *)0)
+    {
+      return -1;
+    }
+
+  word->ident = ident;
+  ++c->token;
+  return push(c, type);
+}
+
+/* Mirror of eval8() */
+
+static int compileAtom(struct Compiler *c)
+{
+  union CodeWord *word;
+  long int n;
+
+  switch (c->token->type)
+    {
+    case T_IDENTIFIER:
+      return compileVariable(c);
+
+    case T_INTEGER:
+    case T_HEXINTEGER:
+    case T_OCTINTEGER:
+      n = c->token->type == T_INTEGER ? c->token->u.integer :
+          c->token->type == T_HEXINTEGER ? c->token->u.hexinteger :
+          c->token->u.octinteger;
+      if ((word = emit(c, OP_PUSHI, 1)) == (union CodeWord *)0)
+        {
+          return -1;
+        }
+
+      word->integer = n;
+      ++c->token;
+      return push(c, V_INTEGER);
+
+    case T_REAL:
+      if ((word = emit(c, OP_PUSHR, 1)) == (union CodeWord *)0)
+        {
+          return -1;
+        }
+
+      word->real = c->token->u.real;
+      ++c->token;
+      return push(c, V_REAL);
+
+    case T_OP:
+      ++c->token;
+      if (compileEval(c) <= 0 || c->token->type != T_CP)
+        {
+          return -1;
+        }
+
+      ++c->token;
+      return 1;
+
+    case T_STRING:
+      return -1;
+
+    default:
+      return 0;
+    }
+}
+
+/* Mirror of eval1() to eval8(): levels 2 and 6 are unarydown(), 8 is the
+ * atom and the others are binarydown() with the level as priority.
+ */
+
+static int compileLevel(struct Compiler *c, int level)
+{
+  enum TokenType op;
+  int ret;
+
+  if (level == 8)
+    {
+      return compileAtom(c);
+    }
+
+  op = c->token->type;
+  if (level == 2 || level == 6)
+    {
+      if (!TOKEN_ISUNARYOPERATOR(op) || TOKEN_UNARYPRIORITY(op) != level)
+        {
+          return compileLevel(c, level + 1);
+        }
+
+      ++c->token;
+      if (compileLevel(c, level) <= 0)
+        {
+          return -1;
+        }
+
+      return compileUnary(c, op);
+    }
+
+  if ((ret = compileLevel(c, level + 1)) <= 0)
+    {
+      return ret;
+    }
+
+  while (1)
+    {
+      op = c->token->type;
+      if (!TOKEN_ISBINARYOPERATOR(op) || TOKEN_BINARYPRIORITY(op) != level)
+        {
+          return 1;
+        }
+
+      ++c->token;
+      if (compileLevel(c, level + 1) <= 0 || compileBinary(c, op) < 0)
+        {
+          return -1;
+        }
+    }
+}
+
+static struct Code *compile(struct Token *token, struct Auto *stack)
+{
+  struct Compiler *c;
+  struct Code *code;
+  unsigned int length;
+
+  c = malloc(sizeof(struct Compiler));
+  if (c == (struct Compiler *)0)
+    {
+      return (struct Code *)0;
+    }
+
+  c->token = token;
+  c->stack = stack;
+  c->length = 0;
+  c->depth = 0;
+
+  if (compileEval(c) > 0 &&
+      emit(c, c->type[0] == V_INTEGER ? OP_ENDI : OP_ENDR, 0))
+    {
+      assert(c->depth == 1);
+      length = c->length;
+    }
+  else
+    {
+      length = 0;
+    }
+
+  code = malloc(sizeof(struct Code) + length * sizeof(union CodeWord));
+  if (code != (struct Code *)0)
+    {
+      code->length = length;
+      code->end = c->token - token;
+      code->stale = 0;
+      memcpy(code->code, c->code, length * sizeof(union CodeWord));
+    }
+
+  free(c);
+  return code;
+}
+
+/* Same as Var_value(), without producing an error value */
+
+static struct Value *element(struct Var *var, unsigned int dim,
+                             const union CodeSlot *idx)
+{
+  unsigned int offset;
+  unsigned int i;
+  int n;
+
+  if (var->value == (struct Value *)0 || dim != var->dim)
+    {
+      return (struct Value *)0;
+    }
+
+  for (offset = 0, i = 0; i < dim; ++i)
+    {
+      n = idx[i].integer;
+      if (n < var->base ||
+          (unsigned int)(n - var->base) >= var->geometry[i])
+        {
+          return (struct Value *)0;
+        }
+
+      offset = offset * var->geometry[i] + (n - var->base);
+    }
+
+  return var->value + offset;
+}
+
+static struct Token *run(struct Code *code, struct Token *token,
+                         struct Auto *stack, struct Value *value)
+{
+  union CodeSlot slot[CODE_MAXSTACK];
+  union CodeSlot *sp = slot - 1;
+  const union CodeWord *ip = code->code;
+  struct Symbol *sym;
+  struct Value *v;
+  unsigned int dim;
+  int overflow;
+
+#ifdef CODE_THREADED
+  static const void *const dispatch[OP_COUNT] =
+  {
+    &&L_OP_ENDI, &&L_OP_ENDR, &&L_OP_PUSHI, &&L_OP_PUSHR,
+    &&L_OP_LOADGI, &&L_OP_LOADGR, &&L_OP_LOADLI, &&L_OP_LOADLR,
+    &&L_OP_LOADAI, &&L_OP_LOADAR, &&L_OP_TOINT, &&L_OP_TOINT1,
+    &&L_OP_TOREAL, &&L_OP_TOREAL1, &&L_OP_NEGI, &&L_OP_NEGR,
+    &&L_OP_NOTI, &&L_OP_ADDI, &&L_OP_ADDR, &&L_OP_SUBI,
+    &&L_OP_SUBR, &&L_OP_MULI, &&L_OP_MULR, &&L_OP_DIVR,
+    &&L_OP_IDIVI, &&L_OP_IDIVR, &&L_OP_MODI, &&L_OP_MODR,
+    &&L_OP_POWR, &&L_OP_ANDI, &&L_OP_ORI, &&L_OP_XORI,
+    &&L_OP_EQVI, &&L_OP_IMPI, &&L_OP_LTI, &&L_OP_LTR,
+    &&L_OP_LEI, &&L_OP_LER, &&L_OP_EQI, &&L_OP_EQR,
+    &&L_OP_GEI, &&L_OP_GER, &&L_OP_GTI, &&L_OP_GTR,
+    &&L_OP_NEI, &&L_OP_NER
+  };
+
+#  define CASE(op)  L_##op:
+#  define NEXT      goto *dispatch[(ip++)->op]
+#  define BEGIN     NEXT;
+#  define END
+#else
+#  define CASE(op)  case op:
+#  define NEXT      break
+#  define BEGIN     while (1) switch ((ip++)->op) {
+#  define END       default: goto bail; }
+#endif
+
+  BEGIN
+
+  CASE(OP_ENDI)
+    VALUE_NEW_INTEGER(value, sp->integer);
+    return token + code->end;
+
+  CASE(OP_ENDR)
+    VALUE_NEW_REAL(value, sp->real);
+    return token + code->end;
+
+  CASE(OP_PUSHI)
+    (++sp)->integer = (ip++)->integer;
+    NEXT;
+
+  CASE(OP_PUSHR)
+    (++sp)->real = (ip++)->real;
+    NEXT;
+
+  CASE(OP_LOADGI)
+    sym = (ip++)->ident->sym;
+    if (sym == (struct Symbol *)0 || sym->type != GLOBALVAR)
+      {
+        goto stale;
+      }
+
+    v = VAR_SCALAR_VALUE(&sym->u.var);
+    if (v->type != V_INTEGER)
+      {
+        goto stale;
+      }
+
+    (++sp)->integer = v->u.integer;
+    NEXT;
+
+  CASE(OP_LOADGR)
+    sym = (ip++)->ident->sym;
+    if (sym == (struct Symbol *)0 || sym->type != GLOBALVAR)
+      {
+        goto stale;
+      }
+
+    v = VAR_SCALAR_VALUE(&sym->u.var);
+    if (v->type != V_REAL)
+      {
+        goto stale;
+      }
+
+    (++sp)->real = v->u.real;
+    NEXT;
+
+  CASE(OP_LOADLI)
+    sym = (ip++)->ident->sym;
+    if (sym == (struct Symbol *)0 || sym->type != LOCALVAR)
+      {
+        goto stale;
+      }
+
+    v = VAR_SCALAR_VALUE(Auto_local(stack, sym->u.local.offset));
+    if (v->type != V_INTEGER)
+      {
+        goto stale;
+      }
+
+    (++sp)->integer = v->u.integer;
+    NEXT;
+
+  CASE(OP_LOADLR)
+    sym = (ip++)->ident->sym;
+    if (sym == (struct Symbol *)0 || sym->type != LOCALVAR)
+      {
+        goto stale;
+      }
+
+    v = VAR_SCALAR_VALUE(Auto_local(stack, sym->u.local.offset));
+    if (v->type != V_REAL)
+      {
+        goto stale;
+      }
+
+    (++sp)->real = v->u.real;
+    NEXT;
+
+  CASE(OP_LOADAI)
+    sym = ip[0].ident->sym;
+    dim = ip[1].dim;
+    ip += 2;
+    if (sym == (struct Symbol *)0 || sym->type != GLOBALARRAY)
+      {
+        goto stale;
+      }
+
+    sp -= dim;
+    if ((v = element(&sym->u.var, dim, sp + 1)) == (struct Value *)0)
+      {
+        goto bail;
+      }
+
+    if (v->type != V_INTEGER)
+      {
+        goto stale;
+      }
+
+    (++sp)->integer = v->u.integer;
+    NEXT;
+
+  CASE(OP_LOADAR)
+    sym = ip[0].ident->sym;
+    dim = ip[1].dim;
+    ip += 2;
+    if (sym == (struct Symbol *)0 || sym->type != GLOBALARRAY)
+      {
+        goto stale;
+      }
+
+    sp -= dim;
+    if ((v = element(&sym->u.var, dim, sp + 1)) == (struct Value *)0)
+      {
+        goto bail;
+      }
+
+    if (v->type != V_REAL)
+      {
+        goto stale;
+      }
+
+    (++sp)->real = v->u.real;
+    NEXT;
+
+  CASE(OP_TOINT)
+    sp->integer = Value_toi(sp->real, &overflow);
+    if (overflow)
+      {
+        goto bail;
+      }
+
+    NEXT;
+
+  CASE(OP_TOINT1)
+    sp[-1].integer = Value_toi(sp[-1].real, &overflow);
+    if (overflow)
+      {
+        goto bail;
+      }
+
+    NEXT;
+
+  CASE(OP_TOREAL)
+    sp->real = sp->integer;
+    NEXT;
+
+  CASE(OP_TOREAL1)
+    sp[-1].real = sp[-1].integer;
+    NEXT;
+
+  CASE(OP_NEGI)
+    sp->integer = -sp->integer;
+    NEXT;
+
+  CASE(OP_NEGR)
+    sp->real = -sp->real;
+    NEXT;
+
+  CASE(OP_NOTI)
+    sp->integer = ~sp->integer;
+    NEXT;
+
+  CASE(OP_ADDI)
+    --sp;
+    sp->integer += sp[1].integer;
+    NEXT;
+
+  CASE(OP_ADDR)
+    --sp;
+    sp->real += sp[1].real;
+    NEXT;
+
+  CASE(OP_SUBI)
+    --sp;
+    sp->integer -= sp[1].integer;
+    NEXT;
+
+  CASE(OP_SUBR)
+    --sp;
+    sp->real -= sp[1].real;
+    NEXT;
+
+  CASE(OP_MULI)
+    --sp;
+    sp->integer *= sp[1].integer;
+    NEXT;
+
+  CASE(OP_MULR)
+    --sp;
+    sp->real *= sp[1].real;
+    NEXT;
+
+  CASE(OP_DIVR)
+    --sp;
+    if (sp[1].real == 0.0)
+      {
+        goto bail;
+      }
+
+    sp->real /= sp[1].real;
+    NEXT;
+
+  CASE(OP_IDIVI)
+    --sp;
+    if (sp[1].integer == 0)
+      {
+        goto bail;
+      }
+
+    sp->integer /= sp[1].integer;
+    NEXT;
+
+  CASE(OP_IDIVR)
+    --sp;
+    if (sp[1].real == 0.0)
+      {
+        goto bail;
+      }
+
+    sp->real = Value_trunc(sp->real / sp[1].real);
+    NEXT;
+
+  CASE(OP_MODI)
+    --sp;
+    if (sp[1].integer == 0)
+      {
+        goto bail;
+      }
+
+    sp->integer %= sp[1].integer;
+    NEXT;
+
+  CASE(OP_MODR)
+    --sp;
+    if (sp[1].real == 0.0)
+      {
+        goto bail;
+      }
+
+    sp->real = fmod(sp->real, sp[1].real);
+    NEXT;
+
+  CASE(OP_POWR)
+    --sp;
+    if (sp->real == 0.0 && sp[1].real == 0.0)
+      {
+        goto bail;
+      }
+
+    sp->real = pow(sp->real, sp[1].real);
+    NEXT;
+
+  CASE(OP_ANDI)
+    --sp;
+    sp->integer &= sp[1].integer;
+    NEXT;
+
+  CASE(OP_ORI)
+    --sp;
+    sp->integer |= sp[1].integer;
+    NEXT;
+
+  CASE(OP_XORI)
+    --sp;
+    sp->integer ^= sp[1].integer;
+    NEXT;
+
+  CASE(OP_EQVI)
+    --sp;
+    sp->integer = ~(sp->integer ^ sp[1].integer);
+    NEXT;
+
+  CASE(OP_IMPI)
+    --sp;
+    sp->integer = (~sp->integer) | sp[1].integer;
+    NEXT;
+
+  CASE(OP_LTI)
+    --sp;
+    sp->integer = (sp->integer < sp[1].integer) ? -1 : 0;
+    NEXT;
+
+  CASE(OP_LTR)
+    --sp;
+    sp->integer = (sp->real < sp[1].real) ? -1 : 0;
+    NEXT;
+
+  CASE(OP_LEI)
+    --sp;
+    sp->integer = (sp->integer <= sp[1].integer) ? -1 : 0;
+    NEXT;
+
+  CASE(OP_LER)
+    --sp;
+    sp->integer = (sp->real <= sp[1].real) ? -1 : 0;
+    NEXT;
+
+  CASE(OP_EQI)
+    --sp;
+    sp->integer = (sp->integer == sp[1].integer) ? -1 : 0;
+    NEXT;
+
+  CASE(OP_EQR)
+    --sp;
+    sp->integer = (sp->real == sp[1].real) ? -1 : 0;
+    NEXT;
+
+  CASE(OP_GEI)
+    --sp;
+    sp->integer = (sp->integer >= sp[1].integer) ? -1 : 0;
+    NEXT;
+
+  CASE(OP_GER)
+    --sp;
+    sp->integer = (sp->real >= sp[1].real) ? -1 : 0;
+    NEXT;
+
+  CASE(OP_GTI)
+    --sp;
+    sp->integer = (sp->integer > sp[1].integer) ? -1 : 0;
+    NEXT;
+
+  CASE(OP_GTR)
+    --sp;
+    sp->integer = (sp->real > sp[1].real) ? -1 : 0;
+    NEXT;
+
+  CASE(OP_NEI)
+    --sp;
+    sp->integer = (sp->integer != sp[1].integer) ? -1 : 0;
+    NEXT;
+
+  CASE(OP_NER)
+    --sp;
+    sp->integer = (sp->real != sp[1].real) ? -1 : 0;
+    NEXT;
+
+  END
+
+#undef CASE
+#undef NEXT
+#undef BEGIN
+#undef END
+
+stale:
+  code->stale = 1;
+
+bail:
+  return (struct Token *)0;
+}
+
+/****************************************************************************
+ * Public Functions
+ ****************************************************************************/
+
+struct Token *Code_eval(struct Token *token, struct Auto *stack,
+                        struct Value *value)
+{
+  struct Code *code;
+
+  /* Only look at tokens that may start a numeric expression, so nothing
+   * gets cached for the many optional expressions that are absent.
+   */
+
+  switch (token->type)
+    {
+    case T_IDENTIFIER:
+    case T_INTEGER:
+    case T_HEXINTEGER:
+    case T_OCTINTEGER:
+    case T_REAL:
+    case T_OP:
+    case T_PLUS:
+    case T_MINUS:
+    case T_NOT:
+      break;
+
+    default:
+      return (struct Token *)0;
+    }
+
+  code = token->code;
+  if (code == (struct Code *)0 || code->stale)
+    {
+      free(code);
+      code = token->code = compile(token, stack);
+      if (code == (struct Code *)0)
+        {
+          return (struct Token *)0;
+        }
+    }
+
+  if (code->length == 0)
+    {
+      return (struct Token *)0;
+    }
+
+  return run(code, token, stack, value);
+}
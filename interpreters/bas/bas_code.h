@@ -0,0 +1,56 @@
+/****************************************************************************
+ * apps/interpreters/bas/bas_code.h
+ *
+ * SPDX-License-Identifier: Apache-2.0
+ *
+ * Licensed to the Apache Software Foundation (ASF) under one or more
+ * contributor license agreements.  See the NOTICE file distributed with
+ * this work for additional information regarding copyright ownership.  The
+ * ASF licenses this file to you under the Apache License, Version 2.0 (the
+ * "License"); you may not use this file except in compliance with the
+ * License.  You may obtain a copy of the License at
+ *
+ *   http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS, WITHOUT
+ * WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.  See the
+ * License for the specific language governing permissions and limitations
+ * under the License.
+ *
+ ****************************************************************************/
+
+#ifndef __APPS_EXAMPLES_BAS_BAS_CODE_H
+#define __APPS_EXAMPLES_BAS_BAS_CODE_H
+
+/****************************************************************************
+ * Included Files
+ ****************************************************************************/
+
+#include "bas_auto.h"
+#include "bas_token.h"
+#include "bas_value.h"
+
+/****************************************************************************
+ * Public Function Prototypes
+ ****************************************************************************/
+
+/* Evaluate the expression starting at token using its compiled bytecode.
+ *
+ * The first call compiles the expression and caches the result in
+ * token->code, which is released with free() by Token_destroy().  Only
+ * numeric expressions without side effects are compiled: literals, scalar
+ * variables, array elements and the arithmetic, relational and logical
+ * operators.  Whenever the bytecode cannot produce exactly the result of
+ * the tree walking evaluator (strings, function calls, errors such as a
+ * division by zero or a variable whose type changed), NULL is returned and
+ * the caller must evaluate the expression itself.
+ *
+ * On success the result is stored in value and the token following the
+ * expression is returned.
+ */
+
+struct Token *Code_eval(struct Token *token, struct Auto *stack,
+                        struct Value *value);
+
+#endif /* __APPS_EXAMPLES_BAS_BAS_CODE_H */
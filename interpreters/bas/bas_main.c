@@ -59,11 +59,12 @@ int main(int argc, FAR char *argv[])
   int backslash_colon = 0;
   int uppercase = 0;
   int restricted = 0;
+  bool bytecode = true;
   int lpfd;
 
   /* parse arguments */
 
-  while ((o = getopt(argc, argv, ":bl:ruVh")) != EOF)
+  while ((o = getopt(argc, argv, ":bl:nruVh")) != EOF)
     {
       switch (o)
         {
@@ -75,6 +76,10 @@ int main(int argc, FAR char *argv[])
           lp = optarg;
           break;
 
+        case 'n':
+          bytecode = false;
+          break;
+
         case 'u':
           uppercase = 1;
           break;
@@ -105,7 +110,8 @@ int main(int argc, FAR char *argv[])
 
   if (usage == 1)
     {
-      fputs(_("Usage: bas [-b] [-l file] [-r] [-u] [program [argument ...]]\n"),
+      fputs(_("Usage: bas [-b] [-l file] [-n] [-r] [-u] "
+              "[program [argument ...]]\n"),
             stderr);
       fputs(_("       bas -h\n"), stderr);
       fputs(_("       bas -V\n"), stderr);
@@ -116,7 +122,8 @@ int main(int argc, FAR char *argv[])
 
   if (usage == 2)
     {
-      fputs(_("Usage: bas [-b] [-l file] [-u] [program [argument ...]]\n"),
+      fputs(_("Usage: bas [-b] [-l file] [-n] [-u] "
+              "[program [argument ...]]\n"),
             stdout);
       fputs(_("       bas -h\n"), stdout);
       fputs(_("       bas -V\n"), stdout);
@@ -125,6 +132,7 @@ int main(int argc, FAR char *argv[])
       fputs("\n", stdout);
       fputs(_("-b  Convert backslashes to colons\n"), stdout);
       fputs(_("-l  Write LPRINT output to file\n"), stdout);
+      fputs(_("-n  Do not compile expressions to bytecode\n"), stdout);
       fputs(_("-r  Forbid SHELL\n"), stdout);
       fputs(_("-u  Output all tokens in uppercase\n"),
             stdout);
@@ -146,6 +154,7 @@ int main(int argc, FAR char *argv[])
   g_bas_argv  = &argv[optind];
   g_bas_argv0 = runFile;
   g_bas_end   = false;
+  g_bas_bytecode = bytecode;
 
   bas_init(backslash_colon, restricted, uppercase, lpfd);
   if (runFile)
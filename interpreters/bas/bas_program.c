@@ -839,7 +839,11 @@ void Program_renum(struct Program *self, int first, int inc)
 
                   if (Program_goLine(self, token->u.integer, &dst))
                     {
+                      /* Drop bytecode holding the old line number */
+
                       token->u.integer = first + dst.line * inc;
+                      free(token->code);
+                      token->code = (struct Code *)0;
                     }
 
                   ++token;
@@ -4631,7 +4631,7 @@ struct Token *Token_newCode(const char *ln) /*{{{*/
   if (l==1) { addNumber=1; ++l; }
   /*}}}*/
   yy_delete_buffer(buf);
-  cur=result=malloc(sizeof(struct Token)*l);
+  cur=result=calloc(l,sizeof(struct Token));
   if (addNumber)
   {
     cur->type=T_UNNUMBERED;
@@ -4683,7 +4683,7 @@ struct Token *Token_newData(const char *ln) /*{{{*/
   g_matchdata=1;
   for (l=1; yylex(); ++l);
   yy_delete_buffer(buf);
-  cur=result=malloc(sizeof(struct Token)*l);
+  cur=result=calloc(l,sizeof(struct Token));
   buf=yy_scan_string(ln);
   g_matchdata=1;
   while (cur->statement=NULL,(cur->type=yylex())) ++cur;
@@ -4699,6 +4699,7 @@ void Token_destroy(struct Token *token) /*{{{*/
 
   do
   {
+    free(r->code);
     switch (r->type)
     {
       case T_ACCESS_READ:       break;
@@ -318,6 +318,7 @@ struct Token
 {
   enum TokenType type;
   struct Value *(*statement)(struct Value *value);
+  struct Code *code; /* Compiled expression starting here, see bas_code.h */
   union
   {
     /* T_ACCESS_READ        */
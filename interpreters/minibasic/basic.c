@@ -39,6 +39,7 @@
 #include <stdarg.h>
 #include <math.h>
 #include <limits.h>
+#include <stdint.h>
 #include <ctype.h>
 #include <assert.h>
 
@@ -167,11 +168,35 @@ struct mb_line_s
 {
   int no;                       /* Line number */
   FAR const char *str;          /* Points to start of line */
+  int tok;                      /* Index of the first token of the line */
+  int jumpno;                   /* Last line number jumped to, 0 if none */
+  int jumpline;                 /* Index of line jumpno, or -1 */
+};
+
+/* The program is tokenized once by setup().  Each token records what
+ * gettoken() and tokenlen() would find at that point of the source text,
+ * so the parser walks the token array instead of re-lexing the text every
+ * time a line is executed.
+ */
+
+struct mb_token_s
+{
+  int16_t type;                 /* Token id, as returned by gettoken() */
+  uint8_t error;                /* Error raised when the token is consumed */
+  uint8_t nl;                   /* Set if a newline precedes the token */
+  union
+  {
+    double dval;                /* VALUE: the pre-parsed number */
+    int slot;                   /* Ids: index in g_variables/g_dimvariables */
+    FAR char *str;              /* QUOTE: the literal (malloced), or NULL */
+    int next;                   /* FOR: index of the matching NEXT, or -1 */
+  } u;
 };
 
 struct mb_variable_s
 {
   char id[32];                  /* Id of variable */
+  int defined;                  /* Set once the variable has been assigned */
   double dval;                  /* Its value if a real */
   FAR char *sval;               /* Its value if a string (malloced) */
 };
@@ -195,7 +220,6 @@ struct mb_lvalue_s
 
 struct mb_forloop_s
 {
-  char id[32];                  /* Id of control variable */
   int nextline;                 /* Line below FOR to which control passes */
   double toval;                 /* Terminal value */
   double step;                  /* Step size */
@@ -226,12 +250,16 @@ static int g_ndimvariables;                     /* Number of dimensioned arrays
 
 static FAR struct mb_line_s *g_lines;           /* List of line starts */
 static int nlines;                              /* Number of BASIC g_lines in program */
+static int g_curline;                           /* Index of the line being run */
+
+static FAR struct mb_token_s *g_tokens;         /* The tokenized program */
+static int g_ntokens;                           /* Number of tokens */
 
 static FILE *g_fpin;                            /* Input stream */
 static FILE *g_fpout;                           /* Output stream */
 static FILE *g_fperr;                           /* Error stream */
 
-static FAR const char *g_string;                /* String we are parsing */
+static FAR struct mb_token_s *g_tok;            /* Token we are parsing */
 static int g_token;                             /* Current token (lookahead) */
 static int g_errorflag;                         /* Set when error in input encountered */
 static char g_iobuffer[IOBUFSIZE];              /* I/O buffer */
@@ -241,6 +269,9 @@ static char g_iobuffer[IOBUFSIZE];              /* I/O buffer */
  ****************************************************************************/
 
 static int setup(FAR const char *script);
+static int tokenize(void);
+static int addtoken(int type, FAR int *size);
+static void linkfors(void);
 static void cleanup(void);
 
 static void reporterror(int lineno);
@@ -272,7 +303,8 @@ static double dimvariable(void);
 
 static FAR struct mb_variable_s *findvariable(FAR const char *id);
 static FAR struct mb_dimvar_s *finddimvar(FAR const char *id);
-static FAR struct mb_dimvar_s *dimension(FAR const char *id, int ndims, ...);
+static FAR struct mb_dimvar_s *dimension(FAR struct mb_dimvar_s *dv,
+                                         int ndims, ...);
 static FAR void *getdimvar(FAR struct mb_dimvar_s *dv, ...);
 static FAR struct mb_variable_s *addfloat(FAR const char *id);
 static FAR struct mb_variable_s *addstring(FAR const char *id);
@@ -293,7 +325,6 @@ static int integer(double x);
 
 static void match(int tok);
 static void seterror(int errorcode);
-static int getnextline(FAR const char *str);
 static int gettoken(FAR const char *str);
 static int tokenlen(FAR const char *str, int tokenid);
 
@@ -328,7 +359,7 @@ static int setup(FAR const char *script)
   int i;
 
   nlines = mystrcount(script, '\n');
-  g_lines = malloc(nlines * sizeof(struct mb_line_s));
+  g_lines = calloc(nlines, sizeof(struct mb_line_s));
   if (!g_lines)
     {
       if (g_fperr)
@@ -388,9 +419,283 @@ static int setup(FAR const char *script)
   g_dimvariables = 0;
   g_ndimvariables = 0;
 
+  g_tokens = 0;
+  g_ntokens = 0;
+
+  if (tokenize() == -1)
+    {
+      if (g_fperr)
+        {
+          fprintf(g_fperr, "Out of memory\n");
+        }
+
+      cleanup();
+      return -1;
+    }
+
+  return 0;
+}
+
+/****************************************************************************
+ * Name: tokenize
+ *
+ * Description:
+ *   Convert the program text into the token array.
+ *   Numbers are parsed, string literals are grabbed and identifiers are
+ *   bound to their slot in the variable lists, so that nothing is looked
+ *   up by name or re-lexed while the program runs.
+ *   Returns: 0 on success, -1 on failure
+ *
+ ****************************************************************************/
+
+static int tokenize(void)
+{
+  FAR struct mb_token_s *tok;
+  FAR struct mb_variable_s *var;
+  FAR struct mb_dimvar_s *dimvar;
+  FAR const char *str;
+  FAR const char *end;
+  FAR char *lit;
+  char id[32];
+  int size = 0;
+  int type;
+  int len;
+  int nl;
+  int i;
+
+  for (i = 0; i < nlines; i++)
+    {
+      str = g_lines[i].str;
+      end = i + 1 < nlines ? g_lines[i + 1].str : NULL;
+      g_lines[i].tok = g_ntokens;
+      nl = 1;
+
+      /* Walk the text exactly as match() used to, continuation lines
+       * included, until the next numbered line starts.
+       */
+
+      while (str != NULL)
+        {
+          while (isspace(*str))
+            {
+              if (*str == '\n')
+                {
+                  nl = 1;
+                }
+
+              str++;
+            }
+
+          if (str == end)
+            {
+              break;
+            }
+
+          type = gettoken(str);
+          if (addtoken(type, &size) == -1)
+            {
+              return -1;
+            }
+
+          tok = &g_tokens[g_ntokens - 1];
+          tok->nl = nl;
+          nl = 0;
+
+          switch (type)
+            {
+            case VALUE:
+              tok->u.dval = getvalue(str, &len);
+              str += len;
+              break;
+
+            case FLTID:
+            case STRID:
+              g_errorflag = 0;
+              getid(str, id, &len);
+              tok->error = g_errorflag;
+              str += len;
+
+              var = findvariable(id);
+              if (!var)
+                {
+                  var = type == FLTID ? addfloat(id) : addstring(id);
+                }
+
+              if (!var)
+                {
+                  return -1;
+                }
+
+              tok->u.slot = var - g_variables;
+              break;
+
+            case DIMFLTID:
+            case DIMSTRID:
+              g_errorflag = 0;
+              getid(str, id, &len);
+              tok->error = g_errorflag;
+              str += len;
+
+              dimvar = finddimvar(id);
+              if (!dimvar)
+                {
+                  dimvar = adddimvar(id);
+                }
+
+              if (!dimvar)
+                {
+                  return -1;
+                }
+
+              tok->u.slot = dimvar - g_dimvariables;
+              break;
+
+            case QUOTE:
+              lit = mystrend(str, '"');
+              if (lit)
+                {
+                  tok->u.str = malloc(lit - str);
+                  if (!tok->u.str)
+                    {
+                      return -1;
+                    }
+
+                  mystrgrablit(tok->u.str, str);
+                  str = lit + 1;
+                }
+              else
+                {
+                  /* Unterminated, stringliteral() reports the error */
+
+                  str = NULL;
+                }
+              break;
+
+            case REM:
+
+              /* The rest of the line is not parsed, but match(REM) still
+               * looks at the next token.
+               */
+
+              str += tokenlen(str, REM);
+              if (gettoken(str) == SYNTAX_ERROR &&
+                  addtoken(SYNTAX_ERROR, &size) == -1)
+                {
+                  return -1;
+                }
+
+              str = NULL;
+              break;
+
+            case SYNTAX_ERROR:
+            case EOS:
+              str = NULL;
+              break;
+
+            default:
+              str += tokenlen(str, type);
+              break;
+            }
+        }
+    }
+
+  /* Terminate the array so that the parser can never run off its end */
+
+  if (g_ntokens == 0 || g_tokens[g_ntokens - 1].type != EOS)
+    {
+      if (addtoken(EOS, &size) == -1)
+        {
+          return -1;
+        }
+
+      g_tokens[g_ntokens - 1].nl = 1;
+    }
+
+  g_errorflag = 0;
+  linkfors();
   return 0;
 }
 
+/****************************************************************************
+ * Name: addtoken
+ *
+ * Description:
+ *   Append a cleared token to the token array.
+ *   Params: type - the token id
+ *           size - the allocated size of the array, updated on growth
+ *   Returns: 0 on success, -1 on out of memory
+ *
+ ****************************************************************************/
+
+static int addtoken(int type, FAR int *size)
+{
+  FAR struct mb_token_s *tokens;
+  int newsize;
+
+  if (g_ntokens == *size)
+    {
+      newsize = *size ? *size * 2 : 64;
+      tokens = realloc(g_tokens, newsize * sizeof(struct mb_token_s));
+      if (!tokens)
+        {
+          return -1;
+        }
+
+      g_tokens = tokens;
+      *size = newsize;
+    }
+
+  memset(&g_tokens[g_ntokens], 0, sizeof(struct mb_token_s));
+  g_tokens[g_ntokens++].type = type;
+  return 0;
+}
+
+/****************************************************************************
+ * Name: linkfors
+ *
+ * Description:
+ *   Find the NEXT matching each FOR statement.
+ *   This is where control passes when the loop body is not to be executed
+ *   at all.
+ *
+ ****************************************************************************/
+
+static void linkfors(void)
+{
+  FAR struct mb_token_s *tok;
+  FAR struct mb_token_s *next;
+  int i;
+  int j;
+
+  for (i = 0; i < nlines; i++)
+    {
+      /* Every line starts with its number, and the array ends with EOS */
+
+      tok = &g_tokens[g_lines[i].tok];
+      if (tok[1].type != FOR)
+        {
+          continue;
+        }
+
+      tok[1].u.next = -1;
+      if (tok[2].type != FLTID && tok[2].type != DIMFLTID)
+        {
+          continue;
+        }
+
+      for (j = i + 1; j < nlines; j++)
+        {
+          next = &g_tokens[g_lines[j].tok];
+          if (next[1].type == NEXT && next[2].type == tok[2].type &&
+              next[2].u.slot == tok[2].u.slot)
+            {
+              tok[1].u.next = j;
+              break;
+            }
+        }
+    }
+}
+
 /****************************************************************************
  * Name: cleanup
  *
@@ -458,6 +763,22 @@ static void cleanup(void)
   g_dimvariables = 0;
   g_ndimvariables = 0;
 
+  for (i = 0; i < g_ntokens; i++)
+    {
+      if (g_tokens[i].type == QUOTE && g_tokens[i].u.str)
+        {
+          free(g_tokens[i].u.str);
+        }
+    }
+
+  if (g_tokens)
+    {
+      free(g_tokens);
+    }
+
+  g_tokens = 0;
+  g_ntokens = 0;
+
   if (g_lines)
     {
       free(g_lines);
@@ -645,7 +966,6 @@ static int findline(int no)
 static int line(void)
 {
   int answer = 0;
-  FAR const char *str;
 
   match(VALUE);
 
@@ -694,22 +1014,9 @@ static int line(void)
 
   if (g_token != EOS)
     {
-      /* match(VALUE); */
-
       /* check for a newline */
 
-      str = g_string;
-      while (isspace(*str))
-        {
-          if (*str == '\n')
-            {
-              break;
-            }
-
-          str++;
-        }
-
-      if (*str != '\n')
+      if (!g_tok->nl)
         {
           seterror(ERR_SYNTAX);
         }
@@ -821,8 +1128,6 @@ static void dodim(void)
 {
   int ndims = 0;
   double dims[6];
-  char name[32];
-  int len;
   FAR struct mb_dimvar_s *dimvar;
   int i;
   int size = 1;
@@ -833,7 +1138,7 @@ static void dodim(void)
     {
     case DIMFLTID:
     case DIMSTRID:
-      getid(g_string, name, &len);
+      dimvar = &g_dimvariables[g_tok->u.slot];
       match(g_token);
       dims[ndims++] = expr();
       while (g_token == COMMA)
@@ -861,27 +1166,27 @@ static void dodim(void)
       switch (ndims)
         {
         case 1:
-          dimvar = dimension(name, 1, (int)dims[0]);
+          dimvar = dimension(dimvar, 1, (int)dims[0]);
           break;
 
         case 2:
-          dimvar = dimension(name, 2, (int)dims[0], (int)dims[1]);
+          dimvar = dimension(dimvar, 2, (int)dims[0], (int)dims[1]);
           break;
 
         case 3:
-          dimvar = dimension(name, 3, (int)dims[0],
+          dimvar = dimension(dimvar, 3, (int)dims[0],
                              (int)dims[1], (int)dims[2]);
           break;
 
         case 4:
           dimvar =
-            dimension(name, 4, (int)dims[0], (int)dims[1], (int)dims[2],
+            dimension(dimvar, 4, (int)dims[0], (int)dims[1], (int)dims[2],
                       (int)dims[3]);
           break;
 
         case 5:
           dimvar =
-            dimension(name, 5, (int)dims[0], (int)dims[1], (int)dims[2],
+            dimension(dimvar, 5, (int)dims[0], (int)dims[1], (int)dims[2],
                       (int)dims[3], (int)dims[4]);
           break;
         }
@@ -1015,18 +1320,14 @@ static int dogoto(void)
 static int dofor(void)
 {
   struct mb_lvalue_s lv;
-  char id[32];
-  char nextid[32];
-  int len;
+  FAR struct mb_token_s *fortok;
   double initval;
   double toval;
   double stepval;
-  FAR const char *savestring;
-  int answer;
+  int next;
 
+  fortok = g_tok;
   match(FOR);
-  getid(g_string, id, &len);
-
   lvalue(&lv);
   if (lv.type != FLTID)
     {
@@ -1060,36 +1361,21 @@ static int dofor(void)
   if ((stepval < 0 && initval < toval) ||
       (stepval > 0 && initval > toval))
     {
-      savestring = g_string;
-      while ((g_string = strchr(g_string, '\n')) != NULL)
+      /* Continue below the matching NEXT, found by linkfors() */
+
+      next = fortok->u.next;
+      if (next == -1)
         {
-          g_errorflag = 0;
-          g_token = gettoken(g_string);
-          match(VALUE);
-          if (g_token == NEXT)
-            {
-              match(NEXT);
-              if (g_token == FLTID || g_token == DIMFLTID)
-                {
-                  getid(g_string, nextid, &len);
-                  if (!strcmp(id, nextid))
-                    {
-                      answer = getnextline(g_string);
-                      g_string = savestring;
-                      g_token = gettoken(g_string);
-                      return answer ? answer : -1;
-                    }
-                }
-            }
+          seterror(ERR_NONEXT);
+          return -1;
         }
 
-      seterror(ERR_NONEXT);
-      return -1;
+      return next + 1 < nlines ? g_lines[next + 1].no : -1;
     }
   else
     {
-      strlcpy(g_forstack[nfors].id, id, sizeof(g_forstack[nfors].id));
-      g_forstack[nfors].nextline = getnextline(g_string);
+      g_forstack[nfors].nextline =
+        g_curline + 1 < nlines ? g_lines[g_curline + 1].no : 0;
       g_forstack[nfors].step = stepval;
       g_forstack[nfors].toval = toval;
       nfors++;
@@ -1108,15 +1394,12 @@ static int dofor(void)
 
 static int donext(void)
 {
-  char id[32];
-  int len;
   struct mb_lvalue_s lv;
 
   match(NEXT);
 
   if (nfors)
     {
-      getid(g_string, id, &len);
       lvalue(&lv);
       if (lv.type != FLTID)
         {
@@ -1260,15 +1543,13 @@ static void dorem(void)
  * Description:
  *   Get an lvalue from the environment
  *   Params: lv - structure to fill.
- *   Notes: missing variables (but not out of range subscripts)
- *          are added to the variable list.
+ *   Notes: scalar variables are defined by their first assignment,
+ *          arrays must have been dimensioned.
  *
  ****************************************************************************/
 
 static void lvalue(FAR struct mb_lvalue_s *lv)
 {
-  char name[32];
-  int len;
   FAR struct mb_variable_s *var;
   FAR struct mb_dimvar_s *dimvar;
   int index[5];
@@ -1283,19 +1564,9 @@ static void lvalue(FAR struct mb_lvalue_s *lv)
     {
     case FLTID:
       {
-        getid(g_string, name, &len);
+        var = &g_variables[g_tok->u.slot];
         match(FLTID);
-        var = findvariable(name);
-        if (!var)
-          {
-            var = addfloat(name);
-          }
-
-        if (!var)
-          {
-            seterror(ERR_OUTOFMEMORY);
-            return;
-          }
+        var->defined = 1;
 
         lv->type = FLTID;
         lv->dval = &var->dval;
@@ -1305,19 +1576,9 @@ static void lvalue(FAR struct mb_lvalue_s *lv)
 
     case STRID:
       {
-        getid(g_string, name, &len);
+        var = &g_variables[g_tok->u.slot];
         match(STRID);
-        var = findvariable(name);
-        if (!var)
-          {
-            var = addstring(name);
-          }
-
-        if (!var)
-          {
-            seterror(ERR_OUTOFMEMORY);
-            return;
-          }
+        var->defined = 1;
 
         lv->type = STRID;
         lv->sval = &var->sval;
@@ -1329,10 +1590,9 @@ static void lvalue(FAR struct mb_lvalue_s *lv)
     case DIMSTRID:
       {
         type = (g_token == DIMFLTID) ? FLTID : STRID;
-        getid(g_string, name, &len);
+        dimvar = &g_dimvariables[g_tok->u.slot];
         match(g_token);
-        dimvar = finddimvar(name);
-        if (dimvar)
+        if (dimvar->ndims)
           {
             switch (dimvar->ndims)
               {
@@ -1750,7 +2010,6 @@ static double factor(void)
   double answer = 0;
   FAR char *str;
   FAR char *end;
-  int len;
 
   switch (g_token)
     {
@@ -1761,7 +2020,7 @@ static double factor(void)
       break;
 
     case VALUE:
-      answer = getvalue(g_string, &len);
+      answer = g_tok->u.dval;
       match(VALUE);
       break;
 
@@ -2088,13 +2347,10 @@ static double instr(void)
 static double variable(void)
 {
   FAR struct mb_variable_s *var;
-  char id[32];
-  int len;
 
-  getid(g_string, id, &len);
+  var = &g_variables[g_tok->u.slot];
   match(FLTID);
-  var = findvariable(id);
-  if (var)
+  if (var->defined)
     {
       return var->dval;
     }
@@ -2117,15 +2373,12 @@ static double variable(void)
 static double dimvariable(void)
 {
   FAR struct mb_dimvar_s *dimvar;
-  char id[32];
-  int len;
   int index[5];
   FAR double *answer = NULL;
 
-  getid(g_string, id, &len);
+  dimvar = &g_dimvariables[g_tok->u.slot];
   match(DIMFLTID);
-  dimvar = finddimvar(id);
-  if (!dimvar)
+  if (!dimvar->ndims)
     {
       seterror(ERR_NOSUCHVARIABLE);
       return 0.0;
@@ -2248,15 +2501,15 @@ static struct mb_dimvar_s *finddimvar(FAR const char *id)
  *
  * Description:
  *   Dimension an array.
- *   Params: id - the id of the array (include leading ()
+ *   Params: dv - the array's entry in variable list
  *           ndims - number of dimension (1-5)
  *         ... - integers giving dimension size,
  *
  ****************************************************************************/
 
-static FAR struct mb_dimvar_s *dimension(FAR const char *id, int ndims, ...)
+static FAR struct mb_dimvar_s *dimension(FAR struct mb_dimvar_s *dv,
+                                         int ndims, ...)
 {
-  FAR struct mb_dimvar_s *dv;
   va_list vargs;
   int size = 1;
   int oldsize = 1;
@@ -2271,18 +2524,6 @@ static FAR struct mb_dimvar_s *dimension(FAR const char *id, int ndims, ...)
       return 0;
     }
 
-  dv = finddimvar(id);
-  if (!dv)
-    {
-      dv = adddimvar(id);
-    }
-
-  if (!dv)
-    {
-      seterror(ERR_OUTOFMEMORY);
-      return 0;
-    }
-
   if (dv->ndims)
     {
       for (i = 0; i < dv->ndims; i++)
@@ -2501,6 +2742,7 @@ static FAR struct mb_variable_s *addfloat(FAR const char *id)
       g_variables = vars;
       strlcpy(g_variables[g_nvariables].id, id,
               sizeof(g_variables[g_nvariables].id));
+      g_variables[g_nvariables].defined = 0;
       g_variables[g_nvariables].dval = 0.0;
       g_variables[g_nvariables].sval = NULL;
       g_nvariables++;
@@ -2535,6 +2777,7 @@ static FAR struct mb_variable_s *addstring(FAR const char *id)
       g_variables = vars;
       strlcpy(g_variables[g_nvariables].id, id,
               sizeof(g_variables[g_nvariables].id));
+      g_variables[g_nvariables].defined = 0;
       g_variables[g_nvariables].sval = NULL;
       g_variables[g_nvariables].dval = 0.0;
       g_nvariables++;
@@ -2982,17 +3225,14 @@ static FAR char *stringstring(void)
 
 static FAR char *stringdimvar(void)
 {
-  char id[32];
-  int len;
   FAR struct mb_dimvar_s *dimvar;
   FAR char **answer = NULL;
   int index[5];
 
-  getid(g_string, id, &len);
+  dimvar = &g_dimvariables[g_tok->u.slot];
   match(DIMSTRID);
-  dimvar = finddimvar(id);
 
-  if (dimvar)
+  if (dimvar->ndims)
     {
       switch (dimvar->ndims)
         {
@@ -3073,14 +3313,11 @@ static FAR char *stringdimvar(void)
 
 static FAR char *stringvar(void)
 {
-  char id[32];
-  int len;
   FAR struct mb_variable_s *var;
 
-  getid(g_string, id, &len);
+  var = &g_variables[g_tok->u.slot];
   match(STRID);
-  var = findvariable(id);
-  if (var)
+  if (var->defined)
     {
       if (var->sval)
         {
@@ -3107,53 +3344,33 @@ static FAR char *stringvar(void)
 
 static FAR char *stringliteral(void)
 {
-  int len = 1;
   FAR char *answer = 0;
   FAR char *temp;
-  FAR char *substr;
-  FAR char *end;
 
   while (g_token == QUOTE)
     {
-      while (isspace(*g_string))
+      /* The literal was grabbed by tokenize(), NULL if unterminated */
+
+      if (!g_tok->u.str)
         {
-          g_string++;
+          seterror(ERR_SYNTAX);
+          return answer;
         }
 
-      end = mystrend(g_string, '"');
-      if (end)
+      if (answer)
         {
-          len = end - g_string;
-          substr = malloc(len);
-          if (!substr)
-            {
-              seterror(ERR_OUTOFMEMORY);
-              return answer;
-            }
-
-          mystrgrablit(substr, g_string);
-          if (answer)
-            {
-              temp = mystrconcat(answer, substr);
-              free(substr);
-              free(answer);
-              answer = temp;
-              if (!answer)
-                {
-                  seterror(ERR_OUTOFMEMORY);
-                  return answer;
-                }
-            }
-          else
-            {
-              answer = substr;
-            }
-
-          g_string = end;
+          temp = mystrconcat(answer, g_tok->u.str);
+          free(answer);
+          answer = temp;
         }
       else
         {
-          seterror(ERR_SYNTAX);
+          answer = mystrdup(g_tok->u.str);
+        }
+
+      if (!answer)
+        {
+          seterror(ERR_OUTOFMEMORY);
           return answer;
         }
 
@@ -3191,7 +3408,7 @@ static int integer(double x)
  *
  * Description:
  *   Check that we have a token of the passed type (if not set g_errorflag)
- *   Move parser on to next token. Sets token and string.
+ *   Move parser on to next token. Sets token and g_tok.
  *
  ****************************************************************************/
 
@@ -3203,13 +3420,17 @@ static void match(int tok)
       return;
     }
 
-  while (isspace(*g_string))
+  if (g_tok->error)
+    {
+      seterror(g_tok->error);
+    }
+
+  if (g_token != EOS)
     {
-      g_string++;
+      g_tok++;
     }
 
-  g_string += tokenlen(g_string, g_token);
-  g_token = gettoken(g_string);
+  g_token = g_tok->type;
   if (g_token == SYNTAX_ERROR)
     {
       seterror(ERR_SYNTAX);
@@ -3234,42 +3455,6 @@ static void seterror(int errorcode)
     }
 }
 
-/****************************************************************************
- * Name: getnextline
- *
- * Description:
- *   Get the next line number
- *   Params: str - pointer to parse string
- *   Returns: line no of next line, 0 if end
- *   Notes: goes to newline, then finds
- *          first line starting with a digit.
- *
- ****************************************************************************/
-
-static int getnextline(FAR const char *str)
-{
-  while (*str)
-    {
-      while (*str && *str != '\n')
-        {
-          str++;
-        }
-
-      if (*str == 0)
-        {
-          return 0;
-        }
-
-      str++;
-      if (isdigit(*str))
-        {
-          return atoi(str);
-        }
-    }
-
-  return 0;
-}
-
 /****************************************************************************
  * Name: gettoken
  *
@@ -4097,8 +4282,9 @@ int basic(FAR const char *script, FILE * in, FILE * out, FILE * err)
 
   while (curline != -1)
     {
-      g_string = g_lines[curline].str;
-      g_token = gettoken(g_string);
+      g_curline = curline;
+      g_tok = &g_tokens[g_lines[curline].tok];
+      g_token = g_tok->type;
       g_errorflag = 0;
 
       nextline = line();
@@ -4122,7 +4308,17 @@ int basic(FAR const char *script, FILE * in, FILE * out, FILE * err)
         }
       else
         {
-          curline = findline(nextline);
+          /* Only search for the target when it differs from the last jump
+           * taken from this line.
+           */
+
+          if (g_lines[curline].jumpno != nextline)
+            {
+              g_lines[curline].jumpno = nextline;
+              g_lines[curline].jumpline = findline(nextline);
+            }
+
+          curline = g_lines[curline].jumpline;
           if (curline == -1)
             {
               if (g_fperr)
@@ -29,6 +29,7 @@
 #include <unistd.h>
 #include <fcntl.h>
 #include <sys/ioctl.h>
+#include <sys/uio.h>
 #include <errno.h>
 #include <netinet/in.h>
 #include <assert.h>
@@ -73,8 +74,12 @@ static int send_dataack(int fd, uint32_t ackxid, int32_t ackresult,
                         uint16_t valuelen, uint16_t valuelen_nontrunc,
                         FAR uint8_t *value_ptr, FAR uint8_t *buf_ptr)
 {
-  int ret;
   struct usrsock_message_datareq_ack_s dataack;
+  struct iovec iov[3];
+  ssize_t total = 0;
+  ssize_t ret;
+  int iovcnt;
+  int i;
 
   dataack.reqack.head.msgid = USRSOCK_MESSAGE_RESPONSE_DATA_ACK;
   dataack.reqack.head.flags = 0;
@@ -85,28 +90,41 @@ static int send_dataack(int fd, uint32_t ackxid, int32_t ackresult,
   dataack.valuelen = valuelen;
   dataack.valuelen_nontrunc = valuelen_nontrunc;
 
-  ret = write_to_usock(fd, &dataack, sizeof(dataack));
-  if (ret < 0)
-    {
-      return ret;
-    }
+  /* Send the header, the value and the data with one writev() so that the
+   * kernel gets the whole response in a single call.
+   */
+
+  iov[0].iov_base = &dataack;
+  iov[0].iov_len = sizeof(dataack);
+  iovcnt = 1;
 
   if ((valuelen > 0) && (value_ptr != NULL))
     {
-      ret = write_to_usock(fd, value_ptr, valuelen);
-      if (ret < 0)
-        {
-          return ret;
-        }
+      iov[iovcnt].iov_base = value_ptr;
+      iov[iovcnt].iov_len = valuelen;
+      iovcnt++;
     }
 
   if ((ackresult > 0) && (buf_ptr != NULL))
     {
-      ret = write_to_usock(fd, buf_ptr, ackresult);
-      if (ret < 0)
-        {
-          return ret;
-        }
+      iov[iovcnt].iov_base = buf_ptr;
+      iov[iovcnt].iov_len = ackresult;
+      iovcnt++;
+    }
+
+  for (i = 0; i < iovcnt; i++)
+    {
+      total += iov[i].iov_len;
+    }
+
+  ret = writev(fd, iov, iovcnt);
+  if (ret < 0)
+    {
+      return -errno;
+    }
+  else if (ret != total)
+    {
+      return -ENOSPC;
     }
 
   return OK;
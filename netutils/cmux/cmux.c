@@ -30,13 +30,14 @@
 #include <string.h>
 #include <stdio.h>
 #include <fcntl.h>
+#include <poll.h>
+#include <unistd.h>
 
 #include <sys/param.h>
 #include <sys/types.h>
 #include <pthread.h>
 #include <sched.h>
 #include <pty.h>
-#include <nuttx/crc8.h>
 
 #include "netutils/chat.h"
 #include "netutils/cmux.h"
@@ -46,24 +47,17 @@
  * Private Data
  ****************************************************************************/
 
-#define CMUX_MIN_FRAME_LEN (5)
 #define CMUX_FRAME_PREFIX (5)
 #define CMUX_FRAME_POSFIX (2)
 
 #define CMUX_TASK_NAME ("cmux")
 #define CMUX_THREAD_PRIOR (100)
 #define CMUX_THREAD_STACK_SIZE (3072)
+#define CMUX_POLL_TIMEOUT (1000)
 
-#define cmux_inc_buffer(buf, p) \
-  p++;                          \
-  if (p == buf->endp)           \
-    p = buf->data;
+/* One step of the GSM 07.10 FCS (CRC-8, reflected polynomial 0xe0) */
 
-#define cmux_buffer_length(buf) \
-  ((buf->readp > buf->writep) ? (CMUX_BUFFER_SZ - (buf->readp - buf->writep)) : (buf->writep - buf->readp))
-
-#define cmux_buffer_free(buf) \
-  ((buf->readp > buf->writep) ? (buf->readp - buf->writep) : (CMUX_BUFFER_SZ - (buf->writep - buf->readp)))
+#define cmux_fcs_add(fcs, c) (g_cmux_fcstab[(unsigned char)((fcs) ^ (c))])
 
 struct cmux_ctl_s
 {
@@ -72,6 +66,35 @@ struct cmux_ctl_s
   struct cmux_parse_s *parse;
   struct cmux_channel_s *channels;
   struct cmux_stream_buffer_s *stream;
+  struct pollfd *fds;                     /* Modem, then one per channel */
+  unsigned char txbuf[CMUX_TX_BUFFER_SZ]; /* Frames waiting for the modem */
+  int txlen;                              /* Bytes used in txbuf */
+};
+
+static const unsigned char g_cmux_fcstab[256] =
+{
+  0x00, 0x91, 0xe3, 0x72, 0x07, 0x96, 0xe4, 0x75, 0x0e, 0x9f, 0xed, 0x7c,
+  0x09, 0x98, 0xea, 0x7b, 0x1c, 0x8d, 0xff, 0x6e, 0x1b, 0x8a, 0xf8, 0x69,
+  0x12, 0x83, 0xf1, 0x60, 0x15, 0x84, 0xf6, 0x67, 0x38, 0xa9, 0xdb, 0x4a,
+  0x3f, 0xae, 0xdc, 0x4d, 0x36, 0xa7, 0xd5, 0x44, 0x31, 0xa0, 0xd2, 0x43,
+  0x24, 0xb5, 0xc7, 0x56, 0x23, 0xb2, 0xc0, 0x51, 0x2a, 0xbb, 0xc9, 0x58,
+  0x2d, 0xbc, 0xce, 0x5f, 0x70, 0xe1, 0x93, 0x02, 0x77, 0xe6, 0x94, 0x05,
+  0x7e, 0xef, 0x9d, 0x0c, 0x79, 0xe8, 0x9a, 0x0b, 0x6c, 0xfd, 0x8f, 0x1e,
+  0x6b, 0xfa, 0x88, 0x19, 0x62, 0xf3, 0x81, 0x10, 0x65, 0xf4, 0x86, 0x17,
+  0x48, 0xd9, 0xab, 0x3a, 0x4f, 0xde, 0xac, 0x3d, 0x46, 0xd7, 0xa5, 0x34,
+  0x41, 0xd0, 0xa2, 0x33, 0x54, 0xc5, 0xb7, 0x26, 0x53, 0xc2, 0xb0, 0x21,
+  0x5a, 0xcb, 0xb9, 0x28, 0x5d, 0xcc, 0xbe, 0x2f, 0xe0, 0x71, 0x03, 0x92,
+  0xe7, 0x76, 0x04, 0x95, 0xee, 0x7f, 0x0d, 0x9c, 0xe9, 0x78, 0x0a, 0x9b,
+  0xfc, 0x6d, 0x1f, 0x8e, 0xfb, 0x6a, 0x18, 0x89, 0xf2, 0x63, 0x11, 0x80,
+  0xf5, 0x64, 0x16, 0x87, 0xd8, 0x49, 0x3b, 0xaa, 0xdf, 0x4e, 0x3c, 0xad,
+  0xd6, 0x47, 0x35, 0xa4, 0xd1, 0x40, 0x32, 0xa3, 0xc4, 0x55, 0x27, 0xb6,
+  0xc3, 0x52, 0x20, 0xb1, 0xca, 0x5b, 0x29, 0xb8, 0xcd, 0x5c, 0x2e, 0xbf,
+  0x90, 0x01, 0x73, 0xe2, 0x97, 0x06, 0x74, 0xe5, 0x9e, 0x0f, 0x7d, 0xec,
+  0x99, 0x08, 0x7a, 0xeb, 0x8c, 0x1d, 0x6f, 0xfe, 0x8b, 0x1a, 0x68, 0xf9,
+  0x82, 0x13, 0x61, 0xf0, 0x85, 0x14, 0x66, 0xf7, 0xa8, 0x39, 0x4b, 0xda,
+  0xaf, 0x3e, 0x4c, 0xdd, 0xa6, 0x37, 0x45, 0xd4, 0xa1, 0x30, 0x42, 0xd3,
+  0xb4, 0x25, 0x57, 0xc6, 0xb3, 0x22, 0x50, 0xc1, 0xba, 0x2b, 0x59, 0xc8,
+  0xbd, 0x2c, 0x5e, 0xcf,
 };
 
 /****************************************************************************
@@ -88,14 +111,21 @@ struct cmux_ctl_s
 
 static unsigned char cmux_calulate_fcs(const unsigned char *input, int count)
 {
-  return crc8rohcpart(input, count, 0x00);
+  unsigned char fcs = CMUX_FCS_MAX_VALUE;
+
+  while (count-- > 0)
+    {
+      fcs = cmux_fcs_add(fcs, *input++);
+    }
+
+  return CMUX_FCS_MAX_VALUE - fcs;
 }
 
 /****************************************************************************
  * Name: cmux_parse_create
  *
  * Description:
- *  Create a circular buffer to receive incoming packets.
+ *  Create the decoder state for incoming packets.
  *
  ****************************************************************************/
 
@@ -106,267 +136,304 @@ static struct cmux_stream_buffer_s *cmux_stream_buffer_create(void)
   if (cmux_buffer)
     {
       memset(cmux_buffer, 0, sizeof(struct cmux_stream_buffer_s));
-      cmux_buffer->readp = cmux_buffer->data;
-      cmux_buffer->writep = cmux_buffer->data;
-      cmux_buffer->endp = cmux_buffer->data + CMUX_BUFFER_SZ;
+      cmux_buffer->state = CMUX_DECODE_FLAG;
     }
 
   return cmux_buffer;
 }
 
 /****************************************************************************
- * Name: cmux_buffer_write
+ * Name: cmux_parse_reset
  *
  * Description:
- *  Write the input frames to the circular buffer.
+ *  Reset parse struct.  The data buffer is overwritten by the next frame
+ *  and is not cleared.
  *
  ****************************************************************************/
 
-static int cmux_buffer_write(struct cmux_stream_buffer_s *cmux_buffer,
-                              const char *input, int length)
+static void cmux_parse_reset(struct cmux_parse_s *cmux_parse)
 {
-  int c = cmux_buffer->endp - cmux_buffer->writep;
-
-  length = MIN(length, cmux_buffer_free(cmux_buffer));
-  if (length > c)
-    {
-      memcpy(cmux_buffer->writep, input, c);
-      memcpy(cmux_buffer->data, input + c, length - c);
-      cmux_buffer->writep = cmux_buffer->data + (length - c);
-    }
-  else
+  if (cmux_parse)
     {
-      memcpy(cmux_buffer->writep, input, length);
-      cmux_buffer->writep += length;
-      if (cmux_buffer->writep == cmux_buffer->endp)
-        {
-          cmux_buffer->writep = cmux_buffer->data;
-        }
+      cmux_parse->address = 0;
+      cmux_parse->control = 0;
+      cmux_parse->data_length = 0;
     }
-
-  return length;
 }
 
 /****************************************************************************
- * Name: cmux_parse_reset
+ * Name: cmux_decode_frame
  *
  * Description:
- *  Reset data buffer and parse struct.
+ *  Feed received bytes to the decoder.  The decoder keeps its state between
+ *  calls, so frames may be split anywhere across reads and nothing is
+ *  scanned twice.  Returns the number of bytes consumed, which stops right
+ *  after a complete frame has been decoded into cmux_parse, and sets
+ *  *complete accordingly.
  *
  ****************************************************************************/
 
-static void cmux_parse_reset(struct cmux_parse_s *cmux_parse)
-{
-  if (cmux_parse)
-    {
-      memset(cmux_parse->data, 0x00, CMUX_BUFFER_SZ);
-      memset(cmux_parse, 0x00, sizeof(struct cmux_parse_s));
-    }
-}
-
 static int cmux_decode_frame(struct cmux_stream_buffer_s *cmux_buffer,
-                            struct cmux_parse_s *cmux_parse)
+                             struct cmux_parse_s *cmux_parse,
+                             const unsigned char *input, int length,
+                             bool *complete)
 {
-  /* Minimal length to CMUX Frame : address, type, length, FCS and flag */
+  const unsigned char *data = input;
+  const unsigned char *end = input + length;
+  unsigned char c;
+  int n;
 
-  int length = CMUX_MIN_FRAME_LEN;
-  unsigned char *data = NULL;
-  unsigned char fcs = CMUX_FCS_MAX_VALUE;
-  int end = 0;
+  *complete = false;
 
-  if (!cmux_buffer || !cmux_parse)
+  while (data < end)
     {
-      return -EACCES;
-    }
+      if (cmux_buffer->state == CMUX_DECODE_DATA)
+        {
+          /* Copy as much of the information field as there is */
 
-  while (cmux_buffer_length(cmux_buffer) >= CMUX_MIN_FRAME_LEN)
-    {
-      cmux_buffer->flag_found = 0;
-      length = CMUX_MIN_FRAME_LEN;
+          n = MIN(end - data, cmux_parse->data_length - cmux_buffer->count);
+          memcpy(cmux_parse->data + cmux_buffer->count, data, n);
+          if (CMUX_FRAME_TYPE(CMUX_FRAME_TYPE_UI, cmux_parse))
+            {
+              int i;
+              for (i = 0; i < n; i++)
+                {
+                  cmux_buffer->fcs = cmux_fcs_add(cmux_buffer->fcs, data[i]);
+                }
+            }
 
-      while (!cmux_buffer->flag_found &&
-            cmux_buffer_length(cmux_buffer) > 0)
-        {
-          if (*cmux_buffer->readp == CMUX_OPEN_FLAG)
+          data += n;
+          cmux_buffer->count += n;
+          if (cmux_buffer->count == cmux_parse->data_length)
             {
-              cmux_buffer->flag_found = 1;
+              cmux_buffer->state = CMUX_DECODE_FCS;
             }
 
-          cmux_inc_buffer(cmux_buffer, cmux_buffer->readp);
+          continue;
         }
 
-      if (!cmux_buffer->flag_found)
+      c = *data++;
+      switch (cmux_buffer->state)
         {
-          return ERROR;
-        }
+          case CMUX_DECODE_FLAG:
+            if (c == CMUX_OPEN_FLAG)
+              {
+                cmux_buffer->state = CMUX_DECODE_ADDRESS;
+              }
 
-      while (cmux_buffer_length(cmux_buffer) > 0 &&
-           (*cmux_buffer->readp == CMUX_OPEN_FLAG))
-        {
-          cmux_inc_buffer(cmux_buffer, cmux_buffer->readp);
-        }
+            break;
 
-      if (cmux_buffer_length(cmux_buffer) < length)
-        {
-          return ERROR;
-        }
+          case CMUX_DECODE_ADDRESS:
+            if (c == CMUX_OPEN_FLAG)
+              {
+                break;
+              }
+
+            cmux_parse->address = (c & CMUX_ADDR_FIELD_CHECK) >> 2;
+            cmux_buffer->fcs = cmux_fcs_add(CMUX_FCS_MAX_VALUE, c);
+            cmux_buffer->state = CMUX_DECODE_CONTROL;
+            break;
+
+          case CMUX_DECODE_CONTROL:
+            cmux_parse->control = c;
+            cmux_buffer->fcs = cmux_fcs_add(cmux_buffer->fcs, c);
+            cmux_buffer->state = CMUX_DECODE_LENGTH;
+            break;
+
+          case CMUX_DECODE_LENGTH:
+          case CMUX_DECODE_LENGTH2:
+            cmux_buffer->fcs = cmux_fcs_add(cmux_buffer->fcs, c);
+            if (cmux_buffer->state == CMUX_DECODE_LENGTH)
+              {
+                cmux_parse->data_length =
+                  (c & CMUX_LENGTH_FIELD_OPERATOR) >> 1;
+              }
+            else
+              {
+                cmux_parse->data_length |=
+                  ((c & CMUX_LENGTH_FIELD_OPERATOR) >> 1) << 7;
+              }
+
+            /* EA bit clear: a second length octet follows */
+
+            if (!(c & 1) && cmux_buffer->state == CMUX_DECODE_LENGTH)
+              {
+                cmux_buffer->state = CMUX_DECODE_LENGTH2;
+                break;
+              }
 
-      data = cmux_buffer->readp;
-      fcs = CMUX_FCS_MAX_VALUE;
-      cmux_parse->address = ((*data &
-                              CMUX_ADDR_FIELD_CHECK) >> 2);
-      fcs = crc8rohcincr(*data, fcs);
-      cmux_inc_buffer(cmux_buffer, data);
+            if (cmux_parse->data_length >= CMUX_BUFFER_SZ)
+              {
+                cmux_buffer->dropped_count++;
+                cmux_buffer->state = CMUX_DECODE_FLAG;
+                break;
+              }
+
+            cmux_buffer->count = 0;
+            cmux_buffer->state = cmux_parse->data_length > 0 ?
+                                 CMUX_DECODE_DATA : CMUX_DECODE_FCS;
+            break;
+
+          case CMUX_DECODE_FCS:
+            if (cmux_fcs_add(cmux_buffer->fcs, c) != CMUX_FCS_OPERATOR)
+              {
+                cmux_buffer->dropped_count++;
+                cmux_buffer->state = c == CMUX_OPEN_FLAG ?
+                                     CMUX_DECODE_ADDRESS : CMUX_DECODE_FLAG;
+                break;
+              }
 
-      cmux_parse->control = *data;
-      fcs = crc8rohcincr(*data, fcs);
-      cmux_inc_buffer(cmux_buffer, data);
+            cmux_buffer->state = CMUX_DECODE_CLOSE;
+            break;
 
-      cmux_parse->data_length = (*data &
-                                CMUX_LENGTH_FIELD_OPERATOR) >> 1;
-      fcs = crc8rohcincr(*data, fcs);
+          case CMUX_DECODE_CLOSE:
+            if (c != CMUX_CLOSE_FLAG)
+              {
+                cmux_buffer->dropped_count++;
+                cmux_buffer->state = CMUX_DECODE_FLAG;
+                break;
+              }
 
-      /* EA bit, should always have the value 1 */
+            /* The close flag may also open the next frame */
 
-      if (!(*data & 1))
-        {
-          cmux_buffer->readp = data;
-          cmux_buffer->flag_found = 0;
-          continue;
+            cmux_buffer->received_count++;
+            cmux_buffer->state = CMUX_DECODE_ADDRESS;
+            *complete = true;
+            return data - input;
+
+          default:
+            cmux_buffer->state = CMUX_DECODE_FLAG;
+            break;
         }
+    }
+
+  return data - input;
+}
+
+/****************************************************************************
+ * Name: cmux_flush
+ *
+ * Description:
+ *  Write the queued frames to the modem.  The tty is non-blocking: unless
+ *  wait is set, whatever does not fit stays queued for the next pass of
+ *  the mux thread, which keeps reading the modem in the meantime.
+ *
+ ****************************************************************************/
+
+static int cmux_flush(struct cmux_ctl_s *ctl, bool wait)
+{
+  struct pollfd fds;
+  int offset = 0;
+  int ret = OK;
 
-      length += cmux_parse->data_length;
-      if (!(cmux_buffer_length(cmux_buffer) >= length))
+  while (offset < ctl->txlen)
+    {
+      ret = write(ctl->fd, ctl->txbuf + offset, ctl->txlen - offset);
+      if (ret > 0)
         {
-          return ERROR;
+          offset += ret;
+          ret = OK;
+          continue;
         }
 
-      cmux_inc_buffer(cmux_buffer, data);
-      if (cmux_parse->data_length > 0 &&
-        cmux_parse->data_length < CMUX_BUFFER_SZ)
+      if (ret < 0 && errno != EAGAIN)
         {
-          end = cmux_buffer->endp - data;
-          if (cmux_parse->data_length > end)
-            {
-              memcpy(cmux_parse->data, data, end);
-              memcpy(cmux_parse->data + end, cmux_buffer->data,
-                    cmux_parse->data_length - end);
-              data = cmux_buffer->data +
-                    (cmux_parse->data_length - end);
-            }
-          else
-            {
-              memcpy(cmux_parse->data, data, cmux_parse->data_length);
-              data += cmux_parse->data_length;
-              if (data == cmux_buffer->endp)
-                {
-                  data = cmux_buffer->data;
-                }
-            }
-
-          if (CMUX_FRAME_TYPE(CMUX_FRAME_TYPE_UI, cmux_parse))
-            {
-              int i;
-              for (i = 0; i < cmux_parse->data_length; i++)
-                {
-                  fcs = crc8rohcincr(cmux_parse->data[i], fcs);
-                }
-            }
+          ret = ERROR;
+          break;
         }
 
-      if (crc8rohcincr(*data, fcs) != CMUX_FCS_OPERATOR)
+      ret = OK;
+      if (!wait)
         {
-          cmux_buffer->dropped_count++;
-          cmux_buffer->readp = data;
-          cmux_parse_reset(cmux_parse);
-          continue;
+          break;
         }
 
-      cmux_inc_buffer(cmux_buffer, data);
-      if (*data != CMUX_CLOSE_FLAG)
+      fds.fd = ctl->fd;
+      fds.events = POLLOUT;
+      fds.revents = 0;
+      if (poll(&fds, 1, CMUX_POLL_TIMEOUT) <= 0)
         {
-          cmux_buffer->readp = data;
-          cmux_buffer->dropped_count++;
-          cmux_parse_reset(cmux_parse);
-          continue;
+          ret = ERROR;
+          break;
         }
+    }
+
+  if (ret != OK)
+    {
+      ninfo("Failed to write frames (wrote %d, expected %d)\n",
+            offset, ctl->txlen);
+      offset = ctl->txlen;
+    }
 
-      cmux_buffer->received_count++;
-      cmux_inc_buffer(cmux_buffer, data);
-      cmux_buffer->readp = data;
-      return OK;
+  ctl->txlen -= offset;
+  if (ctl->txlen > 0 && offset > 0)
+    {
+      memmove(ctl->txbuf, ctl->txbuf + offset, ctl->txlen);
     }
 
-  return ERROR;
+  return ret;
 }
 
 /****************************************************************************
  * Name: cmux_encode_frame
  *
  * Description:
- *  Encode a buffer to the CMUX protocol.
+ *  Encode a buffer to the CMUX protocol.  The frame is appended to the
+ *  transmit buffer, cmux_flush() sends everything queued with one write.
  *
  ****************************************************************************/
 
-static int cmux_encode_frame(int fd, int channel, char *buffer,
-                            int frame_size, unsigned char type)
+static int cmux_encode_frame(struct cmux_ctl_s *ctl, int channel,
+                             char *buffer, int frame_size,
+                             unsigned char type)
 {
-  int prefix_len = 4;
-  unsigned char frame_prefix[CMUX_FRAME_PREFIX] = {
-    CMUX_OPEN_FLAG, (CMUX_ADDR_FIELD_BIT_EA | CMUX_ADDR_FIELD_BIT_CR),
-    0x00, 0x00, 0x00
-  };
+  unsigned char *frame;
+  int prefix_len;
 
-  unsigned char frame_posfix[CMUX_FRAME_POSFIX] = {
-    CMUX_FCS_MAX_VALUE,
-    CMUX_CLOSE_FLAG
-  };
+  if (frame_size < 0 || frame_size >= CMUX_BUFFER_SZ)
+    {
+      return ERROR;
+    }
 
-  frame_prefix[CMUX_BIT1] = (frame_prefix[CMUX_BIT1] |
-  ((CMUX_ADDR_FIELD_OPERATOR & (unsigned char)channel) << 2));
+  if (ctl->txlen + CMUX_FRAME_PREFIX + frame_size + CMUX_FRAME_POSFIX >
+      CMUX_TX_BUFFER_SZ && cmux_flush(ctl, true) != OK)
+    {
+      return ERROR;
+    }
 
-  frame_prefix[CMUX_BIT2] = type;
+  frame = ctl->txbuf + ctl->txlen;
+  frame[CMUX_BIT0] = CMUX_OPEN_FLAG;
+  frame[CMUX_BIT1] = CMUX_ADDR_FIELD_BIT_EA | CMUX_ADDR_FIELD_BIT_CR |
+                     ((CMUX_ADDR_FIELD_OPERATOR &
+                       (unsigned char)channel) << 2);
+  frame[CMUX_BIT2] = type;
 
   if (frame_size <= CMUX_FRAME_MAX_SIZE)
     {
-      frame_prefix[CMUX_BIT3] = CMUX_ADDR_FIELD_BIT_EA | (frame_size << 1);
+      frame[CMUX_BIT3] = CMUX_ADDR_FIELD_BIT_EA | (frame_size << 1);
       prefix_len = 4;
     }
   else
     {
-      frame_prefix[CMUX_BIT3] = (frame_size << 1) &
-                                CMUX_LENGTH_FIELD_OPERATOR;
-      frame_prefix[CMUX_BIT4] = CMUX_ADDR_FIELD_BIT_EA |
-                                ((frame_size >> 7) << 1);
+      frame[CMUX_BIT3] = (frame_size << 1) & CMUX_LENGTH_FIELD_OPERATOR;
+      frame[CMUX_BIT4] = CMUX_ADDR_FIELD_BIT_EA | ((frame_size >> 7) << 1);
       prefix_len = 5;
     }
 
-  frame_posfix[CMUX_BIT0] = cmux_calulate_fcs(frame_prefix + 1,
-                                              prefix_len - 1);
-
-  int ret = write(fd, frame_prefix, prefix_len);
-  if (ret != prefix_len)
-    {
-      return ERROR;
-    }
-
   if (frame_size > 0 && buffer != NULL)
     {
-      ret = write(fd, buffer, frame_size);
-      if (ret != frame_size)
-        {
-          ninfo("Failed to write buffer (wrote %d, expected %d)\n",
-                ret, frame_size);
-          return ERROR;
-        }
+      memcpy(frame + prefix_len, buffer, frame_size);
     }
-
-  ret = write(fd, frame_posfix, CMUX_FRAME_POSFIX);
-  if (ret != CMUX_FRAME_POSFIX)
+  else
     {
-      return ERROR;
+      frame_size = 0;
     }
 
+  frame[prefix_len + frame_size] = cmux_calulate_fcs(frame + 1,
+                                                     prefix_len - 1);
+  frame[prefix_len + frame_size + 1] = CMUX_CLOSE_FLAG;
+
+  ctl->txlen += prefix_len + frame_size + CMUX_FRAME_POSFIX;
   return OK;
 }
 
@@ -389,6 +456,7 @@ static int cmux_open_pseudo_tty(struct cmux_channel_s *channel,
       return -EACCES;
     }
 
+  memset(&options, 0, sizeof(options));
   options.c_lflag &= ~(ICANON | ECHO | ECHOE | ISIG);
   options.c_iflag &= ~(INLCR | ICRNL | IGNCR);
 
@@ -428,14 +496,19 @@ static int cmux_open_pseudo_tty(struct cmux_channel_s *channel,
  *
  ****************************************************************************/
 
-static int cmux_open_channels(int fd, int total_channels)
+static int cmux_open_channels(struct cmux_ctl_s *ctl, int total_channels)
 {
   int ret = 0;
   for (int i = 0; i < total_channels; i++)
     {
-      ret = cmux_encode_frame(fd, i,
+      ret = cmux_encode_frame(ctl, i,
             NULL, 0x00,
             (CMUX_FRAME_TYPE_SABM | CMUX_CONTROL_FIELD_BIT_PF));
+      if (ret == OK)
+        {
+          ret = cmux_flush(ctl, true);
+        }
+
       if (ret != OK)
         {
           perror("ERROR: Failed to open channel\n");
@@ -449,137 +522,158 @@ static int cmux_open_channels(int fd, int total_channels)
 }
 
 /****************************************************************************
- * Name: cmux_extract
+ * Name: cmux_dispatch
  *
  * Description:
- *  Extract a frame from the circular buffer according
- *  to the input and length.
+ *  Handle a frame decoded into ctl->parse.
  *
  ****************************************************************************/
 
-static int cmux_extract(struct cmux_ctl_s *ctl, char *input, int len)
+static void cmux_dispatch(struct cmux_ctl_s *ctl)
 {
   int ret;
-  int frames_extracted = 0;
-
-  if (!input)
-    {
-      return ERROR;
-    }
 
-  ret = cmux_buffer_write(ctl->stream, input, len);
-  if (ret < 0)
+  if (ctl->parse->address >= ctl->total_ports)
     {
-      return ret;
+      ninfo("Frame for unknown channel %d\n", ctl->parse->address);
+      return;
     }
 
-  while (cmux_decode_frame(ctl->stream, ctl->parse) >= 0)
+  if (CMUX_FRAME_TYPE(CMUX_FRAME_TYPE_UI, ctl->parse) ||
+      CMUX_FRAME_TYPE(CMUX_FRAME_TYPE_UIH, ctl->parse))
     {
-      if (CMUX_FRAME_TYPE(CMUX_FRAME_TYPE_UI, ctl->parse) ||
-          CMUX_FRAME_TYPE(CMUX_FRAME_TYPE_UIH, ctl->parse))
+      if (ctl->parse->address > 0)
         {
-          if (ctl->parse->address > 0)
-            {
-              /* Logic channel */
+          /* Logic channel */
 
-              ret = write(ctl->channels[ctl->parse->address].master_fd,
-                          ctl->parse->data,
-                          ctl->parse->data_length);
+          ret = write(ctl->channels[ctl->parse->address].master_fd,
+                      ctl->parse->data,
+                      ctl->parse->data_length);
 
-              if (ret != ctl->parse->data_length)
-                {
-                  ninfo("Frame length less than expected\n");
-                  continue;
-                }
-            }
-          else
+          if (ret != ctl->parse->data_length)
             {
-              /* Control channel */
+              ninfo("Frame length less than expected\n");
             }
         }
       else
         {
-          switch ((ctl->parse->control & ~CMUX_CONTROL_FIELD_BIT_PF))
-            {
-              case CMUX_FRAME_TYPE_UA:
-                ninfo("Frame type: UA \n");
-
-                break;
-              case CMUX_FRAME_TYPE_DM:
-                ninfo("Frame type: DM \n");
-                if (ctl->channels[ctl->parse->address].active)
-                  {
-                    ctl->channels[ctl->parse->address].active = 0;
-                  }
-
-                break;
-              case CMUX_FRAME_TYPE_DISC:
-                ninfo("Frame type: DISC \n");
-
-                if (ctl->channels[ctl->parse->address].active)
+          /* Control channel */
+        }
+    }
+  else
+    {
+      switch ((ctl->parse->control & ~CMUX_CONTROL_FIELD_BIT_PF))
+        {
+          case CMUX_FRAME_TYPE_UA:
+            ninfo("Frame type: UA \n");
+
+            break;
+          case CMUX_FRAME_TYPE_DM:
+            ninfo("Frame type: DM \n");
+            if (ctl->channels[ctl->parse->address].active)
+              {
+                ctl->channels[ctl->parse->address].active = 0;
+              }
+
+            break;
+          case CMUX_FRAME_TYPE_DISC:
+            ninfo("Frame type: DISC \n");
+
+            if (ctl->channels[ctl->parse->address].active)
+              {
+                ctl->channels[ctl->parse->address].active = false;
+                ret = cmux_encode_frame(ctl,
+                      ctl->parse->address, NULL, 0x00,
+                      (CMUX_FRAME_TYPE_UA | CMUX_CONTROL_FIELD_BIT_PF));
+              }
+            else
+              {
+                ret = cmux_encode_frame(ctl,
+                      ctl->parse->address, NULL, 0x00,
+                      (CMUX_FRAME_TYPE_DM | CMUX_CONTROL_FIELD_BIT_PF));
+              }
+
+            if (ret < 0)
+              {
+                nwarn("Failed to encode the frame. Address (%d) \n",
+                      ctl->parse->address);
+              }
+
+            break;
+          case CMUX_FRAME_TYPE_SABM:
+            ninfo("Frame type: SABM\n");
+
+            if (!ctl->channels[ctl->parse->address].active)
+              {
+                if (!ctl->parse->address)
                   {
-                    ctl->channels[ctl->parse->address].active = false;
-                    ret = cmux_encode_frame(ctl->fd,
-                          ctl->parse->address, NULL, 0x00,
-                          (CMUX_FRAME_TYPE_UA | CMUX_CONTROL_FIELD_BIT_PF));
+                    ninfo("Control channel opened.\n");
                   }
                 else
                   {
-                    ret = cmux_encode_frame(ctl->fd,
-                          ctl->parse->address, NULL, 0x00,
-                          (CMUX_FRAME_TYPE_DM | CMUX_CONTROL_FIELD_BIT_PF));
+                    ninfo("Logical channel %d opened.\n",
+                      ctl->parse->address);
                   }
+              }
+            else
+              {
+                nwarn("Even though channel %d was already closed.\n",
+                      ctl->parse->address);
+              }
+
+            ctl->channels[ctl->parse->address].active = 1;
+            ret = cmux_encode_frame(ctl,
+                  ctl->parse->address, NULL, 0x00,
+                  (CMUX_FRAME_TYPE_UA | CMUX_CONTROL_FIELD_BIT_PF));
+            if (ret < 0)
+              {
+                nwarn("Failed to encode the frame. Address (%d) \n",
+                      ctl->parse->address);
+              }
+
+            break;
+          default:
+            ninfo("Frame type: UNKNOWN\n");
+            break;
+        }
+    }
+}
 
-                if (ret < 0)
-                  {
-                    nwarn("Failed to encode the frame. Address (%d) \n",
-                          ctl->parse->address);
-                  }
+/****************************************************************************
+ * Name: cmux_extract
+ *
+ * Description:
+ *  Decode the frames in the input received from the modem and dispatch
+ *  them.  Returns the number of complete frames.
+ *
+ ****************************************************************************/
 
-                break;
-              case CMUX_FRAME_TYPE_SABM:
-                ninfo("Frame type: SABM\n");
+static int cmux_extract(struct cmux_ctl_s *ctl, char *input, int len)
+{
+  const unsigned char *data = (const unsigned char *)input;
+  int frames_extracted = 0;
+  bool complete;
+  int n;
 
-                if (!ctl->channels[ctl->parse->address].active)
-                  {
-                    if (!ctl->parse->address)
-                      {
-                        ninfo("Control channel opened.\n");
-                      }
-                    else
-                      {
-                        ninfo("Logical channel %d opened.\n",
-                          ctl->parse->address);
-                      }
-                  }
-                else
-                  {
-                    nwarn("Even though channel %d was already closed.\n",
-                          ctl->parse->address);
-                  }
+  if (!input)
+    {
+      return ERROR;
+    }
 
-                ctl->channels[ctl->parse->address].active = 1;
-                ret = cmux_encode_frame(ctl->fd,
-                      ctl->parse->address, NULL, 0x00,
-                      (CMUX_FRAME_TYPE_UA | CMUX_CONTROL_FIELD_BIT_PF));
-                if (ret < 0)
-                  {
-                    nwarn("Failed to encode the frame. Address (%d) \n",
-                          ctl->parse->address);
-                  }
+  while (len > 0)
+    {
+      n = cmux_decode_frame(ctl->stream, ctl->parse, data, len, &complete);
+      data += n;
+      len -= n;
 
-                break;
-              default:
-                ninfo("Frame type: UNKNOWN\n");
-                break;
-            }
+      if (complete)
+        {
+          cmux_dispatch(ctl);
+          cmux_parse_reset(ctl->parse);
+          frames_extracted++;
         }
-
-      frames_extracted++;
     }
 
-  cmux_parse_reset(ctl->parse);
-
   return frames_extracted;
 }
 
@@ -600,10 +694,8 @@ static int cmux_send(struct cmux_ctl_s *ctl, char *buffer,
       return ERROR;
     }
 
-  ret = cmux_encode_frame(ctl->fd,
-                          address,
-                          buffer,
-                          length, CMUX_FRAME_TYPE_UIH);
+  ret = cmux_encode_frame(ctl, address, buffer, length,
+                          CMUX_FRAME_TYPE_UIH);
   return ret;
 }
 
@@ -611,55 +703,45 @@ static int cmux_send(struct cmux_ctl_s *ctl, char *buffer,
  * Name: cmux_thread
  *
  * Description:
- *   Start cmux thread.
+ *   Start cmux thread.  Every pass reads whatever the modem and the channel
+ *   pseudo terminals have and queues the resulting frames, which go to the
+ *   modem together.  The channels are not read while the queue is full.
  *
  ****************************************************************************/
 
 static void *cmux_thread(void *args)
 {
   struct cmux_ctl_s *ctl = (struct cmux_ctl_s *)args;
+  struct pollfd *fds = ctl->fds;
   int ret = 0;
-  fd_set rfds;
-  struct timeval timeout;
+  bool room;
   char buffer[CMUX_BUFFER_SZ];
 
   while (true)
     {
-      FD_ZERO(&rfds);
-      FD_SET(ctl->fd, &rfds);
+      room = ctl->txlen + CMUX_FRAME_PREFIX + CMUX_BUFFER_SZ +
+             CMUX_FRAME_POSFIX <= CMUX_TX_BUFFER_SZ;
+
+      fds[0].fd = ctl->fd;
+      fds[0].events = ctl->txlen > 0 ? POLLIN | POLLOUT : POLLIN;
+      fds[0].revents = 0;
 
-      int max_fd = ctl->fd;
       for (int i = 0; i < ctl->total_ports; i++)
         {
-          if (ctl->channels[i].active)
-            {
-              FD_SET(ctl->channels[i].master_fd, &rfds);
-              FD_SET(ctl->channels[i].slave_fd, &rfds);
-
-              if (ctl->channels[i].master_fd > max_fd)
-                {
-                  max_fd = ctl->channels[i].master_fd;
-                }
-
-              if (ctl->channels[i].slave_fd > max_fd)
-                {
-                  max_fd = ctl->channels[i].slave_fd;
-                }
-            }
+          fds[i + 1].fd = ctl->channels[i].active && room ?
+                          ctl->channels[i].master_fd : -1;
+          fds[i + 1].events = POLLIN;
+          fds[i + 1].revents = 0;
         }
 
-      timeout.tv_usec = 100;
-      timeout.tv_sec = 0;
-
-      ret = select(max_fd + 1, &rfds, NULL, NULL, &timeout);
+      ret = poll(fds, ctl->total_ports + 1, CMUX_POLL_TIMEOUT);
       if (ret > 0)
         {
-          if (FD_ISSET(ctl->fd, &rfds))
+          if (fds[0].revents & POLLIN)
             {
-              int bytes_read = read(ctl->fd, buffer, sizeof(buffer) - 1);
+              int bytes_read = read(ctl->fd, buffer, sizeof(buffer));
               if (bytes_read > 0)
                 {
-                  buffer[bytes_read] = '\0';
                   ret = cmux_extract(ctl, buffer, bytes_read);
                   if (ret < 0)
                     {
@@ -671,9 +753,10 @@ static void *cmux_thread(void *args)
           for (int i = 0; i < ctl->total_ports; i++)
             {
               if (ctl->channels[i].active &&
-                  FD_ISSET(ctl->channels[i].master_fd, &rfds))
+                  (fds[i + 1].revents & POLLIN) &&
+                  ctl->txlen + CMUX_FRAME_PREFIX + CMUX_BUFFER_SZ +
+                  CMUX_FRAME_POSFIX <= CMUX_TX_BUFFER_SZ)
                 {
-                  memset(buffer, 0, sizeof(buffer));
                   int bytes_read = read(ctl->channels[i].master_fd,
                                     buffer, sizeof(buffer) - 1);
                   if (bytes_read > 0)
@@ -686,6 +769,11 @@ static void *cmux_thread(void *args)
                     }
                 }
             }
+
+          if (ctl->txlen > 0 && cmux_flush(ctl, false) < 0)
+            {
+              nwarn("WARNING: Failed to write to the modem\n");
+            }
         }
     }
 
@@ -767,6 +855,15 @@ int cmux_create(struct cmux_settings_s *settings)
       goto exit;
     }
 
+  if (settings->channel_paths != NULL)
+    {
+      for (int i = 0; i < settings->total_channels; i++)
+        {
+          strlcpy(settings->channel_paths[i],
+                  cmux_ctl->channels[i].slave_path, CMUX_CHANNEL_NAME_SZ);
+        }
+    }
+
   cmux_ctl->stream = cmux_stream_buffer_create();
   if (cmux_ctl->stream == NULL)
     {
@@ -775,7 +872,16 @@ int cmux_create(struct cmux_settings_s *settings)
       goto exit;
     }
 
-  ret = cmux_open_channels(cmux_ctl->fd, settings->total_channels);
+  cmux_ctl->fds = malloc(sizeof(struct pollfd) *
+                         (settings->total_channels + 1));
+  if (cmux_ctl->fds == NULL)
+    {
+      perror("ERROR: Failed to allocate memory to poll set\n");
+      ret = -ENOMEM;
+      goto exit;
+    }
+
+  ret = cmux_open_channels(cmux_ctl, settings->total_channels);
   if (ret < 0)
     {
       perror("ERROR: Failed to open virtual channels.\n");
@@ -818,6 +924,11 @@ exit:
       free(cmux_ctl->stream);
     }
 
+  if (cmux_ctl->fds)
+    {
+      free(cmux_ctl->fds);
+    }
+
   close(cmux_ctl->fd);
 
   return ret;
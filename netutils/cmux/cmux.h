@@ -42,9 +42,12 @@
 #define CMUX_BIT7 (7)
 
 #define CMUX_BUFFER_SZ (1024)
-#define CMUX_CHANNEL_NAME_SZ (64)
 #define CMUX_FRAME_MAX_SIZE (127)
 
+/* Frames queued for the modem, sent together when the line has room */
+
+#define CMUX_TX_BUFFER_SZ (4 * CMUX_BUFFER_SZ)
+
 /**
  * Mux Frame
  *
@@ -209,13 +212,25 @@ struct cmux_parse_s
   unsigned char data[CMUX_BUFFER_SZ]; /* Reserved to information field */
 };
 
+/* Receive decoder states, one per frame field */
+
+enum cmux_decode_state_e
+{
+  CMUX_DECODE_FLAG = 0,               /* Hunting for an open flag */
+  CMUX_DECODE_ADDRESS,                /* Address, or more open flags */
+  CMUX_DECODE_CONTROL,                /* Control field */
+  CMUX_DECODE_LENGTH,                 /* First length octet */
+  CMUX_DECODE_LENGTH2,                /* Second length octet */
+  CMUX_DECODE_DATA,                   /* Information field */
+  CMUX_DECODE_FCS,                    /* Frame checking sequence */
+  CMUX_DECODE_CLOSE                   /* Close flag */
+};
+
 struct cmux_stream_buffer_s
 {
-  unsigned char data[CMUX_BUFFER_SZ]; /* Buffer to hold incoming packets. */
-  unsigned char *readp;               /* Pointer to read buffer */
-  unsigned char *writep;              /* Pointer to write buffer */
-  unsigned char *endp;                /* Pointer to end of buffer */
-  int flag_found;                     /* Detected open flag */
+  enum cmux_decode_state_e state;     /* Field expected next */
+  unsigned char fcs;                  /* Running FCS of the header */
+  int count;                          /* Information bytes received */
   unsigned long received_count;       /* Counter to received packets */
   unsigned long dropped_count;        /* Counter to dropped packets */
 };
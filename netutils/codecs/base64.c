@@ -53,30 +53,204 @@
  * Included Files
  ****************************************************************************/
 
+#include <sys/types.h>
+#include <stdint.h>
 #include <stdlib.h>
 #include <stdbool.h>
 #include <string.h>
+#include <errno.h>
 
 #include "netutils/base64.h"
 
 #ifdef CONFIG_CODECS_BASE64
 
+/****************************************************************************
+ * Pre-processor Definitions
+ ****************************************************************************/
+
+/* Reverse lookup of a character.  The result has bit 7 set for every
+ * character outside of the alphabet: 0xff in the tables, or any character
+ * >= 0x80.
+ */
+
+#define BASE64_VALUE(rtab, c) ((rtab)[(c) & 0x7f] | ((c) & 0x80))
+
+/****************************************************************************
+ * Private Data
+ ****************************************************************************/
+
+static const char g_base64_table[] =
+  "ABCDEFGHIJKLMNOPQRSTUVWXYZabcdefghijklmnopqrstuvwxyz0123456789+/";
+static const char g_base64w_table[] =
+  "ABCDEFGHIJKLMNOPQRSTUVWXYZabcdefghijklmnopqrstuvwxyz0123456789__";
+
+/* Character to 6-bit value.  The web safe alphabet has '_' twice, it
+ * decodes as 62.
+ */
+
+static const uint8_t g_base64_rtable[128] =
+{
+  0xff, 0xff, 0xff, 0xff, 0xff, 0xff, 0xff, 0xff, 0xff, 0xff, 0xff, 0xff,
+  0xff, 0xff, 0xff, 0xff, 0xff, 0xff, 0xff, 0xff, 0xff, 0xff, 0xff, 0xff,
+  0xff, 0xff, 0xff, 0xff, 0xff, 0xff, 0xff, 0xff, 0xff, 0xff, 0xff, 0xff,
+  0xff, 0xff, 0xff, 0xff, 0xff, 0xff, 0xff, 0x3e, 0xff, 0xff, 0xff, 0x3f,
+  0x34, 0x35, 0x36, 0x37, 0x38, 0x39, 0x3a, 0x3b, 0x3c, 0x3d, 0xff, 0xff,
+  0xff, 0xff, 0xff, 0xff, 0xff, 0x00, 0x01, 0x02, 0x03, 0x04, 0x05, 0x06,
+  0x07, 0x08, 0x09, 0x0a, 0x0b, 0x0c, 0x0d, 0x0e, 0x0f, 0x10, 0x11, 0x12,
+  0x13, 0x14, 0x15, 0x16, 0x17, 0x18, 0x19, 0xff, 0xff, 0xff, 0xff, 0xff,
+  0xff, 0x1a, 0x1b, 0x1c, 0x1d, 0x1e, 0x1f, 0x20, 0x21, 0x22, 0x23, 0x24,
+  0x25, 0x26, 0x27, 0x28, 0x29, 0x2a, 0x2b, 0x2c, 0x2d, 0x2e, 0x2f, 0x30,
+  0x31, 0x32, 0x33, 0xff, 0xff, 0xff, 0xff, 0xff
+};
+
+static const uint8_t g_base64w_rtable[128] =
+{
+  0xff, 0xff, 0xff, 0xff, 0xff, 0xff, 0xff, 0xff, 0xff, 0xff, 0xff, 0xff,
+  0xff, 0xff, 0xff, 0xff, 0xff, 0xff, 0xff, 0xff, 0xff, 0xff, 0xff, 0xff,
+  0xff, 0xff, 0xff, 0xff, 0xff, 0xff, 0xff, 0xff, 0xff, 0xff, 0xff, 0xff,
+  0xff, 0xff, 0xff, 0xff, 0xff, 0xff, 0xff, 0xff, 0xff, 0xff, 0xff, 0xff,
+  0x34, 0x35, 0x36, 0x37, 0x38, 0x39, 0x3a, 0x3b, 0x3c, 0x3d, 0xff, 0xff,
+  0xff, 0xff, 0xff, 0xff, 0xff, 0x00, 0x01, 0x02, 0x03, 0x04, 0x05, 0x06,
+  0x07, 0x08, 0x09, 0x0a, 0x0b, 0x0c, 0x0d, 0x0e, 0x0f, 0x10, 0x11, 0x12,
+  0x13, 0x14, 0x15, 0x16, 0x17, 0x18, 0x19, 0xff, 0xff, 0xff, 0xff, 0x3e,
+  0xff, 0x1a, 0x1b, 0x1c, 0x1d, 0x1e, 0x1f, 0x20, 0x21, 0x22, 0x23, 0x24,
+  0x25, 0x26, 0x27, 0x28, 0x29, 0x2a, 0x2b, 0x2c, 0x2d, 0x2e, 0x2f, 0x30,
+  0x31, 0x32, 0x33, 0xff, 0xff, 0xff, 0xff, 0xff
+};
+
 /****************************************************************************
  * Private Functions
  ****************************************************************************/
 
 /****************************************************************************
- * Name: base64_tab
+ * Name: base64_encode_blocks
+ *
+ * Description:
+ *   Encode the complete 3 byte blocks of src, 4 characters each.  Returns
+ *   the number of input bytes consumed.
+ *
+ ****************************************************************************/
+
+static size_t base64_encode_blocks(FAR const char *table,
+                                   FAR const unsigned char *src,
+                                   size_t len, FAR unsigned char *dst)
+{
+  FAR const unsigned char *in = src;
+  uint32_t v;
+
+  /* Two blocks per iteration keep more loads and stores in flight */
+
+  while (len >= 6)
+    {
+      v = ((uint32_t)in[0] << 16) | ((uint32_t)in[1] << 8) | in[2];
+      dst[0] = table[v >> 18];
+      dst[1] = table[(v >> 12) & 0x3f];
+      dst[2] = table[(v >> 6) & 0x3f];
+      dst[3] = table[v & 0x3f];
+
+      v = ((uint32_t)in[3] << 16) | ((uint32_t)in[4] << 8) | in[5];
+      dst[4] = table[v >> 18];
+      dst[5] = table[(v >> 12) & 0x3f];
+      dst[6] = table[(v >> 6) & 0x3f];
+      dst[7] = table[v & 0x3f];
+
+      in  += 6;
+      dst += 8;
+      len -= 6;
+    }
+
+  if (len >= 3)
+    {
+      v = ((uint32_t)in[0] << 16) | ((uint32_t)in[1] << 8) | in[2];
+      dst[0] = table[v >> 18];
+      dst[1] = table[(v >> 12) & 0x3f];
+      dst[2] = table[(v >> 6) & 0x3f];
+      dst[3] = table[v & 0x3f];
+      in += 3;
+    }
+
+  return in - src;
+}
+
+/****************************************************************************
+ * Name: base64_encode_tail
+ *
+ * Description:
+ *   Encode the last 1 or 2 bytes with padding.  Returns the number of
+ *   characters written, 0 or 4.
+ *
  ****************************************************************************/
 
-static FAR const char *base64_tab(bool websafe)
+static size_t base64_encode_tail(FAR const char *table,
+                                 FAR const unsigned char *in, size_t len,
+                                 FAR unsigned char *dst, char pad)
 {
-  static FAR const char *_tab =
-    "ABCDEFGHIJKLMNOPQRSTUVWXYZabcdefghijklmnopqrstuvwxyz0123456789+/";
-  static FAR const char *_tab_w =
-    "ABCDEFGHIJKLMNOPQRSTUVWXYZabcdefghijklmnopqrstuvwxyz0123456789__";
+  if (len == 0)
+    {
+      return 0;
+    }
 
-  return websafe ? _tab_w : _tab;
+  dst[0] = table[in[0] >> 2];
+  if (len == 1)
+    {
+      dst[1] = table[(in[0] & 0x03) << 4];
+      dst[2] = pad;
+    }
+  else
+    {
+      dst[1] = table[((in[0] & 0x03) << 4) | (in[1] >> 4)];
+      dst[2] = table[(in[1] & 0x0f) << 2];
+    }
+
+  dst[3] = pad;
+  return 4;
+}
+
+/****************************************************************************
+ * Name: base64_decode_blocks
+ *
+ * Description:
+ *   Decode 4 character groups of src into 3 bytes each, up to the first
+ *   group that holds a character outside of the alphabet, including
+ *   padding.  Returns the number of characters consumed.
+ *
+ ****************************************************************************/
+
+static size_t base64_decode_blocks(FAR const uint8_t *rtab,
+                                   FAR const unsigned char *src,
+                                   size_t len, FAR unsigned char *dst)
+{
+  FAR const unsigned char *in = src;
+  uint32_t a;
+  uint32_t b;
+  uint32_t c;
+  uint32_t d;
+
+  while (len >= 4)
+    {
+      a = BASE64_VALUE(rtab, in[0]);
+      b = BASE64_VALUE(rtab, in[1]);
+      c = BASE64_VALUE(rtab, in[2]);
+      d = BASE64_VALUE(rtab, in[3]);
+
+      /* Every invalid value has bit 7 set */
+
+      if (((a | b | c | d) & 0x80) != 0)
+        {
+          break;
+        }
+
+      a = (a << 18) | (b << 12) | (c << 6) | d;
+      dst[0] = a >> 16;
+      dst[1] = a >> 8;
+      dst[2] = a;
+
+      in  += 4;
+      dst += 3;
+      len -= 4;
+    }
+
+  return in - src;
 }
 
 /****************************************************************************
@@ -106,63 +280,28 @@ static FAR unsigned char *_base64_encode(FAR const unsigned char *src,
                                          FAR size_t *out_len,
                                          bool websafe)
 {
+  FAR const char *table = websafe ? g_base64w_table : g_base64_table;
   FAR unsigned char *out;
   FAR unsigned char *pos;
-  FAR const unsigned char *end;
-  FAR const unsigned char *in;
-  FAR const char *base64_table;
-  char ch = '=';
-  size_t olen;
-
-  if (websafe)
-    {
-      ch = '.';
-    }
-
-  base64_table = base64_tab(websafe);
-  olen = (len + 2) / 3 * 4 + 1; /* 3-byte blocks to 4-byte */
-
-  end = src + len;
-  in = src;
+  size_t done;
 
   if (dst)
     {
-      pos = out = dst;
+      out = dst;
     }
   else
     {
-      pos = out = malloc(olen);
+      out = malloc((len + 2) / 3 * 4 + 1); /* 3-byte blocks to 4-byte */
       if (out == NULL)
         {
           return NULL;
         }
     }
 
-  while (end - in >= 3)
-    {
-      *pos++ = base64_table[in[0] >> 2];
-      *pos++ = base64_table[((in[0] & 0x03) << 4) | (in[1] >> 4)];
-      *pos++ = base64_table[((in[1] & 0x0f) << 2) | (in[2] >> 6)];
-      *pos++ = base64_table[in[2] & 0x3f];
-      in += 3;
-    }
-
-  if (end - in != 0)
-    {
-      *pos++ = base64_table[in[0] >> 2];
-      if (end - in == 1)
-        {
-          *pos++ = base64_table[(in[0] & 0x03) << 4];
-          *pos++ = ch;          /* *pos++ = '='; */
-        }
-      else
-        {
-          *pos++ = base64_table[((in[0] & 0x03) << 4) | (in[1] >> 4)];
-          *pos++ = base64_table[(in[1] & 0x0f) << 2];
-        }
-
-      *pos++ = ch;              /* *pos++ = '='; */
-    }
+  done = base64_encode_blocks(table, src, len, out);
+  pos  = out + done / 3 * 4;
+  pos += base64_encode_tail(table, src + done, len - done, pos,
+                            websafe ? '.' : '=');
 
   *pos = '\0';
   if (out_len)
@@ -179,6 +318,10 @@ static FAR unsigned char *_base64_encode(FAR const unsigned char *src,
  * Description:
  *   Base64 decode
  *
+ *   Characters outside of the alphabet decode as zero bits.  Decoding stops
+ *   at the first group with padding, a trailing incomplete group is
+ *   ignored.
+ *
  * Caller is responsible for freeing the returned buffer.
  *
  * Input Parameters:
@@ -196,22 +339,14 @@ static unsigned char *_base64_decode(FAR const unsigned char *src,
                                      size_t len, FAR unsigned char *dst,
                                      FAR size_t *out_len, bool websafe)
 {
+  FAR const uint8_t *rtab = websafe ? g_base64w_rtable : g_base64_rtable;
   FAR unsigned char *out;
   FAR unsigned char *pos;
-  FAR unsigned char block[4];
-  FAR const char *base64_table;
-  char ch = '=';
-  FAR char *tmp;
-  size_t count;
+  uint8_t block[4];
+  char ch = websafe ? '.' : '=';
+  size_t done;
   size_t i;
 
-  if (websafe)
-    {
-      ch = '.';
-    }
-
-  base64_table = base64_tab(websafe);
-
   if (dst)
     {
       pos = out = dst;
@@ -225,30 +360,46 @@ static unsigned char *_base64_decode(FAR const unsigned char *src,
         }
     }
 
-  count = 0;
-  for (i = 0; i < len; i++)
+  for (; ; )
     {
-      tmp = strchr(base64_table, src[i]);
-      block[count] = tmp ? tmp - base64_table : 0;
-      count++;
+      /* Whole groups of valid characters */
 
-      if (count == 4)
+      done = base64_decode_blocks(rtab, src, len, pos);
+      pos += done / 4 * 3;
+      src += done;
+      len -= done;
+
+      if (len < 4)
         {
-          *pos++ = (block[0] << 2) | (block[1] >> 4);
-          if (src[i - 1] == ch)
-            {
-              break;
-            }
+          break;
+        }
 
-          *pos++ = (block[1] << 4) | (block[2] >> 2);
-          if (src[i] == ch)
+      /* A group with padding or other characters */
+
+      for (i = 0; i < 4; i++)
+        {
+          block[i] = BASE64_VALUE(rtab, src[i]);
+          if ((block[i] & 0x80) != 0)
             {
-              break;
+              block[i] = 0;
             }
+        }
+
+      *pos++ = (block[0] << 2) | (block[1] >> 4);
+      if (src[2] == ch)
+        {
+          break;
+        }
 
-          *pos++ = (block[2] << 6) | block[3];
-          count = 0;
+      *pos++ = (block[1] << 4) | (block[2] >> 2);
+      if (src[3] == ch)
+        {
+          break;
         }
+
+      *pos++ = (block[2] << 6) | block[3];
+      src += 4;
+      len -= 4;
     }
 
   *out_len = pos - out;
@@ -317,4 +468,254 @@ FAR void *base64w_decode(FAR const void *src, size_t len, FAR void *dst,
   return _base64_decode(src, len, dst, out_len, true);
 }
 
+/****************************************************************************
+ * Name: base64_encode_init
+ *
+ * Description:
+ *   Start a chunked encode.  websafe selects the base64w alphabet.
+ *
+ ****************************************************************************/
+
+void base64_encode_init(FAR struct base64_ctx_s *ctx, bool websafe)
+{
+  memset(ctx, 0, sizeof(*ctx));
+  ctx->websafe = websafe;
+}
+
+/****************************************************************************
+ * Name: base64_encode_update
+ *
+ * Description:
+ *   Encode the next chunk.  Up to 2 bytes are kept in ctx until the next
+ *   call, so dst must hold base64_encode_length(len + 2) characters.
+ *
+ * Returned Value:
+ *   The number of characters written to dst, no NUL is appended.
+ *
+ ****************************************************************************/
+
+size_t base64_encode_update(FAR struct base64_ctx_s *ctx,
+                            FAR const void *src, size_t len, FAR void *dst)
+{
+  FAR const char *table = ctx->websafe ? g_base64w_table : g_base64_table;
+  FAR const unsigned char *in = src;
+  FAR unsigned char *out = dst;
+  size_t done;
+
+  /* Complete the pending block first */
+
+  while (ctx->count > 0 && ctx->count < 3 && len > 0)
+    {
+      ctx->buf[ctx->count++] = *in++;
+      len--;
+    }
+
+  if (ctx->count == 3)
+    {
+      base64_encode_blocks(table, ctx->buf, 3, out);
+      out += 4;
+      ctx->count = 0;
+    }
+
+  done = base64_encode_blocks(table, in, len, out);
+  out += done / 3 * 4;
+  in  += done;
+  len -= done;
+
+  /* Keep the rest for the next call */
+
+  memcpy(ctx->buf + ctx->count, in, len);
+  ctx->count += len;
+
+  return out - (FAR unsigned char *)dst;
+}
+
+/****************************************************************************
+ * Name: base64_encode_final
+ *
+ * Description:
+ *   Flush the pending bytes with padding, up to 4 characters.
+ *
+ * Returned Value:
+ *   The number of characters written to dst, no NUL is appended.
+ *
+ ****************************************************************************/
+
+size_t base64_encode_final(FAR struct base64_ctx_s *ctx, FAR void *dst)
+{
+  FAR const char *table = ctx->websafe ? g_base64w_table : g_base64_table;
+  size_t n;
+
+  n = base64_encode_tail(table, ctx->buf, ctx->count, dst,
+                         ctx->websafe ? '.' : '=');
+  ctx->count = 0;
+  return n;
+}
+
+/****************************************************************************
+ * Name: base64_decode_init
+ *
+ * Description:
+ *   Start a chunked decode.  websafe selects the base64w alphabet.
+ *
+ ****************************************************************************/
+
+void base64_decode_init(FAR struct base64_ctx_s *ctx, bool websafe)
+{
+  memset(ctx, 0, sizeof(*ctx));
+  ctx->websafe = websafe;
+}
+
+/****************************************************************************
+ * Name: base64_decode_update
+ *
+ * Description:
+ *   Decode the next chunk.  Line breaks and blanks are skipped, other
+ *   characters outside of the alphabet are an error, unlike in
+ *   base64_decode().  Up to 3 characters are kept in ctx until the next
+ *   call, so dst must hold base64_decode_length(len + 3) bytes.
+ *
+ * Returned Value:
+ *   The number of bytes written to dst or -EINVAL if the input is not
+ *   valid base64.
+ *
+ ****************************************************************************/
+
+ssize_t base64_decode_update(FAR struct base64_ctx_s *ctx,
+                             FAR const void *src, size_t len,
+                             FAR void *dst)
+{
+  FAR const uint8_t *rtab = ctx->websafe ? g_base64w_rtable :
+                                           g_base64_rtable;
+  FAR const unsigned char *in = src;
+  FAR unsigned char *out = dst;
+  char pad = ctx->websafe ? '.' : '=';
+  uint8_t value;
+  size_t done;
+
+  while (len > 0)
+    {
+      /* Bulk decode while aligned on a group */
+
+      if (ctx->count == 0 && ctx->npad == 0)
+        {
+          done = base64_decode_blocks(rtab, in, len, out);
+          out += done / 4 * 3;
+          in  += done;
+          len -= done;
+
+          if (len == 0)
+            {
+              break;
+            }
+        }
+
+      value = BASE64_VALUE(rtab, *in);
+      if ((value & 0x80) != 0)
+        {
+          if (*in == ' ' || *in == '\t' || *in == '\r' || *in == '\n')
+            {
+              in++;
+              len--;
+              continue;
+            }
+
+          /* Padding completes a group of 2 or 3 characters */
+
+          if (*in != pad || ctx->count + ctx->npad < 2)
+            {
+              return -EINVAL;
+            }
+
+          ctx->npad++;
+          value = 0;
+        }
+      else if (ctx->npad > 0)
+        {
+          return -EINVAL;
+        }
+
+      ctx->value = (ctx->value << 6) | value;
+      if (ctx->npad == 0)
+        {
+          ctx->count++;
+        }
+
+      in++;
+      len--;
+
+      if (ctx->count + ctx->npad == 4)
+        {
+          /* count is 4, 3 or 2: 3, 2 or 1 bytes */
+
+          out[0] = ctx->value >> 16;
+          if (ctx->count > 2)
+            {
+              out[1] = ctx->value >> 8;
+            }
+
+          if (ctx->count > 3)
+            {
+              out[2] = ctx->value;
+            }
+
+          out += ctx->count - 1;
+          ctx->value = 0;
+          ctx->count = 0;
+          ctx->npad  = ctx->npad > 0 ? 4 : 0; /* Nothing may follow */
+        }
+    }
+
+  return out - (FAR unsigned char *)dst;
+}
+
+/****************************************************************************
+ * Name: base64_decode_final
+ *
+ * Description:
+ *   End a chunked decode.  A last group without padding is accepted.
+ *
+ * Returned Value:
+ *   The number of bytes written to dst, up to 2, or -EINVAL if the input
+ *   ended within a group.
+ *
+ ****************************************************************************/
+
+ssize_t base64_decode_final(FAR struct base64_ctx_s *ctx, FAR void *dst)
+{
+  FAR unsigned char *out = dst;
+  ssize_t ret;
+
+  if (ctx->npad != 0 && ctx->npad != 4)
+    {
+      return -EINVAL;
+    }
+
+  switch (ctx->count)
+    {
+      case 0:
+        ret = 0;
+        break;
+
+      case 2:
+        out[0] = ctx->value >> 4;
+        ret = 1;
+        break;
+
+      case 3:
+        out[0] = ctx->value >> 10;
+        out[1] = ctx->value >> 2;
+        ret = 2;
+        break;
+
+      default:
+        ret = -EINVAL;
+        break;
+    }
+
+  ctx->value = 0;
+  ctx->count = 0;
+  return ret;
+}
+
 #endif /* CONFIG_CODECS_BASE64 */
@@ -53,6 +53,7 @@
 #include <string.h>
 #include <stdint.h>
 #include <fcntl.h>
+#include <errno.h>
 #include <unistd.h>
 
 #include "netutils/md5.h"
@@ -182,13 +183,26 @@ void md5_update(struct md5_context_s *ctx, unsigned char const *buf,
       len -= t;
     }
 
-  /* Process data in 64-byte chunks */
+  /* Process data in 64-byte chunks.  MD5 words are little-endian, so on
+   * little-endian machines aligned input is hashed in place, without the
+   * copy to ctx->in.
+   */
 
   while (len >= 64)
     {
-      memcpy(ctx->in, buf, 64);
-      byte_reverse(ctx->in, 16);
-      md5_transform(ctx->buf, (uint32_t *)ctx->in);
+#ifndef CONFIG_ENDIAN_BIG
+      if (((uintptr_t)buf & (sizeof(uint32_t) - 1)) == 0)
+        {
+          md5_transform(ctx->buf, (FAR const uint32_t *)buf);
+        }
+      else
+#endif
+        {
+          memcpy(ctx->in, buf, 64);
+          byte_reverse(ctx->in, 16);
+          md5_transform(ctx->buf, (uint32_t *)ctx->in);
+        }
+
       buf += 64;
       len -= 64;
     }
@@ -385,15 +399,22 @@ void md5_sum(const uint8_t * addr, const size_t len, uint8_t * mac)
 
 char *md5_hash(const uint8_t * addr, const size_t len)
 {
+  static const char hex[] = "0123456789abcdef";
   uint8_t digest[16];
   char *hash;
   int i;
 
   hash = malloc(33);
+  if (hash == NULL)
+    {
+      return NULL;
+    }
+
   md5_sum(addr, len, digest);
   for (i = 0; i < 16; i++)
     {
-      snprintf(&hash[i * 2], 33 - i * 2, "%02x", digest[i]);
+      hash[i * 2]     = hex[digest[i] >> 4];
+      hash[i * 2 + 1] = hex[digest[i] & 0x0f];
     }
 
   hash[32] = 0;
@@ -36,24 +36,42 @@
  ****************************************************************************/
 
 #ifdef CONFIG_CODECS_URLCODE
-#  define IS_HEX_CHAR(ch) \
-  ((ch >= '0' && ch <= '9') || \
-   (ch >= 'a' && ch <= 'f') || \
-   (ch >= 'A' && ch <= 'F'))
-
-#  define HEX_VALUE(ch, value) \
-  if (ch >= '0' && ch <= '9') \
-    { \
-      value = ch - '0'; \
-    } \
-  else if (ch >= 'a' && ch <= 'f') \
-    { \
-      value = ch - 'a' + 10; \
-    } \
-  else \
-    { \
-      value = ch - 'A' + 10; \
-    }
+#  define HEX_VALUE(ch)    ((ch) < 0x80 ? g_hexval[ch] : 0xff)
+#  define IS_PLAIN(ch)     ((ch) < 0x80 && \
+                            (g_plainchars[(ch) >> 3] & (1 << ((ch) & 7))))
+#endif
+
+/****************************************************************************
+ * Private Data
+ ****************************************************************************/
+
+#ifdef CONFIG_CODECS_URLCODE
+/* Value of the hex digits, 0xff for all other characters */
+
+static const unsigned char g_hexval[128] =
+{
+  0xff, 0xff, 0xff, 0xff, 0xff, 0xff, 0xff, 0xff, 0xff, 0xff, 0xff, 0xff,
+  0xff, 0xff, 0xff, 0xff, 0xff, 0xff, 0xff, 0xff, 0xff, 0xff, 0xff, 0xff,
+  0xff, 0xff, 0xff, 0xff, 0xff, 0xff, 0xff, 0xff, 0xff, 0xff, 0xff, 0xff,
+  0xff, 0xff, 0xff, 0xff, 0xff, 0xff, 0xff, 0xff, 0xff, 0xff, 0xff, 0xff,
+  0x00, 0x01, 0x02, 0x03, 0x04, 0x05, 0x06, 0x07, 0x08, 0x09, 0xff, 0xff,
+  0xff, 0xff, 0xff, 0xff, 0xff, 0x0a, 0x0b, 0x0c, 0x0d, 0x0e, 0x0f, 0xff,
+  0xff, 0xff, 0xff, 0xff, 0xff, 0xff, 0xff, 0xff, 0xff, 0xff, 0xff, 0xff,
+  0xff, 0xff, 0xff, 0xff, 0xff, 0xff, 0xff, 0xff, 0xff, 0xff, 0xff, 0xff,
+  0xff, 0x0a, 0x0b, 0x0c, 0x0d, 0x0e, 0x0f, 0xff, 0xff, 0xff, 0xff, 0xff,
+  0xff, 0xff, 0xff, 0xff, 0xff, 0xff, 0xff, 0xff, 0xff, 0xff, 0xff, 0xff,
+  0xff, 0xff, 0xff, 0xff, 0xff, 0xff, 0xff, 0xff
+};
+
+/* Characters that are not encoded: alphanumerics and "_-.~", one bit per
+ * character.
+ */
+
+static const unsigned char g_plainchars[16] =
+{
+  0x00, 0x00, 0x00, 0x00, 0x00, 0x60, 0xff, 0x03,
+  0xfe, 0xff, 0xff, 0x87, 0xfe, 0xff, 0xff, 0x47
+};
 #endif
 
 /****************************************************************************
@@ -256,10 +274,7 @@ char *urlencode(const char *src, const int src_len, char *dest, int *dest_len)
   pEnd = (unsigned char *)src + src_len;
   for (pSrc = (unsigned char *)src; pSrc < pEnd; pSrc++)
     {
-      if ((*pSrc >= '0' && *pSrc <= '9') ||
-          (*pSrc >= 'a' && *pSrc <= 'z') ||
-          (*pSrc >= 'A' && *pSrc <= 'Z') ||
-          (*pSrc == '_' || *pSrc == '-' || *pSrc == '.' || *pSrc == '~'))
+      if (IS_PLAIN(*pSrc))
         {
           *pDest++ = *pSrc;
         }
@@ -291,46 +306,44 @@ char *urldecode(const char *src, const int src_len, char *dest, int *dest_len)
   const unsigned char *pSrc;
   const unsigned char *pEnd;
   char *pDest;
-  unsigned char cHigh;
-  unsigned char cLow;
-  int valHigh;
-  int valLow;
+  unsigned char valHigh;
+  unsigned char valLow;
 
   pDest = dest;
   pSrc = (unsigned char *)src;
   pEnd = (unsigned char *)src + src_len;
   while (pSrc < pEnd)
     {
-      if (*pSrc == '%' && pSrc + 2 < pEnd)
-        {
-          cHigh = *(pSrc + 1);
-          cLow = *(pSrc + 2);
+      /* Copy the run up to the next escape */
 
-          if (IS_HEX_CHAR(cHigh) && IS_HEX_CHAR(cLow))
-            {
-              HEX_VALUE(cHigh, valHigh)
-              HEX_VALUE(cLow, valLow)
-              *pDest++ = (valHigh << 4) | valLow;
-              pSrc += 3;
-            }
-          else
+      while (*pSrc != '%' && *pSrc != '+')
+        {
+          *pDest++ = *pSrc++;
+          if (pSrc == pEnd)
             {
-              *pDest++ = *pSrc;
-              pSrc++;
+              goto done;
             }
         }
-      else if (*pSrc == '+')
+
+      if (*pSrc == '+')
         {
           *pDest++ = ' ';
           pSrc++;
         }
+      else if (pSrc + 2 < pEnd &&
+               (valHigh = HEX_VALUE(pSrc[1])) != 0xff &&
+               (valLow = HEX_VALUE(pSrc[2])) != 0xff)
+        {
+          *pDest++ = (valHigh << 4) | valLow;
+          pSrc += 3;
+        }
       else
         {
-          *pDest++ = *pSrc;
-          pSrc++;
+          *pDest++ = *pSrc++;
         }
     }
 
+done:
   *pDest = '\0';
   *dest_len = pDest - dest;
   return dest;
@@ -351,10 +364,7 @@ int urlencode_len(const char *src, const int src_len)
   pEnd = (unsigned char *)src + src_len;
   for (pSrc = (unsigned char *)src; pSrc < pEnd; pSrc++)
     {
-      if ((*pSrc >= '0' && *pSrc <= '9') ||
-          (*pSrc >= 'a' && *pSrc <= 'z') ||
-          (*pSrc >= 'A' && *pSrc <= 'Z') ||
-          (*pSrc == '_' || *pSrc == '-' || *pSrc == '.' || *pSrc == '~' || *pSrc == ' '))
+      if (IS_PLAIN(*pSrc) || *pSrc == ' ')
         {
           len++;
         }
@@ -378,22 +388,15 @@ int urldecode_len(const char *src, const int src_len)
   const unsigned char *pSrc;
   const unsigned char *pEnd;
   int len = 0;
-  unsigned char cHigh;
-  unsigned char cLow;
 
   pSrc = (unsigned char *)src;
   pEnd = (unsigned char *)src + src_len;
   while (pSrc < pEnd)
     {
-      if (*pSrc == '%' && pSrc + 2 < pEnd)
+      if (*pSrc == '%' && pSrc + 2 < pEnd &&
+          HEX_VALUE(pSrc[1]) != 0xff && HEX_VALUE(pSrc[2]) != 0xff)
         {
-          cHigh = *(pSrc + 1);
-          cLow = *(pSrc + 2);
-
-          if (IS_HEX_CHAR(cHigh) && IS_HEX_CHAR(cLow))
-            {
-              pSrc += 2;
-            }
+          pSrc += 2;
         }
 
       len++;
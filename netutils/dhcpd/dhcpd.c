@@ -34,7 +34,13 @@
 #  define FAR
 
 #  define nerr(...) printf(__VA_ARGS__)
-#  define ninfo(...) printf(__VA_ARGS__)
+#  ifdef CONFIG_DEBUG_NET_INFO
+#    define ninfo(...) printf(__VA_ARGS__)
+#  else
+#    define ninfo(...)
+#  endif
+
+#  define UNUSED(a) ((void)(a))
 
 #  define ERROR (-1)
 #  define OK    (0)
@@ -49,11 +55,16 @@
 #include <sys/ioctl.h>
 #include <sys/wait.h>
 
+#include <fcntl.h>
 #include <inttypes.h>
 #include <sched.h>
+#include <stddef.h>
 #include <stdint.h>
 #include <stdbool.h>
+#include <stdio.h>
+#include <stdlib.h>
 #include <string.h>
+#include <strings.h>
 #include <unistd.h>
 #include <time.h>
 #include <errno.h>
@@ -191,6 +202,32 @@
 #  define HAVE_LEASE_TIME 1
 #endif
 
+#ifndef CONFIG_NETUTILS_DHCPD_MAXPOOLS
+#  define CONFIG_NETUTILS_DHCPD_MAXPOOLS 1
+#endif
+
+#undef HAVE_LEASE_JOURNAL
+#if defined(CONFIG_NETUTILS_DHCPD_JOURNAL) && defined(HAVE_LEASE_TIME)
+#  define HAVE_LEASE_JOURNAL 1
+#  ifndef CONFIG_NETUTILS_DHCPD_LEASEFILE
+#    define CONFIG_NETUTILS_DHCPD_LEASEFILE "/data/dhcpd.leases"
+#  endif
+#  define DHCPD_LEASEFILE_TMP CONFIG_NETUTILS_DHCPD_LEASEFILE ".tmp"
+#endif
+
+/* Terminates the MAC hash chains of the lease table */
+
+#define DHCPD_NOLEASE             (-1)
+#define DHCPD_MINBUCKETS          16
+
+/* Netmask used to match relay agents to pools that have none */
+
+#define DHCPD_DEFAULT_NETMASK     0xffffff00
+
+/* Journal records are read and written this many at a time */
+
+#define DHCPD_JOURNAL_BATCH       16
+
 #define g_state  (*g_dhcpd_daemon.ds_data)
 
 /****************************************************************************
@@ -199,7 +236,8 @@
 
 /* This structure describes one element in the lease table. There is one
  * slot in the lease table for each assign-able IP address (hence, the IP
- * address itself does not have to be in the table.
+ * address itself does not have to be in the table.  Leases with a MAC
+ * address are also chained into a hash table by that address.
  */
 
 struct lease_s
@@ -208,9 +246,58 @@ struct lease_s
   bool     allocated;               /* true: IP address is allocated */
 #ifdef HAVE_LEASE_TIME
   time_t   expiry;                  /* Lease expiration time (seconds past Epoch) */
+#endif
+  int32_t  next;                    /* Next lease in the same hash bucket */
+};
+
+/* One range of addresses to lease.  The first pool serves the local
+ * subnet, the others serve requests forwarded by relay agents.
+ */
+
+struct dhcpd_pool_s
+{
+  in_addr_t ds_startip;
+  in_addr_t ds_endip;
+#ifdef HAVE_ROUTERIP
+  in_addr_t ds_routerip;
+#endif
+#ifdef HAVE_NETMASK
+  in_addr_t ds_netmask;
+#endif
+#ifdef HAVE_DNSIP
+  in_addr_t ds_dnsip;
 #endif
 };
 
+/* Run time state of a pool.  A set bit in ps_inuse marks an address that
+ * is allocated or reserved, so a free address is found a word at a time.
+ */
+
+struct dhcpd_poolstate_s
+{
+  FAR const struct dhcpd_pool_s *ps_config;
+  FAR struct lease_s *ps_leases;    /* One lease per address */
+  FAR uint32_t       *ps_inuse;     /* One bit per address */
+  uint32_t            ps_size;      /* Number of addresses */
+  uint32_t            ps_nfree;     /* Number of clear bits in ps_inuse */
+  uint32_t            ps_hint;      /* Word of ps_inuse to search first */
+};
+
+#ifdef HAVE_LEASE_JOURNAL
+/* One record of the lease journal, in host order.  A record with a zero
+ * expiry releases the address.
+ */
+
+struct dhcpd_record_s
+{
+  uint32_t ipaddr;                  /* Leased IP address */
+  uint32_t expiry;                  /* Seconds past Epoch */
+  uint8_t  mac[DHCP_HLEN_ETHERNET];
+  uint8_t  reserved[2];
+  uint32_t check;                   /* FNV-1a hash of the fields above */
+};
+#endif
+
 struct dhcpmsg_s
 {
   uint8_t  op;
@@ -267,7 +354,20 @@ struct dhcpd_state_s
 
   /* Leases */
 
-  struct lease_s   ds_leases[CONFIG_NETUTILS_DHCPD_MAXLEASES];
+  FAR struct lease_s *ds_leases;    /* Leases of all pools */
+  FAR int32_t      *ds_hash;        /* Hash buckets of leases by MAC */
+  FAR uint32_t     *ds_inuse;       /* In-use bits of all pools */
+  uint32_t          ds_nleases;     /* Number of leases */
+  uint32_t          ds_hashmask;    /* Number of hash buckets - 1 */
+
+  struct dhcpd_poolstate_s ds_pools[CONFIG_NETUTILS_DHCPD_MAXPOOLS];
+  int               ds_npools;
+  FAR struct dhcpd_poolstate_s *ds_pool; /* Pool of the current message */
+
+#ifdef HAVE_LEASE_JOURNAL
+  int               ds_journal;     /* Lease journal, opened for append */
+  uint32_t          ds_jrecords;    /* Records in the lease journal */
+#endif
 };
 
 /* This type describes the state of the DHCPD client daemon.  Only one
@@ -281,259 +381,1002 @@ struct dhcpd_daemon_s
   FAR struct dhcpd_state_s *ds_data;  /* DHCPD daemon data */
 };
 
-struct dhcpd_config_s
+struct dhcpd_config_s
+{
+  struct dhcpd_pool_s ds_pools[CONFIG_NETUTILS_DHCPD_MAXPOOLS];
+  int                 ds_npools;
+};
+
+/****************************************************************************
+ * Private Data
+ ****************************************************************************/
+
+static const uint8_t        g_magiccookie[4] =
+{
+  99, 130, 83, 99
+};
+
+/* This type describes the state of the DHCPD client daemon.  Only one
+ * instance of the DHCPD daemon is permitted in this implementation.  This
+ * limitation is due only to this global data structure.
+ */
+
+static struct dhcpd_daemon_s g_dhcpd_daemon =
+{
+  DHCPD_NOT_RUNNING,
+  -1,
+  NULL
+};
+
+static const uint8_t        g_nullmac[DHCP_HLEN_ETHERNET];
+
+static struct dhcpd_config_s g_dhcpd_config =
+{
+  {
+    {
+      CONFIG_NETUTILS_DHCPD_STARTIP,
+      CONFIG_NETUTILS_DHCP_OPTION_ENDIP,
+#ifdef HAVE_ROUTERIP
+      CONFIG_NETUTILS_DHCPD_ROUTERIP,
+#endif
+#ifdef HAVE_NETMASK
+      CONFIG_NETUTILS_DHCPD_NETMASK,
+#endif
+#ifdef HAVE_DNSIP
+      CONFIG_NETUTILS_DHCPD_DNSIP
+#endif
+    }
+  },
+  1
+};
+
+/****************************************************************************
+ * Private Functions
+ ****************************************************************************/
+
+/****************************************************************************
+ * Name: dhcpd_arpupdate
+ ****************************************************************************/
+
+#ifndef CONFIG_NETUTILS_DHCPD_IGNOREBROADCAST
+#  ifndef CONFIG_NETUTILS_DHCPD_HOST
+static inline void dhcpd_arpupdate(FAR uint8_t *ipaddr, FAR uint8_t *hwaddr)
+{
+  struct sockaddr_in inaddr;
+
+  /* Put the protocol address in a standard form. ipaddr is assumed to be in
+   * network order by the memcpy.
+   */
+
+  inaddr.sin_family = AF_INET;
+  inaddr.sin_port = 0;
+  memcpy(&inaddr.sin_addr.s_addr, ipaddr, sizeof(in_addr_t));
+
+  /* Update the ARP table */
+
+  netlib_set_arpmapping(&inaddr, hwaddr, NULL);
+}
+#  else
+#    define dhcpd_arpupdate(ipaddr,hwaddr)
+#  endif
+#endif
+
+/****************************************************************************
+ * Name: dhcpd_time
+ ****************************************************************************/
+
+#ifdef CONFIG_NETUTILS_DHCPD_HOST
+#  define dhcpd_time() time(0)
+#elif defined(HAVE_LEASE_TIME)
+static time_t dhcpd_time(void)
+{
+  struct timespec ts;
+  time_t ret = 0;
+
+  if (clock_gettime(CLOCK_REALTIME, &ts) == OK)
+    {
+      ret = ts.tv_sec;
+    }
+
+  return ret;
+}
+#else
+#  define dhcpd_time() (0)
+#endif
+
+/****************************************************************************
+ * Name: dhcpd_hasmac
+ ****************************************************************************/
+
+static inline bool dhcpd_hasmac(FAR const uint8_t *mac)
+{
+  return memcmp(mac, g_nullmac, DHCP_HLEN_ETHERNET) != 0;
+}
+
+/****************************************************************************
+ * Name: dhcpd_machash
+ ****************************************************************************/
+
+static inline uint32_t dhcpd_machash(FAR const uint8_t *mac)
+{
+  uint32_t hash;
+
+  /* Most of the entropy is in the device part of the address, fold the
+   * vendor part in and mix the bits with a multiplicative hash.
+   */
+
+  hash = ((uint32_t)mac[2] << 24 | (uint32_t)mac[3] << 16 |
+          (uint32_t)mac[4] << 8 | mac[5]) ^
+         ((uint32_t)mac[0] << 13 | (uint32_t)mac[1] << 5);
+
+  return ((hash * 2654435761u) >> 8) & g_state.ds_hashmask;
+}
+
+/****************************************************************************
+ * Name: dhcpd_hashlease
+ *
+ * Description:
+ *   Give the lease a new MAC address and chain it into the hash table.
+ *   Leases without a MAC address are not hashed.
+ *
+ ****************************************************************************/
+
+static void dhcpd_hashlease(FAR struct lease_s *lease,
+                            FAR const uint8_t *mac)
+{
+  uint32_t bucket;
+
+  memcpy(lease->mac, mac, DHCP_HLEN_ETHERNET);
+  if (dhcpd_hasmac(mac))
+    {
+      bucket = dhcpd_machash(mac);
+      lease->next = g_state.ds_hash[bucket];
+      g_state.ds_hash[bucket] = lease - g_state.ds_leases;
+    }
+}
+
+/****************************************************************************
+ * Name: dhcpd_unhashlease
+ *
+ * Description:
+ *   Remove the lease from the hash table and clear its MAC address.
+ *
+ ****************************************************************************/
+
+static void dhcpd_unhashlease(FAR struct lease_s *lease)
+{
+  FAR int32_t *link;
+  int32_t ndx;
+
+  if (!dhcpd_hasmac(lease->mac))
+    {
+      return;
+    }
+
+  ndx  = lease - g_state.ds_leases;
+  link = &g_state.ds_hash[dhcpd_machash(lease->mac)];
+  while (*link != DHCPD_NOLEASE)
+    {
+      if (*link == ndx)
+        {
+          *link = lease->next;
+          break;
+        }
+
+      link = &g_state.ds_leases[*link].next;
+    }
+
+  memset(lease->mac, 0, DHCP_HLEN_ETHERNET);
+}
+
+/****************************************************************************
+ * Name: dhcpd_poolbyipaddr
+ ****************************************************************************/
+
+static FAR struct dhcpd_poolstate_s *dhcpd_poolbyipaddr(in_addr_t ipaddr)
+{
+  FAR struct dhcpd_poolstate_s *pool;
+  int i;
+
+  for (i = 0; i < g_state.ds_npools; i++)
+    {
+      pool = &g_state.ds_pools[i];
+      if (ipaddr >= pool->ps_config->ds_startip &&
+          ipaddr <= pool->ps_config->ds_endip)
+        {
+          return pool;
+        }
+    }
+
+  return NULL;
+}
+
+/****************************************************************************
+ * Name: dhcpd_poolbylease
+ ****************************************************************************/
+
+static FAR struct dhcpd_poolstate_s *
+dhcpd_poolbylease(FAR struct lease_s *lease)
+{
+  FAR struct dhcpd_poolstate_s *pool;
+  int i;
+
+  for (i = 0; i < g_state.ds_npools; i++)
+    {
+      pool = &g_state.ds_pools[i];
+      if (lease >= pool->ps_leases &&
+          lease < pool->ps_leases + pool->ps_size)
+        {
+          return pool;
+        }
+    }
+
+  return NULL;
+}
+
+/****************************************************************************
+ * Name: dhcpd_reserved
+ ****************************************************************************/
+
+static inline bool dhcpd_reserved(in_addr_t ipaddr)
+{
+  /* Addresses ending in 0 or 255 are never allocated */
+
+  return (ipaddr & 0xff) == 0 || (ipaddr & 0xff) == 0xff;
+}
+
+/****************************************************************************
+ * Name: dhcpd_markused
+ ****************************************************************************/
+
+static void dhcpd_markused(FAR struct dhcpd_poolstate_s *pool, uint32_t ndx)
+{
+  uint32_t bit = UINT32_C(1) << (ndx & 31);
+
+  if ((pool->ps_inuse[ndx >> 5] & bit) == 0)
+    {
+      pool->ps_inuse[ndx >> 5] |= bit;
+      pool->ps_nfree--;
+    }
+}
+
+/****************************************************************************
+ * Name: dhcpd_markfree
+ ****************************************************************************/
+
+static void dhcpd_markfree(FAR struct dhcpd_poolstate_s *pool, uint32_t ndx)
+{
+  uint32_t bit = UINT32_C(1) << (ndx & 31);
+
+  if ((pool->ps_inuse[ndx >> 5] & bit) != 0 &&
+      !dhcpd_reserved(pool->ps_config->ds_startip + ndx))
+    {
+      pool->ps_inuse[ndx >> 5] &= ~bit;
+      pool->ps_nfree++;
+    }
+}
+
+/****************************************************************************
+ * Name: dhcpd_freelease
+ ****************************************************************************/
+
+static void dhcpd_freelease(FAR struct lease_s *lease)
+{
+  FAR struct dhcpd_poolstate_s *pool = dhcpd_poolbylease(lease);
+
+  dhcpd_unhashlease(lease);
+  lease->allocated = false;
+#ifdef HAVE_LEASE_TIME
+  lease->expiry    = 0;
+#endif
+
+  if (pool != NULL)
+    {
+      dhcpd_markfree(pool, lease - pool->ps_leases);
+    }
+}
+
+/****************************************************************************
+ * Name: dhcpd_leaseexpired
+ ****************************************************************************/
+
+#ifdef HAVE_LEASE_TIME
+static inline bool dhcpd_leaseexpired(struct lease_s *lease)
+{
+  if (lease->expiry > dhcpd_time())
+    {
+      return false;
+    }
+  else
+    {
+      dhcpd_freelease(lease);
+      return true;
+    }
+}
+#else
+#  define dhcpd_leaseexpired(lease) (false)
+#endif
+
+/****************************************************************************
+ * Name: dhcpd_findbymac
+ ****************************************************************************/
+
+static FAR struct lease_s *dhcpd_findbymac(FAR const uint8_t *mac)
+{
+  FAR struct lease_s *lease;
+  int32_t ndx;
+
+  ndx = g_state.ds_hash[dhcpd_machash(mac)];
+  while (ndx != DHCPD_NOLEASE)
+    {
+      lease = &g_state.ds_leases[ndx];
+      if (memcmp(lease->mac, mac, DHCP_HLEN_ETHERNET) == 0)
+        {
+          return lease;
+        }
+
+      ndx = lease->next;
+    }
+
+  return NULL;
+}
+
+/****************************************************************************
+ * Name: dhcpd_bindlease
+ *
+ * Description:
+ *   Allocate the lease to mac until expiry (seconds past Epoch).
+ *
+ ****************************************************************************/
+
+static void dhcpd_bindlease(FAR struct dhcpd_poolstate_s *pool,
+                            FAR struct lease_s *lease,
+                            FAR const uint8_t *mac, time_t expiry)
+{
+  FAR struct lease_s *other;
+
+  /* A client holds one address, drop any other lease it had */
+
+  other = dhcpd_hasmac(mac) ? dhcpd_findbymac(mac) : NULL;
+  if (other != lease)
+    {
+      if (other != NULL)
+        {
+          dhcpd_freelease(other);
+        }
+
+      dhcpd_unhashlease(lease);
+      dhcpd_hashlease(lease, mac);
+    }
+
+  lease->allocated = true;
+#ifdef HAVE_LEASE_TIME
+  lease->expiry    = expiry;
+#else
+  UNUSED(expiry);
+#endif
+
+  dhcpd_markused(pool, lease - pool->ps_leases);
+}
+
+/****************************************************************************
+ * Name: dhcpd_setlease
+ ****************************************************************************/
+
+struct lease_s *dhcpd_setlease(const uint8_t *mac,
+                               in_addr_t ipaddr, time_t expiry)
+{
+  FAR struct dhcpd_poolstate_s *pool;
+  struct lease_s *ret = NULL;
+
+  /* Find the pool of the address.  ipaddr must be in host order! */
+
+  pool = dhcpd_poolbyipaddr(ipaddr);
+
+  ninfo("ipaddr: %08" PRIx32 " pool: %d\n", (uint32_t)ipaddr,
+        pool != NULL ? (int)(pool - g_state.ds_pools) : -1);
+
+  if (pool != NULL)
+    {
+      ret = &pool->ps_leases[ipaddr - pool->ps_config->ds_startip];
+      dhcpd_bindlease(pool, ret, mac, dhcpd_time() + expiry);
+    }
+
+  return ret;
+}
+
+/****************************************************************************
+ * Name: dhcp_leaseipaddr
+ ****************************************************************************/
+
+static inline in_addr_t dhcp_leaseipaddr(FAR struct lease_s *lease)
+{
+  FAR struct dhcpd_poolstate_s *pool = dhcpd_poolbylease(lease);
+
+  /* Return IP address in host order */
+
+  return (in_addr_t)(lease - pool->ps_leases) +
+         pool->ps_config->ds_startip;
+}
+
+/****************************************************************************
+ * Name: dhcpd_findclient
+ *
+ * Description:
+ *   Find the lease of the client that sent the current message in the pool
+ *   serving it.  A lease in another pool is no use on the client's current
+ *   subnet.
+ *
+ ****************************************************************************/
+
+static FAR struct lease_s *dhcpd_findclient(void)
+{
+  FAR struct lease_s *lease;
+
+  lease = dhcpd_findbymac(g_state.ds_inpacket.chaddr);
+  if (lease != NULL && dhcpd_poolbylease(lease) != g_state.ds_pool)
+    {
+      return NULL;
+    }
+
+  return lease;
+}
+
+/****************************************************************************
+ * Name: dhcpd_findbyipaddr
+ ****************************************************************************/
+
+static FAR struct lease_s *dhcpd_findbyipaddr(in_addr_t ipaddr)
+{
+  FAR struct dhcpd_poolstate_s *pool = dhcpd_poolbyipaddr(ipaddr);
+
+  if (pool != NULL)
+    {
+      FAR struct lease_s *lease =
+        &pool->ps_leases[ipaddr - pool->ps_config->ds_startip];
+      if (lease->allocated > 0)
+        {
+          return lease;
+        }
+    }
+
+  return NULL;
+}
+
+/****************************************************************************
+ * Name: dhcpd_findfree
+ *
+ * Description:
+ *   Return the index of a free address in the pool, or -1 if there is
+ *   none.  The search resumes at the word where the last one ended.
+ *
+ ****************************************************************************/
+
+static int dhcpd_findfree(FAR struct dhcpd_poolstate_s *pool)
+{
+  uint32_t nwords = (pool->ps_size + 31) >> 5;
+  uint32_t word = pool->ps_hint;
+  uint32_t bits;
+  uint32_t i;
+
+  if (pool->ps_nfree == 0)
+    {
+      return -1;
+    }
+
+  for (i = 0; i < nwords; i++)
+    {
+      bits = ~pool->ps_inuse[word];
+      if (bits != 0)
+        {
+          pool->ps_hint = word;
+          return (word << 5) + ffs(bits) - 1;
+        }
+
+      if (++word >= nwords)
+        {
+          word = 0;
+        }
+    }
+
+  return -1;
+}
+
+/****************************************************************************
+ * Name: dhcpd_reclaim
+ *
+ * Description:
+ *   Free the expired leases of a pool.  Expired leases are otherwise only
+ *   freed when they are looked up, so this is done when the pool runs out
+ *   of free addresses.
+ *
+ ****************************************************************************/
+
+#ifdef HAVE_LEASE_TIME
+static uint32_t dhcpd_reclaim(FAR struct dhcpd_poolstate_s *pool)
+{
+  FAR struct lease_s *lease;
+  time_t now = dhcpd_time();
+  uint32_t nfreed = 0;
+  uint32_t i;
+
+  for (i = 0; i < pool->ps_size; i++)
+    {
+      lease = &pool->ps_leases[i];
+      if (lease->allocated && lease->expiry <= now)
+        {
+          dhcpd_freelease(lease);
+          nfreed++;
+        }
+    }
+
+  return nfreed;
+}
+#else
+#  define dhcpd_reclaim(pool) (0)
+#endif
+
+/****************************************************************************
+ * Name: dhcpd_allocipaddr
+ ****************************************************************************/
+
+static in_addr_t dhcpd_allocipaddr(void)
+{
+  FAR struct dhcpd_poolstate_s *pool = g_state.ds_pool;
+  FAR struct lease_s *lease;
+  int ndx;
+
+  ndx = dhcpd_findfree(pool);
+  if (ndx < 0 && dhcpd_reclaim(pool) > 0)
+    {
+      ndx = dhcpd_findfree(pool);
+    }
+
+  if (ndx < 0)
+    {
+      return 0;
+    }
+
+#ifdef CONFIG_CPP_HAVE_WARNING
+#  warning "FIXME: Should check if anything responds to an ARP request or ping"
+#  warning "       to verify that there is no other user of this IP address"
+#endif
+
+  lease = &pool->ps_leases[ndx];
+  dhcpd_unhashlease(lease);
+  lease->allocated = true;
+#ifdef HAVE_LEASE_TIME
+  lease->expiry    = dhcpd_time() + CONFIG_NETUTILS_DHCPD_OFFERTIME;
+#endif
+  dhcpd_markused(pool, ndx);
+
+  /* Return the address in host order */
+
+  return pool->ps_config->ds_startip + ndx;
+}
+
+/****************************************************************************
+ * Name: dhcpd_initleases
+ *
+ * Description:
+ *   Allocate the lease table, the MAC hash table and the in-use bits of
+ *   all configured pools.
+ *
+ ****************************************************************************/
+
+static int dhcpd_initleases(void)
+{
+  FAR struct dhcpd_poolstate_s *pool;
+  FAR struct lease_s *lease;
+  FAR uint32_t *inuse;
+  uint32_t nbuckets;
+  uint32_t nwords = 0;
+  uint32_t i;
+  int p;
+
+  g_state.ds_npools  = g_dhcpd_config.ds_npools;
+  g_state.ds_nleases = 0;
+
+  for (p = 0; p < g_state.ds_npools; p++)
+    {
+      pool = &g_state.ds_pools[p];
+      pool->ps_config = &g_dhcpd_config.ds_pools[p];
+      pool->ps_size   = pool->ps_config->ds_endip -
+                        pool->ps_config->ds_startip + 1;
+
+      g_state.ds_nleases += pool->ps_size;
+      nwords += (pool->ps_size + 31) >> 5;
+    }
+
+  for (nbuckets = DHCPD_MINBUCKETS; nbuckets < g_state.ds_nleases; )
+    {
+      nbuckets <<= 1;
+    }
+
+  g_state.ds_leases = calloc(g_state.ds_nleases, sizeof(struct lease_s));
+  g_state.ds_hash   = malloc(nbuckets * sizeof(int32_t));
+  g_state.ds_inuse  = calloc(nwords, sizeof(uint32_t));
+  if (g_state.ds_leases == NULL || g_state.ds_hash == NULL ||
+      g_state.ds_inuse == NULL)
+    {
+      free(g_state.ds_leases);
+      free(g_state.ds_hash);
+      free(g_state.ds_inuse);
+      return -ENOMEM;
+    }
+
+  g_state.ds_hashmask = nbuckets - 1;
+  for (i = 0; i < nbuckets; i++)
+    {
+      g_state.ds_hash[i] = DHCPD_NOLEASE;
+    }
+
+  lease = g_state.ds_leases;
+  inuse = g_state.ds_inuse;
+
+  for (p = 0; p < g_state.ds_npools; p++)
+    {
+      pool = &g_state.ds_pools[p];
+      pool->ps_leases = lease;
+      pool->ps_inuse  = inuse;
+      pool->ps_nfree  = pool->ps_size;
+      pool->ps_hint   = 0;
+
+      lease += pool->ps_size;
+      inuse += (pool->ps_size + 31) >> 5;
+
+      /* Reserve the addresses that are never allocated and the unused
+       * bits of the last word.
+       */
+
+      for (i = 0; i < pool->ps_size; i++)
+        {
+          if (dhcpd_reserved(pool->ps_config->ds_startip + i))
+            {
+              dhcpd_markused(pool, i);
+            }
+        }
+
+      for (; (i & 31) != 0; i++)
+        {
+          pool->ps_inuse[i >> 5] |= UINT32_C(1) << (i & 31);
+        }
+    }
+
+  g_state.ds_pool = &g_state.ds_pools[0];
+  return OK;
+}
+
+/****************************************************************************
+ * Name: dhcpd_freeleases
+ ****************************************************************************/
+
+static void dhcpd_freeleases(void)
 {
-  in_addr_t ds_startip;
-  in_addr_t ds_endip;
-#ifdef HAVE_ROUTERIP
-  in_addr_t ds_routerip;
-#endif
-#ifdef HAVE_NETMASK
-  in_addr_t ds_netmask;
-#endif
-#ifdef HAVE_DNSIP
-  in_addr_t ds_dnsip;
-#endif
-};
+  free(g_state.ds_leases);
+  free(g_state.ds_hash);
+  free(g_state.ds_inuse);
+}
 
 /****************************************************************************
- * Private Data
+ * Name: dhcpd_selectpool
+ *
+ * Description:
+ *   Select the pool serving the current message: the pool on the subnet of
+ *   the relay agent for relayed messages, the default pool otherwise.
+ *
  ****************************************************************************/
 
-static const uint8_t        g_magiccookie[4] =
+static void dhcpd_selectpool(void)
 {
-  99, 130, 83, 99
-};
+  FAR const struct dhcpd_pool_s *config;
+  in_addr_t giaddr;
+  in_addr_t netmask;
+  int i;
 
-/* This type describes the state of the DHCPD client daemon.  Only one
- * instance of the DHCPD daemon is permitted in this implementation.  This
- * limitation is due only to this global data structure.
- */
+  g_state.ds_pool = &g_state.ds_pools[0];
 
-static struct dhcpd_daemon_s g_dhcpd_daemon =
-{
-  DHCPD_NOT_RUNNING,
-  -1,
-  NULL
-};
+  memcpy(&giaddr, g_state.ds_inpacket.giaddr, 4);
+  giaddr = ntohl(giaddr);
+  if (giaddr == 0)
+    {
+      return;
+    }
 
-static struct dhcpd_config_s g_dhcpd_config =
-{
-  CONFIG_NETUTILS_DHCPD_STARTIP,
-  CONFIG_NETUTILS_DHCP_OPTION_ENDIP,
-#ifdef HAVE_ROUTERIP
-  CONFIG_NETUTILS_DHCPD_ROUTERIP,
-#endif
+  for (i = 0; i < g_state.ds_npools; i++)
+    {
+      config  = g_state.ds_pools[i].ps_config;
 #ifdef HAVE_NETMASK
-  CONFIG_NETUTILS_DHCPD_NETMASK,
-#endif
-#ifdef HAVE_DNSIP
-  CONFIG_NETUTILS_DHCPD_DNSIP
+      netmask = config->ds_netmask ? config->ds_netmask :
+                                     DHCPD_DEFAULT_NETMASK;
+#else
+      netmask = DHCPD_DEFAULT_NETMASK;
 #endif
-};
 
-/****************************************************************************
- * Private Functions
- ****************************************************************************/
+      if ((giaddr & netmask) == (config->ds_startip & netmask))
+        {
+          g_state.ds_pool = &g_state.ds_pools[i];
+          return;
+        }
+    }
+}
 
+#ifdef HAVE_LEASE_JOURNAL
 /****************************************************************************
- * Name: dhcpd_arpupdate
+ * Name: dhcpd_journal_check
  ****************************************************************************/
 
-#ifndef CONFIG_NETUTILS_DHCPD_IGNOREBROADCAST
-#  ifndef CONFIG_NETUTILS_DHCPD_HOST
-static inline void dhcpd_arpupdate(FAR uint8_t *ipaddr, FAR uint8_t *hwaddr)
+static uint32_t dhcpd_journal_check(FAR const struct dhcpd_record_s *rec)
 {
-  struct sockaddr_in inaddr;
+  FAR const uint8_t *ptr = (FAR const uint8_t *)rec;
+  uint32_t hash = 2166136261u;
+  size_t i;
 
-  /* Put the protocol address in a standard form. ipaddr is assumed to be in
-   * network order by the memcpy.
-   */
+  for (i = 0; i < offsetof(struct dhcpd_record_s, check); i++)
+    {
+      hash = (hash ^ ptr[i]) * 16777619u;
+    }
 
-  inaddr.sin_family = AF_INET;
-  inaddr.sin_port = 0;
-  memcpy(&inaddr.sin_addr.s_addr, ipaddr, sizeof(in_addr_t));
+  return hash;
+}
 
-  /* Update the ARP table */
+/****************************************************************************
+ * Name: dhcpd_journal_record
+ ****************************************************************************/
 
-  netlib_set_arpmapping(&inaddr, hwaddr, NULL);
+static void dhcpd_journal_record(FAR struct dhcpd_record_s *rec,
+                                 in_addr_t ipaddr, FAR const uint8_t *mac,
+                                 time_t expiry)
+{
+  memset(rec, 0, sizeof(struct dhcpd_record_s));
+  rec->ipaddr = ipaddr;
+  rec->expiry = (uint32_t)expiry;
+  memcpy(rec->mac, mac, DHCP_HLEN_ETHERNET);
+  rec->check  = dhcpd_journal_check(rec);
 }
-#  else
-#    define dhcpd_arpupdate(ipaddr,hwaddr)
-#  endif
-#endif
 
 /****************************************************************************
- * Name: dhcpd_time
+ * Name: dhcpd_journal_write
  ****************************************************************************/
 
-#ifdef CONFIG_NETUTILS_DHCPD_HOST
-#  define dhcpd_time() time(0)
-#elif defined(HAVE_LEASE_TIME)
-static time_t dhcpd_time(void)
+static int dhcpd_journal_write(int fd, FAR const struct dhcpd_record_s *rec,
+                               int nrecs)
 {
-  struct timespec ts;
-  time_t ret = 0;
+  ssize_t len = nrecs * sizeof(struct dhcpd_record_s);
+  ssize_t nwritten;
 
-  if (clock_gettime(CLOCK_REALTIME, &ts) == OK)
+  nwritten = write(fd, rec, len);
+  if (nwritten != len)
     {
-      ret = ts.tv_sec;
+      return nwritten < 0 ? -errno : -ENOSPC;
     }
 
-  return ret;
+  return OK;
 }
-#else
-#  define dhcpd_time() (0)
-#endif
 
 /****************************************************************************
- * Name: dhcpd_leaseexpired
+ * Name: dhcpd_journal_compact
+ *
+ * Description:
+ *   Replace the journal with a snapshot of the live leases and reopen it
+ *   for appending.  The snapshot is written to a temporary file and
+ *   renamed, so a power loss leaves either the old or the new journal.
+ *
  ****************************************************************************/
 
-#ifdef HAVE_LEASE_TIME
-static inline bool dhcpd_leaseexpired(struct lease_s *lease)
+static int dhcpd_journal_compact(void)
 {
-  if (lease->expiry > dhcpd_time())
+  struct dhcpd_record_s rec[DHCPD_JOURNAL_BATCH];
+  FAR struct lease_s *lease;
+  time_t now = dhcpd_time();
+  uint32_t nrecs = 0;
+  uint32_t i;
+  int n = 0;
+  int ret = OK;
+  int fd;
+
+  if (g_state.ds_journal >= 0)
     {
-      return false;
+      close(g_state.ds_journal);
+      g_state.ds_journal = -1;
     }
-  else
+
+  fd = open(DHCPD_LEASEFILE_TMP, O_WRONLY | O_CREAT | O_TRUNC | O_CLOEXEC,
+            0644);
+  if (fd < 0)
     {
-      memset(lease, 0, sizeof(struct lease_s));
-      return true;
+      ret = -errno;
+      nerr("ERROR: Failed to create %s: %d\n", DHCPD_LEASEFILE_TMP, ret);
+      return ret;
     }
-}
-#else
-#  define dhcpd_leaseexpired(lease) (false)
-#endif
 
-/****************************************************************************
- * Name: dhcpd_setlease
- ****************************************************************************/
+  for (i = 0; i < g_state.ds_nleases && ret >= 0; i++)
+    {
+      lease = &g_state.ds_leases[i];
+      if (!lease->allocated || !dhcpd_hasmac(lease->mac) ||
+          lease->expiry <= now)
+        {
+          continue;
+        }
 
-struct lease_s *dhcpd_setlease(const uint8_t *mac,
-                               in_addr_t ipaddr, time_t expiry)
-{
-  /* Calculate the offset from the first IP address managed by DHCPD.
-   * ipaddr must be in host order!
-   */
+      dhcpd_journal_record(&rec[n++], dhcp_leaseipaddr(lease), lease->mac,
+                           lease->expiry);
+      if (n == DHCPD_JOURNAL_BATCH)
+        {
+          ret    = dhcpd_journal_write(fd, rec, n);
+          nrecs += n;
+          n      = 0;
+        }
+    }
 
-  int ndx = ipaddr - g_dhcpd_config.ds_startip;
-  struct lease_s *ret = NULL;
+  if (ret >= 0 && n > 0)
+    {
+      ret    = dhcpd_journal_write(fd, rec, n);
+      nrecs += n;
+    }
 
-  ninfo("ipaddr: %08" PRIx32 " ipaddr: %08" PRIx32 " ndx: %d MAX: %d\n",
-        (uint32_t)ipaddr, (uint32_t)g_dhcpd_config.ds_startip, ndx,
-        CONFIG_NETUTILS_DHCPD_MAXLEASES);
+  if (ret >= 0 && fsync(fd) < 0)
+    {
+      ret = -errno;
+    }
 
-  /* Verify that the address offset is within the supported range */
+  close(fd);
 
-  if (ndx >= 0 && ndx < CONFIG_NETUTILS_DHCPD_MAXLEASES)
+  if (ret >= 0 && rename(DHCPD_LEASEFILE_TMP,
+                         CONFIG_NETUTILS_DHCPD_LEASEFILE) < 0)
     {
-       ret = &g_state.ds_leases[ndx];
-       memcpy(ret->mac, mac, DHCP_HLEN_ETHERNET);
-       ret->allocated = true;
-#ifdef HAVE_LEASE_TIME
-       ret->expiry = dhcpd_time() + expiry;
-#endif
+      ret = -errno;
     }
 
-  return ret;
+  if (ret < 0)
+    {
+      nerr("ERROR: Failed to write %s: %d\n", DHCPD_LEASEFILE_TMP, ret);
+      unlink(DHCPD_LEASEFILE_TMP);
+      return ret;
+    }
+
+  g_state.ds_journal = open(CONFIG_NETUTILS_DHCPD_LEASEFILE,
+                            O_WRONLY | O_APPEND | O_CLOEXEC);
+  if (g_state.ds_journal < 0)
+    {
+      ret = -errno;
+      nerr("ERROR: Failed to open %s: %d\n",
+           CONFIG_NETUTILS_DHCPD_LEASEFILE, ret);
+      return ret;
+    }
+
+  g_state.ds_jrecords = nrecs;
+  ninfo("Lease journal compacted to %" PRIu32 " records\n", nrecs);
+  return OK;
 }
 
 /****************************************************************************
- * Name: dhcp_leaseipaddr
+ * Name: dhcpd_journal_apply
  ****************************************************************************/
 
-static inline in_addr_t dhcp_leaseipaddr(FAR struct lease_s *lease)
+static void dhcpd_journal_apply(FAR const struct dhcpd_record_s *rec,
+                                time_t now)
 {
-  /* Return IP address in host order */
+  FAR struct dhcpd_poolstate_s *pool;
+  FAR struct lease_s *lease;
+
+  /* Addresses no longer in any pool are forgotten */
+
+  pool = dhcpd_poolbyipaddr(rec->ipaddr);
+  if (pool == NULL)
+    {
+      return;
+    }
 
-  return (in_addr_t)(lease - g_state.ds_leases) +
-         g_dhcpd_config.ds_startip;
+  lease = &pool->ps_leases[rec->ipaddr - pool->ps_config->ds_startip];
+  if ((time_t)rec->expiry > now)
+    {
+      dhcpd_bindlease(pool, lease, rec->mac, rec->expiry);
+    }
+  else if (lease->allocated &&
+           memcmp(lease->mac, rec->mac, DHCP_HLEN_ETHERNET) == 0)
+    {
+      dhcpd_freelease(lease);
+    }
 }
 
 /****************************************************************************
- * Name: dhcpd_findbymac
+ * Name: dhcpd_journal_open
+ *
+ * Description:
+ *   Restore the lease table from the journal, later records overriding
+ *   earlier ones, then compact it.  Replay stops at the first damaged
+ *   record, which can only be the last one written before a power loss.
+ *
  ****************************************************************************/
 
-static FAR struct lease_s *dhcpd_findbymac(FAR const uint8_t *mac)
+static int dhcpd_journal_open(void)
 {
+  struct dhcpd_record_s rec[DHCPD_JOURNAL_BATCH];
+  time_t now = dhcpd_time();
+  uint32_t nrecs = 0;
+  ssize_t nbytes;
+  int fd;
+  int n;
   int i;
 
-  for (i = 0; i < CONFIG_NETUTILS_DHCPD_MAXLEASES; i++)
+  g_state.ds_journal = -1;
+
+  fd = open(CONFIG_NETUTILS_DHCPD_LEASEFILE, O_RDONLY | O_CLOEXEC);
+  if (fd >= 0)
     {
-      if (memcmp(g_state.ds_leases[i].mac, mac, DHCP_HLEN_ETHERNET) == 0)
+      while ((nbytes = read(fd, rec, sizeof(rec))) > 0)
         {
-          return &(g_state.ds_leases[i]);
+          n = nbytes / sizeof(struct dhcpd_record_s);
+          for (i = 0; i < n; i++)
+            {
+              if (rec[i].check != dhcpd_journal_check(&rec[i]))
+                {
+                  break;
+                }
+
+              dhcpd_journal_apply(&rec[i], now);
+            }
+
+          nrecs += i;
+          if (i < n || nbytes % sizeof(struct dhcpd_record_s) != 0)
+            {
+              nerr("ERROR: %s damaged after %" PRIu32 " records\n",
+                   CONFIG_NETUTILS_DHCPD_LEASEFILE, nrecs);
+              break;
+            }
         }
+
+      close(fd);
+      ninfo("Replayed %" PRIu32 " lease records\n", nrecs);
     }
 
-  return NULL;
+  return dhcpd_journal_compact();
 }
 
 /****************************************************************************
- * Name: dhcpd_findbyipaddr
+ * Name: dhcpd_journal_append
  ****************************************************************************/
 
-static FAR struct lease_s *dhcpd_findbyipaddr(in_addr_t ipaddr)
+static void dhcpd_journal_append(in_addr_t ipaddr, FAR const uint8_t *mac,
+                                 time_t expiry)
 {
-  if (ipaddr >= g_dhcpd_config.ds_startip &&
-      ipaddr <= g_dhcpd_config.ds_endip)
+  struct dhcpd_record_s rec;
+
+  if (g_state.ds_journal < 0)
     {
-      FAR struct lease_s *lease =
-        &g_state.ds_leases[ipaddr - g_dhcpd_config.ds_startip];
-      if (lease->allocated > 0)
-        {
-          return lease;
-        }
+      return;
     }
 
-  return NULL;
+  /* Start over from a snapshot when the journal gets long, or when a
+   * write failed and may have left a partial record behind.
+   */
+
+  dhcpd_journal_record(&rec, ipaddr, mac, expiry);
+  if (dhcpd_journal_write(g_state.ds_journal, &rec, 1) < 0 ||
+      ++g_state.ds_jrecords > 2 * g_state.ds_nleases + DHCPD_JOURNAL_BATCH)
+    {
+      dhcpd_journal_compact();
+    }
 }
 
 /****************************************************************************
- * Name: dhcpd_allocipaddr
+ * Name: dhcpd_journal_close
  ****************************************************************************/
 
-static in_addr_t dhcpd_allocipaddr(void)
+static void dhcpd_journal_close(void)
 {
-  struct lease_s *lease = NULL;
-  in_addr_t ipaddr, startaddr;
-
-  ipaddr = startaddr = g_dhcpd_config.ds_startip;
-  for (; ipaddr <= g_dhcpd_config.ds_endip; ipaddr++)
+  if (g_state.ds_journal >= 0)
     {
-      /* Skip over address ending in 0 or 255 */
-
-      if ((ipaddr & 0xff) == 0 || (ipaddr & 0xff) == 0xff)
-        {
-          continue;
-        }
-
-      /* Is there already a lease on this address?  If so, has it expired? */
-
-      lease = dhcpd_findbyipaddr(ipaddr);
-      if ((!lease || dhcpd_leaseexpired(lease)))
-        {
-#ifdef CONFIG_CPP_HAVE_WARNING
-#  warning "FIXME: Should check if anything responds to an ARP request or ping"
-#  warning "       to verify that there is no other user of this IP address"
-#endif
-          memset(g_state.ds_leases[ipaddr - startaddr].mac,
-          0, DHCP_HLEN_ETHERNET);
-          g_state.ds_leases[ipaddr - startaddr].allocated = true;
-#ifdef HAVE_LEASE_TIME
-          g_state.ds_leases[ipaddr - startaddr].expiry =
-            dhcpd_time() + CONFIG_NETUTILS_DHCPD_OFFERTIME;
-#endif
-          /* Return the address in host order */
-
-          return ipaddr;
-        }
+      close(g_state.ds_journal);
+      g_state.ds_journal = -1;
     }
-
-  return 0;
 }
+#else
+#  define dhcpd_journal_open()                  (OK)
+#  define dhcpd_journal_append(ipaddr, mac, expiry)
+#  define dhcpd_journal_close()
+#endif
 
 /****************************************************************************
  * Name: dhcpd_parseoptions
@@ -712,8 +1555,8 @@ static inline bool dhcpd_verifyreqip(void)
    * range
    */
 
-  if (g_state.ds_optreqip >= g_dhcpd_config.ds_startip &&
-      g_state.ds_optreqip <= g_dhcpd_config.ds_endip)
+  if (g_state.ds_optreqip >= g_state.ds_pool->ps_config->ds_startip &&
+      g_state.ds_optreqip <= g_state.ds_pool->ps_config->ds_endip)
     {
       /* And verify that the lease has not already been taken or offered
        * (unless the lease/offer is expired, then the address is free game).
@@ -935,6 +1778,7 @@ static void dhcpd_initpacket(uint8_t mtype)
 
   memcpy(&g_state.ds_outpacket.xid, &g_state.ds_inpacket.xid, 4);
   memcpy(g_state.ds_outpacket.chaddr, g_state.ds_inpacket.chaddr, 16);
+  memcpy(g_state.ds_outpacket.giaddr, g_state.ds_inpacket.giaddr, 4);
 
   if (memcmp(g_state.ds_outpacket.giaddr, &nulladdr, 4) != 0)
     {
@@ -958,6 +1802,8 @@ static int dhcpd_sendpacket(int sockfd, int bbroadcast)
 {
   struct sockaddr_in addr;
   in_addr_t ipaddr;
+  in_addr_t relay;
+  uint16_t port = DHCP_CLIENT_PORT;
   int len;
 
 #ifdef CONFIG_NETUTILS_DHCPD_IGNOREBROADCAST
@@ -987,10 +1833,6 @@ static int dhcpd_sendpacket(int sockfd, int bbroadcast)
    *     (BOOTP_BROADCAST set)
    * (4) Otherwise, the client claims it can handle the uni-casst response
    *     and we will uni-cast to the offered address (yiaddr).
-   *
-   * NOTE: We really should also check the giaddr field.  If no zero, the
-   * server should send any return messages to the 'DHCP server' port on the
-   *  BOOTP relay agent whose address appears in 'giaddr'.
    */
 
   if (bbroadcast)
@@ -1015,6 +1857,17 @@ static int dhcpd_sendpacket(int sockfd, int bbroadcast)
     }
 #endif
 
+  /* If the request came through a relay agent (giaddr), the response goes
+   * to the 'DHCP server' port of that agent.
+   */
+
+  memcpy(&relay, g_state.ds_outpacket.giaddr, 4);
+  if (relay != INADDR_ANY)
+    {
+      ipaddr = relay;
+      port   = DHCP_SERVER_PORT;
+    }
+
   /* Create a socket to respond with a packet to the client.  We
    * cannot reuse the listener socket because it is not bound correctly
    */
@@ -1023,7 +1876,7 @@ static int dhcpd_sendpacket(int sockfd, int bbroadcast)
 
   memset(&addr, 0, sizeof(struct sockaddr_in));
   addr.sin_family      = AF_INET;
-  addr.sin_port        = HTONS(DHCP_CLIENT_PORT);
+  addr.sin_port        = htons(port);
   addr.sin_addr.s_addr = ipaddr;
 
   /* Send the minimum sized packet that includes the END option */
@@ -1046,7 +1899,7 @@ static inline int dhcpd_sendoffer(int sockfd, in_addr_t ipaddr,
   in_addr_t netaddr;
 #ifdef HAVE_DNSIP
   uint32_t dnsaddr;
-  dnsaddr = htonl(g_dhcpd_config.ds_dnsip);
+  dnsaddr = htonl(g_state.ds_pool->ps_config->ds_dnsip);
 #endif
   /* IP address is in host order */
 
@@ -1066,11 +1919,11 @@ static inline int dhcpd_sendoffer(int sockfd, in_addr_t ipaddr,
   dhcpd_addoption32(DHCP_OPTION_LEASE_TIME, htonl(leasetime));
 #ifdef HAVE_NETMASK
   dhcpd_addoption32(DHCP_OPTION_SUBNET_MASK,
-                    htonl(g_dhcpd_config.ds_netmask));
+                    htonl(g_state.ds_pool->ps_config->ds_netmask));
 #endif
 #ifdef HAVE_ROUTERIP
   dhcpd_addoption32(DHCP_OPTION_ROUTER,
-                    htonl(g_dhcpd_config.ds_routerip));
+                    htonl(g_state.ds_pool->ps_config->ds_routerip));
 #endif
 #ifdef HAVE_DNSIP
   dhcp_addoption32p(DHCP_OPTION_DNS_SERVER, (FAR uint8_t *)&dnsaddr);
@@ -1105,10 +1958,11 @@ static int dhcpd_sendnak(int sockfd)
 int dhcpd_sendack(int sockfd, in_addr_t ipaddr)
 {
   uint32_t leasetime = CONFIG_NETUTILS_DHCPD_LEASETIME;
+  FAR struct lease_s *lease;
   in_addr_t netaddr;
 #ifdef HAVE_DNSIP
   uint32_t dnsaddr;
-  dnsaddr = htonl(g_dhcpd_config.ds_dnsip);
+  dnsaddr = htonl(g_state.ds_pool->ps_config->ds_dnsip);
 #endif
 
   /* Initialize the ACK response */
@@ -1130,11 +1984,11 @@ int dhcpd_sendack(int sockfd, in_addr_t ipaddr)
   dhcpd_addoption32(DHCP_OPTION_LEASE_TIME, htonl(leasetime));
 #ifdef HAVE_NETMASK
   dhcpd_addoption32(DHCP_OPTION_SUBNET_MASK,
-                    htonl(g_dhcpd_config.ds_netmask));
+                    htonl(g_state.ds_pool->ps_config->ds_netmask));
 #endif
 #ifdef HAVE_ROUTERIP
   dhcpd_addoption32(DHCP_OPTION_ROUTER,
-                    htonl(g_dhcpd_config.ds_routerip));
+                    htonl(g_state.ds_pool->ps_config->ds_routerip));
 #endif
 #ifdef HAVE_DNSIP
   dhcp_addoption32p(DHCP_OPTION_DNS_SERVER, (FAR uint8_t *)&dnsaddr);
@@ -1149,7 +2003,12 @@ int dhcpd_sendack(int sockfd, in_addr_t ipaddr)
       return ERROR;
     }
 
-  dhcpd_setlease(g_state.ds_inpacket.chaddr, ipaddr, leasetime);
+  lease = dhcpd_setlease(g_state.ds_inpacket.chaddr, ipaddr, leasetime);
+  if (lease != NULL)
+    {
+      dhcpd_journal_append(ipaddr, lease->mac, lease->expiry);
+    }
+
   return OK;
 }
 
@@ -1165,7 +2024,7 @@ static inline int dhcpd_discover(int sockfd)
 
   /* Check if the client is already in the lease table */
 
-  lease = dhcpd_findbymac(g_state.ds_inpacket.chaddr);
+  lease = dhcpd_findclient();
   if (lease)
     {
       /* Yes... get the remaining time on the lease */
@@ -1248,7 +2107,7 @@ static inline int dhcpd_request(int sockfd)
    * still valid.
    */
 
-  lease = dhcpd_findbymac(g_state.ds_inpacket.chaddr);
+  lease = dhcpd_findclient();
   if (lease)
     {
       /* Yes.. the client already holds a lease.  Verify that the request is
@@ -1350,8 +2209,9 @@ static inline int dhcpd_request(int sockfd)
        * maybe requested before the last shutdown, lease again.
        */
 
-      else if (g_state.ds_optreqip >= g_dhcpd_config.ds_startip &&
-               g_state.ds_optreqip <= g_dhcpd_config.ds_endip)
+      else if (g_state.ds_optreqip >=
+               g_state.ds_pool->ps_config->ds_startip &&
+               g_state.ds_optreqip <= g_state.ds_pool->ps_config->ds_endip)
         {
           ipaddr = g_state.ds_optreqip;
           response = DHCPACK;
@@ -1408,7 +2268,8 @@ static inline int dhcpd_decline(void)
        * address for a period of time.
        */
 
-      memset(lease->mac, 0, DHCP_HLEN_ETHERNET);
+      dhcpd_journal_append(dhcp_leaseipaddr(lease), lease->mac, 0);
+      dhcpd_unhashlease(lease);
 #ifdef HAVE_LEASE_TIME
       lease->expiry = dhcpd_time() + CONFIG_NETUTILS_DHCPD_DECLINETIME;
 #endif
@@ -1428,7 +2289,8 @@ static inline int dhcpd_release(void)
     {
       /* Release the IP address now */
 
-      memset(lease, 0, sizeof(struct lease_s));
+      dhcpd_journal_append(dhcp_leaseipaddr(lease), lease->mac, 0);
+      dhcpd_freelease(lease);
     }
 
   return OK;
@@ -1494,7 +2356,7 @@ static inline int dhcpd_openlistener(FAR const char *interface)
  * Name: dhcpd_task_run
  ****************************************************************************/
 
-#ifndef CONFIG_BUILD_KERNEL
+#if !defined(CONFIG_BUILD_KERNEL) && !defined(CONFIG_NETUTILS_DHCPD_HOST)
 static int dhcpd_task_run(int argc, char **argv)
 {
   return dhcpd_run(argv[1]);
@@ -1512,7 +2374,8 @@ static int dhcpd_task_run(int argc, char **argv)
  *
  ****************************************************************************/
 
-#if !defined(CONFIG_BUILD_KERNEL) || defined(CONFIG_SCHED_WAITPID)
+#if (!defined(CONFIG_BUILD_KERNEL) || defined(CONFIG_SCHED_WAITPID)) && \
+    !defined(CONFIG_NETUTILS_DHCPD_HOST)
 static pid_t dhcpd_get_pid(void)
 {
   pid_t pid = -1;
@@ -1580,6 +2443,7 @@ int dhcpd_run(FAR const char *interface)
 #endif
   int sockfd = -1;
   int nbytes;
+  int ret;
 
   ninfo("Started\n");
 
@@ -1600,6 +2464,22 @@ int dhcpd_run(FAR const char *interface)
 
   memset(g_dhcpd_daemon.ds_data, 0, sizeof(struct dhcpd_state_s));
 
+  /* Allocate the lease table and restore the leases from the journal */
+
+  ret = dhcpd_initleases();
+  if (ret < 0)
+    {
+      free(g_dhcpd_daemon.ds_data);
+      g_dhcpd_daemon.ds_data = NULL;
+      return ret;
+    }
+
+  ret = dhcpd_journal_open();
+  if (ret < 0)
+    {
+      nerr("ERROR: Leases will not persist: %d\n", ret);
+    }
+
   /* Update the pid if running in daemon mode */
 
   g_dhcpd_daemon.ds_pid = getpid();
@@ -1660,6 +2540,8 @@ int dhcpd_run(FAR const char *interface)
           continue;
         }
 
+      dhcpd_selectpool();
+
 #ifdef CONFIG_NETUTILS_DHCPD_HOST
       /* Get the poor little uC a change to get its recvfrom in place */
 
@@ -1698,6 +2580,8 @@ int dhcpd_run(FAR const char *interface)
         }
     }
 
+  dhcpd_journal_close();
+  dhcpd_freeleases();
   free(g_dhcpd_daemon.ds_data);
   g_dhcpd_daemon.ds_data = NULL;
   g_dhcpd_daemon.ds_pid   = -1;
@@ -1718,7 +2602,7 @@ int dhcpd_run(FAR const char *interface)
  *
  ****************************************************************************/
 
-#ifndef CONFIG_BUILD_KERNEL
+#if !defined(CONFIG_BUILD_KERNEL) && !defined(CONFIG_NETUTILS_DHCPD_HOST)
 int dhcpd_start(FAR const char *interface)
 {
   FAR char *argv[2];
@@ -1808,8 +2692,9 @@ int dhcpd_stop(void)
 
 int dhcpd_set_startip(in_addr_t startip)
 {
-  g_dhcpd_config.ds_startip = startip;
-  g_dhcpd_config.ds_endip = startip + CONFIG_NETUTILS_DHCPD_MAXLEASES - 1;
+  g_dhcpd_config.ds_pools[0].ds_startip = startip;
+  g_dhcpd_config.ds_pools[0].ds_endip =
+    startip + CONFIG_NETUTILS_DHCPD_MAXLEASES - 1;
   return OK;
 }
 
@@ -1827,7 +2712,7 @@ int dhcpd_set_startip(in_addr_t startip)
 
 int dhcpd_set_routerip(in_addr_t routerip)
 {
-  g_dhcpd_config.ds_routerip = routerip;
+  g_dhcpd_config.ds_pools[0].ds_routerip = routerip;
   return OK;
 }
 #endif
@@ -1846,7 +2731,7 @@ int dhcpd_set_routerip(in_addr_t routerip)
 
 int dhcpd_set_netmask(in_addr_t netmask)
 {
-  g_dhcpd_config.ds_netmask = netmask;
+  g_dhcpd_config.ds_pools[0].ds_netmask = netmask;
   return OK;
 }
 #endif
@@ -1865,7 +2750,75 @@ int dhcpd_set_netmask(in_addr_t netmask)
 
 int dhcpd_set_dnsip(in_addr_t dnsip)
 {
-  g_dhcpd_config.ds_dnsip = dnsip;
+  g_dhcpd_config.ds_pools[0].ds_dnsip = dnsip;
   return OK;
 }
 #endif
+
+/****************************************************************************
+ * Name: dhcpd_add_pool
+ *
+ * Description:
+ *   Add a pool of addresses for clients behind a DHCP relay agent.  The
+ *   pool serves the requests relayed from the subnet of its start address.
+ *   routerip, netmask and dnsip are only used if the corresponding default
+ *   option is enabled.  Pools must be added before the daemon is started.
+ *
+ * Returned Value:
+ *   OK on success; a negated errno value on failure.
+ *
+ ****************************************************************************/
+
+int dhcpd_add_pool(in_addr_t startip, in_addr_t endip, in_addr_t routerip,
+                   in_addr_t netmask, in_addr_t dnsip)
+{
+  FAR struct dhcpd_pool_s *pool;
+  int i;
+
+  if (startip > endip)
+    {
+      return -EINVAL;
+    }
+
+  if (g_dhcpd_daemon.ds_state == DHCPD_RUNNING)
+    {
+      return -EBUSY;
+    }
+
+  if (g_dhcpd_config.ds_npools >= CONFIG_NETUTILS_DHCPD_MAXPOOLS)
+    {
+      return -ENOSPC;
+    }
+
+  /* Pools may not overlap */
+
+  for (i = 0; i < g_dhcpd_config.ds_npools; i++)
+    {
+      pool = &g_dhcpd_config.ds_pools[i];
+      if (startip <= pool->ds_endip && endip >= pool->ds_startip)
+        {
+          return -EEXIST;
+        }
+    }
+
+  pool = &g_dhcpd_config.ds_pools[g_dhcpd_config.ds_npools++];
+  pool->ds_startip = startip;
+  pool->ds_endip   = endip;
+#ifdef HAVE_ROUTERIP
+  pool->ds_routerip = routerip;
+#else
+  UNUSED(routerip);
+#endif
+#ifdef HAVE_NETMASK
+  pool->ds_netmask = netmask;
+#else
+  UNUSED(netmask);
+#endif
+#ifdef HAVE_DNSIP
+  pool->ds_dnsip = dnsip;
+#else
+  UNUSED(dnsip);
+#endif
+
+  return OK;
+}
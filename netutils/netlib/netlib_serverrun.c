@@ -0,0 +1,634 @@
+/****************************************************************************
+ * apps/netutils/netlib/netlib_serverrun.c
+ *
+ * SPDX-License-Identifier: Apache-2.0
+ *
+ * Licensed to the Apache Software Foundation (ASF) under one or more
+ * contributor license agreements.  See the NOTICE file distributed with
+ * this work for additional information regarding copyright ownership.  The
+ * ASF licenses this file to you under the Apache License, Version 2.0 (the
+ * "License"); you may not use this file except in compliance with the
+ * License.  You may obtain a copy of the License at
+ *
+ *   http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS, WITHOUT
+ * WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.  See the
+ * License for the specific language governing permissions and limitations
+ * under the License.
+ *
+ ****************************************************************************/
+
+/****************************************************************************
+ * Included Files
+ ****************************************************************************/
+
+#include <nuttx/config.h>
+
+#include <sys/types.h>
+#include <sys/socket.h>
+
+#include <stdint.h>
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+#include <pthread.h>
+#include <poll.h>
+#include <time.h>
+#include <errno.h>
+#include <nuttx/debug.h>
+
+#include "netutils/netlib.h"
+
+/****************************************************************************
+ * Private Functions
+ ****************************************************************************/
+
+/****************************************************************************
+ * Name: netlib_server_now
+ ****************************************************************************/
+
+static uint64_t netlib_server_now(void)
+{
+  struct timespec ts;
+
+  clock_gettime(CLOCK_MONOTONIC, &ts);
+  return (uint64_t)ts.tv_sec * 1000000 + ts.tv_nsec / 1000;
+}
+
+/****************************************************************************
+ * Name: netlib_server_account
+ *
+ * Description:
+ *   Add one sample to a total/maximum pair.  Called with the lock held.
+ *
+ ****************************************************************************/
+
+static void netlib_server_account(FAR uint64_t *total, FAR uint32_t *max,
+                                  uint64_t us)
+{
+  if (us > UINT32_MAX)
+    {
+      us = UINT32_MAX;
+    }
+
+  *total += us;
+  if (us > *max)
+    {
+      *max = (uint32_t)us;
+    }
+}
+
+/****************************************************************************
+ * Name: netlib_server_admit
+ *
+ * Description:
+ *   Count a new connection against the limit of connections in service or
+ *   waiting.  Returns false if the connection must be refused.  Called with
+ *   the lock held.
+ *
+ ****************************************************************************/
+
+static bool netlib_server_admit(FAR struct netlib_server_s *server,
+                                int limit)
+{
+  FAR struct netlib_server_stats_s *stats = &server->stats;
+  int inuse = stats->active + stats->queued;
+
+  if (inuse >= limit)
+    {
+      stats->rejected++;
+      return false;
+    }
+
+  stats->accepted++;
+  if (inuse + 1 > stats->peak)
+    {
+      stats->peak = inuse + 1;
+    }
+
+  return true;
+}
+
+/****************************************************************************
+ * Name: netlib_server_accept
+ *
+ * Description:
+ *   Accept the next connection and apply the socket options.  Returns the
+ *   new socket, -EAGAIN if this connection failed but the listener is
+ *   still usable, or another negated errno if serving must stop.
+ *
+ ****************************************************************************/
+
+static int netlib_server_accept(FAR struct netlib_server_s *server,
+                                int listensd)
+{
+  int acceptsd;
+  int errcode;
+
+  acceptsd = accept4(listensd, NULL, NULL, SOCK_CLOEXEC);
+  if (acceptsd < 0)
+    {
+      errcode = errno;
+      if (errcode == EINTR || errcode == EAGAIN ||
+          errcode == ECONNABORTED || errcode == EMFILE ||
+          errcode == ENFILE || errcode == ENOBUFS || errcode == ENOMEM)
+        {
+          /* Temporary, keep serving the other connections */
+
+          nwarn("WARNING: accept failure: %d\n", errcode);
+          return -EAGAIN;
+        }
+
+      nerr("ERROR: accept failure: %d\n", errcode);
+      return -errcode;
+    }
+
+#ifdef CONFIG_NET_SOLINGER
+  if (server->linger >= 0)
+    {
+      struct linger ling;
+
+      ling.l_onoff  = 1;
+      ling.l_linger = server->linger;
+
+      if (setsockopt(acceptsd, SOL_SOCKET, SO_LINGER,
+                     &ling, sizeof(struct linger)) < 0)
+        {
+          nwarn("WARNING: setsockopt SO_LINGER failure: %d\n", errno);
+        }
+    }
+#endif
+
+  return acceptsd;
+}
+
+/****************************************************************************
+ * Name: netlib_server_worker
+ *
+ * Description:
+ *   Pool worker thread: take connections from the queue and run the
+ *   handler on them until the server stops.
+ *
+ ****************************************************************************/
+
+static FAR void *netlib_server_worker(FAR void *arg)
+{
+  FAR struct netlib_server_s *server = arg;
+  FAR struct netlib_server_stats_s *stats = &server->stats;
+  FAR struct netlib_server_conn_s *slot;
+  uint64_t start;
+  uint64_t now;
+  int sd;
+
+  pthread_mutex_lock(&server->lock);
+  for (; ; )
+    {
+      while (stats->queued == 0 && !server->stopping)
+        {
+          pthread_cond_wait(&server->cond, &server->lock);
+        }
+
+      if (stats->queued == 0)
+        {
+          break;
+        }
+
+      /* Take the oldest connection */
+
+      slot = &server->queue[server->head];
+      server->head = (server->head + 1) %
+                     (server->nworkers + server->backlog);
+      stats->queued--;
+      stats->active++;
+
+      sd    = slot->sd;
+      start = netlib_server_now();
+      netlib_server_account(&stats->wait_total_us, &stats->wait_max_us,
+                            start - slot->start_us);
+      pthread_mutex_unlock(&server->lock);
+
+      ninfo("Serving sd=%d\n", sd);
+      server->handler((pthread_addr_t)((uintptr_t)sd));
+
+      now = netlib_server_now();
+      pthread_mutex_lock(&server->lock);
+      stats->active--;
+      stats->served++;
+      netlib_server_account(&stats->serve_total_us, &stats->serve_max_us,
+                            now - start);
+    }
+
+  pthread_mutex_unlock(&server->lock);
+  return NULL;
+}
+
+/****************************************************************************
+ * Name: netlib_server_pool
+ *
+ * Description:
+ *   Accept loop of the worker pool.  Up to server->backlog connections
+ *   beyond the busy workers wait in a queue, more are closed at once.
+ *
+ ****************************************************************************/
+
+static int netlib_server_pool(FAR struct netlib_server_s *server,
+                              int listensd)
+{
+  FAR struct netlib_server_stats_s *stats = &server->stats;
+  FAR struct netlib_server_conn_s *slot;
+  FAR pthread_t *workers;
+  pthread_attr_t attr;
+  int nworkers;
+  int acceptsd;
+  int ret = OK;
+
+  if (server->handler == NULL || server->nworkers <= 0)
+    {
+      return -EINVAL;
+    }
+
+  /* The queue also hands the connections over to idle workers, so it
+   * holds up to nworkers + backlog entries.
+   */
+
+  if (server->backlog < 0)
+    {
+      server->backlog = 0;
+    }
+
+  server->queue = malloc((server->nworkers + server->backlog) *
+                         sizeof(struct netlib_server_conn_s));
+  workers = malloc(server->nworkers * sizeof(pthread_t));
+  if (server->queue == NULL || workers == NULL)
+    {
+      ret = -ENOMEM;
+      goto errout;
+    }
+
+  /* Start the workers.  Run with fewer if not all of them can be created */
+
+  pthread_attr_init(&attr);
+  pthread_attr_setstacksize(&attr, server->stacksize);
+
+  for (nworkers = 0; nworkers < server->nworkers; nworkers++)
+    {
+      ret = pthread_create(&workers[nworkers], &attr,
+                           netlib_server_worker, server);
+      if (ret != 0)
+        {
+          nerr("ERROR: pthread_create failed: %d\n", ret);
+          break;
+        }
+
+      pthread_setname_np(workers[nworkers], "netlib_server");
+    }
+
+  pthread_attr_destroy(&attr);
+
+  if (nworkers == 0)
+    {
+      ret = -ret;
+      goto errout;
+    }
+
+  pthread_mutex_lock(&server->lock);
+  server->nworkers = nworkers;
+  pthread_mutex_unlock(&server->lock);
+
+  /* Begin serving connections */
+
+  for (; ; )
+    {
+      acceptsd = netlib_server_accept(server, listensd);
+      if (acceptsd == -EAGAIN)
+        {
+          continue;
+        }
+      else if (acceptsd < 0)
+        {
+          ret = acceptsd;
+          break;
+        }
+
+      pthread_mutex_lock(&server->lock);
+      if (!netlib_server_admit(server, nworkers + server->backlog))
+        {
+          pthread_mutex_unlock(&server->lock);
+          ninfo("Connection refused sd=%d\n", acceptsd);
+          close(acceptsd);
+          continue;
+        }
+
+      /* Admitted, so queued < nworkers + backlog */
+
+      slot = &server->queue[(server->head + stats->queued) %
+                            (nworkers + server->backlog)];
+      slot->sd       = acceptsd;
+      slot->start_us = netlib_server_now();
+      stats->queued++;
+
+      pthread_cond_signal(&server->cond);
+      pthread_mutex_unlock(&server->lock);
+    }
+
+  /* Let the workers finish the queued connections and exit */
+
+  pthread_mutex_lock(&server->lock);
+  server->stopping = true;
+  pthread_cond_broadcast(&server->cond);
+  pthread_mutex_unlock(&server->lock);
+
+  while (nworkers > 0)
+    {
+      pthread_join(workers[--nworkers], NULL);
+    }
+
+errout:
+  free(workers);
+  free(server->queue);
+  server->queue = NULL;
+  return ret;
+}
+
+/****************************************************************************
+ * Name: netlib_server_close
+ *
+ * Description:
+ *   Close connection i of the event loop and move the last connection into
+ *   its place.
+ *
+ ****************************************************************************/
+
+static void netlib_server_close(FAR struct netlib_server_s *server,
+                                FAR struct pollfd *fds, int i)
+{
+  FAR struct netlib_server_stats_s *stats = &server->stats;
+  FAR struct netlib_server_conn_s *slot = &server->queue[i];
+  int last = stats->active - 1;
+
+  if (server->ops->disconnect != NULL)
+    {
+      server->ops->disconnect(server->arg, slot->sd, slot->conn);
+    }
+
+  close(slot->sd);
+
+  pthread_mutex_lock(&server->lock);
+  stats->active--;
+  stats->served++;
+  netlib_server_account(&stats->serve_total_us, &stats->serve_max_us,
+                        netlib_server_now() - slot->start_us);
+  pthread_mutex_unlock(&server->lock);
+
+  /* fds[0] is the listener, connection i is polled in fds[i + 1] */
+
+  server->queue[i] = server->queue[last];
+  fds[i + 1]       = fds[last + 1];
+}
+
+/****************************************************************************
+ * Name: netlib_server_event
+ *
+ * Description:
+ *   Single thread event loop.  Up to server->maxconn connections are
+ *   polled together with the listener, more are closed at once.
+ *
+ ****************************************************************************/
+
+static int netlib_server_event(FAR struct netlib_server_s *server,
+                               int listensd)
+{
+  FAR const struct netlib_server_ops_s *ops = server->ops;
+  FAR struct netlib_server_stats_s *stats = &server->stats;
+  FAR struct netlib_server_conn_s *slot;
+  FAR struct pollfd *fds;
+  uint64_t start;
+  uint64_t now;
+  int acceptsd;
+  int ret;
+  int i;
+
+  if (ops == NULL || ops->event == NULL || server->maxconn <= 0)
+    {
+      return -EINVAL;
+    }
+
+  server->queue = malloc(server->maxconn *
+                         sizeof(struct netlib_server_conn_s));
+  fds = malloc((server->maxconn + 1) * sizeof(struct pollfd));
+  if (server->queue == NULL || fds == NULL)
+    {
+      ret = -ENOMEM;
+      goto errout;
+    }
+
+  fds[0].fd     = listensd;
+  fds[0].events = POLLIN;
+
+  for (; ; )
+    {
+      ret = poll(fds, stats->active + 1, -1);
+      if (ret < 0)
+        {
+          if (errno == EINTR)
+            {
+              continue;
+            }
+
+          ret = -errno;
+          nerr("ERROR: poll failure: %d\n", errno);
+          break;
+        }
+
+      /* Dispatch the connections first, the new connection is appended and
+       * is not polled yet.
+       */
+
+      for (i = stats->active - 1; i >= 0; i--)
+        {
+          if (fds[i + 1].revents == 0)
+            {
+              continue;
+            }
+
+          slot  = &server->queue[i];
+          start = netlib_server_now();
+          ret   = ops->event(server->arg, slot->sd, slot->conn,
+                             fds[i + 1].revents);
+          now   = netlib_server_now();
+
+          if (now - start > stats->callback_max_us)
+            {
+              stats->callback_max_us = now - start > UINT32_MAX ?
+                                       UINT32_MAX : now - start;
+            }
+
+          if (ret < 0 || (fds[i + 1].revents & POLLNVAL) != 0)
+            {
+              netlib_server_close(server, fds, i);
+            }
+          else
+            {
+              fds[i + 1].events  = ret;
+              fds[i + 1].revents = 0;
+            }
+        }
+
+      if ((fds[0].revents & POLLIN) == 0)
+        {
+          continue;
+        }
+
+      acceptsd = netlib_server_accept(server, listensd);
+      if (acceptsd == -EAGAIN)
+        {
+          continue;
+        }
+      else if (acceptsd < 0)
+        {
+          ret = acceptsd;
+          break;
+        }
+
+      pthread_mutex_lock(&server->lock);
+      ret = netlib_server_admit(server, server->maxconn);
+      pthread_mutex_unlock(&server->lock);
+
+      if (!ret)
+        {
+          ninfo("Connection refused sd=%d\n", acceptsd);
+          close(acceptsd);
+          continue;
+        }
+
+      slot           = &server->queue[stats->active];
+      slot->sd       = acceptsd;
+      slot->conn     = NULL;
+      slot->start_us = netlib_server_now();
+
+      ret = POLLIN;
+      if (ops->connect != NULL)
+        {
+          ret = ops->connect(server->arg, acceptsd, &slot->conn);
+        }
+
+      now = netlib_server_now();
+      pthread_mutex_lock(&server->lock);
+      netlib_server_account(&stats->wait_total_us, &stats->wait_max_us,
+                            now - slot->start_us);
+
+      if (ret < 0)
+        {
+          stats->accepted--;
+          stats->rejected++;
+          pthread_mutex_unlock(&server->lock);
+          close(acceptsd);
+          continue;
+        }
+
+      fds[stats->active + 1].fd      = acceptsd;
+      fds[stats->active + 1].events  = ret;
+      fds[stats->active + 1].revents = 0;
+      stats->active++;
+      pthread_mutex_unlock(&server->lock);
+    }
+
+  /* Close the remaining connections */
+
+  while (stats->active > 0)
+    {
+      netlib_server_close(server, fds, stats->active - 1);
+    }
+
+errout:
+  free(fds);
+  free(server->queue);
+  server->queue = NULL;
+  return ret;
+}
+
+/****************************************************************************
+ * Public Functions
+ ****************************************************************************/
+
+/****************************************************************************
+ * Name: netlib_server_init
+ *
+ * Description:
+ *   Initialize a server instance with the configured defaults.
+ *
+ * Parameters:
+ *   server    The instance to initialize
+ *   mode      NETLIB_SERVER_POOL or NETLIB_SERVER_EVENT
+ *
+ ****************************************************************************/
+
+void netlib_server_init(FAR struct netlib_server_s *server, int mode)
+{
+  memset(server, 0, sizeof(*server));
+
+  server->mode      = mode;
+  server->nworkers  = CONFIG_NETUTILS_NETLIB_SERVER_WORKERS;
+  server->backlog   = CONFIG_NETUTILS_NETLIB_SERVER_BACKLOG;
+  server->maxconn   = CONFIG_NETUTILS_NETLIB_SERVER_MAXCONN;
+  server->stacksize = PTHREAD_STACK_DEFAULT;
+  server->linger    = -1;
+
+  pthread_mutex_init(&server->lock, NULL);
+  pthread_cond_init(&server->cond, NULL);
+}
+
+/****************************************************************************
+ * Name: netlib_server_run
+ *
+ * Description:
+ *   Serve the connections of a listening socket.  In NETLIB_SERVER_POOL
+ *   mode each connection is passed to server->handler on one of
+ *   server->nworkers threads, in NETLIB_SERVER_EVENT mode all of them are
+ *   served by server->ops on the calling thread.
+ *
+ * Parameters:
+ *   server    The initialized instance
+ *   listensd  Listening stream socket, e.g. from netlib_listenon()
+ *
+ * Return:
+ *   Does not return unless an error occurs, then a negated errno.  The
+ *   listening socket is not closed.
+ *
+ ****************************************************************************/
+
+int netlib_server_run(FAR struct netlib_server_s *server, int listensd)
+{
+  server->stopping = false;
+
+  switch (server->mode)
+    {
+      case NETLIB_SERVER_POOL:
+        return netlib_server_pool(server, listensd);
+
+      case NETLIB_SERVER_EVENT:
+        return netlib_server_event(server, listensd);
+
+      default:
+        return -EINVAL;
+    }
+}
+
+/****************************************************************************
+ * Name: netlib_server_getstats
+ *
+ * Description:
+ *   Return a consistent snapshot of the server's statistics.  May be
+ *   called from any thread while the server is running.
+ *
+ ****************************************************************************/
+
+void netlib_server_getstats(FAR struct netlib_server_s *server,
+                            FAR struct netlib_server_stats_s *stats)
+{
+  pthread_mutex_lock(&server->lock);
+  *stats = server->stats;
+  pthread_mutex_unlock(&server->lock);
+}
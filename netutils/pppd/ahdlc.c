@@ -57,33 +57,121 @@
 #  define PACKET_TX_DEBUG 0
 #endif
 
+/* One FCS-16 step (RFC 1662, section C.2) */
+
+#define AHDLC_FCS(fcs, c)   (((fcs) >> 8) ^ g_fcstab[((fcs) ^ (c)) & 0xff])
+
+/* Test a character against a 256 bit escape map */
+
+#define AHDLC_ESCAPE(map, c) (((map)[(c) >> 5] >> ((c) & 31)) & 1)
+
+/****************************************************************************
+ * Private Data
+ ****************************************************************************/
+
+/* FCS-16 lookup table, polynomial x**0 + x**5 + x**12 + x**16 (0x8408) */
+
+static const uint16_t g_fcstab[256] =
+{
+  0x0000, 0x1189, 0x2312, 0x329b, 0x4624, 0x57ad, 0x6536, 0x74bf,
+  0x8c48, 0x9dc1, 0xaf5a, 0xbed3, 0xca6c, 0xdbe5, 0xe97e, 0xf8f7,
+  0x1081, 0x0108, 0x3393, 0x221a, 0x56a5, 0x472c, 0x75b7, 0x643e,
+  0x9cc9, 0x8d40, 0xbfdb, 0xae52, 0xdaed, 0xcb64, 0xf9ff, 0xe876,
+  0x2102, 0x308b, 0x0210, 0x1399, 0x6726, 0x76af, 0x4434, 0x55bd,
+  0xad4a, 0xbcc3, 0x8e58, 0x9fd1, 0xeb6e, 0xfae7, 0xc87c, 0xd9f5,
+  0x3183, 0x200a, 0x1291, 0x0318, 0x77a7, 0x662e, 0x54b5, 0x453c,
+  0xbdcb, 0xac42, 0x9ed9, 0x8f50, 0xfbef, 0xea66, 0xd8fd, 0xc974,
+  0x4204, 0x538d, 0x6116, 0x709f, 0x0420, 0x15a9, 0x2732, 0x36bb,
+  0xce4c, 0xdfc5, 0xed5e, 0xfcd7, 0x8868, 0x99e1, 0xab7a, 0xbaf3,
+  0x5285, 0x430c, 0x7197, 0x601e, 0x14a1, 0x0528, 0x37b3, 0x263a,
+  0xdecd, 0xcf44, 0xfddf, 0xec56, 0x98e9, 0x8960, 0xbbfb, 0xaa72,
+  0x6306, 0x728f, 0x4014, 0x519d, 0x2522, 0x34ab, 0x0630, 0x17b9,
+  0xef4e, 0xfec7, 0xcc5c, 0xddd5, 0xa96a, 0xb8e3, 0x8a78, 0x9bf1,
+  0x7387, 0x620e, 0x5095, 0x411c, 0x35a3, 0x242a, 0x16b1, 0x0738,
+  0xffcf, 0xee46, 0xdcdd, 0xcd54, 0xb9eb, 0xa862, 0x9af9, 0x8b70,
+  0x8408, 0x9581, 0xa71a, 0xb693, 0xc22c, 0xd3a5, 0xe13e, 0xf0b7,
+  0x0840, 0x19c9, 0x2b52, 0x3adb, 0x4e64, 0x5fed, 0x6d76, 0x7cff,
+  0x9489, 0x8500, 0xb79b, 0xa612, 0xd2ad, 0xc324, 0xf1bf, 0xe036,
+  0x18c1, 0x0948, 0x3bd3, 0x2a5a, 0x5ee5, 0x4f6c, 0x7df7, 0x6c7e,
+  0xa50a, 0xb483, 0x8618, 0x9791, 0xe32e, 0xf2a7, 0xc03c, 0xd1b5,
+  0x2942, 0x38cb, 0x0a50, 0x1bd9, 0x6f66, 0x7eef, 0x4c74, 0x5dfd,
+  0xb58b, 0xa402, 0x9699, 0x8710, 0xf3af, 0xe226, 0xd0bd, 0xc134,
+  0x39c3, 0x284a, 0x1ad1, 0x0b58, 0x7fe7, 0x6e6e, 0x5cf5, 0x4d7c,
+  0xc60c, 0xd785, 0xe51e, 0xf497, 0x8028, 0x91a1, 0xa33a, 0xb2b3,
+  0x4a44, 0x5bcd, 0x6956, 0x78df, 0x0c60, 0x1de9, 0x2f72, 0x3efb,
+  0xd68d, 0xc704, 0xf59f, 0xe416, 0x90a9, 0x8120, 0xb3bb, 0xa232,
+  0x5ac5, 0x4b4c, 0x79d7, 0x685e, 0x1ce1, 0x0d68, 0x3ff3, 0x2e7a,
+  0xe70e, 0xf687, 0xc41c, 0xd595, 0xa12a, 0xb0a3, 0x8238, 0x93b1,
+  0x6b46, 0x7acf, 0x4854, 0x59dd, 0x2d62, 0x3ceb, 0x0e70, 0x1ff9,
+  0xf78f, 0xe606, 0xd49d, 0xc514, 0xb1ab, 0xa022, 0x92b9, 0x8330,
+  0x7bc7, 0x6a4e, 0x58d5, 0x495c, 0x3de3, 0x2c6a, 0x1ef1, 0x0f78,
+};
+
+/* Transmit escape maps.  0x7d and 0x7e are always escaped; the control
+ * characters are escaped too unless the peer has negotiated an all zero
+ * async control character map.  LCP frames always use the default map.
+ */
+
+static const uint32_t g_accm_default[8] =
+{
+  0xffffffff, 0x00000000, 0x00000000, 0x60000000,
+  0x00000000, 0x00000000, 0x00000000, 0x00000000
+};
+
+static const uint32_t g_accm_none[8] =
+{
+  0x00000000, 0x00000000, 0x00000000, 0x60000000,
+  0x00000000, 0x00000000, 0x00000000, 0x00000000
+};
+
 /****************************************************************************
  * Private Functions
  ****************************************************************************/
 
 /****************************************************************************
- * Simple and fast CRC16 routine for embedded processors.
+ * Name: ahdlc_tx_encode
  *
- *    Just slightly slower than the table lookup method but consumes
- *    almost no space.  Much faster and smaller than the loop and
- *    shift method that is widely used in the embedded space.
- *    Can be optimized even more in .ASM
- *
- *    data = (crcvalue ^ inputchar) & 0xff;
- *    data = (data ^ (data << 4)) & 0xff;
- *    crc = (crc >> 8) ^ ((data << 8) ^ (data <<3) ^ (data >> 4))
+ * Description:
+ *   Escape len bytes from src into the transmit buffer at offset pos,
+ *   adding them to the running tx CRC.  The buffer is flushed to the
+ *   serial device if it fills up, which can only happen for frames larger
+ *   than PPP_RX_BUFFER_SIZE.  Returns the new offset.
  *
  ****************************************************************************/
 
-static uint16_t crcadd(uint16_t crcvalue, uint8_t c)
+static uint16_t ahdlc_tx_encode(FAR struct ppp_context_s *ctx,
+                                FAR const uint32_t *accm,
+                                FAR const uint8_t *src, uint16_t len,
+                                uint16_t pos)
 {
-  uint16_t b;
+  FAR uint8_t *dst = ctx->ahdlc_tx_buffer;
+  uint16_t crc = ctx->ahdlc_tx_crc;
+  uint8_t c;
+
+  while (len-- > 0)
+    {
+      if (pos + 2 >= PPP_TX_BUFFER_SIZE)
+        {
+          ppp_arch_write(ctx, dst, pos);
+          pos = 0;
+        }
+
+      c   = *src++;
+      crc = AHDLC_FCS(crc, c);
 
-  b = (crcvalue ^ c) & 0xff;
-  b = (b ^ (b << 4)) & 0xff;
-  b = (b << 8) ^ (b << 3) ^ (b >> 4);
+      if (AHDLC_ESCAPE(accm, c))
+        {
+          /* Send escape char and xor byte by 0x20 */
+
+          dst[pos++] = 0x7d;
+          c ^= 0x20;
+        }
+
+      dst[pos++] = c;
+    }
 
-  return ((crcvalue >> 8) ^ b);
+  ctx->ahdlc_tx_crc = crc;
+  return pos;
 }
 
 /****************************************************************************
@@ -100,6 +188,8 @@ void ahdlc_init(struct ppp_context_s *ctx)
 {
   ctx->ahdlc_flags = PPP_RX_ASYNC_MAP;
   ctx->ahdlc_rx_count = 0;
+  ctx->ahdlc_rx_rawpos = 0;
+  ctx->ahdlc_rx_rawlen = 0;
   ctx->ahdlc_tx_offline = 0;
 
 #ifdef PPP_STATISTICS
@@ -269,7 +359,7 @@ uint8_t ahdlc_rx(FAR struct ppp_context_s *ctx, uint8_t c)
         {
           /* Add CRC in */
 
-          ctx->ahdlc_rx_crc = crcadd(ctx->ahdlc_rx_crc, c);
+          ctx->ahdlc_rx_crc = AHDLC_FCS(ctx->ahdlc_rx_crc, c);
 
           /* Do auto ACFC, if packet len is zero discard 0xff and 0x03 */
 
@@ -298,43 +388,96 @@ uint8_t ahdlc_rx(FAR struct ppp_context_s *ctx, uint8_t c)
 }
 
 /****************************************************************************
- * ahdlc_tx_char(char) - write a character to the serial device,
- * escape if necessary.
+ * ahdlc_rx_bulk(buf, len) - process a block of received bytes.
  *
- * Relies on local global vars   :    ahdlc_tx_crc, ahdlc_flags.
- * Modifies local global vars    :    ahdlc_tx_crc.
+ *    Runs of ordinary characters are CRCed and copied into the receive
+ *    buffer in a tight loop, flags, escapes and everything at the start of
+ *    a frame go through ahdlc_rx().  Processing stops after each frame
+ *    flag so the caller can look at what the upcall did with the frame.
+ *
+ *    Returns the number of bytes consumed, zero if the receive buffer is
+ *    locked.
  *
  ****************************************************************************/
 
-void ahdlc_tx_char(struct ppp_context_s *ctx, uint16_t protocol, uint8_t c)
+uint16_t ahdlc_rx_bulk(FAR struct ppp_context_s *ctx,
+                       FAR const uint8_t *buf, uint16_t len)
 {
-  /* Add in crc */
+  FAR uint8_t *dst = ctx->ahdlc_rx_buffer;
+  uint16_t count;
+  uint16_t crc;
+  uint16_t end;
+  uint16_t i = 0;
+  uint8_t ctlmin;
+  uint8_t c;
+
+  while (i < len)
+    {
+      if ((ctx->ahdlc_flags & PPP_RX_READY) == 0)
+        {
+          break;
+        }
 
-  ctx->ahdlc_tx_crc = crcadd(ctx->ahdlc_tx_crc, c);
+      /* Control characters are discarded by ahdlc_rx() unless the receive
+       * async map is on, leave them to it.
+       */
 
-  /* See if we need to escape char, we always escape 0x7d and 0x7e, in the
-   * case of char < 0x20 we only support async map of default or none, so
-   * escape if ASYNC map is not set.  We may want to modify this to support
-   * ASYNC map.
-   */
+      ctlmin = (ctx->ahdlc_flags & PPP_RX_ASYNC_MAP) != 0 ? 0 : 0x20;
+      count  = ctx->ahdlc_rx_count;
 
-  if ((c == 0x7d) || (c == 0x7e) || ((c < 0x20) &&
-      ((protocol == LCP) || (ctx->ahdlc_flags & PPP_TX_ASYNC_MAP) == 0)))
-    {
-      /* Send escape char and xor byte by 0x20 */
+      if ((ctx->ahdlc_flags & PPP_ESCAPED) == 0 && count > 0)
+        {
+          /* Fast path: plain characters in the middle of a frame */
 
-      ppp_arch_putchar(ctx, 0x7d);
-      c ^= 0x20;
+          end = i + PPP_RX_BUFFER_SIZE - count;
+          if (end > len)
+            {
+              end = len;
+            }
+
+          crc = ctx->ahdlc_rx_crc;
+          while (i < end)
+            {
+              c = buf[i];
+              if (c == 0x7e || c == 0x7d || c < ctlmin)
+                {
+                  break;
+                }
+
+              crc = AHDLC_FCS(crc, c);
+              dst[count++] = c;
+              i++;
+            }
+
+          ctx->ahdlc_rx_crc   = crc;
+          ctx->ahdlc_rx_count = count;
+
+          if (i >= len)
+            {
+              break;
+            }
+        }
+
+      /* Slow path: one character through the state machine */
+
+      c = buf[i++];
+      ahdlc_rx(ctx, c);
+
+      if (c == 0x7e)
+        {
+          break;
+        }
     }
 
-  ppp_arch_putchar(ctx, c);
+  return i;
 }
 
 /****************************************************************************
  * ahdlc_tx(protocol,buffer,len) - Transmit a PPP frame.
  *
  *    Buffer contains protocol data, ahdlc_tx adds address, control and
- *    protocol data.
+ *    protocol data.  The whole frame is escaped into ahdlc_tx_buffer and
+ *    handed to the serial device with a single write.
  *
  * Relies on local global vars    :    ahdlc_tx_crc, ahdlc_flags.
  * Modifies local global vars    :    ahdlc_tx_crc.
@@ -345,8 +488,10 @@ uint8_t ahdlc_tx(struct ppp_context_s *ctx, uint16_t protocol,
                  FAR uint8_t * header, FAR uint8_t * buffer,
                  uint16_t headerlen, uint16_t datalen)
 {
+  FAR const uint32_t *accm;
+  uint8_t frame[4];
+  uint16_t pos;
   uint16_t i;
-  uint8_t c;
 
   DEBUG1(("\nAHDLC_TX - transmit frame, protocol 0x%04x, length %d "
           "offline %d\n",
@@ -378,9 +523,23 @@ uint8_t ahdlc_tx(struct ppp_context_s *ctx, uint16_t protocol,
 
   /* Check to see that physical layer is up, we can assume is some cases */
 
+  /* We only support async map of default or none, LCP always uses the
+   * default one.
+   */
+
+  if (protocol == LCP || (ctx->ahdlc_flags & PPP_TX_ASYNC_MAP) == 0)
+    {
+      accm = g_accm_default;
+    }
+  else
+    {
+      accm = g_accm_none;
+    }
+
   /* Write leading 0x7e */
 
-  ppp_arch_putchar(ctx, 0x7e);
+  ctx->ahdlc_tx_buffer[0] = 0x7e;
+  pos = 1;
 
   /* Set initial CRC value */
 
@@ -388,56 +547,35 @@ uint8_t ahdlc_tx(struct ppp_context_s *ctx, uint16_t protocol,
 
   /* send HDLC control and address if not disabled or of LCP frame type */
 
-  /* if ((0==(ahdlc_flags & PPP_ACFC)) || ((0xc0==buffer[0]) &&
-   * (0x21==buffer[1])))
-   */
-
+  i = 0;
   if ((0 == (ctx->ahdlc_flags & PPP_ACFC)) || (protocol == LCP))
     {
-      ahdlc_tx_char(ctx, protocol, 0xff);
-      ahdlc_tx_char(ctx, protocol, 0x03);
+      frame[i++] = 0xff;
+      frame[i++] = 0x03;
     }
 
   /* Write Protocol */
 
-  ahdlc_tx_char(ctx, protocol, (uint8_t)(protocol >> 8));
-  ahdlc_tx_char(ctx, protocol, (uint8_t)(protocol & 0xff));
-
-  /* Write header if it exists */
-
-  for (i = 0; i < headerlen; ++i)
-    {
-      /* Get next byte from buffer */
-
-      c = header[i];
+  frame[i++] = (uint8_t)(protocol >> 8);
+  frame[i++] = (uint8_t)(protocol & 0xff);
+  pos = ahdlc_tx_encode(ctx, accm, frame, i, pos);
 
-      /* Write it... */
+  /* Write header if it exists, then the frame bytes */
 
-      ahdlc_tx_char(ctx, protocol, c);
-    }
-
-  /* Write frame bytes */
-
-  for (i = 0; i < datalen; ++i)
-    {
-      /* Get next byte from buffer */
-
-      c = buffer[i];
-
-      /* Write it... */
-
-      ahdlc_tx_char(ctx, protocol, c);
-    }
+  pos = ahdlc_tx_encode(ctx, accm, header, headerlen, pos);
+  pos = ahdlc_tx_encode(ctx, accm, buffer, datalen, pos);
 
   /* Send crc, lsb then msb */
 
   i = ctx->ahdlc_tx_crc ^ 0xffff;
-  ahdlc_tx_char(ctx, protocol, (uint8_t)(i & 0xff));
-  ahdlc_tx_char(ctx, protocol, (uint8_t)((i >> 8) & 0xff));
+  frame[0] = (uint8_t)(i & 0xff);
+  frame[1] = (uint8_t)((i >> 8) & 0xff);
+  pos = ahdlc_tx_encode(ctx, accm, frame, 2, pos);
 
   /* Write trailing 0x7e, probably not needed but it doesn't hurt */
 
-  ppp_arch_putchar(ctx, 0x7e);
+  ctx->ahdlc_tx_buffer[pos++] = 0x7e;
+  ppp_arch_write(ctx, ctx->ahdlc_tx_buffer, pos);
 
 #if PPP_STATISTICS
   /* Update statistics */
@@ -67,6 +67,8 @@ void ahdlc_init(FAR struct ppp_context_s *ctx);
 void ahdlc_rx_ready(FAR struct ppp_context_s *ctx);
 
 uint8_t ahdlc_rx(FAR struct ppp_context_s *ctx, uint8_t);
+uint16_t ahdlc_rx_bulk(FAR struct ppp_context_s *ctx,
+                       FAR const uint8_t *buf, uint16_t len);
 uint8_t ahdlc_tx(FAR struct ppp_context_s *ctx, uint16_t protocol,
                  FAR uint8_t *header, FAR uint8_t *buffer,
                  uint16_t headerlen, uint16_t datalen);
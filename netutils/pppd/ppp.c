@@ -214,7 +214,7 @@ void ppp_send(FAR struct ppp_context_s *ctx)
 
 void ppp_poll(FAR struct ppp_context_s *ctx)
 {
-  uint8_t c;
+  int ret;
 
   ctx->ip_len = 0;
 
@@ -230,9 +230,33 @@ void ppp_poll(FAR struct ppp_context_s *ctx)
       return;
     }
 
-  while (ctx->ip_len == 0 && ppp_arch_getchar(ctx, &c))
+  /* Feed the serial data to ahdlc a block at a time.  Bytes left over
+   * when an IP packet comes up stay in ahdlc_rx_raw for the next poll.
+   */
+
+  while (ctx->ip_len == 0)
     {
-      ahdlc_rx(ctx, c);
+      if (ctx->ahdlc_rx_rawpos >= ctx->ahdlc_rx_rawlen)
+        {
+          ret = ppp_arch_read(ctx, ctx->ahdlc_rx_raw,
+                              sizeof(ctx->ahdlc_rx_raw));
+          if (ret <= 0)
+            {
+              break;
+            }
+
+          ctx->ahdlc_rx_rawpos = 0;
+          ctx->ahdlc_rx_rawlen = ret;
+        }
+
+      ret = ahdlc_rx_bulk(ctx, &ctx->ahdlc_rx_raw[ctx->ahdlc_rx_rawpos],
+                          ctx->ahdlc_rx_rawlen - ctx->ahdlc_rx_rawpos);
+      if (ret == 0)
+        {
+          break;
+        }
+
+      ctx->ahdlc_rx_rawpos += ret;
     }
 
   /* If IPCP came up then our link should be up. */
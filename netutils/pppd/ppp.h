@@ -165,6 +165,10 @@ struct ppp_context_s
   /* AHDLC */
 
   uint8_t  ahdlc_rx_buffer[PPP_RX_BUFFER_SIZE];
+  uint8_t  ahdlc_tx_buffer[PPP_TX_BUFFER_SIZE];  /* Escaped tx frame */
+  uint8_t  ahdlc_rx_raw[PPP_RX_CHUNK_SIZE];      /* Raw bytes from tty */
+  uint16_t ahdlc_rx_rawpos;  /* Next unprocessed byte in ahdlc_rx_raw */
+  uint16_t ahdlc_rx_rawlen;  /* Number of valid bytes in ahdlc_rx_raw */
   uint16_t ahdlc_tx_crc;     /* Running tx CRC */
   uint16_t ahdlc_rx_crc;     /* Running rx CRC */
   uint16_t ahdlc_rx_count;   /* Number of rx bytes processed, cur frame */
@@ -58,6 +58,16 @@
 
 #define PPP_RX_BUFFER_SIZE      1024 //1024  //GD 2048 for 1280 IPv6 MTU
 
+/* Worst case escaped frame: flags, address, control, protocol and FCS
+ * around a PPP_RX_BUFFER_SIZE payload, every byte escaped.
+ */
+
+#define PPP_TX_BUFFER_SIZE      (2 * (PPP_RX_BUFFER_SIZE + 6) + 2)
+
+/* Bytes read from the serial device at a time */
+
+#define PPP_RX_CHUNK_SIZE       256
+
 #define AHDLC_TX_OFFLINE        5
 
 #define IPCP_GET_PEER_IP        1
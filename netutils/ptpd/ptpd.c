@@ -58,6 +58,7 @@
 #include <netutils/ptpd.h>
 
 #include "netutils/netlib.h"
+#include "ptpd_servo.h"
 #include "ptpv2.h"
 
 /****************************************************************************
@@ -108,13 +109,12 @@ struct ptp_state_s
   uint16_t sync_seq;
   uint16_t delay_req_seq;
 
-  /* Previous measurement and estimated clock drift rate */
+  /* Previous measurement and the clock servo */
 
   struct timespec last_delta_timestamp;
   int64_t last_delta_ns;
   int64_t last_adjtime_ns;
-  long drift_avg_total_ms;
-  long drift_ppb;
+  struct ptpd_servo_s servo;
 
   /* Identity of currently selected clock source,
    * from the latest announcement message.
@@ -142,8 +142,6 @@ struct ptp_state_s
 
   bool can_send_delayreq;
   struct timespec delayreq_time;
-  int path_delay_avgcount;
-  long path_delay_ns;
   long delayreq_interval;
 
   /* Latest received packet and its timestamp (CLOCK_REALTIME) */
@@ -329,6 +327,25 @@ static int64_t timespec_delta_ns(FAR const struct timespec *ts1,
   return delta_s * NSEC_PER_SEC + (ts1->tv_nsec - ts2->tv_nsec);
 }
 
+/* Move a timespec value by a positive or negative number of nanoseconds */
+
+static void timespec_add_ns(FAR struct timespec *ts, int64_t ns)
+{
+  ts->tv_sec  += ns / NSEC_PER_SEC;
+  ts->tv_nsec += ns % NSEC_PER_SEC;
+
+  if (ts->tv_nsec < 0)
+    {
+      ts->tv_nsec += NSEC_PER_SEC;
+      ts->tv_sec  -= 1;
+    }
+  else if (ts->tv_nsec >= NSEC_PER_SEC)
+    {
+      ts->tv_nsec -= NSEC_PER_SEC;
+      ts->tv_sec  += 1;
+    }
+}
+
 /* Check if the currently selected source is still valid */
 
 static bool is_selected_source_valid(FAR struct ptp_state_s *state)
@@ -525,6 +542,11 @@ static int ptp_initialize_state(FAR struct ptp_state_s *state)
       return ERROR;
     }
 
+  ptpd_servo_init(&state->servo, state->config->hardware_ts,
+                  CONFIG_CLOCK_ADJTIME_SLEWLIMIT_PPM * 1000,
+                  CONFIG_NETUTILS_PTPD_SETTIME_THRESHOLD_MS *
+                  (int64_t)NSEC_PER_MSEC);
+
   /* Create sockets */
 
   if (state->config->af == AF_PACKET)
@@ -998,7 +1020,7 @@ static int ptp_process_announce(FAR struct ptp_state_s *state,
 {
   clock_gettime(CLOCK_MONOTONIC, &state->last_received_announce);
 
-  if (state->conifg->bmca && is_better_clock(msg, &state->n_identity))
+  if (state->config->bmca && is_better_clock(msg, &state->own_identity))
     {
       if (!state->selected_source_valid ||
           is_better_clock(msg, &state->selected_source))
@@ -1007,9 +1029,8 @@ static int ptp_process_announce(FAR struct ptp_state_s *state,
 
           state->selected_source = *msg;
           state->last_received_sync = state->last_received_announce;
-          state->path_delay_avgcount = 0;
-          state->path_delay_ns = 0;
           state->delayreq_time.tv_sec = 0;
+          ptpd_servo_reset(&state->servo);
         }
     }
 
@@ -1024,11 +1045,11 @@ static int ptp_update_local_clock(FAR struct ptp_state_s *state,
                                   FAR struct timespec *remote_timestamp,
                                   FAR struct timespec *local_timestamp)
 {
-  int ret;
-  int64_t delta_ns;
-  int64_t absdelta_ns;
-  const int64_t adj_limit_ns = CONFIG_NETUTILS_PTPD_SETTIME_THRESHOLD_MS
-                               * (int64_t)NSEC_PER_MSEC;
+  int ret = OK;
+  int64_t transit_ns;
+  int64_t local_ns;
+  int64_t offset_ns;
+  int64_t ppb;
 
   ptpinfo("Local time: %jd.%09ld, remote time %jd.%09ld\n",
           (intmax_t)local_timestamp->tv_sec,
@@ -1036,159 +1057,85 @@ static int ptp_update_local_clock(FAR struct ptp_state_s *state,
           (intmax_t)remote_timestamp->tv_sec,
           remote_timestamp->tv_nsec);
 
-  delta_ns = timespec_delta_ns(remote_timestamp, local_timestamp);
-  delta_ns += state->path_delay_ns;
-  absdelta_ns = (delta_ns < 0) ? -delta_ns : delta_ns;
-
-  if (absdelta_ns > adj_limit_ns)
-    {
-      /* Large difference, move by jumping.
-       * Account for delay since packet was received.
-       */
-
-      struct timespec new_time;
-      ptp_gettime(state, &new_time);
-      clock_timespec_subtract(&new_time, local_timestamp, &new_time);
-      clock_timespec_add(&new_time, remote_timestamp, &new_time);
-      ret = ptp_settime(state, &new_time);
-
-      /* Reinitialize drift adjustment parameters */
+  /* The servo filters the transit time of the sync message and turns the
+   * resulting offset into a frequency correction.
+   */
 
-      state->last_delta_timestamp = new_time;
-      state->last_delta_ns = 0;
-      state->last_adjtime_ns = 0;
-      state->drift_avg_total_ms = 0;
-      state->drift_ppb = 0;
+  transit_ns = timespec_delta_ns(local_timestamp, remote_timestamp);
+  local_ns = (int64_t)local_timestamp->tv_sec * NSEC_PER_SEC +
+             local_timestamp->tv_nsec;
 
-      if (ret == OK)
-        {
-          ptpinfo("Jumped to timestamp %jd.%09ld s\n",
-                  (intmax_t)new_time.tv_sec, new_time.tv_nsec);
-        }
-      else
-        {
-          ptperr("ptp_settime() failed: %d\n", errno);
-        }
-    }
-  else
+  switch (ptpd_servo_sync(&state->servo, transit_ns, local_ns,
+                          &offset_ns, &ppb))
     {
-      /* Track drift rate based on two consecutive measurements and
-       * the adjustment that was made previously.
-       */
-
-      int64_t drift_ppb;
-      struct timespec interval;
-      int interval_ms;
-      int max_avg_period_ms;
-      int64_t adjustment_ns;
-
-      clock_timespec_subtract(local_timestamp,
-                              &state->last_delta_timestamp,
-                              &interval);
-      interval_ms = timespec_to_ms(&interval);
-
-      if (interval_ms > 0 && interval_ms < CONFIG_NETUTILS_PTPD_TIMEOUT_MS)
-        {
-          drift_ppb = (delta_ns - state->last_delta_ns) * MSEC_PER_SEC
-                      / interval_ms;
-        }
-      else
+      case PTPD_SERVO_JUMP:
         {
-          ptpwarn("Measurement interval out of range: %d ms\n", interval_ms);
-          drift_ppb = 0;
-          interval_ms = 1;
-        }
+          /* Large difference, move by jumping.  The offset holds at any
+           * time, including the delay since the packet was received.
+           */
 
-      /* Account for the adjustment previously made */
+          struct timespec new_time;
 
-      drift_ppb += state->last_adjtime_ns * MSEC_PER_SEC
-                  / CONFIG_CLOCK_ADJTIME_PERIOD_MS;
+          ptp_gettime(state, &new_time);
+          timespec_add_ns(&new_time, offset_ns);
+          ret = ptp_settime(state, &new_time);
 
-      if (drift_ppb > CONFIG_CLOCK_ADJTIME_SLEWLIMIT_PPM * 1000 ||
-          drift_ppb < -CONFIG_CLOCK_ADJTIME_SLEWLIMIT_PPM * 1000)
-        {
-          ptpwarn("Drift estimate out of range: %lld\n",
-                  (long long)drift_ppb);
-          drift_ppb = state->drift_ppb;
-        }
+          state->last_delta_timestamp = new_time;
+          state->last_delta_ns = 0;
+          state->last_adjtime_ns = 0;
 
-      /* Take direct average of drift estimate for first measurements,
-       * after that update the exponential sliding average.
-       * Measurements are weighted according to the interval, because
-       * drift estimate is more accurate over longer timespan.
-       */
-
-      state->drift_avg_total_ms += interval_ms;
-      max_avg_period_ms = CONFIG_NETUTILS_PTPD_DRIFT_AVERAGE_S
-                          * MSEC_PER_SEC;
-      if (state->drift_avg_total_ms > max_avg_period_ms)
-        {
-          state->drift_avg_total_ms = max_avg_period_ms;
+          if (ret == OK)
+            {
+              ptpinfo("Jumped to timestamp %jd.%09ld s\n",
+                      (intmax_t)new_time.tv_sec, new_time.tv_nsec);
+            }
+          else
+            {
+              ptperr("ptp_settime() failed: %d\n", errno);
+            }
         }
+        break;
 
-      state->drift_ppb += (drift_ppb - state->drift_ppb) * interval_ms
-                        / state->drift_avg_total_ms;
+      case PTPD_SERVO_UNLOCKED:
+        ptpinfo("Delta: %+lld ns, estimating drift\n",
+                (long long)offset_ns);
+        state->last_delta_ns = offset_ns;
+        state->last_delta_timestamp = *local_timestamp;
+        break;
 
-      /* Compute the value we need to give to adjtime() to match the
-       * drift rate.
-       */
+      case PTPD_SERVO_LOCKED:
 
-      adjustment_ns = state->drift_ppb * CONFIG_CLOCK_ADJTIME_PERIOD_MS
-                      / MSEC_PER_SEC;
-
-      /* Drift estimation ensures local clock runs at same rate as remote.
-       *
-       * Adding the current clock offset to adjustment brings the clocks
-       * to match. To avoid individual outliers from causing jitter, we
-       * take the larger signed value of two previous deltas. This is based
-       * on the logic that packets can get delayed in transit, but do not
-       * travel backwards in time.
-       *
-       * Clock offset is applied over ADJTIME_PERIOD. If there is significant
-       * noise in measurements, increasing ADJTIME_PERIOD will reduce its
-       * effect on the local clock run rate.
-       */
+        /* adjtime() slews the clock over CONFIG_CLOCK_ADJTIME_PERIOD_MS,
+         * give it the amount that matches the frequency correction.
+         */
 
-      if (state->last_delta_ns > delta_ns)
-        {
-          adjustment_ns += state->last_delta_ns;
-        }
-      else
-        {
-          adjustment_ns += delta_ns;
-        }
+        state->last_delta_ns = offset_ns;
+        state->last_delta_timestamp = *local_timestamp;
+        state->last_adjtime_ns = ppb * CONFIG_CLOCK_ADJTIME_PERIOD_MS
+                                 / MSEC_PER_SEC;
 
-      /* Apply adjustment and store information for next time */
+        ptpinfo("Delta: %+lld ns, adjustment %+lld ns, freq %+lld ppb, "
+                "drift %+lld ppb\n",
+                (long long)offset_ns,
+                (long long)state->last_adjtime_ns,
+                (long long)ppb,
+                (long long)state->servo.drift_ppb);
 
-      state->last_delta_ns = delta_ns;
-      state->last_delta_timestamp = *local_timestamp;
-      state->last_adjtime_ns = adjustment_ns;
+        ret = ptp_adjtime(state, state->last_adjtime_ns, ppb);
+        if (ret != OK)
+          {
+            ptperr("ptp_adjtime() failed: %d\n", errno);
+          }
 
-      ptpinfo("Delta: %+lld ns, adjustment %+lld ns, drift rate %+lld ppb\n",
-              (long long)delta_ns,
-              (long long)state->last_adjtime_ns,
-              (long long)state->drift_ppb);
+        /* Check if clock is stable enough for sending delay requests */
 
-      if (absdelta_ns > CONFIG_NETUTILS_PTPD_ADJTIME_THRESHOLD_NS)
-        {
-          ret = ptp_adjtime(state, delta_ns, drift_ppb);
-        }
-      else
-        {
-          ret = ptp_adjtime(state, adjustment_ns, state->drift_ppb);
-        }
+        if (offset_ns > -CONFIG_NETUTILS_PTPD_MAX_PATH_DELAY_NS &&
+            offset_ns < CONFIG_NETUTILS_PTPD_MAX_PATH_DELAY_NS)
+          {
+            state->can_send_delayreq = true;
+          }
 
-      if (ret != OK)
-        {
-          ptperr("ptp_adjtime() failed: %d\n", errno);
-        }
-
-      /* Check if clock is stable enough for sending delay requests */
-
-      if (absdelta_ns < CONFIG_NETUTILS_PTPD_MAX_PATH_DELAY_NS)
-        {
-          state->can_send_delayreq = true;
-        }
+        break;
     }
 
   return ret;
@@ -1344,10 +1291,10 @@ static int ptp_process_delay_resp(FAR struct ptp_state_s *state,
                                   FAR struct ptp_delay_resp_s *msg)
 {
   int64_t path_delay;
-  int64_t sync_delay;
   struct timespec remote_rxtime;
   uint16_t sequence;
   int interval;
+  int ret;
 
   if (!state->selected_source_valid ||
       memcmp(msg->header.sourceidentity,
@@ -1369,35 +1316,31 @@ static int ptp_process_delay_resp(FAR struct ptp_state_s *state,
       return OK;
     }
 
-  /* Path delay is calculated as the average between delta for sync
-   * message and delta for delay req message.
-   * (IEEE-1588 section 11.3: Delay request-response mechanism)
+  /* The servo pairs the delay request with the latest sync and filters
+   * the path delay.
    */
 
   ptp_format_to_timespec(msg->receivetimestamp, &remote_rxtime);
-  path_delay = timespec_delta_ns(&remote_rxtime, &state->delayreq_time);
-  sync_delay = state->path_delay_ns - state->last_delta_ns;
-  path_delay = (path_delay + sync_delay) / 2;
-
-  if (path_delay >= 0 && path_delay < CONFIG_NETUTILS_PTPD_MAX_PATH_DELAY_NS)
+  ret = ptpd_servo_delay(&state->servo,
+                         timespec_delta_ns(&remote_rxtime,
+                                           &state->delayreq_time),
+                         (int64_t)state->delayreq_time.tv_sec *
+                         NSEC_PER_SEC + state->delayreq_time.tv_nsec,
+                         &path_delay);
+  if (ret == OK)
     {
-      if (state->path_delay_avgcount <
-          CONFIG_NETUTILS_PTPD_DELAYREQ_AVGCOUNT)
-        {
-          state->path_delay_avgcount++;
-        }
-
-      state->path_delay_ns += (path_delay - state->path_delay_ns)
-                              / state->path_delay_avgcount;
-
-      ptpinfo("Path delay: %ld ns (avg: %ld ns)\n",
-        (long)path_delay, (long)state->path_delay_ns);
+      ptpinfo("Path delay: %ld ns (filtered: %ld ns)\n",
+              (long)path_delay, (long)state->servo.delay_ns);
     }
-  else
+  else if (ret == -EDOM)
     {
       ptpwarn("Path delay out of range: %lld ns\n",
               (long long)path_delay);
     }
+  else
+    {
+      ptpinfo("Path delay outlier: %lld ns\n", (long long)path_delay);
+    }
 
   /* Calculate interval until next packet */
 
@@ -1565,8 +1508,17 @@ static void ptp_process_statusreq(FAR struct ptp_state_s *state)
   status->last_clock_update = state->last_delta_timestamp;
   status->last_delta_ns     = state->last_delta_ns;
   status->last_adjtime_ns   = state->last_adjtime_ns;
-  status->drift_ppb         = state->drift_ppb;
-  status->path_delay_ns     = state->path_delay_ns;
+  status->drift_ppb         = state->servo.drift_ppb;
+  status->path_delay_ns     = state->servo.delay_ns;
+
+  /* Copy servo statistics */
+
+  status->servo_locked = state->servo.state == PTPD_SERVO_LOCKED;
+  status->nsamples     = state->servo.nsamples;
+  status->noutliers    = state->servo.noutliers;
+  status->offset_stats = state->servo.offset_stats;
+  status->delay_stats  = state->servo.delay_stats;
+  status->freq_stats   = state->servo.freq_stats;
 
   /* Copy timestamps */
 
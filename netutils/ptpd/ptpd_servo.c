@@ -0,0 +1,634 @@
+/****************************************************************************
+ * apps/netutils/ptpd/ptpd_servo.c
+ *
+ * SPDX-License-Identifier: Apache-2.0
+ *
+ * Licensed to the Apache Software Foundation (ASF) under one or more
+ * contributor license agreements.  See the NOTICE file distributed with
+ * this work for additional information regarding copyright ownership.  The
+ * ASF licenses this file to you under the Apache License, Version 2.0 (the
+ * "License"); you may not use this file except in compliance with the
+ * License.  You may obtain a copy of the License at
+ *
+ *   http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS, WITHOUT
+ * WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.  See the
+ * License for the specific language governing permissions and limitations
+ * under the License.
+ *
+ ****************************************************************************/
+
+/****************************************************************************
+ * Included Files
+ ****************************************************************************/
+
+#include <nuttx/config.h>
+
+#include <errno.h>
+#include <stdint.h>
+#include <string.h>
+
+#include <nuttx/clock.h>
+
+#include "ptpd_servo.h"
+
+/****************************************************************************
+ * Pre-processor Definitions
+ ****************************************************************************/
+
+#define PTPD_ABS(x)       ((x) < 0 ? -(x) : (x))
+
+/* The clock has settled when the offset is within this many times the
+ * timestamp noise.
+ */
+
+#define PTPD_SERVO_SETTLED 10
+
+/****************************************************************************
+ * Private Functions
+ ****************************************************************************/
+
+/****************************************************************************
+ * Name: ptpd_clamp
+ ****************************************************************************/
+
+static int64_t ptpd_clamp(int64_t value, int64_t limit)
+{
+  if (value > limit)
+    {
+      return limit;
+    }
+
+  if (value < -limit)
+    {
+      return -limit;
+    }
+
+  return value;
+}
+
+/****************************************************************************
+ * Name: ptpd_isqrt
+ ****************************************************************************/
+
+static uint64_t ptpd_isqrt(uint64_t value)
+{
+  uint64_t root = 0;
+  uint64_t bit = (uint64_t)1 << 62;
+
+  while (bit > value)
+    {
+      bit >>= 2;
+    }
+
+  while (bit != 0)
+    {
+      if (value >= root + bit)
+        {
+          value -= root + bit;
+          root = (root >> 1) + bit;
+        }
+      else
+        {
+          root >>= 1;
+        }
+
+      bit >>= 2;
+    }
+
+  return root;
+}
+
+/****************************************************************************
+ * Name: ptpd_sort
+ *
+ * Description:
+ *   Insertion sort, the windows are a few dozen samples at most.
+ *
+ ****************************************************************************/
+
+static void ptpd_sort(FAR int64_t *values, int count)
+{
+  int64_t value;
+  int i;
+  int j;
+
+  for (i = 1; i < count; i++)
+    {
+      value = values[i];
+      for (j = i; j > 0 && values[j - 1] > value; j--)
+        {
+          values[j] = values[j - 1];
+        }
+
+      values[j] = value;
+    }
+}
+
+/****************************************************************************
+ * Name: ptpd_median
+ *
+ * Description:
+ *   Median of count values, the values are sorted in place.
+ *
+ ****************************************************************************/
+
+static int64_t ptpd_median(FAR int64_t *values, int count)
+{
+  ptpd_sort(values, count);
+  if (count & 1)
+    {
+      return values[count / 2];
+    }
+
+  return (values[count / 2 - 1] + values[count / 2]) / 2;
+}
+
+/****************************************************************************
+ * Name: ptpd_filter_clear
+ ****************************************************************************/
+
+static void ptpd_filter_clear(FAR struct ptpd_filter_s *filter)
+{
+  filter->head = 0;
+  filter->count = 0;
+  filter->nrejected = 0;
+}
+
+/****************************************************************************
+ * Name: ptpd_filter_shift
+ ****************************************************************************/
+
+static void ptpd_filter_shift(FAR struct ptpd_filter_s *filter,
+                              int64_t delta)
+{
+  int i;
+
+  for (i = 0; i < filter->count; i++)
+    {
+      filter->sample[i] += delta;
+    }
+}
+
+/****************************************************************************
+ * Name: ptpd_filter_select
+ *
+ * Description:
+ *   Pick the value of the window.  Queuing in the network and in the
+ *   software timestamping path only ever adds delay, so the fastest
+ *   sample ("lucky packet") is the best one.  Hardware timestamps remove
+ *   the software part only, the median is used for them if
+ *   CONFIG_NETUTILS_PTPD_FILTER_MIN_HW is disabled.
+ *
+ ****************************************************************************/
+
+static int64_t ptpd_filter_select(FAR struct ptpd_servo_s *servo,
+                                  FAR struct ptpd_filter_s *filter)
+{
+  int64_t values[CONFIG_NETUTILS_PTPD_FILTER_LENGTH];
+  int64_t best;
+  int i;
+
+  if (servo->lucky)
+    {
+      best = filter->sample[0];
+      for (i = 1; i < filter->count; i++)
+        {
+          if (filter->sample[i] < best)
+            {
+              best = filter->sample[i];
+            }
+        }
+
+      return best;
+    }
+
+  memcpy(values, filter->sample, filter->count * sizeof(values[0]));
+  return ptpd_median(values, filter->count);
+}
+
+/****************************************************************************
+ * Name: ptpd_filter_add
+ *
+ * Description:
+ *   Add a sample to the window unless it is an outlier: further from the
+ *   median than outlier times the median absolute deviation plus the
+ *   timestamp noise.  Half a window of consecutive outliers means that
+ *   the path changed, the window then restarts from the new sample.
+ *
+ *   The lucky packet filter takes every sample.  Slow ones cannot mislead
+ *   the minimum, and a window that only holds queued samples makes a
+ *   fast one look like an outlier although it is the one to keep.  A
+ *   bogus fast sample is held off by the servo instead, see
+ *   ptpd_servo_sync().
+ *
+ ****************************************************************************/
+
+static int ptpd_filter_add(FAR struct ptpd_servo_s *servo,
+                           FAR struct ptpd_filter_s *filter,
+                           int64_t sample)
+{
+  int64_t values[CONFIG_NETUTILS_PTPD_FILTER_LENGTH];
+  int64_t median;
+  int64_t mad;
+  int64_t dev;
+  int i;
+
+  if (!servo->lucky && servo->outlier > 0 &&
+      filter->count >= servo->length && servo->length > 2)
+    {
+      memcpy(values, filter->sample, filter->count * sizeof(values[0]));
+      median = ptpd_median(values, filter->count);
+
+      for (i = 0; i < filter->count; i++)
+        {
+          values[i] = PTPD_ABS(values[i] - median);
+        }
+
+      mad = ptpd_median(values, filter->count);
+      dev = PTPD_ABS(sample - median);
+      if (dev > servo->outlier * mad + servo->noise_ns)
+        {
+          if (++filter->nrejected < (servo->length + 1) / 2)
+            {
+              servo->noutliers++;
+              return -ERANGE;
+            }
+
+          ptpd_filter_clear(filter);
+        }
+    }
+
+  filter->nrejected = 0;
+  filter->sample[filter->head] = sample;
+  filter->head = (filter->head + 1) % servo->length;
+  if (filter->count < servo->length)
+    {
+      filter->count++;
+    }
+
+  return OK;
+}
+
+/****************************************************************************
+ * Name: ptpd_accum_add
+ ****************************************************************************/
+
+static void ptpd_accum_add(FAR struct ptpd_accum_s *acc, int64_t value)
+{
+  uint64_t absval = PTPD_ABS(value);
+  uint64_t square;
+
+  square = absval > UINT32_MAX ? UINT64_MAX : absval * absval;
+  acc->sumsq = acc->sumsq > UINT64_MAX - square ?
+               UINT64_MAX : acc->sumsq + square;
+  acc->sum += value;
+  acc->count++;
+
+  if ((int64_t)absval > acc->max)
+    {
+      acc->max = absval;
+    }
+}
+
+/****************************************************************************
+ * Name: ptpd_accum_publish
+ ****************************************************************************/
+
+static void ptpd_accum_publish(FAR struct ptpd_accum_s *acc,
+                               FAR struct ptpd_statistics_s *stats)
+{
+  if (acc->count > 0)
+    {
+      stats->mean = acc->sum / (int64_t)acc->count;
+      stats->rms  = ptpd_isqrt(acc->sumsq / acc->count);
+      stats->max  = acc->max;
+    }
+
+  memset(acc, 0, sizeof(*acc));
+}
+
+/****************************************************************************
+ * Name: ptpd_servo_update
+ *
+ * Description:
+ *   One step of the PI controller on the filtered offset.
+ *
+ ****************************************************************************/
+
+static int64_t ptpd_servo_update(FAR struct ptpd_servo_s *servo,
+                                 int64_t offset, int64_t interval_ns)
+{
+  int64_t interval_ms = interval_ns / NSEC_PER_MSEC;
+  int64_t kp = servo->kp;
+  int64_t freq;
+
+  /* Never correct more than the whole offset within one interval, the
+   * loop would overshoot.
+   */
+
+  if (interval_ms > 0 && kp * interval_ms > 1000000)
+    {
+      kp = 1000000 / interval_ms;
+    }
+
+  servo->drift_ppb += offset * servo->ki * interval_ms / 1000000;
+  servo->drift_ppb  = ptpd_clamp(servo->drift_ppb, servo->maxppb);
+
+  freq = offset * kp / 1000 + servo->drift_ppb;
+  return ptpd_clamp(freq, servo->maxppb);
+}
+
+/****************************************************************************
+ * Public Functions
+ ****************************************************************************/
+
+/****************************************************************************
+ * Name: ptpd_servo_init
+ ****************************************************************************/
+
+void ptpd_servo_init(FAR struct ptpd_servo_s *servo, bool hardware_ts,
+                     int32_t maxppb, int64_t step_ns)
+{
+  memset(servo, 0, sizeof(*servo));
+
+  servo->hwts = hardware_ts;
+  if (hardware_ts)
+    {
+      servo->kp       = CONFIG_NETUTILS_PTPD_SERVO_KP_HW;
+      servo->ki       = CONFIG_NETUTILS_PTPD_SERVO_KI_HW;
+      servo->noise_ns = PTPD_SERVO_NOISE_HW_NS;
+#ifdef CONFIG_NETUTILS_PTPD_FILTER_MIN_HW
+      servo->lucky    = true;
+#else
+      servo->lucky    = false;
+#endif
+    }
+  else
+    {
+      servo->kp       = CONFIG_NETUTILS_PTPD_SERVO_KP_SW;
+      servo->ki       = CONFIG_NETUTILS_PTPD_SERVO_KI_SW;
+      servo->noise_ns = PTPD_SERVO_NOISE_SW_NS;
+      servo->lucky    = true;
+    }
+
+  servo->maxppb  = maxppb;
+  servo->step_ns = step_ns;
+  servo->length  = CONFIG_NETUTILS_PTPD_FILTER_LENGTH;
+  servo->outlier = CONFIG_NETUTILS_PTPD_OUTLIER_FACTOR;
+
+  ptpd_servo_reset(servo);
+}
+
+/****************************************************************************
+ * Name: ptpd_servo_reset
+ ****************************************************************************/
+
+void ptpd_servo_reset(FAR struct ptpd_servo_s *servo)
+{
+  ptpd_filter_clear(&servo->sync);
+  ptpd_filter_clear(&servo->delay);
+
+  servo->state          = PTPD_SERVO_UNLOCKED;
+  servo->nunlocked      = 0;
+  servo->nheld          = 0;
+  servo->settled        = false;
+  servo->drift_ppb      = servo->freq_ppb;
+  servo->offset_ns      = 0;
+  servo->sync_ns        = 0;
+  servo->transit_ns     = 0;
+  servo->delay_ns       = 0;
+  servo->delay_avgcount = 0;
+  servo->nsamples       = 0;
+  servo->noutliers      = 0;
+
+  memset(&servo->offset_acc, 0, sizeof(servo->offset_acc));
+  memset(&servo->delay_acc, 0, sizeof(servo->delay_acc));
+  memset(&servo->freq_acc, 0, sizeof(servo->freq_acc));
+  memset(&servo->offset_stats, 0, sizeof(servo->offset_stats));
+  memset(&servo->delay_stats, 0, sizeof(servo->delay_stats));
+  memset(&servo->freq_stats, 0, sizeof(servo->freq_stats));
+}
+
+/****************************************************************************
+ * Name: ptpd_servo_sync
+ ****************************************************************************/
+
+int ptpd_servo_sync(FAR struct ptpd_servo_s *servo, int64_t transit_ns,
+                    int64_t local_ns, FAR int64_t *offset_ns,
+                    FAR int64_t *ppb)
+{
+  int64_t interval_ns = 0;
+  int64_t offset;
+
+  if (servo->nsamples > 0)
+    {
+      interval_ns = local_ns - servo->last_local_ns;
+      if (interval_ns <= 0 ||
+          interval_ns > CONFIG_NETUTILS_PTPD_TIMEOUT_MS *
+                        (int64_t)NSEC_PER_MSEC)
+        {
+          /* The old samples say nothing about the clock anymore */
+
+          ptpd_filter_clear(&servo->sync);
+          servo->nunlocked = 0;
+          servo->state = PTPD_SERVO_UNLOCKED;
+          interval_ns = 0;
+        }
+      else
+        {
+          /* Bring the samples in the window to the current local clock:
+           * the transit time grows with the correction applied beyond
+           * the estimated drift.
+           */
+
+          ptpd_filter_shift(&servo->sync,
+                            (servo->freq_ppb - servo->drift_ppb) *
+                            interval_ns / NSEC_PER_SEC);
+        }
+    }
+
+  servo->last_local_ns = local_ns;
+  servo->transit_ns = transit_ns;
+  servo->nsamples++;
+
+  ptpd_filter_add(servo, &servo->sync, transit_ns);
+  servo->sync_ns = ptpd_filter_select(servo, &servo->sync);
+  offset = servo->delay_ns - servo->sync_ns;
+  servo->offset_ns = offset;
+
+  if (PTPD_ABS(offset) > servo->step_ns)
+    {
+      /* Step by the latest sample, the window describes the clock before
+       * the step.
+       */
+
+      ptpd_filter_clear(&servo->sync);
+      if (servo->state == PTPD_SERVO_UNLOCKED)
+        {
+          servo->nunlocked = 0;
+        }
+
+      servo->freq_ppb = servo->drift_ppb;
+      servo->settled  = false;
+      *offset_ns = servo->delay_ns - transit_ns;
+      *ppb = servo->freq_ppb;
+      return PTPD_SERVO_JUMP;
+    }
+
+  if (servo->state == PTPD_SERVO_UNLOCKED)
+    {
+      /* Estimate the drift over the first window before closing the
+       * loop, the integral term alone would take long to find it.
+       */
+
+      if (servo->nunlocked++ == 0)
+        {
+          servo->first_local_ns  = local_ns;
+          servo->first_offset_ns = offset;
+        }
+
+      if (servo->nunlocked < servo->length || servo->nunlocked < 2)
+        {
+          *offset_ns = offset;
+          *ppb = servo->freq_ppb;
+          return PTPD_SERVO_UNLOCKED;
+        }
+
+      servo->drift_ppb = servo->freq_ppb +
+                         (offset - servo->first_offset_ns) * NSEC_PER_SEC /
+                         (local_ns - servo->first_local_ns);
+      servo->drift_ppb = ptpd_clamp(servo->drift_ppb, servo->maxppb);
+      servo->state = PTPD_SERVO_LOCKED;
+
+      /* The window was not corrected for the drift, start it over */
+
+      ptpd_filter_clear(&servo->sync);
+      ptpd_filter_add(servo, &servo->sync, transit_ns);
+      servo->sync_ns = transit_ns;
+      offset = servo->delay_ns - transit_ns;
+      servo->offset_ns = offset;
+    }
+
+  /* When every packet of a window was delayed, or a single one arrived
+   * faster than possible, the selected sample is wrong as well.  Run on
+   * the drift estimate alone while the offset is far beyond what the
+   * last statistics interval saw, for as long as such a sample can stay
+   * in the window.
+   */
+
+  if (servo->outlier > 0 && servo->offset_stats.max > 0 &&
+      PTPD_ABS(offset) > servo->outlier * servo->offset_stats.rms +
+                         servo->noise_ns &&
+      servo->nheld++ < servo->length)
+    {
+      servo->noutliers++;
+      servo->freq_ppb = servo->drift_ppb;
+      *offset_ns = offset;
+      *ppb = servo->freq_ppb;
+      return PTPD_SERVO_LOCKED;
+    }
+
+  servo->nheld = 0;
+  servo->freq_ppb = ptpd_servo_update(servo, offset, interval_ns);
+
+  ptpd_accum_add(&servo->offset_acc, offset);
+  ptpd_accum_add(&servo->freq_acc, servo->freq_ppb);
+  if (servo->offset_acc.count >= CONFIG_NETUTILS_PTPD_STATS_INTERVAL)
+    {
+      ptpd_accum_publish(&servo->offset_acc, &servo->offset_stats);
+      ptpd_accum_publish(&servo->delay_acc, &servo->delay_stats);
+      ptpd_accum_publish(&servo->freq_acc, &servo->freq_stats);
+
+      if (servo->offset_stats.rms <= PTPD_SERVO_SETTLED * servo->noise_ns)
+        {
+          servo->settled = true;
+        }
+    }
+
+  *offset_ns = offset;
+  *ppb = servo->freq_ppb;
+  return PTPD_SERVO_LOCKED;
+}
+
+/****************************************************************************
+ * Name: ptpd_servo_delay
+ ****************************************************************************/
+
+int ptpd_servo_delay(FAR struct ptpd_servo_s *servo, int64_t transit_ns,
+                     int64_t local_ns, FAR int64_t *delay_ns)
+{
+  int64_t selected;
+  int64_t sync_ns;
+  int ret;
+
+  /* Path delay is the average of the transit times in both directions
+   * (IEEE-1588 section 11.3).  The latest sync is paired with the
+   * request, brought to the time the request was sent: the filtered
+   * transit lags behind while the clock is still moving.  Once it has
+   * settled, hardware timestamps pair the filtered transit instead, so
+   * that a queued sync does not spoil the request.  Software send
+   * timestamps run early by about as much as the receive timestamps run
+   * late, that only cancels within the same exchange.
+   */
+
+  sync_ns = servo->hwts && servo->settled ? servo->sync_ns :
+                                            servo->transit_ns;
+  if (servo->nsamples > 0 && local_ns > servo->last_local_ns)
+    {
+      sync_ns += (servo->freq_ppb - servo->drift_ppb) *
+                 (local_ns - servo->last_local_ns) / NSEC_PER_SEC;
+    }
+
+  *delay_ns = (transit_ns + sync_ns) / 2;
+  if (*delay_ns < 0 || *delay_ns >= CONFIG_NETUTILS_PTPD_MAX_PATH_DELAY_NS)
+    {
+      return -EDOM;
+    }
+
+  /* Measurements taken while the clock is still being pulled in are
+   * biased by its movement, use them alone until it has settled so that
+   * they do not linger in the filter and in the average.  Once settled,
+   * a sync window that was queued as a whole must not throw the estimate
+   * away again.
+   */
+
+  if (!servo->settled &&
+      PTPD_ABS(servo->offset_ns) > PTPD_SERVO_SETTLED * servo->noise_ns)
+    {
+      ptpd_filter_clear(&servo->delay);
+      servo->delay_avgcount = 0;
+    }
+
+  ret = ptpd_filter_add(servo, &servo->delay, *delay_ns);
+  if (ret < 0)
+    {
+      return ret;
+    }
+
+  /* Smooth the filtered value as well, it changes the offset of every
+   * following sync.
+   */
+
+  selected = ptpd_filter_select(servo, &servo->delay);
+  if (servo->hwts && servo->delay.count < servo->length)
+    {
+      /* Until the window is full it may not hold a lucky sample yet.  The
+       * hardware timestamps are precise enough that such a miss would be
+       * the largest error in the average, start it over.
+       */
+
+      servo->delay_avgcount = 0;
+    }
+
+  if (servo->delay_avgcount < CONFIG_NETUTILS_PTPD_DELAYREQ_AVGCOUNT)
+    {
+      servo->delay_avgcount++;
+    }
+
+  servo->delay_ns += (selected - servo->delay_ns) / servo->delay_avgcount;
+  ptpd_accum_add(&servo->delay_acc, servo->delay_ns);
+  return OK;
+}
@@ -0,0 +1,204 @@
+/****************************************************************************
+ * apps/netutils/ptpd/ptpd_servo.h
+ *
+ * SPDX-License-Identifier: Apache-2.0
+ *
+ * Licensed to the Apache Software Foundation (ASF) under one or more
+ * contributor license agreements.  See the NOTICE file distributed with
+ * this work for additional information regarding copyright ownership.  The
+ * ASF licenses this file to you under the Apache License, Version 2.0 (the
+ * "License"); you may not use this file except in compliance with the
+ * License.  You may obtain a copy of the License at
+ *
+ *   http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS, WITHOUT
+ * WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.  See the
+ * License for the specific language governing permissions and limitations
+ * under the License.
+ *
+ ****************************************************************************/
+
+#ifndef __APPS_NETUTILS_PTPD_PTPD_SERVO_H
+#define __APPS_NETUTILS_PTPD_PTPD_SERVO_H
+
+/****************************************************************************
+ * Included Files
+ ****************************************************************************/
+
+#include <nuttx/config.h>
+
+#include <stdbool.h>
+#include <stdint.h>
+
+#include <netutils/ptpd.h>
+
+/****************************************************************************
+ * Pre-processor Definitions
+ ****************************************************************************/
+
+/* Result of ptpd_servo_sync() */
+
+#define PTPD_SERVO_UNLOCKED   0  /* Collecting samples, keep the frequency */
+#define PTPD_SERVO_JUMP       1  /* Step the clock by the offset */
+#define PTPD_SERVO_LOCKED     2  /* Apply the frequency correction */
+
+/* Timestamp noise that is never treated as an outlier */
+
+#define PTPD_SERVO_NOISE_HW_NS     100
+#define PTPD_SERVO_NOISE_SW_NS     10000
+
+/****************************************************************************
+ * Public Types
+ ****************************************************************************/
+
+/* Sliding window over the latest samples of one measurement */
+
+struct ptpd_filter_s
+{
+  int64_t sample[CONFIG_NETUTILS_PTPD_FILTER_LENGTH];
+  uint8_t head;                 /* Slot of the next sample */
+  uint8_t count;                /* Number of valid samples */
+  uint8_t nrejected;            /* Consecutive rejected samples */
+};
+
+/* Running sums for one statistics interval */
+
+struct ptpd_accum_s
+{
+  int64_t sum;
+  uint64_t sumsq;               /* Saturates instead of wrapping */
+  int64_t max;
+  uint32_t count;
+};
+
+/* Clock servo state.  The tuning fields are set by ptpd_servo_init() and
+ * may be changed before the first sample.
+ *
+ * The sync filter holds the transit time of the sync messages (local
+ * receive time minus remote send time), which is the path delay minus
+ * the clock offset.  Older samples are moved forward by the frequency
+ * correction applied since they were taken, so that they stay comparable
+ * with the newest one.
+ */
+
+struct ptpd_servo_s
+{
+  /* Tuning */
+
+  int32_t kp;                   /* Proportional gain, 1/1000 s^-1 */
+  int32_t ki;                   /* Integral gain, 1/1000 s^-2 */
+  int32_t maxppb;               /* Limit of the frequency correction */
+  int64_t step_ns;              /* Larger offsets step the clock */
+  int64_t noise_ns;             /* Timestamp noise floor */
+  uint8_t length;               /* Filter window, at most FILTER_LENGTH */
+  uint8_t outlier;              /* Rejection threshold in MADs, 0 = off */
+  bool lucky;                   /* Select the minimum instead of median */
+  bool hwts;                    /* Timestamps are taken by hardware */
+
+  /* Servo */
+
+  int state;                    /* PTPD_SERVO_UNLOCKED or _LOCKED */
+  int nunlocked;                /* Samples collected while unlocked */
+  int nheld;                    /* Consecutive samples not applied */
+  bool settled;                 /* Offset RMS was within the noise */
+  int64_t first_local_ns;       /* Local time of the first sample */
+  int64_t first_offset_ns;      /* Offset of the first sample */
+  int64_t last_local_ns;        /* Local time of the latest sample */
+  int64_t drift_ppb;            /* Integral term, frequency error */
+  int64_t freq_ppb;             /* Correction currently applied */
+  int64_t offset_ns;            /* Filtered offset of the latest sample */
+
+  /* Filters */
+
+  struct ptpd_filter_s sync;
+  struct ptpd_filter_s delay;
+  int64_t sync_ns;              /* Filtered sync transit time */
+  int64_t transit_ns;           /* Transit time of the latest sync */
+  int64_t delay_ns;             /* Filtered path delay */
+  int delay_avgcount;
+  uint32_t nsamples;
+  uint32_t noutliers;
+
+  /* Statistics of the current and of the last complete interval */
+
+  struct ptpd_accum_s offset_acc;
+  struct ptpd_accum_s delay_acc;
+  struct ptpd_accum_s freq_acc;
+  struct ptpd_statistics_s offset_stats;
+  struct ptpd_statistics_s delay_stats;
+  struct ptpd_statistics_s freq_stats;
+};
+
+/****************************************************************************
+ * Public Function Prototypes
+ ****************************************************************************/
+
+/****************************************************************************
+ * Name: ptpd_servo_init
+ *
+ * Description:
+ *   Initialize the servo with the gains and filter mode for hardware or
+ *   software timestamps.  maxppb is the largest frequency correction the
+ *   clock accepts, offsets larger than step_ns step the clock.
+ *
+ ****************************************************************************/
+
+void ptpd_servo_init(FAR struct ptpd_servo_s *servo, bool hardware_ts,
+                     int32_t maxppb, int64_t step_ns);
+
+/****************************************************************************
+ * Name: ptpd_servo_reset
+ *
+ * Description:
+ *   Forget the samples of the previous clock source.  The frequency
+ *   correction in effect is kept, the clock keeps running with it.
+ *
+ ****************************************************************************/
+
+void ptpd_servo_reset(FAR struct ptpd_servo_s *servo);
+
+/****************************************************************************
+ * Name: ptpd_servo_sync
+ *
+ * Description:
+ *   Feed the transit time of a sync message, local receive time minus
+ *   remote send time, received at local time local_ns.
+ *
+ * Output Parameters:
+ *   offset_ns - Clock offset, remote minus local time.  For
+ *               PTPD_SERVO_JUMP the clock should be stepped by it.
+ *   ppb       - Frequency correction to apply, positive speeds the local
+ *               clock up.
+ *
+ * Returned Value:
+ *   PTPD_SERVO_UNLOCKED, PTPD_SERVO_JUMP or PTPD_SERVO_LOCKED.
+ *
+ ****************************************************************************/
+
+int ptpd_servo_sync(FAR struct ptpd_servo_s *servo, int64_t transit_ns,
+                    int64_t local_ns, FAR int64_t *offset_ns,
+                    FAR int64_t *ppb);
+
+/****************************************************************************
+ * Name: ptpd_servo_delay
+ *
+ * Description:
+ *   Feed the transit time of a delay request, remote receive time minus
+ *   local send time, sent at local time local_ns.  The filtered path
+ *   delay is in servo->delay_ns.
+ *
+ * Output Parameters:
+ *   delay_ns - The path delay measured by this request.
+ *
+ * Returned Value:
+ *   Zero if the sample was used, -EDOM if the delay is out of range or
+ *   -ERANGE if it was rejected as outlier.
+ *
+ ****************************************************************************/
+
+int ptpd_servo_delay(FAR struct ptpd_servo_s *servo, int64_t transit_ns,
+                     int64_t local_ns, FAR int64_t *delay_ns);
+
+#endif /* __APPS_NETUTILS_PTPD_PTPD_SERVO_H */
@@ -36,6 +36,10 @@
 #include <poll.h>
 #include <syslog.h>
 
+#ifdef CONFIG_NETUTILS_REXECD_SERVERPOOL
+#  include "netutils/netlib.h"
+#endif
+
 /****************************************************************************
  * Pre-processor Definitions
  ****************************************************************************/
@@ -175,12 +179,16 @@ static void usage(FAR const char *progname)
 int main(int argc, FAR char **argv)
 {
   struct sockaddr_storage addr;
+#ifdef CONFIG_NETUTILS_REXECD_SERVERPOOL
+  struct netlib_server_s server;
+#else
   pthread_attr_t attr;
   pthread_t tid;
+  int sock;
+#endif
   int family;
   int option;
   int serv;
-  int sock;
   int ret;
 
   family = AF_INET;
@@ -241,6 +249,17 @@ int main(int argc, FAR char **argv)
       goto err_out;
     }
 
+#ifdef CONFIG_NETUTILS_REXECD_SERVERPOOL
+  /* Run the commands on the pre-spawned workers */
+
+  netlib_server_init(&server, NETLIB_SERVER_POOL);
+  server.nworkers  = CONFIG_NETUTILS_REXECD_WORKERS;
+  server.backlog   = CONFIG_NETUTILS_REXECD_BACKLOG;
+  server.stacksize = CONFIG_NETUTILS_REXECD_STACKSIZE;
+  server.handler   = doit;
+
+  ret = netlib_server_run(&server, serv);
+#else
   ret = pthread_attr_init(&attr);
   if (ret != 0)
     {
@@ -284,6 +303,7 @@ int main(int argc, FAR char **argv)
 
 attr_out:
   pthread_attr_destroy(&attr);
+#endif
 err_out:
   syslog(LOG_ERR, "rexecd failed ret:%d errno:%d\n", ret, errno);
   close(serv);
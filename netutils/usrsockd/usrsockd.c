@@ -0,0 +1,721 @@
+/****************************************************************************
+ * apps/netutils/usrsockd/usrsockd.c
+ *
+ * SPDX-License-Identifier: Apache-2.0
+ *
+ * Licensed to the Apache Software Foundation (ASF) under one or more
+ * contributor license agreements.  See the NOTICE file distributed with
+ * this work for additional information regarding copyright ownership.  The
+ * ASF licenses this file to you under the Apache License, Version 2.0 (the
+ * "License"); you may not use this file except in compliance with the
+ * License.  You may obtain a copy of the License at
+ *
+ *   http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS, WITHOUT
+ * WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.  See the
+ * License for the specific language governing permissions and limitations
+ * under the License.
+ *
+ ****************************************************************************/
+
+/****************************************************************************
+ * Included Files
+ ****************************************************************************/
+
+#include <nuttx/config.h>
+
+#include <errno.h>
+#include <fcntl.h>
+#include <stdbool.h>
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+
+#include "netutils/usrsockd.h"
+
+/****************************************************************************
+ * Pre-processor Definitions
+ ****************************************************************************/
+
+/* Initial size of the request buffer, enough for every fixed part and
+ * the usual addresses.  It grows to fit larger send requests.
+ */
+
+#define USRSOCKD_REQSIZE 256
+
+/****************************************************************************
+ * Private Data
+ ****************************************************************************/
+
+/* Size of the fixed part of each request */
+
+static const uint8_t g_usrsockd_hdrlen[USRSOCK_REQUEST__MAX] =
+{
+  [USRSOCK_REQUEST_SOCKET]      = sizeof(struct usrsock_request_socket_s),
+  [USRSOCK_REQUEST_CLOSE]       = sizeof(struct usrsock_request_close_s),
+  [USRSOCK_REQUEST_CONNECT]     = sizeof(struct usrsock_request_connect_s),
+  [USRSOCK_REQUEST_SENDTO]      = sizeof(struct usrsock_request_sendto_s),
+  [USRSOCK_REQUEST_RECVFROM]    =
+    sizeof(struct usrsock_request_recvfrom_s),
+  [USRSOCK_REQUEST_SETSOCKOPT]  =
+    sizeof(struct usrsock_request_setsockopt_s),
+  [USRSOCK_REQUEST_GETSOCKOPT]  =
+    sizeof(struct usrsock_request_getsockopt_s),
+  [USRSOCK_REQUEST_GETSOCKNAME] =
+    sizeof(struct usrsock_request_getsockname_s),
+  [USRSOCK_REQUEST_GETPEERNAME] =
+    sizeof(struct usrsock_request_getpeername_s),
+  [USRSOCK_REQUEST_BIND]        = sizeof(struct usrsock_request_bind_s),
+  [USRSOCK_REQUEST_LISTEN]      = sizeof(struct usrsock_request_listen_s),
+  [USRSOCK_REQUEST_ACCEPT]      = sizeof(struct usrsock_request_accept_s),
+  [USRSOCK_REQUEST_IOCTL]       = sizeof(struct usrsock_request_ioctl_s),
+  [USRSOCK_REQUEST_SHUTDOWN]    =
+    sizeof(struct usrsock_request_shutdown_s),
+};
+
+/****************************************************************************
+ * Private Functions
+ ****************************************************************************/
+
+/****************************************************************************
+ * Name: usrsockd_reqlen
+ *
+ * Description:
+ *   Return the total length of the request whose fixed part is in buf, or
+ *   zero if the request id is not known.
+ *
+ ****************************************************************************/
+
+static size_t usrsockd_reqlen(FAR const uint8_t *buf)
+{
+  FAR const struct usrsock_request_common_s *com = (FAR const void *)buf;
+  size_t len;
+
+  if (com->reqid < 0 || com->reqid >= USRSOCK_REQUEST__MAX)
+    {
+      return 0;
+    }
+
+  len = g_usrsockd_hdrlen[com->reqid];
+
+  switch (com->reqid)
+    {
+      case USRSOCK_REQUEST_CONNECT:
+        len += ((FAR const struct usrsock_request_connect_s *)buf)->addrlen;
+        break;
+
+      case USRSOCK_REQUEST_BIND:
+        len += ((FAR const struct usrsock_request_bind_s *)buf)->addrlen;
+        break;
+
+      case USRSOCK_REQUEST_SENDTO:
+        {
+          FAR const struct usrsock_request_sendto_s *req =
+            (FAR const void *)buf;
+
+          len += req->addrlen + req->buflen;
+        }
+        break;
+
+      case USRSOCK_REQUEST_SETSOCKOPT:
+        len += ((FAR const struct usrsock_request_setsockopt_s *)buf)->
+               valuelen;
+        break;
+
+      case USRSOCK_REQUEST_IOCTL:
+        len += ((FAR const struct usrsock_request_ioctl_s *)buf)->arglen;
+        break;
+
+      default:
+        break;
+    }
+
+  return len;
+}
+
+/****************************************************************************
+ * Name: usrsockd_readreq
+ *
+ * Description:
+ *   Read the next request into ud->reqbuf.  Returns its length, zero if
+ *   there is none pending, or a negated errno value.
+ *
+ ****************************************************************************/
+
+static ssize_t usrsockd_readreq(FAR struct usrsockd_s *ud)
+{
+  FAR struct usrsock_request_common_s *com;
+  FAR uint8_t *newbuf;
+  ssize_t nread;
+  size_t reqlen;
+  size_t off;
+
+  do
+    {
+      nread = read(ud->fd, ud->reqbuf, ud->reqsize);
+    }
+  while (nread < 0 && errno == EINTR);
+
+  if (nread < 0)
+    {
+      return -errno;
+    }
+
+  if (nread == 0)
+    {
+      return 0;
+    }
+
+  if (nread < sizeof(struct usrsock_request_common_s))
+    {
+      return -EMSGSIZE;
+    }
+
+  com    = (FAR void *)ud->reqbuf;
+  reqlen = usrsockd_reqlen(ud->reqbuf);
+  if (reqlen == 0)
+    {
+      /* Unknown request, only its header is needed for the answer */
+
+      return nread;
+    }
+
+  if (nread > reqlen || nread < g_usrsockd_hdrlen[com->reqid])
+    {
+      return -EMSGSIZE;
+    }
+
+  if (reqlen > ud->reqsize)
+    {
+      newbuf = realloc(ud->reqbuf, reqlen);
+      if (newbuf == NULL)
+        {
+          return -ENOMEM;
+        }
+
+      ud->reqbuf  = newbuf;
+      ud->reqsize = reqlen;
+    }
+
+  /* Only a request that did not fit takes a second read */
+
+  for (off = nread; off < reqlen; off += nread)
+    {
+      nread = read(ud->fd, &ud->reqbuf[off], reqlen - off);
+      if (nread < 0)
+        {
+          if (errno == EINTR)
+            {
+              nread = 0;
+              continue;
+            }
+
+          return -errno;
+        }
+
+      if (nread == 0)
+        {
+          return -EMSGSIZE;
+        }
+    }
+
+  return reqlen;
+}
+
+/****************************************************************************
+ * Name: usrsockd_reserve
+ *
+ * Description:
+ *   Make room for a message of hdrlen bytes in the header buffer and
+ *   iovcnt segments, flushing what is queued if needed.  A message is
+ *   never split between two writev() calls by the queue itself.
+ *
+ ****************************************************************************/
+
+static int usrsockd_reserve(FAR struct usrsockd_s *ud, size_t hdrlen,
+                            int iovcnt)
+{
+  int ret;
+
+  if (hdrlen > sizeof(ud->hdrbuf) ||
+      iovcnt > CONFIG_NETUTILS_USRSOCKD_IOVMAX)
+    {
+      return -E2BIG;
+    }
+
+  if (ud->hdrlen + hdrlen > sizeof(ud->hdrbuf) ||
+      ud->iovcnt + iovcnt > CONFIG_NETUTILS_USRSOCKD_IOVMAX)
+    {
+      ret = usrsockd_flush(ud);
+      if (ret < 0)
+        {
+          return ret;
+        }
+    }
+
+  return 0;
+}
+
+/****************************************************************************
+ * Name: usrsockd_queue
+ *
+ * Description:
+ *   Append a segment.  Copied bytes go to the header buffer and extend the
+ *   previous segment when that ends there, so a message header and its
+ *   value take one segment.
+ *
+ ****************************************************************************/
+
+static void usrsockd_queue(FAR struct usrsockd_s *ud, FAR const void *buf,
+                           size_t len, bool copy)
+{
+  FAR struct iovec *last;
+
+  if (len == 0)
+    {
+      return;
+    }
+
+  if (copy)
+    {
+      FAR uint8_t *dest = &ud->hdrbuf[ud->hdrlen];
+
+      memcpy(dest, buf, len);
+      ud->hdrlen += len;
+
+      if (ud->iovcnt > 0)
+        {
+          last = &ud->iov[ud->iovcnt - 1];
+          if ((FAR uint8_t *)last->iov_base + last->iov_len == dest)
+            {
+              last->iov_len += len;
+              return;
+            }
+        }
+
+      buf = dest;
+    }
+
+  ud->iov[ud->iovcnt].iov_base = (FAR void *)buf;
+  ud->iov[ud->iovcnt].iov_len  = len;
+  ud->iovcnt++;
+}
+
+/****************************************************************************
+ * Public Functions
+ ****************************************************************************/
+
+/****************************************************************************
+ * Name: usrsockd_open
+ ****************************************************************************/
+
+int usrsockd_open(FAR struct usrsockd_s *ud,
+                  FAR const usrsockd_handler_t *handlers, FAR void *priv)
+{
+  memset(ud, 0, sizeof(*ud));
+
+  ud->reqbuf = malloc(USRSOCKD_REQSIZE);
+  if (ud->reqbuf == NULL)
+    {
+      return -ENOMEM;
+    }
+
+  ud->fd = open("/dev/usrsock", O_RDWR | O_CLOEXEC);
+  if (ud->fd < 0)
+    {
+      int ret = -errno;
+
+      free(ud->reqbuf);
+      ud->reqbuf = NULL;
+      return ret;
+    }
+
+  ud->reqsize  = USRSOCKD_REQSIZE;
+  ud->handlers = handlers;
+  ud->priv     = priv;
+  return 0;
+}
+
+/****************************************************************************
+ * Name: usrsockd_close
+ ****************************************************************************/
+
+void usrsockd_close(FAR struct usrsockd_s *ud)
+{
+  if (ud->fd >= 0)
+    {
+      close(ud->fd);
+      ud->fd = -1;
+    }
+
+  free(ud->reqbuf);
+  ud->reqbuf  = NULL;
+  ud->reqsize = 0;
+}
+
+/****************************************************************************
+ * Name: usrsockd_process
+ ****************************************************************************/
+
+int usrsockd_process(FAR struct usrsockd_s *ud)
+{
+  FAR struct usrsock_request_common_s *com;
+  usrsockd_handler_t handler;
+  ssize_t reqlen;
+  size_t hdrlen;
+  int count = 0;
+  int ret;
+
+  ud->nwakeups++;
+
+  /* The kernel hands out the next request as soon as the previous one is
+   * answered, so keep going until there is nothing left instead of
+   * returning to poll() for each one.
+   */
+
+  while ((reqlen = usrsockd_readreq(ud)) > 0)
+    {
+      com     = (FAR void *)ud->reqbuf;
+      handler = NULL;
+
+      if (com->reqid >= 0 && com->reqid < USRSOCK_REQUEST__MAX)
+        {
+          handler = ud->handlers[com->reqid];
+        }
+
+      if (handler == NULL)
+        {
+          ret = usrsockd_ack(ud, com->xid, -ENOSYS, 0);
+        }
+      else
+        {
+          hdrlen = g_usrsockd_hdrlen[com->reqid];
+          ret = handler(ud, ud->reqbuf, ud->reqbuf + hdrlen,
+                        reqlen - hdrlen);
+        }
+
+      if (ret < 0)
+        {
+          return ret;
+        }
+
+      ret = usrsockd_flush(ud);
+      if (ret < 0)
+        {
+          return ret;
+        }
+
+      ud->nrequests++;
+      count++;
+    }
+
+  return reqlen < 0 ? reqlen : count;
+}
+
+/****************************************************************************
+ * Name: usrsockd_ack
+ ****************************************************************************/
+
+int usrsockd_ack(FAR struct usrsockd_s *ud, uint32_t xid, int32_t result,
+                 uint16_t events)
+{
+  struct usrsock_message_req_ack_s ack;
+  int ret;
+
+  ret = usrsockd_reserve(ud, sizeof(ack), 1);
+  if (ret < 0)
+    {
+      return ret;
+    }
+
+  memset(&ack, 0, sizeof(ack));
+  ack.head.msgid  = USRSOCK_MESSAGE_RESPONSE_ACK;
+  ack.head.events = events;
+  ack.xid         = xid;
+  ack.result      = result;
+
+  usrsockd_queue(ud, &ack, sizeof(ack), true);
+  return 0;
+}
+
+/****************************************************************************
+ * Name: usrsockd_dataack
+ ****************************************************************************/
+
+int usrsockd_dataack(FAR struct usrsockd_s *ud, uint32_t xid,
+                     int32_t result, uint16_t events,
+                     FAR const void *value, uint16_t valuelen,
+                     uint16_t valuelen_nontrunc,
+                     FAR const struct iovec *data, int datacnt)
+{
+  struct usrsock_message_datareq_ack_s ack;
+  int ret;
+  int i;
+
+  ret = usrsockd_reserve(ud, sizeof(ack) + valuelen, 1 + datacnt);
+  if (ret < 0)
+    {
+      return ret;
+    }
+
+  memset(&ack, 0, sizeof(ack));
+  ack.reqack.head.msgid  = USRSOCK_MESSAGE_RESPONSE_DATA_ACK;
+  ack.reqack.head.events = events;
+  ack.reqack.xid         = xid;
+  ack.reqack.result      = result;
+  ack.valuelen           = valuelen;
+  ack.valuelen_nontrunc  = valuelen_nontrunc;
+
+  usrsockd_queue(ud, &ack, sizeof(ack), true);
+  usrsockd_queue(ud, value, valuelen, true);
+
+  for (i = 0; i < datacnt; i++)
+    {
+      usrsockd_queue(ud, data[i].iov_base, data[i].iov_len, false);
+    }
+
+  return 0;
+}
+
+/****************************************************************************
+ * Name: usrsockd_event
+ ****************************************************************************/
+
+int usrsockd_event(FAR struct usrsockd_s *ud, int16_t usockid,
+                   uint16_t events)
+{
+  struct usrsock_message_socket_event_s event;
+  int ret;
+
+  ret = usrsockd_reserve(ud, sizeof(event), 1);
+  if (ret < 0)
+    {
+      return ret;
+    }
+
+  memset(&event, 0, sizeof(event));
+  event.head.msgid  = USRSOCK_MESSAGE_SOCKET_EVENT;
+  event.head.flags  = USRSOCK_MESSAGE_FLAG_EVENT;
+  event.head.events = events;
+  event.usockid     = usockid;
+
+  usrsockd_queue(ud, &event, sizeof(event), true);
+  return 0;
+}
+
+/****************************************************************************
+ * Name: usrsockd_flush
+ ****************************************************************************/
+
+int usrsockd_flush(FAR struct usrsockd_s *ud)
+{
+  FAR struct iovec *iov = ud->iov;
+  int iovcnt = ud->iovcnt;
+  ssize_t nwritten;
+  int ret = 0;
+
+  /* The device may take one message per write, pick up after whatever
+   * it accepted.
+   */
+
+  while (iovcnt > 0)
+    {
+      nwritten = writev(ud->fd, iov, iovcnt);
+      if (nwritten < 0)
+        {
+          if (errno == EINTR)
+            {
+              continue;
+            }
+
+          ret = -errno;
+          break;
+        }
+
+      if (nwritten == 0)
+        {
+          ret = -ENOSPC;
+          break;
+        }
+
+      ud->nwrites++;
+
+      while (iovcnt > 0 && (size_t)nwritten >= iov->iov_len)
+        {
+          nwritten -= iov->iov_len;
+          iov++;
+          iovcnt--;
+        }
+
+      if (iovcnt > 0)
+        {
+          iov->iov_base = (FAR uint8_t *)iov->iov_base + nwritten;
+          iov->iov_len -= nwritten;
+        }
+    }
+
+  ud->iovcnt = 0;
+  ud->hdrlen = 0;
+  return ret;
+}
+
+/****************************************************************************
+ * Name: usrsockd_ring_init
+ ****************************************************************************/
+
+int usrsockd_ring_init(FAR struct usrsockd_ring_s *ring, size_t size)
+{
+  ring->buf = malloc(size);
+  if (ring->buf == NULL)
+    {
+      return -ENOMEM;
+    }
+
+  ring->size = size;
+  ring->head = 0;
+  ring->tail = 0;
+  return 0;
+}
+
+/****************************************************************************
+ * Name: usrsockd_ring_free
+ ****************************************************************************/
+
+void usrsockd_ring_free(FAR struct usrsockd_ring_s *ring)
+{
+  free(ring->buf);
+  memset(ring, 0, sizeof(*ring));
+}
+
+/****************************************************************************
+ * Name: usrsockd_ring_used
+ ****************************************************************************/
+
+size_t usrsockd_ring_used(FAR const struct usrsockd_ring_s *ring)
+{
+  return ring->head - ring->tail;
+}
+
+/****************************************************************************
+ * Name: usrsockd_ring_space
+ ****************************************************************************/
+
+FAR uint8_t *usrsockd_ring_space(FAR struct usrsockd_ring_s *ring,
+                                 FAR size_t *len)
+{
+  size_t off;
+  size_t room;
+
+  /* Start over at the beginning once drained, so a producer that fills
+   * an empty ring gets all of it in one piece.
+   */
+
+  if (ring->head == ring->tail)
+    {
+      ring->head = 0;
+      ring->tail = 0;
+    }
+
+  off  = ring->head % ring->size;
+  room = ring->size - (ring->head - ring->tail);
+  if (room > ring->size - off)
+    {
+      room = ring->size - off;
+    }
+
+  *len = room;
+  return &ring->buf[off];
+}
+
+/****************************************************************************
+ * Name: usrsockd_ring_commit
+ ****************************************************************************/
+
+void usrsockd_ring_commit(FAR struct usrsockd_ring_s *ring, size_t len)
+{
+  ring->head += len;
+}
+
+/****************************************************************************
+ * Name: usrsockd_ring_put
+ ****************************************************************************/
+
+size_t usrsockd_ring_put(FAR struct usrsockd_ring_s *ring,
+                         FAR const void *data, size_t len)
+{
+  FAR const uint8_t *src = data;
+  FAR uint8_t *dest;
+  size_t total = 0;
+  size_t room;
+
+  while (len > 0)
+    {
+      dest = usrsockd_ring_space(ring, &room);
+      if (room == 0)
+        {
+          break;
+        }
+
+      if (room > len)
+        {
+          room = len;
+        }
+
+      memcpy(dest, src, room);
+      usrsockd_ring_commit(ring, room);
+      src   += room;
+      len   -= room;
+      total += room;
+    }
+
+  return total;
+}
+
+/****************************************************************************
+ * Name: usrsockd_ring_peek
+ ****************************************************************************/
+
+int usrsockd_ring_peek(FAR const struct usrsockd_ring_s *ring, size_t len,
+                       FAR struct iovec *iov)
+{
+  size_t used = ring->head - ring->tail;
+  size_t off = ring->tail % ring->size;
+  size_t first;
+
+  if (len > used)
+    {
+      len = used;
+    }
+
+  if (len == 0)
+    {
+      return 0;
+    }
+
+  first = ring->size - off;
+  if (first >= len)
+    {
+      iov[0].iov_base = &ring->buf[off];
+      iov[0].iov_len  = len;
+      return 1;
+    }
+
+  iov[0].iov_base = &ring->buf[off];
+  iov[0].iov_len  = first;
+  iov[1].iov_base = ring->buf;
+  iov[1].iov_len  = len - first;
+  return 2;
+}
+
+/****************************************************************************
+ * Name: usrsockd_ring_consume
+ ****************************************************************************/
+
+void usrsockd_ring_consume(FAR struct usrsockd_ring_s *ring, size_t len)
+{
+  size_t used = ring->head - ring->tail;
+
+  ring->tail += len > used ? used : len;
+}
@@ -687,9 +687,29 @@ static void *httpd_handler(void *arg)
   struct httpd_state *pstate =
     (struct httpd_state *)malloc(sizeof(struct httpd_state));
   int sockfd = (intptr_t)arg;
+#if defined(CONFIG_NETUTILS_HTTPD_SERVERPOOL) && \
+    CONFIG_NETUTILS_HTTPD_TIMEOUT > 0
+  struct timeval tv;
+#endif
 
   ninfo("[%d] Started\n", sockfd);
 
+#if defined(CONFIG_NETUTILS_HTTPD_SERVERPOOL) && \
+    CONFIG_NETUTILS_HTTPD_TIMEOUT > 0
+  /* Pooled workers are shared, do not wait forever on one client */
+
+  tv.tv_sec  = CONFIG_NETUTILS_HTTPD_TIMEOUT;
+  tv.tv_usec = 0;
+  if (setsockopt(sockfd, SOL_SOCKET, SO_RCVTIMEO, &tv,
+                 sizeof(struct timeval)) < 0)
+    {
+      nerr("ERROR: setsockopt SO_RCVTIMEO failure: %d\n", errno);
+      free(pstate);
+      close(sockfd);
+      return NULL;
+    }
+#endif
+
   /* Verify that the state structure was successfully allocated */
 
   if (pstate)
@@ -814,6 +834,34 @@ static void single_server(uint16_t portno, pthread_startroutine_t handler,
 }
 #endif
 
+#ifdef CONFIG_NETUTILS_HTTPD_SERVERPOOL
+static void pool_server(uint16_t portno, pthread_startroutine_t handler,
+                        int stacksize)
+{
+  struct netlib_server_s server;
+  int listensd;
+  int ret;
+
+  listensd = netlib_listenon(portno);
+  if (listensd < 0)
+    {
+      return;
+    }
+
+  netlib_server_init(&server, NETLIB_SERVER_POOL);
+  server.nworkers  = CONFIG_NETUTILS_HTTPD_WORKERS;
+  server.backlog   = CONFIG_NETUTILS_HTTPD_BACKLOG;
+  server.stacksize = stacksize;
+  server.linger    = 30;
+  server.handler   = handler;
+
+  ret = netlib_server_run(&server, listensd);
+  nerr("ERROR: netlib_server_run failed: %d\n", ret);
+
+  close(listensd);
+}
+#endif
+
 /****************************************************************************
  * Public Functions
  ****************************************************************************/
@@ -837,8 +885,10 @@ int httpd_listen(void)
 {
   /* Execute httpd_handler on each connection to port 80 */
 
-#ifdef CONFIG_NETUTILS_HTTPD_SINGLECONNECT
+#if defined(CONFIG_NETUTILS_HTTPD_SINGLECONNECT)
   single_server(HTONS(80), httpd_handler, CONFIG_NETUTILS_HTTPDSTACKSIZE);
+#elif defined(CONFIG_NETUTILS_HTTPD_SERVERPOOL)
+  pool_server(HTONS(80), httpd_handler, CONFIG_NETUTILS_HTTPDSTACKSIZE);
 #else
   netlib_server(HTONS(80), httpd_handler, CONFIG_NETUTILS_HTTPDSTACKSIZE);
 #endif
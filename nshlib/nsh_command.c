@@ -380,8 +380,8 @@ static const struct cmdmap_s g_cmdmap[] =
 
 #if !defined(CONFIG_DISABLE_MOUNTPOINT) && defined(CONFIG_FSUTILS_MKFATFS)
 #  ifndef CONFIG_NSH_DISABLE_MKFATFS
-  CMD_MAP("mkfatfs",  cmd_mkfatfs,  2, 6,
-    "[-F <fatsize>] [-r <rootdirentries>] <block-driver>"),
+  CMD_MAP("mkfatfs",  cmd_mkfatfs,  2, 8,
+    "[-F <fatsize>] [-r <rootdirentries>] [-d] [-v] <block-driver>"),
 #  endif
 #endif
 
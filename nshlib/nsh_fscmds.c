@@ -1916,10 +1916,10 @@ int cmd_mkfatfs(FAR struct nsh_vtbl_s *vtbl, int argc, FAR char **argv)
   int rootdirentries;
   int ret = ERROR;
 
-  /* mkfatfs [-F <fatsize>] <block-driver> */
+  /* mkfatfs [-F <fatsize>] [-r <rootdirentries>] [-d] [-v] <block-driver> */
 
   badarg = false;
-  while ((option = getopt(argc, argv, ":F:r:")) != ERROR)
+  while ((option = getopt(argc, argv, ":F:r:dv")) != ERROR)
     {
       switch (option)
         {
@@ -1946,6 +1946,14 @@ int cmd_mkfatfs(FAR struct nsh_vtbl_s *vtbl, int argc, FAR char **argv)
               }
             break;
 
+         case 'd':
+            fmt.ff_flags |= MKFATFS_FLAG_DISCARD;
+            break;
+
+         case 'v':
+            fmt.ff_flags |= MKFATFS_FLAG_VERBOSE;
+            break;
+
          case ':':
             nsh_error(vtbl, g_fmtargrequired, argv[0]);
             badarg = true;
@@ -44,6 +44,10 @@
 #include "nsh.h"
 #include "nsh_console.h"
 
+#if !defined(CONFIG_NSH_DISABLE_TOP) && defined(NSH_HAVE_CPULOAD)
+#  include "system/procsample.h"
+#endif
+
 /****************************************************************************
  * Pre-processor Definitions
  ****************************************************************************/
@@ -118,15 +122,22 @@ struct nsh_taskstatus_s
   FAR char       *td_buf;          /* Buffer for reading files */
   size_t          td_bufsize;      /* Size of the buffer */
   size_t          td_bufpos;       /* Position in the buffer */
+#if !defined(CONFIG_NSH_DISABLE_TOP) && defined(NSH_HAVE_CPULOAD)
+  FAR const struct procsample_task_s *td_sample; /* Cached files, if any */
+#endif
 };
 
+#if !defined(CONFIG_NSH_DISABLE_TOP) && defined(NSH_HAVE_CPULOAD)
 struct nsh_topstatus_s
 {
+  FAR struct nsh_vtbl_s *vtbl;
   FAR struct nsh_taskstatus_s **status;
+  struct procsample_s ps;          /* Keeps the task files open */
   bool heap;
   size_t size;
   size_t index;
 };
+#endif
 
 /* Status strings */
 
@@ -319,6 +330,57 @@ static bool ps_skipfile(FAR const struct dirent *entryp)
   return false;
 }
 
+/****************************************************************************
+ * Name: ps_readsample
+ *
+ * Description:
+ *   Same as ps_readprocfs(), but take the file content from the copy that
+ *   top sampled instead of opening the file again.
+ *
+ ****************************************************************************/
+
+#if !defined(CONFIG_NSH_DISABLE_TOP) && defined(NSH_HAVE_CPULOAD)
+static ssize_t ps_readsample(FAR const char *basepath,
+                             FAR struct nsh_taskstatus_s *status)
+{
+  static const char * const names[PROCSAMPLE_NFILES] =
+  {
+    [PROCSAMPLE_STATUS]  = "status",
+    [PROCSAMPLE_GROUP]   = "group/status",
+    [PROCSAMPLE_STACK]   = "stack",
+    [PROCSAMPLE_HEAP]    = "heap",
+    [PROCSAMPLE_LOADAVG] = "loadavg",
+    [PROCSAMPLE_CRITMON] = "critmon",
+    [PROCSAMPLE_CMDLINE] = "cmdline",
+  };
+
+  FAR const struct procsample_file_s *file;
+  FAR char *buf = status->td_buf + status->td_bufpos;
+  size_t len;
+  int i;
+
+  for (i = 0; i < PROCSAMPLE_NFILES; i++)
+    {
+      if (strcmp(basepath, names[i]) == 0)
+        {
+          break;
+        }
+    }
+
+  if (i == PROCSAMPLE_NFILES || status->td_sample->file[i].fd < 0)
+    {
+      buf[0] = '\0';
+      return -ENOENT;
+    }
+
+  file = &status->td_sample->file[i];
+  len  = MIN(file->len, status->td_bufsize - status->td_bufpos - 1);
+  memcpy(buf, file->text, len);
+  buf[len] = '\0';
+  return strlen(buf) + 1;
+}
+#endif
+
 /****************************************************************************
  * Name: ps_readprocfs
  ****************************************************************************/
@@ -331,6 +393,13 @@ ssize_t ps_readprocfs(FAR struct nsh_vtbl_s *vtbl, FAR const char *basepath,
   FAR char *filepath = NULL;
   int ret;
 
+#if !defined(CONFIG_NSH_DISABLE_TOP) && defined(NSH_HAVE_CPULOAD)
+  if (status->td_sample != NULL)
+    {
+      return ps_readsample(basepath, status);
+    }
+#endif
+
   ret = asprintf(&filepath, "%s/%s/%s", dirpath, entryp->d_name, basepath);
   if (ret < 0 || filepath == NULL)
     {
@@ -763,19 +832,17 @@ static int ps_callback(FAR struct nsh_vtbl_s *vtbl, FAR const char *dirpath,
  * Name: top_callback
  ****************************************************************************/
 
-static int top_callback(FAR struct nsh_vtbl_s *vtbl, FAR const char *dirpath,
-                        FAR struct dirent *entryp, FAR void *pvarg)
+static int top_callback(FAR struct procsample_s *ps,
+                        FAR struct procsample_task_s *task,
+                        FAR void *pvarg)
 {
   FAR struct nsh_topstatus_s *topstatus = pvarg;
+  FAR struct nsh_vtbl_s *vtbl = topstatus->vtbl;
   FAR struct nsh_taskstatus_s *status;
   int index = topstatus->index;
+  struct dirent entry;
   int ret;
 
-  if (ps_skipfile(entryp))
-    {
-      return OK;
-    }
-
   if (topstatus->size == 0)
     {
       topstatus->status = zalloc(sizeof(FAR struct nsh_taskstatus_s *) * 4);
@@ -828,15 +895,23 @@ static int top_callback(FAR struct nsh_vtbl_s *vtbl, FAR const char *dirpath,
       status->td_bufsize = IOBUFFERSIZE;
     }
 
-  ret = ps_record(vtbl, dirpath, entryp, topstatus->heap, status);
+  /* ps_record() parses the files sampled by procsample */
+
+  entry.d_type = DT_DIR;
+  snprintf(entry.d_name, sizeof(entry.d_name), "%d", (int)task->pid);
+  status->td_sample = task;
+
+  ret = ps_record(vtbl, CONFIG_NSH_PROC_MOUNTPOINT, &entry, topstatus->heap,
+                  status);
   if (ret < 0)
     {
-      nsh_error(vtbl, g_fmtcmdfailed, "top", "ps_record", NSH_ERRNO);
+      nsh_error(vtbl, g_fmtcmdfailed, "top", "ps_record",
+                NSH_ERRNO_OF(-ret));
       return ret;
     }
 
   topstatus->index++;
-  return ret;
+  return OK;
 }
 
 /****************************************************************************
@@ -1412,6 +1487,39 @@ int cmd_top(FAR struct nsh_vtbl_s *vtbl, int argc, FAR char **argv)
     }
 #endif
 
+  /* The files of each task are opened once and re-read on every
+   * refresh.
+   */
+
+  topstatus.vtbl = vtbl;
+  procsample_init(&topstatus.ps, CONFIG_NSH_PROC_MOUNTPOINT,
+                  PROCSAMPLE_FILE(PROCSAMPLE_STATUS) |
+                  PROCSAMPLE_FILE(PROCSAMPLE_GROUP) |
+#ifdef PS_SHOW_STACKSIZE
+                  PROCSAMPLE_FILE(PROCSAMPLE_STACK) |
+#endif
+#ifdef PS_SHOW_HEAPSIZE
+                  (topstatus.heap ? PROCSAMPLE_FILE(PROCSAMPLE_HEAP) : 0) |
+#endif
+                  PROCSAMPLE_FILE(PROCSAMPLE_LOADAVG) |
+                  PROCSAMPLE_FILE(PROCSAMPLE_CMDLINE));
+
+  if (pidlist)
+    {
+      FAR char *save = NULL;
+      FAR char *pid = strtok_r(pidlist, ",", &save);
+
+      while (pid != NULL)
+        {
+          if (procsample_add(&topstatus.ps, atoi(pid)) < 0)
+            {
+              nsh_error(vtbl, g_fmtnosuch, "top", "task", pid);
+            }
+
+          pid = strtok_r(NULL, ",", &save);
+        }
+    }
+
   if (vtbl->isctty)
     {
       tc = nsh_ioctl(vtbl, TIOCSCTTY, getpid());
@@ -1423,32 +1531,11 @@ int cmd_top(FAR struct nsh_vtbl_s *vtbl, int argc, FAR char **argv)
       nsh_output(vtbl, "\033[2J\033[1;1H");
       ps_title(vtbl, topstatus.heap);
 
-      if (pidlist)
-        {
-          FAR char *save = NULL;
-          FAR char *pid = strtok_r(pidlist, ",", &save);
-
-          while (pid != NULL && ret >= 0)
-            {
-              struct dirent entry;
-              entry.d_type = DT_DIR;
-              strlcpy(entry.d_name, pid, sizeof(entry.d_name));
-              ret = top_callback(vtbl, CONFIG_NSH_PROC_MOUNTPOINT,
-                                 &entry, &topstatus);
-              *--pid = ',';
-              pid = strtok_r(NULL, ",", &save);
-            }
-        }
-      else
-        {
-          ret = nsh_foreach_direntry(vtbl, "top", CONFIG_NSH_PROC_MOUNTPOINT,
-                                     top_callback, &topstatus);
-        }
-
+      ret = procsample_update(&topstatus.ps, top_callback, &topstatus);
       if (ret < 0)
         {
-          nsh_error(vtbl, g_fmtcmdfailed, "top", "nsh_foreach_direntry",
-                    NSH_ERRNO);
+          nsh_error(vtbl, g_fmtcmdfailed, "top", "procsample_update",
+                    NSH_ERRNO_OF(-ret));
           break;
         }
 
@@ -1482,6 +1569,8 @@ int cmd_top(FAR struct nsh_vtbl_s *vtbl, int argc, FAR char **argv)
       free(topstatus.status);
     }
 
+  procsample_deinit(&topstatus.ps);
+
   if (vtbl->isctty && tc == 0)
     {
       nsh_ioctl(vtbl, TIOCNOTTY, 0);
@@ -33,12 +33,11 @@
 #include <stdio.h>
 #include <string.h>
 #include <ctype.h>
-#include <fcntl.h>
-#include <dirent.h>
 #include <sched.h>
-#include <syslog.h>
 #include <errno.h>
 
+#include "system/procsample.h"
+
 #ifdef CONFIG_SYSTEM_CRITMONITOR
 
 /****************************************************************************
@@ -79,10 +78,6 @@ struct critmon_state_s
 
 static struct critmon_state_s g_critmon;
 
-#if CONFIG_TASK_NAME_SIZE > 0
-static const char g_name[] = "Name:";
-#endif
-
 /****************************************************************************
  * Private Functions
  ****************************************************************************/
@@ -111,110 +106,30 @@ static FAR char *critmon_isolate_value(FAR char *line)
 }
 
 /****************************************************************************
- * Name: critmon_process_directory
+ * Name: critmon_process_task
  ****************************************************************************/
 
-static int critmon_process_directory(FAR struct dirent *entryp)
+static int critmon_process_task(FAR struct procsample_s *ps,
+                                FAR struct procsample_task_s *task,
+                                FAR void *arg)
 {
-  FAR const char *tmpstr;
-  FAR char *filepath;
+  FAR struct procsample_file_s *file = &task->file[PROCSAMPLE_CRITMON];
   FAR char *maxpreemp;
   FAR char *maxcrit;
   FAR char *maxrun;
   FAR char *runtime;
   FAR char *pos;
-  FILE *stream;
-  int len;
-  int ret;
 
-#if CONFIG_TASK_NAME_SIZE > 0
-  FAR char *name = NULL;
-
-  /* Read the task status to get the task name */
-
-  filepath = NULL;
-  ret = asprintf(&filepath,
-                 CONFIG_SYSTEM_CRITMONITOR_MOUNTPOINT "/%s/status",
-                 entryp->d_name);
-  if (ret < 0)
+  if (file->len == 0)
     {
-      fprintf(stderr,
-              "Csection Monitor: Failed to create path to status file\n");
-      return -ENOMEM;
+      fprintf(stderr, "Csection Monitor: No Csection data for %d\n",
+              task->pid);
+      return OK;
     }
 
-  /* Open the status file */
+  /* The sampled text must stay intact, split a copy of it */
 
-  stream = fopen(filepath, "r");
-  if (stream == NULL)
-    {
-      ret = -errno;
-      fprintf(stderr, "Csection Monitor: Failed to open %s: %d\n",
-              filepath, ret);
-      goto errout_with_filepath;
-    }
-
-  while (fgets(g_critmon.line, 80, stream) != NULL)
-    {
-      g_critmon.line[79] = '\n';
-      len = strlen(g_name);
-      if (strncmp(g_critmon.line, g_name, len) == 0)
-        {
-          tmpstr = critmon_isolate_value(&g_critmon.line[len]);
-          if (*tmpstr == '\0')
-            {
-              ret = -EINVAL;
-              goto errout_with_stream;
-            }
-
-          name = strdup(tmpstr);
-          if (name == NULL)
-            {
-              ret = -EINVAL;
-              goto errout_with_stream;
-            }
-        }
-    }
-
-  free(filepath);
-  fclose(stream);
-#endif
-
-  /* Read critical section information */
-
-  filepath = NULL;
-
-  ret = asprintf(&filepath,
-                 CONFIG_SYSTEM_CRITMONITOR_MOUNTPOINT "/%s/critmon",
-                 entryp->d_name);
-  if (ret < 0)
-    {
-      fprintf(stderr, "Csection Monitor: "
-              "Failed to create path to Csection file\n");
-      ret = -EINVAL;
-      goto errout_with_name;
-    }
-
-  /* Open the Csection file */
-
-  stream = fopen(filepath, "r");
-  if (stream == NULL)
-    {
-      ret = -errno;
-      fprintf(stderr, "Csection Monitor: Failed to open %s: %d\n",
-              filepath, ret);
-      goto errout_with_filepath;
-    }
-
-  /* Read the line containing the Csection max durations */
-
-  if (fgets(g_critmon.line, 80, stream) == NULL)
-    {
-      ret = -errno;
-      fprintf(stderr, "Csection Monitor: Failed to read from %s: %d\n",
-              filepath, ret);
-      goto errout_with_filepath;
-    }
+  strlcpy(g_critmon.line, file->text, sizeof(g_critmon.line));
 
   /* Input Format:   X.XXXXXXXXX,X.XXXXXXXXX,X.XXXXXXXXX
    * Output Format:  X.XXXXXXXXX X.XXXXXXXXX X.XXXXXXXXX NNNNN <name>
@@ -266,53 +181,14 @@ static int critmon_process_directory(FAR struct dirent *entryp)
   /* Finally, output the stack info that we gleaned from the procfs */
 
 #if CONFIG_TASK_NAME_SIZE > 0
-  printf("%-29s %-29s %-16s %-16s %-5s %s\n",
-         maxpreemp, maxcrit, maxrun, runtime, entryp->d_name, name);
+  printf("%-29s %-29s %-16s %-16s %-5d %s\n",
+         maxpreemp, maxcrit, maxrun, runtime, task->pid, task->name);
 #else
-  printf("%-29s %-29s %16s %16s %5s\n",
-         maxpreemp, maxcrit, maxrun, runtime, entryp->d_name);
-#endif
-
-  ret = OK;
-
-errout_with_stream:
-  fclose(stream);
-
-errout_with_filepath:
-  free(filepath);
-
-errout_with_name:
-#if CONFIG_TASK_NAME_SIZE > 0
-  if (name != NULL)
-    {
-      free(name);
-    }
+  printf("%-29s %-29s %16s %16s %5d\n",
+         maxpreemp, maxcrit, maxrun, runtime, task->pid);
 #endif
 
-  return ret;
-}
-
-/****************************************************************************
- * Name: critmon_check_name
- ****************************************************************************/
-
-static bool critmon_check_name(FAR char *name)
-{
-  int i;
-
-  /* Check each character in the name */
-
-  for (i = 0; i < NAME_MAX && name[i] != '\0'; i++)
-    {
-      if (!isdigit(name[i]))
-        {
-          /* Name contains something other than a decimal numeric character */
-
-          return false;
-        }
-    }
-
-  return true;
+  return OK;
 }
 
 /****************************************************************************
@@ -409,11 +285,8 @@ errout_with_filepath:
  * Name: critmon_list_once
  ****************************************************************************/
 
-static int critmon_list_once(void)
+static int critmon_list_once(FAR struct procsample_s *ps)
 {
-  int exitcode = EXIT_SUCCESS;
-  int errcount = 0;
-  DIR *dirp;
   int ret;
 
   /* Output a Header */
@@ -430,62 +303,33 @@ static int critmon_list_once(void)
 
   critmon_global_crit();
 
-  /* Open the top-level procfs directory */
+  /* Sample and output each task */
 
-  dirp = opendir(CONFIG_SYSTEM_CRITMONITOR_MOUNTPOINT);
-  if (dirp == NULL)
+  ret = procsample_update(ps, critmon_process_task, NULL);
+  if (ret < 0)
     {
-      /* Failed to open the directory */
+      /* Failed to read the directory */
 
       fprintf(stderr, "Csection Monitor: Failed to open directory: %s\n",
               CONFIG_SYSTEM_CRITMONITOR_MOUNTPOINT);
       return EXIT_FAILURE;
     }
 
-  /* Read each directory entry */
-
-  for (; ; )
-    {
-      FAR struct dirent *entryp = readdir(dirp);
-      if (entryp == NULL)
-        {
-          /* Finished with this directory */
-
-          break;
-        }
-
-      /* Task/thread entries in the /proc directory will all be (1)
-       * directories with (2) all numeric names.
-       */
+  fputc('\n', stdout);
+  return EXIT_SUCCESS;
+}
 
-      if (DIRENT_ISDIRECTORY(entryp->d_type) &&
-          critmon_check_name(entryp->d_name))
-        {
-          /* Looks good -- process the directory */
-
-          ret = critmon_process_directory(entryp);
-          if (ret < 0)
-            {
-              /* Failed to process the thread directory */
-
-              fprintf(stderr, "Csection Monitor: "
-                      "Failed to process sub-directory: %s\n",
-                      entryp->d_name);
-
-              if (++errcount > 100)
-                {
-                  fprintf(stderr, "Csection Monitor: "
-                          "Too many errors ... exiting\n");
-                  exitcode = EXIT_FAILURE;
-                  break;
-                }
-            }
-        }
-    }
+/****************************************************************************
+ * Name: critmon_sample_init
+ ****************************************************************************/
 
-  closedir(dirp);
-  fputc('\n', stdout);
-  return exitcode;
+static void critmon_sample_init(FAR struct procsample_s *ps)
+{
+  procsample_init(ps, CONFIG_SYSTEM_CRITMONITOR_MOUNTPOINT,
+#if CONFIG_TASK_NAME_SIZE > 0
+                  PROCSAMPLE_FILE(PROCSAMPLE_STATUS) |
+#endif
+                  PROCSAMPLE_FILE(PROCSAMPLE_CRITMON));
 }
 
 /****************************************************************************
@@ -494,15 +338,20 @@ static int critmon_list_once(void)
 
 static int critmon_daemon(int argc, char **argv)
 {
+  struct procsample_s ps;
   int exitcode = EXIT_SUCCESS;
 
   printf("Csection Monitor: Running: %d\n", g_critmon.pid);
 
+  /* The task files stay open across samples */
+
+  critmon_sample_init(&ps);
+
   /* Loop until we detect that there is a request to stop. */
 
   while (!g_critmon.stop)
     {
-      exitcode = critmon_list_once();
+      exitcode = critmon_list_once(&ps);
       if (exitcode != EXIT_SUCCESS)
         {
           break;
@@ -513,6 +362,8 @@ static int critmon_daemon(int argc, char **argv)
       sleep(CONFIG_SYSTEM_CRITMONITOR_INTERVAL);
     }
 
+  procsample_deinit(&ps);
+
   /* Stopped */
 
   g_critmon.stop    = false;
@@ -589,7 +440,13 @@ int critmon_stop_main(int argc, char **argv)
 
 int critmon_main(int argc, char **argv)
 {
-  return critmon_list_once();
+  struct procsample_s ps;
+  int exitcode;
+
+  critmon_sample_init(&ps);
+  exitcode = critmon_list_once(&ps);
+  procsample_deinit(&ps);
+  return exitcode;
 }
 
 #endif /* CONFIG_SYSTEM_CRITMONITOR */
@@ -33,6 +33,7 @@
 #include <errno.h>
 #include <fcntl.h>
 #include <inttypes.h>
+#include <pthread.h>
 #include <stdbool.h>
 #include <stdlib.h>
 #include <stdint.h>
@@ -79,6 +80,8 @@
 #define FASTBOOT_SPARSE_HEADER      sizeof(struct fastboot_sparse_header_s)
 #define FASTBOOT_CHUNK_HEADER       sizeof(struct fastboot_chunk_header_s)
 
+#define FASTBOOT_FILL_BUFSIZE       32768
+
 /* Fastboot TCP Protocol v1
  *
  *   handshake: chars "FB" followed by a 2-digit base-10 ASCII version number
@@ -143,6 +146,47 @@ struct fastboot_file_s
   off_t offset;
 };
 
+#ifdef CONFIG_SYSTEM_FASTBOOTD_STREAM
+enum fastboot_stream_state_e
+{
+  FASTBOOT_STREAM_START = 0,  /* Nothing seen yet */
+  FASTBOOT_STREAM_IMAGE,      /* Not sparse, everything goes to the flash */
+  FASTBOOT_STREAM_HEADER,     /* Collecting the sparse header */
+  FASTBOOT_STREAM_CHUNK,      /* Collecting a chunk header */
+  FASTBOOT_STREAM_RAW,        /* In the data of a raw chunk */
+  FASTBOOT_STREAM_FILL,       /* Collecting the value of a fill chunk */
+  FASTBOOT_STREAM_SKIP,       /* Skipping data that is not written */
+  FASTBOOT_STREAM_DONE        /* All chunks seen, ignore the rest */
+};
+
+/* A download being programmed while it arrives: the download buffer is
+ * split in two halves, the transport fills one while the writer thread
+ * parses the other and writes it to the flash.
+ */
+
+struct fastboot_stream_s
+{
+  pthread_t thread;
+  pthread_mutex_t lock;
+  pthread_cond_t cond;
+  FAR uint8_t *buf[2];      /* The two halves of the download buffer */
+  size_t len[2];            /* Bytes queued in each half, 0 if it is free */
+  bool done;                /* Nothing more will be queued */
+  int result;               /* First error of the writer */
+  int fd;                   /* Partition being programmed */
+
+  /* Sparse image parser, only used by the writer thread */
+
+  enum fastboot_stream_state_e state;
+  struct fastboot_sparse_header_s sparse;
+  uint8_t hdr[FASTBOOT_SPARSE_HEADER];
+  size_t hdrlen;            /* Bytes collected in hdr */
+  size_t left;              /* Bytes left in the raw or skipped data */
+  uint32_t chunks;          /* Chunks not started yet */
+  off_t offset;             /* Flash offset of the next byte written */
+};
+#endif
+
 struct fastboot_transport_ops_s
 {
   CODE int (*init)(FAR struct fastboot_ctx_s *);
@@ -178,6 +222,10 @@ struct fastboot_ctx_s
   FAR struct fastboot_var_s *varlist;
   CODE int (*upload_func)(FAR struct fastboot_ctx_s *);
   FAR const struct fastboot_transport_ops_s *ops;
+#ifdef CONFIG_SYSTEM_FASTBOOTD_STREAM
+  FAR char *stream_part;      /* Partition armed by "oem stream" */
+  size_t stream_size;         /* Size of the last streamed download */
+#endif
   struct
     {
       size_t size;
@@ -230,6 +278,10 @@ static void fastboot_shell(FAR struct fastboot_ctx_s *ctx,
 static void fastboot_switchboot(FAR struct fastboot_ctx_s *context,
                                 FAR const char *arg);
 #endif
+#ifdef CONFIG_SYSTEM_FASTBOOTD_STREAM
+static void fastboot_stream(FAR struct fastboot_ctx_s *ctx,
+                            FAR const char *arg);
+#endif
 
 /* USB transport */
 
@@ -279,6 +331,9 @@ static const struct fastboot_cmd_s g_oem_cmd[] =
 #ifdef CONFIG_BOARDCTL_SWITCH_BOOT
   { "switchboot",         fastboot_switchboot       },
 #endif
+#ifdef CONFIG_SYSTEM_FASTBOOTD_STREAM
+  { "stream",             fastboot_stream           },
+#endif
 };
 
 #ifdef CONFIG_BOARD_MEMORY_RANGE
@@ -424,36 +479,117 @@ static int fastboot_flash_write(int fd, off_t offset,
   return ret;
 }
 
-static int ffastboot_flash_fill(int fd, off_t offset,
-                                uint32_t fill_data,
-                                uint32_t blk_sz,
-                                uint32_t blk_num)
+/* Erase the whole erase blocks within [*start, *end) if the fill pattern
+ * is what erased flash reads back as.  The erased range is returned in
+ * *start and *end, if nothing could be erased both are set to *end.
+ */
+
+static void fastboot_flash_fill_erase(int fd, uint32_t fill_data,
+                                      FAR off_t *start, FAR off_t *end)
+{
+  struct mtd_geometry_s geo;
+  struct mtd_erase_s erase;
+  uint8_t erasestate;
+  off_t first;
+  off_t last;
+
+  if (ioctl(fd, MTDIOC_ERASESTATE,
+            (unsigned long)((uintptr_t)&erasestate)) < 0 ||
+      fill_data != erasestate * 0x01010101u ||
+      ioctl(fd, MTDIOC_GEOMETRY, (unsigned long)((uintptr_t)&geo)) < 0 ||
+      geo.erasesize == 0)
+    {
+      goto none;
+    }
+
+  first = (*start + geo.erasesize - 1) / geo.erasesize;
+  last  = *end / geo.erasesize;
+  if (first >= last)
+    {
+      goto none;
+    }
+
+  /* Push out what is cached for the blocks before, then erase */
+
+  fsync(fd);
+
+  erase.startblock = first;
+  erase.nblocks    = last - first;
+  if (ioctl(fd, MTDIOC_ERASESECTORS,
+            (unsigned long)((uintptr_t)&erase)) < 0)
+    {
+      goto none;
+    }
+
+  *start = first * geo.erasesize;
+  *end   = last * geo.erasesize;
+  return;
+
+none:
+  *start = *end;
+}
+
+static int fastboot_flash_fill_write(int fd, off_t offset,
+                                     FAR void *buffer, size_t bufsize,
+                                     size_t size)
 {
-  FAR void *buffer;
   int ret = OK;
-  int i;
 
-  buffer = malloc(blk_sz);
+  while (size > 0 && ret >= 0)
+    {
+      size_t len = MIN(size, bufsize);
+
+      ret = fastboot_flash_write(fd, offset, buffer, len);
+      offset += len;
+      size -= len;
+    }
+
+  return ret;
+}
+
+static int fastboot_flash_fill(int fd, off_t offset,
+                               uint32_t fill_data,
+                               uint32_t blk_sz,
+                               uint32_t blk_num)
+{
+  size_t size = (size_t)blk_sz * blk_num;
+  size_t bufsize = MIN(size, FASTBOOT_FILL_BUFSIZE);
+  FAR void *buffer;
+  off_t start = offset;
+  off_t end = offset + size;
+  int ret;
+
+  /* Erased flash already holds the pattern, only the partial erase blocks
+   * at both ends are left to write.
+   */
+
+  fastboot_flash_fill_erase(fd, fill_data, &start, &end);
+
+  /* Write the rest with as few and as large writes as possible */
+
+  buffer = malloc(bufsize);
+  if (buffer == NULL && bufsize > blk_sz)
+    {
+      bufsize = blk_sz;
+      buffer = malloc(bufsize);
+    }
+
   if (buffer == NULL)
     {
       fb_err("Flash bwrite malloc fail\n");
       return -ENOMEM;
     }
 
-  fastboot_memset32(buffer, fill_data, blk_sz / 4);
+  fastboot_memset32(buffer, fill_data, bufsize / 4);
 
-  for (i = 0; i < blk_num; i++)
+  ret = fastboot_flash_fill_write(fd, offset, buffer, bufsize,
+                                  start - offset);
+  if (ret >= 0)
     {
-      ret = fastboot_flash_write(fd, offset, buffer, blk_sz);
-      if (ret < 0)
-        {
-          goto out;
-        }
-
-      offset += blk_sz;
+      ret = fastboot_flash_fill_write(fd, end, buffer, bufsize,
+                                      offset + size - end);
     }
 
-out:
   free(buffer);
   return ret;
 }
@@ -524,8 +660,8 @@ static int fastboot_flash_program(FAR struct fastboot_ctx_s *ctx, int fd)
             {
               uint32_t fill_data = be32toh(*(FAR uint32_t *)chunk_ptr);
               uint32_t chunk_size = chunk->chunk_sz * sparse->blk_sz;
-              ret = ffastboot_flash_fill(fd, ctx->download_offset, fill_data,
-                                         sparse->blk_sz, chunk->chunk_sz);
+              ret = fastboot_flash_fill(fd, ctx->download_offset, fill_data,
+                                        sparse->blk_sz, chunk->chunk_sz);
               if (ret < 0)
                 {
                   goto end;
@@ -555,12 +691,381 @@ end:
   return ret;
 }
 
+#ifdef CONFIG_SYSTEM_FASTBOOTD_STREAM
+/* Collect up to size bytes of a header, returns the bytes consumed */
+
+static size_t fastboot_stream_collect(FAR struct fastboot_stream_s *st,
+                                      FAR const uint8_t *data, size_t len,
+                                      size_t size)
+{
+  size_t n = MIN(len, size - st->hdrlen);
+
+  memcpy(st->hdr + st->hdrlen, data, n);
+  st->hdrlen += n;
+  return n;
+}
+
+static void fastboot_stream_next(FAR struct fastboot_stream_s *st)
+{
+  st->hdrlen = 0;
+  st->state = st->chunks > 0 ? FASTBOOT_STREAM_CHUNK : FASTBOOT_STREAM_DONE;
+}
+
+static int fastboot_stream_header(FAR struct fastboot_stream_s *st)
+{
+  FAR struct fastboot_sparse_header_s *sparse = &st->sparse;
+
+  memcpy(sparse, st->hdr, FASTBOOT_SPARSE_HEADER);
+  if (sparse->major_version != 1 ||
+      sparse->file_hdr_sz < FASTBOOT_SPARSE_HEADER ||
+      sparse->chunk_hdr_sz < FASTBOOT_CHUNK_HEADER ||
+      sparse->chunk_hdr_sz > sizeof(st->hdr) ||
+      sparse->blk_sz == 0 || sparse->blk_sz % 4 != 0)
+    {
+      fb_err("Bad sparse header\n");
+      return -EINVAL;
+    }
+
+  st->chunks = sparse->total_chunks;
+  st->left = sparse->file_hdr_sz - FASTBOOT_SPARSE_HEADER;
+  st->hdrlen = 0;
+  st->state = FASTBOOT_STREAM_SKIP;
+  return OK;
+}
+
+/* Every download is a complete sparse image: the pieces a big image is
+ * split into by the host start and end with don't care chunks for the
+ * parts sent in the other pieces.
+ */
+
+static int fastboot_stream_chunk(FAR struct fastboot_stream_s *st)
+{
+  FAR struct fastboot_chunk_header_s chunk;
+  size_t size;
+
+  memcpy(&chunk, st->hdr, FASTBOOT_CHUNK_HEADER);
+  size = (size_t)chunk.chunk_sz * st->sparse.blk_sz;
+  st->chunks--;
+  st->hdrlen = 0;
+
+  switch (chunk.chunk_type)
+    {
+      case FASTBOOT_CHUNK_RAW:
+        st->left = size;
+        st->state = FASTBOOT_STREAM_RAW;
+        break;
+      case FASTBOOT_CHUNK_FILL:
+        st->left = size;
+        st->state = FASTBOOT_STREAM_FILL;
+        break;
+      case FASTBOOT_CHUNK_DONT_CARE:
+        st->offset += size;
+        fastboot_stream_next(st);
+        break;
+      default:
+        if (chunk.chunk_type != FASTBOOT_CHUNK_CRC32)
+          {
+            fb_err("Error chunk type:%d, skip\n", chunk.chunk_type);
+          }
+
+        if (chunk.total_sz < st->sparse.chunk_hdr_sz)
+          {
+            return -EINVAL;
+          }
+
+        st->left = chunk.total_sz - st->sparse.chunk_hdr_sz;
+        st->state = FASTBOOT_STREAM_SKIP;
+        break;
+    }
+
+  return OK;
+}
+
+/* Program the next piece of the download, the sparse chunks may be cut
+ * anywhere between two pieces.
+ */
+
+static int fastboot_stream_parse(FAR struct fastboot_stream_s *st,
+                                 FAR uint8_t *data, size_t len)
+{
+  size_t n = 0;
+  int ret = OK;
+
+  while (len > 0 && ret >= 0)
+    {
+      switch (st->state)
+        {
+          case FASTBOOT_STREAM_START:
+            st->state = len >= 4 &&
+                        *(FAR uint32_t *)data == FASTBOOT_SPARSE_MAGIC ?
+                        FASTBOOT_STREAM_HEADER : FASTBOOT_STREAM_IMAGE;
+            n = 0;
+            break;
+
+          case FASTBOOT_STREAM_IMAGE:
+            n = len;
+            ret = fastboot_flash_write(st->fd, st->offset, data, n);
+            st->offset += n;
+            break;
+
+          case FASTBOOT_STREAM_HEADER:
+            n = fastboot_stream_collect(st, data, len,
+                                        FASTBOOT_SPARSE_HEADER);
+            if (st->hdrlen == FASTBOOT_SPARSE_HEADER)
+              {
+                ret = fastboot_stream_header(st);
+              }
+            break;
+
+          case FASTBOOT_STREAM_CHUNK:
+            n = fastboot_stream_collect(st, data, len,
+                                        st->sparse.chunk_hdr_sz);
+            if (st->hdrlen == st->sparse.chunk_hdr_sz)
+              {
+                ret = fastboot_stream_chunk(st);
+              }
+            break;
+
+          case FASTBOOT_STREAM_RAW:
+            n = MIN(len, st->left);
+            ret = fastboot_flash_write(st->fd, st->offset, data, n);
+            st->offset += n;
+            st->left -= n;
+            if (st->left == 0)
+              {
+                fastboot_stream_next(st);
+              }
+            break;
+
+          case FASTBOOT_STREAM_FILL:
+            n = fastboot_stream_collect(st, data, len, 4);
+            if (st->hdrlen == 4)
+              {
+                ret = fastboot_flash_fill(st->fd, st->offset,
+                                          be32toh(*(FAR uint32_t *)st->hdr),
+                                          st->sparse.blk_sz,
+                                          st->left / st->sparse.blk_sz);
+                st->offset += st->left;
+                fastboot_stream_next(st);
+              }
+            break;
+
+          case FASTBOOT_STREAM_SKIP:
+            n = MIN(len, st->left);
+            st->left -= n;
+            if (st->left == 0)
+              {
+                fastboot_stream_next(st);
+              }
+            break;
+
+          default:
+            n = len;
+            break;
+        }
+
+      data += n;
+      len -= n;
+    }
+
+  return ret;
+}
+
+static FAR void *fastboot_stream_thread(FAR void *arg)
+{
+  FAR struct fastboot_stream_s *st = arg;
+  int idx = 0;
+  int ret;
+
+  pthread_mutex_lock(&st->lock);
+
+  while (1)
+    {
+      while (st->len[idx] == 0 && !st->done)
+        {
+          pthread_cond_wait(&st->cond, &st->lock);
+        }
+
+      if (st->len[idx] == 0)
+        {
+          break;
+        }
+
+      /* Program this half while the transport fills the other one. After
+       * an error the rest of the download is still drained.
+       */
+
+      pthread_mutex_unlock(&st->lock);
+      ret = st->result < 0 ? st->result :
+            fastboot_stream_parse(st, st->buf[idx], st->len[idx]);
+      pthread_mutex_lock(&st->lock);
+
+      st->result = ret;
+      st->len[idx] = 0;
+      pthread_cond_broadcast(&st->cond);
+      idx ^= 1;
+    }
+
+  pthread_mutex_unlock(&st->lock);
+  return NULL;
+}
+
+static int fastboot_stream_download(FAR struct fastboot_ctx_s *ctx,
+                                    size_t len)
+{
+  struct fastboot_stream_s st;
+  char blkdev[PATH_MAX];
+  size_t half = ctx->download_max / 2;
+  int idx = 0;
+  int ret;
+
+  snprintf(blkdev, PATH_MAX, FASTBOOT_BLKDEV, ctx->stream_part);
+
+  memset(&st, 0, sizeof(st));
+  st.buf[0] = ctx->download_buffer;
+  st.buf[1] = st.buf[0] + half;
+  st.fd = fastboot_flash_open(blkdev);
+  if (st.fd < 0)
+    {
+      return st.fd;
+    }
+
+  pthread_mutex_init(&st.lock, NULL);
+  pthread_cond_init(&st.cond, NULL);
+  ret = -pthread_create(&st.thread, NULL, fastboot_stream_thread, &st);
+  if (ret < 0)
+    {
+      goto out;
+    }
+
+  while (len > 0)
+    {
+      size_t size = MIN(len, half);
+      size_t n = 0;
+
+      pthread_mutex_lock(&st.lock);
+      while (st.len[idx] != 0)
+        {
+          pthread_cond_wait(&st.cond, &st.lock);
+        }
+
+      pthread_mutex_unlock(&st.lock);
+
+      while (n < size)
+        {
+          ssize_t r = ctx->ops->read(ctx, st.buf[idx] + n, size - n);
+          if (r <= 0)
+            {
+              if (r < 0 && errno == EAGAIN)
+                {
+                  continue;
+                }
+
+              fb_err("fastboot_download usb read error\n");
+              ret = -EIO;
+              break;
+            }
+
+          n += r;
+        }
+
+      if (ret < 0)
+        {
+          break;
+        }
+
+      pthread_mutex_lock(&st.lock);
+      st.len[idx] = n;
+      pthread_cond_broadcast(&st.cond);
+      pthread_mutex_unlock(&st.lock);
+
+      len -= n;
+      idx ^= 1;
+    }
+
+  pthread_mutex_lock(&st.lock);
+  st.done = true;
+  pthread_cond_broadcast(&st.cond);
+  pthread_mutex_unlock(&st.lock);
+  pthread_join(st.thread, NULL);
+
+  if (ret >= 0)
+    {
+      ret = st.result;
+    }
+
+out:
+  pthread_cond_destroy(&st.cond);
+  pthread_mutex_destroy(&st.lock);
+  fastboot_flash_close(st.fd);
+  return ret;
+}
+
+/* Usage(host):
+ *   fastboot oem stream <partition>
+ *   fastboot [-S <size>] flash <partition> <image>
+ *   fastboot oem stream
+ *
+ * Once armed, each download is programmed into <partition> while it is
+ * received and is not limited to max-download-size any more, the flash
+ * command that follows only reports the result.  Without a partition
+ * streaming is turned off again.
+ */
+
+static void fastboot_stream(FAR struct fastboot_ctx_s *ctx,
+                            FAR const char *arg)
+{
+  free(ctx->stream_part);
+  ctx->stream_part = NULL;
+  ctx->stream_size = 0;
+
+  if (arg != NULL && *arg != '\0')
+    {
+      ctx->stream_part = strdup(arg);
+      if (ctx->stream_part == NULL)
+        {
+          fastboot_fail(ctx, "No memory");
+          return;
+        }
+    }
+
+  fastboot_okay(ctx, "");
+}
+
+static void fastboot_stream_flash(FAR struct fastboot_ctx_s *ctx,
+                                  FAR const char *arg)
+{
+  if (ctx->stream_size == 0)
+    {
+      fastboot_fail(ctx, "No streamed image");
+    }
+  else if (strcmp(arg, ctx->stream_part) != 0)
+    {
+      fastboot_fail(ctx, "Streamed to %s", ctx->stream_part);
+    }
+  else
+    {
+      fastboot_okay(ctx, "");
+    }
+
+  ctx->stream_size = 0;
+}
+#endif
+
 static void fastboot_flash(FAR struct fastboot_ctx_s *ctx,
                            FAR const char *arg)
 {
   char blkdev[PATH_MAX];
   int ret;
 
+#ifdef CONFIG_SYSTEM_FASTBOOTD_STREAM
+  if (ctx->stream_part != NULL)
+    {
+      fastboot_stream_flash(ctx, arg);
+      return;
+    }
+#endif
+
   snprintf(blkdev, PATH_MAX, FASTBOOT_BLKDEV, arg);
 
   if (ctx->flash_fd < 0)
@@ -653,7 +1158,11 @@ static void fastboot_download(FAR struct fastboot_ctx_s *ctx,
   int ret;
 
   len = strtoul(arg, NULL, 16);
+#ifdef CONFIG_SYSTEM_FASTBOOTD_STREAM
+  if (len > ctx->download_max && ctx->stream_part == NULL)
+#else
   if (len > ctx->download_max)
+#endif
     {
       fastboot_fail(ctx, "Data too large");
       return;
@@ -667,6 +1176,25 @@ static void fastboot_download(FAR struct fastboot_ctx_s *ctx,
       return;
     }
 
+#ifdef CONFIG_SYSTEM_FASTBOOTD_STREAM
+  if (ctx->stream_part != NULL)
+    {
+      ctx->download_size = 0;
+      ctx->stream_size = 0;
+
+      ret = fastboot_stream_download(ctx, len);
+      if (ret < 0)
+        {
+          fastboot_fail(ctx, "Image flash failure");
+          return;
+        }
+
+      ctx->stream_size = len;
+      fastboot_okay(ctx, "");
+      return;
+    }
+#endif
+
   download = ctx->download_buffer;
   ctx->download_size = len;
 
@@ -1446,8 +1974,20 @@ static int fastboot_tcp_write(FAR struct fastboot_ctx_s *ctx,
                               FAR const void *buf, size_t len)
 {
   uint64_t data_size = htobe64(len);
+  uint8_t msg[sizeof(data_size) + FASTBOOT_MSG_LEN + 4];
   int ret;
 
+  /* Responses go out in one segment, a separate data_size write would
+   * stall on Nagle and delayed ACK for every command.
+   */
+
+  if (len <= sizeof(msg) - sizeof(data_size))
+    {
+      memcpy(msg, &data_size, sizeof(data_size));
+      memcpy(msg + sizeof(data_size), buf, len);
+      return fastboot_write(ctx->tran_fd[1], msg, sizeof(data_size) + len);
+    }
+
   ret = fastboot_write(ctx->tran_fd[1], &data_size, sizeof(data_size));
   if (ret < 0)
     {
@@ -1473,6 +2013,10 @@ static int fastboot_context_initialize(FAR struct fastboot_ctx_s *ctx,
       ctx->varlist         = NULL;
       ctx->left            = ctx[0].left;
       ctx->ops             = &g_tran_ops[nctx];
+#ifdef CONFIG_SYSTEM_FASTBOOTD_STREAM
+      ctx->stream_part     = NULL;
+      ctx->stream_size     = 0;
+#endif
       ctx->tran_fd[0]      = -1;
       ctx->tran_fd[1]      = -1;
 
@@ -1505,6 +2049,10 @@ static void fastboot_context_deinit(FAR struct fastboot_ctx_s *ctx,
           ctx->ops->deinit(ctx);
           free(ctx->download_buffer);
         }
+
+#ifdef CONFIG_SYSTEM_FASTBOOTD_STREAM
+      free(ctx->stream_part);
+#endif
     }
 }
 
@@ -37,6 +37,7 @@
 #include "action.h"
 #include "builtin.h"
 #include "init.h"
+#include "timeline.h"
 
 /****************************************************************************
  * Pre-processor Definitions
@@ -80,6 +81,7 @@ static void add_ready(FAR struct action_manager_s *am,
                       FAR struct action_s *a)
 {
   FAR struct action_s *ready;
+  int i;
 #ifdef CONFIG_SYSTEM_NXINIT_DEBUG
   FAR struct action_cmd_s *cmd;
 
@@ -101,40 +103,172 @@ static void add_ready(FAR struct action_manager_s *am,
         }
     }
 
+  for (i = 0; i < am->nworkers; i++)
+    {
+      if (am->workers[i].action == a)
+        {
+          init_debug("Action %p(%s) already running", a,
+                     a->event ? a->event : "");
+          return;
+        }
+    }
+
   list_add_tail(&am->ready_actions, &a->ready_node);
 }
 
-static void update_ready(FAR struct action_manager_s *am)
+static bool workers_idle(FAR struct action_manager_s *am)
 {
-  size_t i;
-
-  /* Actions with event trigger */
+  int i;
 
-  for (i = 0; i < nitems(am->events); i++)
+  for (i = 0; i < am->nworkers; i++)
     {
-      if (!am->events[i])
+      if (am->workers[i].action)
         {
-          continue;
+          return false;
         }
+    }
+
+  return true;
+}
+
+/* The events are queued in the order they were added, events[0] is the
+ * one whose actions are executed.  The actions of an event may run
+ * concurrently, but the next event is only taken once all of them have
+ * finished: what an earlier trigger prepares is there for a later one.
+ */
 
+static void update_ready(FAR struct action_manager_s *am)
+{
+  /* Actions with event trigger */
+
+  while (am->events[0])
+    {
       am->current = list_prepare_entry(am->current, &am->actions,
                                        struct action_s, node);
       list_for_every_entry_continue(am->current, &am->actions,
                                     struct action_s, node)
         {
           if (am->current->event && !strcmp(am->current->event,
-                                            am->events[i]))
+                                            am->events[0]))
             {
               add_ready(am, am->current);
               return;
             }
         }
 
-      init_debug("Remove event [%zu] '%s'", i, am->events[i]);
+      if (!list_is_empty(&am->ready_actions) || !workers_idle(am))
+        {
+          /* Continue after the last action when called again */
+
+          am->current = list_last_entry(&am->actions, struct action_s,
+                                        node);
+          return;
+        }
+
+      init_debug("Remove event '%s'", am->events[0]);
       am->current = NULL;
-      free(am->events[i]);
-      am->events[i] = NULL;
+      free(am->events[0]);
+      memmove(&am->events[0], &am->events[1],
+              sizeof(am->events) - sizeof(am->events[0]));
+      am->events[nitems(am->events) - 1] = NULL;
+    }
+}
+
+static int elapsed_ms(FAR const struct timespec *start)
+{
+  struct timespec time;
+
+  clock_gettime(CLOCK_MONOTONIC, &time);
+  clock_timespec_subtract(&time, start, &time);
+  return TIMESPEC2MS(time);
+}
+
+static void reap_worker(FAR struct action_manager_s *am,
+                        FAR struct action_worker_s *worker)
+{
+#if defined(CONFIG_SYSTEM_NXINIT_ACTION_WARN_SLOW) && \
+    CONFIG_SYSTEM_NXINIT_ACTION_WARN_SLOW > 0
+  int ms = elapsed_ms(&worker->time_run);
+
+  if (ms > CONFIG_SYSTEM_NXINIT_ACTION_WARN_SLOW)
+    {
+      if (worker->pid_running <= 0)
+        {
+          init_warn("Command '%s' took %d ms", worker->running->argv[0],
+                    ms);
+        }
+      else
+        {
+          init_warn("Command '%s' pid %d took %d ms",
+                    worker->running->argv[0], worker->pid_running, ms);
+        }
+    }
+#endif
+
+  init_timeline_end(worker->timeline);
+  worker->pid_running = -1;
+  if (list_is_tail(&worker->action->cmds, &worker->running->node))
+    {
+      worker->running = NULL;
+      worker->action = NULL;
+    }
+  else
+    {
+      worker->running = list_next_entry(worker->running,
+                                        struct action_cmd_s, node);
+    }
+}
+
+static int run_worker(FAR struct action_manager_s *am,
+                      FAR struct action_worker_s *worker)
+{
+  FAR struct action_cmd_s *cmd = worker->running;
+  int ret;
+
+  if (worker->pid_running != -1)
+    {
+      init_debug("Waiting '%s' pid %d", cmd->argv[0], worker->pid_running);
+      return INT_MAX;
+    }
+
+  if (worker->wait != NULL)
+    {
+      if (!init_condition_check(am->sm, worker->wait))
+        {
+          ret = elapsed_ms(&worker->time_run);
+          if (worker->wait_timeout <= 0 || ret < worker->wait_timeout)
+            {
+              return worker->wait_timeout <= 0 ? INIT_CONDITION_POLL :
+                     MIN(INIT_CONDITION_POLL, worker->wait_timeout - ret);
+            }
+
+          init_warn("Command '%s' timed out after %d ms", cmd->argv[0],
+                    ret);
+        }
+
+      init_condition_free(worker->wait);
+      worker->wait = NULL;
+      reap_worker(am, worker);
+      return 0;
+    }
+
+  clock_gettime(CLOCK_MONOTONIC, &worker->time_run);
+  worker->timeline = init_timeline_begin("command", cmd->argc, cmd->argv);
+
+  am->worker = worker;
+  ret = init_builtin_run(am, cmd->argc, cmd->argv);
+  am->worker = NULL;
+
+  if (ret > 0)
+    {
+      worker->pid_running = ret;
     }
+  else if (worker->wait == NULL)
+    {
+      reap_worker(am, worker);
+    }
+
+  return 0;
 }
 
 /****************************************************************************
@@ -173,7 +307,9 @@ int init_action_add_event(FAR struct action_manager_s *am,
  * Name: init_action_run_command
  *
  * Description:
- *   Execute the ready commands in the action.
+ *   Execute the ready commands in the action. Every worker executes the
+ *   commands of one ready action in order, idle workers take the next
+ *   ready action.
  *
  * Input Parameters:
  *   am - Instance of Action Manager
@@ -185,86 +321,145 @@ int init_action_add_event(FAR struct action_manager_s *am,
 
 int init_action_run_command(FAR struct action_manager_s *am)
 {
-  FAR struct action_s *ready;
+  FAR struct action_worker_s *worker;
+  int next = INT_MAX;
   int ret;
+  int i;
 
-  if (am->pid_running != -1)
+  for (i = 0; i < am->nworkers; i++)
     {
-      init_debug("Waiting '%s' pid %d", am->running->argv[0],
-                 am->pid_running);
-      return INT_MAX;
-    }
+      worker = &am->workers[i];
+      if (worker->action == NULL)
+        {
+          update_ready(am);
+          if (list_is_empty(&am->ready_actions))
+            {
+              continue;
+            }
 
-  update_ready(am);
-  if (list_is_empty(&am->ready_actions))
-    {
-      return INT_MAX;
+          worker->action = list_peek_head_type(&am->ready_actions,
+                                               struct action_s,
+                                               ready_node);
+          list_delete(&worker->action->ready_node);
+          worker->running = list_peek_head_type(&worker->action->cmds,
+                                                struct action_cmd_s, node);
+          worker->pid_running = -1;
+          if (worker->running == NULL)
+            {
+              worker->action = NULL;
+              next = 0;
+              continue;
+            }
+        }
+
+      ret = run_worker(am, worker);
+      next = MIN(next, ret);
     }
 
-  ready = list_peek_head_type(&am->ready_actions, struct action_s,
-                              ready_node);
+  return next;
+}
 
-  if (!am->running)
-    {
-      am->running = list_peek_head_type(&ready->cmds,
-                                        struct action_cmd_s, node);
-    }
+/****************************************************************************
+ * Name: init_action_reap_command
+ *
+ * Description:
+ *   Complete the command that waits for the exited process.
+ *
+ * Input Parameters:
+ *   am  - Instance of Action Manager
+ *   pid - The exited process
+ *
+ * Returned Value:
+ *   The name of the command, NULL if no command waited for the process.
+ ****************************************************************************/
 
-#if defined(CONFIG_SYSTEM_NXINIT_ACTION_WARN_SLOW) && \
-    CONFIG_SYSTEM_NXINIT_ACTION_WARN_SLOW > 0
-  clock_gettime(CLOCK_MONOTONIC, &am->time_run);
-#endif
-  ret = init_builtin_run(am, am->running->argc, am->running->argv);
-  if (ret > 0)
-    {
-      am->pid_running = ret;
-    }
-  else
+FAR const char *init_action_reap_command(FAR struct action_manager_s *am,
+                                         int pid)
+{
+  FAR struct action_worker_s *worker;
+  FAR const char *name;
+  int i;
+
+  for (i = 0; i < am->nworkers; i++)
     {
-      init_action_reap_command(am);
+      worker = &am->workers[i];
+      if (worker->action != NULL && worker->pid_running == pid)
+        {
+          name = worker->running->argv[0];
+          reap_worker(am, worker);
+          return name;
+        }
     }
 
-  return 0;
+  return NULL;
 }
 
-void init_action_reap_command(FAR struct action_manager_s *am)
+/****************************************************************************
+ * Name: init_action_wait
+ *
+ * Description:
+ *   Make the command being executed wait for a condition. The worker
+ *   continues with the next command of its action once the condition
+ *   holds or the timeout expires, the other workers are not blocked.
+ *
+ * Input Parameters:
+ *   am      - Instance of Action Manager
+ *   argc    - Argument count.
+ *   argv    - The condition, see init_condition_new().
+ *   timeout - Timeout in ms, 0 waits forever.
+ *
+ * Returned Value:
+ *   Returns 0 on success; Returns the negative value of errno on failure.
+ ****************************************************************************/
+
+int init_action_wait(FAR struct action_manager_s *am, int argc,
+                     FAR char **argv, int timeout)
 {
-  FAR struct action_s *ready = list_peek_head_type(&am->ready_actions,
-                                                   struct action_s,
-                                                   ready_node);
+  FAR struct init_condition_s *cond;
 
-#if defined(CONFIG_SYSTEM_NXINIT_ACTION_WARN_SLOW) && \
-    CONFIG_SYSTEM_NXINIT_ACTION_WARN_SLOW > 0
-  struct timespec time;
-  int ms;
+  if (am->worker == NULL)
+    {
+      return -EINVAL;
+    }
 
-  clock_gettime(CLOCK_MONOTONIC, &time);
-  clock_timespec_subtract(&time, &am->time_run, &time);
-  ms = TIMESPEC2MS(time);
-  if (ms > CONFIG_SYSTEM_NXINIT_ACTION_WARN_SLOW)
+  cond = init_condition_new(argc, argv);
+  if (cond == NULL)
     {
-      if (am->pid_running <= 0)
-        {
-          init_warn("Command '%s' took %d ms", am->running->argv[0], ms);
-        }
-      else
-        {
-          init_warn("Command '%s' pid %d took %d ms", am->running->argv[0],
-                    am->pid_running, ms);
-        }
+      return -errno;
     }
-#endif
 
-  am->pid_running = -1;
-  if (list_is_tail(&ready->cmds, &am->running->node))
+  /* Only a service can wait for its own exit, see option "ready" */
+
+  if (cond->type == INIT_CONDITION_EXITED)
     {
-      am->running = NULL;
-      list_delete(&ready->ready_node);
+      init_err("Command '%s' cannot wait for '%s'",
+               am->worker->running->argv[0], argv[0]);
+      init_condition_free(cond);
+      return -EINVAL;
     }
-  else
+
+  if (init_condition_check(am->sm, cond))
     {
-      am->running = list_next_entry(am->running, struct action_cmd_s, node);
+      init_condition_free(cond);
+      return 0;
     }
+
+  am->worker->wait = cond;
+  am->worker->wait_timeout = timeout;
+  return 0;
+}
+
+/****************************************************************************
+ * Name: init_action_idle
+ *
+ * Description:
+ *   Check whether all triggered actions have been executed.
+ ****************************************************************************/
+
+bool init_action_idle(FAR struct action_manager_s *am)
+{
+  return am->events[0] == NULL && workers_idle(am) &&
+         list_is_empty(&am->ready_actions);
 }
 
 int init_action_parse(FAR const struct parser_s *parser,
@@ -29,8 +29,10 @@
 
 #include <nuttx/list.h>
 
+#include <stdbool.h>
 #include <time.h>
 
+#include "condition.h"
 #include "parser.h"
 
 /****************************************************************************
@@ -56,6 +58,25 @@ struct action_s
   struct list_node cmds;          /* Command header, struct action_cmd_s */
 };
 
+/* A worker executes the commands of one ready action in order. Several
+ * workers execute different ready actions concurrently.
+ */
+
+struct action_worker_s
+{
+  FAR struct action_s *action;    /* Action executed, NULL if idle */
+  FAR struct action_cmd_s *running;
+  int pid_running;                /* Pid the command waits for, or -1 */
+
+  /* Condition the command waits for, see the "wait" commands */
+
+  FAR struct init_condition_s *wait;
+  int wait_timeout;               /* In ms, 0 waits forever */
+
+  struct timespec time_run;
+  int timeline;                   /* Boot timeline entry */
+};
+
 struct action_manager_s
 {
   struct list_node actions;       /* Action header, struct action_s */
@@ -64,12 +85,10 @@ struct action_manager_s
   FAR char *events[CONFIG_SYSTEM_NXINIT_ACTION_MANAGER_EVENT_MAX];
   FAR struct action_s *current;
 
-  FAR struct action_cmd_s *running;
-  int pid_running;
-#if defined(CONFIG_SYSTEM_NXINIT_ACTION_WARN_SLOW) && \
-    CONFIG_SYSTEM_NXINIT_ACTION_WARN_SLOW > 0
-  struct timespec time_run;
-#endif
+  struct action_worker_s workers[CONFIG_SYSTEM_NXINIT_ACTION_WORKERS];
+  FAR struct action_worker_s *worker; /* Worker of the builtin running */
+  int nworkers;                   /* Workers used, at most nitems(workers) */
+
   FAR struct service_manager_s *sm;
 };
 
@@ -80,7 +99,11 @@ struct action_manager_s
 int  init_action_add_event(FAR struct action_manager_s *am,
                            FAR const char *name);
 int  init_action_run_command(FAR struct action_manager_s *am);
-void init_action_reap_command(FAR struct action_manager_s *am);
+FAR const char *init_action_reap_command(FAR struct action_manager_s *am,
+                                         int pid);
+int  init_action_wait(FAR struct action_manager_s *am, int argc,
+                      FAR char **argv, int timeout);
+bool init_action_idle(FAR struct action_manager_s *am);
 int  init_action_parse(FAR const struct parser_s *parser,
                        bool create, FAR char *buf);
 #ifdef CONFIG_SYSTEM_NXINIT_DEBUG
@@ -33,8 +33,17 @@
 
 #include "builtin.h"
 #include "init.h"
+#include "property.h"
 #include "service.h"
 
+/****************************************************************************
+ * Pre-processor Definitions
+ ****************************************************************************/
+
+/* Default timeout of the "wait" command, as in Android Init */
+
+#define BUILTIN_WAIT_TIMEOUT 5000
+
 /****************************************************************************
  * Private Types
  ****************************************************************************/
@@ -65,6 +74,14 @@ static int cmd_class_start(FAR struct action_manager_s *am,
                            int argc, FAR char **argv);
 static int cmd_class_stop(FAR struct action_manager_s *am,
                           int argc, FAR char **argv);
+static int cmd_setprop(FAR struct action_manager_s *am,
+                       int argc, FAR char **argv);
+static int cmd_wait(FAR struct action_manager_s *am,
+                    int argc, FAR char **argv);
+static int cmd_wait_for(FAR struct action_manager_s *am,
+                        int argc, FAR char **argv);
+static int cmd_wait_for_prop(FAR struct action_manager_s *am,
+                             int argc, FAR char **argv);
 
 /****************************************************************************
  * Private Data
@@ -76,9 +93,13 @@ static const struct cmd_map_s g_builtin[] =
   {"class_stop", 2, 2, cmd_class_stop},
   {"exec", 3, 99, cmd_exec},
   {"exec_start", 2, 2, cmd_exec_start},
+  {"setprop", 3, 3, cmd_setprop},
   {"start", 2, 2, cmd_start},
   {"stop", 2, 2, cmd_stop},
   {"trigger", 2, 2, cmd_trigger},
+  {"wait", 2, 3, cmd_wait},
+  {"wait_for", 2, 4, cmd_wait_for},
+  {"wait_for_prop", 3, 3, cmd_wait_for_prop},
 };
 
 /****************************************************************************
@@ -109,7 +130,7 @@ static int cmd_exec_start(FAR struct action_manager_s *am,
       return -EINVAL;
     }
 
-  return init_service_start(service);
+  return init_service_start(am->sm, service);
 }
 
 static int cmd_start(FAR struct action_manager_s *am,
@@ -142,6 +163,45 @@ static int cmd_trigger(FAR struct action_manager_s *am,
   return init_action_add_event(am, argv[1]);
 }
 
+static int cmd_setprop(FAR struct action_manager_s *am,
+                       int argc, FAR char **argv)
+{
+  return init_property_set(argv[1], argv[2]);
+}
+
+/* wait <path> [ <timeout> ]: wait for a file, the timeout is in seconds */
+
+static int cmd_wait(FAR struct action_manager_s *am,
+                    int argc, FAR char **argv)
+{
+  FAR char *cond[2];
+
+  cond[0] = "file";
+  cond[1] = argv[1];
+  return init_action_wait(am, nitems(cond), cond,
+                          argc > 2 ? atoi(argv[2]) * 1000 :
+                                     BUILTIN_WAIT_TIMEOUT);
+}
+
+/* wait_for <condition>: wait for any condition, see condition.h */
+
+static int cmd_wait_for(FAR struct action_manager_s *am,
+                        int argc, FAR char **argv)
+{
+  return init_action_wait(am, argc - 1, &argv[1], 0);
+}
+
+static int cmd_wait_for_prop(FAR struct action_manager_s *am,
+                             int argc, FAR char **argv)
+{
+  FAR char *cond[3];
+
+  cond[0] = "property";
+  cond[1] = argv[1];
+  cond[2] = argv[2];
+  return init_action_wait(am, nitems(cond), cond, 0);
+}
+
 static int cmd_exec(FAR struct action_manager_s *am,
                     int argc, FAR char **argv)
 {
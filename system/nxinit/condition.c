@@ -0,0 +1,226 @@
+/****************************************************************************
+ * apps/system/nxinit/condition.c
+ *
+ * SPDX-License-Identifier: Apache-2.0
+ *
+ * Licensed to the Apache Software Foundation (ASF) under one or more
+ * contributor license agreements.  See the NOTICE file distributed with
+ * this work for additional information regarding copyright ownership.  The
+ * ASF licenses this file to you under the Apache License, Version 2.0 (the
+ * "License"); you may not use this file except in compliance with the
+ * License.  You may obtain a copy of the License at
+ *
+ *   http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS, WITHOUT
+ * WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.  See the
+ * License for the specific language governing permissions and limitations
+ * under the License.
+ *
+ ****************************************************************************/
+
+/****************************************************************************
+ * Included Files
+ ****************************************************************************/
+
+#include <nuttx/config.h>
+
+#include <errno.h>
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+#include <sys/param.h>
+#include <sys/stat.h>
+
+#if defined(CONFIG_NET_TCP) && defined(CONFIG_NET_IPv4)
+#  include <arpa/inet.h>
+#  include <netinet/in.h>
+#  include <sys/socket.h>
+#endif
+
+#include "condition.h"
+#include "init.h"
+#include "parser.h"
+#include "property.h"
+#include "service.h"
+
+/****************************************************************************
+ * Private Data
+ ****************************************************************************/
+
+/* Indexed by enum init_condition_type_e */
+
+static const struct
+{
+  FAR const char *name;
+  uint8_t minargs;
+  uint8_t maxargs;
+}
+g_condition[] =
+{
+  {"file", 2, 2},
+  {"socket", 2, 2},
+  {"tcp", 2, 2},
+  {"property", 2, 3},
+  {"service", 2, 2},
+  {"exited", 1, 1},
+};
+
+/****************************************************************************
+ * Private Functions
+ ****************************************************************************/
+
+#if defined(CONFIG_NET_TCP) && defined(CONFIG_NET_IPv4)
+static bool check_tcp(FAR const char *port)
+{
+  struct sockaddr_in addr;
+  bool ret;
+  int fd;
+
+  fd = socket(AF_INET, SOCK_STREAM | SOCK_CLOEXEC, 0);
+  if (fd < 0)
+    {
+      return false;
+    }
+
+  memset(&addr, 0, sizeof(addr));
+  addr.sin_family = AF_INET;
+  addr.sin_port = htons(atoi(port));
+  addr.sin_addr.s_addr = htonl(INADDR_LOOPBACK);
+
+  ret = connect(fd, (FAR struct sockaddr *)&addr, sizeof(addr)) == 0;
+  close(fd);
+  return ret;
+}
+#endif
+
+/****************************************************************************
+ * Public Functions
+ ****************************************************************************/
+
+/****************************************************************************
+ * Name: init_condition_new
+ *
+ * Description:
+ *   Create a condition from its arguments, e.g. "file /dev/ttyS1" or
+ *   "property net.up 1".
+ *
+ * Input Parameters:
+ *   argc - Argument count.
+ *   argv - Condition type followed by its arguments.
+ *
+ * Returned Value:
+ *   The new condition, or NULL with errno set on failure.
+ ****************************************************************************/
+
+FAR struct init_condition_s *init_condition_new(int argc, FAR char **argv)
+{
+  FAR struct init_condition_s *cond;
+  size_t i;
+
+  for (i = 0; i < nitems(g_condition); i++)
+    {
+      if (!strcmp(g_condition[i].name, argv[0]))
+        {
+          break;
+        }
+    }
+
+  if (i == nitems(g_condition) || argc < g_condition[i].minargs ||
+      argc > g_condition[i].maxargs)
+    {
+      init_err("Invalid condition '%s'", argv[0]);
+      errno = EINVAL;
+      return NULL;
+    }
+
+#if !defined(CONFIG_NET_TCP) || !defined(CONFIG_NET_IPv4)
+  /* The condition could never become true and would hold up boot */
+
+  if (i == INIT_CONDITION_TCP)
+    {
+      init_err("Condition '%s' needs TCP/IPv4 support", argv[0]);
+      errno = ENOSYS;
+      return NULL;
+    }
+#endif
+
+  cond = calloc(1, sizeof(*cond));
+  if (cond == NULL)
+    {
+      init_err("Alloc condition");
+      return NULL;
+    }
+
+  cond->type = i;
+  if ((argc > 1 && (cond->arg = strdup(argv[1])) == NULL) ||
+      (argc > 2 && (cond->value = strdup(argv[2])) == NULL))
+    {
+      init_err("Alloc condition argument");
+      init_condition_free(cond);
+      errno = ENOMEM;
+      return NULL;
+    }
+
+  return cond;
+}
+
+void init_condition_free(FAR struct init_condition_s *cond)
+{
+  if (cond != NULL)
+    {
+      free(cond->arg);
+      free(cond->value);
+      free(cond);
+    }
+}
+
+/****************************************************************************
+ * Name: init_condition_check
+ *
+ * Description:
+ *   Check whether a condition holds now. An "exited" condition is never
+ *   true here, the service manager handles it when the service exits.
+ *
+ * Input Parameters:
+ *   sm   - Instance of Service Manager
+ *   cond - The condition
+ *
+ * Returned Value:
+ *   True if the condition holds.
+ ****************************************************************************/
+
+bool init_condition_check(FAR struct service_manager_s *sm,
+                          FAR const struct init_condition_s *cond)
+{
+  FAR struct service_s *service;
+  FAR const char *value;
+  struct stat sb;
+
+  switch (cond->type)
+    {
+      case INIT_CONDITION_FILE:
+        return access(cond->arg, F_OK) == 0;
+
+      case INIT_CONDITION_SOCKET:
+        return stat(cond->arg, &sb) == 0 && S_ISSOCK(sb.st_mode);
+
+#if defined(CONFIG_NET_TCP) && defined(CONFIG_NET_IPv4)
+      case INIT_CONDITION_TCP:
+        return check_tcp(cond->arg);
+#endif
+
+      case INIT_CONDITION_PROPERTY:
+        value = init_property_get(cond->arg);
+        return value != NULL &&
+               (cond->value == NULL || !strcmp(value, cond->value));
+
+      case INIT_CONDITION_SERVICE:
+        service = init_service_find_by_name(sm, cond->arg);
+        return service != NULL && (service->flags & SVC_READY) != 0;
+
+      default:
+        return false;
+    }
+}
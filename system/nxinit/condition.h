@@ -0,0 +1,79 @@
+/****************************************************************************
+ * apps/system/nxinit/condition.h
+ *
+ * SPDX-License-Identifier: Apache-2.0
+ *
+ * Licensed to the Apache Software Foundation (ASF) under one or more
+ * contributor license agreements.  See the NOTICE file distributed with
+ * this work for additional information regarding copyright ownership.  The
+ * ASF licenses this file to you under the Apache License, Version 2.0 (the
+ * "License"); you may not use this file except in compliance with the
+ * License.  You may obtain a copy of the License at
+ *
+ *   http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS, WITHOUT
+ * WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.  See the
+ * License for the specific language governing permissions and limitations
+ * under the License.
+ *
+ ****************************************************************************/
+
+#ifndef __APPS_SYSTEM_NXINIT_CONDITION_H
+#define __APPS_SYSTEM_NXINIT_CONDITION_H
+
+/****************************************************************************
+ * Included Files
+ ****************************************************************************/
+
+#include <nuttx/list.h>
+
+#include <stdbool.h>
+#include <stdint.h>
+
+/****************************************************************************
+ * Pre-processor Definitions
+ ****************************************************************************/
+
+/* Conditions are checked again after this many ms while something waits
+ * for them.
+ */
+
+#define INIT_CONDITION_POLL  CONFIG_SYSTEM_NXINIT_CONDITION_POLL
+
+/****************************************************************************
+ * Public Types
+ ****************************************************************************/
+
+enum init_condition_type_e
+{
+  INIT_CONDITION_FILE = 0,    /* file <path>: the path exists */
+  INIT_CONDITION_SOCKET,      /* socket <path>: a local socket is bound */
+  INIT_CONDITION_TCP,         /* tcp <port>: a local port accepts
+                               * connections */
+  INIT_CONDITION_PROPERTY,    /* property <name> [<value>]: the property
+                               * is set (to the value) */
+  INIT_CONDITION_SERVICE,     /* service <name>: the service is ready */
+  INIT_CONDITION_EXITED,      /* exited: the service exited with 0 */
+};
+
+struct init_condition_s
+{
+  struct list_node node;      /* Condition list node */
+  uint8_t type;               /* enum init_condition_type_e */
+  FAR char *arg;              /* Path, port, property or service name */
+  FAR char *value;            /* Property value, NULL for any */
+};
+
+struct service_manager_s;
+
+/****************************************************************************
+ * Public Function Prototypes
+ ****************************************************************************/
+
+FAR struct init_condition_s *init_condition_new(int argc, FAR char **argv);
+void init_condition_free(FAR struct init_condition_s *cond);
+bool init_condition_check(FAR struct service_manager_s *sm,
+                          FAR const struct init_condition_s *cond);
+#endif /* __APPS_SYSTEM_NXINIT_CONDITION_H */
@@ -28,6 +28,9 @@
 
 #include <errno.h>
 #include <poll.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <unistd.h>
 #include <sys/param.h>
 #include <sys/boardctl.h>
 #include <sys/wait.h>
@@ -39,6 +42,7 @@
 #include "init.h"
 #include "import.h"
 #include "service.h"
+#include "timeline.h"
 
 /****************************************************************************
  * Pre-processor Definitions
@@ -68,6 +72,17 @@ struct init_event_s
  * Private Functions
  ****************************************************************************/
 
+static void show_usage(FAR const char *progname)
+{
+  fprintf(stderr, "Usage: %s [-f <rc file>] [-j <workers>] [-x]\n",
+          progname);
+  fprintf(stderr, "  -f  RC file, default %s\n",
+          CONFIG_SYSTEM_NXINIT_RC_FILE_PATH);
+  fprintf(stderr, "  -j  Actions executed concurrently, 1..%d\n",
+          CONFIG_SYSTEM_NXINIT_ACTION_WORKERS);
+  fprintf(stderr, "  -x  Exit once the boot is complete\n");
+}
+
 static void reap_process(FAR struct service_manager_s *sm,
                          FAR struct action_manager_s *am)
 {
@@ -105,10 +120,10 @@ static void reap_process(FAR struct service_manager_s *sm,
           continue;
         }
 
-      if (pid == am->pid_running)
+      name = init_action_reap_command(am, pid);
+      if (name == NULL)
         {
-          name = am->running->argv[0];
-          init_action_reap_command(am);
+          name = "unknown";
         }
 
       service = init_service_find_by_pid(sm, pid);
@@ -141,9 +156,8 @@ int main(int argc, FAR char *argv[])
       .ready_actions = LIST_INITIAL_VALUE(am.ready_actions),
       .events = { 0 },
       .current = NULL,
-      .running = NULL,
-      .pid_running = -1,
       .sm = &sm,
+      .nworkers = CONFIG_SYSTEM_NXINIT_ACTION_WORKERS,
     };
 
   const struct parser_s parser[] =
@@ -158,11 +172,45 @@ int main(int argc, FAR char *argv[])
     {
     };
 
+  FAR const char *rcfile = CONFIG_SYSTEM_NXINIT_RC_FILE_PATH;
   struct pollfd pfds[nitems(ev)];
+  bool booted = false;
+  bool quit = false;
   sigset_t mask;
   size_t i;
+  int boot;
   int r;
 
+  boot = init_timeline_begin("init", 1, argv);
+
+  while ((r = getopt(argc, argv, "f:j:x")) != ERROR)
+    {
+      switch (r)
+        {
+          case 'f':
+            rcfile = optarg;
+            break;
+
+          case 'j':
+            am.nworkers = atoi(optarg);
+            if (am.nworkers < 1 ||
+                am.nworkers > CONFIG_SYSTEM_NXINIT_ACTION_WORKERS)
+              {
+                show_usage(argv[0]);
+                return -EINVAL;
+              }
+            break;
+
+          case 'x':
+            quit = true;
+            break;
+
+          default:
+            show_usage(argv[0]);
+            return -EINVAL;
+        }
+    }
+
   sigfillset(&mask);
   r = sigprocmask(SIG_BLOCK, &mask, NULL);
   sigemptyset(&mask);
@@ -189,7 +237,7 @@ int main(int argc, FAR char *argv[])
         }
     }
 
-  r = init_parse_config_file(parser, CONFIG_SYSTEM_NXINIT_RC_FILE_PATH);
+  r = init_parse_config_file(parser, rcfile);
   if (r < 0)
     {
       goto out;
@@ -230,6 +278,22 @@ int main(int argc, FAR char *argv[])
           break;
         }
 
+      /* The boot is complete once all triggered actions are executed and
+       * all started services are ready.
+       */
+
+      if (!booted && init_action_idle(&am) && init_service_idle(&sm))
+        {
+          booted = true;
+          init_timeline_end(boot);
+          init_timeline_dump();
+          if (quit)
+            {
+              r = 0;
+              break;
+            }
+        }
+
       r = ppoll(pfds, nitems(pfds), MS2TIMESPEC(&timeout, t), &mask);
       if (r < 0 && errno != EINTR)
         {
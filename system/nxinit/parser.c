@@ -36,6 +36,16 @@
 #include "init.h"
 #include "parser.h"
 
+/****************************************************************************
+ * Private Data
+ ****************************************************************************/
+
+/* Depth of "import", the sections are checked once the outermost file is
+ * parsed as they may refer to each other across files.
+ */
+
+static int g_nesting;
+
 /****************************************************************************
  * Public Functions
  ****************************************************************************/
@@ -155,6 +165,8 @@ int init_parse_config_file(FAR const struct parser_s *parser,
       return -errno;
     }
 
+  g_nesting++;
+
   for (; ; )
     {
       ssize_t r = read(fd, &buf[n], sizeof(buf) - n);
@@ -233,7 +245,7 @@ int init_parse_config_file(FAR const struct parser_s *parser,
         }
     }
 
-  for (n = 0; parser[n].key; n++)
+  for (n = 0; g_nesting == 1 && parser[n].key; n++)
     {
       if (parser[n].check)
         {
@@ -246,6 +258,7 @@ int init_parse_config_file(FAR const struct parser_s *parser,
     }
 
 out:
+  g_nesting--;
   close(fd);
   if (ret < 0)
     {
@@ -0,0 +1,132 @@
+/****************************************************************************
+ * apps/system/nxinit/property.c
+ *
+ * SPDX-License-Identifier: Apache-2.0
+ *
+ * Licensed to the Apache Software Foundation (ASF) under one or more
+ * contributor license agreements.  See the NOTICE file distributed with
+ * this work for additional information regarding copyright ownership.  The
+ * ASF licenses this file to you under the Apache License, Version 2.0 (the
+ * "License"); you may not use this file except in compliance with the
+ * License.  You may obtain a copy of the License at
+ *
+ *   http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS, WITHOUT
+ * WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.  See the
+ * License for the specific language governing permissions and limitations
+ * under the License.
+ *
+ ****************************************************************************/
+
+/****************************************************************************
+ * Included Files
+ ****************************************************************************/
+
+#include <nuttx/list.h>
+
+#include <errno.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include "init.h"
+#include "property.h"
+
+/****************************************************************************
+ * Private Types
+ ****************************************************************************/
+
+struct property_s
+{
+  struct list_node node;     /* Property list node */
+  FAR char *value;
+  char name[1];              /* Property name, allocated with the node */
+};
+
+/****************************************************************************
+ * Private Data
+ ****************************************************************************/
+
+static struct list_node g_properties = LIST_INITIAL_VALUE(g_properties);
+
+/****************************************************************************
+ * Private Functions
+ ****************************************************************************/
+
+static FAR struct property_s *find_property(FAR const char *name)
+{
+  FAR struct property_s *prop;
+
+  list_for_every_entry(&g_properties, prop, struct property_s, node)
+    {
+      if (!strcmp(prop->name, name))
+        {
+          return prop;
+        }
+    }
+
+  return NULL;
+}
+
+/****************************************************************************
+ * Public Functions
+ ****************************************************************************/
+
+/****************************************************************************
+ * Name: init_property_set
+ *
+ * Description:
+ *   Set the value of a property, creating it if needed. Properties only
+ *   live in NxInit, they are used by readiness conditions.
+ *
+ * Input Parameters:
+ *   name  - Property name.
+ *   value - New value.
+ *
+ * Returned Value:
+ *   Returns 0 on success; Returns the negative value of errno on failure.
+ ****************************************************************************/
+
+int init_property_set(FAR const char *name, FAR const char *value)
+{
+  FAR struct property_s *prop;
+  FAR char *dup;
+
+  dup = strdup(value);
+  if (dup == NULL)
+    {
+      init_err("Alloc property value");
+      return -errno;
+    }
+
+  prop = find_property(name);
+  if (prop == NULL)
+    {
+      prop = malloc(sizeof(*prop) + strlen(name));
+      if (prop == NULL)
+        {
+          init_err("Alloc property");
+          free(dup);
+          return -errno;
+        }
+
+      strcpy(prop->name, name);
+      list_add_tail(&g_properties, &prop->node);
+    }
+  else
+    {
+      free(prop->value);
+    }
+
+  prop->value = dup;
+  init_info("Property '%s' = '%s'", name, value);
+  return 0;
+}
+
+FAR const char *init_property_get(FAR const char *name)
+{
+  FAR struct property_s *prop = find_property(name);
+
+  return prop ? prop->value : NULL;
+}
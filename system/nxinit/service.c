@@ -39,6 +39,7 @@
 #include "init.h"
 #include "parser.h"
 #include "service.h"
+#include "timeline.h"
 
 /****************************************************************************
  * Pre-processor Definitions
@@ -100,6 +101,10 @@ static int option_override(FAR struct service_manager_s *sm,
                            int argc, FAR char **argv);
 static int option_oneshot(FAR struct service_manager_s *sm,
                           int argc, FAR char **argv);
+static int option_after(FAR struct service_manager_s *sm,
+                        int argc, FAR char **argv);
+static int option_ready(FAR struct service_manager_s *sm,
+                        int argc, FAR char **argv);
 #ifdef CONFIG_BOARDCTL_RESET
 static int option_reboot_on_failure(FAR struct service_manager_s *sm,
                                     int argc, FAR char **argv);
@@ -116,6 +121,8 @@ static const struct cmd_map_s g_option[] =
   {"restart_period", 2, 2, option_restart_period},
   {"override", 1, 1, option_override},
   {"oneshot", 1, 1, option_oneshot},
+  {"after", 2, NXINIT_ACTION_CMD_ARGS_MAX, option_after},
+  {"ready", 2, 4, option_ready},
 #ifdef CONFIG_BOARDCTL_RESET
   {"reboot_on_failure", 2, 2, option_reboot_on_failure},
 #endif
@@ -131,7 +138,10 @@ static const struct flag_str_s g_flag_str[] =
   {SVC_GENTLE_KILL, "gentle_kill"},
   {SVC_REMOVE, "remove"},
   {SVC_SIGKILL, "sigkill"},
+  {SVC_WAITING, "waiting"},
+  {SVC_READY, "ready"},
   {SVC_OVERRIDE, "override"},
+  {SVC_ORDERED, "ordered"},
 };
 #endif
 
@@ -178,8 +188,128 @@ static int kill_service(FAR struct service_s *service, int signo)
   return ret;
 }
 
+static void mark_ready(FAR struct service_s *service)
+{
+  init_info("Service '%s' is ready", service->argv[1]);
+  add_flags(service, SVC_READY);
+  init_timeline_end(service->timeline);
+  service->timeline = -1;
+}
+
+static bool check_after(FAR struct service_manager_s *sm,
+                        FAR struct service_s *service)
+{
+  FAR struct init_condition_s *cond;
+
+  list_for_every_entry(&service->after, cond, struct init_condition_s, node)
+    {
+      if (!init_condition_check(sm, cond))
+        {
+          return false;
+        }
+    }
+
+  return true;
+}
+
+static FAR struct service_s *
+find_after(FAR struct service_manager_s *sm, FAR const char *name)
+{
+  FAR struct service_s *service;
+
+  list_for_every_entry(&sm->services, service, struct service_s, node)
+    {
+      if (!check_flags(service, SVC_REMOVE) &&
+          !strcmp(name, service->argv[1]))
+        {
+          return service;
+        }
+    }
+
+  return NULL;
+}
+
+static bool after_ordered(FAR struct service_manager_s *sm,
+                          FAR struct service_s *service)
+{
+  FAR struct init_condition_s *cond;
+
+  list_for_every_entry(&service->after, cond, struct init_condition_s, node)
+    {
+      if (!check_flags(find_after(sm, cond->arg), SVC_ORDERED))
+        {
+          return false;
+        }
+    }
+
+  return true;
+}
+
+/* A service whose "after" names an unknown service or, directly or through
+ * others, itself would wait forever, so reject the rc file instead.
+ */
+
+static int check_after_order(FAR struct service_manager_s *sm)
+{
+  FAR struct init_condition_s *cond;
+  FAR struct service_s *s;
+  bool progress;
+  int ret = 0;
+
+  list_for_every_entry(&sm->services, s, struct service_s, node)
+    {
+      list_for_every_entry(&s->after, cond, struct init_condition_s, node)
+        {
+          if (!check_flags(s, SVC_REMOVE) &&
+              find_after(sm, cond->arg) == NULL)
+            {
+              init_err("Service '%s' after unknown service '%s'",
+                       s->argv[1], cond->arg);
+              return -ENOENT;
+            }
+        }
+    }
+
+  /* Mark the services that can start once all services they come after
+   * are marked, the ones left over are part of or behind a loop.
+   */
+
+  do
+    {
+      progress = false;
+      list_for_every_entry(&sm->services, s, struct service_s, node)
+        {
+          if (!check_flags(s, SVC_ORDERED) &&
+              (check_flags(s, SVC_REMOVE) || after_ordered(sm, s)))
+            {
+              add_flags(s, SVC_ORDERED);
+              progress = true;
+            }
+        }
+    }
+  while (progress);
+
+  list_for_every_entry(&sm->services, s, struct service_s, node)
+    {
+      if (!check_flags(s, SVC_ORDERED))
+        {
+          init_err("Service '%s' is in or behind an 'after' loop",
+                   s->argv[1]);
+          ret = -ELOOP;
+        }
+      else
+        {
+          remove_flags(s, SVC_ORDERED);
+        }
+    }
+
+  return ret;
+}
+
 static void remove_service(FAR struct service_s *service)
 {
+  FAR struct init_condition_s *cond;
+  FAR struct init_condition_s *ctmp;
   FAR struct service_class_s *class;
   FAR struct service_class_s *tmp;
   int i;
@@ -192,6 +322,18 @@ static void remove_service(FAR struct service_s *service)
       free(class);
     }
 
+  list_for_every_entry_safe(&service->after, cond, ctmp,
+                            struct init_condition_s, node)
+    {
+      list_delete(&cond->node);
+      init_condition_free(cond);
+    }
+
+  if (service->ready != NULL)
+    {
+      init_condition_free(service->ready);
+    }
+
   for (i = 0; i < service->argc; i++)
     {
       free(service->argv[i]);
@@ -273,6 +415,57 @@ static int option_oneshot(FAR struct service_manager_s *sm,
   return 0;
 }
 
+/* after <service>...: start only once the services are ready */
+
+static int option_after(FAR struct service_manager_s *sm,
+                        int argc, FAR char **argv)
+{
+  FAR struct service_s *s = list_last_entry(&sm->services, struct service_s,
+                                            node);
+  FAR struct init_condition_s *cond;
+  FAR char *args[2];
+  int i;
+
+  args[0] = "service";
+  for (i = 1; i < argc; i++)
+    {
+      args[1] = argv[i];
+      cond = init_condition_new(nitems(args), args);
+      if (cond == NULL)
+        {
+          return -EINVAL;
+        }
+
+      list_add_tail(&s->after, &cond->node);
+    }
+
+  return 0;
+}
+
+/* ready <condition>: when the service is ready, see condition.h */
+
+static int option_ready(FAR struct service_manager_s *sm,
+                        int argc, FAR char **argv)
+{
+  FAR struct service_s *s = list_last_entry(&sm->services, struct service_s,
+                                            node);
+  FAR struct init_condition_s *cond;
+
+  cond = init_condition_new(argc - 1, &argv[1]);
+  if (cond == NULL)
+    {
+      return -EINVAL;
+    }
+
+  if (s->ready != NULL)
+    {
+      init_condition_free(s->ready);
+    }
+
+  s->ready = cond;
+  return 0;
+}
+
 #ifdef CONFIG_BOARDCTL_RESET
 static int option_reboot_on_failure(FAR struct service_manager_s *sm,
                                     int argc, FAR char **argv)
@@ -293,7 +486,8 @@ static int option_reboot_on_failure(FAR struct service_manager_s *sm,
  *
  * Description:
  *   Check if any services need to be restarted, force terminate(SIGKILL), or
- *   deleted.
+ *   deleted, and whether waiting services can start and started services
+ *   became ready.
  *
  * Input Parameters:
  *   sm - Instance of Service Manager
@@ -316,13 +510,45 @@ int init_service_refresh(FAR struct service_manager_s *sm)
   list_for_every_entry_safe(&sm->services, service, tmp, struct service_s,
                             node)
     {
+      if (check_flags(service, SVC_WAITING))
+        {
+          if (check_after(sm, service))
+            {
+              init_service_start(sm, service);
+              min = 0;
+            }
+          else
+            {
+              min = MIN(min, INIT_CONDITION_POLL);
+            }
+
+          continue;
+        }
+
+      if (check_flags(service, SVC_RUNNING) &&
+          !check_flags(service, SVC_READY) &&
+          service->ready->type != INIT_CONDITION_EXITED)
+        {
+          if (init_condition_check(sm, service->ready))
+            {
+              /* Let the services after this one start right away */
+
+              mark_ready(service);
+              min = 0;
+            }
+          else
+            {
+              min = MIN(min, INIT_CONDITION_POLL);
+            }
+        }
+
       if (check_flags(service, SVC_RESTARTING))
         {
           clock_timespec_subtract(&cur, &service->time_started, &diff);
           ms = TIMESPEC2MS(diff);
           if (ms >= service->restart_period)
             {
-              init_service_start(service);
+              init_service_start(sm, service);
               continue;
             }
 
@@ -413,10 +639,30 @@ void init_service_reap(FAR struct service_s *service, int status)
   UNUSED(status);
 #endif
 
+  /* A oneshot that was ready stays ready, the services after it may not
+   * have seen it running yet.
+   */
+
   remove_flags(service, SVC_RUNNING);
+  if (service->ready != NULL &&
+      service->ready->type == INIT_CONDITION_EXITED && status == 0)
+    {
+      mark_ready(service);
+    }
+  else if (!check_flags(service, SVC_ONESHOT) ||
+           !check_flags(service, SVC_READY))
+    {
+      remove_flags(service, SVC_READY);
+      init_timeline_end(service->timeline);
+      service->timeline = -1;
+    }
+
   if (check_flags(service, SVC_ONESHOT))
     {
-      add_flags(service, SVC_DISABLED | SVC_REMOVE);
+      /* Keep a finished oneshot around while others may start after it */
+
+      add_flags(service, check_flags(service, SVC_READY) ?
+                         SVC_DISABLED : SVC_DISABLED | SVC_REMOVE);
     }
 
   if (!check_flags(service, SVC_DISABLED))
@@ -425,7 +671,25 @@ void init_service_reap(FAR struct service_s *service, int status)
     }
 }
 
-int init_service_start(FAR struct service_s *service)
+bool init_service_idle(FAR struct service_manager_s *sm)
+{
+  FAR struct service_s *service;
+
+  list_for_every_entry(&sm->services, service, struct service_s, node)
+    {
+      if (check_flags(service, SVC_WAITING) ||
+          (check_flags(service, SVC_RUNNING) &&
+           !check_flags(service, SVC_READY)))
+        {
+          return false;
+        }
+    }
+
+  return true;
+}
+
+int init_service_start(FAR struct service_manager_s *sm,
+                       FAR struct service_s *service)
 {
   posix_spawnattr_t attr;
   sigset_t mask;
@@ -441,6 +705,17 @@ int init_service_start(FAR struct service_s *service)
       return service->pid;
     }
 
+  if (!check_after(sm, service))
+    {
+      init_info("Service '%s' waits for its dependencies",
+                service->argv[1]);
+      add_flags(service, SVC_WAITING);
+      remove_flags(service, SVC_RESTARTING | SVC_DISABLED);
+      return 0;
+    }
+
+  remove_flags(service, SVC_WAITING | SVC_READY);
+
   ret = posix_spawnattr_init(&attr);
   if (ret != 0)
     {
@@ -482,6 +757,13 @@ int init_service_start(FAR struct service_s *service)
   remove_flags(service, SVC_DISABLED);
   init_info("Started service '%s' pid %d", service->argv[1], service->pid);
 
+  init_timeline_end(service->timeline);
+  service->timeline = init_timeline_begin("service", 1, &service->argv[1]);
+  if (service->ready == NULL)
+    {
+      mark_ready(service);
+    }
+
   return service->pid;
 }
 
@@ -489,6 +771,13 @@ int init_service_stop(FAR struct service_s *service)
 {
   init_info("Stopping service '%s' ...", service->argv[1]);
 
+  if (check_flags(service, SVC_WAITING))
+    {
+      remove_flags(service, SVC_WAITING);
+      add_flags(service, SVC_DISABLED);
+      return 0;
+    }
+
   if (check_flags(service, SVC_RUNNING | SVC_RESTARTING))
     {
       if (check_flags(service, SVC_DISABLED))
@@ -535,7 +824,7 @@ int init_service_start_by_class(FAR struct service_manager_s *sm,
         {
           if (!strcmp(name, class->name))
             {
-              ret = init_service_start(service);
+              ret = init_service_start(sm, service);
               if (ret < 0)
                 {
                   return ret;
@@ -607,7 +896,9 @@ int init_service_parse(FAR const struct parser_s *parser,
 #ifdef CONFIG_BOARDCTL_RESET
       s->reset_reason = -1;
 #endif
+      s->timeline = -1;
       list_initialize(&s->classes);
+      list_initialize(&s->after);
       list_add_tail(&sm->services, &s->node);
     }
   else
@@ -664,12 +955,13 @@ int init_service_check(FAR const struct parser_s *parser)
         }
     }
 
-  return 0;
+  return check_after_order(sm);
 }
 
 #ifdef CONFIG_SYSTEM_NXINIT_DEBUG
 void init_dump_service(FAR struct service_s *s)
 {
+  FAR struct init_condition_s *cond;
   FAR struct service_class_s *c;
   int i;
 
@@ -688,6 +980,18 @@ void init_dump_service(FAR struct service_s *s)
       init_debug("    '%s'", c->name);
     }
 
+  init_debug("  after:");
+  list_for_every_entry(&s->after, cond, struct init_condition_s, node)
+    {
+      init_debug("    '%s'", cond->arg);
+    }
+
+  if (s->ready != NULL)
+    {
+      init_debug("  ready: %d '%s'", s->ready->type,
+                 s->ready->arg ? s->ready->arg : "");
+    }
+
   init_debug("  restart_period: %d", s->restart_period);
 #ifdef CONFIG_BOARDCTL_RESET
   init_debug("  reboot_on_failure: %d", s->reset_reason);
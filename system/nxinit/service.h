@@ -29,9 +29,12 @@
 
 #include <nuttx/list.h>
 
+#include <stdbool.h>
 #include <stdint.h>
 #include <sys/types.h>
 
+#include "condition.h"
+
 /****************************************************************************
  * Pre-processor Definitions
  ****************************************************************************/
@@ -54,6 +57,18 @@
 /* Flags below are new added.
  */
 
+/* Start order checked, only set while the rc file is checked */
+
+#define SVC_ORDERED     (1 << 26)
+
+/* Start requested, waiting for the services and conditions of "after" */
+
+#define SVC_WAITING     (1 << 27)
+
+/* Ready for the services that start after it, see option "ready" */
+
+#define SVC_READY       (1 << 28)
+
 /* Override the previous definition for a service with the same name */
 
 #define SVC_OVERRIDE    (1 << 29)
@@ -84,6 +99,8 @@ struct service_s
 {
   struct list_node node;     /* Service list node */
   struct list_node classes;  /* Class header, struct service_class_s */
+  struct list_node after;    /* Start conditions, struct init_condition_s */
+  FAR struct init_condition_s *ready; /* NULL: ready once spawned */
 
   uint32_t flags;
 
@@ -104,6 +121,7 @@ struct service_s
   struct timespec time_kill;
   int restart_period;
   pid_t pid;
+  int timeline;              /* Boot timeline entry */
 
   /* The "target" of service option "reboot_on_failure" */
 
@@ -122,8 +140,10 @@ struct service_manager_s
  ****************************************************************************/
 
 int  init_service_refresh(FAR struct service_manager_s *sm);
+bool init_service_idle(FAR struct service_manager_s *sm);
 void init_service_reap(FAR struct service_s *service, int status);
-int  init_service_start(FAR struct service_s *service);
+int  init_service_start(FAR struct service_manager_s *sm,
+                        FAR struct service_s *service);
 int  init_service_stop(FAR struct service_s *service);
 int  init_service_start_by_class(FAR struct service_manager_s *sm,
                                  FAR const char *name);
@@ -0,0 +1,199 @@
+/****************************************************************************
+ * apps/system/nxinit/timeline.c
+ *
+ * SPDX-License-Identifier: Apache-2.0
+ *
+ * Licensed to the Apache Software Foundation (ASF) under one or more
+ * contributor license agreements.  See the NOTICE file distributed with
+ * this work for additional information regarding copyright ownership.  The
+ * ASF licenses this file to you under the Apache License, Version 2.0 (the
+ * "License"); you may not use this file except in compliance with the
+ * License.  You may obtain a copy of the License at
+ *
+ *   http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS, WITHOUT
+ * WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.  See the
+ * License for the specific language governing permissions and limitations
+ * under the License.
+ *
+ ****************************************************************************/
+
+/****************************************************************************
+ * Included Files
+ ****************************************************************************/
+
+#include <nuttx/config.h>
+
+#include <errno.h>
+#include <stdbool.h>
+#include <stdio.h>
+#include <string.h>
+#include <time.h>
+#include <sys/param.h>
+
+#include "init.h"
+#include "timeline.h"
+
+/****************************************************************************
+ * Pre-processor Definitions
+ ****************************************************************************/
+
+#define TIMELINE_NAME_MAX 40
+
+/****************************************************************************
+ * Private Types
+ ****************************************************************************/
+
+struct timeline_entry_s
+{
+  FAR const char *type;      /* "init", "command", "service" */
+  char name[TIMELINE_NAME_MAX];
+  int start;                 /* ms since boot */
+  int end;                   /* ms since boot, -1 while running */
+};
+
+/****************************************************************************
+ * Private Data
+ ****************************************************************************/
+
+static struct timeline_entry_s
+  g_timeline[CONFIG_SYSTEM_NXINIT_TIMELINE_ENTRIES];
+static int g_timeline_count;
+static bool g_timeline_done;
+
+/****************************************************************************
+ * Private Functions
+ ****************************************************************************/
+
+static int timeline_now(void)
+{
+  struct timespec now;
+
+  clock_gettime(CLOCK_MONOTONIC, &now);
+  return TIMESPEC2MS(now);
+}
+
+/****************************************************************************
+ * Public Functions
+ ****************************************************************************/
+
+/****************************************************************************
+ * Name: init_timeline_begin
+ *
+ * Description:
+ *   Record the start of a boot step. Steps are recorded until the boot is
+ *   complete, i.e. until init_timeline_dump() is called.
+ *
+ * Input Parameters:
+ *   type - Kind of the step
+ *   argc - Argument count.
+ *   argv - Name and arguments of the step, they name the entry.
+ *
+ * Returned Value:
+ *   Entry to pass to init_timeline_end(), -1 if the step is not recorded.
+ ****************************************************************************/
+
+int init_timeline_begin(FAR const char *type, int argc,
+                        FAR char * const *argv)
+{
+  FAR struct timeline_entry_s *entry;
+  size_t len = 0;
+  int i;
+
+  if (g_timeline_done || g_timeline_count == nitems(g_timeline))
+    {
+      return -1;
+    }
+
+  entry = &g_timeline[g_timeline_count];
+  entry->type = type;
+  entry->name[0] = '\0';
+  for (i = 0; i < argc && len < sizeof(entry->name) - 1; i++)
+    {
+      len += snprintf(entry->name + len, sizeof(entry->name) - len, "%s%s",
+                      i > 0 ? " " : "", argv[i]);
+    }
+
+  entry->start = timeline_now();
+  entry->end = -1;
+  return g_timeline_count++;
+}
+
+void init_timeline_end(int entry)
+{
+  if (!g_timeline_done && entry >= 0 && g_timeline[entry].end < 0)
+    {
+      g_timeline[entry].end = timeline_now();
+    }
+}
+
+/****************************************************************************
+ * Name: init_timeline_dump
+ *
+ * Description:
+ *   Called once the boot is complete: stop recording and write the steps,
+ *   with their start and end in ms since boot, to
+ *   CONFIG_SYSTEM_NXINIT_TIMELINE_PATH and the log.
+ ****************************************************************************/
+
+void init_timeline_dump(void)
+{
+  FAR struct timeline_entry_s *entry;
+  FAR FILE *file = NULL;
+  int now;
+  int i;
+
+  if (g_timeline_done)
+    {
+      return;
+    }
+
+  g_timeline_done = true;
+  now = timeline_now();
+
+  if (CONFIG_SYSTEM_NXINIT_TIMELINE_PATH[0] != '\0')
+    {
+      file = fopen(CONFIG_SYSTEM_NXINIT_TIMELINE_PATH, "w");
+      if (file == NULL)
+        {
+          init_err("Opening %s %d", CONFIG_SYSTEM_NXINIT_TIMELINE_PATH,
+                   errno);
+        }
+    }
+
+  if (file != NULL)
+    {
+      fprintf(file, "# NxInit boot timeline, ms since boot\n");
+      fprintf(file, "# %6s %8s %8s %-8s %s\n", "start", "end", "length",
+              "type", "name");
+    }
+
+  for (i = 0; i < g_timeline_count; i++)
+    {
+      entry = &g_timeline[i];
+      if (entry->end < 0)
+        {
+          entry->end = now;
+        }
+
+      init_info("Timeline %6d %6d %-8s %s", entry->start, entry->end,
+                entry->type, entry->name);
+      if (file != NULL)
+        {
+          fprintf(file, "%8d %8d %8d %-8s %s\n", entry->start, entry->end,
+                  entry->end - entry->start, entry->type, entry->name);
+        }
+    }
+
+  if (file != NULL)
+    {
+      fprintf(file, "# ready at %d ms, %d steps%s\n", now,
+              g_timeline_count,
+              g_timeline_count == nitems(g_timeline) ? " (truncated)" : "");
+      fclose(file);
+    }
+
+  init_info("Boot completed at %d ms", now);
+}
@@ -0,0 +1,46 @@
+/****************************************************************************
+ * apps/system/nxinit/timeline.h
+ *
+ * SPDX-License-Identifier: Apache-2.0
+ *
+ * Licensed to the Apache Software Foundation (ASF) under one or more
+ * contributor license agreements.  See the NOTICE file distributed with
+ * this work for additional information regarding copyright ownership.  The
+ * ASF licenses this file to you under the Apache License, Version 2.0 (the
+ * "License"); you may not use this file except in compliance with the
+ * License.  You may obtain a copy of the License at
+ *
+ *   http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS, WITHOUT
+ * WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.  See the
+ * License for the specific language governing permissions and limitations
+ * under the License.
+ *
+ ****************************************************************************/
+
+#ifndef __APPS_SYSTEM_NXINIT_TIMELINE_H
+#define __APPS_SYSTEM_NXINIT_TIMELINE_H
+
+/****************************************************************************
+ * Included Files
+ ****************************************************************************/
+
+#include <nuttx/config.h>
+
+/****************************************************************************
+ * Public Function Prototypes
+ ****************************************************************************/
+
+#ifdef CONFIG_SYSTEM_NXINIT_TIMELINE
+int  init_timeline_begin(FAR const char *type, int argc,
+                         FAR char * const *argv);
+void init_timeline_end(int entry);
+void init_timeline_dump(void);
+#else
+#  define init_timeline_begin(t, c, v) (-1)
+#  define init_timeline_end(e) ((void)(e))
+#  define init_timeline_dump()
+#endif
+#endif /* __APPS_SYSTEM_NXINIT_TIMELINE_H */
@@ -27,6 +27,8 @@
  * Included Files
  ****************************************************************************/
 
+#include <nuttx/config.h>
+
 #include <limits.h>
 #include <stdbool.h>
 #include <stddef.h>
@@ -40,8 +42,7 @@
 #define PKG_REPO_INDEX        "/etc/nxpkg/index.json"
 #define PKG_REPO_INSTALLED    "/var/lib/nxpkg/installed.json"
 #define PKG_STORE_DIR         "/var/lib/nxpkg/pkgs"
-#define PKG_TMP_DIR           "/var/cache/nxpkg"
-#define PKG_TMP_PKG_DIR       "/var/cache/nxpkg/pkg"
+#define PKG_OBJECT_DIR        "/var/lib/nxpkg/objects"
 
 #define PKG_NAME_MAX          63
 #define PKG_VERSION_MAX       31
@@ -51,6 +52,7 @@
 #define PKG_INDEX_MAX         32
 #define PKG_INSTALLED_MAX     16
 #define PKG_INSTALLED_VERSIONS_MAX 8
+#define PKG_IO_BUFSIZE        CONFIG_SYSTEM_NXPKG_IO_BUFSIZE
 
 /****************************************************************************
  * Public Types
@@ -138,27 +140,25 @@ int pkg_store_format_txn_path(FAR char *buffer, size_t size,
                               FAR const char *name);
 int pkg_store_format_lock_path(FAR char *buffer, size_t size,
                                FAR const char *name);
-int pkg_store_format_download_path(FAR char *buffer, size_t size,
-                                   FAR const char *name,
-                                   FAR const char *version);
-int pkg_store_format_payload_path(FAR char *buffer, size_t size,
-                                  FAR const char *name,
-                                  FAR const char *version,
-                                  FAR const char *artifact);
+int pkg_store_format_object_path(FAR char *buffer, size_t size,
+                                 FAR const char *digest);
 int pkg_store_format_manifest_path(FAR char *buffer, size_t size,
                                    FAR const char *name,
                                    FAR const char *version);
 int pkg_store_read_text(FAR const char *path, FAR char **buffer);
 int pkg_store_write_text_atomic(FAR const char *path, FAR const char *text);
-int pkg_store_copy_file(FAR const char *src, FAR const char *dest);
+int pkg_store_write_all(int fd, FAR const void *buffer, size_t length);
+int pkg_store_import_object(FAR const char *src, FAR const char *sha256,
+                            FAR size_t *written);
 int pkg_store_remove_file(FAR const char *path);
 
 const char *pkg_runtime_arch(void);
 const char *pkg_runtime_compat(void);
 int pkg_compat_check(FAR const struct pkg_manifest_s *manifest);
 
-int pkg_hash_file_sha256(FAR const char *path,
-                         FAR char digest[PKG_HASH_HEX_LEN + 1]);
+int pkg_hash_copy_sha256(int infd, int outfd,
+                         FAR char digest[PKG_HASH_HEX_LEN + 1],
+                         FAR size_t *length);
 
 int pkg_metadata_load_index(FAR struct pkg_index_s *index);
 FAR const struct pkg_manifest_s *
@@ -169,6 +169,8 @@ int pkg_metadata_save_installed(FAR const struct pkg_installed_db_s *db);
 FAR struct pkg_installed_entry_s *
 pkg_metadata_find_installed(FAR struct pkg_installed_db_s *db,
                             FAR const char *name);
+int pkg_metadata_read_manifest(FAR const char *path,
+                               FAR struct pkg_manifest_s *manifest);
 int pkg_metadata_write_manifest(FAR const char *path,
                                 FAR const struct pkg_manifest_s *manifest);
 int pkg_metadata_print_installed(FAR FILE *stream,
@@ -177,8 +179,11 @@ int pkg_metadata_print_installed(FAR FILE *stream,
 const char *pkg_txn_state_str(enum pkg_txn_state_e state);
 int pkg_txn_write_state(FAR const char *name, enum pkg_txn_state_e state);
 int pkg_txn_clear_state(FAR const char *name);
+int pkg_txn_acquire_lock(FAR const char *name, FAR char *path, size_t size);
+int pkg_txn_write_pointers(FAR const struct pkg_installed_entry_s *entry);
 
 int pkg_install(FAR const char *name);
+int pkg_rollback(FAR const char *name);
 int pkg_list(FAR FILE *stream);
 
 void pkg_error(FAR const char *fmt, ...);
@@ -28,6 +28,8 @@
 #include <errno.h>
 #include <stdint.h>
 #include <stdio.h>
+#include <stdlib.h>
+#include <unistd.h>
 
 #include "pkg.h"
 
@@ -54,45 +56,70 @@ static void pkg_hex_encode(FAR const uint8_t *input, size_t length,
  * Public Functions
  ****************************************************************************/
 
-int pkg_hash_file_sha256(FAR const char *path,
-                         FAR char digest[PKG_HASH_HEX_LEN + 1])
+/* Hash everything read from infd in one pass and write it to outfd on the
+ * way, so a payload is stored and verified without reading it twice.
+ */
+
+int pkg_hash_copy_sha256(int infd, int outfd,
+                         FAR char digest[PKG_HASH_HEX_LEN + 1],
+                         FAR size_t *length)
 {
   SHA2_CTX ctx;
-  FAR FILE *stream;
   uint8_t raw[SHA256_DIGEST_LENGTH];
-  uint8_t buffer[512];
-  size_t nread;
+  FAR uint8_t *buffer;
+  size_t total = 0;
+  ssize_t nread;
+  int ret = 0;
 
-  stream = fopen(path, "rb");
-  if (stream == NULL)
+  buffer = malloc(PKG_IO_BUFSIZE);
+  if (buffer == NULL)
     {
-      return -errno;
+      return -ENOMEM;
     }
 
   sha256init(&ctx);
 
   for (; ; )
     {
-      nread = fread(buffer, 1, sizeof(buffer), stream);
-      if (nread > 0)
+      nread = read(infd, buffer, PKG_IO_BUFSIZE);
+      if (nread < 0)
         {
-          sha256update(&ctx, buffer, nread);
+          if (errno == EINTR)
+            {
+              continue;
+            }
+
+          ret = -errno;
+          break;
         }
 
-      if (nread < sizeof(buffer))
+      if (nread == 0)
         {
-          if (ferror(stream))
-            {
-              fclose(stream);
-              return -EIO;
-            }
+          break;
+        }
 
+      sha256update(&ctx, buffer, (size_t)nread);
+      ret = pkg_store_write_all(outfd, buffer, (size_t)nread);
+      if (ret < 0)
+        {
           break;
         }
+
+      total += (size_t)nread;
+    }
+
+  free(buffer);
+  if (ret < 0)
+    {
+      return ret;
     }
 
-  fclose(stream);
   sha256final(raw, &ctx);
   pkg_hex_encode(raw, sizeof(raw), digest);
+  if (length != NULL)
+    {
+      *length = total;
+    }
+
   return 0;
 }
@@ -25,11 +25,9 @@
  ****************************************************************************/
 
 #include <errno.h>
-#include <fcntl.h>
 #include <stdio.h>
-#include <strings.h>
+#include <stdlib.h>
 #include <string.h>
-#include <unistd.h>
 
 #include "pkg.h"
 
@@ -63,34 +61,6 @@ static int pkg_install_resolve_artifact(FAR char *buffer, size_t size,
   return (size_t)ret >= size ? -ENAMETOOLONG : 0;
 }
 
-static int pkg_install_acquire_lock(FAR const char *name, FAR char *path,
-                                    size_t size)
-{
-  int fd;
-  int ret;
-
-  ret = pkg_store_ensure_package_root(name);
-  if (ret < 0)
-    {
-      return ret;
-    }
-
-  ret = pkg_store_format_lock_path(path, size, name);
-  if (ret < 0)
-    {
-      return ret;
-    }
-
-  fd = open(path, O_WRONLY | O_CREAT | O_EXCL, 0644);
-  if (fd < 0)
-    {
-      return errno == EEXIST ? -EBUSY : -errno;
-    }
-
-  close(fd);
-  return 0;
-}
-
 static bool pkg_install_has_version(
               FAR const struct pkg_installed_entry_s *entry,
               FAR const char *version)
@@ -199,45 +169,6 @@ static int pkg_install_update_installed(FAR struct pkg_installed_db_s *db,
   return pkg_install_add_version(entry, manifest->version);
 }
 
-static int pkg_install_write_pointers(
-              FAR const struct pkg_installed_db_s *db,
-              FAR const struct pkg_manifest_s *manifest)
-{
-  FAR struct pkg_installed_entry_s *entry;
-  char current[PATH_MAX];
-  char previous[PATH_MAX];
-  int ret;
-
-  entry = pkg_metadata_find_installed((FAR struct pkg_installed_db_s *)db,
-                                      manifest->name);
-  if (entry == NULL)
-    {
-      return -ENOENT;
-    }
-
-  ret = pkg_store_format_current_path(current, sizeof(current),
-                                      manifest->name);
-  if (ret < 0)
-    {
-      return ret;
-    }
-
-  ret = pkg_store_format_previous_path(previous, sizeof(previous),
-                                       manifest->name);
-  if (ret < 0)
-    {
-      return ret;
-    }
-
-  ret = pkg_store_write_text_atomic(current, entry->current);
-  if (ret < 0)
-    {
-      return ret;
-    }
-
-  return pkg_store_write_text_atomic(previous, entry->previous);
-}
-
 /****************************************************************************
  * Public Functions
  ****************************************************************************/
@@ -248,11 +179,9 @@ int pkg_install(FAR const char *name)
   FAR struct pkg_installed_db_s *installed;
   FAR const struct pkg_manifest_s *manifest;
   char source[PATH_MAX];
-  char tmp[PATH_MAX] = "";
-  char payload[PATH_MAX];
   char manifest_path[PATH_MAX];
   char lock[PATH_MAX] = "";
-  char digest[PKG_HASH_HEX_LEN + 1];
+  size_t written;
   int ret;
 
   index = malloc(sizeof(*index));
@@ -299,7 +228,7 @@ int pkg_install(FAR const char *name)
       return EXIT_FAILURE;
     }
 
-  ret = pkg_install_acquire_lock(name, lock, sizeof(lock));
+  ret = pkg_txn_acquire_lock(name, lock, sizeof(lock));
   if (ret < 0)
     {
       pkg_error("unable to acquire package lock for '%s': %d", name, ret);
@@ -312,31 +241,16 @@ int pkg_install(FAR const char *name)
       goto errout;
     }
 
-  ret = pkg_store_format_download_path(tmp, sizeof(tmp), manifest->name,
-                                       manifest->version);
-  if (ret < 0)
-    {
-      goto errout;
-    }
-
-  ret = pkg_store_copy_file(source, tmp);
-  if (ret < 0)
-    {
-      goto errout;
-    }
+  /* Fetch, verify and store the payload in one pass, or not at all if an
+   * installed version already has the same payload.
+   */
 
-  ret = pkg_hash_file_sha256(tmp, digest);
+  ret = pkg_store_import_object(source, manifest->sha256, &written);
   if (ret < 0)
     {
       goto errout;
     }
 
-  if (strcasecmp(digest, manifest->sha256) != 0)
-    {
-      ret = -EILSEQ;
-      goto errout;
-    }
-
   ret = pkg_txn_write_state(name, PKG_TXN_VERIFIED);
   if (ret < 0)
     {
@@ -349,20 +263,6 @@ int pkg_install(FAR const char *name)
       goto errout;
     }
 
-  ret = pkg_store_format_payload_path(payload, sizeof(payload),
-                                      manifest->name, manifest->version,
-                                      manifest->artifact);
-  if (ret < 0)
-    {
-      goto errout;
-    }
-
-  ret = pkg_store_copy_file(tmp, payload);
-  if (ret < 0)
-    {
-      goto errout;
-    }
-
   ret = pkg_store_format_manifest_path(manifest_path, sizeof(manifest_path),
                                        manifest->name, manifest->version);
   if (ret < 0)
@@ -406,7 +306,8 @@ int pkg_install(FAR const char *name)
       goto errout;
     }
 
-  ret = pkg_install_write_pointers(installed, manifest);
+  ret = pkg_txn_write_pointers(pkg_metadata_find_installed(installed,
+                                                           manifest->name));
   if (ret < 0)
     {
       goto errout;
@@ -425,29 +326,20 @@ int pkg_install(FAR const char *name)
     }
 
   pkg_txn_write_state(name, PKG_TXN_CLEANUP);
-  if (tmp[0] != '\0')
-    {
-      pkg_store_remove_file(tmp);
-    }
-
   pkg_txn_clear_state(name);
   if (lock[0] != '\0')
     {
       pkg_store_remove_file(lock);
     }
 
-  pkg_info("installed %s version %s", manifest->name, manifest->version);
+  pkg_info("installed %s version %s, %zu payload bytes stored",
+           manifest->name, manifest->version, written);
   free(index);
   free(installed);
   return EXIT_SUCCESS;
 
 errout:
   pkg_txn_write_state(name, PKG_TXN_FAILED);
-  if (tmp[0] != '\0')
-    {
-      pkg_store_remove_file(tmp);
-    }
-
   pkg_txn_clear_state(name);
   if (lock[0] != '\0')
     {
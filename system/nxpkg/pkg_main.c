@@ -94,8 +94,16 @@ int main(int argc, FAR char *argv[])
 
   if (strcmp(cmd, "rollback") == 0)
     {
-      pkg_error("'rollback' is not implemented yet in the current unit");
-      return EXIT_FAILURE;
+      if (argc != 3)
+        {
+          pkg_error("rollback expects exactly one package name");
+          fprintf(stderr,
+                  "Usage: %s <install|update|list|rollback|help> [args]\n",
+                  argv[0]);
+          return EXIT_FAILURE;
+        }
+
+      return pkg_rollback(argv[2]);
     }
 
   fprintf(stderr, "ERROR: Unknown subcommand '%s'\n", cmd);
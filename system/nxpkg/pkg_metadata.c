@@ -708,6 +708,31 @@ pkg_metadata_find_installed(FAR struct pkg_installed_db_s *db,
   return NULL;
 }
 
+int pkg_metadata_read_manifest(FAR const char *path,
+                               FAR struct pkg_manifest_s *manifest)
+{
+  FAR cJSON *root;
+  FAR char *text;
+  int ret;
+
+  ret = pkg_store_read_text(path, &text);
+  if (ret < 0)
+    {
+      return ret;
+    }
+
+  root = cJSON_Parse(text);
+  free(text);
+  if (root == NULL)
+    {
+      return -EINVAL;
+    }
+
+  ret = pkg_metadata_parse_manifest(root, manifest);
+  cJSON_Delete(root);
+  return ret;
+}
+
 int pkg_metadata_write_manifest(FAR const char *path,
                                 FAR const struct pkg_manifest_s *manifest)
 {
@@ -24,11 +24,13 @@
  * Included Files
  ****************************************************************************/
 
+#include <ctype.h>
 #include <errno.h>
 #include <fcntl.h>
 #include <stdlib.h>
 #include <stdio.h>
 #include <string.h>
+#include <strings.h>
 #include <sys/types.h>
 #include <sys/stat.h>
 #include <unistd.h>
@@ -126,39 +128,6 @@ static int pkg_store_mkdirs(FAR const char *path)
   return pkg_store_mkdir(buffer);
 }
 
-static int pkg_store_write_all(int fd, FAR const char *buffer, size_t length)
-{
-  size_t offset = 0;
-
-  while (offset < length)
-    {
-      ssize_t ret;
-
-      ret = write(fd, buffer + offset, length - offset);
-      if (ret < 0)
-        {
-          if (errno == EINTR)
-            {
-              continue;
-            }
-
-          return -errno;
-        }
-
-      offset += (size_t)ret;
-    }
-
-  return 0;
-}
-
-static FAR const char *pkg_store_basename(FAR const char *path)
-{
-  FAR const char *leaf;
-
-  leaf = strrchr(path, '/');
-  return leaf != NULL ? leaf + 1 : path;
-}
-
 /****************************************************************************
  * Public Functions
  ****************************************************************************/
@@ -179,13 +148,7 @@ int pkg_store_prepare_layout(void)
       return ret;
     }
 
-  ret = pkg_store_mkdirs(PKG_TMP_DIR);
-  if (ret < 0)
-    {
-      return ret;
-    }
-
-  return pkg_store_mkdirs(PKG_TMP_PKG_DIR);
+  return pkg_store_mkdirs(PKG_OBJECT_DIR);
 }
 
 int pkg_store_ensure_package_root(FAR const char *name)
@@ -275,33 +238,27 @@ int pkg_store_format_lock_path(FAR char *buffer, size_t size,
   return pkg_store_format(buffer, size, PKG_STORE_DIR "/%s/.lock", name, "");
 }
 
-int pkg_store_format_download_path(FAR char *buffer, size_t size,
-                                   FAR const char *name,
-                                   FAR const char *version)
-{
-  return pkg_store_format(buffer, size, PKG_TMP_PKG_DIR "/%s-%s.npkg", name,
-                          version);
-}
+/* Payloads are stored once, named by the lower case hex SHA-256 of their
+ * content. The manifest.json of every installed version refers to its
+ * payload by that digest.
+ */
 
-int pkg_store_format_payload_path(FAR char *buffer, size_t size,
-                                  FAR const char *name,
-                                  FAR const char *version,
-                                  FAR const char *artifact)
+int pkg_store_format_object_path(FAR char *buffer, size_t size,
+                                 FAR const char *digest)
 {
-  FAR const char *leaf;
+  FAR char *cursor;
   int ret;
 
-  leaf = pkg_store_basename(artifact);
-  ret = snprintf(buffer, size, PKG_STORE_DIR "/%s/%s/%s",
-                 name, version, leaf);
+  ret = pkg_store_format(buffer, size, PKG_OBJECT_DIR "/%s", digest, "");
   if (ret < 0)
     {
       return ret;
     }
 
-  if ((size_t)ret >= size)
+  for (cursor = buffer + sizeof(PKG_OBJECT_DIR); *cursor != '\0';
+       cursor++)
     {
-      return -ENAMETOOLONG;
+      *cursor = tolower((unsigned char)*cursor);
     }
 
   return 0;
@@ -424,12 +381,68 @@ int pkg_store_write_text_atomic(FAR const char *path, FAR const char *text)
   return 0;
 }
 
-int pkg_store_copy_file(FAR const char *src, FAR const char *dest)
+int pkg_store_write_all(int fd, FAR const void *buffer, size_t length)
 {
+  FAR const char *data = buffer;
+  size_t offset = 0;
+
+  while (offset < length)
+    {
+      ssize_t ret;
+
+      ret = write(fd, data + offset, length - offset);
+      if (ret < 0)
+        {
+          if (errno == EINTR)
+            {
+              continue;
+            }
+
+          return -errno;
+        }
+
+      offset += (size_t)ret;
+    }
+
+  return 0;
+}
+
+/* Store the payload under its digest. It is read once, hashed while it is
+ * copied and only renamed to its final name when the digest matches, so an
+ * existing object is complete and verified and is not copied again. The
+ * number of bytes stored is returned in written, 0 if the object existed.
+ */
+
+int pkg_store_import_object(FAR const char *src, FAR const char *sha256,
+                            FAR size_t *written)
+{
+  char digest[PKG_HASH_HEX_LEN + 1];
+  char object[PATH_MAX];
+  char tmp[PATH_MAX];
+  struct stat st;
+  size_t length;
   int infd;
   int outfd;
   int ret;
-  char buffer[512];
+
+  *written = 0;
+
+  ret = pkg_store_format_object_path(object, sizeof(object), sha256);
+  if (ret < 0)
+    {
+      return ret;
+    }
+
+  if (stat(object, &st) == 0)
+    {
+      return 0;
+    }
+
+  ret = pkg_store_format(tmp, sizeof(tmp), "%s.tmp", object, "");
+  if (ret < 0)
+    {
+      return ret;
+    }
 
   infd = open(src, O_RDONLY);
   if (infd < 0)
@@ -437,7 +450,7 @@ int pkg_store_copy_file(FAR const char *src, FAR const char *dest)
       return -errno;
     }
 
-  outfd = open(dest, O_WRONLY | O_CREAT | O_TRUNC, 0644);
+  outfd = open(tmp, O_WRONLY | O_CREAT | O_TRUNC, 0644);
   if (outfd < 0)
     {
       ret = -errno;
@@ -445,49 +458,31 @@ int pkg_store_copy_file(FAR const char *src, FAR const char *dest)
       return ret;
     }
 
-  for (; ; )
+  ret = pkg_hash_copy_sha256(infd, outfd, digest, &length);
+  close(infd);
+  if (close(outfd) < 0 && ret == 0)
     {
-      ssize_t nread;
-
-      nread = read(infd, buffer, sizeof(buffer));
-      if (nread < 0)
-        {
-          if (errno == EINTR)
-            {
-              continue;
-            }
-
-          ret = -errno;
-          goto errout;
-        }
-
-      if (nread == 0)
-        {
-          break;
-        }
+      ret = -errno;
+    }
 
-      ret = pkg_store_write_all(outfd, buffer, (size_t)nread);
-      if (ret < 0)
-        {
-          goto errout;
-        }
+  if (ret == 0 && strcasecmp(digest, sha256) != 0)
+    {
+      ret = -EILSEQ;
     }
 
-  close(infd);
+  if (ret == 0 && rename(tmp, object) < 0)
+    {
+      ret = -errno;
+    }
 
-  if (close(outfd) < 0)
+  if (ret < 0)
     {
-      unlink(dest);
-      return -errno;
+      unlink(tmp);
+      return ret;
     }
 
+  *written = length;
   return 0;
-
-errout:
-  close(infd);
-  close(outfd);
-  unlink(dest);
-  return ret;
 }
 
 int pkg_store_remove_file(FAR const char *path)
@@ -25,7 +25,12 @@
  ****************************************************************************/
 
 #include <errno.h>
+#include <fcntl.h>
 #include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <sys/stat.h>
+#include <unistd.h>
 
 #include "pkg.h"
 
@@ -108,3 +113,184 @@ int pkg_txn_clear_state(FAR const char *name)
 
   return pkg_store_remove_file(path);
 }
+
+int pkg_txn_acquire_lock(FAR const char *name, FAR char *path, size_t size)
+{
+  int fd;
+  int ret;
+
+  ret = pkg_store_ensure_package_root(name);
+  if (ret < 0)
+    {
+      return ret;
+    }
+
+  ret = pkg_store_format_lock_path(path, size, name);
+  if (ret < 0)
+    {
+      return ret;
+    }
+
+  fd = open(path, O_WRONLY | O_CREAT | O_EXCL, 0644);
+  if (fd < 0)
+    {
+      return errno == EEXIST ? -EBUSY : -errno;
+    }
+
+  close(fd);
+  return 0;
+}
+
+int pkg_txn_write_pointers(FAR const struct pkg_installed_entry_s *entry)
+{
+  char current[PATH_MAX];
+  char previous[PATH_MAX];
+  int ret;
+
+  ret = pkg_store_format_current_path(current, sizeof(current),
+                                      entry->name);
+  if (ret < 0)
+    {
+      return ret;
+    }
+
+  ret = pkg_store_format_previous_path(previous, sizeof(previous),
+                                       entry->name);
+  if (ret < 0)
+    {
+      return ret;
+    }
+
+  ret = pkg_store_write_text_atomic(current, entry->current);
+  if (ret < 0)
+    {
+      return ret;
+    }
+
+  return pkg_store_write_text_atomic(previous, entry->previous);
+}
+
+/* Make the previous version current again. Every installed version keeps
+ * its manifest and its payload stays in the object store, so this only
+ * checks that the payload is there and swaps the metadata.
+ */
+
+int pkg_rollback(FAR const char *name)
+{
+  FAR struct pkg_installed_db_s *installed;
+  FAR struct pkg_installed_entry_s *entry;
+  struct pkg_manifest_s manifest;
+  char path[PATH_MAX];
+  char lock[PATH_MAX] = "";
+  char version[PKG_VERSION_MAX + 1];
+  struct stat st;
+  int ret;
+
+  installed = malloc(sizeof(*installed));
+  if (installed == NULL)
+    {
+      pkg_error("unable to allocate installed metadata buffer");
+      return EXIT_FAILURE;
+    }
+
+  ret = pkg_store_prepare_layout();
+  if (ret < 0)
+    {
+      free(installed);
+      pkg_error("unable to prepare package layout: %d", ret);
+      return EXIT_FAILURE;
+    }
+
+  ret = pkg_txn_acquire_lock(name, lock, sizeof(lock));
+  if (ret < 0)
+    {
+      free(installed);
+      pkg_error("unable to acquire package lock for '%s': %d", name, ret);
+      return EXIT_FAILURE;
+    }
+
+  ret = pkg_metadata_load_installed(installed);
+  if (ret < 0)
+    {
+      goto errout;
+    }
+
+  entry = pkg_metadata_find_installed(installed, name);
+  if (entry == NULL || entry->previous[0] == '\0')
+    {
+      ret = -ENOENT;
+      goto errout;
+    }
+
+  ret = pkg_txn_write_state(name, PKG_TXN_RESTORE);
+  if (ret < 0)
+    {
+      goto errout;
+    }
+
+  ret = pkg_store_format_manifest_path(path, sizeof(path), name,
+                                       entry->previous);
+  if (ret < 0)
+    {
+      goto errout;
+    }
+
+  ret = pkg_metadata_read_manifest(path, &manifest);
+  if (ret < 0)
+    {
+      goto errout;
+    }
+
+  ret = pkg_store_format_object_path(path, sizeof(path), manifest.sha256);
+  if (ret < 0)
+    {
+      goto errout;
+    }
+
+  if (stat(path, &st) < 0)
+    {
+      ret = -errno;
+      goto errout;
+    }
+
+  ret = pkg_compat_check(&manifest);
+  if (ret < 0)
+    {
+      goto errout;
+    }
+
+  strlcpy(version, entry->current, sizeof(version));
+  strlcpy(entry->current, entry->previous, sizeof(entry->current));
+  strlcpy(entry->previous, version, sizeof(entry->previous));
+  strlcpy(entry->arch, manifest.arch, sizeof(entry->arch));
+  strlcpy(entry->compat, manifest.compat, sizeof(entry->compat));
+  entry->type = manifest.type;
+
+  ret = pkg_txn_write_pointers(entry);
+  if (ret < 0)
+    {
+      goto errout;
+    }
+
+  ret = pkg_metadata_save_installed(installed);
+  if (ret < 0)
+    {
+      goto errout;
+    }
+
+  pkg_txn_write_state(name, PKG_TXN_ACTIVATED);
+  pkg_txn_clear_state(name);
+  pkg_store_remove_file(lock);
+
+  pkg_info("rolled back %s to version %s", name, entry->current);
+  free(installed);
+  return EXIT_SUCCESS;
+
+errout:
+  pkg_txn_write_state(name, PKG_TXN_FAILED);
+  pkg_txn_clear_state(name);
+  pkg_store_remove_file(lock);
+  free(installed);
+  pkg_error("rollback failed for '%s': %d", name, ret);
+  return EXIT_FAILURE;
+}
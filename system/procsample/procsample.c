@@ -0,0 +1,838 @@
+/****************************************************************************
+ * apps/system/procsample/procsample.c
+ *
+ * SPDX-License-Identifier: Apache-2.0
+ *
+ * Licensed to the Apache Software Foundation (ASF) under one or more
+ * contributor license agreements.  See the NOTICE file distributed with
+ * this work for additional information regarding copyright ownership.  The
+ * ASF licenses this file to you under the Apache License, Version 2.0 (the
+ * "License"); you may not use this file except in compliance with the
+ * License.  You may obtain a copy of the License at
+ *
+ *   http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS, WITHOUT
+ * WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.  See the
+ * License for the specific language governing permissions and limitations
+ * under the License.
+ *
+ ****************************************************************************/
+
+/****************************************************************************
+ * Included Files
+ ****************************************************************************/
+
+#include <nuttx/config.h>
+
+#include <sys/types.h>
+#include <ctype.h>
+#include <dirent.h>
+#include <errno.h>
+#include <fcntl.h>
+#include <limits.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+#include <unistd.h>
+
+#include <sys/param.h>
+
+#include "system/procsample.h"
+
+/****************************************************************************
+ * Pre-processor Definitions
+ ****************************************************************************/
+
+#define PROCSAMPLE_MAXSIZE 4096
+
+/* Layout of <pid>/critmon, see proc_critmon() in the kernel */
+
+#if defined(CONFIG_SCHED_CRITMONITOR_MAXTIME_PREEMPTION) && \
+    CONFIG_SCHED_CRITMONITOR_MAXTIME_PREEMPTION >= 0
+#  define HAVE_CRITMON_PREEMPTION
+#endif
+
+#if defined(CONFIG_SCHED_CRITMONITOR_MAXTIME_CSECTION) && \
+    CONFIG_SCHED_CRITMONITOR_MAXTIME_CSECTION >= 0
+#  define HAVE_CRITMON_CSECTION
+#endif
+
+#if defined(CONFIG_SCHED_CRITMONITOR_MAXTIME_THREAD) && \
+    CONFIG_SCHED_CRITMONITOR_MAXTIME_THREAD >= 0
+#  define HAVE_CRITMON_THREAD
+#endif
+
+/****************************************************************************
+ * Private Data
+ ****************************************************************************/
+
+static const char * const g_procsample_path[PROCSAMPLE_NFILES] =
+{
+  [PROCSAMPLE_STATUS]  = "status",
+  [PROCSAMPLE_GROUP]   = "group/status",
+  [PROCSAMPLE_STACK]   = "stack",
+  [PROCSAMPLE_HEAP]    = "heap",
+  [PROCSAMPLE_LOADAVG] = "loadavg",
+  [PROCSAMPLE_CRITMON] = "critmon",
+  [PROCSAMPLE_CMDLINE] = "cmdline",
+};
+
+/* Room initially kept for each file.  A file that fills it is read again
+ * into a larger buffer, up to PROCSAMPLE_MAXSIZE.
+ */
+
+static const uint16_t g_procsample_size[PROCSAMPLE_NFILES] =
+{
+  [PROCSAMPLE_STATUS]  = 512,
+  [PROCSAMPLE_GROUP]   = 192,
+  [PROCSAMPLE_STACK]   = 128,
+  [PROCSAMPLE_HEAP]    = 192,
+  [PROCSAMPLE_LOADAVG] = 16,
+  [PROCSAMPLE_CRITMON] = 160,
+  [PROCSAMPLE_CMDLINE] = 128,
+};
+
+/****************************************************************************
+ * Private Functions
+ ****************************************************************************/
+
+/****************************************************************************
+ * Name: procsample_now
+ ****************************************************************************/
+
+static uint64_t procsample_now(void)
+{
+  struct timespec ts;
+
+  clock_gettime(CLOCK_MONOTONIC, &ts);
+  return (uint64_t)ts.tv_sec * 1000000 + ts.tv_nsec / 1000;
+}
+
+/****************************************************************************
+ * Name: procsample_hash
+ *
+ * Description:
+ *   FNV-1a, only used to tell whether a file changed between samples.
+ *
+ ****************************************************************************/
+
+static uint32_t procsample_hash(FAR const char *text, size_t len)
+{
+  uint32_t hash = 2166136261u;
+
+  while (len-- > 0)
+    {
+      hash = (hash ^ (uint8_t)*text++) * 16777619u;
+    }
+
+  return hash;
+}
+
+/****************************************************************************
+ * Name: procsample_ulong
+ ****************************************************************************/
+
+static unsigned long procsample_ulong(FAR const char *str)
+{
+  unsigned long value = 0;
+
+  if (str != NULL)
+    {
+      while (*str == ' ')
+        {
+          str++;
+        }
+
+      while (isdigit(*str))
+        {
+          value = value * 10 + (*str++ - '0');
+        }
+    }
+
+  return value;
+}
+
+/****************************************************************************
+ * Name: procsample_time
+ *
+ * Description:
+ *   Convert "S.NNNNNNNNN" to nanoseconds and return the end of the number.
+ *
+ ****************************************************************************/
+
+#ifdef CONFIG_SCHED_CRITMONITOR
+static FAR const char *procsample_time(FAR const char *str,
+                                       FAR uint64_t *ns)
+{
+  uint64_t value = 0;
+  int digits = 0;
+
+  while (*str == ' ')
+    {
+      str++;
+    }
+
+  while (isdigit(*str))
+    {
+      value = value * 10 + (*str++ - '0');
+    }
+
+  value *= 1000000000;
+
+  if (*str == '.')
+    {
+      uint32_t frac = 0;
+
+      for (str++; isdigit(*str); str++)
+        {
+          if (digits < 9)
+            {
+              frac = frac * 10 + (*str - '0');
+              digits++;
+            }
+        }
+
+      while (digits++ < 9)
+        {
+          frac *= 10;
+        }
+
+      value += frac;
+    }
+
+  *ns = value;
+
+  /* Skip the caller address that may follow the time */
+
+  while (*str != ',' && *str != '\n' && *str != '\0')
+    {
+      str++;
+    }
+
+  if (*str == ',')
+    {
+      str++;
+    }
+
+  return str;
+}
+#endif
+
+/****************************************************************************
+ * Name: procsample_parse
+ ****************************************************************************/
+
+static void procsample_parse(FAR struct procsample_task_s *task, int n)
+{
+  FAR const char *text = task->file[n].text;
+  FAR const char *ptr;
+
+  switch (n)
+    {
+      case PROCSAMPLE_STATUS:
+#if PROCSAMPLE_NAME_SIZE > 0
+        ptr = procsample_value(text, "Name:");
+        if (ptr != NULL)
+          {
+            procsample_copyline(task->name, sizeof(task->name), ptr);
+          }
+#endif
+        break;
+
+      case PROCSAMPLE_GROUP:
+        ptr = procsample_value(text, "Parent:");
+        if (ptr != NULL)
+          {
+            task->ppid = (pid_t)procsample_ulong(ptr);
+          }
+        break;
+
+      case PROCSAMPLE_STACK:
+        task->stacksize =
+          procsample_ulong(procsample_value(text, "StackSize:"));
+        task->stackused =
+          procsample_ulong(procsample_value(text, "StackUsed:"));
+        break;
+
+      case PROCSAMPLE_HEAP:
+        task->heapsize =
+          procsample_ulong(procsample_value(text, "AllocSize:"));
+        break;
+
+      case PROCSAMPLE_LOADAVG:
+
+        /* Format: "%3u.%01u%%" */
+
+        task->load = procsample_ulong(text) * 10;
+        ptr = strchr(text, '.');
+        if (ptr != NULL && isdigit(ptr[1]))
+          {
+            task->load += ptr[1] - '0';
+          }
+        break;
+
+#ifdef CONFIG_SCHED_CRITMONITOR
+      case PROCSAMPLE_CRITMON:
+        {
+          uint64_t runtime = task->runtime;
+
+          /* Format: [premp,][csection,][runmax,runtime] where each field
+           * is "S.NNNNNNNNN" optionally followed by the caller.
+           */
+
+          ptr = text;
+#  ifdef HAVE_CRITMON_PREEMPTION
+          ptr = procsample_time(ptr, &task->premp_max);
+#  endif
+#  ifdef HAVE_CRITMON_CSECTION
+          ptr = procsample_time(ptr, &task->crit_max);
+#  endif
+#  ifdef HAVE_CRITMON_THREAD
+          ptr = procsample_time(ptr, &task->run_max);
+          ptr = procsample_time(ptr, &task->runtime);
+#  endif
+          UNUSED(ptr);
+
+          if (task->nsamples > 0 && task->runtime >= runtime)
+            {
+              task->runtime_delta = task->runtime - runtime;
+            }
+        }
+        break;
+#endif
+
+      default:
+        break;
+    }
+}
+
+/****************************************************************************
+ * Name: procsample_open
+ ****************************************************************************/
+
+static int procsample_open(FAR struct procsample_s *ps, pid_t pid, int n)
+{
+  char path[PATH_MAX];
+  int fd;
+
+  snprintf(path, sizeof(path), "%s/%d/%s", ps->mountpoint, (int)pid,
+           g_procsample_path[n]);
+
+  ps->nopens++;
+  fd = open(path, O_RDONLY | O_CLOEXEC);
+  return fd < 0 ? -errno : fd;
+}
+
+/****************************************************************************
+ * Name: procsample_free
+ ****************************************************************************/
+
+static void procsample_free(FAR struct procsample_task_s *task)
+{
+  int n;
+
+  for (n = 0; n < PROCSAMPLE_NFILES; n++)
+    {
+      if (task->file[n].fd >= 0)
+        {
+          close(task->file[n].fd);
+        }
+
+      /* Buffers that had to grow were allocated separately */
+
+      if (task->file[n].size > g_procsample_size[n])
+        {
+          free(task->file[n].text);
+        }
+    }
+
+  /* All other text buffers live in the same allocation as the task */
+
+  free(task);
+}
+
+/****************************************************************************
+ * Name: procsample_alloc
+ *
+ * Description:
+ *   Create the record of a task and open its files.  Fails if none of
+ *   them can be opened, i.e. the task is gone.
+ *
+ ****************************************************************************/
+
+static FAR struct procsample_task_s *
+procsample_alloc(FAR struct procsample_s *ps, pid_t pid)
+{
+  FAR struct procsample_task_s *task;
+  FAR char *text;
+  size_t size = sizeof(*task);
+  bool found = false;
+  int n;
+
+  for (n = 0; n < PROCSAMPLE_NFILES; n++)
+    {
+      if (ps->files & PROCSAMPLE_FILE(n))
+        {
+          size += g_procsample_size[n];
+        }
+    }
+
+  task = zalloc(size);
+  if (task == NULL)
+    {
+      return NULL;
+    }
+
+  task->pid  = pid;
+  task->ppid = -1;
+  text = (FAR char *)(task + 1);
+
+  for (n = 0; n < PROCSAMPLE_NFILES; n++)
+    {
+      FAR struct procsample_file_s *file = &task->file[n];
+
+      file->fd = -1;
+      if ((ps->files & PROCSAMPLE_FILE(n)) == 0)
+        {
+          continue;
+        }
+
+      file->text = text;
+      file->size = g_procsample_size[n];
+      text      += file->size;
+
+      /* Files that are not configured in the kernel are simply absent */
+
+      file->fd = procsample_open(ps, pid, n);
+      if (file->fd >= 0)
+        {
+          found = true;
+        }
+    }
+
+  if (!found)
+    {
+      procsample_free(task);
+      return NULL;
+    }
+
+  return task;
+}
+
+/****************************************************************************
+ * Name: procsample_read
+ ****************************************************************************/
+
+static int procsample_read(FAR struct procsample_s *ps,
+                           FAR struct procsample_task_s *task, int n)
+{
+  FAR struct procsample_file_s *file = &task->file[n];
+  FAR char *text;
+  ssize_t nread = -1;
+  uint32_t hash;
+  size_t size;
+
+retry:
+  if (!ps->reopen)
+    {
+      nread = pread(file->fd, file->text, file->size - 1, 0);
+      if (nread < 0 && (errno == ESPIPE || errno == ENOSYS))
+        {
+          /* No seek support, fall back to reopening the file */
+
+          ps->reopen = true;
+        }
+    }
+
+  if (ps->reopen)
+    {
+      close(file->fd);
+      file->fd = procsample_open(ps, task->pid, n);
+      if (file->fd < 0)
+        {
+          return file->fd;
+        }
+
+      nread = read(file->fd, file->text, file->size - 1);
+    }
+
+  if (nread < 0)
+    {
+      return -errno;
+    }
+
+  ps->nreads++;
+
+  /* A full buffer may have truncated the file, e.g. a long command line */
+
+  if (nread == file->size - 1 && file->size < PROCSAMPLE_MAXSIZE)
+    {
+      size = MIN(2 * file->size, PROCSAMPLE_MAXSIZE);
+      text = malloc(size);
+      if (text != NULL)
+        {
+          if (file->size > g_procsample_size[n])
+            {
+              free(file->text);
+            }
+
+          file->text = text;
+          file->size = size;
+          goto retry;
+        }
+    }
+
+  file->text[nread] = '\0';
+  file->len = nread;
+
+  hash = procsample_hash(file->text, nread);
+  if (hash != file->hash || task->nsamples == 0)
+    {
+      file->hash = hash;
+      task->changed |= PROCSAMPLE_FILE(n);
+    }
+
+  return OK;
+}
+
+/****************************************************************************
+ * Name: procsample_sample
+ *
+ * Description:
+ *   Re-read the cached files of one task.  A read error means the task
+ *   has exited since its files were opened.
+ *
+ ****************************************************************************/
+
+static int procsample_sample(FAR struct procsample_s *ps,
+                             FAR struct procsample_task_s *task)
+{
+  int ret;
+  int n;
+
+  task->changed = 0;
+  task->runtime_delta = 0;
+
+  for (n = 0; n < PROCSAMPLE_NFILES; n++)
+    {
+      if (task->file[n].fd < 0)
+        {
+          continue;
+        }
+
+      ret = procsample_read(ps, task, n);
+      if (ret < 0)
+        {
+          return ret;
+        }
+
+      if (task->changed & PROCSAMPLE_FILE(n))
+        {
+          procsample_parse(task, n);
+        }
+    }
+
+  task->nsamples++;
+  return OK;
+}
+
+/****************************************************************************
+ * Name: procsample_find
+ *
+ * Description:
+ *   Binary search for pid.  Returns its index, or the index where it
+ *   would have to be inserted.
+ *
+ ****************************************************************************/
+
+static size_t procsample_find(FAR struct procsample_s *ps, pid_t pid)
+{
+  size_t lo = 0;
+  size_t hi = ps->ntasks;
+
+  while (lo < hi)
+    {
+      size_t mid = (lo + hi) / 2;
+
+      if (ps->tasks[mid]->pid < pid)
+        {
+          lo = mid + 1;
+        }
+      else
+        {
+          hi = mid;
+        }
+    }
+
+  return lo;
+}
+
+/****************************************************************************
+ * Name: procsample_insert
+ ****************************************************************************/
+
+static FAR struct procsample_task_s *
+procsample_insert(FAR struct procsample_s *ps, pid_t pid)
+{
+  FAR struct procsample_task_s *task;
+  size_t i = procsample_find(ps, pid);
+
+  if (i < ps->ntasks && ps->tasks[i]->pid == pid)
+    {
+      return ps->tasks[i];
+    }
+
+  if (ps->ntasks == ps->capacity)
+    {
+      FAR struct procsample_task_s **tasks;
+      size_t capacity = ps->capacity ? ps->capacity * 2 : 16;
+
+      tasks = realloc(ps->tasks, capacity * sizeof(*tasks));
+      if (tasks == NULL)
+        {
+          return NULL;
+        }
+
+      ps->tasks    = tasks;
+      ps->capacity = capacity;
+    }
+
+  task = procsample_alloc(ps, pid);
+  if (task == NULL)
+    {
+      return NULL;
+    }
+
+  memmove(&ps->tasks[i + 1], &ps->tasks[i],
+          (ps->ntasks - i) * sizeof(ps->tasks[0]));
+  ps->tasks[i] = task;
+  ps->ntasks++;
+  return task;
+}
+
+/****************************************************************************
+ * Name: procsample_scan
+ *
+ * Description:
+ *   Mark every task listed in the procfs directory as seen, creating the
+ *   records of new ones.
+ *
+ ****************************************************************************/
+
+static int procsample_scan(FAR struct procsample_s *ps)
+{
+  FAR struct procsample_task_s *task;
+  FAR struct dirent *entryp;
+  FAR DIR *dirp;
+
+  dirp = opendir(ps->mountpoint);
+  if (dirp == NULL)
+    {
+      return -errno;
+    }
+
+  while ((entryp = readdir(dirp)) != NULL)
+    {
+      FAR const char *name = entryp->d_name;
+      pid_t pid = 0;
+
+      /* Task/thread entries are directories with all numeric names */
+
+      if (!DIRENT_ISDIRECTORY(entryp->d_type) || !isdigit(*name))
+        {
+          continue;
+        }
+
+      while (isdigit(*name))
+        {
+          pid = pid * 10 + (*name++ - '0');
+        }
+
+      if (*name != '\0')
+        {
+          continue;
+        }
+
+      task = procsample_insert(ps, pid);
+      if (task != NULL)
+        {
+          task->seen = ps->generation;
+        }
+    }
+
+  closedir(dirp);
+  return OK;
+}
+
+/****************************************************************************
+ * Public Functions
+ ****************************************************************************/
+
+/****************************************************************************
+ * Name: procsample_init
+ ****************************************************************************/
+
+void procsample_init(FAR struct procsample_s *ps,
+                     FAR const char *mountpoint, uint32_t files)
+{
+  memset(ps, 0, sizeof(*ps));
+  ps->mountpoint = mountpoint;
+  ps->files      = files;
+}
+
+/****************************************************************************
+ * Name: procsample_deinit
+ ****************************************************************************/
+
+void procsample_deinit(FAR struct procsample_s *ps)
+{
+  size_t i;
+
+  for (i = 0; i < ps->ntasks; i++)
+    {
+      procsample_free(ps->tasks[i]);
+    }
+
+  free(ps->tasks);
+  ps->tasks    = NULL;
+  ps->ntasks   = 0;
+  ps->capacity = 0;
+}
+
+/****************************************************************************
+ * Name: procsample_add
+ ****************************************************************************/
+
+int procsample_add(FAR struct procsample_s *ps, pid_t pid)
+{
+  ps->fixed = true;
+  return procsample_insert(ps, pid) != NULL ? OK : -ENOENT;
+}
+
+/****************************************************************************
+ * Name: procsample_update
+ ****************************************************************************/
+
+int procsample_update(FAR struct procsample_s *ps, procsample_cb_t cb,
+                      FAR void *arg)
+{
+  uint64_t start = procsample_now();
+  size_t count = 0;
+  size_t i;
+  int ret;
+
+  ps->generation++;
+  ps->nreads = 0;
+  ps->nopens = 0;
+
+  if (ps->fixed)
+    {
+      for (i = 0; i < ps->ntasks; i++)
+        {
+          ps->tasks[i]->seen = ps->generation;
+        }
+    }
+  else
+    {
+      ret = procsample_scan(ps);
+      if (ret < 0)
+        {
+          return ret;
+        }
+    }
+
+  /* Sample the live tasks and drop the ones that are gone, keeping the
+   * array sorted.
+   */
+
+  for (i = 0; i < ps->ntasks; i++)
+    {
+      FAR struct procsample_task_s *task = ps->tasks[i];
+
+      if (task->seen != ps->generation || procsample_sample(ps, task) < 0)
+        {
+          procsample_free(task);
+          continue;
+        }
+
+      ps->tasks[count++] = task;
+    }
+
+  ps->ntasks  = count;
+  ps->elapsed = (uint32_t)(procsample_now() - start);
+
+  if (cb != NULL)
+    {
+      for (i = 0; i < ps->ntasks; i++)
+        {
+          ret = cb(ps, ps->tasks[i], arg);
+          if (ret != 0)
+            {
+              return ret;
+            }
+        }
+    }
+
+  return OK;
+}
+
+/****************************************************************************
+ * Name: procsample_value
+ ****************************************************************************/
+
+FAR const char *procsample_value(FAR const char *text, FAR const char *key)
+{
+  size_t len = strlen(key);
+
+  while (*text != '\0')
+    {
+      if (strncmp(text, key, len) == 0)
+        {
+          text += len;
+          while (*text == ' ' || *text == '\t')
+            {
+              text++;
+            }
+
+          return text;
+        }
+
+      text = strchr(text, '\n');
+      if (text == NULL)
+        {
+          break;
+        }
+
+      text++;
+    }
+
+  return NULL;
+}
+
+/****************************************************************************
+ * Name: procsample_copyline
+ ****************************************************************************/
+
+size_t procsample_copyline(FAR char *dest, size_t size,
+                           FAR const char *value)
+{
+  size_t len = 0;
+
+  while (len + 1 < size && value[len] != '\n' && value[len] != '\r' &&
+         value[len] != '\0')
+    {
+      dest[len] = value[len];
+      len++;
+    }
+
+  while (len > 0 && (dest[len - 1] == ' ' || dest[len - 1] == '\t'))
+    {
+      len--;
+    }
+
+  dest[len] = '\0';
+  return len;
+}
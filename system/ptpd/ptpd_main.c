@@ -26,6 +26,7 @@
 
 #include <nuttx/config.h>
 
+#include <inttypes.h>
 #include <stdint.h>
 #include <stdlib.h>
 #include <stdio.h>
@@ -104,6 +105,21 @@ static int do_ptpd_status(int pid)
   printf("- last_adjtime_ns: %lld\n", (long long)status.last_adjtime_ns);
   printf("- drift_ppb: %ld\n", status.drift_ppb);
   printf("- path_delay_ns: %ld\n", status.path_delay_ns);
+  printf("- servo_locked: %d\n", (int)status.servo_locked);
+  printf("- samples: %" PRIu32 " (%" PRIu32 " outliers)\n",
+         status.nsamples, status.noutliers);
+  printf("- offset_ns: mean %lld rms %lld max %lld\n",
+         (long long)status.offset_stats.mean,
+         (long long)status.offset_stats.rms,
+         (long long)status.offset_stats.max);
+  printf("- delay_ns: mean %lld rms %lld max %lld\n",
+         (long long)status.delay_stats.mean,
+         (long long)status.delay_stats.rms,
+         (long long)status.delay_stats.max);
+  printf("- freq_ppb: mean %lld rms %lld max %lld\n",
+         (long long)status.freq_stats.mean,
+         (long long)status.freq_stats.rms,
+         (long long)status.freq_stats.max);
 
   clock_gettime(CLOCK_MONOTONIC, &time_now);
 
@@ -31,14 +31,11 @@
 #include <unistd.h>
 #include <stdlib.h>
 #include <stdio.h>
-#include <string.h>
-#include <ctype.h>
-#include <fcntl.h>
-#include <dirent.h>
 #include <sched.h>
-#include <syslog.h>
 #include <errno.h>
 
+#include "system/procsample.h"
+
 #ifdef CONFIG_SYSTEM_STACKMONITOR
 
 /****************************************************************************
@@ -70,7 +67,6 @@ struct stkmon_state_s
   volatile bool started;
   volatile bool stop;
   pid_t pid;
-  char line[80];
 };
 
 /****************************************************************************
@@ -78,231 +74,30 @@ struct stkmon_state_s
  ****************************************************************************/
 
 static struct stkmon_state_s g_stackmonitor;
-#if CONFIG_TASK_NAME_SIZE > 0
-static const char g_name[] = "Name:";
-#endif
-static const char g_stacksize[] = "StackSize:";
-static const char g_stackused[] = "StackUsed:";
 
 /****************************************************************************
  * Private Functions
  ****************************************************************************/
 
 /****************************************************************************
- * Name: stkmon_isolate_value
- ****************************************************************************/
-
-static FAR char *stkmon_isolate_value(FAR char *line)
-{
-  FAR char *ptr;
-
-  while (isblank(*line) && *line != '\0')
-    {
-      line++;
-    }
-
-  ptr = line;
-  while (*ptr != '\n' && *ptr != '\r' && *ptr != '\0')
-    {
-      ptr++;
-    }
-
-  *ptr = '\0';
-  return line;
-}
-
-/****************************************************************************
- * Name: stkmon_process_directory
+ * Name: stkmon_process_task
  ****************************************************************************/
 
-static int stkmon_process_directory(FAR struct dirent *entryp)
+static int stkmon_process_task(FAR struct procsample_s *ps,
+                               FAR struct procsample_task_s *task,
+                               FAR void *arg)
 {
-  FAR char *filepath;
-  FAR char *endptr;
-  FAR const char *tmpstr;
-  FILE *stream;
-  unsigned long stack_size;
-  unsigned long stack_used;
-  int len;
-  int ret;
-
-#if CONFIG_TASK_NAME_SIZE > 0
-  FAR char *name = NULL;
-
-  /* Read the task status to get the task name */
-
-  filepath = NULL;
-  ret = asprintf(&filepath,
-                 CONFIG_SYSTEM_STACKMONITOR_MOUNTPOINT "/%s/status",
-                 entryp->d_name);
-  if (ret < 0)
-    {
-      fprintf(stderr,
-              "Stack Monitor: Failed to create path to status file\n");
-      return -ENOMEM;
-    }
-
-  /* Open the status file */
-
-  stream = fopen(filepath, "r");
-  if (stream == NULL)
-    {
-      ret = -errno;
-      fprintf(stderr, "Stack Monitor: Failed to open %s: %d\n",
-              filepath, ret);
-      goto errout_with_filepath;
-    }
-
-  while (fgets(g_stackmonitor.line, 80, stream) != NULL)
-    {
-      g_stackmonitor.line[79] = '\n';
-      len = strlen(g_name);
-      if (strncmp(g_stackmonitor.line, g_name, len) == 0)
-        {
-          tmpstr = stkmon_isolate_value(&g_stackmonitor.line[len]);
-          if (*tmpstr == '\0')
-            {
-              ret = -EINVAL;
-              goto errout_with_stream;
-            }
-
-          name = strdup(tmpstr);
-          if (name == NULL)
-            {
-              ret = -EINVAL;
-              goto errout_with_stream;
-            }
-        }
-    }
-
-  free(filepath);
-  fclose(stream);
-#endif
-
-  /* Read stack information */
-
-  stack_size = 0;
-  stack_used = 0;
-  filepath   = NULL;
-
-  ret = asprintf(&filepath,
-                 CONFIG_SYSTEM_STACKMONITOR_MOUNTPOINT "/%s/stack",
-                 entryp->d_name);
-  if (ret < 0)
-    {
-      fprintf(stderr,
-              "Stack Monitor: Failed to create path to stack file\n");
-      ret = -EINVAL;
-      goto errout_with_name;
-    }
-
-  /* Open the stack file */
-
-  stream = fopen(filepath, "r");
-  if (stream == NULL)
-    {
-      ret = -errno;
-      fprintf(stderr, "Stack Monitor: Failed to open %s: %d\n",
-              filepath, ret);
-      goto errout_with_filepath;
-    }
-
-  while (fgets(g_stackmonitor.line, 80, stream) != NULL)
-    {
-      g_stackmonitor.line[79] = '\n';
-      len = strlen(g_stacksize);
-      if (strncmp(g_stackmonitor.line, g_stacksize, len) == 0)
-        {
-          tmpstr = stkmon_isolate_value(&g_stackmonitor.line[len]);
-          if (*tmpstr == '\0')
-            {
-              ret = -EINVAL;
-              goto errout_with_stream;
-            }
-
-          stack_size = (uint32_t)strtoul(tmpstr, &endptr, 10);
-          if (*endptr != '\0')
-            {
-              fprintf(stderr,
-                      "Stack Monitor: Bad numeric value %s\n", tmpstr);
-              ret = -EINVAL;
-              goto errout_with_stream;
-            }
-        }
-      else
-        {
-          len = strlen(g_stackused);
-          if (strncmp(g_stackmonitor.line, g_stackused, len) == 0)
-            {
-              tmpstr = stkmon_isolate_value(&g_stackmonitor.line[len]);
-              if (*tmpstr == '\0')
-                {
-                  ret = -EINVAL;
-                  goto errout_with_stream;
-                }
-
-              stack_used = (uint32_t)strtoul(tmpstr, &endptr, 10);
-              if (*endptr != '\0')
-                {
-                  fprintf(stderr,
-                          "Stack Monitor: Bad numeric value %s\n", tmpstr);
-                  ret = -EINVAL;
-                  goto errout_with_stream;
-                }
-            }
-        }
-    }
-
-  /* Finally, output the stack info that we gleaned from the procfs */
+  /* Output the stack info that was sampled from the procfs */
 
 #if CONFIG_TASK_NAME_SIZE > 0
-  printf("%5s %6lu %6lu %s\n",
-         entryp->d_name, stack_size, stack_used, name);
+  printf("%5d %6lu %6lu %s\n",
+         task->pid, task->stacksize, task->stackused, task->name);
 #else
-  printf("%5s %6lu %6lu\n",
-         entryp->d_name, stack_size, stack_used);
+  printf("%5d %6lu %6lu\n",
+         task->pid, task->stacksize, task->stackused);
 #endif
 
-  ret = OK;
-
-errout_with_stream:
-  fclose(stream);
-
-errout_with_filepath:
-  free(filepath);
-
-errout_with_name:
-#if CONFIG_TASK_NAME_SIZE > 0
-  if (name != NULL)
-    {
-      free(name);
-    }
-#endif
-
-  return ret;
-}
-
-/****************************************************************************
- * Name: stackmonitor_check_name
- ****************************************************************************/
-
-static bool stackmonitor_check_name(FAR char *name)
-{
-  int i;
-
-  /* Check each character in the name */
-
-  for (i = 0; i < NAME_MAX && name[i] != '\0'; i++)
-    {
-      if (!isdigit(name[i]))
-        {
-          /* Name contains something other than a decimal numeric character */
-
-          return false;
-        }
-    }
-
-  return true;
+  return OK;
 }
 
 /****************************************************************************
@@ -311,13 +106,21 @@ static bool stackmonitor_check_name(FAR char *name)
 
 static int stackmonitor_daemon(int argc, char **argv)
 {
-  DIR *dirp;
+  struct procsample_s ps;
   int exitcode = EXIT_SUCCESS;
   int errcount = 0;
   int ret;
 
   printf("Stack Monitor: Running: %d\n", g_stackmonitor.pid);
 
+  /* The task files stay open across samples */
+
+  procsample_init(&ps, CONFIG_SYSTEM_STACKMONITOR_MOUNTPOINT,
+#if CONFIG_TASK_NAME_SIZE > 0
+                  PROCSAMPLE_FILE(PROCSAMPLE_STATUS) |
+#endif
+                  PROCSAMPLE_FILE(PROCSAMPLE_STACK));
+
   /* Loop until we detect that there is a request to stop. */
 
   while (!g_stackmonitor.stop)
@@ -326,25 +129,6 @@ static int stackmonitor_daemon(int argc, char **argv)
 
       sleep(CONFIG_SYSTEM_STACKMONITOR_INTERVAL);
 
-      /* Open the top-level procfs directory */
-
-      dirp = opendir(CONFIG_SYSTEM_STACKMONITOR_MOUNTPOINT);
-      if (dirp == NULL)
-        {
-          /* Failed to open the directory */
-
-          fprintf(stderr, "Stack Monitor: Failed to open directory: %s\n",
-                  CONFIG_SYSTEM_STACKMONITOR_MOUNTPOINT);
-
-          if (++errcount > 100)
-            {
-              fprintf(stderr,
-                      "Stack Monitor: Too many errors ... exiting\n");
-              exitcode = EXIT_FAILURE;
-              break;
-            }
-        }
-
       /* Output the header */
 
 #if CONFIG_TASK_NAME_SIZE > 0
@@ -353,50 +137,28 @@ static int stackmonitor_daemon(int argc, char **argv)
       printf("%-5s %-6s %-6s\n", "PID", "SIZE", "USED");
 #endif
 
-      /* Read each directory entry */
+      /* Sample and output each task */
 
-      for (; ; )
+      ret = procsample_update(&ps, stkmon_process_task, NULL);
+      if (ret < 0)
         {
-          FAR struct dirent *entryp = readdir(dirp);
-          if (entryp == NULL)
-            {
-              /* Finished with this directory */
-
-              break;
-            }
+          /* Failed to read the directory */
 
-          /* Task/thread entries in the /proc directory will all be (1)
-           * directories with (2) all numeric names.
-           */
+          fprintf(stderr, "Stack Monitor: Failed to open directory: %s\n",
+                  CONFIG_SYSTEM_STACKMONITOR_MOUNTPOINT);
 
-          if (DIRENT_ISDIRECTORY(entryp->d_type) &&
-              stackmonitor_check_name(entryp->d_name))
+          if (++errcount > 100)
             {
-              /* Looks good -- process the directory */
-
-              ret = stkmon_process_directory(entryp);
-              if (ret < 0)
-                {
-                  /* Failed to process the thread directory */
-
-                  fprintf(stderr, "Stack Monitor: "
-                          "Failed to process sub-directory: %s\n",
-                          entryp->d_name);
-
-                  if (++errcount > 100)
-                    {
-                      fprintf(stderr,
-                             "Stack Monitor: Too many errors ... exiting\n");
-                      exitcode = EXIT_FAILURE;
-                      break;
-                    }
-                }
+              fprintf(stderr,
+                      "Stack Monitor: Too many errors ... exiting\n");
+              exitcode = EXIT_FAILURE;
+              break;
             }
         }
-
-      closedir(dirp);
     }
 
+  procsample_deinit(&ps);
+
   /* Stopped */
 
   g_stackmonitor.stop    = false;
@@ -78,6 +78,23 @@ struct tcurses_vt100_s
   int    keycount;
   char   keybuf[16];
   tcflag_t lflag;
+
+  /* Terminal state as last sent, used to skip redundant escape sequences
+   * and to pick the shortest cursor motion.  Negative when unknown.
+   */
+
+  int    row;                      /* Cursor row */
+  int    col;                      /* Cursor column */
+  int    cols;                     /* Screen width, 0 if unknown */
+  int    fg;                       /* Foreground color index */
+  int    bg;                       /* Background color index */
+  int    cursor;                   /* Cursor visibility */
+  long   attrib;                   /* TCURS_ATTRIB_* text attributes */
+
+  /* Output collected until the next flush */
+
+  size_t outlen;
+  char   outbuf[CONFIG_SYSTEM_TERMCURSES_VT100_OUTBUFSIZE];
 };
 
 /****************************************************************************
@@ -99,6 +116,9 @@ static int tcurses_vt100_getkeycode(FAR struct termcurses_s *dev,
               FAR int *specialkey, FAR int *keymodifers);
 static bool tcurses_vt100_checkkey(FAR struct termcurses_s *dev);
 static int tcurses_vt100_terminate(FAR struct termcurses_s *dev);
+static int tcurses_vt100_write(FAR struct termcurses_s *dev,
+              FAR const char *buf, size_t len);
+static int tcurses_vt100_flush(FAR struct termcurses_s *dev);
 
 /****************************************************************************
  * Private Data
@@ -114,7 +134,9 @@ static const struct termcurses_ops_s g_vt100_ops =
   tcurses_vt100_setattributes,
   tcurses_vt100_getkeycode,
   tcurses_vt100_checkkey,
-  tcurses_vt100_terminate
+  tcurses_vt100_terminate,
+  tcurses_vt100_write,
+  tcurses_vt100_flush
 };
 
 /* VT100 terminal codes */
@@ -127,14 +149,20 @@ static const char *g_movecurs       = "\033[%d;%dH";  /* Move cursor to x,y */
 static const char *g_getwinsize     = "\x1b[s\x1b[999;999H\x1b[6n\x1bu";
 static const char *g_setfgcolor     = "\x1b[38;5;%dm";
 static const char *g_setbgcolor     = "\x1b[48;5;%dm";
+static const char *g_setcolors      = "\x1b[38;5;%d;48;5;%dm";
 static const char *g_showcursor     = "\x1b[?25h";
 static const char *g_hidecursor     = "\x1b[?25l";
-static const char *g_setbold        = "\x1b[1";
-static const char *g_setnobold      = "\x1b[22";
-static const char *g_setblink       = ";5";
-static const char *g_setnoblink     = ";25";
-static const char *g_setunderline   = ";4";
-static const char *g_setnounderline = ";24";
+static const char *g_setacs         = "\x1b(0";      /* Line drawing set */
+static const char *g_setnoacs       = "\x1b(B";      /* ASCII set */
+
+/* Select Graphic Rendition parameters, sent as "ESC [ p1 ; p2 ... m" */
+
+static const char *g_setbold        = "1";
+static const char *g_setnobold      = "22";
+static const char *g_setblink       = "5";
+static const char *g_setnoblink     = "25";
+static const char *g_setunderline   = "4";
+static const char *g_setnounderline = "24";
 
 /* Set default background and foreground colors. */
 
@@ -731,6 +759,194 @@ struct termcurses_dev_s g_vt100_tcurs =
  * Private Functions
  ****************************************************************************/
 
+/****************************************************************************
+ * Forget the terminal state, the next operations send it in full again
+ ****************************************************************************/
+
+static void tcurses_vt100_invalidate(FAR struct tcurses_vt100_s *priv)
+{
+  priv->row    = -1;
+  priv->col    = -1;
+  priv->fg     = -1;
+  priv->bg     = -1;
+  priv->cursor = -1;
+  priv->attrib = -1;
+}
+
+/****************************************************************************
+ * Send the buffered output to the terminal
+ ****************************************************************************/
+
+static int tcurses_vt100_drain(FAR struct tcurses_vt100_s *priv)
+{
+  size_t  off = 0;
+  ssize_t nbytes;
+  int     ret = OK;
+
+  while (off < priv->outlen)
+    {
+      nbytes = write(priv->out_fd, &priv->outbuf[off], priv->outlen - off);
+      if (nbytes < 0)
+        {
+          if (errno == EINTR)
+            {
+              continue;
+            }
+
+          /* Part of the output is lost, so is what we know of the
+           * terminal.
+           */
+
+          ret = -errno;
+          tcurses_vt100_invalidate(priv);
+          break;
+        }
+
+      off += nbytes;
+    }
+
+  priv->outlen = 0;
+  return ret;
+}
+
+/****************************************************************************
+ * Queue output for the terminal, flushing when the buffer fills up
+ ****************************************************************************/
+
+static int tcurses_vt100_output(FAR struct tcurses_vt100_s *priv,
+                                FAR const char *buf, size_t len)
+{
+  size_t chunk;
+  int    ret = OK;
+
+  /* Keep short sequences in one piece */
+
+  if (priv->outlen + len > sizeof(priv->outbuf))
+    {
+      ret = tcurses_vt100_drain(priv);
+    }
+
+  while (len > 0)
+    {
+      if (priv->outlen == sizeof(priv->outbuf))
+        {
+          ret = tcurses_vt100_drain(priv);
+        }
+
+      chunk = sizeof(priv->outbuf) - priv->outlen;
+      if (chunk > len)
+        {
+          chunk = len;
+        }
+
+      memcpy(&priv->outbuf[priv->outlen], buf, chunk);
+      priv->outlen += chunk;
+      buf          += chunk;
+      len          -= chunk;
+    }
+
+  return ret;
+}
+
+/****************************************************************************
+ * Format a cursor motion sequence "ESC [ n cmd", the count is left out
+ * when it is 1.  Returns the length of the sequence.
+ ****************************************************************************/
+
+static int tcurses_vt100_motion(FAR char *str, int count, char cmd)
+{
+  if (count == 1)
+    {
+      str[0] = '\x1b';
+      str[1] = '[';
+      str[2] = cmd;
+      return 3;
+    }
+
+  return sprintf(str, "\x1b[%d%c", count, cmd);
+}
+
+/****************************************************************************
+ * Build the relative cursor motion from the current position to row, col
+ * out of CR, LF, BS and the cursor up/down/forward/back sequences.  Returns
+ * the length of the motion or -1 if the position is not known.
+ ****************************************************************************/
+
+static int tcurses_vt100_relmove(FAR struct tcurses_vt100_s *priv,
+                                 FAR char *str, int col, int row)
+{
+  int curcol = priv->col;
+  int len    = 0;
+  int count;
+  int seqlen;
+
+  if (priv->row < 0 || priv->col < 0)
+    {
+      return -1;
+    }
+
+  /* Column 0 is a single CR away */
+
+  if (col == 0 && curcol != 0)
+    {
+      str[len++] = '\r';
+      curcol     = 0;
+    }
+
+  /* Vertical motion.  Line feeds only go to column 0, where a terminal
+   * translating LF to CR LF ends up in the same place.
+   */
+
+  count = row - priv->row;
+  if (count > 0)
+    {
+      seqlen = tcurses_vt100_motion(&str[len], count, 'B');
+      if (col == 0 && count < seqlen)
+        {
+          memset(&str[len], '\n', count);
+          seqlen = count;
+        }
+
+      len += seqlen;
+    }
+  else if (count < 0)
+    {
+      len += tcurses_vt100_motion(&str[len], -count, 'A');
+    }
+
+  /* Horizontal motion */
+
+  count = col - curcol;
+  if (count > 0)
+    {
+      len += tcurses_vt100_motion(&str[len], count, 'C');
+    }
+  else if (count < 0)
+    {
+      seqlen = tcurses_vt100_motion(&str[len], -count, 'D');
+      if (-count < seqlen)
+        {
+          memset(&str[len], '\b', -count);
+          seqlen = -count;
+        }
+
+      len += seqlen;
+    }
+
+  return len;
+}
+
+/****************************************************************************
+ * Append an SGR parameter to the sequence in str
+ ****************************************************************************/
+
+static void tcurses_vt100_sgrparam(FAR char *str, size_t size,
+                                   FAR const char *param)
+{
+  strlcat(str, str[0] == '\0' ? "\x1b[" : ";", size);
+  strlcat(str, param, size);
+}
+
 /****************************************************************************
  * Clear screen / line operations
  ****************************************************************************/
@@ -738,43 +954,31 @@ struct termcurses_dev_s g_vt100_tcurs =
 static int tcurses_vt100_clear(FAR struct termcurses_s *dev, int type)
 {
   FAR struct tcurses_vt100_s *priv;
-  int ret = -ENOSYS;
-  int fd;
+  FAR const char *str;
 
   priv = (FAR struct tcurses_vt100_s *)dev;
-  fd = priv->out_fd;
 
   /* Perform operation based on type */
 
   switch (type)
     {
       case TCURS_CLEAR_SCREEN:
-        ret = write(fd, g_clrscr, strlen(g_clrscr));
-        break;
-
-      case TCURS_CLEAR_LINE:
+        str = g_clrscr;
         break;
 
       case TCURS_CLEAR_EOS:
-        ret = write(fd, g_clrscr, strlen(g_clreos));
+        str = g_clreos;
         break;
 
       case TCURS_CLEAR_EOL:
-        ret = write(fd, g_clrscr, strlen(g_clreol));
+        str = g_clreol;
         break;
 
       default:
         return -ENOSYS;
     }
 
-  /* If data written successfully, return OK */
-
-  if (ret > 0)
-    {
-      ret = OK;
-    }
-
-  return ret;
+  return tcurses_vt100_output(priv, str, strlen(str));
 }
 
 /****************************************************************************
@@ -785,34 +989,43 @@ static int tcurses_vt100_move(FAR struct termcurses_s *dev, int type,
                               int col, int row)
 {
   FAR struct tcurses_vt100_s *priv;
-  int   ret = -ENOSYS;
-  int   fd;
-  char  str[32];
+  char  absstr[32];
+  char  relstr[32];
+  int   abslen;
+  int   rellen;
 
   priv = (FAR struct tcurses_vt100_s *)dev;
-  fd   = priv->out_fd;
 
   /* Perform operation based on type */
 
   switch (type)
     {
       case TCURS_MOVE_YX:
-        snprintf(str, sizeof(str), g_movecurs, row + 1, col + 1);
-        ret = write(fd, str, strlen(str));
         break;
 
       default:
         return -ENOSYS;
     }
 
-  /* If bytes written, return OK */
+  if (row == priv->row && col == priv->col)
+    {
+      return OK;
+    }
+
+  /* Send whichever of the absolute and the relative motion is shorter */
 
-  if (ret > 0)
+  abslen = snprintf(absstr, sizeof(absstr), g_movecurs, row + 1, col + 1);
+  rellen = tcurses_vt100_relmove(priv, relstr, col, row);
+
+  priv->row = row;
+  priv->col = col;
+
+  if (rellen >= 0 && rellen < abslen)
     {
-      ret = OK;
+      return tcurses_vt100_output(priv, relstr, rellen);
     }
 
-  return ret;
+  return tcurses_vt100_output(priv, absstr, abslen);
 }
 
 /****************************************************************************
@@ -909,21 +1122,24 @@ static int tcurses_vt100_setcolors(FAR struct termcurses_s *dev,
                                    FAR struct termcurses_colors_s *colors)
 {
   FAR struct tcurses_vt100_s *priv;
-  int  ret = -ENOSYS;
-  int  fd;
+  int  fg = -1;
+  int  bg = -1;
+  int  index;
+  int  len;
   char str[48];
 
   priv = (FAR struct tcurses_vt100_s *)dev;
-  fd   = priv->out_fd;
 
   /* Test if FG color to be set */
 
   if ((colors->color_mask & TCURS_COLOR_FG) != 0)
     {
-      snprintf(str, sizeof(str), g_setfgcolor,
-               tcurses_vt100_getcolorindex(colors->fg_red, colors->fg_green,
-                                           colors->fg_blue));
-      ret = write(fd, str, strlen(str));
+      index = tcurses_vt100_getcolorindex(colors->fg_red, colors->fg_green,
+                                          colors->fg_blue);
+      if (index != priv->fg)
+        {
+          fg = index;
+        }
     }
 
   /* Test if BG color to be set */
@@ -936,20 +1152,46 @@ static int tcurses_vt100_setcolors(FAR struct termcurses_s *dev,
           colors->bg_red = 0;
         }
 
-      snprintf(str, sizeof(str), g_setbgcolor,
-               tcurses_vt100_getcolorindex(colors->bg_red, colors->bg_green,
-                                           colors->bg_blue));
-      ret = write(fd, str, strlen(str));
+      index = tcurses_vt100_getcolorindex(colors->bg_red, colors->bg_green,
+                                          colors->bg_blue);
+      if (index != priv->bg)
+        {
+          bg = index;
+        }
     }
 
-  /* If bytes written, return OK */
+  /* Send only the colors that differ from the terminal's, in one
+   * sequence when both do.
+   */
 
-  if (ret > 0)
+  if (fg >= 0 && bg >= 0)
+    {
+      len = snprintf(str, sizeof(str), g_setcolors, fg, bg);
+    }
+  else if (fg >= 0)
     {
-      ret = OK;
+      len = snprintf(str, sizeof(str), g_setfgcolor, fg);
+    }
+  else if (bg >= 0)
+    {
+      len = snprintf(str, sizeof(str), g_setbgcolor, bg);
+    }
+  else
+    {
+      return OK;
     }
 
-  return ret;
+  if (fg >= 0)
+    {
+      priv->fg = fg;
+    }
+
+  if (bg >= 0)
+    {
+      priv->bg = bg;
+    }
+
+  return tcurses_vt100_output(priv, str, len);
 }
 
 /****************************************************************************
@@ -975,10 +1217,17 @@ static int tcurses_vt100_getwinsize(FAR struct termcurses_s *dev,
   ret = ioctl(fd, TIOCGWINSZ, (unsigned long) winsz);
   if (ret == OK)
     {
+      priv->cols = winsz->ws_col;
       return OK;
     }
 
-  /* Write command to get window size */
+  /* Write command to get window size, after any pending output.  The
+   * query leaves the cursor in the lower right corner.
+   */
+
+  tcurses_vt100_drain(priv);
+  priv->row = -1;
+  priv->col = -1;
 
   ret = write(fd, g_getwinsize, strlen(g_getwinsize));
   if (ret <= 0)
@@ -1030,6 +1279,7 @@ static int tcurses_vt100_getwinsize(FAR struct termcurses_s *dev,
               if (ch == ';')
                 {
                   winsz->ws_col = atoi(&resp[x + 1]);
+                  priv->cols    = winsz->ws_col;
                 }
 
               /* Change back to original block/non-block mode */
@@ -1057,12 +1307,11 @@ static int tcurses_vt100_setattributes(FAR struct termcurses_s *dev,
                                        unsigned long attrib)
 {
   FAR struct tcurses_vt100_s *priv;
-  int ret;
-  int fd;
+  unsigned long changed;
+  int ret = OK;
   char str[48];
 
   priv = (FAR struct tcurses_vt100_s *)dev;
-  fd   = priv->out_fd;
 
   /* Test for cursor hide */
 
@@ -1070,55 +1319,78 @@ static int tcurses_vt100_setattributes(FAR struct termcurses_s *dev,
     {
       /* Send sequence to hide the cursor */
 
-      ret = write(fd, g_hidecursor, strlen(g_hidecursor));
+      if (priv->cursor != 0)
+        {
+          priv->cursor = 0;
+          ret = tcurses_vt100_output(priv, g_hidecursor,
+                                     strlen(g_hidecursor));
+        }
+
       return ret;
     }
 
   if (attrib & TCURS_ATTRIB_CURS_SHOW)
     {
-      /* Send sequence to hide the cursor */
+      /* Send sequence to show the cursor */
+
+      if (priv->cursor != 1)
+        {
+          priv->cursor = 1;
+          ret = tcurses_vt100_output(priv, g_showcursor,
+                                     strlen(g_showcursor));
+        }
 
-      ret = write(fd, g_showcursor, strlen(g_showcursor));
       return ret;
     }
 
-  /* Build attribute string */
+  /* Only the attributes that change are sent */
 
-  if (attrib & TCURS_ATTRIB_BOLD)
-    {
-      strlcpy(str, g_setbold, sizeof(str));
-    }
-  else
+  changed = priv->attrib < 0 ? ~0ul : attrib ^ priv->attrib;
+  priv->attrib = attrib;
+
+  if (changed & TCURS_ATTRIB_ALTCHARSET)
     {
-      strlcpy(str, g_setnobold, sizeof(str));
+      if (attrib & TCURS_ATTRIB_ALTCHARSET)
+        {
+          ret = tcurses_vt100_output(priv, g_setacs, strlen(g_setacs));
+        }
+      else
+        {
+          ret = tcurses_vt100_output(priv, g_setnoacs, strlen(g_setnoacs));
+        }
     }
 
-  if (attrib & TCURS_ATTRIB_BLINK)
+  /* Build attribute string */
+
+  str[0] = '\0';
+
+  if (changed & TCURS_ATTRIB_BOLD)
     {
-      strlcat(str, g_setblink, sizeof(str));
+      tcurses_vt100_sgrparam(str, sizeof(str),
+                             (attrib & TCURS_ATTRIB_BOLD) ?
+                             g_setbold : g_setnobold);
     }
-  else
+
+  if (changed & TCURS_ATTRIB_BLINK)
     {
-      strlcat(str, g_setnoblink, sizeof(str));
+      tcurses_vt100_sgrparam(str, sizeof(str),
+                             (attrib & TCURS_ATTRIB_BLINK) ?
+                             g_setblink : g_setnoblink);
     }
 
-  if (attrib & TCURS_ATTRIB_UNDERLINE)
+  if (changed & TCURS_ATTRIB_UNDERLINE)
     {
-      strlcat(str, g_setunderline, sizeof(str));
+      tcurses_vt100_sgrparam(str, sizeof(str),
+                             (attrib & TCURS_ATTRIB_UNDERLINE) ?
+                             g_setunderline : g_setnounderline);
     }
-  else
+
+  if (str[0] != '\0')
     {
-      strlcat(str, g_setnounderline, sizeof(str));
+      strlcat(str, "m", sizeof(str));
+      ret = tcurses_vt100_output(priv, str, strlen(str));
     }
 
-  strlcat(str, "m", sizeof(str));
-
-  ret = write(fd, str, strlen(str));
-
-  /* If bytes written, return OK */
-
-  ret = (ret > 0) ? OK : -ENOSYS;
-
   return ret;
 }
 
@@ -1162,6 +1434,10 @@ static int tcurses_vt100_getkeycode(FAR struct termcurses_s *dev,
   priv = (FAR struct tcurses_vt100_s *)dev;
   fd   = priv->in_fd;
 
+  /* Make sure the user sees everything before waiting for a key */
+
+  tcurses_vt100_drain(priv);
+
   /* Watch stdin (fd 0) to see when it has input. */
 
   FD_ZERO(&rfds);
@@ -1431,6 +1707,8 @@ static bool tcurses_vt100_checkkey(FAR struct termcurses_s *dev)
   priv = (FAR struct tcurses_vt100_s *)dev;
   fd   = priv->in_fd;
 
+  tcurses_vt100_drain(priv);
+
   /* Test for queued characters */
 
   if (priv->keycount > 0)
@@ -1457,6 +1735,54 @@ static bool tcurses_vt100_checkkey(FAR struct termcurses_s *dev)
   return false;
 }
 
+/****************************************************************************
+ * Output text at the cursor position
+ ****************************************************************************/
+
+static int tcurses_vt100_write(FAR struct termcurses_s *dev,
+                               FAR const char *buf, size_t len)
+{
+  FAR struct tcurses_vt100_s *priv;
+  size_t i;
+
+  priv = (FAR struct tcurses_vt100_s *)dev;
+
+  /* Follow the cursor.  Control characters and reaching the right margin,
+   * where terminals differ on auto-wrap, make its position unknown.
+   */
+
+  for (i = 0; i < len && priv->col >= 0; i++)
+    {
+      if ((uint8_t)buf[i] < ' ')
+        {
+          priv->col = -1;
+        }
+      else if ((buf[i] & 0xc0) != 0x80)
+        {
+          /* Not a UTF-8 continuation byte */
+
+          priv->col++;
+        }
+    }
+
+  if (priv->col < 0 || priv->col >= priv->cols)
+    {
+      priv->row = -1;
+      priv->col = -1;
+    }
+
+  return tcurses_vt100_output(priv, buf, len);
+}
+
+/****************************************************************************
+ * Send the buffered output to the terminal
+ ****************************************************************************/
+
+static int tcurses_vt100_flush(FAR struct termcurses_s *dev)
+{
+  return tcurses_vt100_drain((FAR struct tcurses_vt100_s *)dev);
+}
+
 /****************************************************************************
  * Public Functions
  ****************************************************************************/
@@ -1494,6 +1820,8 @@ FAR struct termcurses_s *tcurses_vt100_initialize(int in_fd, int out_fd)
   priv->out_fd   = out_fd;
   priv->keycount = 0;
 
+  tcurses_vt100_invalidate(priv);
+
       if (isatty(priv->in_fd))
         {
           if (tcgetattr(priv->in_fd, &cfg) == 0)
@@ -1535,16 +1863,20 @@ static int tcurses_vt100_terminate(FAR struct termcurses_s *dev)
 {
   FAR struct tcurses_vt100_s *priv;
   struct termios cfg;
-  int  fd;
 
   priv = (FAR struct tcurses_vt100_s *)dev;
-  fd   = priv->out_fd;
 
-  /* Set default foreground and background colors.
-   * (Ignore the return result.)
+  /* Leave the line drawing set and set default foreground and background
+   * colors.  (Ignore the return result.)
    */
 
-  write(fd, g_setdefcolors, strlen(g_setdefcolors));
+  if (priv->attrib > 0 && (priv->attrib & TCURS_ATTRIB_ALTCHARSET) != 0)
+    {
+      tcurses_vt100_output(priv, g_setnoacs, strlen(g_setnoacs));
+    }
+
+  tcurses_vt100_output(priv, g_setdefcolors, strlen(g_setdefcolors));
+  tcurses_vt100_drain(priv);
 
       if (isatty(priv->in_fd))
         {
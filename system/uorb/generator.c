@@ -27,6 +27,9 @@
 
 #include <ctype.h>
 #include <uORB/uORB.h>
+#ifdef CONFIG_UORB_BINLOG
+#  include <uORB/binlog.h>
+#endif
 
 /****************************************************************************
  * Pre-processor Definitions
@@ -70,6 +73,7 @@ generator <command> [arguments...]\n\
  when parameter 's' is used. default:10hz.\n\
 \t[-s <val> ]  Playback fake data.\n\
 \t[-t <val> ]  Playback topic.\n\
+\t[-c <dir> ]  Convert a binary log given by -f into text files in dir.\n\
 \t e.g.:\n\
 \t\tsim - sensor_accel0:\n\
 \t\t  uorb_generator -n 100 -r 5 -s -t sensor_accel0 timestamp:23191100,\
@@ -79,8 +83,14 @@ x:0.1,y:9.7,z:0.81,temperature:22.15\n\n\
 pressure:999.12,temperature:26.34\n\n\
 \t\tfiles - sensor_accel1\n\
 \t\t  uorb_generator -f /data/uorb/20240823061723/sensor_accel0.csv\
- -t sensor_accel1\
-\t\t\n\
+ -t sensor_accel1\n\n\
+\t\tbinary log - all topics, or only sensor_accel0 as sensor_accel1\n\
+\t\t  uorb_generator -f /data/uorb/20240823061723/record.bin\n\
+\t\t  uorb_generator -f /data/uorb/20240823061723/record.bin\
+ -t sensor_accel1\n\n\
+\t\tbinary log to text files\n\
+\t\t  uorb_generator -f /data/uorb/20240823061723/record.bin\
+ -c /data/uorb/20240823061723\n\
   ");
 }
 
@@ -245,6 +255,303 @@ out_line:
   return ret;
 }
 
+#ifdef CONFIG_UORB_BINLOG
+/****************************************************************************
+ * Name: replay_binary
+ *
+ * Description:
+ *   Play back a binary log.  Each sample is published at its recorded
+ *   time relative to the first sample, measured against the absolute
+ *   clock so that sleep overhead does not accumulate.  A topic is only
+ *   advertised when its first sample is due.
+ *
+ * Input Parameters:
+ *   reader     Binary log reader.
+ *   filter     If not NULL, only replay this topic, as this instance.
+ *
+ * Returned Value:
+ *   0 on success, otherwise negative errno.
+ ****************************************************************************/
+
+static int replay_binary(FAR struct uorb_binlog_reader_s *reader,
+                         FAR struct sensor_gen_info_s *filter)
+{
+  struct uorb_binlog_sample_s sample;
+  FAR const struct orb_metadata *meta;
+  FAR uint8_t *data = NULL;
+  size_t datasize = 0;
+  unsigned long npublished = 0;
+  uint64_t maxlag = 0;
+  uint64_t first = 0;
+  uint64_t start = 0;
+  uint64_t target;
+  uint64_t now;
+  FAR int *fds;
+  int instance;
+  int ret = 0;
+  int i;
+
+  fds = malloc(UORB_BINLOG_MAXTOPICS * sizeof(int));
+  if (fds == NULL)
+    {
+      return -ENOMEM;
+    }
+
+  for (i = 0; i < UORB_BINLOG_MAXTOPICS; i++)
+    {
+      fds[i] = -1;
+    }
+
+  while (!g_gen_should_exit &&
+         (ret = uorb_binlog_read(reader, &sample)) > 0)
+    {
+      meta = sample.topic->meta;
+      if (meta == NULL || (filter != NULL && filter->obj.meta != meta))
+        {
+          continue;
+        }
+
+      /* Topic structures start with a uint64_t timestamp, so the data
+       * must be aligned before it is handed out.
+       */
+
+      if (sample.size > datasize)
+        {
+          FAR uint8_t *tmp = realloc(data, sample.size);
+          if (tmp == NULL)
+            {
+              ret = -ENOMEM;
+              break;
+            }
+
+          data     = tmp;
+          datasize = sample.size;
+        }
+
+      memcpy(data, sample.data, sample.size);
+
+      now = orb_absolute_time();
+      if (npublished == 0)
+        {
+          first = sample.timestamp;
+          start = now;
+        }
+      else if (sample.timestamp > first)
+        {
+          target = start + (sample.timestamp - first);
+          if (target > now)
+            {
+              nxsig_usleep(target - now);
+              now = orb_absolute_time();
+            }
+
+          if (now > target && now - target > maxlag)
+            {
+              maxlag = now - target;
+            }
+        }
+
+      if (fds[sample.id] < 0)
+        {
+          instance = filter ? filter->obj.instance : sample.topic->instance;
+          fds[sample.id] = orb_advertise_multi_queue_persist(meta, data,
+                                                             &instance, 1);
+          if (fds[sample.id] < 0)
+            {
+              uorbinfo_raw("Playback orb advertise failed[%d]!",
+                           fds[sample.id]);
+              ret = fds[sample.id];
+              break;
+            }
+        }
+      else if (OK != orb_publish(meta, fds[sample.id], data))
+        {
+          uorbinfo_raw("Topic publish error!");
+          ret = ERROR;
+          break;
+        }
+
+      npublished++;
+    }
+
+  uorbinfo_raw("Replayed %lu samples in %" PRIu64 " ms, max lag %" PRIu64
+               " us", npublished,
+               npublished ? (orb_absolute_time() - start) / 1000 : 0,
+               maxlag);
+
+  for (i = 0; i < UORB_BINLOG_MAXTOPICS; i++)
+    {
+      if (fds[i] >= 0)
+        {
+          orb_unadvertise(fds[i]);
+        }
+    }
+
+  free(data);
+  free(fds);
+  return ret;
+}
+
+/****************************************************************************
+ * Name: convert_binary
+ *
+ * Description:
+ *   Convert a binary log into one text file per topic in the format
+ *   written by 'uorb_listener -s', one sample per line.  The format string
+ *   stored in the log is used, so topics that changed since the recording
+ *   are converted too.
+ *
+ * Input Parameters:
+ *   reader     Binary log reader.
+ *   outdir     Directory for the text files.
+ *
+ * Returned Value:
+ *   0 on success, otherwise negative errno.
+ ****************************************************************************/
+
+static int convert_binary(FAR struct uorb_binlog_reader_s *reader,
+                          FAR const char *outdir)
+{
+  struct uorb_binlog_sample_s sample;
+  FAR struct uorb_binlog_topic_s *topic;
+  FAR const char *format;
+  char path[PATH_MAX];
+  FAR uint8_t *data = NULL;
+  size_t datasize = 0;
+  unsigned long nconverted = 0;
+  FAR FILE **files;
+  int ret = 0;
+  int i;
+
+  files = calloc(UORB_BINLOG_MAXTOPICS, sizeof(FAR FILE *));
+  if (files == NULL)
+    {
+      return -ENOMEM;
+    }
+
+  while (!g_gen_should_exit &&
+         (ret = uorb_binlog_read(reader, &sample)) > 0)
+    {
+      topic  = sample.topic;
+      format = topic->format;
+      if (format == NULL && topic->meta != NULL)
+        {
+          format = topic->meta->o_format;
+        }
+
+      if (format == NULL)
+        {
+          continue;
+        }
+
+      if (files[sample.id] == NULL)
+        {
+          snprintf(path, sizeof(path), "%s/%s%d.csv", outdir, topic->name,
+                   topic->instance);
+          files[sample.id] = fopen(path, "w");
+          if (files[sample.id] == NULL)
+            {
+              ret = -errno;
+              uorbinfo_raw("Failed to create file:[%s]!", path);
+              break;
+            }
+
+          fprintf(files[sample.id], "%s,%d,%d,%s\n", format, topic->size,
+                  topic->instance, topic->name);
+          uorbinfo_raw("creat file:[%s]", path);
+        }
+
+      if (sample.size > datasize)
+        {
+          FAR uint8_t *tmp = realloc(data, sample.size);
+          if (tmp == NULL)
+            {
+              ret = -ENOMEM;
+              break;
+            }
+
+          data     = tmp;
+          datasize = sample.size;
+        }
+
+      memcpy(data, sample.data, sample.size);
+      orb_fprintf(files[sample.id], format, data);
+      fputc('\n', files[sample.id]);
+      nconverted++;
+    }
+
+  for (i = 0; i < UORB_BINLOG_MAXTOPICS; i++)
+    {
+      if (files[i] != NULL)
+        {
+          fclose(files[i]);
+        }
+    }
+
+  uorbinfo_raw("Converted %lu samples", nconverted);
+  free(data);
+  free(files);
+  return ret;
+}
+
+/****************************************************************************
+ * Name: binary_worker
+ *
+ * Description:
+ *   Replay or convert a binary log.
+ *
+ * Input Parameters:
+ *   path       Path of the log.
+ *   topic      Topic to replay, or NULL for all topics.
+ *   outdir     Convert to text files in this directory instead.
+ *
+ * Returned Value:
+ *   0 on success, -EINVAL if the file is not a binary log, otherwise
+ *   negative errno.
+ ****************************************************************************/
+
+static int binary_worker(FAR const char *path, FAR const char *topic,
+                         FAR const char *outdir)
+{
+  struct uorb_binlog_reader_s reader;
+  struct sensor_gen_info_s filter;
+  int ret;
+
+  if (topic != NULL && outdir == NULL)
+    {
+      ret = get_play_orb_id(topic, &filter);
+      if (ret < 0)
+        {
+          return ret;
+        }
+    }
+
+  ret = uorb_binlog_reader_open(&reader, path, 0);
+  if (ret < 0)
+    {
+      if (ret != -EINVAL || outdir != NULL)
+        {
+          uorbinfo_raw("Failed to open binary log:[%s] %d!", path, ret);
+          ret = ret == -EINVAL ? -ENOEXEC : ret;
+        }
+
+      return ret;
+    }
+
+  if (outdir != NULL)
+    {
+      ret = convert_binary(&reader, outdir);
+    }
+  else
+    {
+      ret = replay_binary(&reader, topic != NULL ? &filter : NULL);
+    }
+
+  uorb_binlog_reader_close(&reader);
+  return ret;
+}
+#endif
+
 /****************************************************************************
  * Name: fake_worker
  *
@@ -333,6 +640,7 @@ int main(int argc, FAR char *argv[])
   FAR char *filter = NULL;
   FAR char *topic  = NULL;
   FAR char *path   = NULL;
+  FAR char *outdir = NULL;
   int nb_cycle     = 1;
   bool sim         = false;
   int opt;
@@ -344,7 +652,7 @@ int main(int argc, FAR char *argv[])
       return 1;
     }
 
-  while ((opt = getopt(argc, argv, "f:t:r:n:sh")) != -1)
+  while ((opt = getopt(argc, argv, "f:t:r:n:c:sh")) != -1)
     {
       switch (opt)
         {
@@ -376,6 +684,12 @@ int main(int argc, FAR char *argv[])
             sim = true;
             break;
 
+#ifdef CONFIG_UORB_BINLOG
+          case 'c':
+            outdir = optarg;
+            break;
+#endif
+
           case 'h':
           default:
             goto error;
@@ -387,6 +701,21 @@ int main(int argc, FAR char *argv[])
       filter = argv[optind];
     }
 
+#ifdef CONFIG_UORB_BINLOG
+  /* Binary logs are recognized by their header, anything else is played
+   * back as text.
+   */
+
+  if (!sim && path != NULL)
+    {
+      ret = binary_worker(path, topic, outdir);
+      if (ret != -EINVAL)
+        {
+          return ret;
+        }
+    }
+#endif
+
   ret = get_play_orb_id(topic, &sensor_tmp);
   if (ret < 0)
     {
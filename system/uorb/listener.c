@@ -40,6 +40,9 @@
 #include <fcntl.h>
 
 #include <uORB/uORB.h>
+#ifdef CONFIG_UORB_BINLOG
+#  include <uORB/binlog.h>
+#endif
 
 /****************************************************************************
  * Pre-processor Definitions
@@ -48,6 +51,8 @@
 #define ORB_MAX_PRINT_NAME 32
 #define ORB_TOP_WAIT_TIME  1000
 #define ORB_DATA_DIR       "/data/uorb/"
+#define ORB_BINLOG_NAME    "record.bin"
+#define ORB_BINLOG_BATCH   16
 
 #if defined(CONFIG_UORB_FORMAT) && !defined(CONFIG_LIBC_FLOATINGPOINT)
 #error "Enable CONFIG_LIBC_FLOATINGPOINT, required to see debug output"
@@ -65,6 +70,9 @@ struct listen_object_s
   orb_abstime timestamp;    /* Time of last generation */
   unsigned long generation; /* Latest generation */
   FAR FILE *file;
+#ifdef CONFIG_UORB_BINLOG
+  int binid;                /* Topic id in the binary log */
+#endif
 };
 
 SLIST_HEAD(listen_list_s, listen_object_s);
@@ -84,7 +92,8 @@ static int listener_print(FAR const struct orb_metadata *meta, int fd);
 static void listener_monitor(FAR struct listen_list_s *objlist,
                              int nb_objects, float topic_rate,
                              int topic_latency, int nb_msgs,
-                             int timeout, bool record, bool nonwakeup);
+                             int timeout, bool record, bool binary,
+                             bool nonwakeup);
 static int listener_update(FAR struct listen_list_s *objlist,
                            FAR struct orb_object *object);
 static void listener_top(FAR struct listen_list_s *objlist,
@@ -131,6 +140,7 @@ listener <command> [arguments...]\n\
 \t<topics_name> Topic name. Multi name are separated by ','\n\
 \t[-h       ]  Listener commands help\n\
 \t[-s       ]  Record uorb data to file\n\
+\t[-B       ]  Record uorb data to a binary log (see uorb_generator)\n\
 \t[-n <val> ]  Number of messages, default: 0\n\
 \t[-r <val> ]  Subscription rate (unlimited if 0), default: 0\n\
 \t[-b <val> ]  Subscription maximum report latency in us(unlimited if 0),\n\
@@ -787,6 +797,54 @@ static int listener_record(FAR const struct orb_metadata *meta, int fd,
   return ret;
 }
 
+#ifdef CONFIG_UORB_BINLOG
+/****************************************************************************
+ * Name: listener_record_binary
+ *
+ * Description:
+ *   Drain all queued samples of one topic into the binary log.  Samples
+ *   are fetched in batches so that a high rate topic costs one read per
+ *   wakeup rather than one per sample.
+ *
+ * Input Parameters:
+ *   tmp      Topic object.
+ *   fd       Subscriber handle.
+ *   writer   Binary log writer.
+ *   buffer   Scratch buffer of ORB_BINLOG_BATCH samples.
+ *
+ * Returned Value:
+ *   Number of samples recorded, otherwise -1
+ ****************************************************************************/
+
+static int listener_record_binary(FAR struct listen_object_s *tmp, int fd,
+                                  FAR struct uorb_binlog_writer_s *writer,
+                                  FAR uint8_t *buffer)
+{
+  FAR const struct orb_metadata *meta = tmp->object.meta;
+  ssize_t nread;
+  int nsamples = 0;
+  int i;
+
+  do
+    {
+      nread = orb_copy_multi(fd, buffer, ORB_BINLOG_BATCH * meta->o_size);
+      if (nread < meta->o_size)
+        {
+          break;
+        }
+
+      for (i = 0; i + meta->o_size <= nread; i += meta->o_size)
+        {
+          uorb_binlog_write(writer, tmp->binid, buffer + i, meta->o_size);
+          nsamples++;
+        }
+    }
+  while (nread == ORB_BINLOG_BATCH * meta->o_size);
+
+  return nsamples > 0 ? nsamples : -1;
+}
+#endif
+
 /****************************************************************************
  * Name: listener_monitor
  *
@@ -800,6 +858,9 @@ static int listener_record(FAR const struct orb_metadata *meta, int fd,
  *   topic_latency  Subscribe report latency.
  *   nb_msgs        Subscribe amount of messages.
  *   timeout        Maximum poll waiting time(microseconds).
+ *   record         Record to text files.
+ *   binary         Record to a binary log.
+ *   nonwakeup      Subscribe in non-wakeup mode.
  *
  * Returned Value:
  *   None
@@ -808,7 +869,8 @@ static int listener_record(FAR const struct orb_metadata *meta, int fd,
 static void listener_monitor(FAR struct listen_list_s *objlist,
                              int nb_objects, float topic_rate,
                              int topic_latency, int nb_msgs,
-                             int timeout, bool record, bool nonwakeup)
+                             int timeout, bool record, bool binary,
+                             bool nonwakeup)
 {
   FAR struct pollfd *fds;
   char path[PATH_MAX];
@@ -817,6 +879,12 @@ static void listener_monitor(FAR struct listen_list_s *objlist,
   int nb_recv_msgs = 0;
   FAR char *dir;
   int i = 0;
+#ifdef CONFIG_UORB_BINLOG
+  struct uorb_binlog_writer_s writer;
+  FAR uint8_t *binbuf = NULL;
+  size_t maxsize = 0;
+  int ret;
+#endif
 
   FAR struct listen_object_s *tmp;
 
@@ -865,6 +933,45 @@ static void listener_monitor(FAR struct listen_list_s *objlist,
       i++;
     }
 
+#ifdef CONFIG_UORB_BINLOG
+  if (binary)
+    {
+      listener_create_dir(path, sizeof(path));
+      strlcat(path, ORB_BINLOG_NAME, sizeof(path));
+
+      SLIST_FOREACH(tmp, objlist, node)
+        {
+          if (tmp->object.meta->o_size > maxsize)
+            {
+              maxsize = tmp->object.meta->o_size;
+            }
+        }
+
+      binbuf = malloc(ORB_BINLOG_BATCH * maxsize);
+      ret = binbuf ? uorb_binlog_open(&writer, path, 0) : -ENOMEM;
+      if (ret < 0)
+        {
+          uorbinfo_raw("binary log creat failed![%s]:%d", path, ret);
+          free(binbuf);
+          binary = false;
+          goto out;
+        }
+
+      uorbinfo_raw("creat file:[%s]", path);
+      SLIST_FOREACH(tmp, objlist, node)
+        {
+          tmp->binid = uorb_binlog_add_topic(&writer, tmp->object.meta,
+                                             tmp->object.instance);
+          if (tmp->binid < 0)
+            {
+              uorbinfo_raw("binary log can't add %s%d:%d",
+                           tmp->object.meta->o_name, tmp->object.instance,
+                           tmp->binid);
+            }
+        }
+    }
+  else
+#endif
   if (record)
     {
       listener_create_dir(path, sizeof(path));
@@ -907,6 +1014,24 @@ static void listener_monitor(FAR struct listen_list_s *objlist,
                   nb_recv_msgs++;
                   recv_msgs[i]++;
 
+#ifdef CONFIG_UORB_BINLOG
+                  if (binary)
+                    {
+                      ret = tmp->binid < 0 ? -1 :
+                            listener_record_binary(tmp, fds[i].fd, &writer,
+                                                   binbuf);
+                      if (ret < 0)
+                        {
+                          orb_copy_multi(fds[i].fd, NULL, 0);
+                        }
+                      else
+                        {
+                          nb_recv_msgs += ret - 1;
+                          recv_msgs[i] += ret - 1;
+                        }
+                    }
+                  else
+#endif
                   if (tmp->file != NULL)
                     {
                       if (listener_record(tmp->object.meta, fds[i].fd,
@@ -941,6 +1066,9 @@ static void listener_monitor(FAR struct listen_list_s *objlist,
         }
     }
 
+#ifdef CONFIG_UORB_BINLOG
+out:
+#endif
   i = 0;
   SLIST_FOREACH(tmp, objlist, node)
     {
@@ -971,6 +1099,18 @@ static void listener_monitor(FAR struct listen_list_s *objlist,
       i++;
     }
 
+#ifdef CONFIG_UORB_BINLOG
+  if (binary)
+    {
+      ret = uorb_binlog_close(&writer);
+      uorbinfo_raw("Binary log: %lu records, %lu dropped, "
+                   "peak buffer %zu/%zu bytes%s",
+                   writer.nrecords, writer.ndropped, writer.peak,
+                   writer.bufsize, ret < 0 ? ", write error" : "");
+      free(binbuf);
+    }
+#endif
+
   uorbinfo_raw("Total number of received Message:%d/%d",
                nb_recv_msgs, nb_msgs ? nb_msgs : nb_recv_msgs);
   free(fds);
@@ -1080,6 +1220,7 @@ int main(int argc, FAR char *argv[])
   bool info         = false;
   bool flush        = false;
   bool record       = false;
+  bool binary       = false;
   bool nonwakeup    = false;
   bool only_once    = false;
   FAR char *filter  = NULL;
@@ -1094,7 +1235,7 @@ int main(int argc, FAR char *argv[])
 
   /* Pasrse Argument */
 
-  while ((ch = getopt(argc, argv, "r:b:n:t:Tfslhiu")) != EOF)
+  while ((ch = getopt(argc, argv, "r:b:n:t:TfsBlhiu")) != EOF)
     {
       switch (ch)
       {
@@ -1136,6 +1277,12 @@ int main(int argc, FAR char *argv[])
           break;
 #endif
 
+#ifdef CONFIG_UORB_BINLOG
+        case 'B':
+          binary = true;
+          break;
+#endif
+
         case 'f':
           flush = true;
           break;
@@ -1203,7 +1350,7 @@ int main(int argc, FAR char *argv[])
         }
 
       listener_monitor(&objlist, ret, topic_rate, topic_latency,
-                       nb_msgs, timeout, record, nonwakeup);
+                       nb_msgs, timeout, record, binary, nonwakeup);
     }
 
 exit:
@@ -0,0 +1,674 @@
+/****************************************************************************
+ * apps/system/uorb/uORB/binlog.c
+ *
+ * SPDX-License-Identifier: Apache-2.0
+ *
+ * Licensed to the Apache Software Foundation (ASF) under one or more
+ * contributor license agreements.  See the NOTICE file distributed with
+ * this work for additional information regarding copyright ownership.  The
+ * ASF licenses this file to you under the Apache License, Version 2.0 (the
+ * "License"); you may not use this file except in compliance with the
+ * License.  You may obtain a copy of the License at
+ *
+ *   http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS, WITHOUT
+ * WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.  See the
+ * License for the specific language governing permissions and limitations
+ * under the License.
+ *
+ ****************************************************************************/
+
+/****************************************************************************
+ * Included Files
+ ****************************************************************************/
+
+#include <errno.h>
+#include <fcntl.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+#include <unistd.h>
+
+#include <uORB/binlog.h>
+
+/****************************************************************************
+ * Pre-processor Definitions
+ ****************************************************************************/
+
+/* The writer thread wakes up when this much data is queued, or at least
+ * every UORB_BINLOG_FLUSH_MS milliseconds.
+ */
+
+#define UORB_BINLOG_FLUSH_MS    500
+#define UORB_BINLOG_WATERMARK(w) ((w)->bufsize / 4)
+
+/****************************************************************************
+ * Private Functions
+ ****************************************************************************/
+
+static void uorb_binlog_put16(FAR uint8_t *p, uint16_t v)
+{
+  p[0] = v & 0xff;
+  p[1] = v >> 8;
+}
+
+static void uorb_binlog_put32(FAR uint8_t *p, uint32_t v)
+{
+  uorb_binlog_put16(p, v & 0xffff);
+  uorb_binlog_put16(p + 2, v >> 16);
+}
+
+static uint16_t uorb_binlog_get16(FAR const uint8_t *p)
+{
+  return p[0] | ((uint16_t)p[1] << 8);
+}
+
+static uint32_t uorb_binlog_get32(FAR const uint8_t *p)
+{
+  return uorb_binlog_get16(p) | ((uint32_t)uorb_binlog_get16(p + 2) << 16);
+}
+
+static uint32_t uorb_binlog_fnv(uint32_t hash, FAR const void *data,
+                                size_t len)
+{
+  FAR const uint8_t *p = data;
+
+  while (len-- > 0)
+    {
+      hash ^= *p++;
+      hash *= 16777619u;
+    }
+
+  return hash;
+}
+
+/****************************************************************************
+ * Name: uorb_binlog_writeall
+ ****************************************************************************/
+
+static int uorb_binlog_writeall(int fd, FAR const uint8_t *buf, size_t len)
+{
+  ssize_t nwritten;
+
+  while (len > 0)
+    {
+      nwritten = write(fd, buf, len);
+      if (nwritten < 0)
+        {
+          if (errno == EINTR)
+            {
+              continue;
+            }
+
+          return -errno;
+        }
+
+      buf += nwritten;
+      len -= nwritten;
+    }
+
+  return 0;
+}
+
+/****************************************************************************
+ * Name: uorb_binlog_thread
+ *
+ * Description:
+ *   Drain the ring buffer to the file.  The lock is only held to pick up
+ *   the queued range and to release it again, so the capture loop keeps
+ *   running while the file system is busy.
+ ****************************************************************************/
+
+static FAR void *uorb_binlog_thread(FAR void *arg)
+{
+  FAR struct uorb_binlog_writer_s *writer = arg;
+  struct timespec abstime;
+  size_t tail;
+  size_t len;
+  int ret;
+
+  pthread_mutex_lock(&writer->lock);
+  for (; ; )
+    {
+      while (!writer->exit &&
+             writer->fill < UORB_BINLOG_WATERMARK(writer))
+        {
+          clock_gettime(CLOCK_REALTIME, &abstime);
+          abstime.tv_nsec += UORB_BINLOG_FLUSH_MS * 1000000l;
+          if (abstime.tv_nsec >= 1000000000l)
+            {
+              abstime.tv_sec++;
+              abstime.tv_nsec -= 1000000000l;
+            }
+
+          if (pthread_cond_timedwait(&writer->cond, &writer->lock,
+                                     &abstime) == ETIMEDOUT)
+            {
+              break;
+            }
+        }
+
+      if (writer->fill == 0)
+        {
+          if (writer->exit)
+            {
+              break;
+            }
+
+          continue;
+        }
+
+      /* Write the contiguous part of the queued data */
+
+      tail = writer->tail;
+      len  = writer->fill;
+      if (tail + len > writer->bufsize)
+        {
+          len = writer->bufsize - tail;
+        }
+
+      pthread_mutex_unlock(&writer->lock);
+      ret = uorb_binlog_writeall(writer->fd, writer->buf + tail, len);
+      pthread_mutex_lock(&writer->lock);
+
+      if (ret < 0 && writer->error == 0)
+        {
+          writer->error = ret;
+        }
+
+      writer->tail  = (tail + len) % writer->bufsize;
+      writer->fill -= len;
+    }
+
+  pthread_mutex_unlock(&writer->lock);
+  return NULL;
+}
+
+/****************************************************************************
+ * Name: uorb_binlog_queue
+ *
+ * Description:
+ *   Append one record to the ring buffer.  Called with the lock held.
+ ****************************************************************************/
+
+static int uorb_binlog_queue(FAR struct uorb_binlog_writer_s *writer,
+                             uint8_t type, uint8_t id,
+                             FAR const void *data1, size_t len1,
+                             FAR const void *data2, size_t len2)
+{
+  FAR const uint8_t *src[3];
+  uint8_t hdr[UORB_BINLOG_RECLEN];
+  size_t len[3];
+  size_t chunk;
+  size_t n;
+  int i;
+
+  if (writer->fill + sizeof(hdr) + len1 + len2 > writer->bufsize)
+    {
+      writer->ndropped++;
+      return -ENOSPC;
+    }
+
+  hdr[0] = type;
+  hdr[1] = id;
+  uorb_binlog_put16(&hdr[2], len1 + len2);
+
+  src[0] = hdr;
+  len[0] = sizeof(hdr);
+  src[1] = data1;
+  len[1] = len1;
+  src[2] = data2;
+  len[2] = len2;
+
+  for (i = 0; i < 3; i++)
+    {
+      n = len[i];
+      while (n > 0)
+        {
+          chunk = writer->bufsize - writer->head;
+          if (chunk > n)
+            {
+              chunk = n;
+            }
+
+          memcpy(writer->buf + writer->head, src[i] + len[i] - n, chunk);
+          writer->head = (writer->head + chunk) % writer->bufsize;
+          n -= chunk;
+        }
+
+      writer->fill += len[i];
+    }
+
+  if (writer->fill > writer->peak)
+    {
+      writer->peak = writer->fill;
+    }
+
+  writer->nrecords++;
+  if (writer->fill >= UORB_BINLOG_WATERMARK(writer))
+    {
+      pthread_cond_signal(&writer->cond);
+    }
+
+  return 0;
+}
+
+/****************************************************************************
+ * Name: uorb_binlog_fill
+ *
+ * Description:
+ *   Make sure at least len bytes are available at reader->pos, compacting
+ *   and growing the buffer as needed.
+ *
+ * Returned Value:
+ *   1 if the bytes are available, 0 at a clean end of file, otherwise
+ *   negative errno.
+ ****************************************************************************/
+
+static int uorb_binlog_fill(FAR struct uorb_binlog_reader_s *reader,
+                            size_t len)
+{
+  FAR uint8_t *buf;
+  ssize_t nread;
+
+  while (reader->len - reader->pos < len)
+    {
+      if (reader->pos > 0)
+        {
+          memmove(reader->buf, reader->buf + reader->pos,
+                  reader->len - reader->pos);
+          reader->len -= reader->pos;
+          reader->pos  = 0;
+        }
+
+      if (len > reader->bufsize)
+        {
+          buf = realloc(reader->buf, len);
+          if (buf == NULL)
+            {
+              return -ENOMEM;
+            }
+
+          reader->buf     = buf;
+          reader->bufsize = len;
+        }
+
+      nread = read(reader->fd, reader->buf + reader->len,
+                   reader->bufsize - reader->len);
+      if (nread < 0)
+        {
+          if (errno == EINTR)
+            {
+              continue;
+            }
+
+          return -errno;
+        }
+      else if (nread == 0)
+        {
+          /* A partial record at the end is what an interrupted capture
+           * leaves behind, so it is not treated as an error.
+           */
+
+          return 0;
+        }
+
+      reader->len += nread;
+    }
+
+  return 1;
+}
+
+/****************************************************************************
+ * Name: uorb_binlog_parse_topic
+ ****************************************************************************/
+
+static int uorb_binlog_parse_topic(FAR struct uorb_binlog_reader_s *reader,
+                                   uint8_t id, FAR const uint8_t *payload,
+                                   uint16_t size)
+{
+  FAR struct uorb_binlog_topic_s *topic;
+  uint16_t fmtlen;
+  uint8_t namelen;
+
+  if (size < UORB_BINLOG_TOPICLEN || id >= UORB_BINLOG_MAXTOPICS)
+    {
+      return -EINVAL;
+    }
+
+  namelen = payload[7];
+  fmtlen  = uorb_binlog_get16(&payload[8]);
+  if (namelen >= ORB_PATH_MAX ||
+      UORB_BINLOG_TOPICLEN + namelen + fmtlen > size)
+    {
+      return -EINVAL;
+    }
+
+  topic = reader->topics[id];
+  if (topic == NULL)
+    {
+      topic = calloc(1, sizeof(*topic));
+      if (topic == NULL)
+        {
+          return -ENOMEM;
+        }
+
+      reader->topics[id] = topic;
+    }
+  else
+    {
+      free(topic->format);
+      topic->format = NULL;
+    }
+
+  topic->hash     = uorb_binlog_get32(&payload[0]);
+  topic->size     = uorb_binlog_get16(&payload[4]);
+  topic->instance = payload[6];
+
+  payload += UORB_BINLOG_TOPICLEN;
+  memcpy(topic->name, payload, namelen);
+  topic->name[namelen] = '\0';
+
+  if (fmtlen > 0)
+    {
+      topic->format = malloc(fmtlen + 1);
+      if (topic->format == NULL)
+        {
+          return -ENOMEM;
+        }
+
+      memcpy(topic->format, payload + namelen, fmtlen);
+      topic->format[fmtlen] = '\0';
+    }
+
+  /* Only bind to the local metadata if the layout is unchanged */
+
+  topic->meta = orb_get_meta(topic->name);
+  if (topic->meta != NULL &&
+      (topic->meta->o_size != topic->size ||
+       uorb_binlog_hash(topic->meta) != topic->hash))
+    {
+      uorbinfo_raw("Topic %s layout changed since recording, ignored",
+                   topic->name);
+      topic->meta = NULL;
+    }
+
+  return 0;
+}
+
+/****************************************************************************
+ * Public Functions
+ ****************************************************************************/
+
+uint32_t uorb_binlog_hash(FAR const struct orb_metadata *meta)
+{
+  uint32_t hash = 2166136261u;
+  uint8_t size[2];
+
+  uorb_binlog_put16(size, meta->o_size);
+  hash = uorb_binlog_fnv(hash, meta->o_name, strlen(meta->o_name));
+  hash = uorb_binlog_fnv(hash, size, sizeof(size));
+#ifdef CONFIG_UORB_FORMAT
+  if (meta->o_format != NULL)
+    {
+      hash = uorb_binlog_fnv(hash, meta->o_format, strlen(meta->o_format));
+    }
+#endif
+
+  return hash;
+}
+
+int uorb_binlog_open(FAR struct uorb_binlog_writer_s *writer,
+                     FAR const char *path, size_t bufsize)
+{
+  uint8_t hdr[UORB_BINLOG_HEADERLEN];
+  int ret;
+
+  memset(writer, 0, sizeof(*writer));
+  writer->bufsize = bufsize ? bufsize : CONFIG_UORB_BINLOG_BUFSIZE;
+  writer->buf = malloc(writer->bufsize);
+  if (writer->buf == NULL)
+    {
+      return -ENOMEM;
+    }
+
+  writer->fd = open(path, O_WRONLY | O_CREAT | O_TRUNC | O_CLOEXEC, 0666);
+  if (writer->fd < 0)
+    {
+      ret = -errno;
+      goto errout_with_buf;
+    }
+
+  memcpy(hdr, UORB_BINLOG_MAGIC, UORB_BINLOG_MAGICLEN);
+  hdr[UORB_BINLOG_MAGICLEN] = UORB_BINLOG_VERSION;
+  ret = uorb_binlog_writeall(writer->fd, hdr, sizeof(hdr));
+  if (ret < 0)
+    {
+      goto errout_with_fd;
+    }
+
+  pthread_mutex_init(&writer->lock, NULL);
+  pthread_cond_init(&writer->cond, NULL);
+
+  ret = pthread_create(&writer->thread, NULL, uorb_binlog_thread, writer);
+  if (ret != 0)
+    {
+      pthread_cond_destroy(&writer->cond);
+      pthread_mutex_destroy(&writer->lock);
+      ret = -ret;
+      goto errout_with_fd;
+    }
+
+  pthread_setname_np(writer->thread, "uorb_binlog");
+  return 0;
+
+errout_with_fd:
+  close(writer->fd);
+errout_with_buf:
+  free(writer->buf);
+  writer->buf = NULL;
+  return ret;
+}
+
+int uorb_binlog_add_topic(FAR struct uorb_binlog_writer_s *writer,
+                          FAR const struct orb_metadata *meta,
+                          uint8_t instance)
+{
+  uint8_t topic[UORB_BINLOG_TOPICLEN + ORB_PATH_MAX];
+  FAR const char *format = NULL;
+  size_t namelen;
+  size_t fmtlen = 0;
+  int ret;
+
+  if (writer->ntopics >= UORB_BINLOG_MAXTOPICS)
+    {
+      return -E2BIG;
+    }
+
+  namelen = strlen(meta->o_name);
+  if (namelen >= ORB_PATH_MAX)
+    {
+      return -ENAMETOOLONG;
+    }
+
+#ifdef CONFIG_UORB_FORMAT
+  format = meta->o_format;
+  if (format != NULL)
+    {
+      fmtlen = strlen(format);
+    }
+#endif
+
+  uorb_binlog_put32(&topic[0], uorb_binlog_hash(meta));
+  uorb_binlog_put16(&topic[4], meta->o_size);
+  topic[6] = instance;
+  topic[7] = namelen;
+  uorb_binlog_put16(&topic[8], fmtlen);
+  memcpy(&topic[UORB_BINLOG_TOPICLEN], meta->o_name, namelen);
+
+  pthread_mutex_lock(&writer->lock);
+  ret = uorb_binlog_queue(writer, UORB_BINLOG_TYPE_TOPIC, writer->ntopics,
+                          topic, UORB_BINLOG_TOPICLEN + namelen,
+                          format, fmtlen);
+  if (ret >= 0)
+    {
+      ret = writer->ntopics++;
+    }
+
+  pthread_mutex_unlock(&writer->lock);
+  return ret;
+}
+
+int uorb_binlog_write(FAR struct uorb_binlog_writer_s *writer, uint8_t id,
+                      FAR const void *data, uint16_t size)
+{
+  int ret;
+
+  pthread_mutex_lock(&writer->lock);
+  ret = uorb_binlog_queue(writer, UORB_BINLOG_TYPE_DATA, id,
+                          data, size, NULL, 0);
+  pthread_mutex_unlock(&writer->lock);
+  return ret;
+}
+
+int uorb_binlog_close(FAR struct uorb_binlog_writer_s *writer)
+{
+  int ret;
+
+  pthread_mutex_lock(&writer->lock);
+  writer->exit = true;
+  pthread_cond_signal(&writer->cond);
+  pthread_mutex_unlock(&writer->lock);
+
+  pthread_join(writer->thread, NULL);
+  pthread_cond_destroy(&writer->cond);
+  pthread_mutex_destroy(&writer->lock);
+
+  ret = writer->error;
+  if (fsync(writer->fd) < 0 && ret == 0)
+    {
+      ret = -errno;
+    }
+
+  close(writer->fd);
+  free(writer->buf);
+  writer->buf = NULL;
+  return ret;
+}
+
+int uorb_binlog_reader_open(FAR struct uorb_binlog_reader_s *reader,
+                            FAR const char *path, size_t bufsize)
+{
+  int ret;
+
+  memset(reader, 0, sizeof(*reader));
+  reader->bufsize = bufsize ? bufsize : CONFIG_UORB_BINLOG_BUFSIZE;
+  reader->buf = malloc(reader->bufsize);
+  if (reader->buf == NULL)
+    {
+      return -ENOMEM;
+    }
+
+  reader->fd = open(path, O_RDONLY | O_CLOEXEC);
+  if (reader->fd < 0)
+    {
+      ret = -errno;
+      free(reader->buf);
+      return ret;
+    }
+
+  ret = uorb_binlog_fill(reader, UORB_BINLOG_HEADERLEN);
+  if (ret <= 0 ||
+      memcmp(reader->buf, UORB_BINLOG_MAGIC, UORB_BINLOG_MAGICLEN) != 0 ||
+      reader->buf[UORB_BINLOG_MAGICLEN] != UORB_BINLOG_VERSION)
+    {
+      uorb_binlog_reader_close(reader);
+      return ret < 0 ? ret : -EINVAL;
+    }
+
+  reader->pos = UORB_BINLOG_HEADERLEN;
+  return 0;
+}
+
+int uorb_binlog_read(FAR struct uorb_binlog_reader_s *reader,
+                     FAR struct uorb_binlog_sample_s *sample)
+{
+  FAR const uint8_t *rec;
+  uint16_t size;
+  uint8_t type;
+  uint8_t id;
+  int ret;
+
+  for (; ; )
+    {
+      ret = uorb_binlog_fill(reader, UORB_BINLOG_RECLEN);
+      if (ret <= 0)
+        {
+          return ret;
+        }
+
+      rec  = reader->buf + reader->pos;
+      type = rec[0];
+      id   = rec[1];
+      size = uorb_binlog_get16(&rec[2]);
+
+      ret = uorb_binlog_fill(reader, UORB_BINLOG_RECLEN + size);
+      if (ret <= 0)
+        {
+          return ret;
+        }
+
+      rec = reader->buf + reader->pos;
+      reader->pos += UORB_BINLOG_RECLEN + size;
+      rec += UORB_BINLOG_RECLEN;
+
+      if (type == UORB_BINLOG_TYPE_TOPIC)
+        {
+          ret = uorb_binlog_parse_topic(reader, id, rec, size);
+          if (ret < 0)
+            {
+              return ret;
+            }
+        }
+      else if (type == UORB_BINLOG_TYPE_DATA && id < UORB_BINLOG_MAXTOPICS &&
+               reader->topics[id] != NULL &&
+               size == reader->topics[id]->size &&
+               size >= sizeof(uint64_t))
+        {
+          sample->id    = id;
+          sample->topic = reader->topics[id];
+          sample->data  = rec;
+          sample->size  = size;
+
+          /* The payload is the raw native structure, so its leading
+           * timestamp is in host byte order.
+           */
+
+          memcpy(&sample->timestamp, rec, sizeof(sample->timestamp));
+          return 1;
+        }
+
+      /* Unknown record types and data of undeclared topics are skipped */
+    }
+}
+
+void uorb_binlog_reader_close(FAR struct uorb_binlog_reader_s *reader)
+{
+  int i;
+
+  for (i = 0; i < UORB_BINLOG_MAXTOPICS; i++)
+    {
+      if (reader->topics[i] != NULL)
+        {
+          free(reader->topics[i]->format);
+          free(reader->topics[i]);
+          reader->topics[i] = NULL;
+        }
+    }
+
+  close(reader->fd);
+  free(reader->buf);
+  reader->buf = NULL;
+}
@@ -0,0 +1,257 @@
+/****************************************************************************
+ * apps/system/uorb/uORB/binlog.h
+ *
+ * SPDX-License-Identifier: Apache-2.0
+ *
+ * Licensed to the Apache Software Foundation (ASF) under one or more
+ * contributor license agreements.  See the NOTICE file distributed with
+ * this work for additional information regarding copyright ownership.  The
+ * ASF licenses this file to you under the Apache License, Version 2.0 (the
+ * "License"); you may not use this file except in compliance with the
+ * License.  You may obtain a copy of the License at
+ *
+ *   http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS, WITHOUT
+ * WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.  See the
+ * License for the specific language governing permissions and limitations
+ * under the License.
+ *
+ ****************************************************************************/
+
+#ifndef __APP_SYSTEM_UORB_UORB_BINLOG_H
+#define __APP_SYSTEM_UORB_UORB_BINLOG_H
+
+/****************************************************************************
+ * Included Files
+ ****************************************************************************/
+
+#include <pthread.h>
+#include <stddef.h>
+#include <stdint.h>
+#include <stdbool.h>
+
+#include <uORB/uORB.h>
+
+/****************************************************************************
+ * Pre-processor Definitions
+ ****************************************************************************/
+
+#ifndef CONFIG_UORB_BINLOG_BUFSIZE
+#  define CONFIG_UORB_BINLOG_BUFSIZE 16384
+#endif
+
+/* Binary log layout (all fields little-endian):
+ *
+ *   File header:  "uORBlog" magic (7 bytes) + version (1 byte)
+ *   Record:       type (1 byte) + topic id (1 byte) + payload size
+ *                 (2 bytes), followed by the payload.
+ *
+ * A topic record must precede the first data record of its topic id.  Its
+ * payload is the metadata hash (4 bytes), o_size (2 bytes), instance
+ * (1 byte), name length (1 byte), format length (2 bytes), then the name
+ * and the format string without terminators.
+ *
+ * A data record's payload is the raw o_size topic structure, whose leading
+ * uint64_t field is the sample timestamp.
+ */
+
+#define UORB_BINLOG_MAGIC       "uORBlog"
+#define UORB_BINLOG_MAGICLEN    7
+#define UORB_BINLOG_VERSION     1
+#define UORB_BINLOG_HEADERLEN   8
+
+#define UORB_BINLOG_RECLEN      4
+#define UORB_BINLOG_TOPICLEN    10
+#define UORB_BINLOG_MAXTOPICS   255
+
+#define UORB_BINLOG_TYPE_TOPIC  'T'
+#define UORB_BINLOG_TYPE_DATA   'D'
+
+/****************************************************************************
+ * Public Types
+ ****************************************************************************/
+
+/* Buffered writer.  Samples are copied into a ring buffer by the capture
+ * loop and written to the file in large chunks by a separate thread, so
+ * that slow storage never stalls the subscriber.
+ */
+
+struct uorb_binlog_writer_s
+{
+  int             fd;          /* Output file */
+  uint8_t         ntopics;     /* Topic ids handed out so far */
+  bool            exit;        /* Ask the writer thread to drain and exit */
+  int             error;       /* First write error seen by the thread */
+  FAR uint8_t    *buf;         /* Ring buffer */
+  size_t          bufsize;     /* Size of the ring buffer */
+  size_t          head;        /* Producer position */
+  size_t          tail;        /* Consumer position */
+  size_t          fill;        /* Bytes queued in the ring */
+  size_t          peak;        /* High-water mark of fill */
+  unsigned long   nrecords;    /* Records queued */
+  unsigned long   ndropped;    /* Records dropped on overflow */
+  pthread_mutex_t lock;
+  pthread_cond_t  cond;
+  pthread_t       thread;
+};
+
+/* Topic described by a topic record */
+
+struct uorb_binlog_topic_s
+{
+  uint32_t                       hash;     /* Metadata hash at record time */
+  uint16_t                       size;     /* Recorded o_size */
+  uint8_t                        instance; /* Recorded instance */
+  FAR const struct orb_metadata *meta;     /* Local metadata, or NULL */
+  FAR char                      *format;   /* Recorded format, or NULL */
+  char                           name[ORB_PATH_MAX];
+};
+
+/* Streaming reader */
+
+struct uorb_binlog_reader_s
+{
+  int          fd;         /* Input file */
+  FAR uint8_t *buf;        /* Read buffer */
+  size_t       bufsize;    /* Size of the read buffer */
+  size_t       pos;        /* Next unread byte in buf */
+  size_t       len;        /* Valid bytes in buf */
+  FAR struct uorb_binlog_topic_s *topics[UORB_BINLOG_MAXTOPICS];
+};
+
+/* One data sample returned by the reader */
+
+struct uorb_binlog_sample_s
+{
+  uint8_t                         id;    /* Topic id */
+  FAR struct uorb_binlog_topic_s *topic; /* Topic description */
+  uint64_t                        timestamp;
+  FAR const uint8_t              *data;  /* Raw topic data (unaligned) */
+  uint16_t                        size;  /* Size of data */
+};
+
+/****************************************************************************
+ * Public Function Prototypes
+ ****************************************************************************/
+
+#ifdef __cplusplus
+#define EXTERN extern "C"
+extern "C"
+{
+#else
+#define EXTERN extern
+#endif
+
+/****************************************************************************
+ * Name: uorb_binlog_hash
+ *
+ * Description:
+ *   Compute the hash identifying a topic layout: its name, size and, when
+ *   available, its format string.
+ *
+ ****************************************************************************/
+
+uint32_t uorb_binlog_hash(FAR const struct orb_metadata *meta);
+
+/****************************************************************************
+ * Name: uorb_binlog_open
+ *
+ * Description:
+ *   Create a binary log and start its writer thread.
+ *
+ * Input Parameters:
+ *   writer   Writer state to initialize.
+ *   path     Output file path.
+ *   bufsize  Size of the ring buffer, 0 for CONFIG_UORB_BINLOG_BUFSIZE.
+ *
+ * Returned Value:
+ *   0 on success, otherwise negative errno.
+ ****************************************************************************/
+
+int uorb_binlog_open(FAR struct uorb_binlog_writer_s *writer,
+                     FAR const char *path, size_t bufsize);
+
+/****************************************************************************
+ * Name: uorb_binlog_add_topic
+ *
+ * Description:
+ *   Emit a topic record.
+ *
+ * Returned Value:
+ *   Topic id to pass to uorb_binlog_write() on success, otherwise negative
+ *   errno.
+ ****************************************************************************/
+
+int uorb_binlog_add_topic(FAR struct uorb_binlog_writer_s *writer,
+                          FAR const struct orb_metadata *meta,
+                          uint8_t instance);
+
+/****************************************************************************
+ * Name: uorb_binlog_write
+ *
+ * Description:
+ *   Queue one sample.  Never blocks on storage: if the ring buffer is full
+ *   the sample is dropped and counted.
+ *
+ * Returned Value:
+ *   0 on success, -ENOSPC if the sample was dropped.
+ ****************************************************************************/
+
+int uorb_binlog_write(FAR struct uorb_binlog_writer_s *writer, uint8_t id,
+                      FAR const void *data, uint16_t size);
+
+/****************************************************************************
+ * Name: uorb_binlog_close
+ *
+ * Description:
+ *   Flush all queued records, stop the writer thread and close the file.
+ *
+ * Returned Value:
+ *   0 on success, otherwise the first write error as negative errno.
+ ****************************************************************************/
+
+int uorb_binlog_close(FAR struct uorb_binlog_writer_s *writer);
+
+/****************************************************************************
+ * Name: uorb_binlog_reader_open
+ *
+ * Description:
+ *   Open a binary log for reading and check its header.
+ *
+ * Returned Value:
+ *   0 on success, -EINVAL if the file is not a binary log, otherwise
+ *   negative errno.
+ ****************************************************************************/
+
+int uorb_binlog_reader_open(FAR struct uorb_binlog_reader_s *reader,
+                            FAR const char *path, size_t bufsize);
+
+/****************************************************************************
+ * Name: uorb_binlog_read
+ *
+ * Description:
+ *   Return the next data sample.  Topic records are consumed internally
+ *   and exposed through sample->topic.  The returned data pointer is valid
+ *   until the next call.
+ *
+ * Returned Value:
+ *   1 if a sample was returned, 0 at end of file, otherwise negative errno.
+ ****************************************************************************/
+
+int uorb_binlog_read(FAR struct uorb_binlog_reader_s *reader,
+                     FAR struct uorb_binlog_sample_s *sample);
+
+/****************************************************************************
+ * Name: uorb_binlog_reader_close
+ ****************************************************************************/
+
+void uorb_binlog_reader_close(FAR struct uorb_binlog_reader_s *reader);
+
+#undef EXTERN
+#ifdef __cplusplus
+}
+#endif
+
+#endif /* __APP_SYSTEM_UORB_UORB_BINLOG_H */
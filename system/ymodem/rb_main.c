@@ -27,12 +27,24 @@
 #include <fcntl.h>
 #include <stdio.h>
 #include <getopt.h>
+#include <inttypes.h>
 #include <pthread.h>
+#include <time.h>
 
 #include <nuttx/circbuf.h>
 
 #include "ymodem.h"
 
+/****************************************************************************
+ * Pre-processor Definitions
+ ****************************************************************************/
+
+/* YMODEM-G cannot pause the sender while a file write stalls, so streaming
+ * always writes behind with at least this much buffer.
+ */
+
+#define YMODEM_STREAMING_BUFSIZE (32 * 1024)
+
 /****************************************************************************
  * Private Types
  ****************************************************************************/
@@ -42,6 +54,7 @@ struct ymodem_priv_s
   int fd;
   FAR char *foldname;
   size_t file_saved_size;
+  size_t total_size;
   FAR char *skip_prefix;
   FAR char *skip_suffix;
   FAR char *prepend_prefix;
@@ -56,59 +69,100 @@ struct ymodem_priv_s
   size_t threshold;
   pthread_t pid;
   bool exited;
+  bool flush;    /* Write out everything buffered */
+  int error;     /* Write error of the write behind */
 };
 
 /****************************************************************************
  * Private Functions
  ****************************************************************************/
 
-static int flush_data(FAR struct ymodem_priv_s *priv)
+static int write_all(int fd, FAR const uint8_t *data, size_t size)
 {
-  while (priv->fd > 0 && circbuf_used(&priv->circ))
-    {
-      FAR uint8_t *buffer;
-      size_t i = 0;
-      size_t size;
+  size_t i = 0;
 
-      buffer = circbuf_get_readptr(&priv->circ, &size);
-      while (i < size)
+  while (i < size)
+    {
+      ssize_t ret = write(fd, data + i, size - i);
+      if (ret < 0)
         {
-          ssize_t ret = write(priv->fd, buffer + i, size - i);
-          if (ret < 0)
-            {
-              return -errno;
-            }
-
-          i += ret;
+          return -errno;
         }
 
-      circbuf_readcommit(&priv->circ, size);
+      i += ret;
     }
 
   return 0;
 }
 
+static int flush_data(FAR struct ymodem_priv_s *priv)
+{
+  int ret;
+
+  /* Wait for the write behind to write everything buffered */
+
+  pthread_mutex_lock(&priv->mutex);
+  priv->flush = true;
+  pthread_cond_broadcast(&priv->cond);
+  while (circbuf_used(&priv->circ) > 0 && priv->error == 0)
+    {
+      pthread_cond_wait(&priv->cond, &priv->mutex);
+    }
+
+  priv->flush = false;
+  ret = priv->error;
+  pthread_mutex_unlock(&priv->mutex);
+  return ret;
+}
+
 static FAR void *async_write(FAR void *arg)
 {
   FAR struct ymodem_priv_s *priv = arg;
 
   pthread_mutex_lock(&priv->mutex);
-  while (priv->exited == false)
+  for (; ; )
     {
-      if (circbuf_used(&priv->circ) <= priv->threshold)
-        {
-          pthread_cond_wait(&priv->cond, &priv->mutex);
-          continue;
-        }
+      FAR uint8_t *buffer;
+      size_t used;
+      size_t size;
+      int ret;
 
-      if (flush_data(priv) < 0)
+      used = circbuf_used(&priv->circ);
+      if (priv->error == 0 && used > 0 &&
+          (used > priv->threshold || circbuf_is_full(&priv->circ) ||
+           priv->flush || priv->exited))
         {
+          /* Write without holding the lock, so that the receiver keeps
+           * buffering packets meanwhile.
+           */
+
+          buffer = circbuf_get_readptr(&priv->circ, &size);
           pthread_mutex_unlock(&priv->mutex);
-          return NULL;
+
+          ret = write_all(priv->fd, buffer, size);
+
+          pthread_mutex_lock(&priv->mutex);
+          if (ret < 0)
+            {
+              priv->error = ret;
+            }
+          else
+            {
+              circbuf_readcommit(&priv->circ, size);
+            }
+
+          pthread_cond_broadcast(&priv->cond);
+        }
+      else if (priv->exited)
+        {
+          break;
+        }
+      else
+        {
+          pthread_cond_wait(&priv->cond, &priv->mutex);
         }
     }
 
-  flush_data(priv);
   pthread_mutex_unlock(&priv->mutex);
   return NULL;
 }
@@ -123,7 +177,16 @@ static int write_data(FAR struct ymodem_priv_s *priv,
       pthread_mutex_lock(&priv->mutex);
       while (i < size)
         {
-          ssize_t ret = circbuf_write(&priv->circ, data + i, size - i);
+          ssize_t ret;
+
+          if (priv->error < 0)
+            {
+              ret = priv->error;
+              pthread_mutex_unlock(&priv->mutex);
+              return ret;
+            }
+
+          ret = circbuf_write(&priv->circ, data + i, size - i);
           if (ret < 0)
             {
               pthread_mutex_unlock(&priv->mutex);
@@ -131,12 +194,10 @@ static int write_data(FAR struct ymodem_priv_s *priv,
             }
           else if (ret == 0)
             {
-              ret = flush_data(priv);
-              if (ret < 0)
-                {
-                  pthread_mutex_unlock(&priv->mutex);
-                  return ret;
-                }
+              /* Full, wait for the write behind to make room */
+
+              pthread_cond_broadcast(&priv->cond);
+              pthread_cond_wait(&priv->cond, &priv->mutex);
             }
           else
             {
@@ -146,23 +207,14 @@ static int write_data(FAR struct ymodem_priv_s *priv,
 
       if (circbuf_used(&priv->circ) > priv->threshold)
         {
-          pthread_cond_signal(&priv->cond);
+          pthread_cond_broadcast(&priv->cond);
         }
 
       pthread_mutex_unlock(&priv->mutex);
     }
   else
     {
-      while (i < size)
-        {
-          ssize_t ret = write(priv->fd, data + i, size - i);
-          if (ret < 0)
-            {
-              return -errno;
-            }
-
-          i += ret;
-        }
+      return write_all(priv->fd, data, size);
     }
 
   return 0;
@@ -182,9 +234,7 @@ static int handler(FAR struct ymodem_ctx_s *ctx)
         {
           if (priv->buffersize)
             {
-              pthread_mutex_lock(&priv->mutex);
               ret = flush_data(priv);
-              pthread_mutex_unlock(&priv->mutex);
               if (ret < 0)
                 {
                   return ret;
@@ -269,6 +319,7 @@ static int handler(FAR struct ymodem_ctx_s *ctx)
         }
 
       priv->file_saved_size += size;
+      priv->total_size += size;
     }
 
   return 0;
@@ -330,6 +381,27 @@ static void async_uninit(FAR struct ymodem_priv_s *priv)
   circbuf_uninit(&priv->circ);
 }
 
+static void show_speed(FAR struct ymodem_priv_s *priv,
+                       FAR const struct timespec *start, bool streaming)
+{
+  struct timespec end;
+  uint64_t msec;
+
+  clock_gettime(CLOCK_MONOTONIC, &end);
+  msec = (end.tv_sec - start->tv_sec) * 1000ull +
+         end.tv_nsec / 1000000 - start->tv_nsec / 1000000;
+  if (msec == 0)
+    {
+      msec = 1;
+    }
+
+  printf("received %zu bytes in %" PRIu64 ".%03" PRIu64 " s, "
+         "%" PRIu64 " KiB/s%s\n", priv->total_size,
+         msec / 1000, msec % 1000,
+         (uint64_t)priv->total_size * 1000 / msec / 1024,
+         streaming ? " (YMODEM-G)" : "");
+}
+
 static void show_usage(FAR const char *progname)
 {
   fprintf(stderr, "USAGE: %s [OPTIONS]\n", progname);
@@ -348,6 +420,10 @@ static void show_usage(FAR const char *progname)
           "\t-e|--prepend_prefix <prefix>: prepend file name a prefix\n");
   fprintf(stderr,
           "\t-a|--append_suffix <suffix>: append file name a suffix\n");
+  fprintf(stderr,
+          "\t-g|--streaming: Ask the sender for YMODEM-G streaming, for "
+          "error free links only. Buffers at least %dkB\n",
+          YMODEM_STREAMING_BUFSIZE / 1024);
   fprintf(stderr,
           "\t-b|--buffersize <size>: Asynchronously receive buffer size."
           "If greater than 0, accept data asynchronously, Default: 0kB\n");
@@ -374,6 +450,7 @@ int main(int argc, FAR char *argv[])
 {
   struct ymodem_priv_s priv;
   struct ymodem_ctx_s ctx;
+  struct timespec start;
   FAR char *devname = NULL;
   size_t len;
   int ret;
@@ -388,6 +465,7 @@ int main(int argc, FAR char *argv[])
       {"threshold", 1, NULL, 't'},
       {"interval", 1, NULL, 'i'},
       {"retry", 1, NULL, 'r'},
+      {"streaming", 0, NULL, 'g'},
     };
 
   memset(&priv, 0, sizeof(priv));
@@ -396,7 +474,7 @@ int main(int argc, FAR char *argv[])
   memset(&ctx, 0, sizeof(ctx));
   ctx.interval = 15;
   ctx.retry = 100;
-  while ((ret = getopt_long(argc, argv, "b:d:f:hk:p:s:t:i:r:e:a:",
+  while ((ret = getopt_long(argc, argv, "b:d:f:ghk:p:s:t:i:r:e:a:",
                             options, NULL)) != ERROR)
     {
       switch (ret)
@@ -415,6 +493,9 @@ int main(int argc, FAR char *argv[])
                 priv.foldname[len - 1] = '\0';
               }
 
+            break;
+          case 'g':
+            ctx.streaming = true;
             break;
           case 'h':
             show_usage(argv[0]);
@@ -451,6 +532,11 @@ int main(int argc, FAR char *argv[])
         }
     }
 
+  if (ctx.streaming && priv.buffersize < YMODEM_STREAMING_BUFSIZE)
+    {
+      priv.buffersize = YMODEM_STREAMING_BUFSIZE;
+    }
+
   if (priv.buffersize && (priv.threshold > priv.buffersize ||
                           ctx.custom_size > priv.buffersize))
     {
@@ -485,7 +571,12 @@ int main(int argc, FAR char *argv[])
       ctx.sendfd = STDOUT_FILENO;
     }
 
+  clock_gettime(CLOCK_MONOTONIC, &start);
   ret = ymodem_recv(&ctx);
+  if (ret >= 0 && devname != NULL)
+    {
+      show_speed(&priv, &start, ctx.streaming);
+    }
   if (ctx.recvfd > 0)
     {
       close(ctx.recvfd);
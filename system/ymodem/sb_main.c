@@ -27,8 +27,10 @@
 #include <fcntl.h>
 #include <stdio.h>
 #include <getopt.h>
+#include <inttypes.h>
 #include <libgen.h>
 #include <pthread.h>
+#include <time.h>
 #include <sys/stat.h>
 
 #include <nuttx/circbuf.h>
@@ -44,6 +46,7 @@ struct ymodem_priv_s
   int fd;
   FAR char **filelist;
   size_t filenum;
+  size_t total_size;
 
   /* Async */
 
@@ -53,6 +56,9 @@ struct ymodem_priv_s
   size_t buffersize;
   pthread_t pid;
   bool exited;
+  bool busy;     /* The read ahead is reading the file */
+  bool eof;      /* The read ahead reached the end of the file */
+  int error;     /* Read error of the read ahead */
 };
 
 /****************************************************************************
@@ -67,25 +73,44 @@ static FAR void *async_read(FAR void *arg)
   while (priv->exited == false)
     {
       FAR uint8_t *buffer;
-      ssize_t ret = 0;
+      ssize_t ret;
       size_t size;
+      int fd;
 
-      if (priv->fd > 0)
+      if (priv->fd <= 0 || priv->eof || circbuf_is_full(&priv->circ))
         {
-          buffer = circbuf_get_writeptr(&priv->circ, &size);
-          ret = read(priv->fd, buffer, size);
-          if (ret < 0)
-            {
-              break;
-            }
+          pthread_cond_wait(&priv->cond, &priv->mutex);
+          continue;
+        }
 
-          circbuf_writecommit(&priv->circ, ret);
+      /* Read into the free space without holding the lock, so that the
+       * sender keeps taking the data already buffered meanwhile.
+       */
+
+      buffer = circbuf_get_writeptr(&priv->circ, &size);
+      fd = priv->fd;
+      priv->busy = true;
+      pthread_mutex_unlock(&priv->mutex);
+
+      ret = read(fd, buffer, size);
+      if (ret < 0)
+        {
+          ret = -errno;
         }
 
-      if (circbuf_is_full(&priv->circ) || priv->fd <= 0 || ret == 0)
+      pthread_mutex_lock(&priv->mutex);
+      priv->busy = false;
+      if (ret > 0)
         {
-          pthread_cond_wait(&priv->cond, &priv->mutex);
+          circbuf_writecommit(&priv->circ, ret);
+        }
+      else
+        {
+          priv->eof = true;
+          priv->error = ret;
         }
+
+      pthread_cond_broadcast(&priv->cond);
     }
 
   pthread_mutex_unlock(&priv->mutex);
@@ -110,20 +135,25 @@ static int read_data(FAR struct ymodem_priv_s *priv,
               return ret;
             }
 
-          if (ret == 0)
+          if (ret > 0)
             {
-              ret = read(priv->fd, data + i, size - i);
-              if (ret < 0)
-                {
-                  pthread_mutex_unlock(&priv->mutex);
-                  return -errno;
-                }
+              i += ret;
+              pthread_cond_broadcast(&priv->cond);
             }
+          else if (priv->eof)
+            {
+              /* The file is shorter than it was when the transfer started */
 
-          i += ret;
+              ret = priv->error < 0 ? priv->error : -EIO;
+              pthread_mutex_unlock(&priv->mutex);
+              return ret;
+            }
+          else
+            {
+              pthread_cond_wait(&priv->cond, &priv->mutex);
+            }
         }
 
-      pthread_cond_signal(&priv->cond);
       pthread_mutex_unlock(&priv->mutex);
     }
   else
@@ -144,6 +174,36 @@ static int read_data(FAR struct ymodem_priv_s *priv,
   return 0;
 }
 
+static void close_file(FAR struct ymodem_priv_s *priv)
+{
+  if (priv->buffersize)
+    {
+      /* Take the file away from the read ahead once it is not reading */
+
+      pthread_mutex_lock(&priv->mutex);
+      while (priv->busy)
+        {
+          pthread_cond_wait(&priv->cond, &priv->mutex);
+        }
+
+      if (priv->fd > 0)
+        {
+          close(priv->fd);
+          priv->fd = 0;
+        }
+
+      circbuf_reset(&priv->circ);
+      priv->eof = false;
+      priv->error = 0;
+      pthread_mutex_unlock(&priv->mutex);
+    }
+  else if (priv->fd > 0)
+    {
+      close(priv->fd);
+      priv->fd = 0;
+    }
+}
+
 static int handler(FAR struct ymodem_ctx_s *ctx)
 {
   FAR struct ymodem_priv_s *priv = ctx->priv;
@@ -153,12 +213,9 @@ static int handler(FAR struct ymodem_ctx_s *ctx)
     {
       FAR char *filename;
       struct stat st;
+      int fd;
 
-      if (priv->fd > 0)
-        {
-          close(priv->fd);
-          priv->fd = 0;
-        }
+      close_file(priv);
 
       filename = priv->filelist[priv->filenum++];
       if (filename == NULL)
@@ -172,12 +229,26 @@ static int handler(FAR struct ymodem_ctx_s *ctx)
           return -errno;
         }
 
-      priv->fd = open(filename, O_RDONLY);
-      if (priv->fd < 0)
+      fd = open(filename, O_RDONLY);
+      if (fd < 0)
         {
           return -errno;
         }
 
+      /* Hand the new file to the read ahead */
+
+      if (priv->buffersize)
+        {
+          pthread_mutex_lock(&priv->mutex);
+          priv->fd = fd;
+          pthread_cond_broadcast(&priv->cond);
+          pthread_mutex_unlock(&priv->mutex);
+        }
+      else
+        {
+          priv->fd = fd;
+        }
+
       filename = basename(filename);
       strlcpy(ctx->file_name, filename, PATH_MAX);
       ctx->file_length = st.st_size;
@@ -204,6 +275,7 @@ static int handler(FAR struct ymodem_ctx_s *ctx)
         }
 
       ctx->file_length -= size;
+      priv->total_size += size;
     }
 
   return 0;
@@ -265,6 +337,27 @@ static void async_uninit(FAR struct ymodem_priv_s *priv)
   circbuf_uninit(&priv->circ);
 }
 
+static void show_speed(FAR struct ymodem_priv_s *priv,
+                       FAR const struct timespec *start, bool streaming)
+{
+  struct timespec end;
+  uint64_t msec;
+
+  clock_gettime(CLOCK_MONOTONIC, &end);
+  msec = (end.tv_sec - start->tv_sec) * 1000ull +
+         end.tv_nsec / 1000000 - start->tv_nsec / 1000000;
+  if (msec == 0)
+    {
+      msec = 1;
+    }
+
+  printf("sent %zu bytes in %" PRIu64 ".%03" PRIu64 " s, "
+         "%" PRIu64 " KiB/s%s\n", priv->total_size,
+         msec / 1000, msec % 1000,
+         (uint64_t)priv->total_size * 1000 / msec / 1024,
+         streaming ? " (YMODEM-G)" : "");
+}
+
 static void show_usage(FAR const char *progname)
 {
   fprintf(stderr, "USAGE: %s [OPTIONS] <lname> [<lname> [<lname> ...]]\n",
@@ -297,6 +390,7 @@ int main(int argc, FAR char *argv[])
 {
   struct ymodem_priv_s priv;
   struct ymodem_ctx_s ctx;
+  struct timespec start;
   FAR char *devname = NULL;
   int ret = 0;
   struct option options[] =
@@ -378,7 +472,12 @@ int main(int argc, FAR char *argv[])
         }
     }
 
+  clock_gettime(CLOCK_MONOTONIC, &start);
   ret = ymodem_send(&ctx);
+  if (ret >= 0 && devname != NULL)
+    {
+      show_speed(&priv, &start, ctx.streaming);
+    }
 
   if (priv.buffersize)
     {
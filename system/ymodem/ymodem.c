@@ -31,6 +31,7 @@
 #include <stdlib.h>
 #include <string.h>
 #include <termios.h>
+#include <poll.h>
 
 #include <nuttx/crc16.h>
 
@@ -61,6 +62,7 @@
 #define NAK           0x15  /* Negative acknowledge */
 #define CAN           0x18  /* Two of these in succession aborts transfer */
 #define CRC           0x43  /* 'C' == 0x43, request 16-bit CRC */
+#define WANTG         0x47  /* 'G' == 0x47, request YMODEM-G streaming */
 
 /****************************************************************************
  * Private Functions
@@ -190,12 +192,21 @@ static int ymodem_recv_file(FAR struct ymodem_ctx_s *ctx)
 {
   FAR char *str = NULL;
   uint32_t total_seq = 0;
+  uint8_t start = ctx->streaming ? WANTG : CRC;
+  uint8_t cmd = start;
+  bool streaming = false;
   int retries = 0;
   int ret;
 
-  ctx->header[0] = CRC;
 recv_packet:
-  ymodem_send_buffer(ctx, ctx->header, 1);
+
+  /* Reply to the previous packet, nothing while streaming with YMODEM-G */
+
+  if (cmd != 0)
+    {
+      ymodem_send_buffer(ctx, &cmd, 1);
+    }
+
   ret = ymodem_recv_packet(ctx);
   if (ret == -ECANCELED)
     {
@@ -204,11 +215,12 @@ recv_packet:
     }
   else if (ret == -EAGAIN)
     {
-      ctx->header[0] = ACK;
-      ymodem_send_buffer(ctx, ctx->header, 1);
+      cmd = ACK;
+      ymodem_send_buffer(ctx, &cmd, 1);
       ymodem_debug("recv_file: finished one file transfer\n");
-      ctx->header[0] = CRC;
+      cmd = start;
       total_seq = 0;
+      streaming = false;
       goto recv_packet;
     }
   else if (ret < 0)
@@ -216,6 +228,15 @@ recv_packet:
       /* other errors, like ETIMEDOUT, EILSEQ, EBADMSG... */
 
       tcflush(ctx->recvfd, TCIOFLUSH);
+      if (streaming)
+        {
+          /* YMODEM-G has no retransmission, the transfer failed */
+
+          ymodem_debug("recv_file: error %d while streaming, cancel!!\n",
+                       ret);
+          goto cancel;
+        }
+
       if (++retries > ctx->retry)
         {
           ymodem_debug("recv_file: too many errors, cancel!!\n");
@@ -224,7 +245,7 @@ recv_packet:
 
       /* Use str to mask transfer start */
 
-      ctx->header[0] = str ? NAK : CRC;
+      cmd = str ? NAK : start;
       goto recv_packet;
     }
 
@@ -234,14 +255,26 @@ recv_packet:
                    "been received, continue %" PRIu32 " %u\n", total_seq,
                    ctx->header[1]);
 
-      ctx->header[0] = ACK;
+      if (streaming)
+        {
+          ret = -EILSEQ;
+          goto cancel;
+        }
+
+      cmd = ACK;
       goto recv_packet;
     }
   else if ((total_seq & 0xff) != ctx->header[1])
     {
       ymodem_debug("recv_file: total seq error:%" PRIu32 " %u\n", total_seq,
                    ctx->header[1]);
-      ctx->header[0] = CRC;
+      if (streaming)
+        {
+          ret = -EILSEQ;
+          goto cancel;
+        }
+
+      cmd = start;
       goto recv_packet;
     }
 
@@ -256,8 +289,8 @@ recv_packet:
           /* Last file done, so the session also finished */
 
           ymodem_debug("recv_file: session finished\n");
-          ctx->header[0] = ACK;
-          ymodem_send_buffer(ctx, ctx->header, 1);
+          cmd = ACK;
+          ymodem_send_buffer(ctx, &cmd, 1);
           return 0;
         }
 
@@ -276,9 +309,18 @@ recv_packet:
           goto cancel;
         }
 
-      ctx->header[0] = ACK;
-      ymodem_send_buffer(ctx, ctx->header, 1);
-      ctx->header[0] = CRC;
+      /* YMODEM-G does not acknowledge the file name packet either, the
+       * next 'G' starts the data.
+       */
+
+      if (!ctx->streaming)
+        {
+          cmd = ACK;
+          ymodem_send_buffer(ctx, &cmd, 1);
+        }
+
+      cmd = start;
+      streaming = ctx->streaming;
       total_seq++;
       goto recv_packet;
     }
@@ -293,16 +335,16 @@ recv_packet:
       goto cancel;
     }
 
-  ctx->header[0] = ACK;
+  cmd = streaming ? 0 : ACK;
   total_seq++;
   ymodem_debug("recv_file: recv data success\n");
   retries = 0;
   goto recv_packet;
 
 cancel:
-  ctx->header[0] = CAN;
-  ymodem_send_buffer(ctx, ctx->header, 1);
-  ymodem_send_buffer(ctx, ctx->header, 1);
+  cmd = CAN;
+  ymodem_send_buffer(ctx, &cmd, 1);
+  ymodem_send_buffer(ctx, &cmd, 1);
   ymodem_debug("recv_file: cancel command sent to sender\n");
   return ret;
 }
@@ -334,6 +376,77 @@ static int ymodem_recv_cmd(FAR struct ymodem_ctx_s *ctx, uint8_t cmd)
   return 0;
 }
 
+static int ymodem_recv_start(FAR struct ymodem_ctx_s *ctx)
+{
+  uint8_t recv;
+  int ret;
+
+  /* 'C' starts a packet sequence with an ACK per packet, 'G' starts a
+   * YMODEM-G stream.
+   */
+
+  ret = ymodem_recv_buffer(ctx, &recv, 1);
+  if (ret == 0 && recv == ACK && ctx->streaming)
+    {
+      /* lrzsz acknowledges the name packet in YMODEM-G mode as well */
+
+      ret = ymodem_recv_buffer(ctx, &recv, 1);
+    }
+
+  if (ret < 0)
+    {
+      ymodem_debug("recv start error\n");
+      return ret;
+    }
+
+  if (recv == NAK)
+    {
+      return -EAGAIN;
+    }
+
+  if (recv != CRC && recv != WANTG)
+    {
+      ymodem_debug("recv start error, receive 0x%x\n", recv);
+      return -EINVAL;
+    }
+
+  ctx->streaming = recv == WANTG;
+  return 0;
+}
+
+static int ymodem_check_cancel(FAR struct ymodem_ctx_s *ctx)
+{
+  struct pollfd fds;
+  uint8_t recv;
+  int ret;
+
+  /* While streaming the receiver only talks to abort the transfer, look
+   * for that without waiting.
+   */
+
+  fds.fd = ctx->recvfd;
+  fds.events = POLLIN;
+  fds.revents = 0;
+  if (poll(&fds, 1, 0) <= 0)
+    {
+      return 0;
+    }
+
+  ret = ymodem_recv_buffer(ctx, &recv, 1);
+  if (ret < 0)
+    {
+      return ret;
+    }
+
+  if (recv == CAN)
+    {
+      ymodem_debug("stream canceled by receiver\n");
+      return -ECANCELED;
+    }
+
+  return 0;
+}
+
 static int ymodem_send_file(FAR struct ymodem_ctx_s *ctx)
 {
   uint16_t crc;
@@ -343,7 +456,7 @@ static int ymodem_send_file(FAR struct ymodem_ctx_s *ctx)
   ymodem_debug("waiting handshake\n");
   for (retries = 0; retries < ctx->retry; retries++)
     {
-      ret = ymodem_recv_cmd(ctx, CRC);
+      ret = ymodem_recv_start(ctx);
       if (ret >= 0)
         {
           break;
@@ -356,7 +469,8 @@ static int ymodem_send_file(FAR struct ymodem_ctx_s *ctx)
       return -ETIMEDOUT;
     }
 
-  ymodem_debug("ymodem send file start\n");
+  ymodem_debug("ymodem send file start%s\n",
+               ctx->streaming ? ", YMODEM-G" : "");
 send_start:
   ctx->packet_type = YMODEM_FILENAME_PACKET;
   ret = ctx->packet_handler(ctx);
@@ -385,20 +499,27 @@ send_name:
       return ret;
     }
 
-  ret = ymodem_recv_cmd(ctx, ACK);
-  if (ret == -EAGAIN)
-    {
-      ymodem_debug("send name packet recv NAK, need send again\n");
-      goto send_name;
-    }
+  /* With YMODEM-G the 'G' that starts the data is the answer, an ACK
+   * before it is dropped by ymodem_recv_start().
+   */
 
-  if (ret < 0)
+  if (!ctx->streaming)
     {
-      ymodem_debug("send name packet, recv error cmd\n");
-      return ret;
+      ret = ymodem_recv_cmd(ctx, ACK);
+      if (ret == -EAGAIN)
+        {
+          ymodem_debug("send name packet recv NAK, need send again\n");
+          goto send_name;
+        }
+
+      if (ret < 0)
+        {
+          ymodem_debug("send name packet, recv error cmd\n");
+          return ret;
+        }
     }
 
-  ret = ymodem_recv_cmd(ctx, CRC);
+  ret = ymodem_recv_start(ctx);
   if (ret == -EAGAIN)
     {
       ymodem_debug("send name packet recv NAK, need send again\n");
@@ -449,6 +570,19 @@ send_packet_again:
       return ret;
     }
 
+  if (ctx->streaming)
+    {
+      /* YMODEM-G: no ACK, keep streaming unless the receiver gave up */
+
+      ret = ymodem_check_cancel(ctx);
+      if (ret < 0)
+        {
+          return ret;
+        }
+
+      goto send_next;
+    }
+
   ret = ymodem_recv_cmd(ctx, ACK);
   if (ret == -EAGAIN)
     {
@@ -462,6 +596,7 @@ send_packet_again:
       return ret;
     }
 
+send_next:
   if (ctx->file_length != 0)
     {
       ymodem_debug("The remain bytes sent are %zu\n", ctx->file_length);
@@ -490,7 +625,7 @@ send_eot:
       return ret;
     }
 
-  ret = ymodem_recv_cmd(ctx, CRC);
+  ret = ymodem_recv_start(ctx);
   if (ret == -EAGAIN)
     {
       ymodem_debug("send EOT recv NAK, need send again\n");
@@ -523,6 +658,11 @@ send_last_again:
       return ret;
     }
 
+  if (ctx->streaming)
+    {
+      return 0;
+    }
+
   ret = ymodem_recv_cmd(ctx, ACK);
   if (ret == -EAGAIN)
     {
@@ -27,6 +27,7 @@
  * Included Files
  ****************************************************************************/
 
+#include <stdbool.h>
 #include <stddef.h>
 
 /****************************************************************************
@@ -55,6 +56,12 @@ struct ymodem_ctx_s
   uint8_t interval;
   int retry;
 
+  /* Receiver: ask for YMODEM-G streaming, no per packet ACK.  Sender: set
+   * when the receiver asked for it.
+   */
+
+  bool streaming;
+
   /* Public data */
 
   FAR uint8_t *data;
@@ -0,0 +1,296 @@
+/****************************************************************************
+ * apps/system/zmodem/host/zmpty.c
+ *
+ * SPDX-License-Identifier: Apache-2.0
+ *
+ * Licensed to the Apache Software Foundation (ASF) under one or more
+ * contributor license agreements.  See the NOTICE file distributed with
+ * this work for additional information regarding copyright ownership.  The
+ * ASF licenses this file to you under the Apache License, Version 2.0 (the
+ * "License"); you may not use this file except in compliance with the
+ * License.  You may obtain a copy of the License at
+ *
+ *   http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS, WITHOUT
+ * WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.  See the
+ * License for the specific language governing permissions and limitations
+ * under the License.
+ *
+ ****************************************************************************/
+
+/* Throughput test for the host sz and rz: both run on the two ends of a
+ * pair of pseudo terminals that this program links together, optionally
+ * throttled to a given line rate.
+ *
+ *   zmpty [-b bytes/s] [-r rzdir] <sz> <rz> <file>
+ */
+
+/****************************************************************************
+ * Included Files
+ ****************************************************************************/
+
+#define _GNU_SOURCE 1
+
+#include <errno.h>
+#include <fcntl.h>
+#include <signal.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <sys/select.h>
+#include <sys/stat.h>
+#include <sys/wait.h>
+#include <termios.h>
+#include <time.h>
+#include <unistd.h>
+
+/****************************************************************************
+ * Pre-processor Definitions
+ ****************************************************************************/
+
+#define ZMPTY_BUFSIZE 4096
+
+/****************************************************************************
+ * Private Types
+ ****************************************************************************/
+
+struct zmpty_s
+{
+  int master;                   /* Our end of the pty */
+  int slave;                    /* Kept open so reads never see EIO */
+  char name[32];                /* Slave device for sz or rz */
+};
+
+/****************************************************************************
+ * Private Functions
+ ****************************************************************************/
+
+static int zmpty_open(struct zmpty_s *pty)
+{
+  struct termios tio;
+
+  pty->master = posix_openpt(O_RDWR | O_NOCTTY);
+  if (pty->master < 0 || grantpt(pty->master) < 0 ||
+      unlockpt(pty->master) < 0 ||
+      ptsname_r(pty->master, pty->name, sizeof(pty->name)) != 0)
+    {
+      perror("pty");
+      return -1;
+    }
+
+  pty->slave = open(pty->name, O_RDWR | O_NOCTTY);
+  if (pty->slave < 0)
+    {
+      perror(pty->name);
+      return -1;
+    }
+
+  tcgetattr(pty->slave, &tio);
+  cfmakeraw(&tio);
+  tcsetattr(pty->slave, TCSANOW, &tio);
+  return 0;
+}
+
+static pid_t zmpty_spawn(char *const argv[])
+{
+  pid_t pid = fork();
+
+  if (pid == 0)
+    {
+      execv(argv[0], argv);
+      perror(argv[0]);
+      _exit(127);
+    }
+
+  return pid;
+}
+
+static double zmpty_now(void)
+{
+  struct timespec ts;
+
+  clock_gettime(CLOCK_MONOTONIC, &ts);
+  return ts.tv_sec + ts.tv_nsec / 1e9;
+}
+
+/* Move what is available from one master to the other.  With a rate limit
+ * at most the bytes earned since the start are moved.
+ */
+
+static int zmpty_relay(int from, int to, long rate, double start,
+                       unsigned long *total)
+{
+  char buf[ZMPTY_BUFSIZE];
+  size_t len = sizeof(buf);
+  ssize_t nread;
+  ssize_t nwritten;
+  size_t off;
+
+  if (rate > 0)
+    {
+      double allowed = (zmpty_now() - start) * rate - *total;
+
+      if (allowed < 1)
+        {
+          return 0;
+        }
+
+      if (allowed < len)
+        {
+          len = allowed;
+        }
+    }
+
+  nread = read(from, buf, len);
+  if (nread <= 0)
+    {
+      return nread < 0 && errno != EAGAIN && errno != EINTR ? -1 : 0;
+    }
+
+  for (off = 0; off < (size_t)nread; off += nwritten)
+    {
+      nwritten = write(to, buf + off, nread - off);
+      if (nwritten < 0)
+        {
+          if (errno == EINTR || errno == EAGAIN)
+            {
+              nwritten = 0;
+              continue;
+            }
+
+          return -1;
+        }
+    }
+
+  *total += nread;
+  return nread;
+}
+
+/****************************************************************************
+ * Public Functions
+ ****************************************************************************/
+
+int main(int argc, char *argv[])
+{
+  struct zmpty_s sz;
+  struct zmpty_s rz;
+  struct timeval tv;
+  struct stat st;
+  unsigned long tosz = 0;
+  unsigned long torz = 0;
+  const char *rzdir = "/tmp";
+  char *szargv[5];
+  char *rzargv[6];
+  double start;
+  double elapsed;
+  fd_set rfds;
+  long rate = 0;
+  pid_t szpid;
+  pid_t rzpid;
+  int running = 2;
+  int status;
+  int ret = EXIT_SUCCESS;
+  int opt;
+
+  while ((opt = getopt(argc, argv, "b:r:")) != -1)
+    {
+      switch (opt)
+        {
+          case 'b':
+            rate = atol(optarg);
+            break;
+
+          case 'r':
+            rzdir = optarg;
+            break;
+
+          default:
+            goto usage;
+        }
+    }
+
+  if (argc - optind != 3 || argv[optind + 2][0] != '/' ||
+      stat(argv[optind + 2], &st) < 0)
+    {
+usage:
+      fprintf(stderr, "usage: %s [-b bytes/s] [-r rzdir] <sz> <rz> "
+                      "</absolute/file>\n", argv[0]);
+      return EXIT_FAILURE;
+    }
+
+  if (zmpty_open(&sz) < 0 || zmpty_open(&rz) < 0)
+    {
+      return EXIT_FAILURE;
+    }
+
+  fcntl(sz.master, F_SETFL, O_NONBLOCK);
+  fcntl(rz.master, F_SETFL, O_NONBLOCK);
+
+  rzargv[0] = argv[optind + 1];
+  rzargv[1] = "-d";
+  rzargv[2] = rz.name;
+  rzargv[3] = "-p";
+  rzargv[4] = (char *)rzdir;
+  rzargv[5] = NULL;
+
+  szargv[0] = argv[optind];
+  szargv[1] = "-d";
+  szargv[2] = sz.name;
+  szargv[3] = argv[optind + 2];
+  szargv[4] = NULL;
+
+  start = zmpty_now();
+  rzpid = zmpty_spawn(rzargv);
+  szpid = zmpty_spawn(szargv);
+
+  while (running > 0)
+    {
+      FD_ZERO(&rfds);
+      FD_SET(sz.master, &rfds);
+      FD_SET(rz.master, &rfds);
+      tv.tv_sec = 0;
+      tv.tv_usec = rate > 0 ? 1000 : 100000;
+
+      if (select(rz.master > sz.master ? rz.master + 1 : sz.master + 1,
+                 &rfds, NULL, NULL, &tv) > 0)
+        {
+          if (FD_ISSET(sz.master, &rfds))
+            {
+              zmpty_relay(sz.master, rz.master, rate, start, &torz);
+            }
+
+          if (FD_ISSET(rz.master, &rfds))
+            {
+              zmpty_relay(rz.master, sz.master, 0, start, &tosz);
+            }
+        }
+
+      while (running > 0 && waitpid(-1, &status, WNOHANG) > 0)
+        {
+          if (!WIFEXITED(status) || WEXITSTATUS(status) != 0)
+            {
+              ret = EXIT_FAILURE;
+            }
+
+          running--;
+        }
+
+      if (zmpty_now() - start > 600)
+        {
+          fprintf(stderr, "timed out\n");
+          kill(szpid, SIGKILL);
+          kill(rzpid, SIGKILL);
+          return EXIT_FAILURE;
+        }
+    }
+
+  elapsed = zmpty_now() - start;
+  printf("%s: %ld bytes in %.3f s, %.1f KiB/s (line %lu bytes, "
+         "back channel %lu bytes)%s\n",
+         argv[optind + 2], (long)st.st_size, elapsed,
+         st.st_size / elapsed / 1024, torz, tosz,
+         ret == EXIT_SUCCESS ? "" : ", FAILED");
+  return ret;
+}
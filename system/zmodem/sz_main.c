@@ -263,9 +263,19 @@ errout_with_zmodem:
 
 errout_with_device:
 
-  /* Flush the serial output to assure do not hang trying to drain it */
+  /* After a successful transfer let the final "OO" go out.  Otherwise flush
+   * the serial output to assure do not hang trying to drain it.
+   */
 
-  tcflush(fd, TCIOFLUSH);
+  if (exitcode == EXIT_SUCCESS)
+    {
+      tcdrain(fd);
+      tcflush(fd, TCIFLUSH);
+    }
+  else
+    {
+      tcflush(fd, TCIOFLUSH);
+    }
 
   /* Restore the saved terminal setting */
 
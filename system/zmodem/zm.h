@@ -36,8 +36,12 @@
 #include <sys/types.h>
 
 #include <stdint.h>
+#include <stdbool.h>
 #include <nuttx/debug.h>
 #include <syslog.h>
+#ifdef CONFIG_SYSTEM_ZMODEM_FILEIO
+#  include <pthread.h>
+#endif
 
 #include <nuttx/compiler.h>
 #include <nuttx/ascii.h>
@@ -211,6 +215,19 @@
 
 #define ZM_PKTBUFSIZE (CONFIG_SYSTEM_ZMODEM_PKTBUFSIZE + 5)
 
+/* File data is read ahead of the sender or written behind the receiver in
+ * ZM_NIOBUFS buffers.  Without CONFIG_SYSTEM_ZMODEM_FILEIO there is no I/O
+ * thread and the single buffer is serviced synchronously.
+ */
+
+#ifdef CONFIG_SYSTEM_ZMODEM_FILEIO
+#  define ZM_NIOBUFS  2
+#else
+#  define ZM_NIOBUFS  1
+#endif
+
+#define ZM_IOBUFSIZE  CONFIG_SYSTEM_ZMODEM_IOBUFSIZE
+
 /* Debug Definitions ********************************************************/
 
 /* Non-standard debug selectable with CONFIG_DEBUG_ZMODEM.  Debug output goes
@@ -289,6 +306,39 @@ struct zm_transition_s
   action_t   action;         /* Transition action */
 };
 
+/* One file I/O buffer */
+
+struct zm_iobuf_s
+{
+  off_t    offset;           /* File offset of data[0] (read ahead only) */
+  size_t   len;              /* Number of valid bytes in data[] */
+  bool     full;             /* Handed over: to the sender by the reader,
+                              * to the I/O thread by the receiver */
+  uint8_t  data[ZM_IOBUFSIZE];
+};
+
+/* Read ahead / write behind state of one file */
+
+struct zm_fileio_s
+{
+  int      fd;               /* The local file */
+  int      error;            /* Sticky negated errno of the file I/O */
+  uint8_t  head;             /* Next buffer used by the protocol */
+  uint8_t  tail;             /* Next buffer used by the I/O thread */
+  bool     zcnl;             /* Write behind: convert newlines */
+  bool     eof;              /* Read ahead: end of file was read */
+  off_t    next;             /* Read ahead: file offset of the next read */
+#ifdef CONFIG_SYSTEM_ZMODEM_FILEIO
+  bool     running;          /* The I/O thread was started */
+  bool     stop;             /* The I/O thread must terminate */
+  uint16_t gen;              /* Read ahead: incremented on every seek */
+  pthread_t thread;          /* The I/O thread */
+  pthread_mutex_t lock;      /* Protects all of the above and buf[].full */
+  pthread_cond_t cond;       /* Signaled on every buffer hand over */
+#endif
+  struct zm_iobuf_s buf[ZM_NIOBUFS];
+};
+
 /* Common state information.  This structure contains all of the top-level
  * information needed by the common Zmodem receive and transmit parsing.
  */
@@ -346,9 +396,6 @@ struct zm_state_s
   uint8_t  rcvbuf[CONFIG_SYSTEM_ZMODEM_RCVBUFSIZE];
   uint8_t  pktbuf[ZM_PKTBUFSIZE];
   uint8_t  scratch[CONFIG_SYSTEM_ZMODEM_SNDBUFSIZE];
-#ifdef CONFIG_SYSTEM_ZMODEM_SNDFILEBUF
-  uint8_t  filebuf[CONFIG_SYSTEM_ZMODEM_SNDBUFSIZE];
-#endif
 };
 
 /* Receive state information */
@@ -380,6 +427,7 @@ struct zmr_state_s
   time_t timestamp;          /* Remote time stamp */
 #endif
   int outfd;                 /* Local output file descriptor */
+  struct zm_fileio_s wrbehind; /* Write behind of outfd */
 };
 
 /* Send state information */
@@ -407,7 +455,9 @@ struct zms_state_s
   off_t lastoffs;            /* Last acknowledged file offset */
   off_t zrpos;               /* Last offset from ZRPOS */
   off_t filesize;            /* Size of the file to send */
+  off_t ackoffs;             /* Next offset that asks for a ZACK */
   int infd;                  /* Local input file descriptor */
+  struct zm_fileio_s rdahead; /* Read ahead of infd */
 };
 
 /****************************************************************************
@@ -571,6 +621,74 @@ int zm_writefile(int fd, FAR const uint8_t *buffer,
 
 uint32_t zm_filecrc(FAR struct zm_state_s *pzm, FAR const char *filename);
 
+/****************************************************************************
+ * Name: zm_rdstart
+ *
+ * Description:
+ *   Start reading ahead the file fd, beginning at file offset zero.
+ *
+ ****************************************************************************/
+
+int zm_rdstart(FAR struct zm_fileio_s *io, int fd);
+
+/****************************************************************************
+ * Name: zm_rdget
+ *
+ * Description:
+ *   Get the file data at the given offset.  On success, the number of bytes
+ *   available at *data is returned, zero at the end of the file.  The data
+ *   stay valid until the next call.  An offset that is not the one that
+ *   follows the previous data restarts the read ahead at that offset.
+ *
+ ****************************************************************************/
+
+ssize_t zm_rdget(FAR struct zm_fileio_s *io, off_t offset,
+                 FAR const uint8_t **data);
+
+/****************************************************************************
+ * Name: zm_wrstart
+ *
+ * Description:
+ *   Start writing behind to the file fd, see zm_writefile() for zcnl.
+ *
+ ****************************************************************************/
+
+int zm_wrstart(FAR struct zm_fileio_s *io, int fd, bool zcnl);
+
+/****************************************************************************
+ * Name: zm_wrput
+ *
+ * Description:
+ *   Queue data to be written to the file.  A negated errno is returned if a
+ *   previous write failed.
+ *
+ ****************************************************************************/
+
+int zm_wrput(FAR struct zm_fileio_s *io, FAR const uint8_t *buffer,
+             size_t buflen);
+
+/****************************************************************************
+ * Name: zm_wrflush
+ *
+ * Description:
+ *   Wait until all of the queued data has been written.  A negated errno is
+ *   returned if any write failed.
+ *
+ ****************************************************************************/
+
+int zm_wrflush(FAR struct zm_fileio_s *io);
+
+/****************************************************************************
+ * Name: zm_iostop
+ *
+ * Description:
+ *   Stop a read ahead or write behind, data still queued is discarded.  The
+ *   file itself is left open.
+ *
+ ****************************************************************************/
+
+void zm_iostop(FAR struct zm_fileio_s *io);
+
 /****************************************************************************
  * Name: zm_rawmode
  *
@@ -609,6 +727,30 @@ void zm_flowc(int fd);
 FAR uint8_t *zm_putzdle(FAR struct zm_state_s *pzm, FAR uint8_t *buffer,
                         uint8_t ch);
 
+/****************************************************************************
+ * Name: zm_putzdlebuf
+ *
+ * Description:
+ *   Transfer as much of a buffer as fits into buflen bytes of the output
+ *   buffer, performing ZDLE escaping.
+ *
+ * Input Parameters:
+ *   pzm - Zmodem session state
+ *   buffer - Buffer in which to add the escaped data
+ *   buflen - Room in buffer
+ *   src - The raw, unescaped data
+ *   srclen - The number of bytes in src
+ *   nused - Returns the number of bytes taken from src
+ *
+ * Returned Value:
+ *   The number of bytes added to buffer.
+ *
+ ****************************************************************************/
+
+size_t zm_putzdlebuf(FAR struct zm_state_s *pzm, FAR uint8_t *buffer,
+                     size_t buflen, FAR const uint8_t *src, size_t srclen,
+                     FAR size_t *nused);
+
 /****************************************************************************
  * Name: zm_senddata
  *
@@ -0,0 +1,539 @@
+/****************************************************************************
+ * apps/system/zmodem/zm_fileio.c
+ *
+ * SPDX-License-Identifier: Apache-2.0
+ *
+ * Licensed to the Apache Software Foundation (ASF) under one or more
+ * contributor license agreements.  See the NOTICE file distributed with
+ * this work for additional information regarding copyright ownership.  The
+ * ASF licenses this file to you under the Apache License, Version 2.0 (the
+ * "License"); you may not use this file except in compliance with the
+ * License.  You may obtain a copy of the License at
+ *
+ *   http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS, WITHOUT
+ * WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.  See the
+ * License for the specific language governing permissions and limitations
+ * under the License.
+ *
+ ****************************************************************************/
+
+/****************************************************************************
+ * Included Files
+ ****************************************************************************/
+
+#include <nuttx/config.h>
+
+#include <string.h>
+#include <unistd.h>
+#include <signal.h>
+#include <errno.h>
+
+#include "zm.h"
+
+/****************************************************************************
+ * Private Functions
+ ****************************************************************************/
+
+/****************************************************************************
+ * Name: zm_pread
+ *
+ * Description:
+ *   Read one buffer of the file at the given offset.
+ *
+ ****************************************************************************/
+
+static ssize_t zm_pread(int fd, FAR uint8_t *buffer, off_t offset)
+{
+  ssize_t nread;
+
+  do
+    {
+      nread = pread(fd, buffer, ZM_IOBUFSIZE, offset);
+    }
+  while (nread < 0 && errno == EINTR);
+
+  if (nread < 0)
+    {
+      zmdbg("ERROR: read failed: %d\n", errno);
+      return -errno;
+    }
+
+  return nread;
+}
+
+#ifdef CONFIG_SYSTEM_ZMODEM_FILEIO
+
+/****************************************************************************
+ * Name: zm_rdthread
+ *
+ * Description:
+ *   Fill the free buffers in order, the file offset to read is io->next.
+ *   A seek bumps io->gen, a read that was in progress is then discarded.
+ *
+ ****************************************************************************/
+
+static FAR void *zm_rdthread(FAR void *arg)
+{
+  FAR struct zm_fileio_s *io = arg;
+  FAR struct zm_iobuf_s *buf;
+  uint16_t gen;
+  ssize_t nread;
+  off_t offset;
+
+  pthread_mutex_lock(&io->lock);
+  while (!io->stop)
+    {
+      buf = &io->buf[io->tail];
+      if (buf->full || io->eof || io->error < 0)
+        {
+          pthread_cond_wait(&io->cond, &io->lock);
+          continue;
+        }
+
+      gen    = io->gen;
+      offset = io->next;
+      pthread_mutex_unlock(&io->lock);
+
+      nread = zm_pread(io->fd, buf->data, offset);
+
+      pthread_mutex_lock(&io->lock);
+      if (gen != io->gen)
+        {
+          continue;
+        }
+
+      if (nread < 0)
+        {
+          io->error = nread;
+        }
+      else if (nread == 0)
+        {
+          io->eof = true;
+        }
+      else
+        {
+          buf->offset = offset;
+          buf->len    = nread;
+          buf->full   = true;
+          io->next    = offset + nread;
+          io->tail    = (io->tail + 1) % ZM_NIOBUFS;
+        }
+
+      pthread_cond_broadcast(&io->cond);
+    }
+
+  pthread_mutex_unlock(&io->lock);
+  return NULL;
+}
+
+/****************************************************************************
+ * Name: zm_wrthread
+ *
+ * Description:
+ *   Write the buffers handed over by the receiver in order.
+ *
+ ****************************************************************************/
+
+static FAR void *zm_wrthread(FAR void *arg)
+{
+  FAR struct zm_fileio_s *io = arg;
+  FAR struct zm_iobuf_s *buf;
+  int ret;
+
+  pthread_mutex_lock(&io->lock);
+  while (!io->stop)
+    {
+      buf = &io->buf[io->tail];
+      if (!buf->full)
+        {
+          pthread_cond_wait(&io->cond, &io->lock);
+          continue;
+        }
+
+      pthread_mutex_unlock(&io->lock);
+
+      ret = io->error < 0 ? OK :
+            zm_writefile(io->fd, buf->data, buf->len, io->zcnl);
+
+      pthread_mutex_lock(&io->lock);
+      if (ret < 0 && io->error == 0)
+        {
+          io->error = ret;
+        }
+
+      buf->len  = 0;
+      buf->full = false;
+      io->tail  = (io->tail + 1) % ZM_NIOBUFS;
+      pthread_cond_broadcast(&io->cond);
+    }
+
+  pthread_mutex_unlock(&io->lock);
+  return NULL;
+}
+
+/****************************************************************************
+ * Name: zm_iostart
+ *
+ * Description:
+ *   Start the I/O thread.  SIGALRM stays with the protocol thread, that is
+ *   how zm_datapump() learns about timeouts.
+ *
+ ****************************************************************************/
+
+static int zm_iostart(FAR struct zm_fileio_s *io,
+                      CODE FAR void *(*entry)(FAR void *))
+{
+  sigset_t set;
+  sigset_t oset;
+  int ret;
+
+  pthread_mutex_init(&io->lock, NULL);
+  pthread_cond_init(&io->cond, NULL);
+
+  sigemptyset(&set);
+  sigaddset(&set, SIGALRM);
+  pthread_sigmask(SIG_BLOCK, &set, &oset);
+  ret = pthread_create(&io->thread, NULL, entry, io);
+  pthread_sigmask(SIG_SETMASK, &oset, NULL);
+
+  if (ret != 0)
+    {
+      zmdbg("ERROR: pthread_create failed: %d\n", ret);
+      pthread_cond_destroy(&io->cond);
+      pthread_mutex_destroy(&io->lock);
+      return -ret;
+    }
+
+  io->running = true;
+  return OK;
+}
+#endif
+
+/****************************************************************************
+ * Name: zm_ioinit
+ ****************************************************************************/
+
+static void zm_ioinit(FAR struct zm_fileio_s *io, int fd)
+{
+  int i;
+
+  io->fd    = fd;
+  io->error = 0;
+  io->head  = 0;
+  io->tail  = 0;
+  io->eof   = false;
+  io->next  = 0;
+
+  for (i = 0; i < ZM_NIOBUFS; i++)
+    {
+      io->buf[i].len  = 0;
+      io->buf[i].full = false;
+    }
+
+#ifdef CONFIG_SYSTEM_ZMODEM_FILEIO
+  io->stop  = false;
+  io->gen   = 0;
+#endif
+}
+
+/****************************************************************************
+ * Public Functions
+ ****************************************************************************/
+
+/****************************************************************************
+ * Name: zm_rdstart
+ *
+ * Description:
+ *   Start reading ahead the file fd, beginning at file offset zero.
+ *
+ ****************************************************************************/
+
+int zm_rdstart(FAR struct zm_fileio_s *io, int fd)
+{
+  zm_ioinit(io, fd);
+
+#ifdef CONFIG_SYSTEM_ZMODEM_FILEIO
+  return zm_iostart(io, zm_rdthread);
+#else
+  return OK;
+#endif
+}
+
+/****************************************************************************
+ * Name: zm_rdget
+ *
+ * Description:
+ *   Get the file data at the given offset.  On success, the number of bytes
+ *   available at *data is returned, zero at the end of the file.  The data
+ *   stay valid until the next call.  An offset that is not the one that
+ *   follows the previous data restarts the read ahead at that offset.
+ *
+ ****************************************************************************/
+
+ssize_t zm_rdget(FAR struct zm_fileio_s *io, off_t offset,
+                 FAR const uint8_t **data)
+{
+  FAR struct zm_iobuf_s *buf;
+  ssize_t ret;
+  int i;
+
+#ifdef CONFIG_SYSTEM_ZMODEM_FILEIO
+  pthread_mutex_lock(&io->lock);
+#endif
+
+  for (; ; )
+    {
+      buf = &io->buf[io->head];
+      if (buf->full)
+        {
+          if (offset >= buf->offset && offset < buf->offset + buf->len)
+            {
+              *data = &buf->data[offset - buf->offset];
+              ret   = buf->offset + buf->len - offset;
+              break;
+            }
+
+          if (offset > buf->offset)
+            {
+              /* The sender is done with this buffer, hand it back */
+
+              buf->full = false;
+              io->head  = (io->head + 1) % ZM_NIOBUFS;
+#ifdef CONFIG_SYSTEM_ZMODEM_FILEIO
+              pthread_cond_broadcast(&io->cond);
+#endif
+              continue;
+            }
+        }
+      else if (io->error < 0)
+        {
+          ret = io->error;
+          break;
+        }
+      else if (offset >= io->next &&
+               offset < io->next + ZM_NIOBUFS * ZM_IOBUFSIZE)
+        {
+          /* This comes with the next read */
+
+          if (io->eof)
+            {
+              ret = 0;
+              break;
+            }
+
+#ifdef CONFIG_SYSTEM_ZMODEM_FILEIO
+          pthread_cond_wait(&io->cond, &io->lock);
+#else
+          ret = zm_pread(io->fd, buf->data, io->next);
+          if (ret <= 0)
+            {
+              io->error = ret;
+              io->eof   = ret == 0;
+              continue;
+            }
+
+          buf->offset = io->next;
+          buf->len    = ret;
+          buf->full   = true;
+          io->next   += ret;
+#endif
+          continue;
+        }
+
+      /* ZRPOS, or the file CRC before the data: restart at offset */
+
+      zmdbg("Read ahead restarts at %ld\n", (unsigned long)offset);
+
+      for (i = 0; i < ZM_NIOBUFS; i++)
+        {
+          io->buf[i].full = false;
+        }
+
+      io->head  = 0;
+      io->tail  = 0;
+      io->next  = offset;
+      io->eof   = false;
+      io->error = 0;
+#ifdef CONFIG_SYSTEM_ZMODEM_FILEIO
+      io->gen++;
+      pthread_cond_broadcast(&io->cond);
+#endif
+    }
+
+#ifdef CONFIG_SYSTEM_ZMODEM_FILEIO
+  pthread_mutex_unlock(&io->lock);
+#endif
+  return ret;
+}
+
+/****************************************************************************
+ * Name: zm_wrstart
+ *
+ * Description:
+ *   Start writing behind to the file fd, see zm_writefile() for zcnl.
+ *
+ ****************************************************************************/
+
+int zm_wrstart(FAR struct zm_fileio_s *io, int fd, bool zcnl)
+{
+  zm_ioinit(io, fd);
+  io->zcnl = zcnl;
+
+#ifdef CONFIG_SYSTEM_ZMODEM_FILEIO
+  return zm_iostart(io, zm_wrthread);
+#else
+  return OK;
+#endif
+}
+
+/****************************************************************************
+ * Name: zm_wrput
+ *
+ * Description:
+ *   Queue data to be written to the file.  A negated errno is returned if a
+ *   previous write failed.
+ *
+ ****************************************************************************/
+
+int zm_wrput(FAR struct zm_fileio_s *io, FAR const uint8_t *buffer,
+             size_t buflen)
+{
+  FAR struct zm_iobuf_s *buf;
+  size_t nbytes;
+  int ret = OK;
+
+  while (buflen > 0 && ret == OK)
+    {
+      buf = &io->buf[io->head];
+
+#ifdef CONFIG_SYSTEM_ZMODEM_FILEIO
+      /* Wait until the I/O thread is done with the buffer */
+
+      pthread_mutex_lock(&io->lock);
+      while (buf->full && io->error == 0)
+        {
+          pthread_cond_wait(&io->cond, &io->lock);
+        }
+
+      ret = io->error;
+      pthread_mutex_unlock(&io->lock);
+      if (ret < 0)
+        {
+          break;
+        }
+#endif
+
+      nbytes = ZM_IOBUFSIZE - buf->len;
+      if (nbytes > buflen)
+        {
+          nbytes = buflen;
+        }
+
+      memcpy(&buf->data[buf->len], buffer, nbytes);
+      buf->len += nbytes;
+      buffer   += nbytes;
+      buflen   -= nbytes;
+
+      if (buf->len == ZM_IOBUFSIZE)
+        {
+          ret = zm_wrflush(io);
+        }
+    }
+
+  return ret;
+}
+
+/****************************************************************************
+ * Name: zm_wrflush
+ *
+ * Description:
+ *   Hand over the partially filled buffer, if any.  Without an I/O thread
+ *   this writes it.  With one, the hand over of a full buffer just returns,
+ *   otherwise we wait until all of the queued data has been written.  A
+ *   negated errno is returned if any write failed.
+ *
+ ****************************************************************************/
+
+int zm_wrflush(FAR struct zm_fileio_s *io)
+{
+  FAR struct zm_iobuf_s *buf = &io->buf[io->head];
+  int ret;
+
+#ifdef CONFIG_SYSTEM_ZMODEM_FILEIO
+  bool sync = buf->len < ZM_IOBUFSIZE;
+  int i;
+
+  pthread_mutex_lock(&io->lock);
+  if (buf->len > 0 && !buf->full)
+    {
+      buf->full = true;
+      io->head  = (io->head + 1) % ZM_NIOBUFS;
+      pthread_cond_broadcast(&io->cond);
+    }
+
+  for (i = 0; sync && i < ZM_NIOBUFS && io->error == 0; )
+    {
+      if (io->buf[i].full)
+        {
+          pthread_cond_wait(&io->cond, &io->lock);
+        }
+      else
+        {
+          i++;
+        }
+    }
+
+  ret = io->error;
+  pthread_mutex_unlock(&io->lock);
+#else
+  ret = io->error;
+  if (buf->len > 0 && ret == 0)
+    {
+      ret = zm_writefile(io->fd, buf->data, buf->len, io->zcnl);
+      if (ret < 0)
+        {
+          io->error = ret;
+        }
+      else
+        {
+          ret = OK;
+        }
+    }
+
+  buf->len = 0;
+#endif
+
+  return ret;
+}
+
+/****************************************************************************
+ * Name: zm_iostop
+ *
+ * Description:
+ *   Stop a read ahead or write behind, data still queued is discarded.  The
+ *   file itself is left open.
+ *
+ ****************************************************************************/
+
+void zm_iostop(FAR struct zm_fileio_s *io)
+{
+#ifdef CONFIG_SYSTEM_ZMODEM_FILEIO
+  if (io->running)
+    {
+      pthread_mutex_lock(&io->lock);
+      io->stop = true;
+      pthread_cond_broadcast(&io->cond);
+      pthread_mutex_unlock(&io->lock);
+
+      pthread_join(io->thread, NULL);
+      pthread_cond_destroy(&io->cond);
+      pthread_mutex_destroy(&io->lock);
+      io->running = false;
+    }
+#endif
+
+  zm_ioinit(io, -1);
+}
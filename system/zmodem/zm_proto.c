@@ -32,12 +32,52 @@
 #include <nuttx/config.h>
 
 #include <stdio.h>
+#include <assert.h>
 
 #include <nuttx/crc16.h>
 #include <nuttx/crc32.h>
 
 #include "zm.h"
 
+/****************************************************************************
+ * Pre-processor Definitions
+ ****************************************************************************/
+
+/* Classes of g_zdleclass[] */
+
+#define ZM_ESC_ALWAYS  (1 << 0)  /* ZDLE, DLE, XON, XOFF, GS, DEL, 0xff */
+#define ZM_ESC_CTRL    (1 << 1)  /* Control character, if ZM_FLAG_ESCCTRL */
+#define ZM_ESC_CR      (1 << 2)  /* CR, after '@' or if ZM_FLAG_ESCCTRL */
+#define ZM_ESC_AT      (1 << 3)  /* '@', never escaped itself */
+
+/****************************************************************************
+ * Private Data
+ ****************************************************************************/
+
+/* The ZDLE escaping class of every byte value, the high bit is ignored
+ * except for ZDLE and 0xff.
+ */
+
+static const uint8_t g_zdleclass[256] =
+{
+  2, 2, 2, 2, 2, 2, 2, 2, 2, 2, 2, 2, 2, 4, 2, 2,  /* 00 */
+  1, 1, 2, 1, 2, 2, 2, 2, 1, 2, 2, 2, 2, 1, 2, 2,  /* 10 */
+  0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0,  /* 20 */
+  0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0,  /* 30 */
+  8, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0,  /* 40 */
+  0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0,  /* 50 */
+  0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0,  /* 60 */
+  0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 1,  /* 70 */
+  2, 2, 2, 2, 2, 2, 2, 2, 2, 2, 2, 2, 2, 4, 2, 2,  /* 80 */
+  1, 1, 2, 1, 2, 2, 2, 2, 2, 2, 2, 2, 2, 1, 2, 2,  /* 90 */
+  0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0,  /* a0 */
+  0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0,  /* b0 */
+  8, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0,  /* c0 */
+  0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0,  /* d0 */
+  0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0,  /* e0 */
+  0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 1   /* f0 */
+};
+
 /****************************************************************************
  * Public Data
  ****************************************************************************/
@@ -87,52 +127,82 @@ const uint8_t g_canistr[CANISTR_SIZE] =
 FAR uint8_t *zm_putzdle(FAR struct zm_state_s *pzm, FAR uint8_t *buffer,
                         uint8_t ch)
 {
-  uint8_t ch7 = ch & 0x7f;
+  size_t nused;
+
+  return buffer + zm_putzdlebuf(pzm, buffer, 2, &ch, 1, &nused);
+}
 
-  /* Check if this character requires ZDLE escaping.
-   *
-   * The Zmodem protocol requires that CAN(ZDLE), DLE, XON, XOFF and a CR
-   * following '@' be escaped.
+/****************************************************************************
+ * Name: zm_putzdlebuf
+ *
+ * Description:
+ *   Transfer as much of a buffer as fits into buflen bytes of the output
+ *   buffer, performing ZDLE escaping.
+ *
+ * Input Parameters:
+ *   pzm - Zmodem session state
+ *   buffer - Buffer in which to add the escaped data
+ *   buflen - Room in buffer
+ *   src - The raw, unescaped data
+ *   srclen - The number of bytes in src
+ *   nused - Returns the number of bytes taken from src
+ *
+ * Returned Value:
+ *   The number of bytes added to buffer.
+ *
+ ****************************************************************************/
+
+size_t zm_putzdlebuf(FAR struct zm_state_s *pzm, FAR uint8_t *buffer,
+                     size_t buflen, FAR const uint8_t *src, size_t srclen,
+                     FAR size_t *nused)
+{
+  FAR uint8_t *ptr = buffer;
+  FAR uint8_t *end = buffer + buflen;
+  uint8_t escmask = ZM_ESC_ALWAYS;
+  uint8_t cls = 0;
+  uint8_t ch;
+  size_t i;
+
+  /* The Zmodem protocol requires that CAN(ZDLE), DLE, XON, XOFF and a CR
+   * following '@' be escaped.  The other end may ask for all of the
+   * control characters.
    */
 
-  if (ch   == ZDLE ||
-      ch7  == ASCII_DLE ||
-      ch7  == ASCII_DC1 ||
-      ch7  == ASCII_DC3 ||
-      ch7  == ASCII_GS ||
-      (ch7 == '\r' && (pzm->flags & ZM_FLAG_ATSIGN)  != 0) ||
-      (ch7 <  ' '  && (pzm->flags & ZM_FLAG_ESCCTRL) != 0) ||
-      ch7  == ASCII_DEL ||
-      ch   == 0xff
-      )
+  if ((pzm->flags & ZM_FLAG_ESCCTRL) != 0)
     {
-      /* Yes... save the data link escape the character */
+      escmask |= ZM_ESC_CTRL | ZM_ESC_CR;
+    }
 
-      *buffer++ = ZDLE;
+  if ((pzm->flags & ZM_FLAG_ATSIGN) != 0)
+    {
+      cls = ZM_ESC_AT;
+    }
 
-      /* And modify the character itself as appropriate  */
+  for (i = 0; i < srclen && ptr < end; i++)
+    {
+      ch = src[i];
+
+      /* A CR is escaped if the previous character was an '@' */
 
-      if (ch == ASCII_DEL)
+      if ((g_zdleclass[ch] & (escmask | (cls == ZM_ESC_AT ? ZM_ESC_CR : 0)))
+          == 0)
         {
-          ch = ZRUB0;
+          *ptr++ = ch;
         }
-      else if (ch == 0xff)
+      else if (end - ptr >= 2)
         {
-          ch = ZRUB1;
+          *ptr++ = ZDLE;
+          *ptr++ = ch == ASCII_DEL ? ZRUB0 : ch == 0xff ? ZRUB1 : ch ^ 0x40;
         }
       else
         {
-          ch ^= 0x40;
+          break;
         }
-    }
-
-  /* Save the possibly escaped character */
-
-  *buffer++ = ch;
 
-  /* Check if the character is the AT sign */
+      cls = g_zdleclass[ch];
+    }
 
-  if (ch7 == '@')
+  if (cls == ZM_ESC_AT)
     {
       pzm->flags |= ZM_FLAG_ATSIGN;
     }
@@ -141,7 +211,8 @@ FAR uint8_t *zm_putzdle(FAR struct zm_state_s *pzm, FAR uint8_t *buffer,
       pzm->flags &= ~ZM_FLAG_ATSIGN;
     }
 
-  return buffer;
+  *nused = i;
+  return ptr - buffer;
 }
 
 /****************************************************************************
@@ -163,6 +234,7 @@ int zm_senddata(FAR struct zm_state_s *pzm, FAR const uint8_t *buffer,
 {
   uint8_t *ptr = pzm->scratch;
   ssize_t nwritten;
+  size_t nused;
   uint32_t crc;
   uint8_t zbin;
   uint8_t term;
@@ -185,21 +257,20 @@ int zm_senddata(FAR struct zm_state_s *pzm, FAR const uint8_t *buffer,
   zmdbg("zbin=%c, buflen=%zu, term=%c flags=%04x\n",
         zbin, buflen, term, pzm->flags);
 
-  /* Transfer the data to the I/O buffer, accumulating the CRC */
+  /* Accumulate the CRC and transfer the data to the I/O buffer */
 
-  while (buflen-- > 0)
+  if (zbin == ZBIN)
     {
-      if (zbin == ZBIN)
-        {
-          crc = (uint32_t)crc16xmodempart(buffer, 1, (uint16_t)crc);
-        }
-      else /* zbin = ZBIN32 */
-        {
-          crc = crc32part(buffer, 1, crc);
-        }
-
-      ptr = zm_putzdle(pzm, ptr, *buffer++);
+      crc = (uint32_t)crc16xmodempart(buffer, buflen, (uint16_t)crc);
     }
+  else /* zbin = ZBIN32 */
+    {
+      crc = crc32part(buffer, buflen, crc);
+    }
+
+  ptr += zm_putzdlebuf(pzm, ptr, CONFIG_SYSTEM_ZMODEM_SNDBUFSIZE - 10,
+                       buffer, buflen, &nused);
+  DEBUGASSERT(nused == buflen);
 
   /* Trasnfer the data link escape character (without updating the CRC) */
 
@@ -56,6 +56,22 @@
  * Pre-processor Definitions
  ****************************************************************************/
 
+/* With the file written behind the transfer the receiver can take data
+ * while it writes (CANOVIO) and needs no flow control, so it advertises a
+ * buffer length of zero and the sender may stream a whole file.  lrzsz
+ * limits its block length to the receive buffer length it is told, so only
+ * do that if the packet buffer holds a full 1024 byte block.
+ */
+
+#if defined(CONFIG_SYSTEM_ZMODEM_FILEIO) && \
+    CONFIG_SYSTEM_ZMODEM_PKTBUFSIZE >= 1024
+#  define ZMR_BUFLEN 0
+#  define ZMR_RCAPS  (CANFC32 | CANFDX | CANOVIO)
+#else
+#  define ZMR_BUFLEN CONFIG_SYSTEM_ZMODEM_PKTBUFSIZE
+#  define ZMR_RCAPS  (CANFC32 | CANFDX)
+#endif
+
 /****************************************************************************
  * Private Types
  ****************************************************************************/
@@ -319,8 +335,8 @@ static int zmr_zrinit(FAR struct zm_state_s *pzm)
   /* Send ZRINIT */
 
   pzm->timeout = CONFIG_SYSTEM_ZMODEM_RESPTIME;
-  buf[0]       = CONFIG_SYSTEM_ZMODEM_PKTBUFSIZE & 0xff;
-  buf[1]       = (CONFIG_SYSTEM_ZMODEM_PKTBUFSIZE >> 8) & 0xff;
+  buf[0]       = ZMR_BUFLEN & 0xff;
+  buf[1]       = (ZMR_BUFLEN >> 8) & 0xff;
   buf[2]       = 0;
   buf[3]       = pzmr->rcaps;
   return zm_sendhexhdr(pzm, ZRINIT, buf);
@@ -759,13 +775,12 @@ static int zmr_filedata(FAR struct zm_state_s *pzm)
         }
     }
 
-  /* Write the packet of data to the file */
+  /* Queue the packet of data to be written to the file */
 
-  ret = zm_writefile(pzmr->outfd, pzm->pktbuf, pzm->pktlen,
-                     pzmr->f0 == ZCNL);
+  ret = zm_wrput(&pzmr->wrbehind, pzm->pktbuf, pzm->pktlen);
   if (ret < 0)
     {
-      int errorcode = errno;
+      int errorcode = -ret;
 
       /* Could not write to the file. */
 
@@ -907,6 +922,7 @@ static int zmr_fileto(FAR struct zm_state_s *pzm)
 static int zmr_zeof(FAR struct zm_state_s *pzm)
 {
   FAR struct zmr_state_s *pzmr = (FAR struct zmr_state_s *)pzm;
+  int ret;
 
   zmdbg("ZMR_STATE %d: offset=%ld\n", pzm->state,
         (unsigned long)pzmr->offset);
@@ -922,13 +938,26 @@ static int zmr_zeof(FAR struct zm_state_s *pzm)
       return OK;         /* it was probably spurious */
     }
 
-  /* Close the output file.
+  /* Wait for the data still queued to be written and close the output
+   * file.
    * TODO: if we can't close the file, send a ZFERR.
    */
 
+  ret = zm_wrflush(&pzmr->wrbehind);
+  zm_iostop(&pzmr->wrbehind);
   close(pzmr->outfd);
   pzmr->outfd = -1;
 
+  if (ret < 0)
+    {
+      zmdbg("ERROR: Write to file failed: %d\n", ret);
+      zmdbg("ZMR_STATE %d->%d\n",  pzm->state, ZMR_FINISH);
+
+      pzm->state = ZMR_FINISH;
+      zmr_fileerror(pzmr, ZFERR, (uint32_t)-ret);
+      return ret;
+    }
+
   /* TODO:  Set the file timestamp and access privileges */
 
   /* Re-send the ZRINIT header so that we are ready for the next file */
@@ -1435,6 +1464,15 @@ static int zmr_openfile(FAR struct zmr_state_s *pzmr, uint32_t crc)
           zmdbg("ERROR: Failed to open %s: %d\n", pzmr->filename, errno);
           goto skip;
         }
+
+      /* The data will be written behind the transfer */
+
+      if (zm_wrstart(&pzmr->wrbehind, pzmr->outfd, pzmr->f0 == ZCNL) < 0)
+        {
+          close(pzmr->outfd);
+          pzmr->outfd = -1;
+          goto skip;
+        }
     }
 
   /* Are we appending/resuming a transfer? */
@@ -1564,6 +1602,7 @@ static void zmr_filecleanup(FAR struct zmr_state_s *pzmr)
 
   if (pzmr->outfd >= 0)
     {
+      zm_iostop(&pzmr->wrbehind);
       close(pzmr->outfd);
       pzmr->outfd = -1;
     }
@@ -1621,7 +1660,7 @@ ZMRHANDLE zmr_initialize(int remfd)
       pzm->pstate    = PSTATE_IDLE;
       pzm->psubstate = PIDLE_ZPAD;
       pzm->remfd     = remfd;
-      pzmr->rcaps    = CANFC32 | CANFDX;
+      pzmr->rcaps    = ZMR_RCAPS;
       pzmr->outfd    = -1;
 
       /* Create a timer to handle timeout events */
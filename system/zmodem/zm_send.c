@@ -60,6 +60,19 @@
  * Pre-processor Definitions
  ****************************************************************************/
 
+/* Without a reverse channel, a receiver that does full streaming is sent
+ * ZCRCG subpackets up to this many unacknowledged bytes.  Zero sends a ZCRCQ
+ * subpacket per ZACK.
+ */
+
+#define ZMS_WINDOW CONFIG_SYSTEM_ZMODEM_SNDWINDOW
+
+#ifdef CONFIG_SYSTEM_ZMODEM_RCVSAMPLE
+#  define ZMS_WINDOWED(p) false
+#else
+#  define ZMS_WINDOWED(p) (ZMS_WINDOW > 0 && (p)->dpkttype == ZCRCQ)
+#endif
+
 /****************************************************************************
  * Private Types
  ****************************************************************************/
@@ -137,6 +150,8 @@ static int zms_endoftransfer(FAR struct zm_state_s *pzm);
 static int zms_fileskip(FAR struct zm_state_s *pzm);
 static int zms_sendfiledata(FAR struct zm_state_s *pzm);
 static int zms_sendpacket(FAR struct zm_state_s *pzm);
+static int zms_sendack(FAR struct zm_state_s *pzm);
+static int zms_sendto(FAR struct zm_state_s *pzm);
 static int zms_filecrc(FAR struct zm_state_s *pzm);
 static int zms_sendwaitack(FAR struct zm_state_s *pzm);
 static int zms_sendnak(FAR struct zm_state_s *pzm);
@@ -251,14 +266,14 @@ static const struct zm_transition_s g_zms_crcwait[] =
 static const struct zm_transition_s g_zmr_sending[] =
 {
   {ZME_SINIT,     false, ZMS_START,    zms_attention},
-  {ZME_ACK,       false, ZMS_SENDING,  zms_sendpacket},
+  {ZME_ACK,       false, ZMS_SENDING,  zms_sendack},
   {ZME_RPOS,      true,  ZMS_SENDING,  zms_sendrpos},
   {ZME_SKIP,      true,  ZMS_FILEWAIT, zms_fileskip},
   {ZME_NAK,       true,  ZMS_SENDING,  zms_sendnak},
   {ZME_RINIT,     true,  ZMS_FILEWAIT, zms_sendfilename},
   {ZME_ABORT,     true,  ZMS_FINISH,   zms_abort},
   {ZME_FERR,      true,  ZMS_FINISH,   zms_abort},
-  {ZME_TIMEOUT,   false, ZMS_SENDING,  zms_sendpacket},
+  {ZME_TIMEOUT,   false, ZMS_SENDING,  zms_sendto},
   {ZME_ERROR,     false, ZMS_SENDING,  zms_error},
 };
 
@@ -817,6 +832,7 @@ static int zms_fileskip(FAR struct zm_state_s *pzm)
   FAR struct zms_state_s *pzms = (FAR struct zms_state_s *)pzm;
 
   zmdbg("ZMS_STATE %d\n", pzm->state);
+  zm_iostop(&pzms->rdahead);
   close(pzms->infd);
   pzms->infd = -1;
   return ZM_XFRDONE;
@@ -855,15 +871,19 @@ static int zms_sendfiledata(FAR struct zm_state_s *pzm)
 static int zms_sendpacket(FAR struct zm_state_s *pzm)
 {
   FAR struct zms_state_s *pzms = (FAR struct zms_state_s *)pzm;
+  FAR const uint8_t *data;
   ssize_t nwritten;
+  ssize_t nread;
   int32_t unacked;
   bool bcrc32;
   uint32_t crc;
   uint8_t by[4];
   uint8_t *ptr;
   uint8_t type;
-  bool wait = false;
-  int sndsize;
+  bool wait;
+  off_t maxdata;
+  size_t room;
+  size_t nused;
   int pktsize;
   int i;
 
@@ -873,59 +893,128 @@ static int zms_sendpacket(FAR struct zm_state_s *pzm)
 
   do
     {
-      /* This is the number of byte left in the file to be sent */
-
-      sndsize = pzms->filesize - pzms->offset;
-
       /* This is the number of bytes that have been sent but not yet
        * acknowledged.
        */
 
       unacked = pzms->offset - pzms->lastoffs;
+      wait    = false;
 
       /* Can we still send?  If so, how much?   If rcvmax is zero, then the
-       * remote can handle full streaming and we never have to wait.
-       * Otherwise, we have to restrict the total number of unacknowledged
-       * bytes to rcvmax.
+       * remote can handle full streaming and we only keep the streaming
+       * window.  Otherwise, we have to restrict the total number of
+       * unacknowledged bytes to rcvmax.
        */
 
-      zmdbg("sndsize: %d unacked: %d rcvmax: %d\n",
-            sndsize, unacked, pzms->rcvmax);
+      zmdbg("offset: %ld unacked: %d rcvmax: %d\n",
+            (unsigned long)pzms->offset, unacked, pzms->rcvmax);
 
+      maxdata = pzms->filesize - pzms->offset;
       if (pzms->rcvmax != 0)
         {
-          /* If we were to send 'sndsize' more bytes,
-           * would that exceed recvmax?
+          /* If we were to send the rest of the file, would that exceed
+           * recvmax?
            */
 
-          if (sndsize + unacked > pzms->rcvmax)
+          if (maxdata + unacked > pzms->rcvmax)
             {
               /* Yes... clip the maximum so that we stay within that limit */
 
-              int maximum = pzms->rcvmax - unacked;
-              if (sndsize < maximum)
-                {
-                  sndsize = maximum;
-                }
+              maxdata = pzms->rcvmax - unacked;
+              wait    = true;
+              zmdbg("Clipped maxdata: %ld\n", (long)maxdata);
+            }
+
+          /* Can we send anything? */
+
+          if (maxdata <= 0)
+            {
+              /* No, not now. Keep waiting */
 
-              wait = true;
-              zmdbg("Clipped sndsize: %d\n", sndsize);
+              zmdbg("ZMS_STATE %d->%d\n", pzm->state, ZMS_SENDWAIT);
+
+              pzm->state   = ZMS_SENDWAIT;
+              pzm->timeout = CONFIG_SYSTEM_ZMODEM_RESPTIME;
+              return OK;
             }
         }
+      else if (ZMS_WINDOWED(pzms) && unacked >= ZMS_WINDOW &&
+               (pzm->flags & ZM_FLAG_WAIT) == 0)
+        {
+          /* The window is full, the ZACK of a ZCRCQ sent in its first half
+           * resumes the stream.
+           */
 
-      /* Can we send anything? */
+          zmdbg("Window full\n");
+          pzm->timeout = CONFIG_SYSTEM_ZMODEM_RESPTIME;
+          return OK;
+        }
 
-      if (sndsize <= 0)
+      /* Read characters from file and put into buffer until buffer is full
+       * or file is exhausted.  The CRC is accumulated over each chunk as it
+       * is escaped.
+       */
+
+      bcrc32      = ((pzm->flags & ZM_FLAG_CRC32) != 0);
+      crc         = bcrc32 ? 0xffffffff : 0;
+      pzm->flags &= ~ZM_FLAG_ATSIGN;
+
+      ptr         = pzm->scratch;
+      room        = CONFIG_SYSTEM_ZMODEM_SNDBUFSIZE - 10;
+
+      while (room > 0 && maxdata > 0)
         {
-          /* No, not now. Keep waiting */
+          nread = zm_rdget(&pzms->rdahead, pzms->offset, &data);
+          if (nread < 0)
+            {
+              zmdbg("ERROR: Failed to read file: %d\n", (int)nread);
+              return (int)nread;
+            }
+          else if (nread == 0)
+            {
+              /* The file was truncated while we were sending it */
 
-          zmdbg("ZMS_STATE %d->%d\n", pzm->state, ZMS_SENDWAIT);
+              zmdbg("Unexpected end of file at %ld\n",
+                    (unsigned long)pzms->offset);
+              pzms->filesize = pzms->offset;
+              break;
+            }
 
-          pzm->state   = ZMS_SENDWAIT;
-          pzm->timeout = CONFIG_SYSTEM_ZMODEM_RESPTIME;
-          return OK;
+          if (nread > maxdata)
+            {
+              nread = maxdata;
+            }
+
+          /* Put the data into the buffer, escaping as necessary */
+
+          i     = zm_putzdlebuf(pzm, ptr, room, data, nread, &nused);
+          ptr  += i;
+          room -= i;
+
+          /* Add the new data to the accumulated CRC */
+
+          if (!bcrc32)
+            {
+              crc = (uint32_t)crc16xmodempart(data, nused, (uint16_t)crc);
+            }
+          else
+            {
+              crc = crc32part(data, nused, crc);
+            }
+
+          /* And increment the file offset */
+
+          pzms->offset += nused;
+          maxdata      -= nused;
+
+          if (nused < (size_t)nread)
+            {
+              break;
+            }
         }
 
+      pktsize = ptr - pzm->scratch;
+
       /* Determine what kind of packet to send
        *
        * ZCRCW:
@@ -946,6 +1035,10 @@ static int zms_sendpacket(FAR struct zm_state_s *pzm)
        *    with the last good file offset.  Another data subpacket
        *    continues immediately.  ZCRCQ subpackets are not used if the
        *    receiver does not indicate FDX ability with the CANFDX bit.
+       *
+       * Within the streaming window, ZCRCG subpackets are sent with a ZCRCQ
+       * every half window, so the ZACKs keep the window open and the
+       * reverse channel is looked at for a ZRPOS at least that often.
        */
 
       if ((pzm->flags & ZM_FLAG_WAIT) != 0)
@@ -957,69 +1050,19 @@ static int zms_sendpacket(FAR struct zm_state_s *pzm)
         {
           type = ZCRCW;
         }
-      else
+      else if (ZMS_WINDOWED(pzms))
         {
-          type = pzms->dpkttype;
-        }
-
-      /* Read characters from file and put into buffer until buffer is full
-       * or file is exhausted
-       */
-
-      bcrc32      = ((pzm->flags & ZM_FLAG_CRC32) != 0);
-      crc         = bcrc32 ? 0xffffffff : 0;
-      pzm->flags &= ~ZM_FLAG_ATSIGN;
-
-      ptr         = pzm->scratch;
-      pktsize     = 0;
-
-#ifdef CONFIG_SYSTEM_ZMODEM_SNDFILEBUF
-      /* Read multiple bytes of file and store into the temporal buffer */
-
-      zm_read(pzms->infd, pzm->filebuf, CONFIG_SYSTEM_ZMODEM_SNDBUFSIZE);
-
-      i = 0;
-#endif
-
-      while (pktsize <= (CONFIG_SYSTEM_ZMODEM_SNDBUFSIZE - 10) &&
-             (pzms->offset < pzms->filesize))
-        {
-          /* Add the new value to the accumulated CRC */
-
-#ifdef CONFIG_SYSTEM_ZMODEM_SNDFILEBUF
-          uint8_t ch = pzm->filebuf[i++];
-#else
-          uint8_t ch = zm_getc(pzms->infd);
-#endif
-          if (!bcrc32)
-            {
-              crc = (uint32_t)crc16xmodempart(&ch, 1, (uint16_t)crc);
-            }
-          else
+          type = ZCRCG;
+          if (pzms->offset >= pzms->ackoffs)
             {
-              crc = crc32part(&ch, 1, crc);
+              type           = ZCRCQ;
+              pzms->ackoffs  = pzms->offset + ZMS_WINDOW / 2;
             }
-
-          /* Put the character into the buffer, escaping as necessary */
-
-          ptr = zm_putzdle(pzm, ptr, ch);
-
-          /* Recalculate the accumulated packet size to handle expansion due
-           * to escaping.
-           */
-
-          pktsize = (int32_t)(ptr - pzm->scratch);
-
-          /* And increment the file offset */
-
-          pzms->offset++;
         }
-
-#ifdef CONFIG_SYSTEM_ZMODEM_SNDFILEBUF
-      /* Restore file position to be read next time */
-
-      lseek(pzms->infd, pzms->offset, SEEK_SET);
-#endif
+      else
+        {
+          type = pzms->dpkttype;
+        }
 
       /* If we've reached file end, a ZEOF header will follow.  If there's
        * room in the outgoing buffer for it, end the packet with ZCRCE and
@@ -1079,7 +1122,7 @@ static int zms_sendpacket(FAR struct zm_state_s *pzm)
       /* Get the final packet size */
 
       pktsize = ptr - pzm->scratch;
-      DEBUGASSERT(pktsize < CONFIG_SYSTEM_ZMODEM_SNDBUFSIZE);
+      DEBUGASSERT(pktsize <= CONFIG_SYSTEM_ZMODEM_SNDBUFSIZE);
 
       /* And send the packet */
 
@@ -1140,12 +1183,51 @@ static int zms_sendpacket(FAR struct zm_state_s *pzm)
 #ifdef CONFIG_SYSTEM_ZMODEM_RCVSAMPLE
   while (pzm->state == ZMS_SENDING && !zm_rcvpending(pzm));
 #else
-  while (0);
+  while (pzm->state == ZMS_SENDING && ZMS_WINDOWED(pzms));
 #endif
 
   return OK;
 }
 
+/****************************************************************************
+ * Name: zms_sendack
+ *
+ * Description:
+ *   ZACK of a ZCRCQ subpacket received while streaming.  Update the last
+ *   known receiver offset and continue the stream.
+ *
+ ****************************************************************************/
+
+static int zms_sendack(FAR struct zm_state_s *pzm)
+{
+  FAR struct zms_state_s *pzms = (FAR struct zms_state_s *)pzm;
+  off_t offset;
+
+  offset = zm_bytobe32(pzm->hdrdata + 1);
+  if (offset > pzms->lastoffs)
+    {
+      pzms->lastoffs = offset;
+    }
+
+  zmdbg("ZMS_STATE %d: offset: %ld\n", pzm->state, (unsigned long)offset);
+  return zms_sendpacket(pzm);
+}
+
+/****************************************************************************
+ * Name: zms_sendto
+ *
+ * Description:
+ *   Timed out while streaming, maybe a ZACK was lost with the window full.
+ *   Send the next subpacket as ZCRCW to get the receiver offset back.
+ *
+ ****************************************************************************/
+
+static int zms_sendto(FAR struct zm_state_s *pzm)
+{
+  pzm->flags |= ZM_FLAG_WAIT;
+  return zms_sendpacket(pzm);
+}
+
 /****************************************************************************
  * Name: zms_filecrc
  *
@@ -1157,10 +1239,25 @@ static int zms_sendpacket(FAR struct zm_state_s *pzm)
 static int zms_filecrc(FAR struct zm_state_s *pzm)
 {
   FAR struct zms_state_s *pzms = (FAR struct zms_state_s *)pzm;
+  FAR const uint8_t *data;
+  ssize_t nread;
   uint8_t by[4];
   uint32_t crc;
+  off_t offset;
 
-  crc = zm_filecrc(pzm, pzms->filename);
+  /* Run the file through the read ahead, so that reading and the CRC
+   * calculation overlap.
+   */
+
+  crc = 0xffffffff;
+  for (offset = 0;
+       (nread = zm_rdget(&pzms->rdahead, offset, &data)) > 0;
+       offset += nread)
+    {
+      crc = crc32part(data, nread, crc);
+    }
+
+  crc = ~crc;
   zmdbg("ZMS_STATE %d: CRC %08x\n", pzm->state, crc);
 
   zm_be32toby(crc, by);
@@ -1219,25 +1316,11 @@ static int zms_sendwaitack(FAR struct zm_state_s *pzm)
 static int zms_sendnak(FAR struct zm_state_s *pzm)
 {
   FAR struct zms_state_s *pzms = (FAR struct zms_state_s *)pzm;
-  off_t offset;
 
-  /* Save the ZRPOS file offset */
+  /* Resume at the ZRPOS file offset, the read ahead follows */
 
   pzms->offset = pzms->zrpos;
 
-  /* TODO: What is the correct thing to do if lseek fails? Send ZEOF? */
-
-  offset = lseek(pzms->infd, pzms->offset, SEEK_SET);
-  if (offset == (off_t)-1)
-    {
-      int errorcode = errno;
-
-      zmdbg("ERROR: Failed to seek to %ld: %d\n",
-            (unsigned long)pzms->offset, errorcode);
-      DEBUGASSERT(errorcode > 0);
-      return -errorcode;
-    }
-
   zmdbg("ZMS_STATE %d: offset: %ld\n",
         pzm->state, (unsigned long)pzms->offset);
 
@@ -1410,7 +1493,6 @@ static int zms_error(FAR struct zm_state_s *pzm)
 
 static int zms_startfiledata(FAR struct zms_state_s *pzms)
 {
-  off_t offset;
   int ret;
 
   zmdbg("ZMS_STATE %d: offset %ld nerrors %d\n",
@@ -1424,19 +1506,11 @@ static int zms_startfiledata(FAR struct zms_state_s *pzms)
   pzms->zrpos      = zm_bytobe32(pzms->cmn.hdrdata + 1);
   pzms->offset     = pzms->zrpos;
   pzms->lastoffs   = pzms->zrpos;
+  pzms->ackoffs    = pzms->zrpos + ZMS_WINDOW / 2;
 
-  /* See to the requested file position */
-
-  offset = lseek(pzms->infd, pzms->offset, SEEK_SET);
-  if (offset == (off_t)-1)
-    {
-      int errorcode = errno;
-
-      zmdbg("ERROR: Failed to seek to %ld: %d\n",
-            (unsigned long)pzms->offset, errorcode);
-      DEBUGASSERT(errorcode > 0);
-      return -errorcode;
-    }
+  /* There is no need to seek, zm_rdget() restarts the read ahead at the
+   * requested file position.
+   */
 
   /* Paragraph 8.2: "The sender sends a ZDATA binary header (with file
    * position) followed by one or more data subpackets."
@@ -1497,8 +1571,9 @@ static int zms_sendfile(FAR struct zms_state_s *pzms,
       return -errorcode;
     }
 
-  /* Open the local file for reading */
+  /* Open the local file for reading and start reading it ahead */
 
+  zm_iostop(&pzms->rdahead);
   pzms->infd = open(filename, O_RDONLY);
   if (pzms->infd < 0)
     {
@@ -1508,6 +1583,14 @@ static int zms_sendfile(FAR struct zms_state_s *pzms,
       return -errorcode;
     }
 
+  ret = zm_rdstart(&pzms->rdahead, pzms->infd);
+  if (ret < 0)
+    {
+      close(pzms->infd);
+      pzms->infd = -1;
+      return ret;
+    }
+
   /* Initialize for the transfer */
 
   pzms->cmn.flags &= ~ZM_FLAG_EOF;
@@ -1737,6 +1820,7 @@ int zms_release(ZMSHANDLE handle)
 
   /* Make sure that the file is closed */
 
+  zm_iostop(&pzms->rdahead);
   if (pzms->infd)
     {
       close(pzms->infd);
@@ -362,7 +362,7 @@ int zm_writefile(int fd, FAR const uint8_t *buffer, size_t buflen, bool zcnl)
 
       /* Loop for each character in the buffer */
 
-      for (; buflen > 0 && ret == OK; buflen--)
+      for (; buflen > 0 && ret >= 0; buflen--)
         {
           /* Get the next character in the buffer */
 
@@ -379,7 +379,7 @@ int zm_writefile(int fd, FAR const uint8_t *buffer, size_t buflen, bool zcnl)
                   nbytes  = 0;
                 }
 
-              if (ret == OK)
+              if (ret >= 0)
                 {
                   /* Skip one char of \r\n? */
 
@@ -412,7 +412,7 @@ int zm_writefile(int fd, FAR const uint8_t *buffer, size_t buflen, bool zcnl)
 
       /* Write any trailing data that does not end with a newline */
 
-      if (ret == OK && nbytes > 0)
+      if (ret >= 0 && nbytes > 0)
         {
           ret = zm_write(fd, start, nbytes);
         }
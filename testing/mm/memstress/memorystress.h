@@ -0,0 +1,124 @@
+/****************************************************************************
+ * apps/testing/mm/memstress/memorystress.h
+ *
+ * SPDX-License-Identifier: Apache-2.0
+ *
+ * Licensed to the Apache Software Foundation (ASF) under one or more
+ * contributor license agreements.  See the NOTICE file distributed with
+ * this work for additional information regarding copyright ownership.  The
+ * ASF licenses this file to you under the Apache License, Version 2.0 (the
+ * "License"); you may not use this file except in compliance with the
+ * License.  You may obtain a copy of the License at
+ *
+ *   http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS, WITHOUT
+ * WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.  See the
+ * License for the specific language governing permissions and limitations
+ * under the License.
+ *
+ ****************************************************************************/
+
+#ifndef __APPS_TESTING_MM_MEMSTRESS_MEMORYSTRESS_H
+#define __APPS_TESTING_MM_MEMSTRESS_MEMORYSTRESS_H
+
+/****************************************************************************
+ * Included Files
+ ****************************************************************************/
+
+#include <nuttx/config.h>
+
+#include <pthread.h>
+#include <stdbool.h>
+#include <stddef.h>
+#include <stdint.h>
+#include <stdio.h>
+
+/****************************************************************************
+ * Pre-processor Definitions
+ ****************************************************************************/
+
+#define MEMSTRESS_PREFIX "MemoryStress:"
+
+/****************************************************************************
+ * Public Types
+ ****************************************************************************/
+
+/* Synthetic allocation size distributions used by the benchmark mode */
+
+enum memorystress_dist_e
+{
+  MEMORY_STRESS_DIST_UNIFORM = 0,  /* Uniform in [1, max_allocsize] */
+  MEMORY_STRESS_DIST_SMALL,        /* Log-uniform, biased to small sizes */
+  MEMORY_STRESS_DIST_BIMODAL       /* 90% small objects, 10% large ones */
+};
+
+struct memorystress_func_s
+{
+  void *(*malloc)(size_t size);
+  void *(*aligned_alloc)(size_t align, size_t nbytes);
+  void *(*realloc)(FAR void *ptr, size_t new_size);
+  void (*freefunc)(FAR void *ptr);
+};
+
+struct memorystress_global_s
+{
+  FAR struct memorystress_func_s func;
+  FAR pthread_t *threads;
+  size_t max_allocsize;
+  size_t nthreads;
+  size_t nodelen;
+  uint32_t sleep_us;
+  bool debug;
+
+  /* Benchmark mode */
+
+  FAR const char *replay;          /* Allocation trace to replay (-T) */
+  size_t benchops;                 /* Operations per thread (-b) */
+  uint32_t interval_ms;            /* Sampling interval (-i) */
+  enum memorystress_dist_e dist;   /* Synthetic size distribution (-D) */
+};
+
+/****************************************************************************
+ * Public Function Prototypes
+ ****************************************************************************/
+
+/****************************************************************************
+ * Name: memorystress_trace_start
+ *
+ * Description:
+ *   Install the recording hooks into the allocator function table.  Every
+ *   allocation and free issued through the table is recorded in the format
+ *   understood by the benchmark replay (-T).  Records are buffered per
+ *   thread and written when a buffer fills up and by
+ *   memorystress_trace_stop().
+ *
+ ****************************************************************************/
+
+int memorystress_trace_start(FAR struct memorystress_func_s *func,
+                             FAR const char *path);
+
+/****************************************************************************
+ * Name: memorystress_trace_stop
+ *
+ * Description:
+ *   Write out the records still buffered by the threads and close the
+ *   trace file.  Called once the threads issuing allocations are done.
+ *
+ ****************************************************************************/
+
+void memorystress_trace_stop(void);
+
+/****************************************************************************
+ * Name: memorystress_bench
+ *
+ * Description:
+ *   Run the allocator benchmark and print the results as CSV records on
+ *   stdout.  Returns zero on success.
+ *
+ ****************************************************************************/
+
+int memorystress_bench(FAR struct memorystress_global_s *global);
+
+#endif /* __APPS_TESTING_MM_MEMSTRESS_MEMORYSTRESS_H */
@@ -0,0 +1,1237 @@
+/****************************************************************************
+ * apps/testing/mm/memstress/memorystress_bench.c
+ *
+ * SPDX-License-Identifier: Apache-2.0
+ *
+ * Licensed to the Apache Software Foundation (ASF) under one or more
+ * contributor license agreements.  See the NOTICE file distributed with
+ * this work for additional information regarding copyright ownership.  The
+ * ASF licenses this file to you under the Apache License, Version 2.0 (the
+ * "License"); you may not use this file except in compliance with the
+ * License.  You may obtain a copy of the License at
+ *
+ *   http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS, WITHOUT
+ * WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.  See the
+ * License for the specific language governing permissions and limitations
+ * under the License.
+ *
+ ****************************************************************************/
+
+/****************************************************************************
+ * Included Files
+ ****************************************************************************/
+
+#include <nuttx/config.h>
+
+#include <ctype.h>
+#include <errno.h>
+#include <fcntl.h>
+#include <inttypes.h>
+#include <malloc.h>
+#include <pthread.h>
+#include <stdarg.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+#include <unistd.h>
+#include <sys/param.h>
+
+#include <nuttx/atomic.h>
+#include <nuttx/clock.h>
+
+#include "memorystress.h"
+
+/****************************************************************************
+ * Pre-processor Definitions
+ ****************************************************************************/
+
+/* Latency histogram with 8 linear sub-buckets per power of two, which keeps
+ * the percentile error below 12.5% without storing individual samples.
+ */
+
+#define BENCH_HIST_LINEAR   16
+#define BENCH_HIST_SUB      8
+#define BENCH_HIST_NBUCKETS (BENCH_HIST_LINEAR + 28 * BENCH_HIST_SUB)
+
+#define BENCH_DEFAULT_OPS   100000
+#define BENCH_TRACE_LINE    80
+#define BENCH_TRACE_BUFSIZE 2048
+
+/* Trace record types */
+
+#define BENCH_OP_MALLOC     'm'
+#define BENCH_OP_ALIGNED    'a'
+#define BENCH_OP_REALLOC    'r'
+#define BENCH_OP_FREE       'f'
+
+/****************************************************************************
+ * Private Types
+ ****************************************************************************/
+
+/* One decoded trace record.  Pointers from the recorded system are mapped
+ * to dense object ids when the trace is loaded.
+ */
+
+struct memorystress_traceop_s
+{
+  uint8_t op;
+  uint32_t id;
+  uint32_t size;
+  uint32_t align;
+};
+
+struct memorystress_trace_s
+{
+  FAR struct memorystress_traceop_s *ops;
+  size_t nops;
+  size_t nids;
+};
+
+/* A trace record as read from the file, before it is put in order */
+
+struct memorystress_rawop_s
+{
+  uint32_t seq;
+  uint8_t op;
+  uintptr_t ptr;
+  uintptr_t newptr;
+  size_t size;
+  size_t align;
+};
+
+/* Records of one thread not yet written to the trace file */
+
+struct memorystress_tracebuf_s
+{
+  FAR struct memorystress_tracebuf_s *next;
+  size_t len;
+  char data[BENCH_TRACE_BUFSIZE];
+};
+
+/* Pointer to object id map used while loading a trace */
+
+struct memorystress_idmap_s
+{
+  FAR uintptr_t *keys;
+  FAR uint32_t *ids;
+  size_t size;
+  size_t used;
+};
+
+struct memorystress_slot_s
+{
+  FAR void *buf;
+  size_t size;
+};
+
+struct memorystress_bench_s
+{
+  FAR struct memorystress_global_s *global;
+  FAR const struct memorystress_trace_s *trace;
+  FAR struct memorystress_slot_s *slots;
+  size_t nslots;
+  pthread_t thread;
+  uint32_t seed;
+  uint32_t malloc_hist[BENCH_HIST_NBUCKETS];
+  uint32_t free_hist[BENCH_HIST_NBUCKETS];
+  clock_t malloc_max;
+  clock_t free_max;
+  volatile size_t ops;
+  volatile size_t live;
+  size_t peak;
+  size_t failures;
+  volatile bool done;
+};
+
+/****************************************************************************
+ * Private Data
+ ****************************************************************************/
+
+static int g_trace = -1;
+static pthread_mutex_t g_trace_lock = PTHREAD_MUTEX_INITIALIZER;
+static pthread_key_t g_trace_key;
+static FAR struct memorystress_tracebuf_s *g_trace_bufs;
+static atomic_t g_trace_seq;
+static struct memorystress_func_s g_trace_next;
+
+/****************************************************************************
+ * Private Functions
+ ****************************************************************************/
+
+/****************************************************************************
+ * Name: trace_flush
+ *
+ * Description:
+ *   Write out the records buffered by one thread.  The caller holds
+ *   g_trace_lock.
+ *
+ ****************************************************************************/
+
+static void trace_flush(FAR struct memorystress_tracebuf_s *buf)
+{
+  if (buf->len > 0)
+    {
+      write(g_trace, buf->data, buf->len);
+      buf->len = 0;
+    }
+}
+
+/****************************************************************************
+ * Name: trace_record
+ *
+ * Description:
+ *   Append a record to the buffer of the calling thread.  Threads only
+ *   synchronize when a buffer is full, so the records carry a global
+ *   sequence number and are put back in order when the trace is loaded.
+ *
+ ****************************************************************************/
+
+static void trace_record(FAR const char *fmt, ...)
+{
+  FAR struct memorystress_tracebuf_s *buf;
+  va_list ap;
+  int len;
+
+  buf = pthread_getspecific(g_trace_key);
+  if (buf == NULL)
+    {
+      buf = malloc(sizeof(*buf));
+      if (buf == NULL)
+        {
+          return;
+        }
+
+      buf->len = 0;
+      pthread_setspecific(g_trace_key, buf);
+
+      pthread_mutex_lock(&g_trace_lock);
+      buf->next = g_trace_bufs;
+      g_trace_bufs = buf;
+      pthread_mutex_unlock(&g_trace_lock);
+    }
+
+  if (buf->len + BENCH_TRACE_LINE > BENCH_TRACE_BUFSIZE)
+    {
+      pthread_mutex_lock(&g_trace_lock);
+      trace_flush(buf);
+      pthread_mutex_unlock(&g_trace_lock);
+    }
+
+  len = snprintf(buf->data + buf->len, BENCH_TRACE_LINE, "%u ",
+                 (unsigned int)atomic_fetch_add(&g_trace_seq, 1));
+
+  va_start(ap, fmt);
+  len += vsnprintf(buf->data + buf->len + len, BENCH_TRACE_LINE - len,
+                   fmt, ap);
+  va_end(ap);
+
+  buf->len += MIN(len, BENCH_TRACE_LINE - 1);
+}
+
+/****************************************************************************
+ * Name: trace_malloc
+ ****************************************************************************/
+
+static FAR void *trace_malloc(size_t size)
+{
+  FAR void *ptr;
+
+  ptr = g_trace_next.malloc(size);
+  if (ptr != NULL)
+    {
+      trace_record("m %p %zu\n", ptr, size);
+    }
+
+  return ptr;
+}
+
+/****************************************************************************
+ * Name: trace_aligned_alloc
+ ****************************************************************************/
+
+static FAR void *trace_aligned_alloc(size_t align, size_t nbytes)
+{
+  FAR void *ptr;
+
+  ptr = g_trace_next.aligned_alloc(align, nbytes);
+  if (ptr != NULL)
+    {
+      trace_record("a %p %zu %zu\n", ptr, nbytes, align);
+    }
+
+  return ptr;
+}
+
+/****************************************************************************
+ * Name: trace_realloc
+ ****************************************************************************/
+
+static FAR void *trace_realloc(FAR void *ptr, size_t new_size)
+{
+  FAR void *newptr;
+
+  /* The old block may be reused by another thread before this record is
+   * numbered.  That race is rare and only makes the replay reallocate a
+   * different object.
+   */
+
+  newptr = g_trace_next.realloc(ptr, new_size);
+  if (newptr != NULL)
+    {
+      trace_record("r %p %p %zu\n", ptr, newptr, new_size);
+    }
+
+  return newptr;
+}
+
+/****************************************************************************
+ * Name: trace_free
+ ****************************************************************************/
+
+static void trace_free(FAR void *ptr)
+{
+  /* Record before the block can be handed out again, so that the free is
+   * numbered before the allocation that reuses its address.
+   */
+
+  if (ptr != NULL)
+    {
+      trace_record("f %p\n", ptr);
+    }
+
+  g_trace_next.freefunc(ptr);
+}
+
+/****************************************************************************
+ * Name: idmap_slot
+ ****************************************************************************/
+
+static size_t idmap_slot(FAR struct memorystress_idmap_s *map, uintptr_t key)
+{
+  size_t i = (key >> 3) * 2654435761u % map->size;
+
+  while (map->keys[i] != 0 && map->keys[i] != key)
+    {
+      i = (i + 1) % map->size;
+    }
+
+  return i;
+}
+
+/****************************************************************************
+ * Name: idmap_grow
+ ****************************************************************************/
+
+static int idmap_grow(FAR struct memorystress_idmap_s *map)
+{
+  struct memorystress_idmap_s newmap;
+  size_t i;
+  size_t j;
+
+  newmap.size = map->size ? map->size * 2 : 256;
+  newmap.used = map->used;
+  newmap.keys = calloc(newmap.size, sizeof(uintptr_t));
+  newmap.ids  = calloc(newmap.size, sizeof(uint32_t));
+  if (newmap.keys == NULL || newmap.ids == NULL)
+    {
+      free(newmap.keys);
+      free(newmap.ids);
+      return -ENOMEM;
+    }
+
+  for (i = 0; i < map->size; i++)
+    {
+      if (map->keys[i] != 0)
+        {
+          j = idmap_slot(&newmap, map->keys[i]);
+          newmap.keys[j] = map->keys[i];
+          newmap.ids[j]  = map->ids[i];
+        }
+    }
+
+  free(map->keys);
+  free(map->ids);
+  *map = newmap;
+  return 0;
+}
+
+/****************************************************************************
+ * Name: idmap_bind
+ *
+ * Description:
+ *   Bind a pointer to a fresh object id.  A pointer is only handed out
+ *   again after it was freed, so the latest binding always wins.
+ *
+ ****************************************************************************/
+
+static int idmap_bind(FAR struct memorystress_idmap_s *map, uintptr_t key,
+                      uint32_t id)
+{
+  size_t i;
+
+  if ((map->used + 1) * 2 > map->size && idmap_grow(map) < 0)
+    {
+      return -ENOMEM;
+    }
+
+  i = idmap_slot(map, key);
+  if (map->keys[i] == 0)
+    {
+      map->keys[i] = key;
+      map->used++;
+    }
+
+  map->ids[i] = id;
+  return 0;
+}
+
+/****************************************************************************
+ * Name: idmap_find
+ ****************************************************************************/
+
+static int idmap_find(FAR struct memorystress_idmap_s *map, uintptr_t key,
+                      FAR uint32_t *id)
+{
+  size_t i;
+
+  if (map->size == 0)
+    {
+      return -ENOENT;
+    }
+
+  i = idmap_slot(map, key);
+  if (map->keys[i] == 0)
+    {
+      return -ENOENT;
+    }
+
+  *id = map->ids[i];
+  return 0;
+}
+
+/****************************************************************************
+ * Name: trace_compare
+ ****************************************************************************/
+
+static int trace_compare(FAR const void *a, FAR const void *b)
+{
+  FAR const struct memorystress_rawop_s *x = a;
+  FAR const struct memorystress_rawop_s *y = b;
+
+  return x->seq < y->seq ? -1 : x->seq > y->seq;
+}
+
+/****************************************************************************
+ * Name: trace_read
+ *
+ * Description:
+ *   Read the records of a trace file and sort them by sequence number.
+ *   Records without one keep the order of the file.
+ *
+ ****************************************************************************/
+
+static int trace_read(FAR const char *path,
+                      FAR struct memorystress_rawop_s **raws,
+                      FAR size_t *nraws)
+{
+  FAR struct memorystress_rawop_s *raw;
+  char line[BENCH_TRACE_LINE];
+  FAR char *cursor;
+  FAR void *ptr;
+  FAR void *newptr;
+  size_t capacity = 0;
+  int ret = 0;
+  FAR FILE *fp;
+
+  fp = fopen(path, "r");
+  if (fp == NULL)
+    {
+      return -errno;
+    }
+
+  *raws = NULL;
+  *nraws = 0;
+
+  while (fgets(line, sizeof(line), fp) != NULL)
+    {
+      if (*nraws == capacity)
+        {
+          capacity = capacity ? capacity * 2 : 1024;
+          raw = realloc(*raws, capacity * sizeof(*raw));
+          if (raw == NULL)
+            {
+              ret = -ENOMEM;
+              break;
+            }
+
+          *raws = raw;
+        }
+
+      raw = &(*raws)[*nraws];
+      memset(raw, 0, sizeof(*raw));
+      raw->seq = *nraws;
+
+      cursor = line;
+      if (isdigit((unsigned char)*cursor))
+        {
+          raw->seq = strtoul(cursor, &cursor, 10);
+          while (*cursor == ' ')
+            {
+              cursor++;
+            }
+        }
+
+      raw->op = *cursor++;
+      ptr = NULL;
+      newptr = NULL;
+
+      switch (raw->op)
+        {
+          case BENCH_OP_MALLOC:
+          case BENCH_OP_ALIGNED:
+            if (sscanf(cursor, "%p %zu %zu", &ptr, &raw->size,
+                       &raw->align) < 2)
+              {
+                continue;
+              }
+            break;
+
+          case BENCH_OP_REALLOC:
+            if (sscanf(cursor, "%p %p %zu", &ptr, &newptr,
+                       &raw->size) != 3)
+              {
+                continue;
+              }
+            break;
+
+          case BENCH_OP_FREE:
+            if (sscanf(cursor, "%p", &ptr) != 1)
+              {
+                continue;
+              }
+            break;
+
+          default:
+            continue;
+        }
+
+      raw->ptr = (uintptr_t)ptr;
+      raw->newptr = (uintptr_t)newptr;
+      (*nraws)++;
+    }
+
+  fclose(fp);
+
+  if (ret < 0)
+    {
+      free(*raws);
+      *raws = NULL;
+      return ret;
+    }
+
+  qsort(*raws, *nraws, sizeof(**raws), trace_compare);
+  return 0;
+}
+
+/****************************************************************************
+ * Name: trace_load
+ ****************************************************************************/
+
+static int trace_load(FAR struct memorystress_trace_s *trace,
+                      FAR const char *path)
+{
+  FAR struct memorystress_rawop_s *raws;
+  FAR struct memorystress_rawop_s *raw;
+  struct memorystress_idmap_s map;
+  struct memorystress_traceop_s op;
+  size_t capacity = 0;
+  size_t nraws;
+  size_t i;
+  uint32_t id;
+  int ret;
+
+  ret = trace_read(path, &raws, &nraws);
+  if (ret < 0)
+    {
+      return ret;
+    }
+
+  memset(trace, 0, sizeof(*trace));
+  memset(&map, 0, sizeof(map));
+
+  for (i = 0; i < nraws; i++)
+    {
+      raw = &raws[i];
+      memset(&op, 0, sizeof(op));
+      op.op = raw->op;
+
+      switch (op.op)
+        {
+          case BENCH_OP_MALLOC:
+          case BENCH_OP_ALIGNED:
+            op.id = trace->nids++;
+            ret = idmap_bind(&map, raw->ptr, op.id);
+            op.size = raw->size;
+            op.align = raw->align;
+            break;
+
+          case BENCH_OP_REALLOC:
+
+            /* A realloc of an unknown (or NULL) pointer behaves like
+             * malloc for the replay.
+             */
+
+            if (idmap_find(&map, raw->ptr, &id) < 0)
+              {
+                id = trace->nids++;
+              }
+
+            op.id = id;
+            op.size = raw->size;
+            ret = idmap_bind(&map, raw->newptr, id);
+            break;
+
+          default:
+            if (idmap_find(&map, raw->ptr, &op.id) < 0)
+              {
+                continue;
+              }
+            break;
+        }
+
+      if (ret < 0)
+        {
+          break;
+        }
+
+      if (trace->nops == capacity)
+        {
+          FAR struct memorystress_traceop_s *ops;
+
+          capacity = capacity ? capacity * 2 : 1024;
+          ops = realloc(trace->ops, capacity * sizeof(*ops));
+          if (ops == NULL)
+            {
+              ret = -ENOMEM;
+              break;
+            }
+
+          trace->ops = ops;
+        }
+
+      trace->ops[trace->nops++] = op;
+    }
+
+  free(raws);
+  free(map.keys);
+  free(map.ids);
+
+  if (ret < 0)
+    {
+      free(trace->ops);
+      trace->ops = NULL;
+    }
+
+  return ret;
+}
+
+/****************************************************************************
+ * Name: bench_randnum
+ ****************************************************************************/
+
+static uint32_t bench_randnum(uint32_t max, FAR uint32_t *seed)
+{
+  uint32_t x = *seed;
+  x ^= x << 13;
+  x ^= x >> 17;
+  x ^= x << 5;
+  *seed = x;
+  return x % max;
+}
+
+/****************************************************************************
+ * Name: bench_size
+ ****************************************************************************/
+
+static size_t bench_size(FAR struct memorystress_bench_s *bench)
+{
+  size_t max = bench->global->max_allocsize;
+  uint32_t shift;
+  size_t size;
+
+  switch (bench->global->dist)
+    {
+      case MEMORY_STRESS_DIST_SMALL:
+        for (shift = 0; ((size_t)2 << shift) <= max; shift++);
+        shift = bench_randnum(shift + 1, &bench->seed);
+        size = ((size_t)1 << shift) + bench_randnum(1 << shift, &bench->seed);
+        return MIN(max, size);
+
+      case MEMORY_STRESS_DIST_BIMODAL:
+        if (bench_randnum(10, &bench->seed) != 0)
+          {
+            return 16 + bench_randnum(113, &bench->seed);
+          }
+
+        return max / 2 + bench_randnum(max / 2 + 1, &bench->seed);
+
+      default:
+        return 1 + bench_randnum(max, &bench->seed);
+    }
+}
+
+/****************************************************************************
+ * Name: hist_index
+ ****************************************************************************/
+
+static int hist_index(clock_t value)
+{
+  uint32_t v = value > UINT32_MAX ? UINT32_MAX : (uint32_t)value;
+  int msb;
+
+  if (v < BENCH_HIST_LINEAR)
+    {
+      return v;
+    }
+
+  msb = 31 - __builtin_clz(v);
+  return BENCH_HIST_LINEAR + (msb - 4) * BENCH_HIST_SUB +
+         ((v >> (msb - 3)) & (BENCH_HIST_SUB - 1));
+}
+
+/****************************************************************************
+ * Name: hist_upper
+ *
+ * Description:
+ *   Return the largest value that falls into the given bucket.
+ *
+ ****************************************************************************/
+
+static clock_t hist_upper(int index)
+{
+  int msb;
+  int sub;
+
+  if (index < BENCH_HIST_LINEAR)
+    {
+      return index;
+    }
+
+  msb = (index - BENCH_HIST_LINEAR) / BENCH_HIST_SUB + 4;
+  sub = (index - BENCH_HIST_LINEAR) % BENCH_HIST_SUB;
+  return ((clock_t)(BENCH_HIST_SUB + sub + 1) << (msb - 3)) - 1;
+}
+
+/****************************************************************************
+ * Name: hist_percentile
+ ****************************************************************************/
+
+static clock_t hist_percentile(FAR const uint32_t *hist, unsigned int pct,
+                               clock_t max)
+{
+  uint64_t total = 0;
+  uint64_t sum = 0;
+  int i;
+
+  for (i = 0; i < BENCH_HIST_NBUCKETS; i++)
+    {
+      total += hist[i];
+    }
+
+  if (total == 0)
+    {
+      return 0;
+    }
+
+  for (i = 0; i < BENCH_HIST_NBUCKETS; i++)
+    {
+      sum += hist[i];
+      if (sum * 100 >= total * pct)
+        {
+          break;
+        }
+    }
+
+  return hist_upper(i) < max ? hist_upper(i) : max;
+}
+
+/****************************************************************************
+ * Name: ticks_to_ns
+ ****************************************************************************/
+
+static uint64_t ticks_to_ns(clock_t ticks)
+{
+  struct timespec ts;
+
+  perf_convert(ticks, &ts);
+  return (uint64_t)ts.tv_sec * NSEC_PER_SEC + ts.tv_nsec;
+}
+
+/****************************************************************************
+ * Name: bench_record
+ ****************************************************************************/
+
+static void bench_record(FAR uint32_t *hist, FAR clock_t *max,
+                         clock_t start)
+{
+  clock_t elapsed = perf_gettime() - start;
+
+  hist[hist_index(elapsed)]++;
+  if (elapsed > *max)
+    {
+      *max = elapsed;
+    }
+}
+
+/****************************************************************************
+ * Name: bench_alloc
+ *
+ * Description:
+ *   Perform one timed allocation into a slot.  op is one of the trace
+ *   record types; a realloc of an empty slot behaves like malloc.
+ *
+ ****************************************************************************/
+
+static void bench_alloc(FAR struct memorystress_bench_s *bench,
+                        FAR struct memorystress_slot_s *slot, uint8_t op,
+                        size_t size, size_t align)
+{
+  FAR struct memorystress_func_s *func = &bench->global->func;
+  FAR void *ptr;
+  clock_t start;
+
+  start = perf_gettime();
+  switch (op)
+    {
+      case BENCH_OP_ALIGNED:
+        ptr = func->aligned_alloc(align, size);
+        break;
+
+      case BENCH_OP_REALLOC:
+        ptr = func->realloc(slot->buf, size);
+        break;
+
+      default:
+        ptr = func->malloc(size);
+        break;
+    }
+
+  bench_record(bench->malloc_hist, &bench->malloc_max, start);
+
+  if (ptr == NULL)
+    {
+      bench->failures++;
+      return;
+    }
+
+  /* Touch the block so that lazily mapped memory is accounted as well */
+
+  *(FAR volatile uint8_t *)ptr = 0;
+
+  bench->live = bench->live - (op == BENCH_OP_REALLOC ? slot->size : 0) +
+                size;
+  if (bench->live > bench->peak)
+    {
+      bench->peak = bench->live;
+    }
+
+  slot->buf = ptr;
+  slot->size = size;
+}
+
+/****************************************************************************
+ * Name: bench_free
+ ****************************************************************************/
+
+static void bench_free(FAR struct memorystress_bench_s *bench,
+                       FAR struct memorystress_slot_s *slot)
+{
+  clock_t start;
+
+  start = perf_gettime();
+  bench->global->func.freefunc(slot->buf);
+  bench_record(bench->free_hist, &bench->free_max, start);
+
+  bench->live -= slot->size;
+  slot->buf = NULL;
+  slot->size = 0;
+}
+
+/****************************************************************************
+ * Name: bench_synthetic
+ ****************************************************************************/
+
+static void bench_synthetic(FAR struct memorystress_bench_s *bench)
+{
+  FAR struct memorystress_slot_s *slot;
+  size_t i;
+
+  for (i = 0; i < bench->global->benchops; i++)
+    {
+      slot = &bench->slots[bench_randnum(bench->nslots, &bench->seed)];
+
+      /* Empty slots are filled, live ones are resized now and then and
+       * freed otherwise, so the heap settles around half occupancy.
+       */
+
+      if (slot->buf == NULL)
+        {
+          bench_alloc(bench, slot, BENCH_OP_MALLOC, bench_size(bench), 0);
+        }
+      else if (bench_randnum(8, &bench->seed) == 0)
+        {
+          bench_alloc(bench, slot, BENCH_OP_REALLOC, bench_size(bench), 0);
+        }
+      else
+        {
+          bench_free(bench, slot);
+        }
+
+      bench->ops++;
+    }
+}
+
+/****************************************************************************
+ * Name: bench_replay
+ ****************************************************************************/
+
+static void bench_replay(FAR struct memorystress_bench_s *bench)
+{
+  FAR const struct memorystress_traceop_s *op;
+  FAR struct memorystress_slot_s *slot;
+  size_t i;
+
+  for (i = 0; i < bench->trace->nops; i++)
+    {
+      op = &bench->trace->ops[i];
+      slot = &bench->slots[op->id];
+
+      if (op->op == BENCH_OP_FREE)
+        {
+          if (slot->buf != NULL)
+            {
+              bench_free(bench, slot);
+            }
+        }
+      else
+        {
+          /* A failed allocation earlier in the replay leaves the slot
+           * empty, release anything still bound to a reused id.
+           */
+
+          if (op->op != BENCH_OP_REALLOC && slot->buf != NULL)
+            {
+              bench_free(bench, slot);
+            }
+
+          bench_alloc(bench, slot, op->op, op->size, op->align);
+        }
+
+      bench->ops++;
+    }
+}
+
+/****************************************************************************
+ * Name: bench_thread
+ ****************************************************************************/
+
+static FAR void *bench_thread(FAR void *arg)
+{
+  FAR struct memorystress_bench_s *bench = arg;
+  size_t i;
+
+  if (bench->trace != NULL)
+    {
+      bench_replay(bench);
+    }
+  else
+    {
+      bench_synthetic(bench);
+    }
+
+  /* Release everything so that consecutive runs start from the same
+   * heap state; this is not part of the measurement.
+   */
+
+  for (i = 0; i < bench->nslots; i++)
+    {
+      bench->global->func.freefunc(bench->slots[i].buf);
+    }
+
+  bench->live = 0;
+  bench->done = true;
+  return NULL;
+}
+
+/****************************************************************************
+ * Name: bench_sample
+ ****************************************************************************/
+
+static void bench_sample(FAR struct memorystress_bench_s *benches,
+                         size_t nthreads, clock_t start,
+                         FAR size_t *peak_live, FAR size_t *peak_used,
+                         FAR unsigned int *frag)
+{
+  struct mallinfo info;
+  size_t live = 0;
+  size_t ops = 0;
+  size_t i;
+
+  for (i = 0; i < nthreads; i++)
+    {
+      live += benches[i].live;
+      ops  += benches[i].ops;
+    }
+
+  info = mallinfo();
+
+  *frag = info.fordblks > 0 ?
+          100 - (unsigned int)((uint64_t)info.mxordblk * 100 /
+                               info.fordblks) : 0;
+  if (live > *peak_live)
+    {
+      *peak_live = live;
+    }
+
+  if ((size_t)info.uordblks > *peak_used)
+    {
+      *peak_used = info.uordblks;
+    }
+
+  printf("sample,%" PRIu64 ",%zu,%zu,%d,%d,%d,%u\n",
+         ticks_to_ns(perf_gettime() - start) / 1000000, ops, live,
+         info.uordblks, info.fordblks, info.mxordblk, *frag);
+}
+
+/****************************************************************************
+ * Public Functions
+ ****************************************************************************/
+
+/****************************************************************************
+ * Name: memorystress_trace_start
+ ****************************************************************************/
+
+int memorystress_trace_start(FAR struct memorystress_func_s *func,
+                             FAR const char *path)
+{
+  int ret;
+
+  g_trace = open(path, O_WRONLY | O_CREAT | O_TRUNC, 0644);
+  if (g_trace < 0)
+    {
+      return -errno;
+    }
+
+  ret = pthread_key_create(&g_trace_key, NULL);
+  if (ret != 0)
+    {
+      close(g_trace);
+      g_trace = -1;
+      return -ret;
+    }
+
+  g_trace_next = *func;
+
+  func->malloc        = trace_malloc;
+  func->aligned_alloc = trace_aligned_alloc;
+  func->realloc       = trace_realloc;
+  func->freefunc      = trace_free;
+  return 0;
+}
+
+/****************************************************************************
+ * Name: memorystress_trace_stop
+ ****************************************************************************/
+
+void memorystress_trace_stop(void)
+{
+  FAR struct memorystress_tracebuf_s *buf;
+
+  if (g_trace < 0)
+    {
+      return;
+    }
+
+  pthread_mutex_lock(&g_trace_lock);
+  while ((buf = g_trace_bufs) != NULL)
+    {
+      g_trace_bufs = buf->next;
+      trace_flush(buf);
+      free(buf);
+    }
+
+  close(g_trace);
+  g_trace = -1;
+  pthread_mutex_unlock(&g_trace_lock);
+  pthread_key_delete(g_trace_key);
+}
+
+/****************************************************************************
+ * Name: memorystress_bench
+ ****************************************************************************/
+
+int memorystress_bench(FAR struct memorystress_global_s *global)
+{
+  FAR struct memorystress_bench_s *benches;
+  struct memorystress_trace_s trace;
+  uint32_t malloc_hist[BENCH_HIST_NBUCKETS];
+  uint32_t free_hist[BENCH_HIST_NBUCKETS];
+  clock_t malloc_max = 0;
+  clock_t free_max = 0;
+  size_t peak_live = 0;
+  size_t peak_used = 0;
+  size_t failures = 0;
+  size_t ops = 0;
+  uint64_t elapsed;
+  unsigned int frag = 0;
+  clock_t start;
+  bool done;
+  size_t i;
+  int j;
+  int ret = 0;
+
+  if (global->replay != NULL)
+    {
+      ret = trace_load(&trace, global->replay);
+      if (ret < 0 || trace.nops == 0)
+        {
+          fprintf(stderr, MEMSTRESS_PREFIX "Failed to load trace %s: %d\n",
+                  global->replay, ret);
+          return ret < 0 ? ret : -EINVAL;
+        }
+    }
+
+  if (global->benchops == 0)
+    {
+      global->benchops = BENCH_DEFAULT_OPS;
+    }
+
+  benches = calloc(global->nthreads, sizeof(*benches));
+  if (benches == NULL)
+    {
+      ret = -ENOMEM;
+      goto errout_with_trace;
+    }
+
+  for (i = 0; i < global->nthreads; i++)
+    {
+      benches[i].global = global;
+      benches[i].trace  = global->replay != NULL ? &trace : NULL;
+      benches[i].nslots = global->replay != NULL ? trace.nids :
+                                                   global->nodelen;
+      benches[i].seed   = 0x9e3779b9u * (i + 1);
+      benches[i].slots  = calloc(benches[i].nslots,
+                                 sizeof(struct memorystress_slot_s));
+      if (benches[i].slots == NULL)
+        {
+          ret = -ENOMEM;
+          goto errout_with_benches;
+        }
+    }
+
+  printf("# type,time_ms,ops,live_bytes,heap_used,heap_free,"
+         "largest_free,frag_pct\n");
+
+  start = perf_gettime();
+  for (i = 0; i < global->nthreads; i++)
+    {
+      if (pthread_create(&benches[i].thread, NULL, bench_thread,
+                         &benches[i]) != 0)
+        {
+          fprintf(stderr, MEMSTRESS_PREFIX "Failed to create thread\n");
+
+          /* Only the started threads are waited for and cleaned up */
+
+          while (global->nthreads > i)
+            {
+              free(benches[--global->nthreads].slots);
+            }
+
+          ret = -EAGAIN;
+          break;
+        }
+    }
+
+  /* Sample the heap while the workers run to track fragmentation */
+
+  do
+    {
+      usleep(global->interval_ms * 1000);
+
+      done = true;
+      for (i = 0; i < global->nthreads; i++)
+        {
+          done &= benches[i].done;
+        }
+
+      if (!done)
+        {
+          bench_sample(benches, global->nthreads, start, &peak_live,
+                       &peak_used, &frag);
+        }
+    }
+  while (!done);
+
+  for (i = 0; i < global->nthreads; i++)
+    {
+      pthread_join(benches[i].thread, NULL);
+    }
+
+  elapsed = ticks_to_ns(perf_gettime() - start);
+
+  memset(malloc_hist, 0, sizeof(malloc_hist));
+  memset(free_hist, 0, sizeof(free_hist));
+
+  for (i = 0; i < global->nthreads; i++)
+    {
+      for (j = 0; j < BENCH_HIST_NBUCKETS; j++)
+        {
+          malloc_hist[j] += benches[i].malloc_hist[j];
+          free_hist[j]   += benches[i].free_hist[j];
+        }
+
+      malloc_max = MAX(malloc_max, benches[i].malloc_max);
+      free_max   = MAX(free_max, benches[i].free_max);
+      failures  += benches[i].failures;
+      ops       += benches[i].ops;
+
+      /* Runs shorter than the sampling interval are never sampled */
+
+      peak_live  = MAX(peak_live, benches[i].peak);
+    }
+
+  printf("# summary,threads,ops,elapsed_ms,ops_per_sec,"
+         "malloc_p50_ns,malloc_p99_ns,malloc_max_ns,"
+         "free_p50_ns,free_p99_ns,free_max_ns,"
+         "peak_live_bytes,peak_heap_used,last_frag_pct,failures\n");
+  printf("summary,%zu,%zu,%" PRIu64 ",%" PRIu64 ",%" PRIu64 ",%" PRIu64
+         ",%" PRIu64 ",%" PRIu64 ",%" PRIu64 ",%" PRIu64 ",%zu,%zu,%u,%zu\n",
+         global->nthreads, ops, elapsed / 1000000,
+         elapsed > 0 ? (uint64_t)ops * NSEC_PER_SEC / elapsed : 0,
+         ticks_to_ns(hist_percentile(malloc_hist, 50, malloc_max)),
+         ticks_to_ns(hist_percentile(malloc_hist, 99, malloc_max)),
+         ticks_to_ns(malloc_max),
+         ticks_to_ns(hist_percentile(free_hist, 50, free_max)),
+         ticks_to_ns(hist_percentile(free_hist, 99, free_max)),
+         ticks_to_ns(free_max), peak_live, peak_used, frag, failures);
+
+errout_with_benches:
+  for (i = 0; i < global->nthreads; i++)
+    {
+      free(benches[i].slots);
+    }
+
+  free(benches);
+
+errout_with_trace:
+  if (global->replay != NULL)
+    {
+      free(trace.ops);
+    }
+
+  return ret;
+}
@@ -35,12 +35,14 @@
 #include <stdint.h>
 #include <stdbool.h>
 #include <assert.h>
+#include <signal.h>
+
+#include "memorystress.h"
 
 /****************************************************************************
  * Pre-processor Definitions
  ****************************************************************************/
 
-#define MEMSTRESS_PREFIX "MemoryStress:"
 #define DEBUG_MAGIC 0xaa
 
 #define OPTARG_TO_VALUE(value, type) \
@@ -65,14 +67,6 @@ enum memorystress_rwerror_e
   MEMORY_STRESS_WRITE_ERROR
 };
 
-struct memorystress_func_s
-{
-  void *(*malloc)(size_t size);
-  void *(*aligned_alloc)(size_t align, size_t nbytes);
-  void *(*realloc)(FAR void *ptr, size_t new_size);
-  void (*freefunc)(FAR void *ptr);
-};
-
 struct memorystress_error_s
 {
   FAR uint8_t *buf;
@@ -99,16 +93,11 @@ struct memorystress_thread_context_s
   struct memorystress_error_s error;
 };
 
-struct memorystress_global_s
-{
-  FAR struct memorystress_func_s func;
-  FAR pthread_t *threads;
-  size_t max_allocsize;
-  size_t nthreads;
-  size_t nodelen;
-  uint32_t sleep_us;
-  bool debug;
-};
+/****************************************************************************
+ * Private Data
+ ****************************************************************************/
+
+static volatile sig_atomic_t g_stop;
 
 /****************************************************************************
  * Private Functions
@@ -131,6 +120,13 @@ static void show_usage(FAR const char *progname)
   printf("  -x [nthreads] Enable multi-thread stress testing. \n");
   printf("  -d [debug mode] Helps to localize the problem situation,"
          "there is a lot of information output in this mode.\n");
+  printf("\nBenchmark mode (results as CSV on stdout):\n");
+  printf("  -b [ops] Run the allocator benchmark, ops per thread.\n");
+  printf("  -D [uniform|small|bimodal] Synthetic size distribution.\n");
+  printf("  -T [file] Replay an allocation trace instead.\n");
+  printf("  -i [ms] Heap sampling interval Default:100.\n");
+  printf("  -R [file] Record the allocations of the stress test"
+         " as a trace,\n            until SIGINT stops the test.\n");
   exit(EXIT_FAILURE);
 }
 
@@ -377,13 +373,24 @@ static FAR void *debug_realloc(FAR void *ptr, size_t new_size)
   return ptr;
 }
 
+/****************************************************************************
+ * Name: stop_handler
+ ****************************************************************************/
+
+static void stop_handler(int signo)
+{
+  g_stop = 1;
+}
+
 /****************************************************************************
  * Name: global_init
  ****************************************************************************/
 
-static void global_init(FAR struct memorystress_global_s *global, int argc,
+static bool global_init(FAR struct memorystress_global_s *global, int argc,
                         FAR char *argv[])
 {
+  FAR const char *record = NULL;
+  bool bench = false;
   int ch;
 
   memset(global, 0, sizeof(struct memorystress_global_s));
@@ -394,14 +401,43 @@ static void global_init(FAR struct memorystress_global_s *global, int argc,
   global->sleep_us = 100;
   global->max_allocsize = 8192;
   global->nodelen = 1024;
+  global->interval_ms = 100;
 
-  while ((ch = getopt(argc, argv, "dm:n:t:x::")) != ERROR)
+  while ((ch = getopt(argc, argv, "b:dD:i:m:n:R:t:T:x::")) != ERROR)
     {
       switch (ch)
         {
+          case 'b':
+            OPTARG_TO_VALUE(global->benchops, size_t);
+            bench = true;
+            break;
           case 'd':
             global->debug = true;
             break;
+          case 'D':
+            if (strcmp(optarg, "small") == 0)
+              {
+                global->dist = MEMORY_STRESS_DIST_SMALL;
+              }
+            else if (strcmp(optarg, "bimodal") == 0)
+              {
+                global->dist = MEMORY_STRESS_DIST_BIMODAL;
+              }
+            else if (strcmp(optarg, "uniform") != 0)
+              {
+                show_usage(argv[0]);
+              }
+            break;
+          case 'i':
+            OPTARG_TO_VALUE(global->interval_ms, uint32_t);
+            break;
+          case 'R':
+            record = optarg;
+            break;
+          case 'T':
+            global->replay = optarg;
+            bench = true;
+            break;
           case 'm':
             OPTARG_TO_VALUE(global->max_allocsize, size_t);
             break;
@@ -435,6 +471,25 @@ static void global_init(FAR struct memorystress_global_s *global, int argc,
         global->func.freefunc = free;
       }
 
+    if (global->interval_ms == 0)
+      {
+        global->interval_ms = 1;
+      }
+
+    if (record != NULL &&
+        memorystress_trace_start(&global->func, record) < 0)
+      {
+        syslog(LOG_ERR, MEMSTRESS_PREFIX "Open trace %s Failed\n", record);
+        exit(EXIT_FAILURE);
+      }
+
+    /* A recording ends with SIGINT, so that the trace is complete */
+
+    if (record != NULL)
+      {
+        signal(SIGINT, stop_handler);
+      }
+
     global->threads = (FAR pthread_t *)malloc(sizeof(pthread_t) *
                                               global->nthreads);
     if (global->threads == NULL)
@@ -450,6 +505,7 @@ static void global_init(FAR struct memorystress_global_s *global, int argc,
            global->nthreads, global->debug ? "true" : "false");
 
     srand(time(NULL));
+    return bench;
 }
 
 /****************************************************************************
@@ -480,7 +536,7 @@ FAR void *memorystress_thread(FAR void *arg)
 
   global = (FAR struct memorystress_global_s *)arg;
   thread_init(&context, global);
-  while (memorystress_iter(&context))
+  while (!g_stop && memorystress_iter(&context))
     {
       usleep(global->sleep_us);
     }
@@ -499,9 +555,16 @@ FAR void *memorystress_thread(FAR void *arg)
 int main(int argc, FAR char *argv[])
 {
   struct memorystress_global_s global;
+  int ret;
   int i;
 
-  global_init(&global, argc, argv);
+  if (global_init(&global, argc, argv))
+    {
+      ret = memorystress_bench(&global);
+      memorystress_trace_stop();
+      return ret < 0 ? EXIT_FAILURE : 0;
+    }
+
   syslog(LOG_INFO, MEMSTRESS_PREFIX "testing...\n");
   for (i = 0; i < global.nthreads; i++)
     {
@@ -518,5 +581,6 @@ int main(int argc, FAR char *argv[])
       pthread_join(global.threads[i], NULL);
     }
 
+  memorystress_trace_stop();
   return 0;
 }
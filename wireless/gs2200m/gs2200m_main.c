@@ -49,6 +49,8 @@
 #include <nuttx/wireless/wireless.h>
 #include <nuttx/wireless/gs2200m.h>
 
+#include "netutils/usrsockd.h"
+
 /****************************************************************************
  * Pre-processor Definitions
  ****************************************************************************/
@@ -64,6 +66,8 @@
 #define SOCKET_BASE  10000
 #define SOCKET_COUNT 16
 
+#define RXRING_SIZE  CONFIG_WIRELESS_GS2200M_RXRING_SIZE
+
 /****************************************************************************
  * Private Data Types
  ****************************************************************************/
@@ -83,6 +87,7 @@ struct usock_s
   enum sock_state_e state;
   uint16_t lport;           /* local port */
   struct sockaddr_in raddr; /* remote addr */
+  struct usrsockd_ring_s rxring; /* TCP data fetched from the driver */
 };
 
 struct gs2200m_s
@@ -94,119 +99,59 @@ struct gs2200m_s
   int     gsfd;
   int     usock_enable;
   struct usock_s sockets[SOCKET_COUNT];
-};
-
-union usrsock_request_u
-{
-  struct usrsock_request_socket_s       socket;
-  struct usrsock_request_close_s        close;
-  struct usrsock_request_connect_s      connect;
-  struct usrsock_request_sendto_s       sendto;
-  struct usrsock_request_recvfrom_s     recvfrom;
-  struct usrsock_request_setsockopt_s   setsockopt;
-  struct usrsock_request_getsockopt_s   getsockopt;
-  struct usrsock_request_getsockname_s  getsockname;
-  struct usrsock_request_getpeername_s  getpeername;
-  struct usrsock_request_bind_s         bind;
-  struct usrsock_request_listen_s       listen;
-  struct usrsock_request_accept_s       accept;
-  struct usrsock_request_ioctl_s        ioctl;
+  struct usrsockd_s ud;
 };
 
 /****************************************************************************
  * Private Function Prototypes
  ****************************************************************************/
 
-static int socket_request(int fd, FAR struct gs2200m_s *priv,
-                          FAR void *hdrbuf);
-static int close_request(int fd, FAR struct gs2200m_s *priv,
-                         FAR void *hdrbuf);
-static int connect_request(int fd, FAR struct gs2200m_s *priv,
-                           FAR void *hdrbuf);
-static int sendto_request(int fd, FAR struct gs2200m_s *priv,
-                          FAR void *hdrbuf);
-static int recvfrom_request(int fd, FAR struct gs2200m_s *priv,
-                            FAR void *hdrbuf);
-static int setsockopt_request(int fd, FAR struct gs2200m_s *priv,
-                              FAR void *hdrbuf);
-static int getsockopt_request(int fd, FAR struct gs2200m_s *priv,
-                              FAR void *hdrbuf);
-static int getsockname_request(int fd, FAR struct gs2200m_s *priv,
-                               FAR void *hdrbuf);
-static int getpeername_request(int fd, FAR struct gs2200m_s *priv,
-                               FAR void *hdrbuf);
-static int ioctl_request(int fd, FAR struct gs2200m_s *priv,
-                         FAR void *hdrbuf);
-static int bind_request(int fd, FAR struct gs2200m_s *priv,
-                        FAR void *hdrbuf);
-static int listen_request(int fd, FAR struct gs2200m_s *priv,
-                          FAR void *hdrbuf);
-static int accept_request(int fd, FAR struct gs2200m_s *priv,
-                          FAR void *hdrbuf);
+static int socket_request(FAR struct usrsockd_s *ud, FAR void *hdrbuf,
+                          FAR uint8_t *data, size_t datalen);
+static int close_request(FAR struct usrsockd_s *ud, FAR void *hdrbuf,
+                         FAR uint8_t *data, size_t datalen);
+static int connect_request(FAR struct usrsockd_s *ud, FAR void *hdrbuf,
+                           FAR uint8_t *data, size_t datalen);
+static int sendto_request(FAR struct usrsockd_s *ud, FAR void *hdrbuf,
+                          FAR uint8_t *data, size_t datalen);
+static int recvfrom_request(FAR struct usrsockd_s *ud, FAR void *hdrbuf,
+                            FAR uint8_t *data, size_t datalen);
+static int setsockopt_request(FAR struct usrsockd_s *ud, FAR void *hdrbuf,
+                              FAR uint8_t *data, size_t datalen);
+static int getsockopt_request(FAR struct usrsockd_s *ud, FAR void *hdrbuf,
+                              FAR uint8_t *data, size_t datalen);
+static int getsockname_request(FAR struct usrsockd_s *ud, FAR void *hdrbuf,
+                               FAR uint8_t *data, size_t datalen);
+static int getpeername_request(FAR struct usrsockd_s *ud, FAR void *hdrbuf,
+                               FAR uint8_t *data, size_t datalen);
+static int ioctl_request(FAR struct usrsockd_s *ud, FAR void *hdrbuf,
+                         FAR uint8_t *data, size_t datalen);
+static int bind_request(FAR struct usrsockd_s *ud, FAR void *hdrbuf,
+                        FAR uint8_t *data, size_t datalen);
+static int listen_request(FAR struct usrsockd_s *ud, FAR void *hdrbuf,
+                          FAR uint8_t *data, size_t datalen);
+static int accept_request(FAR struct usrsockd_s *ud, FAR void *hdrbuf,
+                          FAR uint8_t *data, size_t datalen);
 
 /****************************************************************************
  * Private Data
  ****************************************************************************/
 
-static const struct usrsock_req_handler_s
-{
-  uint32_t hdrlen;
-  int (CODE *fn)(int fd, FAR struct gs2200m_s *priv, FAR void *req);
-}
-handlers[USRSOCK_REQUEST__MAX] =
-{
-{
-  sizeof(struct usrsock_request_socket_s),
-  socket_request,
-},
-{
-  sizeof(struct usrsock_request_close_s),
-  close_request,
-},
-{
-  sizeof(struct usrsock_request_connect_s),
-  connect_request,
-},
-{
-  sizeof(struct usrsock_request_sendto_s),
-  sendto_request,
-},
-{
-  sizeof(struct usrsock_request_recvfrom_s),
-  recvfrom_request,
-},
-{
-  sizeof(struct usrsock_request_setsockopt_s),
-  setsockopt_request,
-},
-{
-  sizeof(struct usrsock_request_getsockopt_s),
-  getsockopt_request,
-},
-{
-  sizeof(struct usrsock_request_getsockname_s),
-  getsockname_request,
-},
+static const usrsockd_handler_t handlers[USRSOCK_REQUEST__MAX] =
 {
-  sizeof(struct usrsock_request_getpeername_s),
-  getpeername_request,
-},
-{
-  sizeof(struct usrsock_request_bind_s),
-  bind_request,
-},
-{
-  sizeof(struct usrsock_request_listen_s),
-  listen_request,
-},
-{
-  sizeof(struct usrsock_request_accept_s),
-  accept_request,
-},
-{
-  sizeof(struct usrsock_request_ioctl_s),
-  ioctl_request,
-},
+  [USRSOCK_REQUEST_SOCKET]      = socket_request,
+  [USRSOCK_REQUEST_CLOSE]       = close_request,
+  [USRSOCK_REQUEST_CONNECT]     = connect_request,
+  [USRSOCK_REQUEST_SENDTO]      = sendto_request,
+  [USRSOCK_REQUEST_RECVFROM]    = recvfrom_request,
+  [USRSOCK_REQUEST_SETSOCKOPT]  = setsockopt_request,
+  [USRSOCK_REQUEST_GETSOCKOPT]  = getsockopt_request,
+  [USRSOCK_REQUEST_GETSOCKNAME] = getsockname_request,
+  [USRSOCK_REQUEST_GETPEERNAME] = getpeername_request,
+  [USRSOCK_REQUEST_BIND]        = bind_request,
+  [USRSOCK_REQUEST_LISTEN]      = listen_request,
+  [USRSOCK_REQUEST_ACCEPT]      = accept_request,
+  [USRSOCK_REQUEST_IOCTL]       = ioctl_request,
 };
 
 static struct gs2200m_s *_daemon;
@@ -215,48 +160,6 @@ static struct gs2200m_s *_daemon;
  * Private Functions
  ****************************************************************************/
 
-/****************************************************************************
- * Name: _write_to_usock
- ****************************************************************************/
-
-static int _write_to_usock(int fd, void *buf, size_t count)
-{
-  ssize_t wlen;
-
-  wlen = write(fd, buf, count);
-
-  if (wlen < 0)
-    {
-      return -errno;
-    }
-
-  if (wlen != count)
-    {
-      return -ENOSPC;
-    }
-
-  return OK;
-}
-
-/****************************************************************************
- * Name: _send_ack_common
- ****************************************************************************/
-
-static int _send_ack_common(int fd,
-                            uint16_t events,
-                            uint32_t xid,
-                            FAR struct usrsock_message_req_ack_s *resp)
-{
-  resp->head.msgid  = USRSOCK_MESSAGE_RESPONSE_ACK;
-  resp->head.flags  = 0;
-  resp->head.events = events;
-  resp->xid = xid;
-
-  /* Send ACK response. */
-
-  return _write_to_usock(fd, resp, sizeof(*resp));
-}
-
 /****************************************************************************
  * Name: gs2200m_socket_alloc
  ****************************************************************************/
@@ -348,93 +251,20 @@ static int gs2200m_socket_free(FAR struct gs2200m_s *priv, int sockid)
 
   usock->state = CLOSED;
   usock->cid = 'z'; /* invalid */
+  usrsockd_ring_free(&usock->rxring);
 
   return 0;
 }
 
-/****************************************************************************
- * Name: read_req
- ****************************************************************************/
-
-static ssize_t
-read_req(int fd, FAR const struct usrsock_request_common_s *com_hdr,
-         FAR void *req, size_t reqsize)
-{
-  ssize_t rlen;
-
-  rlen = read(fd, (uint8_t *)req + sizeof(*com_hdr),
-              reqsize - sizeof(*com_hdr));
-
-  if (rlen < 0)
-    {
-      return -errno;
-    }
-
-  if (rlen + sizeof(*com_hdr) != reqsize)
-    {
-      return -EMSGSIZE;
-    }
-
-  return rlen;
-}
-
-/****************************************************************************
- * Name: usrsock_handle_request
- ****************************************************************************/
-
-static int usrsock_handle_request(int fd, FAR struct gs2200m_s *priv)
-{
-  FAR struct usrsock_request_common_s *com_hdr;
-  union usrsock_request_u req;
-  ssize_t rlen;
-
-  com_hdr = (FAR void *)&req;
-  rlen = read(fd, com_hdr, sizeof(*com_hdr));
-
-  if (rlen < 0)
-    {
-      return -errno;
-    }
-
-  if (rlen != sizeof(*com_hdr))
-    {
-      return -EMSGSIZE;
-    }
-
-  if (com_hdr->reqid >= USRSOCK_REQUEST__MAX ||
-      !handlers[com_hdr->reqid].fn)
-    {
-      ASSERT(false);
-      return -EIO;
-    }
-
-  assert(handlers[com_hdr->reqid].hdrlen <= sizeof(req));
-
-  rlen = read_req(fd, com_hdr, &req,
-                  handlers[com_hdr->reqid].hdrlen);
-
-  if (rlen < 0)
-    {
-      return rlen;
-    }
-
-  return handlers[com_hdr->reqid].fn(fd, priv, &req);
-}
-
 /****************************************************************************
  * Name: usock_send_event
  ****************************************************************************/
 
-static int usock_send_event(int fd, FAR struct gs2200m_s *priv,
+static int usock_send_event(FAR struct gs2200m_s *priv,
                             FAR struct usock_s *usock, int events)
 {
-  FAR struct usrsock_message_socket_event_s event;
   int i;
 
-  memset(&event, 0, sizeof(event));
-  event.head.flags = USRSOCK_MESSAGE_FLAG_EVENT;
-  event.head.msgid = USRSOCK_MESSAGE_SOCKET_EVENT;
-
   for (i = 0; i < SOCKET_COUNT; i++)
     {
       if (usock == &priv->sockets[i])
@@ -448,17 +278,14 @@ static int usock_send_event(int fd, FAR struct gs2200m_s *priv,
       return -EINVAL;
     }
 
-  event.usockid = i + SOCKET_BASE;
-  event.head.events = events;
-
-  return _write_to_usock(fd, &event, sizeof(event));
+  return usrsockd_event(&priv->ud, i + SOCKET_BASE, events);
 }
 
 /****************************************************************************
  * Name: usock_sendevent_toall
  ****************************************************************************/
 
-static void usock_sendevent_toall(FAR struct gs2200m_s *priv, int fd)
+static void usock_sendevent_toall(FAR struct gs2200m_s *priv)
 {
   int i;
 
@@ -466,7 +293,7 @@ static void usock_sendevent_toall(FAR struct gs2200m_s *priv, int fd)
     {
       if (priv->sockets[i].state != CLOSED)
         {
-          usock_send_event(fd, priv, &priv->sockets[i],
+          usock_send_event(priv, &priv->sockets[i],
                            USRSOCK_EVENT_RECVFROM_AVAIL);
         }
     }
@@ -476,11 +303,11 @@ static void usock_sendevent_toall(FAR struct gs2200m_s *priv, int fd)
  * Name: socket_request
  ****************************************************************************/
 
-static int socket_request(int fd, FAR struct gs2200m_s *priv,
-                          FAR void *hdrbuf)
+static int socket_request(FAR struct usrsockd_s *ud, FAR void *hdrbuf,
+                          FAR uint8_t *data, size_t datalen)
 {
   FAR struct usrsock_request_socket_s *req = hdrbuf;
-  struct usrsock_message_req_ack_s resp;
+  FAR struct gs2200m_s *priv = ud->priv;
   uint16_t events = 0;
   int16_t usockid;
   int ret;
@@ -514,14 +341,12 @@ static int socket_request(int fd, FAR struct gs2200m_s *priv,
 
   /* Send ACK response */
 
-  memset(&resp, 0, sizeof(resp));
-  resp.result = usockid;
   if (req->type == SOCK_DGRAM)
     {
       events = USRSOCK_EVENT_SENDTO_READY;
     }
 
-  ret = _send_ack_common(fd, events, req->head.xid, &resp);
+  ret = usrsockd_ack(ud, req->head.xid, usockid, events);
 
   if (0 > ret)
     {
@@ -536,11 +361,11 @@ static int socket_request(int fd, FAR struct gs2200m_s *priv,
  * Name: close_request
  ****************************************************************************/
 
-static int close_request(int fd, FAR struct gs2200m_s *priv,
-                         FAR void *hdrbuf)
+static int close_request(FAR struct usrsockd_s *ud, FAR void *hdrbuf,
+                         FAR uint8_t *data, size_t datalen)
 {
   FAR struct usrsock_request_close_s *req = hdrbuf;
-  struct usrsock_message_req_ack_s resp;
+  FAR struct gs2200m_s *priv = ud->priv;
   struct gs2200m_close_msg clmsg;
   FAR struct usock_s *usock;
   char cid;
@@ -568,9 +393,7 @@ errout:
 
   /* Send ACK response */
 
-  memset(&resp, 0, sizeof(resp));
-  resp.result = ret;
-  ret = _send_ack_common(fd, 0, req->head.xid, &resp);
+  ret = usrsockd_ack(ud, req->head.xid, ret, 0);
 
   if (0 > ret)
     {
@@ -590,17 +413,16 @@ errout:
  * Name: connect_request
  ****************************************************************************/
 
-static int connect_request(int fd, FAR struct gs2200m_s *priv,
-                           FAR void *hdrbuf)
+static int connect_request(FAR struct usrsockd_s *ud, FAR void *hdrbuf,
+                           FAR uint8_t *data, size_t datalen)
 {
   FAR struct usrsock_request_connect_s *req = hdrbuf;
-  struct usrsock_message_req_ack_s resp;
+  FAR struct gs2200m_s *priv = ud->priv;
   struct gs2200m_connect_msg cmsg;
   struct sockaddr_in addr;
   FAR struct usock_s *usock;
   int events;
   ssize_t wlen;
-  ssize_t rlen;
   int ret = 0;
 
   DEBUGASSERT(priv);
@@ -663,16 +485,17 @@ static int connect_request(int fd, FAR struct gs2200m_s *priv,
       goto prepare;
     }
 
-  /* Read address. */
-
-  rlen = read(fd, &addr, sizeof(addr));
+  /* Take the address from the request. */
 
-  if (rlen < 0 || rlen < req->addrlen)
+  if (datalen < req->addrlen)
     {
       ret = -EFAULT;
       goto prepare;
     }
 
+  memset(&addr, 0, sizeof(addr));
+  memcpy(&addr, data, req->addrlen);
+
   /* Check address family. */
 
   if (addr.sin_family != AF_INET)
@@ -707,9 +530,7 @@ prepare:
 
   /* Send ACK response. */
 
-  memset(&resp, 0, sizeof(resp));
-  resp.result = ret;
-  ret = _send_ack_common(fd, 0, req->head.xid, &resp);
+  ret = usrsockd_ack(ud, req->head.xid, ret, 0);
 
   if (0 > ret)
     {
@@ -717,7 +538,7 @@ prepare:
     }
 
   events = USRSOCK_EVENT_SENDTO_READY;
-  wlen   = usock_send_event(fd, priv, usock, events);
+  wlen   = usock_send_event(priv, usock, events);
 
   if (wlen < 0)
     {
@@ -732,16 +553,14 @@ prepare:
  * Name: sendto_request
  ****************************************************************************/
 
-static int sendto_request(int fd, FAR struct gs2200m_s *priv,
-                          FAR void *hdrbuf)
+static int sendto_request(FAR struct usrsockd_s *ud, FAR void *hdrbuf,
+                          FAR uint8_t *data, size_t datalen)
 {
   FAR struct usrsock_request_sendto_s *req = hdrbuf;
-  struct usrsock_message_req_ack_s resp;
+  FAR struct gs2200m_s *priv = ud->priv;
   struct gs2200m_send_msg smsg;
   FAR struct usock_s *usock;
-  uint8_t *sendbuf = NULL;
   ssize_t wlen;
-  ssize_t rlen;
   int nret;
   int ret = 0;
 
@@ -795,15 +614,16 @@ static int sendto_request(int fd, FAR struct gs2200m_s *priv,
               goto prepare;
             }
 
-          /* In UDP case, read the address. */
-
-          rlen = read(fd, &smsg.addr, sizeof(smsg.addr));
+          /* In UDP case, take the address from the request. */
 
-          if (rlen < 0 || rlen < req->addrlen)
+          if (req->addrlen > sizeof(smsg.addr) ||
+              datalen < req->addrlen)
             {
               ret = -EFAULT;
               goto prepare;
             }
+
+          memcpy(&smsg.addr, data, req->addrlen);
         }
       else if (CONNECTED == usock->state)
         {
@@ -826,21 +646,16 @@ static int sendto_request(int fd, FAR struct gs2200m_s *priv,
 
   if (req->buflen > 0)
     {
-      sendbuf = calloc(1, req->buflen);
-      ASSERT(sendbuf);
-
-      /* Read data from usrsock. */
-
-      rlen = read(fd, sendbuf, req->buflen);
-
-      if (rlen < 0 || rlen < req->buflen)
+      if (datalen < req->addrlen + req->buflen)
         {
           ret = -EFAULT;
           goto prepare;
         }
 
+      /* Hand the data to the driver straight from the request buffer. */
+
       smsg.cid = usock->cid;
-      smsg.buf = sendbuf;
+      smsg.buf = data + req->addrlen;
       smsg.len = req->buflen;
 
       nret = ioctl(priv->gsfd, GS2200M_IOC_SEND,
@@ -866,16 +681,10 @@ static int sendto_request(int fd, FAR struct gs2200m_s *priv,
     }
 
 prepare:
-  if (sendbuf)
-    {
-      free(sendbuf);
-    }
 
   /* Send ACK response. */
 
-  memset(&resp, 0, sizeof(resp));
-  resp.result = ret;
-  ret = _send_ack_common(fd, 0, req->head.xid, &resp);
+  ret = usrsockd_ack(ud, req->head.xid, ret, 0);
 
   if (0 > ret)
     {
@@ -884,7 +693,7 @@ prepare:
 
   /* Let kernel-side know that there is space for more send data. */
 
-  wlen = usock_send_event(fd, priv, usock,
+  wlen = usock_send_event(priv, usock,
                           USRSOCK_EVENT_SENDTO_READY);
 
   if (wlen < 0)
@@ -901,14 +710,16 @@ prepare:
  * Name: recvfrom_request
  ****************************************************************************/
 
-static int recvfrom_request(int fd, FAR struct gs2200m_s *priv,
-                            FAR void *hdrbuf)
+static int recvfrom_request(FAR struct usrsockd_s *ud, FAR void *hdrbuf,
+                            FAR uint8_t *data, size_t datalen)
 {
   FAR struct usrsock_request_recvfrom_s *req = hdrbuf;
-  struct usrsock_message_datareq_ack_s resp;
-  struct usrsock_message_req_ack_s resp1;
+  FAR struct gs2200m_s *priv = ud->priv;
   struct gs2200m_recv_msg rmsg;
   FAR struct usock_s *usock;
+  struct iovec iov[2];
+  size_t room;
+  int iovcnt = 0;
   int ret = 0;
 
   DEBUGASSERT(priv);
@@ -938,30 +749,71 @@ static int recvfrom_request(int fd, FAR struct gs2200m_s *priv,
     }
 
   rmsg.cid = usock->cid;
-  rmsg.reqlen = req->max_buflen;
   rmsg.is_tcp = (usock->type == SOCK_STREAM) ? true : false;
   rmsg.flags = req->flags;
 
-  if (0 < req->max_buflen)
+  if (rmsg.is_tcp && 0 < req->max_buflen)
+    {
+      /* TCP data is fetched into the socket's receive ring, in one piece
+       * as large as the ring once it has been drained, and answered from
+       * there in place.  Small reads then no longer cost a driver call
+       * each.
+       */
+
+      if (!usock->rxring.buf &&
+          usrsockd_ring_init(&usock->rxring, RXRING_SIZE) < 0)
+        {
+          ret = -ENOMEM;
+          goto prepare;
+        }
+
+      if (0 == usrsockd_ring_used(&usock->rxring))
+        {
+          rmsg.buf    = usrsockd_ring_space(&usock->rxring, &room);
+          rmsg.reqlen = room;
+          rmsg.flags &= ~MSG_PEEK; /* The ring keeps what is peeked at */
+
+          ret = ioctl(priv->gsfd, GS2200M_IOC_RECV,
+                      (unsigned long)&rmsg);
+          if (0 != ret)
+            {
+              ret = -errno;
+              goto prepare;
+            }
+
+          usrsockd_ring_commit(&usock->rxring, rmsg.len);
+        }
+
+      ret       = MIN(usrsockd_ring_used(&usock->rxring), req->max_buflen);
+      iovcnt    = usrsockd_ring_peek(&usock->rxring, ret, iov);
+      rmsg.addr = usock->raddr;
+
+      if (!(req->flags & MSG_PEEK))
+        {
+          usrsockd_ring_consume(&usock->rxring, ret);
+        }
+    }
+  else if (0 < req->max_buflen)
     {
+      rmsg.reqlen = req->max_buflen;
       rmsg.buf = calloc(1, req->max_buflen);
       ASSERT(rmsg.buf);
 
       ret = ioctl(priv->gsfd, GS2200M_IOC_RECV,
                   (unsigned long)&rmsg);
-    }
 
-  if (0 == ret)
-    {
-      ret = rmsg.len;
-    }
-  else
-    {
-      ret = -errno;
-    }
+      if (0 == ret)
+        {
+          ret = rmsg.len;
+          iov[0].iov_base = rmsg.buf;
+          iov[0].iov_len  = rmsg.len;
+          iovcnt = 1;
+        }
+      else
+        {
+          ret = -errno;
+        }
 
-  if (!rmsg.is_tcp)
-    {
       gs2200m_printf("%s: from (%s:%d)\n",
                      __func__,
                      inet_ntoa(rmsg.addr.sin_addr),
@@ -970,75 +822,58 @@ static int recvfrom_request(int fd, FAR struct gs2200m_s *priv,
 
 prepare:
 
-  /* Prepare response. */
-
-  memset(&resp, 0, sizeof(resp));
-  resp.reqack.result = ret;
-  resp.reqack.xid = req->head.xid;
-  resp.reqack.head.msgid  = USRSOCK_MESSAGE_RESPONSE_DATA_ACK;
-  resp.reqack.head.flags  = 0;
-  resp.reqack.head.events = 0;
-
-  if (0 <= ret)
+  if (0 <= ret && (0 == rmsg.len) && (0 != rmsg.reqlen))
     {
-      resp.valuelen_nontrunc = sizeof(rmsg.addr);
-      resp.valuelen = MIN(resp.valuelen_nontrunc,
-                          req->max_addrlen);
-
-      if ((0 == rmsg.len) && (0 != rmsg.reqlen))
-        {
-          usock_send_event(fd, priv, usock,
-                           USRSOCK_EVENT_REMOTE_CLOSED
-                           );
+      usock_send_event(priv, usock, USRSOCK_EVENT_REMOTE_CLOSED);
 
-          /* Send ack only */
+      /* Send ack only */
 
-          memset(&resp1, 0, sizeof(resp1));
-          resp1.result = ret;
-          ret = _send_ack_common(fd, 0, req->head.xid, &resp1);
-
-          goto err_out;
-        }
+      ret = usrsockd_ack(ud, req->head.xid, ret, 0);
+      goto err_out;
     }
 
-  /* Send response. */
-
-  ret = _write_to_usock(fd, &resp, sizeof(resp));
+  /* Send response, the data follows straight from the ring or the
+   * receive buffer.
+   */
 
-  if (0 > ret)
+  if (0 <= ret)
     {
-      goto err_out;
+      ret = usrsockd_dataack(ud, req->head.xid, ret, 0,
+                             &rmsg.addr,
+                             MIN(sizeof(rmsg.addr), req->max_addrlen),
+                             sizeof(rmsg.addr), iov, iovcnt);
     }
-
-  if (0 < resp.valuelen)
+  else
     {
-      /* Send address (value) */
-
-      ret = _write_to_usock(fd, &rmsg.addr, resp.valuelen);
-
-      if (0 > ret)
-        {
-          goto err_out;
-        }
+      ret = usrsockd_dataack(ud, req->head.xid, ret, 0, NULL, 0, 0,
+                             NULL, 0);
     }
 
-  if (resp.reqack.result > 0)
+  if (0 > ret)
     {
-      /* Send buffer */
+      goto err_out;
+    }
 
-      ret = _write_to_usock(fd, rmsg.buf, resp.reqack.result);
+  /* Data left over in the ring makes for another recvfrom */
 
-      if (0 > ret)
-        {
-          goto err_out;
-        }
+  if (usock && usock->rxring.buf &&
+      0 < usrsockd_ring_used(&usock->rxring))
+    {
+      ret = usock_send_event(priv, usock, USRSOCK_EVENT_RECVFROM_AVAIL);
     }
 
 err_out:
   gs2200m_printf("%s: *** end ret=%d\n", __func__, ret);
 
-  if (rmsg.buf)
+  if (rmsg.buf && !rmsg.is_tcp)
     {
+      /* The response refers to the buffer, send it before freeing. */
+
+      if (0 <= ret)
+        {
+          ret = usrsockd_flush(ud);
+        }
+
       free(rmsg.buf);
     }
 
@@ -1049,15 +884,14 @@ err_out:
  * Name: bind_request
  ****************************************************************************/
 
-static int bind_request(int fd, FAR struct gs2200m_s *priv,
-                        FAR void *hdrbuf)
+static int bind_request(FAR struct usrsockd_s *ud, FAR void *hdrbuf,
+                        FAR uint8_t *data, size_t datalen)
 {
   FAR struct usrsock_request_bind_s *req = hdrbuf;
-  struct usrsock_message_req_ack_s resp;
+  FAR struct gs2200m_s *priv = ud->priv;
   struct gs2200m_bind_msg bmsg;
   FAR struct usock_s *usock;
   struct sockaddr_in addr;
-  ssize_t rlen;
   int ret = 0;
 
   DEBUGASSERT(priv);
@@ -1082,16 +916,17 @@ static int bind_request(int fd, FAR struct gs2200m_s *priv,
       goto prepare;
     }
 
-  /* Read address. */
+  /* Take the address from the request. */
 
-  rlen = read(fd, &addr, sizeof(addr));
-
-  if (rlen < 0 || rlen < req->addrlen)
+  if (datalen < req->addrlen)
     {
       ret = -EFAULT;
       goto prepare;
     }
 
+  memset(&addr, 0, sizeof(addr));
+  memcpy(&addr, data, req->addrlen);
+
   /* Check address family. */
 
   if (addr.sin_family != AF_INET)
@@ -1117,9 +952,7 @@ prepare:
 
   /* Send ACK response. */
 
-  memset(&resp, 0, sizeof(resp));
-  resp.result = ret;
-  ret = _send_ack_common(fd, 0, req->head.xid, &resp);
+  ret = usrsockd_ack(ud, req->head.xid, ret, 0);
 
   if (0 > ret)
     {
@@ -1134,11 +967,11 @@ prepare:
  * Name: listen_request
  ****************************************************************************/
 
-static int listen_request(int fd, FAR struct gs2200m_s *priv,
-                          FAR void *hdrbuf)
+static int listen_request(FAR struct usrsockd_s *ud, FAR void *hdrbuf,
+                          FAR uint8_t *data, size_t datalen)
 {
   FAR struct usrsock_request_listen_s *req = hdrbuf;
-  struct usrsock_message_req_ack_s resp;
+  FAR struct gs2200m_s *priv = ud->priv;
   FAR struct usock_s *usock;
   int ret = 0;
 
@@ -1158,9 +991,7 @@ static int listen_request(int fd, FAR struct gs2200m_s *priv,
 
   /* Send ACK response. */
 
-  memset(&resp, 0, sizeof(resp));
-  resp.result = ret;
-  ret = _send_ack_common(fd, 0, req->head.xid, &resp);
+  ret = usrsockd_ack(ud, req->head.xid, ret, 0);
 
   if (0 > ret)
     {
@@ -1175,12 +1006,13 @@ static int listen_request(int fd, FAR struct gs2200m_s *priv,
  * Name: accept_request
  ****************************************************************************/
 
-static int accept_request(int fd, FAR struct gs2200m_s *priv,
-                          FAR void *hdrbuf)
+static int accept_request(FAR struct usrsockd_s *ud, FAR void *hdrbuf,
+                          FAR uint8_t *data, size_t datalen)
 {
   FAR struct usrsock_request_accept_s *req = hdrbuf;
-  struct usrsock_message_datareq_ack_s resp;
+  FAR struct gs2200m_s *priv = ud->priv;
   struct gs2200m_accept_msg amsg;
+  struct iovec iov;
   FAR struct usock_s *usock;
   FAR struct usock_s *new_usock = NULL;
   int ret = 0;
@@ -1227,49 +1059,27 @@ static int accept_request(int fd, FAR struct gs2200m_s *priv,
 
 prepare:
 
-  /* Prepare response. */
-
-  memset(&resp, 0, sizeof(resp));
-  resp.reqack.xid = req->head.xid;
-  resp.reqack.head.msgid  = USRSOCK_MESSAGE_RESPONSE_DATA_ACK;
-  resp.reqack.head.flags  = 0;
-  resp.reqack.head.events = 0;
+  /* Send response: the address as value, the new usockid as data. */
 
   if (0 == ret)
     {
-      resp.reqack.result = 2; /* new_usock->raddr + usock */
-      resp.valuelen_nontrunc = sizeof(new_usock->raddr);
-      resp.valuelen = resp.valuelen_nontrunc;
-    }
-  else
-    {
-      resp.reqack.result = ret;
-      resp.valuelen = 0;
-    }
-
-  /* Send response. */
-
-  ret = _write_to_usock(fd, &resp, sizeof(resp));
+      iov.iov_base = &usockid;
+      iov.iov_len  = sizeof(usockid);
 
-  if (0 > ret)
-    {
-      goto err_out;
-    }
-
-  if (resp.valuelen > 0)
-    {
-      /* Send address (value) */
-
-      ret = _write_to_usock(fd, &new_usock->raddr, resp.valuelen);
+      ret = usrsockd_dataack(ud, req->head.xid,
+                             2, /* new_usock->raddr + usock */
+                             0, &new_usock->raddr,
+                             sizeof(new_usock->raddr),
+                             sizeof(new_usock->raddr), &iov, 1);
 
       if (0 > ret)
         {
           goto err_out;
         }
 
-      /* Send new usockid info */
+      /* The response refers to usockid on the stack */
 
-      ret = _write_to_usock(fd, &usockid, sizeof(usockid));
+      ret = usrsockd_flush(ud);
 
       if (0 > ret)
         {
@@ -1278,9 +1088,14 @@ prepare:
 
       /* Set events ofr new_usock */
 
-      usock_send_event(fd, priv, new_usock,
-                       USRSOCK_EVENT_SENDTO_READY
-                       );
+      ret = usock_send_event(priv, new_usock,
+                             USRSOCK_EVENT_SENDTO_READY
+                             );
+    }
+  else
+    {
+      ret = usrsockd_dataack(ud, req->head.xid, ret, 0, NULL, 0, 0,
+                             NULL, 0);
     }
 
 err_out:
@@ -1292,13 +1107,12 @@ err_out:
  * Name: setsockopt_request
  ****************************************************************************/
 
-static int setsockopt_request(int fd, FAR struct gs2200m_s *priv,
-                              FAR void *hdrbuf)
+static int setsockopt_request(FAR struct usrsockd_s *ud, FAR void *hdrbuf,
+                              FAR uint8_t *data, size_t datalen)
 {
   FAR struct usrsock_request_setsockopt_s *req = hdrbuf;
-  struct usrsock_message_req_ack_s resp;
+  FAR struct gs2200m_s *priv = ud->priv;
   FAR struct usock_s *usock;
-  ssize_t rlen;
   int ret = 0;
   int value;
 
@@ -1339,16 +1153,16 @@ static int setsockopt_request(int fd, FAR struct gs2200m_s *priv,
       goto prepare;
     }
 
-  /* Read value. */
-
-  rlen = read(fd, &value, sizeof(value));
+  /* Take the value from the request. */
 
-  if (rlen < 0 || rlen < sizeof(value))
+  if (datalen < sizeof(value))
     {
       ret = -EFAULT;
       goto prepare;
     }
 
+  memcpy(&value, data, sizeof(value));
+
   /* Debug print */
 
   gs2200m_printf("setsockopt: option=%d value=%d\n",
@@ -1360,10 +1174,7 @@ prepare:
 
   /* Send ACK response */
 
-  memset(&resp, 0, sizeof(resp));
-  resp.result = ret;
-
-  ret = _send_ack_common(fd, 0, req->head.xid, &resp);
+  ret = usrsockd_ack(ud, req->head.xid, ret, 0);
 
   gs2200m_printf("%s: end (ret=%d)\n", __func__, ret);
   return ret;
@@ -1373,8 +1184,8 @@ prepare:
  * Name: getsockopt_request
  ****************************************************************************/
 
-static int getsockopt_request(int fd, FAR struct gs2200m_s *priv,
-                              FAR void *hdrbuf)
+static int getsockopt_request(FAR struct usrsockd_s *ud, FAR void *hdrbuf,
+                              FAR uint8_t *data, size_t datalen)
 {
   DEBUGASSERT(false);
   return -ENOSYS;
@@ -1384,11 +1195,11 @@ static int getsockopt_request(int fd, FAR struct gs2200m_s *priv,
  * Name: getsockname_request
  ****************************************************************************/
 
-static int getsockname_request(int fd, FAR struct gs2200m_s *priv,
-                               FAR void *hdrbuf)
+static int getsockname_request(FAR struct usrsockd_s *ud, FAR void *hdrbuf,
+                               FAR uint8_t *data, size_t datalen)
 {
   FAR struct usrsock_request_getsockname_s *req = hdrbuf;
-  struct usrsock_message_datareq_ack_s resp;
+  FAR struct gs2200m_s *priv = ud->priv;
   struct gs2200m_name_msg nmsg;
   FAR struct usock_s *usock;
   int ret = 0;
@@ -1416,53 +1227,20 @@ static int getsockname_request(int fd, FAR struct gs2200m_s *priv,
 
 prepare:
 
-  /* Prepare response. */
-
-  memset(&resp, 0, sizeof(resp));
-  resp.reqack.xid = req->head.xid;
-  resp.reqack.head.msgid  = USRSOCK_MESSAGE_RESPONSE_DATA_ACK;
-  resp.reqack.head.flags  = 0;
-  resp.reqack.head.events = 0;
-  resp.reqack.result = ret;
+  /* Send response with the address as value. */
 
   if (0 == ret)
     {
-      resp.valuelen_nontrunc = sizeof(nmsg.addr);
-      resp.valuelen = resp.valuelen_nontrunc;
-
-      if (resp.valuelen > req->max_addrlen)
-        {
-          resp.valuelen = req->max_addrlen;
-        }
+      ret = usrsockd_dataack(ud, req->head.xid, ret, 0, &nmsg.addr,
+                             MIN(sizeof(nmsg.addr), req->max_addrlen),
+                             sizeof(nmsg.addr), NULL, 0);
     }
   else
     {
-      resp.valuelen_nontrunc = 0;
-      resp.valuelen = 0;
-    }
-
-  /* Send response. */
-
-  ret = _write_to_usock(fd, &resp, sizeof(resp));
-
-  if (0 > ret)
-    {
-      goto err_out;
-    }
-
-  if (resp.valuelen > 0)
-    {
-      /* Send address (value) */
-
-      ret = _write_to_usock(fd, &nmsg.addr, resp.valuelen);
-
-      if (0 > ret)
-        {
-          goto err_out;
-        }
+      ret = usrsockd_dataack(ud, req->head.xid, ret, 0, NULL, 0, 0,
+                             NULL, 0);
     }
 
-err_out:
   gs2200m_printf("%s: end\n", __func__);
   return ret;
 }
@@ -1471,11 +1249,11 @@ err_out:
  * Name: getpeername_request
  ****************************************************************************/
 
-static int getpeername_request(int fd, FAR struct gs2200m_s *priv,
-                               FAR void *hdrbuf)
+static int getpeername_request(FAR struct usrsockd_s *ud, FAR void *hdrbuf,
+                               FAR uint8_t *data, size_t datalen)
 {
   FAR struct usrsock_request_getpeername_s *req = hdrbuf;
-  struct usrsock_message_datareq_ack_s resp;
+  FAR struct gs2200m_s *priv = ud->priv;
   FAR struct usock_s *usock;
   int ret = 0;
 
@@ -1501,53 +1279,20 @@ static int getpeername_request(int fd, FAR struct gs2200m_s *priv,
 
 prepare:
 
-  /* Prepare response. */
-
-  memset(&resp, 0, sizeof(resp));
-  resp.reqack.xid = req->head.xid;
-  resp.reqack.head.msgid  = USRSOCK_MESSAGE_RESPONSE_DATA_ACK;
-  resp.reqack.head.flags  = 0;
-  resp.reqack.head.events = 0;
-  resp.reqack.result = ret;
+  /* Send response with the address as value. */
 
   if (0 == ret)
     {
-      resp.valuelen_nontrunc = sizeof(usock->raddr);
-      resp.valuelen = resp.valuelen_nontrunc;
-
-      if (resp.valuelen > req->max_addrlen)
-        {
-          resp.valuelen = req->max_addrlen;
-        }
+      ret = usrsockd_dataack(ud, req->head.xid, ret, 0, &usock->raddr,
+                             MIN(sizeof(usock->raddr), req->max_addrlen),
+                             sizeof(usock->raddr), NULL, 0);
     }
   else
     {
-      resp.valuelen_nontrunc = 0;
-      resp.valuelen = 0;
-    }
-
-  /* Send response. */
-
-  ret = _write_to_usock(fd, &resp, sizeof(resp));
-
-  if (0 > ret)
-    {
-      goto err_out;
+      ret = usrsockd_dataack(ud, req->head.xid, ret, 0, NULL, 0, 0,
+                             NULL, 0);
     }
 
-  if (resp.valuelen > 0)
-    {
-      /* Send address (value) */
-
-      ret = _write_to_usock(fd, &usock->raddr, resp.valuelen);
-
-      if (0 > ret)
-        {
-          goto err_out;
-        }
-    }
-
-err_out:
   gs2200m_printf("%s: end\n", __func__);
   return ret;
 }
@@ -1556,14 +1301,13 @@ err_out:
  * Name: ioctl_request
  ****************************************************************************/
 
-static int ioctl_request(int fd, FAR struct gs2200m_s *priv,
-                         FAR void *hdrbuf)
+static int ioctl_request(FAR struct usrsockd_s *ud, FAR void *hdrbuf,
+                         FAR uint8_t *data, size_t datalen)
 {
   FAR struct usrsock_request_ioctl_s *req = hdrbuf;
-  struct usrsock_message_req_ack_s resp;
-  struct usrsock_message_datareq_ack_s resp2;
+  FAR struct gs2200m_s *priv = ud->priv;
   struct gs2200m_ifreq_msg imsg;
-  uint8_t sock_type;
+  uint8_t sock_type = 0;
   bool getreq = false;
   bool drvreq = true;
   int ret = -EINVAL;
@@ -1594,7 +1338,7 @@ static int ioctl_request(int fd, FAR struct gs2200m_s *priv,
       case SIOCSIFNETMASK:
         if (priv->usock_enable)
           {
-            read(fd, &imsg.ifr, sizeof(imsg.ifr));
+            memcpy(&imsg.ifr, data, MIN(datalen, sizeof(imsg.ifr)));
           }
         else
           {
@@ -1605,7 +1349,10 @@ static int ioctl_request(int fd, FAR struct gs2200m_s *priv,
 
       case SIOCDENYINETSOCK:
 
-        read(fd, &sock_type, sizeof(uint8_t));
+        if (datalen >= sizeof(uint8_t))
+          {
+            sock_type = data[0];
+          }
 
         if (sock_type == DENY_INET_SOCK_ENABLE)
           {
@@ -1640,34 +1387,13 @@ static int ioctl_request(int fd, FAR struct gs2200m_s *priv,
     {
       /* Send ACK response */
 
-      memset(&resp, 0, sizeof(resp));
-      resp.result = ret;
-      ret = _send_ack_common(fd, 0, req->head.xid, &resp);
-
-      if (0 > ret)
-        {
-          return ret;
-        }
+      return usrsockd_ack(ud, req->head.xid, ret, 0);
     }
 
-  if (getreq)
-    {
-      resp2.reqack.result = ret;
-      resp2.reqack.xid = req->head.xid;
-      resp2.reqack.head.msgid  = USRSOCK_MESSAGE_RESPONSE_DATA_ACK;
-      resp2.reqack.head.flags  = 0;
-      resp2.reqack.head.events = 0;
-      resp2.valuelen_nontrunc = sizeof(imsg.ifr);
-      resp2.valuelen = sizeof(imsg.ifr);
-
-      _write_to_usock(fd, &resp2, sizeof(resp2));
-
-      /* Return struct ifreq address */
+  /* Return struct ifreq address */
 
-      _write_to_usock(fd, &imsg.ifr, resp2.valuelen);
-    }
-
-  return ret;
+  return usrsockd_dataack(ud, req->head.xid, ret, 0, &imsg.ifr,
+                          sizeof(imsg.ifr), sizeof(imsg.ifr), NULL, 0);
 }
 
 /****************************************************************************
@@ -1683,8 +1409,9 @@ static int gs2200m_loop(FAR struct gs2200m_s *priv)
   char cid;
   int  ret;
 
-  fd[0] = open("/dev/usrsock", O_RDWR);
-  ASSERT(0 <= fd[0]);
+  ret = usrsockd_open(&priv->ud, handlers, priv);
+  ASSERT(0 == ret);
+  fd[0] = priv->ud.fd;
 
   fd[1] = open("/dev/gs2200m", O_RDWR);
   ASSERT(0 <= fd[1]);
@@ -1722,8 +1449,10 @@ static int gs2200m_loop(FAR struct gs2200m_s *priv)
 
       if (fds[0].revents & POLLIN)
         {
-          ret = usrsock_handle_request(fd[0], priv);
-          ASSERT(0 == ret);
+          /* Handles every pending request, not just one */
+
+          ret = usrsockd_process(&priv->ud);
+          ASSERT(0 <= ret);
         }
 
       if (fds[1].revents & POLLIN)
@@ -1748,7 +1477,7 @@ static int gs2200m_loop(FAR struct gs2200m_s *priv)
                * send event to all opened sockets.
                */
 
-              usock_sendevent_toall(priv, fd[0]);
+              usock_sendevent_toall(priv);
             }
           else
             {
@@ -1765,15 +1494,18 @@ static int gs2200m_loop(FAR struct gs2200m_s *priv)
                 {
                   /* send event to call xxxx_request() */
 
-                  usock_send_event(fd[0], priv, usock,
-                                  USRSOCK_EVENT_RECVFROM_AVAIL);
+                  usock_send_event(priv, usock,
+                                   USRSOCK_EVENT_RECVFROM_AVAIL);
                 }
             }
+
+          ret = usrsockd_flush(&priv->ud);
+          ASSERT(0 == ret);
         }
     }
 
   close(fd[1]);
-  close(fd[0]);
+  usrsockd_close(&priv->ud);
 
   gs2200m_printf("finished: ret=%d\n", __func__, ret);
 